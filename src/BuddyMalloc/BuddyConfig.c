@@ -215,6 +215,54 @@ int Buddy_load_parameter_from_conf(config_file_t in_config,
 
           out_parameter->keep_minimum = keep_min;
 
+        }
+      else if(!STRCMP(key_name, "Profile_Sample_Rate"))
+        {
+          size_t sample_rate;
+
+          if(s_read_size(key_value, &sample_rate))
+            {
+              LogCrit(COMPONENT_MEMALLOC,
+                      "BUDDY LOAD PARAMETER: ERROR: Unexpected value for %s: null or positive size expected.",
+                      key_name);
+              return BUDDY_ERR_EINVAL;
+            }
+
+          out_parameter->profile_sample_rate = sample_rate;
+
+        }
+      else if(!STRCMP(key_name, "Trim_Delay"))
+        {
+
+          int trim_delay = s_read_int(key_value);
+
+          if(trim_delay < 0)
+            {
+              LogCrit(COMPONENT_MEMALLOC,
+                      "BUDDY LOAD PARAMETER: ERROR: Unexpected value for %s: null or positive integer expected.",
+                      key_name);
+              return BUDDY_ERR_EINVAL;
+            }
+
+          out_parameter->trim_delay = trim_delay;
+
+        }
+      else if(!STRCMP(key_name, "Use_Hugepages"))
+        {
+          int bool;
+
+          bool = StrToBoolean(key_value);
+
+          if(bool == -1)
+            {
+              LogCrit(COMPONENT_MEMALLOC,
+                      "BUDDY LOAD PARAMETER: ERROR: Unexpected value for %s: boolean expected.",
+                      key_name);
+              return BUDDY_ERR_EINVAL;
+            }
+
+          out_parameter->use_hugepages = bool;
+
         }
       else if(!STRCMP(key_name, "LogFile"))
         {
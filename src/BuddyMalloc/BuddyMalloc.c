@@ -49,6 +49,9 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <stddef.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 /* to detect memory corruption */
 #define MAGIC_NUMBER_FREE   0xF4EEB10C
@@ -70,8 +73,14 @@ buddy_parameter_t default_buddy_parameter = {
   .keep_factor      = 3,         /* keep at least 3x the number of used pages */
   .keep_minimum     = 5,         /* Never decrease under 5 allocated pages
                                   * if this value is overcome. */
+  .profile_sample_rate = 524288LL, /* Profile 1 allocation per 512kB */
+  .trim_delay       = 60,        /* Give free pages back to the OS at most once a minute */
+  .use_hugepages    = FALSE,     /* Standard pages backed by system pages */
 };
 
+/* Size of the hugepages backing the standard pages when use_hugepages is set */
+#define BUDDY_HUGEPAGE_SIZE  ( 2 * 1024 * 1024 )
+
 /* ------------------------------------------*
  * Internal datatypes for memory management.
  * ------------------------------------------*/
@@ -148,11 +157,23 @@ typedef struct BuddyHeader_t
   /* Indicate the status for this block. */
   BuddyBlockStatus_t status;
 
+  /* (fits in the padding at the end of the header) */
+  union
+  {
+    /* Reserved block: profiler site of this block, 0 if it was not sampled. */
+    unsigned int SampleSite;
+
+    /* Free block: number of its system pages given back to the OS. */
+    unsigned int ReleasedPages;
+  } BlockState;
+
 } BuddyHeader_t;
 
 /* aliases */
 #define StdInfo BlockInfo.StdInfo
 #define ExtraInfo BlockInfo.ExtraInfo
+#define SampleSite BlockState.SampleSite
+#define ReleasedPages BlockState.ReleasedPages
 
 /** Content of a free buddy block (without header)  */
 typedef struct BuddyFreeBlockInfo_t
@@ -220,6 +241,19 @@ typedef struct BuddyThreadContext_t
 
   char label_thread[STR_LEN];
 
+  /* Bytes to allocate before the next sampled block, and the seed
+   * of the random intervals between samples. */
+  long long SampleCountdown;
+  unsigned int SampleSeed;
+
+  /* Standard pages are mmapped and backed by hugepages. */
+  int HugePages;
+
+  /* Granularity of the free space given back to the OS,
+   * and last time it was given back. */
+  size_t TrimPageSize;
+  time_t LastTrim;
+
 #ifdef _DEBUG_MEMLEAKS
 
   /* block label (for debugging) */
@@ -591,6 +625,9 @@ static void Insert_FreeBlock(BuddyThreadContext_t * context, BuddyBlock_t * p_bu
   /* check current magic number */
   isBadMagicNumber("Insert_FreeBlock:", context, p_buddyblock, MAGIC_NUMBER_FREE, 0);
 
+  context->Stats.StdReleasedSpace +=
+      (size_t) p_buddyblock->Header.ReleasedPages * context->TrimPageSize;
+
   /* Is there already a free block in the list ? */
   if((next = context->MemDesc[p_buddyblock->Header.StdInfo.k_size]) != NULL)
     {
@@ -628,6 +665,10 @@ static void Remove_FreeBlock(BuddyThreadContext_t * context, BuddyBlock_t * p_bu
   /* check current magic number */
   isBadMagicNumber("Remove_FreeBlock:", context, p_buddyblock, MAGIC_NUMBER_FREE, 0);
 
+  /* the caller keeps ReleasedPages if it merges the block */
+  context->Stats.StdReleasedSpace -=
+      (size_t) p_buddyblock->Header.ReleasedPages * context->TrimPageSize;
+
   prev = p_buddyblock->Content.FreeBlockInfo.PrevBlock;
   next = p_buddyblock->Content.FreeBlockInfo.NextBlock;
 
@@ -687,6 +728,31 @@ static BuddyBlock_t *Get_BuddyBlock(BuddyThreadContext_t * context,
 
 }                               /* Get_BuddyBlock */
 
+/**
+ * ReleasableArea :
+ * System pages of a free block that can be given back to the OS:
+ * all of them but those holding the header and the free list links.
+ * Returns the number of pages, and their address in *p_start.
+ */
+static unsigned int ReleasableArea(BuddyThreadContext_t * context,
+                                   BuddyBlock_t * p_buddyblock, BUDDY_ADDR_T * p_start)
+{
+  BUDDY_PTRDIFF_T page = context->TrimPageSize;
+  BUDDY_PTRDIFF_T start;
+  BUDDY_PTRDIFF_T end;
+
+  start = ((BUDDY_PTRDIFF_T) p_buddyblock + size_header64 + MIN_ALLOC_SIZE + page - 1)
+      & ~(page - 1);
+  end = ((BUDDY_PTRDIFF_T) p_buddyblock + ((BUDDY_PTRDIFF_T) 1 << p_buddyblock->Header.StdInfo.k_size))
+      & ~(page - 1);
+
+  if(p_start)
+    *p_start = (BUDDY_ADDR_T) start;
+
+  return (end > start) ? (end - start) / page : 0;
+
+}                               /* ReleasableArea */
+
 /**
  * UpdateStats_InsertStdPage:
  * update statistics to remember that there is a new standard page.
@@ -882,6 +948,46 @@ static void UpdateStats_RemoveExtraPage(BuddyThreadContext_t * context, size_t a
 
 }
 
+/**
+ * AllocStdPageArea / FreeStdPageArea :
+ * Memory of the standard pages. With hugepages, the pages are mmapped on
+ * a boundary of their size, so that the kernel can back them with
+ * transparent hugepages.
+ */
+static void *AllocStdPageArea(BuddyThreadContext_t * context, size_t allocation)
+{
+  char *area;
+  char *aligned;
+
+  if(!context->HugePages)
+    return malloc(allocation);
+
+  area = (char *)mmap(NULL, 2 * allocation, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(area == (char *)MAP_FAILED)
+    return NULL;
+
+  /* keep the aligned part only */
+  aligned = (char *)(((BUDDY_PTRDIFF_T) area + allocation - 1) & ~(allocation - 1));
+  if(aligned > area)
+    munmap(area, aligned - area);
+  munmap(aligned + allocation, area + allocation - aligned);
+
+#ifdef MADV_HUGEPAGE
+  madvise(aligned, allocation, MADV_HUGEPAGE);
+#endif
+
+  return aligned;
+}
+
+static void FreeStdPageArea(BuddyThreadContext_t * context, void *area, size_t allocation)
+{
+  if(context->HugePages)
+    munmap(area, allocation);
+  else
+    free(area);
+}
+
 /**
  *  NewStdPage :
  *  Adds a new page (with standard size) to the pool.
@@ -899,7 +1005,7 @@ BuddyBlock_t *NewStdPage(BuddyThreadContext_t * context)
   k_size = context->k_size;
   allocation = 1 << k_size;
 
-  p_block = (BuddyBlock_t *) malloc(allocation);
+  p_block = (BuddyBlock_t *) AllocStdPageArea(context, allocation);
 
   LogFullDebug(COMPONENT_MEMALLOC, "Memory area allocation for thread %p : ptr=%p ; size=%llu=2^%u",
                (caddr_t)pthread_self(), p_block, (unsigned long long)allocation, k_size);
@@ -913,6 +1019,7 @@ BuddyBlock_t *NewStdPage(BuddyThreadContext_t * context)
   p_block->Header.StdInfo.Base_kSize = k_size;
   p_block->Header.status = FREE_BLOCK;
   p_block->Header.StdInfo.k_size = k_size;
+  p_block->Header.ReleasedPages = 0;
 
   p_block->Header.MagicNumber = MAGIC_NUMBER_FREE;
 
@@ -958,7 +1065,7 @@ static void Garbage_StdPages(BuddyThreadContext_t * context,
 
   Remove_FreeBlock(context, p_last_free_block);
 
-  free(p_last_free_block);
+  FreeStdPageArea(context, p_last_free_block, context->Stats.StdPageSize);
 
   UpdateStats_RemoveStdPage(context);
 
@@ -1008,6 +1115,7 @@ BUDDY_ADDR_T AllocLargeBlock(BuddyThreadContext_t * context, size_t Size)
   p_block->Header.status = RESERVED_BLOCK;
   p_block->Header.MagicNumber = MAGIC_NUMBER_USED;
   p_block->Header.OwnerThread = pthread_self();
+  p_block->Header.SampleSite = 0;
 #ifndef _MONOTHREAD_MEMALLOC
   p_block->Header.OwnerThreadContext = context;
 #endif
@@ -1041,6 +1149,119 @@ BUDDY_ADDR_T AllocLargeBlock(BuddyThreadContext_t * context, size_t Size)
 /* Macro used to determine if it is a extra block or not (for BuddyFree) */
 #define IS_EXTRA_BLOCK( _p_block_ ) ( (_p_block_)->Header.Base_ptr == NULL )
 
+/* Size of the user space of a reserved block */
+static size_t BlockUserSize(BuddyBlock_t * p_block)
+{
+  if(IS_EXTRA_BLOCK(p_block))
+    return p_block->Header.ExtraInfo - size_header64;
+  else
+    return ((size_t) 1 << p_block->Header.StdInfo.k_size) - size_header64;
+}
+
+/* ------------------------------------------*
+ *       Sampled allocation profiler.
+ * ------------------------------------------*/
+
+/* Mean number of bytes between two sampled blocks, 0 if profiling is off.
+ * Set once at startup: the weight of a block is computed again when it is freed. */
+static size_t buddy_profile_rate = 0;
+
+/* A block of size bytes is sampled with a probability of about
+ * size/rate: it stands for max(size, rate) allocated bytes. */
+static size_t BuddyProfileWeight(size_t size)
+{
+  return (size > buddy_profile_rate) ? size : buddy_profile_rate;
+}
+
+/**
+ * BuddySetProfileRate:
+ * Sets the mean number of bytes allocated between two sampled blocks.
+ * 0 disables the profiler. To be called before the threads allocate memory.
+ */
+void BuddySetProfileRate(size_t sample_rate)
+{
+  buddy_profile_rate = sample_rate;
+}
+
+size_t BuddyGetProfileRate()
+{
+  return buddy_profile_rate;
+}
+
+/* Bytes before the next sample: rate in average, at random to avoid
+ * always sampling the same allocation of a periodic pattern */
+static long long BuddyProfileInterval(BuddyThreadContext_t * context)
+{
+  return buddy_profile_rate / 2 + rand_r(&context->SampleSeed) % (buddy_profile_rate + 1);
+}
+
+/* Counts a block against the countdown of the thread, and records
+ * it in the profile when the countdown expires. */
+static BUDDY_ADDR_T BuddyProfileSample(BUDDY_ADDR_T ptr, const char *file,
+                                       unsigned int line, const char *label)
+{
+  BuddyThreadContext_t *context;
+  BuddyBlock_t *p_block;
+  size_t size;
+
+  if(ptr == NULL || buddy_profile_rate == 0)
+    return ptr;
+
+  if((context = GetThreadContext()) == NULL)
+    return ptr;
+
+  p_block = (BuddyBlock_t *) (ptr - size_header64);
+  size = BlockUserSize(p_block);
+
+  /* the countdown starts with the first block profiled by the thread */
+  if(context->SampleCountdown == 0)
+    context->SampleCountdown = BuddyProfileInterval(context);
+
+  context->SampleCountdown -= size;
+  if(context->SampleCountdown > 0)
+    return ptr;
+
+  context->SampleCountdown = BuddyProfileInterval(context);
+
+  p_block->Header.SampleSite = BuddyProfileRecordAlloc(file, line, label, size,
+                                                       BuddyProfileWeight(size));
+  return ptr;
+}                               /* BuddyProfileSample */
+
+BUDDY_ADDR_T BuddyMalloc_Sampled(size_t sz, const char *file, unsigned int line,
+                                 const char *label)
+{
+  return BuddyProfileSample(BuddyMallocExit(sz), file, line, label);
+}
+
+BUDDY_ADDR_T BuddyCalloc_Sampled(size_t NumberOfElements, size_t ElementSize,
+                                 const char *file, unsigned int line, const char *label)
+{
+  return BuddyProfileSample(BuddyCalloc(NumberOfElements, ElementSize), file, line, label);
+}
+
+BUDDY_ADDR_T BuddyRealloc_Sampled(BUDDY_ADDR_T ptr, size_t Size,
+                                  const char *file, unsigned int line, const char *label)
+{
+  BuddyBlock_t *p_block;
+
+  /* The old block leaves the profile before the realloc, at its old size:
+   * the new block may keep its header and be sampled for another site */
+  if(ptr != NULL)
+    {
+      p_block = (BuddyBlock_t *) (ptr - size_header64);
+
+      if(p_block->Header.status == RESERVED_BLOCK && p_block->Header.SampleSite != 0)
+        {
+          BuddyProfileRecordFree(p_block->Header.SampleSite, BlockUserSize(p_block),
+                                 BuddyProfileWeight(BlockUserSize(p_block)));
+          p_block->Header.SampleSite = 0;
+        }
+    }
+
+  return BuddyProfileSample(BuddyRealloc(ptr, Size), file, line, label);
+}
+
 /**
  * FreeLargeBlock:
  * free blocks that are larger than the standard page size.
@@ -1143,7 +1364,7 @@ static int TryContextCleanup(BuddyThreadContext_t * context)
             LogFullDebug(COMPONENT_MEMALLOC, "Releasing memory page at address %p, size=2^%u",
                          p_block, p_block->Header.StdInfo.k_size );
             Remove_FreeBlock(context, p_block);
-            free(p_block);
+            FreeStdPageArea(context, p_block, context->Stats.StdPageSize);
             UpdateStats_RemoveStdPage(context);
           }
 
@@ -1297,6 +1518,27 @@ int BuddyInit(buddy_parameter_t * p_buddy_init_info)
   context->Stats.NbExtraPages = 0;
   context->Stats.WM_NbExtraPages = 0;
 
+  context->Stats.StdReleasedSpace = 0;
+
+  /* Hugepages only make sense for standard pages made of several of them */
+  context->HugePages = FALSE;
+  context->TrimPageSize = sysconf(_SC_PAGESIZE);
+
+  if(context->Config.use_hugepages)
+    {
+      if(context->Stats.StdPageSize >= BUDDY_HUGEPAGE_SIZE)
+        {
+          context->HugePages = TRUE;
+          context->TrimPageSize = BUDDY_HUGEPAGE_SIZE;
+        }
+      else
+        LogEvent(COMPONENT_MEMALLOC,
+                 "Page size %llu is smaller than a hugepage, hugepages not used for thread %p",
+                 (unsigned long long)context->Stats.StdPageSize, (caddr_t)pthread_self());
+    }
+
+  context->LastTrim = time(NULL);
+
 #ifndef _MONOTHREAD_MEMALLOC
   if(pthread_mutex_init(&context->ToBeFreed_mutex, NULL) != 0)
     {
@@ -1309,6 +1551,10 @@ int BuddyInit(buddy_parameter_t * p_buddy_init_info)
   context->destroy_pending = FALSE;
 #endif
 
+  /* the first sample comes after a random amount of bytes */
+  context->SampleSeed = (unsigned int)time(NULL) ^ (unsigned int)(unsigned long)context;
+  context->SampleCountdown = 0;
+
   /* structure is initialized */
 
   context->initialized = TRUE;
@@ -1387,6 +1633,7 @@ static BUDDY_ADDR_T __BuddyMalloc(size_t Size, int do_exit_on_error)
   BuddyBlock_t *p_block;
   BuddyThreadContext_t *context;
   size_t allocation;
+  int released;
 
   /* Ensure thread safety. */
   context = GetThreadContext();
@@ -1507,6 +1754,10 @@ static BUDDY_ADDR_T __BuddyMalloc(size_t Size, int do_exit_on_error)
 
   Remove_FreeBlock(context, p_block);
 
+  /* If all its free pages were given back to the OS, so were those of its halves */
+  released = (p_block->Header.ReleasedPages != 0 &&
+              p_block->Header.ReleasedPages == ReleasableArea(context, p_block, NULL));
+
   /* If it was a whole page, we notice that it becomes used */
 
   if((p_block->Header.Base_ptr == (BUDDY_ADDR_T) p_block)
@@ -1539,6 +1790,7 @@ static BUDDY_ADDR_T __BuddyMalloc(size_t Size, int do_exit_on_error)
       p_buddy->Header.MagicNumber = MAGIC_NUMBER_FREE;
 
       p_buddy->Header.StdInfo.k_size = p_block->Header.StdInfo.k_size;
+      p_buddy->Header.ReleasedPages = released ? ReleasableArea(context, p_buddy, NULL) : 0;
 
       /* insert block into the free list */
       Insert_FreeBlock(context, p_buddy);
@@ -1550,6 +1802,7 @@ static BUDDY_ADDR_T __BuddyMalloc(size_t Size, int do_exit_on_error)
 
   p_block->Header.MagicNumber = MAGIC_NUMBER_USED;
   p_block->Header.OwnerThread = pthread_self();
+  p_block->Header.SampleSite = 0;
 
 #ifndef _MONOTHREAD_MEMALLOC
   p_block->Header.OwnerThreadContext = context;
@@ -1600,6 +1853,7 @@ BUDDY_ADDR_T BuddyMallocExit(size_t Size)
 static void __BuddyFree(BuddyThreadContext_t * context, BuddyBlock_t * p_block)
 {
   BuddyBlock_t *p_block_tmp;
+  unsigned int released_pages = 0;
 
 #ifdef _DEBUG_MEMLEAKS
   /* remove from allocated blocks */
@@ -1650,8 +1904,9 @@ static void __BuddyFree(BuddyThreadContext_t * context, BuddyBlock_t * p_block)
         /* stop merging */
         break;
 
-      /* The buddy can be merged */
+      /* The buddy can be merged, with the pages it gave back to the OS */
       Remove_FreeBlock(context, p_buddy);
+      released_pages += p_buddy->Header.ReleasedPages;
 
       LogFullDebug(COMPONENT_MEMALLOC, "%p:Merging %p with %p (sizes 2^%.2u)", (BUDDY_ADDR_T) pthread_self(),
                    p_buddy, p_block_tmp, p_block_tmp->Header.StdInfo.k_size);
@@ -1668,6 +1923,7 @@ static void __BuddyFree(BuddyThreadContext_t * context, BuddyBlock_t * p_block)
 
   /* Add the merged bloc to the free list */
 
+  p_block_tmp->Header.ReleasedPages = released_pages;
   Insert_FreeBlock(context, p_block_tmp);
 
   /* update stats */
@@ -1762,6 +2018,14 @@ void BuddyFree(BUDDY_ADDR_T ptr)
       return;
     }
 
+  /* a sampled block leaves the profile, whichever thread frees it */
+  if(p_block->Header.SampleSite != 0)
+    {
+      BuddyProfileRecordFree(p_block->Header.SampleSite, BlockUserSize(p_block),
+                             BuddyProfileWeight(BlockUserSize(p_block)));
+      p_block->Header.SampleSite = 0;
+    }
+
   /* check owner thread */
 
   if(p_block->Header.OwnerThread != pthread_self())
@@ -2156,6 +2420,71 @@ void BuddyGetStats(buddy_stats_t * budd_stats)
 
 }
 
+/**
+ *  Gives the free pages of the current thread back to the OS.
+ *  With force, trim_delay is not waited for (but 0 still disables it).
+ */
+size_t BuddyTrim(int force)
+{
+  BuddyThreadContext_t *context;
+  BuddyBlock_t *p_block;
+  BUDDY_ADDR_T start;
+  unsigned int nb_pages;
+  unsigned int k;
+  size_t released = 0;
+  time_t now;
+
+  /* Ensure thread safety. */
+  context = GetThreadContext();
+
+  /* sanity check */
+  if(!context || !context->initialized || context->Config.trim_delay == 0)
+    return 0;
+
+  now = time(NULL);
+  if(!force && now - context->LastTrim < context->Config.trim_delay)
+    return 0;
+
+  context->LastTrim = now;
+
+#ifndef _MONOTHREAD_MEMALLOC
+  /* check if there are some blocks to be freed */
+  CheckBlocksToBeFreed(context, TRUE);
+#endif
+
+#ifdef MADV_DONTNEED
+  /* The smaller blocks have no page to give back */
+  for(k = Log2Ceil(2 * context->TrimPageSize); k <= context->k_size; k++)
+    {
+      for(p_block = context->MemDesc[k]; p_block != NULL;
+          p_block = p_block->Content.FreeBlockInfo.NextBlock)
+        {
+          nb_pages = ReleasableArea(context, p_block, &start);
+
+          /* the released pages stay released until the block is allocated */
+          if(nb_pages == p_block->Header.ReleasedPages)
+            continue;
+
+          if(madvise(start, (size_t) nb_pages * context->TrimPageSize, MADV_DONTNEED) != 0)
+            continue;
+
+          released += (size_t) (nb_pages - p_block->Header.ReleasedPages) * context->TrimPageSize;
+          context->Stats.StdReleasedSpace +=
+              (size_t) (nb_pages - p_block->Header.ReleasedPages) * context->TrimPageSize;
+          p_block->Header.ReleasedPages = nb_pages;
+        }
+    }
+#endif
+
+  if(released > 0)
+    LogDebug(COMPONENT_MEMALLOC, "%p: %llu bytes given back to the OS, %llu released in all",
+             (caddr_t)pthread_self(), (unsigned long long)released,
+             (unsigned long long)context->Stats.StdReleasedSpace);
+
+  return released;
+
+}                               /* BuddyTrim */
+
 
 #ifdef _DEBUG_MEMLEAKS
 
@@ -2212,6 +2541,7 @@ void _InitPool(struct prealloc_pool *pool,
 {
   int size;
   pool->pa_free        = NULL;
+  pool->pa_slab        = NULL;
   pool->pa_constructor = ctor;
   pool->pa_destructor  = dtor;
   pool->pa_size        = size_type;
@@ -2561,8 +2891,17 @@ void BuddyDumpPools(FILE *output)
 #ifndef _MONOTHREAD_MEMALLOC
 #ifndef _NO_BLOCK_PREALLOC
   struct prealloc_pool *pool;
+  slab_stats_t stats;
+  int blocks, allocated, used;
+
+  /* Pools are only added at the head of the list, so it can be walked
+   * without the mutex once the head is read. This matters for shared
+   * pools: their counters are read from the slab cache, whose registry
+   * mutex is taken before ContextListMutex by SlabCacheCreate. */
   P(ContextListMutex);
   pool = first_pool;
+  V(ContextListMutex);
+
   fprintf(output, "Num Blocks  Num/Block  Size of Entry  Num Allocated  Num in Use  Max in Use  Type/Name\n"
                   "----------  ---------  -------------  -------------  ----------  ----------  ------------------------\n");
   while (pool != NULL)
@@ -2570,14 +2909,32 @@ void BuddyDumpPools(FILE *output)
       char *n = pool->pa_type;
       if (pool->pa_name[0] != '\0')
         n = pool->pa_name;
+
+      if (pool->pa_slab != NULL)
+        {
+          /* Shared pool: entries cross threads, only the slab cache counts them.
+           * The max in use is the highest count seen by the dumps. */
+          SlabCacheGetStats(pool->pa_slab, &stats);
+          blocks = (int) stats.nb_grow;
+          allocated = (int) stats.nb_objects;
+          used = (int) stats.nb_in_use;
+          if (used > pool->pa_high)
+            pool->pa_high = used;
+        }
+      else
+        {
+          blocks = pool->pa_blocks;
+          allocated = pool->pa_allocated;
+          used = pool->pa_used;
+        }
+
       fprintf(output,
               "%10d  %9d  %13d  %13d  %10d  %10d  %s\n",
-              pool->pa_blocks, pool->pa_num, (int) pool->pa_size,
-              pool->pa_allocated, pool->pa_used, pool->pa_high,
+              blocks, pool->pa_num, (int) pool->pa_size,
+              allocated, used, pool->pa_high,
               n);
       pool = pool->pa_next_pool;
     }
-  V(ContextListMutex);
 #endif
 #endif
 }
@@ -0,0 +1,222 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * \file    BuddyProfile.c
+ * \brief   Call sites of the blocks sampled by the allocation profiler.
+ *
+ * BuddyProfile.c : Call sites of the blocks sampled by the allocation profiler.
+ *
+ * BuddyMalloc samples about one block per Profile_Sample_Rate allocated
+ * bytes, whatever the thread, and counts it here for the Mem_Alloc_Label
+ * call site that asked for it. Only the sampled blocks take the mutex of
+ * the table, so the cost for the other allocations is a countdown in the
+ * thread context. A sampled block keeps the index of its site in its
+ * header, and is counted out of the site when it is freed.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "BuddyMalloc.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+static pthread_mutex_t profile_mutex = PTHREAD_MUTEX_INITIALIZER;
+static buddy_profile_site_t profile_sites[BUDDY_PROFILE_NB_SITES];
+static unsigned short profile_index[BUDDY_PROFILE_NB_SITES * 2];       /* hash -> site, 0 if empty */
+static unsigned int profile_nb_sites = 1;       /* site 0 means "not sampled" */
+
+/* The file names are the __FILE__ of the callers: their address identifies them */
+static unsigned int profile_hash(const char *file, unsigned int line)
+{
+  unsigned long h = (unsigned long)file ^ ((unsigned long)line * 2654435761UL);
+
+  return (unsigned int)((h ^ (h >> 15)) & (BUDDY_PROFILE_NB_SITES * 2 - 1));
+}
+
+/**
+ * BuddyProfileRecordAlloc:
+ * Counts a sampled block of size bytes, standing for weight bytes, for its call site.
+ * Returns the index of the site, 0 if the table is full.
+ */
+unsigned int BuddyProfileRecordAlloc(const char *file, unsigned int line,
+                                     const char *label, size_t size, size_t weight)
+{
+  buddy_profile_site_t *psite;
+  unsigned int h = profile_hash(file, line);
+  unsigned int site;
+
+  pthread_mutex_lock(&profile_mutex);
+
+  /* open addressing, the index has twice as many slots as the table */
+  while((site = profile_index[h]) != 0)
+    {
+      if(profile_sites[site].file == file && profile_sites[site].line == line)
+        break;
+      h = (h + 1) & (BUDDY_PROFILE_NB_SITES * 2 - 1);
+    }
+
+  if(site == 0)
+    {
+      if(profile_nb_sites == BUDDY_PROFILE_NB_SITES)
+        {
+          pthread_mutex_unlock(&profile_mutex);
+          return 0;
+        }
+
+      site = profile_nb_sites;
+      psite = &profile_sites[site];
+      psite->file = file;
+      psite->line = line;
+      strncpy(psite->label, (label != NULL) ? label : "", BUDDY_PROFILE_LABEL_LEN - 1);
+      psite->label[BUDDY_PROFILE_LABEL_LEN - 1] = '\0';
+
+      profile_index[h] = site;
+      profile_nb_sites += 1;
+    }
+
+  psite = &profile_sites[site];
+  psite->nb_alloc += weight / size;
+  psite->alloc_bytes += weight;
+
+  pthread_mutex_unlock(&profile_mutex);
+
+  return site;
+}                               /* BuddyProfileRecordAlloc */
+
+/**
+ * BuddyProfileRecordFree:
+ * Counts a sampled block out of its call site.
+ */
+void BuddyProfileRecordFree(unsigned int site, size_t size, size_t weight)
+{
+  if(site == 0 || site >= BUDDY_PROFILE_NB_SITES)
+    return;
+
+  pthread_mutex_lock(&profile_mutex);
+  profile_sites[site].nb_free += weight / size;
+  profile_sites[site].free_bytes += weight;
+  pthread_mutex_unlock(&profile_mutex);
+}                               /* BuddyProfileRecordFree */
+
+/**
+ * BuddyProfileSnapshot:
+ * Copies the counters of all the sites.
+ */
+void BuddyProfileSnapshot(buddy_profile_snapshot_t * psnap)
+{
+  pthread_mutex_lock(&profile_mutex);
+  psnap->nb_sites = profile_nb_sites;
+  memcpy(psnap->sites, profile_sites, profile_nb_sites * sizeof(buddy_profile_site_t));
+  pthread_mutex_unlock(&profile_mutex);
+
+  psnap->when = time(NULL);
+  psnap->sample_rate = BuddyGetProfileRate();
+}                               /* BuddyProfileSnapshot */
+
+/**
+ * BuddyProfileDiff:
+ * What was allocated and freed between two snapshots.
+ * The sites keep their index, those of pold are a prefix of those of pnew.
+ */
+void BuddyProfileDiff(buddy_profile_snapshot_t * pold,
+                      buddy_profile_snapshot_t * pnew, buddy_profile_snapshot_t * pdiff)
+{
+  unsigned int i;
+
+  pdiff->when = pnew->when;
+  pdiff->sample_rate = pnew->sample_rate;
+  pdiff->nb_sites = pnew->nb_sites;
+
+  for(i = 1; i < pnew->nb_sites; i++)
+    {
+      pdiff->sites[i] = pnew->sites[i];
+
+      if(pold == NULL || i >= pold->nb_sites)
+        continue;
+
+      pdiff->sites[i].nb_alloc -= pold->sites[i].nb_alloc;
+      pdiff->sites[i].nb_free -= pold->sites[i].nb_free;
+      pdiff->sites[i].alloc_bytes -= pold->sites[i].alloc_bytes;
+      pdiff->sites[i].free_bytes -= pold->sites[i].free_bytes;
+    }
+}                               /* BuddyProfileDiff */
+
+/**
+ * BuddyProfileTop:
+ * Indexes of the nb sites having the most live bytes (or allocated
+ * bytes if by_alloc), in decreasing order. Returns how many were found.
+ */
+unsigned int BuddyProfileTop(buddy_profile_snapshot_t * psnap, int by_alloc,
+                             unsigned int *indexes, unsigned int nb)
+{
+  unsigned int nb_found = 0;
+  unsigned int i, j;
+  long long value;
+
+#define PROFILE_VALUE( _i_ ) ( by_alloc ? (long long)psnap->sites[_i_].alloc_bytes \
+                                        : (long long)BuddyProfileLiveBytes(&psnap->sites[_i_]) )
+
+  /* insertion in a sorted array of nb items, there are few sites */
+  for(i = 1; i < psnap->nb_sites; i++)
+    {
+      value = PROFILE_VALUE(i);
+
+      if(value <= 0 || (nb_found == nb && value <= PROFILE_VALUE(indexes[nb - 1])))
+        continue;
+
+      j = (nb_found < nb) ? nb_found++ : nb - 1;
+      while(j > 0 && PROFILE_VALUE(indexes[j - 1]) < value)
+        {
+          indexes[j] = indexes[j - 1];
+          j -= 1;
+        }
+      indexes[j] = i;
+    }
+
+#undef PROFILE_VALUE
+
+  return nb_found;
+}                               /* BuddyProfileTop */
+
+/**
+ * BuddyProfileSprintSite:
+ * Prints a site as label@file:line live_bytes alloc_bytes free_bytes nb_alloc nb_free
+ * Returns the number of characters printed, as snprintf.
+ */
+int BuddyProfileSprintSite(char *str, size_t size, buddy_profile_site_t * psite)
+{
+  const char *file = strrchr(psite->file, '/');
+
+  return snprintf(str, size, "%s@%s:%u %lld %llu %llu %llu %llu",
+                  psite->label, (file != NULL) ? file + 1 : psite->file, psite->line,
+                  (long long)BuddyProfileLiveBytes(psite),
+                  psite->alloc_bytes, psite->free_bytes, psite->nb_alloc, psite->nb_free);
+}                               /* BuddyProfileSprintSite */
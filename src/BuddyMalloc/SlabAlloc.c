@@ -0,0 +1,640 @@
+/*
+ *
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * \file    SlabAlloc.c
+ * \brief   Thread-safe slab allocator with per-thread magazines.
+ *
+ * SlabAlloc.c : Thread-safe slab allocator with per-thread magazines.
+ *
+ * Every thread owns a 'loaded' and a 'previous' magazine per cache.
+ * Allocation pops from 'loaded', swaps with 'previous' when 'loaded' is
+ * empty, and only then goes to the depot for a full magazine. Release
+ * pushes into 'loaded', swaps with 'previous' when 'loaded' is full, and
+ * only then hands the full magazine to the depot. A thread therefore
+ * holds at most two magazines per cache, which bounds what an idle
+ * thread can hoard; SlabThreadFlush gives them back entirely.
+ *
+ * Slabs are allocated, and their objects constructed, by the thread that
+ * needs them. With the kernel first-touch policy the pages are local to
+ * the node of that thread, and the magazines keep them there as long as
+ * that thread allocates and releases them.
+ *
+ * Slabs are never given back to the system, as it was already the case
+ * for the preallocated pools.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "SlabAlloc.h"
+#include "stuff_alloc.h"
+#include "log_macros.h"
+
+#ifndef P
+#define P( _mutex_ ) pthread_mutex_lock( &_mutex_ )
+#endif
+#ifndef V
+#define V( _mutex_ ) pthread_mutex_unlock( &_mutex_ )
+#endif
+
+/* Header in front of each object: points to itself when the object is in
+ * use, links the object in the overflow list otherwise. */
+typedef struct slab_header__
+{
+  struct slab_header__ *next;
+} slab_header_t;
+
+#define SLAB_HEADER_SIZE ((sizeof(slab_header_t) + 7) & ~7)
+#define slab_get_header(entry) ((slab_header_t *) ((char *)(entry) - SLAB_HEADER_SIZE))
+#define slab_get_entry(header) ((void *) ((char *)(header) + SLAB_HEADER_SIZE))
+
+/* Magazines of a thread for a given cache */
+typedef struct slab_thread_cache__
+{
+  slab_magazine_t *loaded;
+  slab_magazine_t *previous;
+  unsigned long long nb_alloc;
+  unsigned long long nb_free;
+} slab_thread_cache_t;
+
+/* Per-thread context */
+typedef struct slab_thread__
+{
+  struct slab_thread__ *next;
+  struct slab_thread__ *prev;
+  slab_thread_cache_t caches[SLAB_MAX_CACHES];
+} slab_thread_t;
+
+static pthread_mutex_t slab_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static slab_cache_t *slab_caches[SLAB_MAX_CACHES];
+static unsigned int slab_nb_caches = 0;
+static slab_thread_t *slab_threads = NULL;
+
+static pthread_key_t slab_thread_key;
+static pthread_once_t slab_once_key = PTHREAD_ONCE_INIT;
+
+/* Loose objects, used when no magazine could be allocated to store them */
+static slab_header_t *slab_overflow[SLAB_MAX_CACHES];
+
+static void slab_thread_exit(void *arg);
+
+/* init pthread_key for current thread */
+static void slab_init_keys(void)
+{
+  if(pthread_key_create(&slab_thread_key, slab_thread_exit) != 0)
+    LogMajor(COMPONENT_MEMALLOC, "SlabAlloc: error creating pthread key for thread %p",
+             (caddr_t) pthread_self());
+}                               /* slab_init_keys */
+
+/**
+ * slab_get_thread:
+ * Returns the magazines of the current thread, allocating them the first time.
+ */
+static slab_thread_t *slab_get_thread(void)
+{
+  slab_thread_t *pthr;
+
+  if(pthread_once(&slab_once_key, slab_init_keys) != 0)
+    return NULL;
+
+  pthr = (slab_thread_t *) pthread_getspecific(slab_thread_key);
+
+  if(pthr != NULL)
+    return pthr;
+
+  /* Not taken from the buddy allocator: the context outlives its thread's
+   * buddy context when the key destructor runs. */
+  if((pthr = (slab_thread_t *) calloc(1, sizeof(slab_thread_t))) == NULL)
+    {
+      LogMajor(COMPONENT_MEMALLOC, "SlabAlloc: not enough memory for thread %p",
+               (caddr_t) pthread_self());
+      return NULL;
+    }
+
+  P(slab_registry_mutex);
+  pthr->prev = NULL;
+  pthr->next = slab_threads;
+  if(slab_threads != NULL)
+    slab_threads->prev = pthr;
+  slab_threads = pthr;
+  V(slab_registry_mutex);
+
+  pthread_setspecific(slab_thread_key, (void *)pthr);
+
+  return pthr;
+}                               /* slab_get_thread */
+
+/**
+ * slab_depot_put:
+ * Gives a magazine back to the depot. Must be called with depot_mutex held.
+ */
+static void slab_depot_put(slab_cache_t * cache, slab_magazine_t * mag)
+{
+  if(mag == NULL)
+    return;
+
+  if(mag->rounds == 0)
+    {
+      mag->next = cache->depot_empty;
+      cache->depot_empty = mag;
+      cache->depot_stats.nb_empty_magazines++;
+    }
+  else
+    {
+      mag->next = cache->depot_full;
+      cache->depot_full = mag;
+      cache->depot_stats.nb_full_magazines++;
+      cache->depot_stats.nb_depot_put++;
+    }
+}                               /* slab_depot_put */
+
+/**
+ * slab_depot_get_full:
+ * Takes a non empty magazine from the depot. Must be called with depot_mutex held.
+ */
+static slab_magazine_t *slab_depot_get_full(slab_cache_t * cache)
+{
+  slab_magazine_t *mag = cache->depot_full;
+
+  if(mag != NULL)
+    {
+      cache->depot_full = mag->next;
+      cache->depot_stats.nb_full_magazines--;
+      cache->depot_stats.nb_depot_get++;
+    }
+
+  return mag;
+}                               /* slab_depot_get_full */
+
+/**
+ * slab_thread_exit:
+ * pthread_key destructor: the magazines of the exiting thread go to the depots.
+ */
+static void slab_thread_exit(void *arg)
+{
+  slab_thread_t *pthr = (slab_thread_t *) arg;
+  slab_thread_cache_t *ptc;
+  slab_cache_t *cache;
+  unsigned int i;
+
+  P(slab_registry_mutex);
+
+  for(i = 0; i < slab_nb_caches; i++)
+    {
+      cache = slab_caches[i];
+      ptc = &pthr->caches[i];
+
+      P(cache->depot_mutex);
+      slab_depot_put(cache, ptc->loaded);
+      slab_depot_put(cache, ptc->previous);
+      cache->depot_stats.nb_alloc += ptc->nb_alloc;
+      cache->depot_stats.nb_free += ptc->nb_free;
+      V(cache->depot_mutex);
+    }
+
+  if(pthr->prev != NULL)
+    pthr->prev->next = pthr->next;
+  else
+    slab_threads = pthr->next;
+  if(pthr->next != NULL)
+    pthr->next->prev = pthr->prev;
+
+  V(slab_registry_mutex);
+
+  free(pthr);
+}                               /* slab_thread_exit */
+
+/**
+ * SlabCacheCreate: Gets the slab cache for a given kind of objects.
+ *
+ * The caches are shared: a cache created with the same name, size,
+ * constructor and destructor as an existing one is that very cache.
+ *
+ * @param name      name of the cache (usually the type name).
+ * @param entry_size size of the objects.
+ * @param slab_objs number of objects allocated at once when the cache grows.
+ * @param ctor      constructor called once on each object when its slab is allocated.
+ * @param dtor      destructor called on each object when it is released.
+ *
+ * @return the cache, or NULL if SLAB_MAX_CACHES is reached.
+ *
+ */
+slab_cache_t *SlabCacheCreate(const char *name,
+                              size_t entry_size,
+                              unsigned int slab_objs,
+                              void (*ctor) (void *entry), void (*dtor) (void *entry))
+{
+  slab_cache_t *cache;
+  unsigned int i;
+
+  P(slab_registry_mutex);
+
+  for(i = 0; i < slab_nb_caches; i++)
+    {
+      cache = slab_caches[i];
+      if(cache->entry_size == entry_size && cache->ctor == ctor && cache->dtor == dtor
+         && !strncmp(cache->name, name, SLAB_NAME_LEN))
+        {
+          V(slab_registry_mutex);
+          return cache;
+        }
+    }
+
+  if(slab_nb_caches == SLAB_MAX_CACHES)
+    {
+      V(slab_registry_mutex);
+      LogCrit(COMPONENT_MEMALLOC, "SlabAlloc: too many slab caches, can't create %s", name);
+      return NULL;
+    }
+
+  if((cache = (slab_cache_t *) Mem_Calloc_Label(1, sizeof(slab_cache_t), "slab_cache_t")) == NULL)
+    {
+      V(slab_registry_mutex);
+      return NULL;
+    }
+
+  strncpy(cache->name, name, SLAB_NAME_LEN - 1);
+  cache->index = slab_nb_caches;
+  cache->entry_size = entry_size;
+  cache->obj_size = (SLAB_HEADER_SIZE + entry_size + 7) & ~7;
+  cache->slab_objs = (slab_objs > 0) ? slab_objs : SLAB_DEFAULT_OBJECTS;
+  cache->ctor = ctor;
+  cache->dtor = dtor;
+
+  /* Don't let a magazine of big objects pin too much memory */
+  cache->mag_rounds = SLAB_MAGAZINE_BYTES / cache->obj_size;
+  if(cache->mag_rounds > SLAB_MAGAZINE_MAX_ROUNDS)
+    cache->mag_rounds = SLAB_MAGAZINE_MAX_ROUNDS;
+  if(cache->mag_rounds < 2)
+    cache->mag_rounds = 2;
+
+  pthread_mutex_init(&cache->depot_mutex, NULL);
+
+  slab_caches[slab_nb_caches] = cache;
+  slab_nb_caches++;
+
+  V(slab_registry_mutex);
+
+  LogDebug(COMPONENT_MEMALLOC,
+           "SlabAlloc: cache %s created, object size=%lu, %u objects per slab, %u per magazine",
+           cache->name, (unsigned long)cache->obj_size, cache->slab_objs,
+           cache->mag_rounds);
+
+  return cache;
+}                               /* SlabCacheCreate */
+
+/**
+ * SlabCacheGrow: Allocates a new slab and stores its objects in the depot.
+ *
+ * @param cache   the cache to grow.
+ * @param nb_objs number of objects in the new slab (0 means the cache default).
+ *
+ * @return the number of objects added to the cache.
+ *
+ */
+int SlabCacheGrow(slab_cache_t * cache, unsigned int nb_objs)
+{
+  char *slab;
+  char *mem;
+  slab_header_t *h;
+  slab_magazine_t *mag = NULL;
+  slab_magazine_t *mags = NULL;
+  unsigned int i;
+
+  if(nb_objs == 0)
+    nb_objs = cache->slab_objs;
+
+  if((slab = (char *)Mem_Calloc_Label(nb_objs, cache->obj_size, cache->name)) == NULL)
+    return 0;
+
+  /* Construct the objects in the thread that will use them first */
+  for(i = 0, mem = slab; i < nb_objs; i++, mem += cache->obj_size)
+    {
+      ((slab_header_t *) mem)->next = NULL;
+
+      if(cache->ctor != NULL)
+        cache->ctor(slab_get_entry(mem));
+    }
+
+  /* Load them into magazines */
+  for(i = 0, mem = slab; i < nb_objs; i++, mem += cache->obj_size)
+    {
+      if(mag == NULL || mag->rounds == cache->mag_rounds)
+        {
+          if((mag = (slab_magazine_t *) Mem_Alloc_Label(sizeof(slab_magazine_t),
+                                                         "slab_magazine_t")) == NULL)
+            break;
+          mag->rounds = 0;
+          mag->next = mags;
+          mags = mag;
+        }
+
+      mag->objs[mag->rounds++] = slab_get_entry(mem);
+    }
+
+  P(cache->depot_mutex);
+
+  /* Objects left without magazine (out of memory) go to the overflow list */
+  for(; i < nb_objs; i++, mem += cache->obj_size)
+    {
+      h = (slab_header_t *) mem;
+      h->next = slab_overflow[cache->index];
+      slab_overflow[cache->index] = h;
+    }
+
+  while(mags != NULL)
+    {
+      mag = mags;
+      mags = mags->next;
+      slab_depot_put(cache, mag);
+      cache->depot_stats.nb_depot_put--;
+    }
+
+  cache->depot_stats.nb_grow++;
+  cache->depot_stats.nb_objects += nb_objs;
+
+  V(cache->depot_mutex);
+
+  return nb_objs;
+}                               /* SlabCacheGrow */
+
+/**
+ * SlabAlloc: Gets an object from a slab cache.
+ *
+ * @param cache the cache.
+ *
+ * @return the object, or NULL if no memory is available.
+ *
+ */
+void *SlabAlloc(slab_cache_t * cache)
+{
+  slab_thread_t *pthr;
+  slab_thread_cache_t *ptc;
+  slab_magazine_t *mag;
+  slab_header_t *h;
+  void *entry;
+
+  if((pthr = slab_get_thread()) == NULL)
+    return NULL;
+
+  ptc = &pthr->caches[cache->index];
+
+  while(ptc->loaded == NULL || ptc->loaded->rounds == 0)
+    {
+      /* Try the previous magazine */
+      if(ptc->previous != NULL && ptc->previous->rounds > 0)
+        {
+          mag = ptc->loaded;
+          ptc->loaded = ptc->previous;
+          ptc->previous = mag;
+          break;
+        }
+
+      P(cache->depot_mutex);
+
+      if((mag = slab_depot_get_full(cache)) != NULL)
+        {
+          /* The empty 'previous' goes back to the depot */
+          if(ptc->previous != NULL)
+            slab_depot_put(cache, ptc->previous);
+          ptc->previous = ptc->loaded;
+          ptc->loaded = mag;
+          V(cache->depot_mutex);
+          break;
+        }
+
+      if((h = slab_overflow[cache->index]) != NULL)
+        {
+          slab_overflow[cache->index] = h->next;
+          V(cache->depot_mutex);
+          entry = slab_get_entry(h);
+          goto found;
+        }
+
+      V(cache->depot_mutex);
+
+      /* The depot is empty, the cache has to grow */
+      if(SlabCacheGrow(cache, 0) == 0)
+        return NULL;
+    }
+
+  entry = ptc->loaded->objs[--ptc->loaded->rounds];
+
+ found:
+  h = slab_get_header(entry);
+  h->next = h;
+
+  ptc->nb_alloc++;
+
+  return entry;
+}                               /* SlabAlloc */
+
+/**
+ * SlabFree: Releases an object to a slab cache.
+ *
+ * The object may be released by another thread than the one that
+ * allocated it.
+ *
+ * @param cache the cache the object was allocated from.
+ * @param entry the object.
+ *
+ */
+void SlabFree(slab_cache_t * cache, void *entry)
+{
+  slab_thread_t *pthr;
+  slab_thread_cache_t *ptc;
+  slab_magazine_t *mag;
+  slab_header_t *h = slab_get_header(entry);
+
+  if(cache->dtor != NULL)
+    cache->dtor(entry);
+
+  h->next = NULL;
+
+  if((pthr = slab_get_thread()) == NULL)
+    goto overflow;
+
+  ptc = &pthr->caches[cache->index];
+  ptc->nb_free++;
+
+  if(ptc->loaded != NULL && ptc->loaded->rounds < cache->mag_rounds)
+    {
+      ptc->loaded->objs[ptc->loaded->rounds++] = entry;
+      return;
+    }
+
+  if(ptc->previous != NULL && ptc->previous->rounds == 0)
+    {
+      mag = ptc->loaded;
+      ptc->loaded = ptc->previous;
+      ptc->previous = mag;
+      ptc->loaded->objs[ptc->loaded->rounds++] = entry;
+      return;
+    }
+
+  /* Both magazines are full (or missing): give 'previous' to the depot,
+   * and load an empty magazine */
+  P(cache->depot_mutex);
+
+  if(ptc->previous != NULL)
+    slab_depot_put(cache, ptc->previous);
+  ptc->previous = ptc->loaded;
+
+  if((mag = cache->depot_empty) != NULL)
+    {
+      cache->depot_empty = mag->next;
+      cache->depot_stats.nb_empty_magazines--;
+    }
+
+  V(cache->depot_mutex);
+
+  if(mag == NULL)
+    mag = (slab_magazine_t *) Mem_Alloc_Label(sizeof(slab_magazine_t), "slab_magazine_t");
+
+  if((ptc->loaded = mag) == NULL)
+    goto overflow;
+
+  mag->rounds = 0;
+  mag->objs[mag->rounds++] = entry;
+  return;
+
+ overflow:
+  P(cache->depot_mutex);
+  h->next = slab_overflow[cache->index];
+  slab_overflow[cache->index] = h;
+  V(cache->depot_mutex);
+}                               /* SlabFree */
+
+/**
+ * SlabThreadFlush: Gives all the magazines of the current thread back to the depots.
+ *
+ * This is called by threads that are going idle, so that they don't keep
+ * objects the other threads may need.
+ *
+ */
+void SlabThreadFlush(void)
+{
+  slab_thread_t *pthr;
+  slab_thread_cache_t *ptc;
+  slab_cache_t *cache;
+  unsigned int i, nb_caches;
+
+  if(pthread_once(&slab_once_key, slab_init_keys) != 0)
+    return;
+
+  if((pthr = (slab_thread_t *) pthread_getspecific(slab_thread_key)) == NULL)
+    return;
+
+  P(slab_registry_mutex);
+  nb_caches = slab_nb_caches;
+  V(slab_registry_mutex);
+
+  for(i = 0; i < nb_caches; i++)
+    {
+      ptc = &pthr->caches[i];
+
+      if(ptc->loaded == NULL && ptc->previous == NULL)
+        continue;
+
+      cache = slab_caches[i];
+
+      P(cache->depot_mutex);
+      slab_depot_put(cache, ptc->loaded);
+      slab_depot_put(cache, ptc->previous);
+      V(cache->depot_mutex);
+
+      ptc->loaded = NULL;
+      ptc->previous = NULL;
+    }
+}                               /* SlabThreadFlush */
+
+/**
+ * SlabCacheGetStats: Gets the statistics of a slab cache.
+ *
+ * @param cache  the cache.
+ * @param pstats [OUT] the statistics.
+ *
+ */
+void SlabCacheGetStats(slab_cache_t * cache, slab_stats_t * pstats)
+{
+  slab_thread_t *pthr;
+
+  P(slab_registry_mutex);
+
+  P(cache->depot_mutex);
+  *pstats = cache->depot_stats;
+  V(cache->depot_mutex);
+
+  /* Per-thread counters are read without lock, this is only statistics */
+  for(pthr = slab_threads; pthr != NULL; pthr = pthr->next)
+    {
+      pstats->nb_alloc += pthr->caches[cache->index].nb_alloc;
+      pstats->nb_free += pthr->caches[cache->index].nb_free;
+    }
+
+  V(slab_registry_mutex);
+
+  pstats->nb_in_use = (pstats->nb_alloc > pstats->nb_free) ?
+      pstats->nb_alloc - pstats->nb_free : 0;
+}                               /* SlabCacheGetStats */
+
+/**
+ * SlabDumpStats: Prints the statistics of every slab cache.
+ *
+ * One line per cache, in the format of the stats file:
+ * SLAB_CACHE,date;name,object size|allocs,frees,in use|depot gets,depot puts|slabs,objects|full magazines,empty magazines
+ *
+ * @param output  the stream to write to.
+ * @param strdate the date of this stats pass.
+ *
+ */
+void SlabDumpStats(FILE * output, char *strdate)
+{
+  slab_stats_t stats;
+  unsigned int i, nb_caches;
+
+  P(slab_registry_mutex);
+  nb_caches = slab_nb_caches;
+  V(slab_registry_mutex);
+
+  for(i = 0; i < nb_caches; i++)
+    {
+      SlabCacheGetStats(slab_caches[i], &stats);
+
+      fprintf(output, "SLAB_CACHE,%s;%s,%lu|%llu,%llu,%llu|%llu,%llu|%llu,%llu|%u,%u\n",
+              strdate, slab_caches[i]->name, (unsigned long)slab_caches[i]->obj_size,
+              stats.nb_alloc, stats.nb_free, stats.nb_in_use,
+              stats.nb_depot_get, stats.nb_depot_put,
+              stats.nb_grow, stats.nb_objects,
+              stats.nb_full_magazines, stats.nb_empty_magazines);
+    }
+}                               /* SlabDumpStats */
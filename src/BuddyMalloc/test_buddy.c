@@ -1209,6 +1209,91 @@ void *TESTB(void *arg)
 
 }
 
+/* Live bytes counted by the profiler for a call site of TESTC */
+static unsigned long long profile_live_bytes(unsigned int line)
+{
+  static buddy_profile_snapshot_t snap;
+  unsigned int i;
+
+  BuddyProfileSnapshot(&snap);
+
+  for(i = 1; i < snap.nb_sites; i++)
+    if(snap.sites[i].line == line && !strcmp(snap.sites[i].file, __FILE__))
+      return BuddyProfileLiveBytes(&snap.sites[i]);
+
+  return 0;
+}
+
+void *TESTC(void *arg)
+{
+
+  int th = (long)arg;
+  int rc;
+  int i;
+
+  caddr_t pointer;
+
+  LogTest("%d:BuddyInit(%llu)=%d", th, MEM_SIZE, rc = BuddyInit(&parameter));
+
+  /* every block is sampled, for its own size */
+  BuddySetProfileRate(1);
+
+  /* the call sites are told apart by their line: 1 for malloc, 2 and 3 for realloc */
+  pointer = BuddyMalloc_Sampled(100, __FILE__, 1, "TESTC malloc");
+
+  if(profile_live_bytes(1) == 0)
+    {
+      LogTest("ERROR: malloc not sampled");
+      exit(1);
+    }
+
+  /* the block leaves the site of its malloc, even if its size class is the same */
+  pointer = BuddyRealloc_Sampled(pointer, 110, __FILE__, 2, "TESTC realloc same size");
+
+  LogTest("--> after small realloc: site 1 = %llu bytes, site 2 = %llu bytes",
+          profile_live_bytes(1), profile_live_bytes(2));
+
+  if(profile_live_bytes(1) != 0 || profile_live_bytes(2) == 0)
+    {
+      LogTest("ERROR: bad profile after a small realloc");
+      exit(1);
+    }
+
+  /* and a larger one */
+  pointer = BuddyRealloc_Sampled(pointer, MEM_SIZE / 10, __FILE__, 3, "TESTC realloc");
+
+  for(i = 0; i < MEM_SIZE / 10; i++)
+    pointer[i] = (char)i;
+
+  LogTest("--> after realloc: site 2 = %llu bytes, site 3 = %llu bytes",
+          profile_live_bytes(2), profile_live_bytes(3));
+
+  if(profile_live_bytes(2) != 0 || profile_live_bytes(3) == 0)
+    {
+      LogTest("ERROR: bad profile after a realloc");
+      exit(1);
+    }
+
+  BuddyFree(pointer);
+
+  if(profile_live_bytes(3) != 0)
+    {
+      LogTest("ERROR: bad profile after free");
+      exit(1);
+    }
+
+  BuddySetProfileRate(0);
+
+  /* destroy thread resources */
+  if(rc = BuddyDestroy())
+    {
+      LogTest("ERROR in BuddyDestroy: %d", rc);
+    }
+
+  return NULL;
+
+}
+
 static char usage[] =
     "Usage :\n"
     "\ttest_buddy <test_name>\n\n"
@@ -1223,7 +1308,8 @@ static char usage[] =
     "\t\t8[mt] : garbage collection stats (mt: multithreaded test)\n"
     "\t\t9[mt] : debug labels (mt: multithreaded test)\n"
     "\t\tA     : multithreaded alloc/free on shared memory segments\n"
-    "\t\tB[mt] : memory corruption tests\n";
+    "\t\tB[mt] : memory corruption tests\n"
+    "\t\tC     : allocation profiler test\n";
 
 /* Multithread launch macro */
 #define LAUNCH_THREADS( _function_ , _nb_threads_ ) do {\
@@ -1294,6 +1380,9 @@ int main(int argc, char **argv)
   else if(!strcmp(argv[1], "B"))
     TESTB(0);
 
+  else if(!strcmp(argv[1], "C"))
+    TESTC(0);
+
   else if(!strcmp(argv[1], "1mt"))
     LAUNCH_THREADS(TEST1, NB_THREADS);
 
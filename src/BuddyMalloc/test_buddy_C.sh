@@ -0,0 +1,7 @@
+#!/bin/sh
+##
+## test_buddy_C.sh
+## allocation profiler tests
+##
+
+./test_buddy C
@@ -0,0 +1,372 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ *
+ * Micro-benchmark of cache_inode, on the FSAL described by the configuration
+ * file given with -f. NB_FILES files are created in the directory given
+ * with -d (the root of the FSAL by default), then every thread, with its
+ * own cache_inode client as the workers have:
+ *   cache_inode_lookup       : looks the files up by name
+ *   cache_inode_lookup_noent : looks up names that do not exist
+ *   cache_inode_getattr      : gets the attributes of the files
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef _SOLARIS
+#include "solaris_port.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pwd.h>
+#include "BuddyMalloc.h"
+#include "log_macros.h"
+#include "config_parsing.h"
+#include "fsal.h"
+#include "cache_inode.h"
+#include "BenchStats.h"
+
+#define DEFAULT_OPS  100000
+#define NB_FILES     1000
+
+typedef struct bench_ci_thread__
+{
+  fsal_export_context_t exp_context;
+  fsal_op_context_t context;
+  cache_inode_client_t client;
+  int is_init;
+} bench_ci_thread_t;
+
+typedef struct bench_ci_arg__
+{
+  hash_table_t *ht;
+  cache_entry_t *proot;
+  cache_entry_t *entries[NB_FILES];
+  fsal_name_t names[NB_FILES];
+  cache_inode_client_parameter_t client_param;
+  bench_ci_thread_t *threads;
+  char *dir_path;
+} bench_ci_arg_t;
+
+static int lru_entry_to_str(LRU_data_t data, char *str)
+{
+  return sprintf(str, "%p (len=%llu)", data.pdata, (unsigned long long)data.len);
+}
+
+static int lru_clean_entry(LRU_entry_t * entry, void *adddata)
+{
+  return 0;
+}
+
+static int init_fsal(config_file_t config_file)
+{
+  fsal_parameter_t init_param;
+  fsal_status_t st;
+
+  FSAL_LoadFunctions();
+  FSAL_LoadConsts();
+
+  FSAL_SetDefault_FSAL_parameter(&init_param);
+  FSAL_SetDefault_FS_common_parameter(&init_param);
+  FSAL_SetDefault_FS_specific_parameter(&init_param);
+
+  st = FSAL_load_FSAL_parameter_from_conf(config_file, &init_param);
+  if(FSAL_IS_ERROR(st) && st.major != ERR_FSAL_NOENT)
+    return -1;
+
+  st = FSAL_load_FS_common_parameter_from_conf(config_file, &init_param);
+  if(FSAL_IS_ERROR(st) && st.major != ERR_FSAL_NOENT)
+    return -1;
+
+  st = FSAL_load_FS_specific_parameter_from_conf(config_file, &init_param);
+  if(FSAL_IS_ERROR(st) && st.major != ERR_FSAL_NOENT)
+    return -1;
+
+  st = FSAL_Init(&init_param);
+
+  return FSAL_IS_ERROR(st) ? -1 : 0;
+}                               /* init_fsal */
+
+static int init_thread_context(bench_ci_thread_t * p_thr, bench_ci_arg_t * p_arg)
+{
+  struct passwd *pw_struct;
+  fsal_status_t st;
+
+  st = FSAL_BuildExportContext(&p_thr->exp_context, NULL, NULL);
+  if(FSAL_IS_ERROR(st))
+    return -1;
+
+  st = FSAL_InitClientContext(&p_thr->context);
+  if(FSAL_IS_ERROR(st))
+    return -1;
+
+  if((pw_struct = getpwuid(getuid())) == NULL)
+    return -1;
+
+  st = FSAL_GetClientContext(&p_thr->context, &p_thr->exp_context,
+                             getuid(), pw_struct->pw_gid, NULL, 0);
+  if(FSAL_IS_ERROR(st))
+    return -1;
+
+  if(cache_inode_client_init(&p_thr->client, p_arg->client_param, 0, NULL) != 0)
+    return -1;
+
+  p_thr->is_init = TRUE;
+
+  return 0;
+}                               /* init_thread_context */
+
+static int bench_thread_init(void *arg, unsigned int thread)
+{
+  bench_ci_arg_t *p_arg = (bench_ci_arg_t *) arg;
+  bench_ci_thread_t *p_thr = &p_arg->threads[thread + 1];
+
+  if(BuddyInit(NULL) != BUDDY_SUCCESS)
+    return -1;
+
+  /* the clients are kept from one bench to the next, as the workers do */
+  if(p_thr->is_init)
+    return 0;
+
+  return init_thread_context(p_thr, p_arg);
+}
+
+static int bench_lookup(void *arg, unsigned int thread, unsigned long long iter)
+{
+  bench_ci_arg_t *p_arg = (bench_ci_arg_t *) arg;
+  bench_ci_thread_t *p_thr = &p_arg->threads[thread + 1];
+  fsal_attrib_list_t attr;
+  cache_inode_status_t status;
+
+  if(cache_inode_lookup(p_arg->proot, &p_arg->names[(iter + thread * 7919) % NB_FILES],
+                        &attr, p_arg->ht, &p_thr->client, &p_thr->context,
+                        &status) == NULL)
+    return -1;
+
+  return 0;
+}
+
+static int bench_lookup_noent(void *arg, unsigned int thread, unsigned long long iter)
+{
+  bench_ci_arg_t *p_arg = (bench_ci_arg_t *) arg;
+  bench_ci_thread_t *p_thr = &p_arg->threads[thread + 1];
+  fsal_attrib_list_t attr;
+  fsal_name_t name;
+  cache_inode_status_t status;
+  char str[FSAL_MAX_NAME_LEN];
+
+  /* a few names, as for the lookups of a compiler in its include path */
+  snprintf(str, FSAL_MAX_NAME_LEN, "noent.%llu", iter % 64);
+  FSAL_str2name(str, FSAL_MAX_NAME_LEN, &name);
+
+  if(cache_inode_lookup(p_arg->proot, &name, &attr, p_arg->ht, &p_thr->client,
+                        &p_thr->context, &status) != NULL || status != CACHE_INODE_NOT_FOUND)
+    return -1;
+
+  return 0;
+}
+
+static int bench_getattr(void *arg, unsigned int thread, unsigned long long iter)
+{
+  bench_ci_arg_t *p_arg = (bench_ci_arg_t *) arg;
+  bench_ci_thread_t *p_thr = &p_arg->threads[thread + 1];
+  fsal_attrib_list_t attr;
+  cache_inode_status_t status;
+
+  return cache_inode_getattr(p_arg->entries[(iter + thread * 7919) % NB_FILES], &attr,
+                             p_arg->ht, &p_thr->client, &p_thr->context, &status);
+}
+
+static int bench_setup(bench_ci_arg_t * p_arg, config_file_t config_file)
+{
+  cache_inode_parameter_t cache_param;
+  cache_inode_fsal_data_t fsdata;
+  bench_ci_thread_t *p_main = &p_arg->threads[0];
+  fsal_attrib_list_t attr;
+  fsal_status_t st;
+  cache_inode_status_t status;
+  char str[FSAL_MAX_NAME_LEN];
+  fsal_path_t path;
+  unsigned int i;
+
+  if(cache_inode_read_conf_hash_parameter(config_file, &cache_param) != CACHE_INODE_SUCCESS)
+    return -1;
+
+  cache_param.hparam.hash_func_key = cache_inode_fsal_hash_func;
+  cache_param.hparam.hash_func_rbt = cache_inode_fsal_rbt_func;
+  cache_param.hparam.hash_func_both = NULL;
+  cache_param.hparam.compare_key = cache_inode_compare_key_fsal;
+  cache_param.hparam.key_to_str = NULL;
+  cache_param.hparam.val_to_str = NULL;
+
+  if((p_arg->ht = cache_inode_init(cache_param, &status)) == NULL)
+    return -1;
+
+  if(cache_inode_read_conf_client_parameter(config_file, &p_arg->client_param) !=
+     CACHE_INODE_SUCCESS)
+    return -1;
+
+  p_arg->client_param.lru_param.entry_to_str = lru_entry_to_str;
+  p_arg->client_param.lru_param.clean_entry = lru_clean_entry;
+
+  /* the attributes the FSAL supports are asked for through the root */
+  p_arg->client_param.attrmask = FSAL_ATTRS_POSIX;
+
+  if(init_thread_context(p_main, p_arg) != 0)
+    return -1;
+
+  /* the directory of the files is the root of the cache */
+  memset(&fsdata, 0, sizeof(fsdata));
+
+  if(FSAL_IS_ERROR(st = FSAL_str2path(p_arg->dir_path, FSAL_MAX_PATH_LEN, &path)))
+    return -1;
+
+  st = FSAL_lookupPath(&path, &p_main->context, &fsdata.handle, NULL);
+  if(FSAL_IS_ERROR(st))
+    {
+      LogTest("bench_cache_inode: cannot look %s up: error %d", p_arg->dir_path, st.major);
+      return -1;
+    }
+
+  FSAL_CLEAR_MASK(attr.asked_attributes);
+  FSAL_SET_MASK(attr.asked_attributes, FSAL_ATTR_SUPPATTR);
+  if(FSAL_IS_ERROR(FSAL_getattrs(&fsdata.handle, &p_main->context, &attr)))
+    return -1;
+  p_arg->client_param.attrmask = attr.supported_attributes;
+  p_main->client.attrmask = attr.supported_attributes;
+
+  if((p_arg->proot = cache_inode_make_root(&fsdata, p_arg->ht, &p_main->client,
+                                           &p_main->context, &status)) == NULL)
+    return -1;
+
+  for(i = 0; i < NB_FILES; i++)
+    {
+      snprintf(str, FSAL_MAX_NAME_LEN, "bench.%u", i);
+      FSAL_str2name(str, FSAL_MAX_NAME_LEN, &p_arg->names[i]);
+
+      p_arg->entries[i] = cache_inode_create(p_arg->proot, &p_arg->names[i], REGULAR_FILE,
+                                             0644, NULL, &attr, p_arg->ht,
+                                             &p_main->client, &p_main->context, &status);
+
+      /* left by a previous run on a persistent FSAL */
+      if(p_arg->entries[i] == NULL && status == CACHE_INODE_ENTRY_EXISTS)
+        p_arg->entries[i] = cache_inode_lookup(p_arg->proot, &p_arg->names[i], &attr,
+                                               p_arg->ht, &p_main->client,
+                                               &p_main->context, &status);
+
+      if(p_arg->entries[i] == NULL)
+        return -1;
+    }
+
+  return 0;
+}                               /* bench_setup */
+
+int main(int argc, char *argv[])
+{
+  bench_options_t options;
+  bench_ci_arg_t arg;
+  config_file_t config_file;
+  char *config_path = NULL;
+  char *dir_path = "/";
+  char **bench_argv;
+  int bench_argc = 0;
+  unsigned int t;
+  int i;
+  int rc = 0;
+
+  bench_def_t benches[] = {
+    {"cache_inode_lookup", bench_lookup, bench_thread_init, NULL, &arg},
+    {"cache_inode_lookup_noent", bench_lookup_noent, bench_thread_init, NULL, &arg},
+    {"cache_inode_getattr", bench_getattr, bench_thread_init, NULL, &arg},
+    {NULL, NULL, NULL, NULL, NULL}
+  };
+  bench_def_t *p_bench;
+
+  SetDefaultLogging("TEST");
+  SetNamePgm("bench_cache_inode");
+
+  /* -f <config_file> and -d <dir> are ours, the other options are the common ones */
+  if((bench_argv = malloc((argc + 1) * sizeof(char *))) == NULL)
+    exit(1);
+
+  for(i = 0; i < argc; i++)
+    if(i > 0 && !strcmp(argv[i], "-f") && i + 1 < argc)
+      config_path = argv[++i];
+    else if(i > 0 && !strcmp(argv[i], "-d") && i + 1 < argc)
+      dir_path = argv[++i];
+    else
+      bench_argv[bench_argc++] = argv[i];
+  bench_argv[bench_argc] = NULL;
+
+  if((rc = BenchStats_GetOptions(bench_argc, bench_argv, DEFAULT_OPS, &options)) != 0)
+    {
+      fprintf(stderr, "  -f: FSAL and cache_inode configuration file (required)\n"
+              "  -d: directory the files are created in (default /)\n");
+      exit(rc > 0 ? 0 : 1);
+    }
+
+  if(config_path == NULL)
+    {
+      fprintf(stderr, "%s: a configuration file is needed (-f <config_file>)\n", argv[0]);
+      exit(1);
+    }
+
+  BuddyInit(NULL);
+
+  if((config_file = config_ParseFile(config_path)) == NULL)
+    {
+      LogTest("bench_cache_inode: error parsing %s: %s", config_path,
+              config_GetErrorMsg());
+      exit(1);
+    }
+
+  memset(&arg, 0, sizeof(arg));
+  arg.dir_path = dir_path;
+  if((arg.threads = calloc(options.max_threads + 1, sizeof(bench_ci_thread_t))) == NULL)
+    exit(1);
+
+  if(init_fsal(config_file) != 0 || bench_setup(&arg, config_file) != 0)
+    {
+      LogTest("bench_cache_inode: could not set up the FSAL and the cache");
+      exit(1);
+    }
+
+  config_Free(config_file);
+
+  BenchStats_Begin(&options, "Cache_inode");
+
+  for(t = 0; t < options.nb_thread_counts; t++)
+    for(p_bench = benches; p_bench->name != NULL; p_bench++)
+      if(BenchStats_Run(&options, p_bench, options.thread_counts[t]) != 0)
+        rc = 1;
+
+  BenchStats_End(&options);
+
+  exit(rc);
+}
@@ -100,6 +100,7 @@ cache_inode_commit(cache_entry_t * pentry,
     fsal_boolean_t eof;
     cache_inode_unstable_data_t *udata;
     fsal_status_t fsal_status;
+    cache_content_status_t cache_content_status;
 
 
     /* If we aren't using the Ganesha write buffer, then we're using the filesystem
@@ -122,10 +123,22 @@ cache_inode_commit(cache_entry_t * pentry,
           return *pstatus;
         }
 
+      /* Unstable writes kept by the block cache are to be written before the sync */
+#ifdef _USE_MFSL
+      cache_content_block_flush(&(pentry->object.file.handle),
+                                &(pentry->object.file.open_fd.mfsl_fd.fsal_file),
+                                &fsal_status, &cache_content_status);
+#else
+      cache_content_block_flush(&(pentry->object.file.handle),
+                                &(pentry->object.file.open_fd.fd),
+                                &fsal_status, &cache_content_status);
+#endif
+
+      if(cache_content_status == CACHE_CONTENT_SUCCESS)
 #ifdef _USE_MFSL      
-      fsal_status = MFSL_sync(&(pentry->object.file.open_fd.mfsl_fd), NULL); 
+        fsal_status = MFSL_sync(&(pentry->object.file.open_fd.mfsl_fd), NULL); 
 #else
-      fsal_status = FSAL_sync(&(pentry->object.file.open_fd.fd));
+        fsal_status = FSAL_sync(&(pentry->object.file.open_fd.fd));
 #endif
       if(FSAL_IS_ERROR(fsal_status)) {
         LogMajor(COMPONENT_CACHE_INODE, "cache_inode_rdwr: fsal_sync() failed: fsal_status.major = %d",
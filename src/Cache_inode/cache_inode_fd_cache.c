@@ -0,0 +1,376 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * \file    cache_inode_fd_cache.c
+ * \brief   Bound on the FSAL file descriptors kept open by the whole server.
+ *
+ * cache_inode_fd_cache.c : Bound on the FSAL file descriptors kept open by the whole server.
+ *
+ * The fd opened for an IO is kept in its cache entry, and used by every
+ * worker doing IOs on the entry. The entries keeping an fd open are given a
+ * slot of a single table of Max_Open_Fd slots, recycled with the CLOCK
+ * algorithm: an IO on the entry sets the referenced bit of its slot, and the
+ * hand clears the bits until it finds a slot not referenced since its last
+ * pass. The fd of that slot is closed and the slot given to the new fd.
+ *
+ * The lock of the entry counts the users of its fd: IOs hold it, as readers
+ * or writer, while they use the fd, and the fd is only closed by a thread
+ * holding the lock as writer. An fd is thus evicted only if the lock of its
+ * entry can be taken at once, which never waits on another entry and never
+ * closes an fd in use. When no slot can be freed, the new fd is closed after
+ * the IO, as without the fd cache.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef _SOLARIS
+#include "solaris_port.h"
+#endif                          /* _SOLARIS */
+
+#include "LRU_List.h"
+#include "log_macros.h"
+#include "HashData.h"
+#include "HashTable.h"
+#include "fsal.h"
+#include "cache_inode.h"
+#include "stuff_alloc.h"
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/param.h>
+#include <time.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdio.h>
+
+/* Max number of fds closed by a retention pass before the mutex is released */
+#define FD_CACHE_EXPIRE_BATCH 32
+
+typedef struct cache_inode_fd_slot__
+{
+  cache_entry_t *pentry;        /* NULL if the slot is free */
+  int referenced;               /* set by each IO, cleared by the hand */
+  int next_free;                /* next free slot, -1 at the end */
+} cache_inode_fd_slot_t;
+
+static pthread_mutex_t fd_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static cache_inode_fd_slot_t *fd_slots = NULL;
+static unsigned int fd_nb_slots = 0;
+static unsigned int fd_hand = 0;
+static int fd_free_head = -1;
+static time_t fd_last_expire = 0;
+static cache_inode_fd_cache_stat_t fd_stat;
+
+/* Closes the fd of an entry locked as writer, whose slot was already released */
+static fsal_status_t fd_cache_close_fd(cache_entry_t * pentry,
+                                       cache_inode_client_t * pclient)
+{
+  fsal_status_t fsal_status;
+
+#ifdef _USE_MFSL
+  fsal_status = MFSL_close(&(pentry->object.file.open_fd.mfsl_fd), &pclient->mfsl_context, NULL);
+#else
+  fsal_status = FSAL_close(&(pentry->object.file.open_fd.fd));
+#endif
+
+  pentry->object.file.open_fd.fileno = 0;
+  pentry->object.file.open_fd.last_op = 0;
+
+  return fsal_status;
+}                               /* fd_cache_close_fd */
+
+/* Releases the slot of an entry. Called with fd_cache_mutex held */
+static void fd_cache_release_slot(cache_entry_t * pentry)
+{
+  int slot = pentry->object.file.open_fd.fd_slot;
+
+  fd_slots[slot].pentry = NULL;
+  fd_slots[slot].referenced = FALSE;
+  fd_slots[slot].next_free = fd_free_head;
+  fd_free_head = slot;
+
+  pentry->object.file.open_fd.fd_slot = -1;
+  fd_stat.nb_open -= 1;
+}                               /* fd_cache_release_slot */
+
+/**
+ *
+ * cache_inode_fd_cache_init: allocates the slots of the fd cache.
+ *
+ * @param param     [IN] cache inode client parameters (Max_Open_Fd, Max_Fd)
+ * @param nb_worker [IN] number of workers, Max_Open_Fd defaulting to Max_Fd per worker
+ *
+ * @return 0 if successful, -1 otherwise.
+ *
+ */
+int cache_inode_fd_cache_init(cache_inode_client_parameter_t param, unsigned int nb_worker)
+{
+  unsigned int i;
+
+  if(!param.use_cache)
+    return 0;
+
+  fd_nb_slots = param.max_open_fd;
+  if(fd_nb_slots == 0)
+    fd_nb_slots = param.max_fd_per_thread * nb_worker;
+  if(fd_nb_slots == 0)
+    fd_nb_slots = 1;
+
+  if((fd_slots = (cache_inode_fd_slot_t *)
+      Mem_Alloc_Label(fd_nb_slots * sizeof(cache_inode_fd_slot_t),
+                      "cache_inode_fd_slot_t")) == NULL)
+    return -1;
+
+  for(i = 0; i < fd_nb_slots; i++)
+    {
+      fd_slots[i].pentry = NULL;
+      fd_slots[i].referenced = FALSE;
+      fd_slots[i].next_free = (i + 1 < fd_nb_slots) ? (int)(i + 1) : -1;
+    }
+
+  fd_free_head = 0;
+  fd_hand = 0;
+  fd_last_expire = time(NULL);
+
+  memset(&fd_stat, 0, sizeof(fd_stat));
+  fd_stat.nb_max = fd_nb_slots;
+
+  LogEvent(COMPONENT_CACHE_INODE,
+           "cache_inode_fd_cache_init: up to %u FSAL file descriptors kept open",
+           fd_nb_slots);
+
+  return 0;
+}                               /* cache_inode_fd_cache_init */
+
+/**
+ *
+ * cache_inode_fd_cache_keep: keeps the fd of an entry open after the IO.
+ *
+ * Called after the fd was opened, or found open, with the entry locked as
+ * writer. The slot of the entry is looked up under fd_cache_mutex, so that two
+ * threads keeping the same entry cannot give it two slots. If no slot is free,
+ * the CLOCK hand looks for an fd to close. If none can be closed, the fd keeps
+ * no slot and is closed by cache_inode_close.
+ *
+ * @param pentry  [INOUT] entry whose fd is open.
+ * @param pclient [INOUT] ressource allocated by the client for the nfs management.
+ *
+ * @return nothing (void function)
+ *
+ */
+void cache_inode_fd_cache_keep(cache_entry_t * pentry, cache_inode_client_t * pclient)
+{
+  cache_entry_t *pvictim = NULL;
+  cache_inode_fd_slot_t *pslot;
+  unsigned int nb_steps;
+  int slot = -1;
+
+  if(fd_slots == NULL || pentry->object.file.open_fd.fileno == 0)
+    return;
+
+  P(fd_cache_mutex);
+
+  if(pentry->object.file.open_fd.fd_slot >= 0)
+    {
+      fd_slots[pentry->object.file.open_fd.fd_slot].referenced = TRUE;
+      fd_stat.nb_reused += 1;
+      V(fd_cache_mutex);
+      return;
+    }
+
+  if(fd_free_head >= 0)
+    {
+      slot = fd_free_head;
+      fd_free_head = fd_slots[slot].next_free;
+      fd_stat.nb_open += 1;
+    }
+  else
+    {
+      /* Two turns of the hand: the first one may only clear the referenced bits */
+      for(nb_steps = 0; nb_steps < 2 * fd_nb_slots; nb_steps++)
+        {
+          pslot = &fd_slots[fd_hand];
+          fd_hand = (fd_hand + 1) % fd_nb_slots;
+
+          if(pslot->referenced)
+            {
+              pslot->referenced = FALSE;
+              continue;
+            }
+
+          /* An entry whose lock is held may be doing an IO on its fd */
+          if(rw_lock_try_w(&pslot->pentry->lock) != 0)
+            continue;
+
+          pvictim = pslot->pentry;
+          slot = pvictim->object.file.open_fd.fd_slot;
+          pvictim->object.file.open_fd.fd_slot = -1;
+          fd_stat.nb_evicted += 1;
+          break;
+        }
+    }
+
+  if(slot >= 0)
+    {
+      fd_slots[slot].pentry = pentry;
+      fd_slots[slot].referenced = TRUE;
+      pentry->object.file.open_fd.fd_slot = slot;
+      fd_stat.nb_opened += 1;
+    }
+  else
+    fd_stat.nb_not_kept += 1;
+
+  V(fd_cache_mutex);
+
+  /* The victim left its slot, it can be closed without the mutex */
+  if(pvictim != NULL)
+    {
+      LogFullDebug(COMPONENT_CACHE_INODE,
+                   "cache_inode_fd_cache_keep: evicting pentry %p, fileno = %d",
+                   pvictim, pvictim->object.file.open_fd.fileno);
+
+      fd_cache_close_fd(pvictim, pclient);
+      V_w(&pvictim->lock);
+    }
+}                               /* cache_inode_fd_cache_keep */
+
+/**
+ *
+ * cache_inode_fd_cache_close: closes the fd of an entry and releases its slot.
+ *
+ * Called with the entry locked as writer, when its fd is closed or before
+ * the entry is released.
+ *
+ * @param pentry  [INOUT] entry whose fd is to be closed.
+ * @param pclient [INOUT] ressource allocated by the client for the nfs management.
+ *
+ * @return the status of the FSAL close.
+ *
+ */
+fsal_status_t cache_inode_fd_cache_close(cache_entry_t * pentry,
+                                         cache_inode_client_t * pclient)
+{
+  P(fd_cache_mutex);
+  if(pentry->object.file.open_fd.fd_slot >= 0)
+    fd_cache_release_slot(pentry);
+  V(fd_cache_mutex);
+
+  if(pentry->object.file.open_fd.fileno == 0)
+    {
+      pentry->object.file.open_fd.last_op = 0;
+      ReturnCode(ERR_FSAL_NOT_OPENED, 0);
+    }
+
+  return fd_cache_close_fd(pentry, pclient);
+}                               /* cache_inode_fd_cache_close */
+
+/**
+ *
+ * cache_inode_fd_cache_expire: closes the fds not used for OpenFile_Retention.
+ *
+ * Does nothing if another thread ran it less than OpenFile_Retention ago.
+ * The fds whose entry is locked are left to the next pass.
+ *
+ * @param pclient [INOUT] ressource allocated by the client for the nfs management.
+ *
+ * @return the number of fds closed.
+ *
+ */
+unsigned int cache_inode_fd_cache_expire(cache_inode_client_t * pclient)
+{
+  cache_entry_t *pexpired[FD_CACHE_EXPIRE_BATCH];
+  cache_entry_t *pentry;
+  unsigned int nb_expired;
+  unsigned int nb_closed = 0;
+  unsigned int i = 0;
+  time_t now = time(NULL);
+  time_t last_expire = fd_last_expire;
+
+  if(fd_slots == NULL || now - last_expire < pclient->retention)
+    return 0;
+
+  /* Only one thread does the pass */
+  if(!__sync_bool_compare_and_swap(&fd_last_expire, last_expire, now))
+    return 0;
+
+  while(i < fd_nb_slots)
+    {
+      nb_expired = 0;
+
+      P(fd_cache_mutex);
+
+      for(; i < fd_nb_slots && nb_expired < FD_CACHE_EXPIRE_BATCH; i++)
+        {
+          if((pentry = fd_slots[i].pentry) == NULL)
+            continue;
+
+          if(now - pentry->object.file.open_fd.last_op <= pclient->retention)
+            continue;
+
+          if(rw_lock_try_w(&pentry->lock) != 0)
+            continue;
+
+          fd_cache_release_slot(pentry);
+          pexpired[nb_expired++] = pentry;
+        }
+
+      fd_stat.nb_expired += nb_expired;
+
+      V(fd_cache_mutex);
+
+      while(nb_expired > 0)
+        {
+          pentry = pexpired[--nb_expired];
+          fd_cache_close_fd(pentry, pclient);
+          V_w(&pentry->lock);
+          nb_closed += 1;
+        }
+    }
+
+  if(nb_closed > 0)
+    LogDebug(COMPONENT_CACHE_INODE_GC,
+             "File descriptor GC: %u files closed", nb_closed);
+
+  return nb_closed;
+}                               /* cache_inode_fd_cache_expire */
+
+/**
+ *
+ * cache_inode_fd_cache_get_stats: gets the statistics of the fd cache.
+ *
+ * @param pstat [OUT] the statistics.
+ *
+ * @return nothing (void function)
+ *
+ */
+void cache_inode_fd_cache_get_stats(cache_inode_fd_cache_stat_t * pstat)
+{
+  P(fd_cache_mutex);
+  *pstat = fd_stat;
+  V(fd_cache_mutex);
+}                               /* cache_inode_fd_cache_get_stats */
@@ -189,6 +189,8 @@ static int cache_inode_gc_clean_entry(cache_entry_t * pentry,
   /* If entry is a DIR_CONTINUE or a DIR_BEGINNING, release pdir_data */
   if(pentry->internal_md.type == DIR_BEGINNING)
     {
+      cache_inode_neg_release(pentry);
+
       /* Put the pentry back to the pool */
       ReleaseToPool(pentry->object.dir_begin.pdir_data, &pgcparam->pclient->pool_dir_data);
     }
@@ -200,6 +202,10 @@ static int cache_inode_gc_clean_entry(cache_entry_t * pentry,
     }
   LogFullDebug(COMPONENT_CACHE_INODE_GC,"++++> pdir_data (if needed) sent back to pool");
 
+  /* Close the fd kept open on a file, the entry is going away */
+  if(pentry->internal_md.type == REGULAR_FILE)
+    cache_inode_fd_cache_close(pentry, pgcparam->pclient);
+
   /* Free and Destroy the mutex associated with the pentry */
   V_w(&pentry->lock);
 
@@ -435,7 +441,7 @@ int cache_inode_gc_suppress_directory(cache_entry_t * pentry,
  *
  * @return 1 if entry must be set invalid, 0 if not.
  *
- * @see LRU_invalidate_by_function
+ * @see LRU_reclaim
  * @see LRU_gc_invalid
  *
  */
@@ -558,7 +564,7 @@ cache_inode_gc_policy_t cache_inode_get_gc_policy(void)
  * @return CACHE_INODE_LRU_ERROR if allocation error occured when validating the entry
  *
  * @see HashTable_GetSize
- * @see LRU_invalidate_by_function
+ * @see LRU_reclaim
  * @see LRU_gc_invalid
  *
  */
@@ -568,8 +574,7 @@ cache_inode_status_t cache_inode_gc(hash_table_t * ht,
 {
   cache_inode_param_gc_t gcparam;
   unsigned int hash_size;
-  unsigned int invalid_before_gc = 0;
-  unsigned int invalid_after_gc = 0;
+  unsigned int nb_reclaimed = 0;
 
   /* Set the return default to CACHE_INODE_SUCCESS */
   *pstatus = CACHE_INODE_SUCCESS;
@@ -611,15 +616,9 @@ cache_inode_status_t cache_inode_gc(hash_table_t * ht,
                         "Garbage collection started (to be purged=%u, LRU size=%u)",
                         pclient->lru_gc->nb_entry, gcparam.nb_to_be_purged);
 
-      invalid_before_gc = pclient->lru_gc->nb_invalid;
-      if(LRU_invalidate_by_function
-         (pclient->lru_gc, cache_inode_gc_function, (void *)&gcparam) != LRU_LIST_SUCCESS)
-        {
-          *pstatus = CACHE_INODE_LRU_ERROR;
-          return *pstatus;
-        }
-
-      invalid_after_gc = pclient->lru_gc->nb_invalid;
+      /* Walk from the LRU, the entries used since the last gc get a second chance */
+      nb_reclaimed = LRU_reclaim(pclient->lru_gc, gcparam.nb_to_be_purged,
+                                 cache_inode_gc_function, (void *)&gcparam);
 
       /* Removes the LRU entries and put them back to the pool */
       if(LRU_gc_invalid(pclient->lru_gc, NULL) != LRU_LIST_SUCCESS)
@@ -630,7 +629,7 @@ cache_inode_status_t cache_inode_gc(hash_table_t * ht,
 
       LogEvent(COMPONENT_CACHE_INODE_GC,
                         "Garbage collection finished, %u entries removed",
-                        invalid_after_gc - invalid_before_gc);
+                        nb_reclaimed);
 
       *pstatus = CACHE_INODE_SUCCESS;
     }
@@ -650,47 +649,15 @@ cache_inode_status_t cache_inode_gc(hash_table_t * ht,
   return *pstatus;
 }                               /* cache_inode_gc */
 
-int cache_inode_gc_fd_func(LRU_entry_t * plru_entry, void *addparam)
-{
-  time_t entry_time = 0;
-  time_t current_time = time(NULL);
-  cache_entry_t *pentry = NULL;
-  cache_inode_param_gc_t *pgcparam = (cache_inode_param_gc_t *) addparam;
-  cache_inode_status_t status;
-
-  time_t allocated;
-
-  /* Get the entry */
-  pentry = (cache_entry_t *) (plru_entry->buffdata.pdata);
-
-  /* check if a file descriptor is opened on the file for a long time */
-
-  if((pentry->internal_md.type == REGULAR_FILE)
-     && (pentry->object.file.open_fd.fileno != 0)
-     && (time(NULL) - pentry->object.file.open_fd.last_op > pgcparam->pclient->retention))
-    {
-      P_w(&pentry->lock);
-      cache_inode_close(pentry, pgcparam->pclient, &status);
-      V_w(&pentry->lock);
-
-      pgcparam->nb_to_be_purged--;
-    }
-
-  /* return true for continuing */
-  if(pgcparam->nb_to_be_purged == 0)
-    return FALSE;
-  else
-    return TRUE;
-}
-
 /**
  * Garbagge opened file descriptors
+ *
+ * The fds are kept in a cache shared by all the clients (see cache_inode_fd_cache.c):
+ * the ones not used for the retention duration are closed, whichever client opened them.
  */
 cache_inode_status_t cache_inode_gc_fd(cache_inode_client_t * pclient,
                                        cache_inode_status_t * pstatus)
 {
-  cache_inode_param_gc_t gcparam;
-
   /* Set the return default to CACHE_INODE_SUCCESS */
   *pstatus = CACHE_INODE_SUCCESS;
 
@@ -702,23 +669,9 @@ cache_inode_status_t cache_inode_gc_fd(cache_inode_client_t * pclient,
   if(time(NULL) - pclient->time_of_last_gc_fd < pclient->retention)
     return *pstatus;
 
-  gcparam.ht = NULL;            /* not used */
-  gcparam.pclient = pclient;
-  gcparam.nb_to_be_purged = pclient->max_fd_per_thread;
-
-  if(LRU_apply_function(pclient->lru_gc, cache_inode_gc_fd_func, (void *)&gcparam) !=
-     LRU_LIST_SUCCESS)
-    {
-      *pstatus = CACHE_INODE_LRU_ERROR;
-      return *pstatus;
-    }
-
-  LogDebug(COMPONENT_CACHE_INODE_GC,
-                    "File descriptor GC: %u files closed",
-                    pclient->max_fd_per_thread - gcparam.nb_to_be_purged);
+  cache_inode_fd_cache_expire(pclient);
   pclient->time_of_last_gc_fd = time(NULL);
 
-  *pstatus = CACHE_INODE_SUCCESS;
   return *pstatus;
 }
 
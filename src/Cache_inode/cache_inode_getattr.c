@@ -56,6 +56,92 @@
 #include <time.h>
 #include <pthread.h>
 
+/* Number of lockless reads of the attributes attempted before locking the entry */
+#define CACHE_INODE_GETATTR_LOCKLESS_TRY 4
+
+/**
+ *
+ * cache_inode_getattr_lockless: Gets the attributes of a fresh entry without locking it.
+ *
+ * Every update of a cache entry is made while holding its lock for writing, which bumps
+ * the sequence of the lock, so the attributes can be copied without taking the lock as
+ * long as the sequence did not change during the copy. This is only done for entries that
+ * cache_inode_renew_entry would not renew, and that were validated during the current
+ * second: the garbage collector's LRU and the fd retention are still managed by the
+ * locked path, once per second and per entry.
+ *
+ * @param pentry [IN] entry to be managed.
+ * @param pattr [OUT] pointer to the results
+ * @param pclient [INOUT] ressource allocated by the client for the nfs management.
+ *
+ * @return TRUE if the attributes were copied, FALSE if the entry is to be locked.
+ *
+ */
+static int cache_inode_getattr_lockless(cache_entry_t * pentry,
+                                        fsal_attrib_list_t * pattr,
+                                        cache_inode_client_t * pclient)
+{
+    time_t current_time = time(NULL);
+    cache_inode_file_type_t type;
+    unsigned int seq;
+    int fresh;
+    int i;
+
+    for(i = 0; i < CACHE_INODE_GETATTR_LOCKLESS_TRY; i++)
+        {
+            seq = rw_lock_seq_begin(&pentry->lock);
+
+            /* Do not spin while a writer is active, it may be calling the FSAL */
+            if(seq & 1)
+                return FALSE;
+
+            /* The type may change under us: the copy must not follow the pdir_begin
+             * of a DIR_CONTINUE, so it is made from the type read here, not from
+             * cache_inode_get_attributes reading it again */
+            type = pentry->internal_md.type;
+
+            fresh = (pentry->internal_md.valid_state == VALID &&
+                     pentry->internal_md.read_time == current_time &&
+                     type != DIR_CONTINUE &&
+                     !cache_inode_renew_needed(pentry, pclient, current_time));
+
+            if(fresh)
+                switch (type)
+                    {
+                    case REGULAR_FILE:
+                        *pattr = pentry->object.file.attributes;
+                        break;
+
+                    case SYMBOLIC_LINK:
+                        *pattr = pentry->object.symlink.attributes;
+                        break;
+
+                    case FS_JUNCTION:
+                    case DIR_BEGINNING:
+                        *pattr = pentry->object.dir_begin.attributes;
+                        break;
+
+                    case SOCKET_FILE:
+                    case FIFO_FILE:
+                    case BLOCK_FILE:
+                    case CHARACTER_FILE:
+                        *pattr = pentry->object.special_obj.attributes;
+                        break;
+
+                    default:
+                        fresh = FALSE;
+                        break;
+                    }
+
+            if(!rw_lock_seq_retry(&pentry->lock, seq))
+                return (fresh &&
+                        !FSAL_TEST_MASK(pattr->asked_attributes,
+                                        FSAL_ATTR_RDATTR_ERR));
+        }
+
+    return FALSE;
+}                               /* cache_inode_getattr_lockless */
+
 /**
  *
  * cache_inode_getattr: Gets the attributes for a cached entry.
@@ -103,6 +189,16 @@ cache_inode_getattr(cache_entry_t * pentry,
     pclient->stat.nb_call_total += 1;
     inc_func_call(pclient, CACHE_INODE_GETATTR);
 
+    /* Fresh attributes are served without locking the entry */
+    if(cache_inode_getattr_lockless(pentry, pattr, pclient))
+        {
+            inc_func_success(pclient, CACHE_INODE_GETATTR);
+            LogFullDebug(COMPONENT_CACHE_INODE,
+                         "cache_inode_getattr: returning %d(%s) from lockless read",
+                         *pstatus, cache_inode_err_str(*pstatus));
+            return *pstatus;
+        }
+
     /* Lock the entry */
     P_w(&pentry->lock);
     status = cache_inode_renew_entry(pentry, pattr, ht,
@@ -117,9 +213,6 @@ cache_inode_getattr(cache_entry_t * pentry,
             return *pstatus;
         }
 
-    /* RW Lock goes for writer to reader */
-    rw_lock_downgrade(&pentry->lock);
-
     cache_inode_get_attributes(pentry, pattr);
 
     if(FSAL_TEST_MASK(pattr->asked_attributes,
@@ -167,7 +260,7 @@ cache_inode_getattr(cache_entry_t * pentry,
             if(FSAL_IS_ERROR(fsal_status))
                 {
                     *pstatus = cache_inode_error_convert(fsal_status);
-                    V_r(&pentry->lock);
+                    V_w(&pentry->lock);
 
                     if(fsal_status.major == ERR_FSAL_STALE)
                         {
@@ -200,6 +293,10 @@ cache_inode_getattr(cache_entry_t * pentry,
             /* Set the new attributes */
             cache_inode_set_attributes(pentry, pattr);
         }
+
+    /* RW Lock goes for writer to reader, the attributes are not modified any more */
+    rw_lock_downgrade(&pentry->lock);
+
     *pstatus = cache_inode_valid(pentry, CACHE_INODE_OP_GET, pclient);
 
     V_r(&pentry->lock);
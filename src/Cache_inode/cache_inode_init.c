@@ -122,6 +122,7 @@ int cache_inode_client_init(cache_inode_client_t * pclient,
   pclient->use_cache = param.use_cache;
   pclient->retention = param.retention;
   pclient->max_fd_per_thread = param.max_fd_per_thread;
+  pclient->nb_neg_dirent = param.nb_neg_dirent;
 
   /* introducing desynchronisation for GC */
   pclient->time_of_last_gc = time(NULL) + thread_index * 20;
@@ -129,7 +130,7 @@ int cache_inode_client_init(cache_inode_client_t * pclient,
 
   pclient->time_of_last_gc_fd = time(NULL);
 
-  MakePool(&pclient->pool_entry, pclient->nb_prealloc, cache_entry_t, NULL, NULL);
+  MakeSharedPool(&pclient->pool_entry, pclient->nb_prealloc, cache_entry_t, NULL, NULL);
   NamePool(&pclient->pool_entry, "Cache Inode Client Entry Pool for Worker %d", thread_index);
   if(!IsPoolPreallocated(&pclient->pool_entry))
     {
@@ -138,7 +139,7 @@ int cache_inode_client_init(cache_inode_client_t * pclient,
       return 1;
     }
 
-  MakePool(&pclient->pool_dir_data, pclient->nb_pre_dir_data, cache_inode_dir_data_t, NULL, NULL);
+  MakeSharedPool(&pclient->pool_dir_data, pclient->nb_pre_dir_data, cache_inode_dir_data_t, NULL, NULL);
   NamePool(&pclient->pool_dir_data, "Cache Inode Client Dir Data Pool for Worker %d", thread_index);
   if(!IsPoolPreallocated(&pclient->pool_dir_data))
     {
@@ -147,7 +148,7 @@ int cache_inode_client_init(cache_inode_client_t * pclient,
       return 1;
     }
 
-  MakePool(&pclient->pool_parent, pclient->nb_pre_parent, cache_inode_parent_entry_t, NULL, NULL);
+  MakeSharedPool(&pclient->pool_parent, pclient->nb_pre_parent, cache_inode_parent_entry_t, NULL, NULL);
   NamePool(&pclient->pool_parent, "Cache Inode Client Parent Link Pool for Worker %d", thread_index);
   if(!IsPoolPreallocated(&pclient->pool_parent))
     {
@@ -156,7 +157,7 @@ int cache_inode_client_init(cache_inode_client_t * pclient,
       return 1;
     }
 
-  MakePool(&pclient->pool_state_v4, pclient->nb_pre_state_v4, cache_inode_state_t, NULL, NULL);
+  MakeSharedPool(&pclient->pool_state_v4, pclient->nb_pre_state_v4, cache_inode_state_t, NULL, NULL);
   NamePool(&pclient->pool_state_v4, "Cache Inode Client State V4 Pool for Worker %d", thread_index);
   if(!IsPoolPreallocated(&pclient->pool_state_v4))
     {
@@ -166,7 +167,7 @@ int cache_inode_client_init(cache_inode_client_t * pclient,
     }
 
   /* TODO: warning - entries in this pool are never released! */
-  MakePool(&pclient->pool_open_owner, pclient->nb_pre_state_v4, cache_inode_open_owner_t, NULL, NULL);
+  MakeSharedPool(&pclient->pool_open_owner, pclient->nb_pre_state_v4, cache_inode_open_owner_t, NULL, NULL);
   NamePool(&pclient->pool_open_owner, "Cache Inode Client Open Owner Pool for Worker %d", thread_index);
   if(!IsPoolPreallocated(&pclient->pool_open_owner))
     {
@@ -176,7 +177,7 @@ int cache_inode_client_init(cache_inode_client_t * pclient,
     }
 
   /* TODO: warning - entries in this pool are never released! */
-  MakePool(&pclient->pool_open_owner_name, pclient->nb_pre_state_v4, cache_inode_open_owner_name_t, NULL, NULL);
+  MakeSharedPool(&pclient->pool_open_owner_name, pclient->nb_pre_state_v4, cache_inode_open_owner_name_t, NULL, NULL);
   NamePool(&pclient->pool_open_owner_name, "Cache Inode Client Open Owner Name Pool for Worker %d", thread_index);
   if(!IsPoolPreallocated(&pclient->pool_open_owner_name))
     {
@@ -186,7 +187,7 @@ int cache_inode_client_init(cache_inode_client_t * pclient,
     }
 #ifdef _USE_NFS4_1
   /* TODO: warning - entries in this pool are never released! */
-  MakePool(&pclient->pool_session, pclient->nb_pre_state_v4, nfs41_session_t, NULL, NULL);
+  MakeSharedPool(&pclient->pool_session, pclient->nb_pre_state_v4, nfs41_session_t, NULL, NULL);
   NamePool(&pclient->pool_session, "Cache Inode Client Session Pool for Worker %d", thread_index);
   if(!IsPoolPreallocated(&pclient->pool_session))
     {
@@ -196,7 +197,7 @@ int cache_inode_client_init(cache_inode_client_t * pclient,
     }
 #endif                          /* _USE_NFS4_1 */
 
-  MakePool(&pclient->pool_key, pclient->nb_prealloc, cache_inode_fsal_data_t, NULL, NULL);
+  MakeSharedPool(&pclient->pool_key, pclient->nb_prealloc, cache_inode_fsal_data_t, NULL, NULL);
   NamePool(&pclient->pool_key, "Cache Inode Client Key Pool for Worker %d", thread_index);
   if(!IsPoolPreallocated(&pclient->pool_key))
     {
@@ -49,6 +49,7 @@
 #include "fsal.h"
 #include "cache_inode.h"
 #include "stuff_alloc.h"
+#include "lookup3.h"
 
 #include <unistd.h>
 #include <sys/types.h>
@@ -73,19 +74,253 @@ static void cache_inode_lock_print(cache_entry_t * pentry)
 #endif
 }
 
+/*
+ * The lock states of a file are kept out of its state chain, in two indexes
+ * protected by the lock of the pentry:
+ *
+ * - plock_root is an AVL tree of the lock states ordered by offset, each node
+ *   knowing the greatest end of the locks in its subtree (an interval tree):
+ *   the locks overlapping a range are found in O(log n + k), k being the
+ *   number of overlapping locks.
+ *
+ * - lock_owners is a red-black tree of the same states, keyed by a hash of
+ *   their lock owner.
+ *
+ * A lock covers [offset, offset + length[, CACHE_INODE_LOCK_OFFSET_EOF as
+ * length meaning "until the end of the file".
+ */
+
+#define LOCK_HEIGHT( _pstate_ ) ( (_pstate_) == NULL ? 0 : (_pstate_)->lock_height )
+
+static uint64_t cache_inode_lock_end(cache_inode_state_t * pfilelock)
+{
+    if(pfilelock->state_data.lock.length == CACHE_INODE_LOCK_OFFSET_EOF)
+        return CACHE_INODE_LOCK_OFFSET_EOF;
+
+    return pfilelock->state_data.lock.offset + pfilelock->state_data.lock.length;
+}
+
+/* Orders the locks by offset, then by address for the locks starting at the same offset */
+static int cache_inode_lock_cmp(cache_inode_state_t * pstate1, cache_inode_state_t * pstate2)
+{
+    if(pstate1->state_data.lock.offset != pstate2->state_data.lock.offset)
+        return (pstate1->state_data.lock.offset < pstate2->state_data.lock.offset) ? -1 : 1;
+
+    if(pstate1 != pstate2)
+        return (pstate1 < pstate2) ? -1 : 1;
+
+    return 0;
+}
+
+/* Sets the height and greatest end of a node from its children */
+static void cache_inode_lock_update(cache_inode_state_t * pfilelock)
+{
+    uint64_t end_max = cache_inode_lock_end(pfilelock);
+    int hleft = LOCK_HEIGHT(pfilelock->lock_left);
+    int hright = LOCK_HEIGHT(pfilelock->lock_right);
+
+    if(pfilelock->lock_left != NULL && pfilelock->lock_left->lock_end_max > end_max)
+        end_max = pfilelock->lock_left->lock_end_max;
+
+    if(pfilelock->lock_right != NULL && pfilelock->lock_right->lock_end_max > end_max)
+        end_max = pfilelock->lock_right->lock_end_max;
+
+    pfilelock->lock_end_max = end_max;
+    pfilelock->lock_height = 1 + ((hleft > hright) ? hleft : hright);
+}
+
+static cache_inode_state_t *cache_inode_lock_rotate_right(cache_inode_state_t * pfilelock)
+{
+    cache_inode_state_t *pleft = pfilelock->lock_left;
+
+    pfilelock->lock_left = pleft->lock_right;
+    pleft->lock_right = pfilelock;
+
+    cache_inode_lock_update(pfilelock);
+    cache_inode_lock_update(pleft);
+
+    return pleft;
+}
+
+static cache_inode_state_t *cache_inode_lock_rotate_left(cache_inode_state_t * pfilelock)
+{
+    cache_inode_state_t *pright = pfilelock->lock_right;
+
+    pfilelock->lock_right = pright->lock_left;
+    pright->lock_left = pfilelock;
+
+    cache_inode_lock_update(pfilelock);
+    cache_inode_lock_update(pright);
+
+    return pright;
+}
+
+/* Restores the AVL balance of a subtree whose children are balanced, returns its new root */
+static cache_inode_state_t *cache_inode_lock_balance(cache_inode_state_t * pfilelock)
+{
+    int balance;
+
+    cache_inode_lock_update(pfilelock);
+
+    balance = LOCK_HEIGHT(pfilelock->lock_left) - LOCK_HEIGHT(pfilelock->lock_right);
+
+    if(balance > 1)
+        {
+            if(LOCK_HEIGHT(pfilelock->lock_left->lock_left) <
+               LOCK_HEIGHT(pfilelock->lock_left->lock_right))
+                pfilelock->lock_left = cache_inode_lock_rotate_left(pfilelock->lock_left);
+
+            return cache_inode_lock_rotate_right(pfilelock);
+        }
+
+    if(balance < -1)
+        {
+            if(LOCK_HEIGHT(pfilelock->lock_right->lock_right) <
+               LOCK_HEIGHT(pfilelock->lock_right->lock_left))
+                pfilelock->lock_right = cache_inode_lock_rotate_right(pfilelock->lock_right);
+
+            return cache_inode_lock_rotate_left(pfilelock);
+        }
+
+    return pfilelock;
+}
+
+static cache_inode_state_t *cache_inode_lock_tree_insert(cache_inode_state_t * proot,
+                                                         cache_inode_state_t * pfilelock)
+{
+    if(proot == NULL)
+        {
+            pfilelock->lock_left = NULL;
+            pfilelock->lock_right = NULL;
+            cache_inode_lock_update(pfilelock);
+            return pfilelock;
+        }
+
+    if(cache_inode_lock_cmp(pfilelock, proot) < 0)
+        proot->lock_left = cache_inode_lock_tree_insert(proot->lock_left, pfilelock);
+    else
+        proot->lock_right = cache_inode_lock_tree_insert(proot->lock_right, pfilelock);
+
+    return cache_inode_lock_balance(proot);
+}
+
+static cache_inode_state_t *cache_inode_lock_tree_remove_min(cache_inode_state_t * proot,
+                                                             cache_inode_state_t ** ppmin)
+{
+    if(proot->lock_left == NULL)
+        {
+            *ppmin = proot;
+            return proot->lock_right;
+        }
+
+    proot->lock_left = cache_inode_lock_tree_remove_min(proot->lock_left, ppmin);
+
+    return cache_inode_lock_balance(proot);
+}
+
+static cache_inode_state_t *cache_inode_lock_tree_remove(cache_inode_state_t * proot,
+                                                         cache_inode_state_t * pfilelock)
+{
+    cache_inode_state_t *pmin = NULL;
+    int cmp;
+
+    if(proot == NULL)
+        return NULL;            /* Not in the tree */
+
+    cmp = cache_inode_lock_cmp(pfilelock, proot);
+
+    if(cmp < 0)
+        proot->lock_left = cache_inode_lock_tree_remove(proot->lock_left, pfilelock);
+    else if(cmp > 0)
+        proot->lock_right = cache_inode_lock_tree_remove(proot->lock_right, pfilelock);
+    else
+        {
+            /* The successor of the removed lock takes its place */
+            if(proot->lock_right == NULL)
+                return proot->lock_left;
+
+            proot->lock_right = cache_inode_lock_tree_remove_min(proot->lock_right, &pmin);
+            pmin->lock_left = proot->lock_left;
+            pmin->lock_right = proot->lock_right;
+            proot = pmin;
+        }
+
+    return cache_inode_lock_balance(proot);
+}
+
+/* Two locks conflict when one of them is not a READ_LT and they have different owners */
+static int cache_inode_lock_conflict(cache_inode_state_t * pfilelock,
+                                     nfs_lock_type4 lock_type,
+                                     open_owner4 * plockowner)
+{
+    if(lock_type == READ_LT && pfilelock->state_data.lock.lock_type == READ_LT)
+        return FALSE;
+
+    /* all-0/all-1 stateids (no owner) are considered a different owner */
+    if(plockowner != NULL &&
+       plockowner->owner.owner_len == pfilelock->powner->owner_len &&
+       !memcmp(plockowner->owner.owner_val, pfilelock->powner->owner_val,
+               pfilelock->powner->owner_len))
+        {
+            /* The calling state owner is the same. There is a discussion on this case at page 161 of RFC3530.
+             * This lock is ignored */
+            return FALSE;
+        }
+
+    return TRUE;
+}
+
+/* Returns the first lock of the subtree conflicting with [offset, end[, NULL if none */
+static cache_inode_state_t *cache_inode_lock_tree_find(cache_inode_state_t * proot,
+                                                       uint64_t offset,
+                                                       uint64_t end,
+                                                       nfs_lock_type4 lock_type,
+                                                       open_owner4 * plockowner)
+{
+    cache_inode_state_t *pfound = NULL;
+
+    /* No lock of this subtree ends after the beginning of the range */
+    if(proot == NULL || proot->lock_end_max <= offset)
+        return NULL;
+
+    if((pfound = cache_inode_lock_tree_find(proot->lock_left, offset, end,
+                                            lock_type, plockowner)) != NULL)
+        return pfound;
+
+    /* This lock and the ones on its right begin after the end of the range */
+    if(proot->state_data.lock.offset >= end)
+        return NULL;
+
+    if(cache_inode_lock_end(proot) > offset &&
+       cache_inode_lock_conflict(proot, lock_type, plockowner))
+        return proot;
+
+    return cache_inode_lock_tree_find(proot->lock_right, offset, end, lock_type, plockowner);
+}
+
+/* Key of a lock owner in the lock_owners index */
+static long cache_inode_lock_owner_key(clientid4 clientid, char *owner_val,
+                                       unsigned int owner_len)
+{
+    return (long)(Lookup3_hash_buff(owner_val, owner_len) ^
+                  (uint32_t) (clientid ^ (clientid >> 32)));
+}
+
 /**
  *
  * cache_inode_lock_check_conflicting_range: checks for conflicts in lock ranges.
  *
- * Checks for conflicts in lock ranges.
+ * Checks for conflicts in lock ranges. The pentry is supposed to be locked.
  *
- * @param pentry    [INOUT] cache entry for which the lock is to be created
- * @param offset    [IN]    offset where the lock range start
- * @param length    [IN]    length for the lock range ( do not use CACHE_INODE_LOCK_OFFSET_EOF)
- * @param pfilelock [OUT]   pointer to the conflicting lock if a conflit is found, NULL if no conflict
- * @param pstatus   [OUT]   returned status.
+ * @param pentry     [IN]    cache entry for which the lock is to be created
+ * @param offset     [IN]    offset where the lock range start
+ * @param length     [IN]    length for the lock range (CACHE_INODE_LOCK_OFFSET_EOF means "until the end of file")
+ * @param lock_type  [IN]    the kind of lock wanted
+ * @param plockowner [IN]    owner of the lock wanted, its locks do not conflict. NULL for no owner.
+ * @param ppfilelock [OUT]   pointer to the conflicting lock if a conflit is found, NULL if no conflict
+ * @param pstatus    [OUT]   returned status.
  *
- * @return the same as *pstatus
+ * @return CACHE_INODE_STATE_CONFLICT if a conflicting lock was found, CACHE_INODE_SUCCESS if not.
  *
  */
 cache_inode_status_t
@@ -93,14 +328,18 @@ cache_inode_lock_check_conflicting_range(cache_entry_t * pentry,
                                          uint64_t offset,
                                          uint64_t length,
                                          nfs_lock_type4 lock_type,
+                                         open_owner4 * plockowner,
+                                         cache_inode_state_t ** ppfilelock,
                                          cache_inode_status_t *
                                          pstatus)
 {
+    uint64_t end;
+
     if(pstatus == NULL)
         return CACHE_INODE_INVALID_ARGUMENT;
 
     /* pentry should be there */
-    if(pentry == NULL)
+    if(pentry == NULL || ppfilelock == NULL)
         {
             *pstatus = CACHE_INODE_INVALID_ARGUMENT;
             return *pstatus;
@@ -112,80 +351,50 @@ cache_inode_lock_check_conflicting_range(cache_entry_t * pentry,
             *pstatus = CACHE_INODE_BAD_TYPE;
             return *pstatus;
         }
-    /*
-     * CACHE_INODE_LOCK_OFFSET_EOF should have been handled
-     * sooner, use "absolute" length
-     */
+
     if(length == CACHE_INODE_LOCK_OFFSET_EOF)
-        {
-            *pstatus = CACHE_INODE_INVALID_ARGUMENT;
-            return *pstatus;
-        }
+        end = CACHE_INODE_LOCK_OFFSET_EOF;
+    else
+        end = offset + length;
 
-    LogFullDebug(COMPONENT_CACHE_INODE,
-                 "!!!!! Plein de chose a faire dans cache_inode_lock_print !!!!!\n");
-    *pstatus = CACHE_INODE_INVALID_ARGUMENT;
-    return *pstatus;
+    *ppfilelock = cache_inode_lock_tree_find(pentry->object.file.plock_root,
+                                             offset, end, lock_type, plockowner);
 
-#ifdef BUGAZOMEU
-    for(piter_state = pentry->object.file.state_v4; piter_state != NULL;
-        piter_state = piter_state->next)
+    if(*ppfilelock != NULL)
         {
-            if(piter_state->state_type != CACHE_INODE_STATE_LOCK)
-                continue;
-
             LogFullDebug(COMPONENT_CACHE_INODE,
                          "--- check_conflicting_range : offset=%llu length=%llu "
-                         "piter_state->offset=%llu piter_state->length=%llu "
-                         "lock_type=%u piter_state->lock_type=%u\n",
-                         offset, length, piter_state->data.lock.offset,
-                         piter_state->data.lock.length,
-                         lock_type, piter_state->data.lock.lock_type);
-
-            /* Check for a "conflict on the left" */
-            if((offset <= piter_state->data.lock.offset) &&
-               ((offset + length) >= piter_state->data.lock.offset))
-                found = TRUE;
-
-            /* Check for a "conflict on the right" */
-            if((offset >= piter_state->data.lock.offset) &&
-               (offset <= (piter_state->data.lock.offset +
-                           piter_state->data.lock.length)))
-                found = TRUE;
-
-            if(found)
-                {
-                    /* No conflict on read lock */
-                    if((piter_state->data.lock.lock_type == CACHE_INODE_WRITE_LT) ||
-                       (lock_type == CACHE_INODE_WRITE_LT))
-                        {
-                            *ppfilelock = piter_state;
-                            *pstatus = CACHE_INODE_LOCK_CONFLICT;
-                            return *pstatus;
-                        }
-                }
+                         "conflicts with pstate=%p offset=%llu length=%llu",
+                         (unsigned long long)offset, (unsigned long long)length,
+                         *ppfilelock,
+                         (unsigned long long)(*ppfilelock)->state_data.lock.offset,
+                         (unsigned long long)(*ppfilelock)->state_data.lock.length);
 
-            /*
-             * Locks are supposed to be ordered by their range.
-             * Stop search is lock is "on the right"
-             * of the right extremity of the requested lock
-             */
-            if((offset + length) < piter_state->data.lock.offset)
-                break;
+            *pstatus = CACHE_INODE_STATE_CONFLICT;
+            return *pstatus;
         }
 
     /* If this line is reached, then no conflict were found */
-    *ppfilelock = NULL;
     *pstatus = CACHE_INODE_SUCCESS;
     return *pstatus;
-#endif    /* BUGAZOMEU */
-}
+}                               /* cache_inode_lock_check_conflicting_range */
 
+/**
+ *
+ * cache_inode_lock_test: tests if a lock could be granted.
+ *
+ * Tests if a lock could be granted, as cache_inode_lock_check_conflicting_range, with the pentry read locked.
+ *
+ * @return CACHE_INODE_STATE_CONFLICT if a conflicting lock was found (returned in *ppfilelock), CACHE_INODE_SUCCESS if not.
+ *
+ */
 cache_inode_status_t
 cache_inode_lock_test(cache_entry_t * pentry,
                       uint64_t offset,
                       uint64_t length,
                       nfs_lock_type4 lock_type,
+                      open_owner4 * plockowner,
+                      cache_inode_state_t ** ppfilelock,
                       cache_inode_client_t * pclient,
                       cache_inode_status_t * pstatus)
 {
@@ -196,21 +405,22 @@ cache_inode_lock_test(cache_entry_t * pentry,
     P_r(&pentry->lock);
     cache_inode_lock_check_conflicting_range(pentry, offset,
                                              length, lock_type,
+                                             plockowner, ppfilelock,
                                              pstatus);
     V_r(&pentry->lock);
 
-    if(*pstatus == CACHE_INODE_SUCCESS)
-        inc_func_err_unrecover(pclient, CACHE_INODE_LOCKT);
-    else
+    if(*pstatus == CACHE_INODE_SUCCESS || *pstatus == CACHE_INODE_STATE_CONFLICT)
         inc_func_success(pclient, CACHE_INODE_LOCKT);
+    else
+        inc_func_err_unrecover(pclient, CACHE_INODE_LOCKT);
     return *pstatus;
 }
 
 /**
  *
- * cache_inode_lock_insert: insert a lock into the lock list.
+ * cache_inode_lock_insert: insert a lock into the lock indexes of the file.
  *
- * Inserts a lock into the lock list.
+ * Inserts a lock into the lock indexes of the file. The pentry is supposed to be write locked.
  *
  * @param pentry          [INOUT] cache entry for which the lock is to be created
  * @param pfilelock       [IN]    file lock to be inserted
@@ -221,60 +431,160 @@ cache_inode_lock_test(cache_entry_t * pentry,
 
 void cache_inode_lock_insert(cache_entry_t * pentry, cache_inode_state_t * pfilelock)
 {
+    struct rbt_head *powners;
+    struct rbt_node *pn;
+    struct rbt_node *qn;
+    long value;
 
-    LogFullDebug(COMPONENT_CACHE_INODE,
-                 "!!!!! Plein de chose a faire dans cache_inode_lock_insert !!!!!!\n");
-
-    if(pentry == NULL)
+    if(pentry == NULL || pfilelock == NULL)
         return;
 
     if(pentry->internal_md.type != REGULAR_FILE)
         return;
 
-#ifdef BUGAZOMEU
-    for(piter_state = pentry->object.file.state_v4; piter_state != NULL;
-        piter_state_prev = piter_state, piter_state = piter_state->next)
-        {
-            if(pfilelock->data.lock.offset > piter_state->data.lock.offset)
-                break;
-        }
+    pentry->object.file.plock_root =
+        cache_inode_lock_tree_insert(pentry->object.file.plock_root, pfilelock);
 
-    /* At this line, piter_lock is the position before the new lock should be inserted */
-    if(piter_state == NULL)
-        {
-            /* Lock is to be inserted at the end of list */
-            pfilelock->next = NULL;
-            pfilelock->prev = piter_state_prev;
-            piter_state_prev->next = pfilelock;
-        }
-    else
-        {
-            pfilelock->next = piter_state->next;
-            pfilelock->prev = piter_state;
-            piter_state->next = pfilelock;
-        }
-#endif                          /* BUGAZOMEU */
-}                               /* cache_inode_insert_lock */
+    value = cache_inode_lock_owner_key(pfilelock->powner->clientid,
+                                       pfilelock->powner->owner_val,
+                                       pfilelock->powner->owner_len);
+
+    powners = &pentry->object.file.lock_owners;
+    qn = &pfilelock->owner_node;
+
+    RBT_FIND(powners, pn, value);
+    RBT_OPAQ(qn) = pfilelock;
+    RBT_VALUE(qn) = value;
+    RBT_INSERT(powners, qn, pn);
+}                               /* cache_inode_lock_insert */
 
 /**
  *
- * cache_inode_lock_remove: removes a lock from the lock list.
+ * cache_inode_lock_remove: removes a lock from the lock indexes of the file.
  *
- * Remove a lock from the lock list.
+ * Removes a lock from the lock indexes of the file. The pentry is supposed to be write locked.
  *
+ * @param pentry          [INOUT] cache entry the lock belongs to
  * @param pfilelock       [IN]    file lock to be removed
  *
  * @return nothing (void function)
  *
  */
-void cache_inode_lock_remove(cache_entry_t * pentry, cache_inode_client_t * pclient)
+void cache_inode_lock_remove(cache_entry_t * pentry, cache_inode_state_t * pfilelock)
 {
+    struct rbt_head *powners;
+    struct rbt_node *qn;
 
-    LogFullDebug(COMPONENT_CACHE_INODE,
-                 "!!!!!!!! Plein de chose a faire dans cache_inode_lock_remove !!!!\n");
-    return;
+    if(pentry == NULL || pfilelock == NULL)
+        return;
+
+    pentry->object.file.plock_root =
+        cache_inode_lock_tree_remove(pentry->object.file.plock_root, pfilelock);
+
+    powners = &pentry->object.file.lock_owners;
+    qn = &pfilelock->owner_node;
+
+    RBT_UNLINK(powners, qn);
+
+    pfilelock->lock_left = NULL;
+    pfilelock->lock_right = NULL;
 }                               /* cache_inode_lock_remove */
 
+/**
+ *
+ * cache_inode_find_state_by_owner: iterates on the lock states of a file held by a lock owner
+ *
+ * Iterates on the lock states of a file held by a lock owner, using the owner index of the file.
+ *
+ * @param pentry          [IN]    the file
+ * @param powner          [IN]    the lock owner
+ * @param ppstate         [OUT]   the next lock state of this owner, NULL if there is no more
+ * @param previous_pstate [IN]    state returned by the previous call, NULL at first call
+ * @param pclient         [INOUT] related cache inode client
+ * @param pcontext        [IN]    related FSAL operation context
+ * @param pstatus         [OUT]   status for the operation
+ *
+ * @return the same as *pstatus
+ *
+ */
+cache_inode_status_t cache_inode_find_state_by_owner(cache_entry_t * pentry,
+                                                     open_owner4 * powner,
+                                                     cache_inode_state_t * *ppstate,
+                                                     cache_inode_state_t *
+                                                     previous_pstate,
+                                                     cache_inode_client_t * pclient,
+                                                     fsal_op_context_t * pcontext,
+                                                     cache_inode_status_t * pstatus)
+{
+    struct rbt_head *powners;
+    struct rbt_node *pn;
+    cache_inode_state_t *pstate;
+    long value;
+
+    if(pstatus == NULL)
+        return CACHE_INODE_INVALID_ARGUMENT;
+
+    if(pentry == NULL || powner == NULL || ppstate == NULL || pclient == NULL)
+        {
+            *pstatus = CACHE_INODE_INVALID_ARGUMENT;
+            return *pstatus;
+        }
+
+    if(pentry->internal_md.type != REGULAR_FILE)
+        {
+            *pstatus = CACHE_INODE_BAD_TYPE;
+            return *pstatus;
+        }
+
+    value = cache_inode_lock_owner_key(powner->clientid, powner->owner.owner_val,
+                                       powner->owner.owner_len);
+
+    P_r(&pentry->lock);
+
+    powners = &pentry->object.file.lock_owners;
+
+    if(previous_pstate == NULL)
+        {
+            RBT_FIND_LEFT(powners, pn, value);
+        }
+    else
+        {
+            /* Sanity check: make sure that this state is related to this pentry */
+            if(previous_pstate->pentry != pentry)
+                {
+                    V_r(&pentry->lock);
+                    *pstatus = CACHE_INODE_STATE_ERROR;
+                    return *pstatus;
+                }
+
+            pn = &previous_pstate->owner_node;
+            RBT_INCREMENT(pn);
+        }
+
+    /* Other owners may have the same key */
+    *ppstate = NULL;
+    while(pn != NULL && RBT_VALUE(pn) == value)
+        {
+            pstate = (cache_inode_state_t *) RBT_OPAQ(pn);
+
+            if(pstate->powner->clientid == powner->clientid &&
+               pstate->powner->owner_len == powner->owner.owner_len &&
+               !memcmp(pstate->powner->owner_val, powner->owner.owner_val,
+                       powner->owner.owner_len))
+                {
+                    *ppstate = pstate;
+                    break;
+                }
+
+            RBT_INCREMENT(pn);
+        }
+
+    V_r(&pentry->lock);
+
+    *pstatus = CACHE_INODE_SUCCESS;
+    return *pstatus;
+}                               /* cache_inode_find_state_by_owner */
+
 /**
  *
  * cache_inode_lock_create: creates a new lock for a given entry.
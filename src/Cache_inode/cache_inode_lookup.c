@@ -225,6 +225,20 @@ cache_entry_t *cache_inode_lookup_sw(cache_entry_t * pentry_parent,
         }
       while(pentry == NULL);
 
+      /* A name the FSAL recently did not find is not looked up again */
+      if(pentry == NULL && cache_inode_neg_lookup(pentry_parent, pname, pclient))
+        {
+          *pstatus = CACHE_INODE_NOT_FOUND;
+
+          if(use_mutex == TRUE)
+            V_r(&pentry_parent->lock);
+
+          /* stats */
+          pclient->stat.func_stats.nb_err_unrecover[CACHE_INODE_LOOKUP] += 1;
+
+          return NULL;
+        }
+
       /* At this point, if pentry == NULL, we are not looking for a known son, query fsal for lookup */
       if(pentry == NULL)
         {
@@ -282,6 +296,9 @@ cache_entry_t *cache_inode_lookup_sw(cache_entry_t * pentry_parent,
             {
               *pstatus = cache_inode_error_convert(fsal_status);
 
+              if(fsal_status.major == ERR_FSAL_NOENT)
+                cache_inode_neg_add(pentry_parent, pname, pclient);
+
               if(use_mutex == TRUE)
                 V_r(&pentry_parent->lock);
 
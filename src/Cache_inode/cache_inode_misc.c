@@ -416,11 +416,15 @@ cache_entry_t *cache_inode_new_entry(cache_inode_fsal_data_t * pfsdata,
 #endif
       pentry->object.file.attributes = fsal_attributes;
       pentry->object.file.pentry_content = NULL;        /* Not yet a File Content entry associated with this entry */
+      pentry->object.file.use_block_cache = FALSE;      /* Set by the data cache policy */
       pentry->object.file.pstate_head = NULL;   /* No associated client yet                                */
       pentry->object.file.pstate_tail = NULL;   /* No associated client yet                                */
+      pentry->object.file.plock_root = NULL;    /* No lock yet                                             */
+      RBT_HEAD_INIT(&pentry->object.file.lock_owners);
       pentry->object.file.open_fd.fileno = 0;
       pentry->object.file.open_fd.last_op = 0;
       pentry->object.file.open_fd.openflags = 0;
+      pentry->object.file.open_fd.fd_slot = -1;
 #ifdef _USE_MFSL
       memset(&(pentry->object.file.open_fd.mfsl_fd), 0, sizeof(mfsl_file_t));
 #else
@@ -456,6 +460,7 @@ cache_entry_t *cache_inode_new_entry(cache_inode_fsal_data_t * pfsdata,
       pentry->object.dir_begin.nbactive = 0;
       pentry->object.dir_begin.nbdircont = 0;
       pentry->object.dir_begin.referral = NULL;
+      pentry->object.dir_begin.pdir_neg = NULL;
 
       for(i = 0; i < CHILDREN_ARRAY_SIZE; i++)
         {
@@ -614,6 +619,7 @@ cache_entry_t *cache_inode_new_entry(cache_inode_fsal_data_t * pfsdata,
       pentry->object.dir_begin.nbactive = 0;
       pentry->object.dir_begin.nbdircont = 0;
       pentry->object.dir_begin.referral = NULL;
+      pentry->object.dir_begin.pdir_neg = NULL;
 
       for(i = 0; i < CHILDREN_ARRAY_SIZE; i++)
         {
@@ -912,27 +918,36 @@ cache_inode_status_t cache_inode_valid(cache_entry_t * pentry,
       return cache_inode_valid(pentry->object.dir_cont.pdir_begin, op, pclient);
     }
 
-  /* Invalidate former entry if needed */
-  if(pentry->gc_lru != NULL && pentry->gc_lru_entry)
+  if(pentry->gc_lru == pclient->lru_gc && pentry->gc_lru_entry != NULL &&
+     pentry->gc_lru_entry->valid_state == LRU_ENTRY_VALID)
     {
-      if(LRU_invalidate(pentry->gc_lru, pentry->gc_lru_entry) != LRU_LIST_SUCCESS)
+      /* Already in our LRU: just mark it used, the gc will give it a second chance */
+      LRU_touch(pclient->lru_gc, pentry->gc_lru_entry);
+    }
+  else
+    {
+      /* Invalidate former entry if needed */
+      if(pentry->gc_lru != NULL && pentry->gc_lru_entry)
+        {
+          if(LRU_invalidate(pentry->gc_lru, pentry->gc_lru_entry) != LRU_LIST_SUCCESS)
+            {
+              ReleaseToPool(pentry, &pclient->pool_entry);
+              return CACHE_INODE_LRU_ERROR;
+            }
+        }
+
+      if((plru_entry = LRU_new_entry(pclient->lru_gc, &lru_status)) == NULL)
         {
           ReleaseToPool(pentry, &pclient->pool_entry);
           return CACHE_INODE_LRU_ERROR;
         }
-    }
+      plru_entry->buffdata.pdata = (caddr_t) pentry;
+      plru_entry->buffdata.len = sizeof(cache_entry_t);
 
-  if((plru_entry = LRU_new_entry(pclient->lru_gc, &lru_status)) == NULL)
-    {
-      ReleaseToPool(pentry, &pclient->pool_entry);
-      return CACHE_INODE_LRU_ERROR;
+      /* Setting the anchors */
+      pentry->gc_lru = pclient->lru_gc;
+      pentry->gc_lru_entry = plru_entry;
     }
-  plru_entry->buffdata.pdata = (caddr_t) pentry;
-  plru_entry->buffdata.len = sizeof(cache_entry_t);
-
-  /* Setting the anchors */
-  pentry->gc_lru = pclient->lru_gc;
-  pentry->gc_lru_entry = plru_entry;
 
   /* Update internal md */
   pentry->internal_md.valid_state = VALID;
@@ -1104,9 +1119,9 @@ void cache_inode_set_attributes(cache_entry_t * pentry, fsal_attrib_list_t * pat
     case DIR_CONTINUE:
       /* lock the related dir_begin (dir begin are garbagge collected AFTER their related dir_cont)
        * this means that if a DIR_CONTINUE exists, its pdir pointer is not endless */
-      P_r(&pentry->object.dir_cont.pdir_begin->lock);
+      P_w(&pentry->object.dir_cont.pdir_begin->lock);
       pentry->object.dir_cont.pdir_begin->object.dir_begin.attributes = *pattr;
-      V_r(&pentry->object.dir_cont.pdir_begin->lock);
+      V_w(&pentry->object.dir_cont.pdir_begin->lock);
       break;
 
     case SOCKET_FILE:
@@ -1700,6 +1715,9 @@ cache_inode_status_t cache_inode_kill_entry(cache_entry_t * pentry,
     {
       cache_content_status_t cache_content_status;
 
+      /* Close the fd kept open on the file */
+      cache_inode_fd_cache_close(pentry, pclient);
+
       if(pentry->object.file.pentry_content != NULL)
         if(cache_content_release_entry
            ((cache_content_entry_t *) pentry->object.file.pentry_content,
@@ -1717,6 +1735,8 @@ cache_inode_status_t cache_inode_kill_entry(cache_entry_t * pentry,
           pentry->object.dir_begin.pdir_data->dir_entries[i].active = INVALID;
           pentry->object.dir_begin.pdir_data->dir_entries[i].pentry = NULL;
         }
+      cache_inode_neg_release(pentry);
+
       /* Put the pentry back to the pool */
       ReleaseToPool(pentry->object.dir_begin.pdir_data, &pclient->pool_dir_data);
     }
@@ -0,0 +1,289 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * \file    cache_inode_neg.c
+ * \brief   Negative lookup cache.
+ *
+ * cache_inode_neg.c : Negative lookup cache.
+ *
+ * The dirents cached in DIR_BEGINNING and DIR_CONTINUE entries are only the
+ * names that exist, so a lookup for a missing name always reaches the FSAL.
+ * The names the FSAL said do not exist are kept in a small array of slots
+ * attached to the directory, allocated at the first miss. A name stays valid
+ * until the directory's cached mtime changes, until the dirent grace period
+ * expires, or until it is added to the directory. When all the slots are
+ * used, the oldest name is replaced.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef _SOLARIS
+#include "solaris_port.h"
+#endif                          /* _SOLARIS */
+
+#include "LRU_List.h"
+#include "log_macros.h"
+#include "HashData.h"
+#include "HashTable.h"
+#include "fsal.h"
+#include "cache_inode.h"
+#include "stuff_alloc.h"
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/param.h>
+#include <time.h>
+#include <pthread.h>
+#include <string.h>
+
+/**
+ *
+ * cache_inode_neg_valid: tells if a slot of the negative cache can still be trusted.
+ *
+ * @param pentry_parent [IN] the directory the slot belongs to, locked.
+ * @param pneg [IN] the slot.
+ * @param pclient [IN] ressource allocated by the client for the nfs management.
+ * @param current_time [IN] the time to compare the slot's time with.
+ *
+ * @return TRUE if the slot holds a name known not to exist, FALSE otherwise.
+ *
+ */
+static int cache_inode_neg_valid(cache_entry_t * pentry_parent,
+                                 cache_inode_neg_dirent_t * pneg,
+                                 cache_inode_client_t * pclient, time_t current_time)
+{
+  fsal_time_t *pmtime = &pentry_parent->object.dir_begin.attributes.mtime;
+
+  if(pneg->name.len == 0)
+    return FALSE;
+
+  if(pclient->expire_type_dirent != CACHE_INODE_EXPIRE_NEVER &&
+     (current_time - pneg->time >= pclient->grace_period_dirent))
+    return FALSE;
+
+  /* The directory was modified since the FSAL was asked */
+  if(pneg->dir_mtime.seconds != pmtime->seconds ||
+     pneg->dir_mtime.nseconds != pmtime->nseconds)
+    return FALSE;
+
+  return TRUE;
+}                               /* cache_inode_neg_valid */
+
+/**
+ *
+ * cache_inode_neg_lookup: looks for a name in the negative cache of a directory.
+ *
+ * @param pentry_parent [IN] the directory, locked (for reading at least).
+ * @param pname [IN] the name to look for.
+ * @param pclient [INOUT] ressource allocated by the client for the nfs management.
+ *
+ * @return TRUE if the name is known not to exist in the directory, FALSE otherwise.
+ *
+ */
+int cache_inode_neg_lookup(cache_entry_t * pentry_parent,
+                           fsal_name_t * pname, cache_inode_client_t * pclient)
+{
+  cache_inode_neg_dir_t *pdir_neg;
+  time_t current_time;
+  unsigned int i;
+  int found = FALSE;
+
+  if(pentry_parent->internal_md.type != DIR_BEGINNING ||
+     (pdir_neg = pentry_parent->object.dir_begin.pdir_neg) == NULL)
+    return FALSE;
+
+  current_time = time(NULL);
+
+  P(pdir_neg->lock);
+
+  for(i = 0; i < pdir_neg->size; i++)
+    if(cache_inode_neg_valid(pentry_parent, &pdir_neg->entries[i], pclient, current_time)
+       && !FSAL_namecmp(pname, &pdir_neg->entries[i].name))
+      {
+        found = TRUE;
+        break;
+      }
+
+  V(pdir_neg->lock);
+
+  if(found)
+    {
+      pclient->stat.nb_neg_hit += 1;
+      LogFullDebug(COMPONENT_CACHE_INODE,
+                   "Negative cache hit for name=%s in directory %p",
+                   pname->name, pentry_parent);
+    }
+
+  return found;
+}                               /* cache_inode_neg_lookup */
+
+/**
+ *
+ * cache_inode_neg_add: records that a name does not exist in a directory.
+ *
+ * The negative cache is an optimization: if it can't be allocated, nothing is recorded.
+ *
+ * @param pentry_parent [INOUT] the directory, locked (for reading at least).
+ * @param pname [IN] the name the FSAL did not find.
+ * @param pclient [INOUT] ressource allocated by the client for the nfs management.
+ *
+ * @return nothing (void function).
+ *
+ */
+void cache_inode_neg_add(cache_entry_t * pentry_parent,
+                         fsal_name_t * pname, cache_inode_client_t * pclient)
+{
+  cache_inode_neg_dir_t *pdir_neg;
+  size_t size;
+  unsigned int i;
+
+  if(pclient->nb_neg_dirent == 0 || pentry_parent->internal_md.type != DIR_BEGINNING)
+    return;
+
+  if((pdir_neg = pentry_parent->object.dir_begin.pdir_neg) == NULL)
+    {
+      size = sizeof(cache_inode_neg_dir_t) +
+          (pclient->nb_neg_dirent - 1) * sizeof(cache_inode_neg_dirent_t);
+
+      if((pdir_neg = (cache_inode_neg_dir_t *) Mem_Alloc_Label(size,
+                                                                "cache_inode_neg_dir_t")) == NULL)
+        return;
+
+      memset(pdir_neg, 0, size);
+      pthread_mutex_init(&pdir_neg->lock, NULL);
+      pdir_neg->size = pclient->nb_neg_dirent;
+
+      /* The directory is only read locked, another worker may have been faster */
+      if(!__sync_bool_compare_and_swap(&pentry_parent->object.dir_begin.pdir_neg,
+                                       NULL, pdir_neg))
+        {
+          pthread_mutex_destroy(&pdir_neg->lock);
+          Mem_Free(pdir_neg);
+          pdir_neg = pentry_parent->object.dir_begin.pdir_neg;
+        }
+    }
+
+  P(pdir_neg->lock);
+
+  /* Reuse the slot of the name if it is already there, or take the oldest one */
+  for(i = 0; i < pdir_neg->size; i++)
+    if(!FSAL_namecmp(pname, &pdir_neg->entries[i].name))
+      break;
+
+  if(i == pdir_neg->size)
+    {
+      i = pdir_neg->next;
+      pdir_neg->next = (i + 1) % pdir_neg->size;
+    }
+
+  pdir_neg->entries[i].name = *pname;
+  pdir_neg->entries[i].time = time(NULL);
+  pdir_neg->entries[i].dir_mtime = pentry_parent->object.dir_begin.attributes.mtime;
+
+  V(pdir_neg->lock);
+
+  pclient->stat.nb_neg_set += 1;
+}                               /* cache_inode_neg_add */
+
+/**
+ *
+ * cache_inode_neg_remove: forgets a name that now exists in a directory.
+ *
+ * @param pentry_parent [INOUT] the directory, locked (for reading at least).
+ * @param pname [IN] the name added to the directory.
+ *
+ * @return nothing (void function).
+ *
+ */
+void cache_inode_neg_remove(cache_entry_t * pentry_parent, fsal_name_t * pname)
+{
+  cache_inode_neg_dir_t *pdir_neg;
+  unsigned int i;
+
+  if(pentry_parent->internal_md.type != DIR_BEGINNING ||
+     (pdir_neg = pentry_parent->object.dir_begin.pdir_neg) == NULL)
+    return;
+
+  P(pdir_neg->lock);
+
+  for(i = 0; i < pdir_neg->size; i++)
+    if(!FSAL_namecmp(pname, &pdir_neg->entries[i].name))
+      memset(&pdir_neg->entries[i].name, 0, sizeof(fsal_name_t));
+
+  V(pdir_neg->lock);
+}                               /* cache_inode_neg_remove */
+
+/**
+ *
+ * cache_inode_neg_flush: forgets all the names of the negative cache of a directory.
+ *
+ * @param pentry_parent [INOUT] the directory, locked (for reading at least).
+ *
+ * @return nothing (void function).
+ *
+ */
+void cache_inode_neg_flush(cache_entry_t * pentry_parent)
+{
+  cache_inode_neg_dir_t *pdir_neg;
+  unsigned int i;
+
+  if(pentry_parent->internal_md.type != DIR_BEGINNING ||
+     (pdir_neg = pentry_parent->object.dir_begin.pdir_neg) == NULL)
+    return;
+
+  P(pdir_neg->lock);
+
+  for(i = 0; i < pdir_neg->size; i++)
+    memset(&pdir_neg->entries[i].name, 0, sizeof(fsal_name_t));
+  pdir_neg->next = 0;
+
+  V(pdir_neg->lock);
+}                               /* cache_inode_neg_flush */
+
+/**
+ *
+ * cache_inode_neg_release: frees the negative cache of a directory that leaves the cache.
+ *
+ * @param pentry_parent [INOUT] the directory, that nobody else uses any more.
+ *
+ * @return nothing (void function).
+ *
+ */
+void cache_inode_neg_release(cache_entry_t * pentry_parent)
+{
+  cache_inode_neg_dir_t *pdir_neg;
+
+  if(pentry_parent->internal_md.type != DIR_BEGINNING ||
+     (pdir_neg = pentry_parent->object.dir_begin.pdir_neg) == NULL)
+    return;
+
+  pentry_parent->object.dir_begin.pdir_neg = NULL;
+
+  pthread_mutex_destroy(&pdir_neg->lock);
+  Mem_Free(pdir_neg);
+}                               /* cache_inode_neg_release */
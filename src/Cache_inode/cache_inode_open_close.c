@@ -109,6 +109,7 @@ cache_inode_status_t cache_inode_open(cache_entry_t * pentry,
                                       cache_inode_status_t * pstatus)
 {
   fsal_status_t fsal_status;
+  fsal_openflags_t open_mode = openflags;
 
   if((pentry == NULL) || (pclient == NULL) || (pcontext == NULL) || (pstatus == NULL))
     return CACHE_INODE_INVALID_ARGUMENT;
@@ -125,11 +126,7 @@ cache_inode_status_t cache_inode_open(cache_entry_t * pentry,
      (pentry->object.file.open_fd.fileno != 0) &&
      (pentry->object.file.open_fd.openflags != openflags))
     {
-#ifdef _USE_MFSL
-      fsal_status = MFSL_close(&(pentry->object.file.open_fd.mfsl_fd), &pclient->mfsl_context, NULL);
-#else
-      fsal_status = FSAL_close(&(pentry->object.file.open_fd.fd));
-#endif
+      fsal_status = cache_inode_fd_cache_close(pentry, pclient);
       if(FSAL_IS_ERROR(fsal_status) && (fsal_status.major != ERR_FSAL_NOT_OPENED))
         {
           *pstatus = cache_inode_error_convert(fsal_status);
@@ -137,10 +134,9 @@ cache_inode_status_t cache_inode_open(cache_entry_t * pentry,
           return *pstatus;
         }
 
-      /* force re-openning */
-      pentry->object.file.open_fd.last_op = 0;
-      pentry->object.file.open_fd.fileno = 0;
-
+      /* The file is read and written: reopen it for both, so that the fd is shared */
+      if(pclient->use_cache)
+        open_mode = FSAL_O_RDWR;
     }
 
   if((pentry->object.file.open_fd.last_op == 0)
@@ -151,18 +147,39 @@ cache_inode_status_t cache_inode_open(cache_entry_t * pentry,
       fsal_status = MFSL_open(&(pentry->mobject),
                               pcontext,
                               &pclient->mfsl_context,
-                              openflags,
+                              open_mode,
                               &pentry->object.file.open_fd.mfsl_fd,
                               &(pentry->object.file.attributes),
                               NULL );
 #else
       fsal_status = FSAL_open(&(pentry->object.file.handle),
                               pcontext,
-                              openflags,
+                              open_mode,
                               &pentry->object.file.open_fd.fd,
                               &(pentry->object.file.attributes));
 #endif
 
+      /* The caller may not be allowed read/write: open as asked */
+      if(FSAL_IS_ERROR(fsal_status) && (open_mode != openflags))
+        {
+          open_mode = openflags;
+#ifdef _USE_MFSL
+          fsal_status = MFSL_open(&(pentry->mobject),
+                                  pcontext,
+                                  &pclient->mfsl_context,
+                                  open_mode,
+                                  &pentry->object.file.open_fd.mfsl_fd,
+                                  &(pentry->object.file.attributes),
+                                  NULL );
+#else
+          fsal_status = FSAL_open(&(pentry->object.file.handle),
+                                  pcontext,
+                                  open_mode,
+                                  &pentry->object.file.open_fd.fd,
+                                  &(pentry->object.file.attributes));
+#endif
+        }
+
       if(FSAL_IS_ERROR(fsal_status))
         {
           *pstatus = cache_inode_error_convert(fsal_status);
@@ -175,7 +192,7 @@ cache_inode_status_t cache_inode_open(cache_entry_t * pentry,
 #else
       pentry->object.file.open_fd.fileno = FSAL_FILENO(&(pentry->object.file.open_fd.fd));
 #endif
-      pentry->object.file.open_fd.openflags = openflags;
+      pentry->object.file.open_fd.openflags = open_mode;
 
       LogFullDebug(COMPONENT_CACHE_INODE, "cache_inode_open: pentry %p: lastop=0, fileno = %d", pentry,
              pentry->object.file.open_fd.fileno);
@@ -184,10 +201,11 @@ cache_inode_status_t cache_inode_open(cache_entry_t * pentry,
   /* regular exit */
   pentry->object.file.open_fd.last_op = time(NULL);
 
-  /* if file descriptor is too high, garbage collect FDs */
-  if(pclient->use_cache
-     && (pentry, pentry->object.file.open_fd.fileno > pclient->max_fd_per_thread))
+  /* keep the fd open for the next IOs, and close the ones not used for a while */
+  if(pclient->use_cache)
     {
+      cache_inode_fd_cache_keep(pentry, pclient);
+
       if(cache_inode_gc_fd(pclient, pstatus) != CACHE_INODE_SUCCESS)
         {
           LogCrit(COMPONENT_CACHE_INODE_GC, "FAILURE performing FD garbage collection");
@@ -254,21 +272,13 @@ cache_inode_status_t cache_inode_open_by_name(cache_entry_t * pentry_dir,
      (pentry_file->object.file.open_fd.fileno >= 0) &&
      (pentry_file->object.file.open_fd.openflags != openflags))
     {
-#ifdef _USE_MFSL
-      fsal_status =
-          MFSL_close(&(pentry_file->object.file.open_fd.mfsl_fd), &pclient->mfsl_context, NULL);
-#else
-      fsal_status = FSAL_close(&(pentry_file->object.file.open_fd.fd));
-#endif
+      fsal_status = cache_inode_fd_cache_close(pentry_file, pclient);
       if(FSAL_IS_ERROR(fsal_status) && (fsal_status.major != ERR_FSAL_NOT_OPENED))
         {
           *pstatus = cache_inode_error_convert(fsal_status);
 
           return *pstatus;
         }
-
-      pentry_file->object.file.open_fd.last_op = 0;
-      pentry_file->object.file.open_fd.fileno = 0;
     }
 
   if(pentry_file->object.file.open_fd.last_op == 0
@@ -359,10 +369,14 @@ cache_inode_status_t cache_inode_open_by_name(cache_entry_t * pentry_dir,
   /* regular exit */
   pentry_file->object.file.open_fd.last_op = time(NULL);
 
-  /* if file descriptor is too high, garbage collect FDs */
-  if(pclient->use_cache
-     && (pentry_file->object.file.open_fd.fileno > pclient->max_fd_per_thread))
+  /* keep the fd open for the next IOs, and close the ones not used for a while */
+  if(pclient->use_cache)
     {
+      /* The callers do not hold the lock of the file, keep expects it as writer */
+      P_w(&pentry_file->lock);
+      cache_inode_fd_cache_keep(pentry_file, pclient);
+      V_w(&pentry_file->lock);
+
       if(cache_inode_gc_fd(pclient, pstatus) != CACHE_INODE_SUCCESS)
         {
           LogCrit(COMPONENT_CACHE_INODE_GC, "FAILURE performing FD garbage collection");
@@ -413,23 +427,17 @@ cache_inode_status_t cache_inode_close(cache_entry_t * pentry,
       return *pstatus;
     }
 
+  /* the fd is kept open if the fd cache gave it a slot */
   if((pclient->use_cache == 0) ||
-     (time(NULL) - pentry->object.file.open_fd.last_op > pclient->retention) ||
-     (pentry->object.file.open_fd.fileno > (int)(pclient->max_fd_per_thread)))
+     (pentry->object.file.open_fd.fd_slot < 0) ||
+     (time(NULL) - pentry->object.file.open_fd.last_op > pclient->retention))
     {
 
       LogDebug(COMPONENT_CACHE_INODE, "cache_inode_close: pentry %p, fileno = %d, lastop=%d ago",
              pentry, pentry->object.file.open_fd.fileno,
              (int)(time(NULL) - pentry->object.file.open_fd.last_op));
 
-#ifdef _USE_MFSL
-      fsal_status = MFSL_close(&(pentry->object.file.open_fd.mfsl_fd), &pclient->mfsl_context, NULL);
-#else
-      fsal_status = FSAL_close(&(pentry->object.file.open_fd.fd));
-#endif
-
-      pentry->object.file.open_fd.fileno = 0;
-      pentry->object.file.open_fd.last_op = 0;
+      fsal_status = cache_inode_fd_cache_close(pentry, pclient);
 
       if(FSAL_IS_ERROR(fsal_status) && (fsal_status.major != ERR_FSAL_NOT_OPENED))
         {
@@ -0,0 +1,415 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * \file    cache_inode_prefetch.c
+ * \brief   Concurrent renewal of the attributes of directory entries.
+ *
+ * cache_inode_prefetch.c : Concurrent renewal of the attributes of directory entries.
+ *
+ * READDIRPLUS and NFSv4 READDIR return the attributes of every entry of a
+ * page of directory. The entries whose cached attributes have expired are
+ * renewed here before the reply is encoded: the FSAL_getattrs calls are
+ * shared between the calling worker and a pool of helper threads, so that a
+ * page costs about one backend round trip per thread instead of one per
+ * entry. The attributes are stored in the cache by the calling worker.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef _SOLARIS
+#include "solaris_port.h"
+#endif                          /* _SOLARIS */
+
+#include "LRU_List.h"
+#include "log_macros.h"
+#include "HashData.h"
+#include "HashTable.h"
+#include "fsal.h"
+#include "cache_inode.h"
+#include "stuff_alloc.h"
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/param.h>
+#include <time.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdio.h>
+
+typedef struct cache_inode_prefetch_item__
+{
+  cache_entry_t *pentry;
+  fsal_handle_t handle;                                 /**< copied: the entry may be recycled */
+  fsal_attrib_list_t attr;
+  fsal_status_t fsal_status;
+} cache_inode_prefetch_item_t;
+
+typedef struct cache_inode_prefetch_batch__
+{
+  cache_inode_prefetch_item_t *items;
+  unsigned int nb_items;
+  unsigned int next_item;                               /**< first item not yet taken          */
+  unsigned int nb_done;                                 /**< items whose getattr is over       */
+  fsal_op_context_t *pcontext;                          /**< context of the calling worker     */
+  pthread_cond_t done_cond;
+  struct cache_inode_prefetch_batch__ *next;
+} cache_inode_prefetch_batch_t;
+
+static pthread_mutex_t prefetch_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t prefetch_cond = PTHREAD_COND_INITIALIZER;
+static cache_inode_prefetch_batch_t *prefetch_queue = NULL;
+static unsigned int prefetch_nb_threads = 0;
+
+/* Takes the next item of the first batch having some left. Called with prefetch_mutex held */
+static cache_inode_prefetch_item_t *prefetch_take(cache_inode_prefetch_batch_t * pbatch)
+{
+  cache_inode_prefetch_batch_t **ppbatch;
+  cache_inode_prefetch_item_t *pitem;
+
+  if(pbatch->next_item >= pbatch->nb_items)
+    return NULL;
+
+  pitem = &pbatch->items[pbatch->next_item];
+  pbatch->next_item += 1;
+
+  /* The batch leaves the queue when its last item is taken */
+  if(pbatch->next_item == pbatch->nb_items)
+    for(ppbatch = &prefetch_queue; *ppbatch != NULL; ppbatch = &(*ppbatch)->next)
+      if(*ppbatch == pbatch)
+        {
+          *ppbatch = pbatch->next;
+          break;
+        }
+
+  return pitem;
+}
+
+static void prefetch_done(cache_inode_prefetch_batch_t * pbatch)
+{
+  pbatch->nb_done += 1;
+  if(pbatch->nb_done == pbatch->nb_items)
+    pthread_cond_signal(&pbatch->done_cond);
+}
+
+/**
+ * cache_inode_prefetch_thread: helper thread of the attribute prefetch.
+ *
+ * Does FSAL_getattrs for the queued items, with its own FSAL context set to
+ * the export and credentials of the worker that queued them.
+ */
+static void *cache_inode_prefetch_thread(void *arg)
+{
+  unsigned long index = (unsigned long)arg;
+  char thr_name[32];
+  fsal_op_context_t context;
+  cache_inode_prefetch_batch_t *pbatch;
+  cache_inode_prefetch_item_t *pitem;
+  fsal_status_t fsal_status;
+
+  snprintf(thr_name, sizeof(thr_name), "attr_prefetch#%lu", index);
+  SetNameFunction(thr_name);
+
+#ifndef _NO_BUDDY_SYSTEM
+  if(BuddyInit(NULL) != BUDDY_SUCCESS)
+    {
+      LogCrit(COMPONENT_CACHE_INODE,
+              "cache_inode_prefetch_thread #%lu: Memory manager could not be initialized",
+              index);
+      return NULL;
+    }
+#endif
+
+  if(FSAL_IS_ERROR(FSAL_InitClientContext(&context)))
+    {
+      LogCrit(COMPONENT_CACHE_INODE,
+              "cache_inode_prefetch_thread #%lu: Error initializing thread's credential",
+              index);
+      return NULL;
+    }
+
+  P(prefetch_mutex);
+
+  while(1)
+    {
+      while(prefetch_queue == NULL)
+        pthread_cond_wait(&prefetch_cond, &prefetch_mutex);
+
+      pbatch = prefetch_queue;
+      pitem = prefetch_take(pbatch);
+
+      V(prefetch_mutex);
+
+      fsal_status = FSAL_GetClientContext(&context,
+                                          pbatch->pcontext->export_context,
+                                          FSAL_OP_CONTEXT_TO_UID(pbatch->pcontext),
+                                          FSAL_OP_CONTEXT_TO_GID(pbatch->pcontext),
+                                          NULL, 0);
+      if(!FSAL_IS_ERROR(fsal_status))
+        fsal_status = FSAL_getattrs(&pitem->handle, &context, &pitem->attr);
+
+      pitem->fsal_status = fsal_status;
+
+      P(prefetch_mutex);
+      prefetch_done(pbatch);
+    }
+
+  return NULL;
+}                               /* cache_inode_prefetch_thread */
+
+/**
+ *
+ * cache_inode_prefetch_init: starts the helper threads of the attribute prefetch.
+ *
+ * @param param [IN] client parameters, Attr_Prefetch_Threads gives the number of threads.
+ *
+ * @return 0 if ok, -1 otherwise.
+ *
+ */
+int cache_inode_prefetch_init(cache_inode_client_parameter_t param)
+{
+  pthread_attr_t attr_thr;
+  pthread_t thrid;
+  unsigned long i;
+
+  pthread_attr_init(&attr_thr);
+  pthread_attr_setscope(&attr_thr, PTHREAD_SCOPE_SYSTEM);
+  pthread_attr_setdetachstate(&attr_thr, PTHREAD_CREATE_DETACHED);
+
+  for(i = 0; i < param.nb_attr_prefetch_threads; i++)
+    {
+      if(pthread_create(&thrid, &attr_thr, cache_inode_prefetch_thread, (void *)i) != 0)
+        {
+          LogCrit(COMPONENT_CACHE_INODE,
+                  "cache_inode_prefetch_init: could not create attribute prefetch thread #%lu",
+                  i);
+          return -1;
+        }
+      prefetch_nb_threads += 1;
+    }
+
+  if(prefetch_nb_threads > 0)
+    LogEvent(COMPONENT_CACHE_INODE,
+             "cache_inode_prefetch_init: %u attribute prefetch threads started",
+             prefetch_nb_threads);
+
+  return 0;
+}                               /* cache_inode_prefetch_init */
+
+/* Tells if readdir should renew the attributes of this entry, and copies its handle.
+ * The entry is not locked by readdir: its fields are read under its lock */
+static int prefetch_needed(cache_entry_t * pentry, cache_inode_client_t * pclient,
+                           time_t current_time, fsal_handle_t * pfsal_handle)
+{
+  int needed = FALSE;
+
+  if(pclient->expire_type_attr == CACHE_INODE_EXPIRE_NEVER)
+    return FALSE;
+
+  P_r(&pentry->lock);
+
+  if(current_time - pentry->internal_md.refresh_time >= pclient->grace_period_attr)
+    {
+      /* Directories and symlinks renew more than their attributes, and data cached files
+       * do not expire: cache_inode_renew_entry handles them */
+      switch (pentry->internal_md.type)
+        {
+        case REGULAR_FILE:
+          if(pentry->object.file.pentry_content == NULL)
+            {
+              *pfsal_handle = pentry->object.file.handle;
+              needed = TRUE;
+            }
+          break;
+
+        case SOCKET_FILE:
+        case FIFO_FILE:
+        case CHARACTER_FILE:
+        case BLOCK_FILE:
+          *pfsal_handle = pentry->object.special_obj.handle;
+          needed = TRUE;
+          break;
+
+        default:
+          break;
+        }
+    }
+
+  V_r(&pentry->lock);
+
+  return needed;
+}                               /* prefetch_needed */
+
+/**
+ *
+ * cache_inode_prefetch_attributes: renews the expired attributes of a page of directory entries.
+ *
+ * Renews the expired attributes of a page of directory entries returned by
+ * cache_inode_readdir. The FSAL_getattrs calls are done concurrently by the
+ * caller and the helper threads, then the attributes are stored in the cache.
+ * Entries whose getattr fails are left as they are: the error will be seen by
+ * the next operation on them.
+ *
+ * @param dirent_array [IN] entries returned by cache_inode_readdir.
+ * @param nb_entries [IN] number of entries in dirent_array.
+ * @param pclient [INOUT] ressource allocated by the client for the nfs management.
+ * @param pcontext [IN] FSAL credentials.
+ *
+ * @return the number of entries whose attributes were renewed.
+ *
+ */
+unsigned int cache_inode_prefetch_attributes(cache_inode_dir_entry_t * dirent_array,
+                                             unsigned int nb_entries,
+                                             cache_inode_client_t * pclient,
+                                             fsal_op_context_t * pcontext)
+{
+  cache_inode_prefetch_batch_t batch;
+  cache_inode_prefetch_item_t *pitem;
+  fsal_handle_t *pfsal_handle;
+  fsal_handle_t fsal_handle;
+  fsal_status_t fsal_status;
+  time_t current_time = time(NULL);
+  unsigned int nb_renewed = 0;
+  unsigned int i;
+
+  if(prefetch_nb_threads == 0 || nb_entries == 0)
+    return 0;
+
+  memset(&batch, 0, sizeof(batch));
+
+  for(i = 0; i < nb_entries; i++)
+    {
+      if(dirent_array[i].pentry == NULL)
+        continue;
+
+      if(!prefetch_needed(dirent_array[i].pentry, pclient, current_time, &fsal_handle))
+        continue;
+
+      if(batch.items == NULL)
+        {
+          if((batch.items =
+              (cache_inode_prefetch_item_t *) Mem_Alloc_Label((nb_entries - i) *
+                                                              sizeof
+                                                              (cache_inode_prefetch_item_t),
+                                                              "cache_inode_prefetch_item_t"))
+             == NULL)
+            return 0;
+        }
+
+      batch.items[batch.nb_items].pentry = dirent_array[i].pentry;
+      batch.items[batch.nb_items].handle = fsal_handle;
+      batch.items[batch.nb_items].attr.asked_attributes = pclient->attrmask;
+      batch.nb_items += 1;
+    }
+
+  if(batch.nb_items == 0)
+    return 0;
+
+  batch.pcontext = pcontext;
+  pthread_cond_init(&batch.done_cond, NULL);
+
+  /* Queue the batch if helpers can share it */
+  P(prefetch_mutex);
+  if(batch.nb_items > 1)
+    {
+      batch.next = prefetch_queue;
+      prefetch_queue = &batch;
+      pthread_cond_broadcast(&prefetch_cond);
+    }
+
+  /* Work with the helpers */
+  while((pitem = prefetch_take(&batch)) != NULL)
+    {
+      V(prefetch_mutex);
+
+      pitem->fsal_status = FSAL_getattrs(&pitem->handle, pcontext, &pitem->attr);
+
+      P(prefetch_mutex);
+      prefetch_done(&batch);
+    }
+
+  while(batch.nb_done < batch.nb_items)
+    pthread_cond_wait(&batch.done_cond, &prefetch_mutex);
+  V(prefetch_mutex);
+
+  pthread_cond_destroy(&batch.done_cond);
+
+  /* Keep the new attributes in cache */
+  for(i = 0; i < batch.nb_items; i++)
+    {
+      pitem = &batch.items[i];
+
+      if(FSAL_IS_ERROR(pitem->fsal_status))
+        {
+          LogDebug(COMPONENT_CACHE_INODE,
+                   "cache_inode_prefetch_attributes: FSAL_getattrs failed on entry %p, fsal_status.major = %d",
+                   pitem->pentry, pitem->fsal_status.major);
+          continue;
+        }
+
+      P_w(&pitem->pentry->lock);
+
+      /* The entry may have been recycled for another object in the meantime */
+      switch (pitem->pentry->internal_md.type)
+        {
+        case REGULAR_FILE:
+          pfsal_handle = &pitem->pentry->object.file.handle;
+          break;
+
+        case SOCKET_FILE:
+        case FIFO_FILE:
+        case CHARACTER_FILE:
+        case BLOCK_FILE:
+          pfsal_handle = &pitem->pentry->object.special_obj.handle;
+          break;
+
+        default:
+          pfsal_handle = NULL;
+          break;
+        }
+
+      if(pfsal_handle == NULL || FSAL_handlecmp(pfsal_handle, &pitem->handle, &fsal_status))
+        {
+          V_w(&pitem->pentry->lock);
+          continue;
+        }
+
+      cache_inode_set_attributes(pitem->pentry, &pitem->attr);
+
+      pitem->pentry->internal_md.refresh_time = time(NULL);
+
+      V_w(&pitem->pentry->lock);
+
+      /* stat */
+      pclient->stat.func_stats.nb_call[CACHE_INODE_RENEW_ENTRY] += 1;
+      nb_renewed += 1;
+    }
+
+  Mem_Free(batch.items);
+
+  return nb_renewed;
+}                               /* cache_inode_prefetch_attributes */
@@ -107,6 +107,7 @@ cache_inode_status_t cache_inode_rdwr(cache_entry_t * pentry,
   fsal_attrib_list_t post_write_attr;
   fsal_status_t fsal_status_getattr;
   struct stat buffstat;
+  fsal_file_t *pfd;
 
   /* Set the return default to CACHE_INODE_SUCCESS */
   *pstatus = CACHE_INODE_SUCCESS;
@@ -321,6 +322,99 @@ cache_inode_status_t cache_inode_rdwr(cache_entry_t * pentry,
               buffstat.st_blksize * buffstat.st_blocks;
 
         }
+      else if(pentry->object.file.use_block_cache && cache_content_block_enabled())
+        {
+          /* Entry is data cached by blocks in memory, missing data go through FSAL.
+           * The write lock is kept: the blocks of a file are not shared between concurrent IOs */
+          pentry->object.file.attributes.asked_attributes = pclient->attrmask;
+
+          /* Writes read the partial pages they fill, reads only need a read-only fd:
+           * the dirty pages are written back by COMMIT, which opens the file itself */
+          if(cache_inode_open(pentry,
+                              pclient,
+                              (read_or_write == CACHE_INODE_READ) ? FSAL_O_RDONLY : FSAL_O_RDWR,
+                              pcontext, pstatus) != CACHE_INODE_SUCCESS)
+            {
+              V_w(&pentry->lock);
+
+              /* stats */
+              pclient->stat.func_stats.nb_err_unrecover[statindex] += 1;
+
+              return *pstatus;
+            }
+
+#ifdef _USE_MFSL
+          pfd = &(pentry->object.file.open_fd.mfsl_fd.fsal_file);
+#else
+          pfd = &(pentry->object.file.open_fd.fd);
+#endif
+
+          if(read_or_write == CACHE_INODE_READ)
+            cache_content_block_read(&(pentry->object.file.handle),
+                                     pfd,
+                                     &(pentry->object.file.attributes),
+                                     seek_descriptor->offset,
+                                     io_size,
+                                     pio_size,
+                                     buffer, p_fsal_eof, &fsal_status, &cache_content_status);
+          else
+            {
+              /* Unstable writes may stay in memory until COMMIT */
+              cache_content_block_write(&(pentry->object.file.handle),
+                                        pfd,
+                                        &(pentry->object.file.attributes),
+                                        seek_descriptor->offset,
+                                        io_size,
+                                        pio_size,
+                                        buffer,
+                                        (stable == FSAL_UNSAFE_WRITE_TO_FS_BUFFER),
+                                        &fsal_status, &cache_content_status);
+
+              if(cache_content_status == CACHE_CONTENT_SUCCESS && stable == FSAL_SAFE_WRITE_TO_FS)
+                {
+                  fsal_status = FSAL_sync(pfd);
+                  if(FSAL_IS_ERROR(fsal_status))
+                    LogMajor(COMPONENT_CACHE_INODE, "cache_inode_rdwr: fsal_sync() failed: fsal_status.major = %d",
+                             fsal_status.major);
+                }
+            }
+
+          if(cache_content_status != CACHE_CONTENT_SUCCESS)
+            {
+              LogDebug(COMPONENT_CACHE_INODE,
+                       "cache_inode_rdwr: block cache IO failed, fsal_status.major = %d",
+                       fsal_status.major);
+
+              cache_inode_fd_cache_close(pentry, pclient);
+
+              *pstatus = cache_inode_error_convert(fsal_status);
+
+              V_w(&pentry->lock);
+
+              /* stats */
+              pclient->stat.func_stats.nb_err_unrecover[statindex] += 1;
+
+              return *pstatus;
+            }
+
+          LogFullDebug(COMPONENT_CACHE_INODE,
+                       "inode/block: io_size=%llu, pio_size=%llu, eof=%d, seek=%d.%"PRIu64,
+                       io_size, *pio_size, *p_fsal_eof, seek_descriptor->whence,
+                       seek_descriptor->offset);
+
+          if(cache_inode_close(pentry, pclient, pstatus) != CACHE_INODE_SUCCESS)
+            {
+              LogEvent(COMPONENT_CACHE_INODE,
+                       "cache_inode_rdwr: cache_inode_close = %d", *pstatus);
+
+              V_w(&pentry->lock);
+
+              /* stats */
+              pclient->stat.func_stats.nb_err_unrecover[statindex] += 1;
+
+              return *pstatus;
+            }
+        }
       else
         {
           /* No data cache entry, we operated directly on FSAL */
@@ -411,12 +505,6 @@ cache_inode_status_t cache_inode_rdwr(cache_entry_t * pentry,
                   LogFullDebug(COMPONENT_CACHE_INODE, "cache_inode_rdwr: CLOSING pentry %p: fd=%d", pentry,
                          pentry->object.file.open_fd.fileno);
 
-#ifdef _USE_MFSL
-                  MFSL_close(&(pentry->object.file.open_fd.mfsl_fd), &pclient->mfsl_context, NULL);
-#else
-                  FSAL_close(&(pentry->object.file.open_fd.fd));
-#endif
-
                   *pstatus = cache_inode_error_convert(fsal_status);
                 }
               else
@@ -428,8 +516,7 @@ cache_inode_status_t cache_inode_rdwr(cache_entry_t * pentry,
                   *pstatus = CACHE_INODE_FSAL_DELAY;
                 }
 
-              pentry->object.file.open_fd.last_op = 0;
-              pentry->object.file.open_fd.fileno = 0;
+              cache_inode_fd_cache_close(pentry, pclient);
 
               V_w(&pentry->lock);
 
@@ -303,6 +303,10 @@ cache_inode_status_t cache_inode_read_conf_client_parameter(config_file_t in_con
         {
           pparam->max_fd_per_thread = atoi(key_value);
         }
+      else if(!strcasecmp(key_name, "Max_Open_Fd"))
+        {
+          pparam->max_open_fd = atoi(key_value);
+        }
       else if(!strcasecmp(key_name, "OpenFile_Retention"))
         {
           pparam->retention = atoi(key_value);
@@ -315,6 +319,14 @@ cache_inode_status_t cache_inode_read_conf_client_parameter(config_file_t in_con
         {
           pparam->use_fsal_hash = StrToBoolean(key_value);
         }
+      else if(!strcasecmp(key_name, "Attr_Prefetch_Threads"))
+        {
+          pparam->nb_attr_prefetch_threads = atoi(key_value);
+        }
+      else if(!strcasecmp(key_name, "Negative_Cache_Size"))
+        {
+          pparam->nb_neg_dirent = atoi(key_value);
+        }
       else if(!strcasecmp(key_name, "DebugLevel"))
         {
           DebugLevel = ReturnLevelAscii(key_value);
@@ -499,6 +511,12 @@ void cache_inode_print_conf_client_parameter(FILE * output,
           (int)param.grace_period_dirent);
   fprintf(output, "CacheInode Client: Use_Test_Access              = %d\n",
           param.use_test_access);
+  fprintf(output, "CacheInode Client: Attr_Prefetch_Threads        = %u\n",
+          param.nb_attr_prefetch_threads);
+  fprintf(output, "CacheInode Client: Negative_Cache_Size          = %u\n",
+          param.nb_neg_dirent);
+  fprintf(output, "CacheInode Client: Max_Open_Fd                  = %u\n",
+          param.max_open_fd);
 }                               /* cache_inode_print_conf_client_parameter */
 
 /**
@@ -339,6 +339,9 @@ cache_inode_status_t cache_inode_add_cached_dirent(cache_entry_t * pentry_parent
       return *pstatus;
     }
 
+  /* The name exists now */
+  cache_inode_neg_remove(pentry_parent, pname);
+
   /* We don't known where to write, we have to seek for an empty place */
   /* Search loop. We look for an empty slot in a dirent array */
   pdir_chain = pentry_parent;
@@ -606,6 +609,9 @@ cache_inode_status_t cache_inode_invalidate_all_cached_dirent(cache_entry_t * pe
       pentry = pentry->object.dir_cont.pdir_cont;
     }
 
+  /* Names known not to exist may have been created too */
+  cache_inode_neg_flush(pentry_dir);
+
   /* Reinit the fields */
   pentry_dir->object.dir_begin.has_been_readdir = CACHE_INODE_NO;
   pentry_dir->object.dir_begin.end_of_dir = END_OF_DIR;
@@ -153,6 +153,10 @@ cache_inode_status_t cache_inode_clean_internal(cache_entry_t * to_remove_entry,
         }
     }
 
+  /* Close the fd kept open on a file, the entry is going away */
+  if(to_remove_entry->internal_md.type == REGULAR_FILE)
+    cache_inode_fd_cache_close(to_remove_entry, pclient);
+
   /* delete the entry from the cache */
   fsaldata.handle = *pfsal_handle_remove;
   if(to_remove_entry->internal_md.type != DIR_CONTINUE)
@@ -211,6 +215,8 @@ cache_inode_status_t cache_inode_clean_internal(cache_entry_t * to_remove_entry,
   /* If entry is a DIR_CONTINUE or a DIR_BEGINNING, release pdir_data */
   if(to_remove_entry->internal_md.type == DIR_BEGINNING)
     {
+      cache_inode_neg_release(to_remove_entry);
+
       /* Put the pentry back to the pool */
       ReleaseToPool(to_remove_entry->object.dir_begin.pdir_data, &pclient->pool_dir_data);
     }
@@ -453,12 +459,12 @@ cache_inode_status_t cache_inode_remove_sw(cache_entry_t * pentry,             /
   else if(pentry->internal_md.type == DIR_CONTINUE)
     {
       if(use_mutex)
-        P_r(&pentry->object.dir_cont.pdir_begin->lock);
+        P_w(&pentry->object.dir_cont.pdir_begin->lock);
 
       pentry->object.dir_cont.pdir_begin->object.dir_begin.attributes = after_attr;
 
       if(use_mutex)
-        V_r(&pentry->object.dir_cont.pdir_begin->lock);
+        V_w(&pentry->object.dir_cont.pdir_begin->lock);
     }
 
   /* Update the attributes for the removed entry */
@@ -519,6 +525,9 @@ cache_inode_status_t cache_inode_remove_sw(cache_entry_t * pentry,             /
       /* If pentry is a regular file, data cached, the related data cache entry should be removed as well */
       if(to_remove_entry->internal_md.type == REGULAR_FILE)
         {
+          /* Drop the data cached by blocks, dirty ones included */
+          cache_content_block_invalidate(&to_remove_entry->object.file.handle, 0);
+
           if(to_remove_entry->object.file.pentry_content != NULL)
             {
               /* Something is to be deleted, release the cache data entry */
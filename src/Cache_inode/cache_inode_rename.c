@@ -102,6 +102,55 @@ cache_inode_status_t cache_inode_rename_cached_dirent(cache_entry_t * pentry_par
   return *pstatus;
 }                               /* cache_inode_rename_cached_dirent */
 
+/**
+ *
+ * cache_inode_rename_dir_begins: gets the DIR_BEGINNING entries to lock for a rename.
+ *
+ * When a directory of the rename is a DIR_CONTINUE, FSAL_rename updates the
+ * attributes of its DIR_BEGINNING, whose lock must then be held as writer.
+ * The entries already locked by cache_inode_rename are skipped and the others
+ * are returned in address order, in which they must be locked.
+ *
+ * @param pentry_dirsrc [IN] entry pointer for the source directory
+ * @param pentry_dirdest [IN] entry pointer for the destination directory
+ * @param pdir_begins [OUT] the entries to lock
+ *
+ * @return the number of entries to lock, from 0 to 2.
+ *
+ */
+static unsigned int cache_inode_rename_dir_begins(cache_entry_t * pentry_dirsrc,
+                                                  cache_entry_t * pentry_dirdest,
+                                                  cache_entry_t * pdir_begins[2])
+{
+  cache_entry_t *pentry_dirs[2] = { pentry_dirsrc, pentry_dirdest };
+  cache_entry_t *pdir_begin;
+  unsigned int nb_dir_begins = 0;
+  int i;
+
+  for(i = 0; i < 2; i++)
+    {
+      if(pentry_dirs[i]->internal_md.type != DIR_CONTINUE)
+        continue;
+
+      pdir_begin = pentry_dirs[i]->object.dir_cont.pdir_begin;
+
+      if(pdir_begin == pentry_dirsrc || pdir_begin == pentry_dirdest ||
+         (nb_dir_begins == 1 && pdir_begin == pdir_begins[0]))
+        continue;
+
+      pdir_begins[nb_dir_begins++] = pdir_begin;
+    }
+
+  if(nb_dir_begins == 2 && pdir_begins[1] < pdir_begins[0])
+    {
+      pdir_begin = pdir_begins[0];
+      pdir_begins[0] = pdir_begins[1];
+      pdir_begins[1] = pdir_begin;
+    }
+
+  return nb_dir_begins;
+}                               /* cache_inode_rename_dir_begins */
+
 /**
  *
  * cache_inode_rename: renames an entry in the cache. 
@@ -144,6 +193,9 @@ cache_inode_status_t cache_inode_rename(cache_entry_t * pentry_dirsrc,
   fsal_attrib_list_t *pattrdest;
   fsal_handle_t *phandle_dirsrc;
   fsal_handle_t *phandle_dirdest;
+  cache_entry_t *pdir_begins[2];
+  int nb_dir_begins;
+  int i;
 
   /* Set the return default to CACHE_INODE_SUCCESS */
   *pstatus = CACHE_INODE_SUCCESS;
@@ -418,7 +470,13 @@ cache_inode_status_t cache_inode_rename(cache_entry_t * pentry_dirsrc,
    * before doing anything in the cache.
    * Indeed, if the FSAL_rename fails unexpectly,
    * the cache would be inconsistent !
+   * The attributes of a DIR_BEGINNING updated through a DIR_CONTINUE are
+   * written under its lock held as writer, until they are copied back.
    */
+  nb_dir_begins = cache_inode_rename_dir_begins(pentry_dirsrc, pentry_dirdest, pdir_begins);
+  for(i = 0; i < nb_dir_begins; i++)
+    P_w(&pdir_begins[i]->lock);
+
 #ifdef _USE_MFSL
   fsal_status = MFSL_rename(&pentry_dirsrc->mobject,
                             poldname,
@@ -435,6 +493,9 @@ cache_inode_status_t cache_inode_rename(cache_entry_t * pentry_dirsrc,
       *pstatus = cache_inode_error_convert(fsal_status);
       pclient->stat.func_stats.nb_err_unrecover[CACHE_INODE_RENAME] += 1;
 
+      for(i = nb_dir_begins - 1; i >= 0; i--)
+        V_w(&pdir_begins[i]->lock);
+
       V_w(&pentry_dirsrc->lock);
       if(pentry_dirsrc != pentry_dirdest)
         {
@@ -491,6 +552,9 @@ cache_inode_status_t cache_inode_rename(cache_entry_t * pentry_dirsrc,
   if(pattr_dst != NULL)
     *pattr_dst = *pattrdest;
 
+  for(i = nb_dir_begins - 1; i >= 0; i--)
+    V_w(&pdir_begins[i]->lock);
+
   /* At this point, we know that:
    *  - both pentry_dir_src and pentry_dir_dest are directories 
    *  - pentry_dir_src/oldname exists
@@ -56,6 +56,69 @@
 #include <time.h>
 #include <pthread.h>
 
+/**
+ *
+ * cache_inode_renew_needed: Tells if cache_inode_renew_entry would have some work to do.
+ *
+ * Makes the expiration tests of cache_inode_renew_entry, without calling the FSAL. This
+ * is used by cache_inode_getattr to serve fresh attributes without locking the entry,
+ * so the answer may be TRUE when no renewal is needed, but never FALSE when one is.
+ *
+ * @param pentry [IN] entry to be checked.
+ * @param pclient [IN] ressource allocated by the client for the nfs management.
+ * @param current_time [IN] the time to compare the refresh time of the entry with.
+ *
+ * @return TRUE if the entry may have to be renewed, FALSE otherwise.
+ *
+ */
+int cache_inode_renew_needed(cache_entry_t * pentry,
+                             cache_inode_client_t * pclient, time_t current_time)
+{
+  time_t entry_time = pentry->internal_md.refresh_time;
+
+  switch (pentry->internal_md.type)
+    {
+    case REGULAR_FILE:
+      /* Attributes of data cached files do not expire */
+      if(pentry->object.file.pentry_content != NULL)
+        return FALSE;
+      break;
+
+    case SYMBOLIC_LINK:
+      if(pclient->expire_type_link != CACHE_INODE_EXPIRE_NEVER &&
+         (current_time - entry_time >= pclient->grace_period_link))
+        return TRUE;
+      break;
+
+    case DIR_BEGINNING:
+      if(pentry->object.dir_begin.has_been_readdir == CACHE_INODE_YES)
+        {
+          /* getattr/mtime checking always calls the FSAL */
+          if(pclient->getattr_dir_invalidation &&
+             FSAL_TEST_MASK(pclient->attrmask, FSAL_ATTR_MTIME))
+            return TRUE;
+
+          if(pclient->expire_type_dirent != CACHE_INODE_EXPIRE_NEVER &&
+             (current_time - entry_time >= pclient->grace_period_dirent))
+            return TRUE;
+        }
+      break;
+
+    case DIR_CONTINUE:
+      /* Managed through the related dir_begin */
+      return TRUE;
+
+    default:
+      break;
+    }
+
+  if(pclient->expire_type_attr != CACHE_INODE_EXPIRE_NEVER &&
+     (current_time - entry_time >= pclient->grace_period_attr))
+    return TRUE;
+
+  return FALSE;
+}                               /* cache_inode_renew_needed */
+
 /**
  *
  * cache_inode_renew_entry: Renews the attributes for an entry.
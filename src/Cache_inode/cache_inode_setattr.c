@@ -48,6 +48,7 @@
 #include "HashTable.h"
 #include "fsal.h"
 #include "cache_inode.h"
+#include "cache_content.h"
 #include "stuff_alloc.h"
 
 #include <unistd.h>
@@ -173,6 +174,10 @@ cache_inode_status_t cache_inode_setattr(cache_entry_t * pentry, fsal_attrib_lis
 
   if(pattr->asked_attributes & FSAL_ATTR_SIZE)
     {
+      /* Data cached by blocks beyond the new size are no more valid */
+      if(pentry->internal_md.type == REGULAR_FILE)
+        cache_content_block_invalidate(pfsal_handle, pattr->filesize);
+
       truncate_attributes.asked_attributes = pclient->attrmask;
 
       fsal_status = FSAL_truncate(pfsal_handle,
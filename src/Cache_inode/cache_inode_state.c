@@ -112,6 +112,27 @@ int cache_inode_state_conflict(cache_inode_state_t * pstate,
   return rc;
 }                               /* cache_inode_state_conflict */
 
+/* Takes a state out of the state list or the lock indexes of its file. The pentry is write locked. */
+static void cache_inode_state_unlink(cache_entry_t * pentry, cache_inode_state_t * pstate)
+{
+  if(pstate->state_type == CACHE_INODE_STATE_LOCK)
+    {
+      cache_inode_lock_remove(pentry, pstate);
+      return;
+    }
+
+  /* redo the double chained list */
+  if(pstate->prev != NULL)
+    pstate->prev->next = pstate->next;
+  else
+    pentry->object.file.pstate_head = (void *)pstate->next;
+
+  if(pstate->next != NULL)
+    pstate->next->prev = pstate->prev;
+  else
+    pentry->object.file.pstate_tail = (void *)pstate->prev;
+}                               /* cache_inode_state_unlink */
+
 /**
  *
  * cache_inode_add_state: adds a new state to a file pentry 
@@ -139,14 +160,11 @@ cache_inode_status_t cache_inode_add_state(cache_entry_t * pentry,
                                            cache_inode_state_t * *ppstate,
                                            cache_inode_status_t * pstatus)
 {
-  cache_inode_state_t *phead_state = NULL;
   cache_inode_state_t *pnew_state = NULL;
   cache_inode_state_t *piter_state = NULL;
-  cache_inode_state_t *piter_saved = NULL;
   cache_inode_open_owner_t *powner = powner_input;
   char debug_str[25];
   bool_t conflict_found = FALSE;
-  unsigned int i = 0;
 
   /* Sanity Check */
   if(pstatus == NULL)
@@ -185,45 +203,11 @@ cache_inode_status_t cache_inode_add_state(cache_entry_t * pentry,
       return *pstatus;
     }
 
-  /* If there already a state or not ? */
-  if(pentry->object.file.pstate_head == NULL)
+  /* Lock conflicts are checked in the lock index by the NFS request, the other states against the chain */
+  if(state_type != CACHE_INODE_STATE_LOCK)
     {
-      /* The file has no state for now, accept this new state */
-      pnew_state->next = NULL;
-      pnew_state->prev = NULL;
-
-      /* Add the stateid.other, this will increment pentry->object.file.state_current_counter */
-      if(!nfs4_BuildStateId_Other(pentry,
-                                  pcontext, powner_input, pnew_state->stateid_other))
-        {
-          LogDebug(COMPONENT_CACHE_INODE,
-                       "Can't create a new state id for the pentry %p (A)", pentry);
-          *pstatus = CACHE_INODE_STATE_ERROR;
-
-          /* stat */
-          pclient->stat.func_stats.nb_err_unrecover[CACHE_INODE_ADD_STATE] += 1;
-
-          V_w(&pentry->lock);
-
-          return *pstatus;
-        }
-
-      /* Set the type and data for this state */
-      pnew_state->state_type = state_type;
-      memcpy((char *)&(pnew_state->state_data), (char *)pstate_data,
-             sizeof(cache_inode_state_data_t));
-      pnew_state->seqid = 0;
-      pnew_state->pentry = pentry;
-      pnew_state->powner = powner;
-
-      /* Set the head state id */
-      pentry->object.file.pstate_head = (void *)pnew_state;
-    }
-  else
-    {
-      /* Brwose the state's list */
       for(piter_state = pentry->object.file.pstate_head; piter_state != NULL;
-          piter_saved = piter_state, piter_state = piter_state->next)
+          piter_state = piter_state->next)
         {
           if(cache_inode_state_conflict(piter_state, state_type, pstate_data))
             {
@@ -231,55 +215,50 @@ cache_inode_status_t cache_inode_add_state(cache_entry_t * pentry,
               break;
             }
         }
+    }
 
-      /* An error is to be returned if a conflict is found */
-      if(conflict_found == TRUE)
-        {
-          LogDebug(COMPONENT_CACHE_INODE,
-                            "new state conflicts with another state for pentry %p",
-                            pentry);
-          *pstatus = CACHE_INODE_STATE_CONFLICT;
-
-          /* stat */
-          pclient->stat.func_stats.nb_err_unrecover[CACHE_INODE_ADD_STATE] += 1;
-
-          V_w(&pentry->lock);
+  /* An error is to be returned if a conflict is found */
+  if(conflict_found == TRUE)
+    {
+      LogDebug(COMPONENT_CACHE_INODE,
+                        "new state conflicts with another state for pentry %p",
+                        pentry);
+      *pstatus = CACHE_INODE_STATE_CONFLICT;
 
-          return *pstatus;
-        }
+      /* stat */
+      pclient->stat.func_stats.nb_err_unrecover[CACHE_INODE_ADD_STATE] += 1;
 
-      /* If this point is reached, then the state is to be added to the state list and piter_saved is the tail of the list  */
-      pnew_state->next = NULL;
-      pnew_state->prev = piter_saved;
-      piter_saved->next = pnew_state;
+      ReleaseToPool(pnew_state, &pclient->pool_state_v4);
+      V_w(&pentry->lock);
 
-      /* Add the stateid.other, this will increment pentry->object.file.state_current_counter */
-      if(!nfs4_BuildStateId_Other
-         (pentry, pcontext, powner_input, pnew_state->stateid_other))
-        {
-          LogDebug(COMPONENT_CACHE_INODE,
-                            "Can't create a new state id for the pentry %p (E)", pentry);
-          *pstatus = CACHE_INODE_STATE_ERROR;
+      return *pstatus;
+    }
 
-          /* stat */
-          pclient->stat.func_stats.nb_err_unrecover[CACHE_INODE_ADD_STATE] += 1;
+  /* Add the stateid.other, this will increment pentry->object.file.state_current_counter */
+  if(!nfs4_BuildStateId_Other(pentry, pcontext, powner_input, pnew_state->stateid_other))
+    {
+      LogDebug(COMPONENT_CACHE_INODE,
+                        "Can't create a new state id for the pentry %p (E)", pentry);
+      *pstatus = CACHE_INODE_STATE_ERROR;
 
-          V_w(&pentry->lock);
+      /* stat */
+      pclient->stat.func_stats.nb_err_unrecover[CACHE_INODE_ADD_STATE] += 1;
 
-          return *pstatus;
-        }
+      ReleaseToPool(pnew_state, &pclient->pool_state_v4);
+      V_w(&pentry->lock);
 
-      /* Set the type and data for this state */
-      pnew_state->state_type = state_type;
-      memcpy((char *)&(pnew_state->state_data), (char *)pstate_data,
-             sizeof(cache_inode_state_data_t));
-      pnew_state->seqid = 0;
-      pnew_state->pentry = pentry;
-      pnew_state->powner = powner;
+      return *pstatus;
+    }
 
-      /* Set the head state id */
-      pentry->object.file.pstate_tail = (void *)pnew_state;
-    }                           /* else */
+  /* Set the type and data for this state */
+  pnew_state->state_type = state_type;
+  memcpy((char *)&(pnew_state->state_data), (char *)pstate_data,
+         sizeof(cache_inode_state_data_t));
+  pnew_state->seqid = 0;
+  pnew_state->pentry = pentry;
+  pnew_state->powner = powner;
+  pnew_state->next = NULL;
+  pnew_state->prev = NULL;
 
   /* Add the state to the related hashtable */
   if(!nfs4_State_Set(pnew_state->stateid_other, pnew_state))
@@ -291,11 +270,30 @@ cache_inode_status_t cache_inode_add_state(cache_entry_t * pentry,
       /* stat */
       pclient->stat.func_stats.nb_err_unrecover[CACHE_INODE_ADD_STATE] += 1;
 
+      ReleaseToPool(pnew_state, &pclient->pool_state_v4);
       V_w(&pentry->lock);
 
       return *pstatus;
     }
 
+  if(state_type == CACHE_INODE_STATE_LOCK)
+    {
+      /* Lock states are only in the lock indexes of the file */
+      cache_inode_lock_insert(pentry, pnew_state);
+    }
+  else
+    {
+      /* The state is added at the tail of the state list */
+      pnew_state->prev = (cache_inode_state_t *) pentry->object.file.pstate_tail;
+
+      if(pnew_state->prev == NULL)
+        pentry->object.file.pstate_head = (void *)pnew_state;
+      else
+        pnew_state->prev->next = pnew_state;
+
+      pentry->object.file.pstate_tail = (void *)pnew_state;
+    }
+
   /* Copy the result */
   *ppstate = pnew_state;
 
@@ -443,28 +441,7 @@ cache_inode_status_t cache_inode_del_state_by_key(char other[12],
 
   P_w(&pentry->lock);
 
-  /* Set the head counter */
-  if(pstate == pentry->object.file.pstate_head)
-    {
-      /* This is the first state managed */
-      if(pstate->next == NULL)
-        {
-          /* I am the only remaining state, set the head counter to 0 in the pentry */
-          pentry->object.file.pstate_head = NULL;
-        }
-      else
-        {
-          /* The state that is next to me become the new head */
-          pentry->object.file.pstate_head = (void *)pstate->next;
-        }
-    }
-
-  /* redo the double chained list */
-  if(pstate->next != NULL)
-    pstate->next->prev = pstate->prev;
-
-  if(pstate->prev != NULL)
-    pstate->prev->next = pstate->next;
+  cache_inode_state_unlink(pentry, pstate);
 
   if(!memcmp((char *)pstate->stateid_other, other, 12))
     {
@@ -550,28 +527,7 @@ cache_inode_status_t cache_inode_del_state(cache_inode_state_t * pstate,
 
   P_w(&pentry->lock);
 
-  /* Set the head counter */
-  if(pstate == pentry->object.file.pstate_head)
-    {
-      /* This is the first state managed */
-      if(pstate->next == NULL)
-        {
-          /* I am the only remaining state, set the head counter to 0 in the pentry */
-          pentry->object.file.pstate_head = NULL;
-        }
-      else
-        {
-          /* The state that is next to me become the new head */
-          pentry->object.file.pstate_head = (void *)pstate->next;
-        }
-    }
-
-  /* redo the double chained list */
-  if(pstate->next != NULL)
-    pstate->next->prev = pstate->prev;
-
-  if(pstate->prev != NULL)
-    pstate->prev->next = pstate->next;
+  cache_inode_state_unlink(pentry, pstate);
 
   /* Remove the entry from the HashTable */
   if(!nfs4_State_Del(pstate->stateid_other))
@@ -606,7 +562,8 @@ cache_inode_status_t cache_inode_del_state(cache_inode_state_t * pstate,
  *
  * cache_inode_state_iterate: iterates on the states's loop
  *
- * Iterates on the states's loop
+ * Iterates on the states's loop. The lock states are not in this loop, they are
+ * found by range with cache_inode_lock_check_conflicting_range.
  *
  * @param other           [IN]    stateid.other used as hash key
  * @param ppstate         [OUT]   pointer to a pointer of state that will point to the result
@@ -143,6 +143,9 @@ cache_inode_status_t cache_inode_truncate_sw(cache_entry_t * pentry,
     }
   else
     {
+      /* Data cached by blocks beyond the new size are no more valid */
+      cache_content_block_invalidate(&pentry->object.file.handle, length);
+
       /* Call FSAL to actually truncate */
       pentry->object.file.attributes.asked_attributes = pclient->attrmask;
 #ifdef _USE_MFSL
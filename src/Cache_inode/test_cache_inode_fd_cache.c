@@ -0,0 +1,205 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ * Test for the fd cache of the Cache inode layer
+ *
+ * Several threads open, keep and close the fds of a set of entries larger
+ * than the fd cache, the way cache_inode_open_by_name and cache_inode_close
+ * do. FSAL_close (MFSL_close with MFSL) is replaced by a stub checking that
+ * no fd is closed twice.
+ * At the end, each entry must have at most one slot, and no slot may be
+ * shared by two entries.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "BuddyMalloc.h"
+#include "LRU_List.h"
+#include "log_macros.h"
+#include "HashData.h"
+#include "HashTable.h"
+#include "fsal.h"
+#include "cache_inode.h"
+
+#define NB_THREADS 8
+#define NB_ENTRIES 64
+#define NB_SLOTS   16
+#define NB_LOOPS   200000
+
+static cache_entry_t entries[NB_ENTRIES];
+static int is_open[NB_ENTRIES];
+static unsigned int nb_errors = 0;
+
+/* Stub of the FSAL (or of the MFSL): the fds are only flags in is_open */
+#ifdef _USE_MFSL
+fsal_status_t MFSL_close(mfsl_file_t * file_descriptor,
+                         mfsl_context_t * p_mfsl_context, void *pextra)
+{
+  cache_entry_t *pentry = (cache_entry_t *) ((char *)file_descriptor -
+                                             offsetof(cache_entry_t,
+                                                      object.file.open_fd.mfsl_fd));
+#else
+fsal_status_t FSAL_close(fsal_file_t * file_descriptor)
+{
+  cache_entry_t *pentry = (cache_entry_t *) ((char *)file_descriptor -
+                                             offsetof(cache_entry_t,
+                                                      object.file.open_fd.fd));
+#endif
+  fsal_status_t status = { ERR_FSAL_NO_ERROR, 0 };
+
+  if(__sync_lock_test_and_set(&is_open[pentry - entries], 0) != 1)
+    {
+      LogTest("Test FAILED: fd of entry %d closed twice", (int)(pentry - entries));
+      __sync_fetch_and_add(&nb_errors, 1);
+    }
+
+  return status;
+}                               /* FSAL_close or MFSL_close */
+
+static void *worker(void *arg)
+{
+  cache_inode_client_t client;
+  cache_entry_t *pentry;
+  unsigned int seed = (unsigned int)(unsigned long)arg;
+  int i, n;
+
+  memset(&client, 0, sizeof(client));
+  client.use_cache = TRUE;
+
+  for(i = 0; i < NB_LOOPS; i++)
+    {
+      n = rand_r(&seed) % NB_ENTRIES;
+      pentry = &entries[n];
+
+      P_w(&pentry->lock);
+
+      if(rand_r(&seed) % 8 == 0)
+        {
+          /* as cache_inode_close */
+          cache_inode_fd_cache_close(pentry, &client);
+        }
+      else
+        {
+          /* as cache_inode_open_by_name */
+          if(pentry->object.file.open_fd.fileno == 0)
+            {
+              if(__sync_lock_test_and_set(&is_open[n], 1) != 0)
+                {
+                  LogTest("Test FAILED: entry %d opened twice", n);
+                  __sync_fetch_and_add(&nb_errors, 1);
+                }
+              pentry->object.file.open_fd.fileno = n + 1;
+            }
+          cache_inode_fd_cache_keep(pentry, &client);
+        }
+
+      V_w(&pentry->lock);
+    }
+
+  return NULL;
+}                               /* worker */
+
+int main(int argc, char *argv[])
+{
+  SetDefaultLogging("TEST");
+  SetNamePgm("test_cache_inode_fd_cache");
+
+  cache_inode_client_parameter_t param;
+  cache_inode_fd_cache_stat_t stat;
+  pthread_t threads[NB_THREADS];
+  int owner[NB_SLOTS];
+  unsigned int nb_kept = 0;
+  int i, slot;
+
+  BuddyInit(NULL);
+
+  memset(&param, 0, sizeof(param));
+  param.use_cache = TRUE;
+  param.max_open_fd = NB_SLOTS;
+
+  if(cache_inode_fd_cache_init(param, NB_THREADS) != 0)
+    {
+      LogTest("Test FAILED: Bad Init");
+      exit(1);
+    }
+
+  for(i = 0; i < NB_ENTRIES; i++)
+    {
+      memset(&entries[i], 0, sizeof(cache_entry_t));
+      entries[i].internal_md.type = REGULAR_FILE;
+      entries[i].object.file.open_fd.fd_slot = -1;
+      rw_lock_init(&entries[i].lock);
+    }
+
+  for(i = 0; i < NB_THREADS; i++)
+    if(pthread_create(&threads[i], NULL, worker, (void *)(unsigned long)(i + 1)) != 0)
+      {
+        LogTest("Test FAILED: cannot create thread %d", i);
+        exit(1);
+      }
+
+  for(i = 0; i < NB_THREADS; i++)
+    pthread_join(threads[i], NULL);
+
+  for(slot = 0; slot < NB_SLOTS; slot++)
+    owner[slot] = -1;
+
+  for(i = 0; i < NB_ENTRIES; i++)
+    {
+      slot = entries[i].object.file.open_fd.fd_slot;
+      if(slot < 0)
+        continue;
+
+      if(slot >= NB_SLOTS || owner[slot] != -1 || !is_open[i])
+        {
+          LogTest("Test FAILED: entry %d has bad slot %d", i, slot);
+          exit(1);
+        }
+      owner[slot] = i;
+      nb_kept += 1;
+    }
+
+  cache_inode_fd_cache_get_stats(&stat);
+  LogTest("opened=%llu reused=%llu evicted=%llu not_kept=%llu open=%u",
+          stat.nb_opened, stat.nb_reused, stat.nb_evicted, stat.nb_not_kept,
+          stat.nb_open);
+
+  if(stat.nb_open != nb_kept || nb_errors != 0)
+    {
+      LogTest("Test FAILED: %u slots in use for %u entries kept, %u errors",
+              stat.nb_open, nb_kept, nb_errors);
+      exit(1);
+    }
+
+  LogTest("\n-----------------------------------------");
+  LogTest("Test succeeded: all tests pass successfully");
+
+  exit(0);
+}                               /* main */
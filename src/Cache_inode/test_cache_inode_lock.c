@@ -0,0 +1,227 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ * Test for the lock index of the Cache inode layer
+ *
+ * Random lock states are inserted in and removed from the interval tree
+ * and the owner index of a file. After each change, a random range is
+ * tested for conflicts and the result is compared with a linear scan of
+ * the locks held. The locks of an owner found through the owner index
+ * are counted the same way.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "BuddyMalloc.h"
+#include "LRU_List.h"
+#include "log_macros.h"
+#include "HashData.h"
+#include "HashTable.h"
+#include "fsal.h"
+#include "cache_inode.h"
+
+#define NB_LOCKS   3000
+#define NB_OWNERS  7
+#define NB_LOOPS   200000
+#define MAX_OFFSET 100000
+
+static cache_inode_state_t locks[NB_LOCKS];
+static int is_held[NB_LOCKS];
+static cache_inode_open_owner_t owners[NB_OWNERS];
+
+static uint64_t lock_end(uint64_t offset, uint64_t length)
+{
+  if(length == CACHE_INODE_LOCK_OFFSET_EOF)
+    return CACHE_INODE_LOCK_OFFSET_EOF;
+
+  return offset + length;
+}                               /* lock_end */
+
+/* The reference: the conflicting lock with the lowest offset, by a linear scan */
+static cache_inode_state_t *scan_conflicting_range(uint64_t offset, uint64_t length,
+                                                   nfs_lock_type4 lock_type,
+                                                   open_owner4 * plockowner)
+{
+  cache_inode_state_t *pfound = NULL;
+  cache_inode_state_t *plock;
+  int i;
+
+  for(i = 0; i < NB_LOCKS; i++)
+    {
+      if(!is_held[i])
+        continue;
+
+      plock = &locks[i];
+
+      if(plock->state_data.lock.offset >= lock_end(offset, length) ||
+         offset >= lock_end(plock->state_data.lock.offset, plock->state_data.lock.length))
+        continue;
+
+      if(lock_type == READ_LT && plock->state_data.lock.lock_type == READ_LT)
+        continue;
+
+      if(plockowner != NULL &&
+         plockowner->owner.owner_len == plock->powner->owner_len &&
+         !memcmp(plockowner->owner.owner_val, plock->powner->owner_val,
+                 plock->powner->owner_len))
+        continue;
+
+      if(pfound == NULL ||
+         plock->state_data.lock.offset < pfound->state_data.lock.offset ||
+         (plock->state_data.lock.offset == pfound->state_data.lock.offset && plock < pfound))
+        pfound = plock;
+    }
+
+  return pfound;
+}                               /* scan_conflicting_range */
+
+int main(int argc, char *argv[])
+{
+  SetDefaultLogging("TEST");
+  SetNamePgm("test_cache_inode_lock");
+
+  cache_entry_t entry;
+  cache_inode_client_t client;
+  cache_inode_status_t status;
+  cache_inode_state_t *pfound;
+  cache_inode_state_t *pexpected;
+  cache_inode_state_t *piter;
+  open_owner4 lockowner;
+  open_owner4 *plockowner;
+  nfs_lock_type4 lock_type;
+  uint64_t offset, length;
+  unsigned int nb_found, nb_expected;
+  int i, k, n, loop;
+
+  BuddyInit(NULL);
+  srand(1);
+
+  memset(&entry, 0, sizeof(entry));
+  memset(&client, 0, sizeof(client));
+  entry.internal_md.type = REGULAR_FILE;
+  rw_lock_init(&entry.lock);
+  RBT_HEAD_INIT(&entry.object.file.lock_owners);
+
+  for(i = 0; i < NB_OWNERS; i++)
+    {
+      owners[i].clientid = i % 3;
+      owners[i].owner_len = sprintf(owners[i].owner_val, "owner%d", i);
+    }
+
+  for(loop = 0; loop < NB_LOOPS; loop++)
+    {
+      /* Take or release a random lock */
+      k = rand() % NB_LOCKS;
+
+      if(is_held[k])
+        {
+          cache_inode_lock_remove(&entry, &locks[k]);
+          is_held[k] = FALSE;
+        }
+      else
+        {
+          locks[k].state_type = CACHE_INODE_STATE_LOCK;
+          locks[k].pentry = &entry;
+          locks[k].powner = &owners[rand() % NB_OWNERS];
+          locks[k].state_data.lock.offset = rand() % MAX_OFFSET;
+          locks[k].state_data.lock.length =
+              (rand() % 50 == 0) ? CACHE_INODE_LOCK_OFFSET_EOF : 1 + rand() % 200;
+          locks[k].state_data.lock.lock_type = (rand() % 4) ? READ_LT : WRITE_LT;
+
+          cache_inode_lock_insert(&entry, &locks[k]);
+          is_held[k] = TRUE;
+        }
+
+      /* Test a random range, from a random owner or from none */
+      offset = rand() % MAX_OFFSET;
+      length = (rand() % 30 == 0) ? CACHE_INODE_LOCK_OFFSET_EOF : 1 + rand() % 300;
+      lock_type = (rand() % 2) ? READ_LT : WRITE_LT;
+
+      n = rand() % (NB_OWNERS + 1);
+      plockowner = NULL;
+      if(n < NB_OWNERS)
+        {
+          lockowner.clientid = owners[n].clientid;
+          lockowner.owner.owner_len = owners[n].owner_len;
+          lockowner.owner.owner_val = owners[n].owner_val;
+          plockowner = &lockowner;
+        }
+
+      cache_inode_lock_check_conflicting_range(&entry, offset, length, lock_type,
+                                               plockowner, &pfound, &status);
+      pexpected = scan_conflicting_range(offset, length, lock_type, plockowner);
+
+      if(pfound != pexpected ||
+         status != ((pexpected != NULL) ? CACHE_INODE_STATE_CONFLICT : CACHE_INODE_SUCCESS))
+        {
+          LogTest("Test FAILED: loop %d, conflict %p found instead of %p (status %d)",
+                  loop, pfound, pexpected, status);
+          exit(1);
+        }
+
+      if(plockowner == NULL)
+        continue;
+
+      /* The owner index must give all the locks of the owner, and only them */
+      nb_found = 0;
+      piter = NULL;
+      do
+        {
+          cache_inode_find_state_by_owner(&entry, plockowner, &piter, piter, &client, NULL,
+                                          &status);
+          if(piter != NULL)
+            {
+              if(piter->powner != &owners[n])
+                {
+                  LogTest("Test FAILED: loop %d, lock of another owner found", loop);
+                  exit(1);
+                }
+              nb_found += 1;
+            }
+        }
+      while(piter != NULL);
+
+      nb_expected = 0;
+      for(i = 0; i < NB_LOCKS; i++)
+        if(is_held[i] && locks[i].powner == &owners[n])
+          nb_expected += 1;
+
+      if(nb_found != nb_expected)
+        {
+          LogTest("Test FAILED: loop %d, %u locks found for owner %d instead of %u",
+                  loop, nb_found, n, nb_expected);
+          exit(1);
+        }
+    }
+
+  /* Tous les tests sont ok */
+  LogTest("\n-----------------------------------------");
+  LogTest("Test succeeded: all tests pass successfully");
+
+  exit(0);
+}                               /* main */
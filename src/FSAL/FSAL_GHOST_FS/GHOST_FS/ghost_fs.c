@@ -29,8 +29,20 @@
  * \date    $Date: 2005/11/28 17:02:35 $
  * \version $Revision: 1.6 $
  * \brief   Implementation of a very simple file system in memory,
- *          used for basic tests.
+ *          used for basic tests and as a benchmark backend.
  *          Thread-safe.
+ *
+ * Directories index their entries by name in a hash table that grows with
+ * them; the list of the entries is kept in insertion order for readdir.
+ * File data is held in blocks of GHOSTFS_BLOCK_SIZE bytes allocated on the
+ * first write, so holes cost nothing. A latency and a bandwidth can be
+ * injected in each class of operation, the caller sleeps without holding
+ * any lock.
+ *
+ * Removed items are never freed: they are kept in a free list and reused by
+ * the next creation. A handle on a removed item thus never points to freed
+ * memory, its magic number just no longer matches, and this is checked again
+ * once the item is locked.
  */
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -39,6 +51,9 @@
 #include "FSAL/FSAL_GHOST_FS/ghost_fs.h"
 #include "stuff_alloc.h"
 #include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
 #include <sys/time.h>
 
 #define TRUE  1
@@ -52,24 +67,52 @@ static GHOSTFS_stats_t stats;
 /* configuration parameters */
 static GHOSTFS_parameter_t config;
 
-/* computes a validator based on inode number an current time */
+/* removed items, kept for reuse */
+static GHOSTFS_item_t *free_items = NULL;
+static pthread_mutex_t free_items_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* last magic number given to an item */
+static unsigned int last_magic = 0;
+
+/* computes a validator for a new item.
+ * 0 is never given: it is the magic of removed items.
+ */
 static unsigned int mk_magic(GHOSTFS_inode_t inode)
 {
   unsigned int validator;
-  unsigned long long inode64 = (unsigned long long)inode;
-
-  struct timeval tv;
-  gettimeofday(&tv, NULL);
 
-  validator = (unsigned int)tv.tv_sec
-      ^ (unsigned int)tv.tv_usec ^ (unsigned int)(inode64 >> 32) ^ (unsigned int)inode64;
+  do
+    validator = __sync_add_and_fetch(&last_magic, 1);
+  while(validator == 0);
 
-  LogFullDebug(COMPONENT_FSAL, "validator(%llu)=%u", inode, validator);
+  LogFullDebug(COMPONENT_FSAL, "validator(%p)=%u", inode, validator);
 
   return validator;
 
 }
 
+/* sleeps for the latency of an operation class,
+ * plus the time needed to transfer size bytes at bandwidth MB/s.
+ */
+static void inject_delay(unsigned int latency, unsigned int bandwidth,
+                         GHOSTFS_size_t size)
+{
+  unsigned long long usec = latency;
+  struct timespec delay;
+
+  if(bandwidth != 0)
+    usec += (size * 1000000ULL) / ((unsigned long long)bandwidth << 20);
+
+  if(usec == 0)
+    return;
+
+  delay.tv_sec = usec / 1000000;
+  delay.tv_nsec = (usec % 1000000) * 1000;
+
+  while(nanosleep(&delay, &delay) == -1 && errno == EINTR) ;
+
+}
+
 static GHOSTFS_item_t *GetEntry_From_Handle(GHOSTFS_handle_t handle)
 {
   GHOSTFS_item_t *p_entry;
@@ -88,6 +131,101 @@ static GHOSTFS_item_t *GetEntry_From_Handle(GHOSTFS_handle_t handle)
 
 }
 
+/* gets an entry from its handle and locks it.
+ * the magic number is checked again once the lock is held,
+ * for the case the entry was removed while we were waiting.
+ */
+static GHOSTFS_item_t *LockEntry_From_Handle(GHOSTFS_handle_t handle, int for_write)
+{
+  GHOSTFS_item_t *p_entry;
+
+  p_entry = GetEntry_From_Handle(handle);
+
+  if(p_entry == NULL)
+    return NULL;
+
+  if(for_write)
+    P_w(&p_entry->entry_lock);
+  else
+    P_r(&p_entry->entry_lock);
+
+  if(p_entry->magic != handle.magic)
+    {
+      if(for_write)
+        V_w(&p_entry->entry_lock);
+      else
+        V_r(&p_entry->entry_lock);
+      return NULL;
+    }
+
+  return p_entry;
+
+}
+
+/* locks several entries for writing, by increasing address,
+ * and each of them only once.
+ * Every function that holds more than one entry lock
+ * takes them this way, which avoids deadlocks between them.
+ */
+static void LockEntries_Ordered(GHOSTFS_item_t ** entries, int nb)
+{
+  GHOSTFS_item_t *p_tmp;
+  int i, j;
+
+  /* insertion sort, there are at most 4 entries */
+  for(i = 1; i < nb; i++)
+    for(j = i; j > 0 && entries[j] < entries[j - 1]; j--)
+      {
+        p_tmp = entries[j];
+        entries[j] = entries[j - 1];
+        entries[j - 1] = p_tmp;
+      }
+
+  for(i = 0; i < nb; i++)
+    if(i == 0 || entries[i] != entries[i - 1])
+      P_w(&entries[i]->entry_lock);
+
+}
+
+/* unlocks entries locked by LockEntries_Ordered */
+static void UnlockEntries_Ordered(GHOSTFS_item_t ** entries, int nb)
+{
+  int i;
+
+  for(i = nb - 1; i >= 0; i--)
+    if(i == 0 || entries[i] != entries[i - 1])
+      V_w(&entries[i]->entry_lock);
+
+}
+
+/* locks the entries nb_locked..nb-1, in addition to the nb_locked first ones,
+ * which are already locked by LockEntries_Ordered.
+ * If the new entries do not all come after the locked ones,
+ * every lock is released and taken again in order:
+ * the function then returns FALSE, and the caller must check
+ * what it looked up under the released locks.
+ */
+static int RelockEntries_Ordered(GHOSTFS_item_t ** entries, int nb_locked, int nb)
+{
+  int i;
+
+  for(i = nb_locked; i < nb; i++)
+    if(entries[i] <= entries[nb_locked - 1])
+      break;
+
+  if(i == nb)
+    {
+      /* in order: lock them after the others */
+      LockEntries_Ordered(entries + nb_locked, nb - nb_locked);
+      return TRUE;
+    }
+
+  UnlockEntries_Ordered(entries, nb_locked);
+  LockEntries_Ordered(entries, nb);
+  return FALSE;
+
+}
+
 /* creates a new entry.
  * this entry is locked for modification.
  */
@@ -96,19 +234,38 @@ static GHOSTFS_item_t *create_new_ghostfs_entry(GHOSTFS_typeitem_t type)
 {
   GHOSTFS_item_t *p_entry;
 
-  /* Allocates a new entry */
-  p_entry = (GHOSTFS_item_t *) Mem_Alloc(sizeof(GHOSTFS_item_t));
+  /* reuse a removed entry if there is one */
+  P(free_items_lock);
+
+  p_entry = free_items;
+  if(p_entry != NULL)
+    free_items = p_entry->next_free;
 
-  memset(p_entry, 0, sizeof(GHOSTFS_item_t));
+  V(free_items_lock);
 
   if(p_entry == NULL)
-    return NULL;
+    {
+      /* Allocates a new entry */
+      p_entry = (GHOSTFS_item_t *) Mem_Alloc(sizeof(GHOSTFS_item_t));
+
+      if(p_entry == NULL)
+        return NULL;
 
-  rw_lock_init(&p_entry->entry_lock);
+      memset(p_entry, 0, sizeof(GHOSTFS_item_t));
 
-  /* lock the entry for modification */
+      rw_lock_init(&p_entry->entry_lock);
+    }
+
+  /* lock the entry for modification.
+   * the lock of a reused entry is still initialized,
+   * and may be taken by threads with a stale handle.
+   */
   P_w(&p_entry->entry_lock);
 
+  memset(&p_entry->attributes, 0, sizeof(GHOSTFS_metadata_t));
+  memset(&p_entry->content_u, 0, sizeof(p_entry->content_u));
+  p_entry->next_free = NULL;
+
   p_entry->inode = (GHOSTFS_inode_t) p_entry;
 
   /* generates a new magic number for this entry */
@@ -125,6 +282,71 @@ static GHOSTFS_item_t *create_new_ghostfs_entry(GHOSTFS_typeitem_t type)
 
 }
 
+/* hash function for entry names */
+static unsigned int hash_name(char *name)
+{
+  unsigned int hash = 5381;
+  int i;
+
+  for(i = 0; i < GHOSTFS_MAX_FILENAME && name[i] != '\0'; i++)
+    hash = (hash * 33) ^ (unsigned char)name[i];
+
+  return hash;
+}
+
+/* inserts a dirent into the name index of a directory */
+static void Hash_Insert(GHOSTFS_dir_t * p_dir, GHOSTFS_dirlist_t * p_entry)
+{
+  unsigned int index = hash_name(p_entry->name) % p_dir->hash_size;
+
+  p_entry->hash_next = p_dir->hash_tab[index];
+  p_dir->hash_tab[index] = p_entry;
+}
+
+/* removes a dirent from the name index of a directory */
+static void Hash_Remove(GHOSTFS_dir_t * p_dir, GHOSTFS_dirlist_t * p_entry)
+{
+  GHOSTFS_dirlist_t **pp_link;
+
+  pp_link = &p_dir->hash_tab[hash_name(p_entry->name) % p_dir->hash_size];
+
+  while(*pp_link != p_entry)
+    pp_link = &(*pp_link)->hash_next;
+
+  *pp_link = p_entry->hash_next;
+  p_entry->hash_next = NULL;
+}
+
+/* doubles the size of the name index of a directory.
+ * if this fails, the old index is kept (with longer chains).
+ */
+static int Hash_Grow(GHOSTFS_dir_t * p_dir)
+{
+  GHOSTFS_dirlist_t **new_tab;
+  GHOSTFS_dirlist_t *dirl;
+  unsigned int new_size;
+
+  new_size = (p_dir->hash_size == 0) ? GHOSTFS_DIR_HASH_SIZE : 2 * p_dir->hash_size;
+
+  new_tab = (GHOSTFS_dirlist_t **) Mem_Alloc(new_size * sizeof(GHOSTFS_dirlist_t *));
+
+  if(new_tab == NULL)
+    return ERR_GHOSTFS_MALLOC;
+
+  memset(new_tab, 0, new_size * sizeof(GHOSTFS_dirlist_t *));
+
+  if(p_dir->hash_tab != NULL)
+    Mem_Free(p_dir->hash_tab);
+
+  p_dir->hash_tab = new_tab;
+  p_dir->hash_size = new_size;
+
+  for(dirl = p_dir->direntries; dirl != NULL; dirl = dirl->next)
+    Hash_Insert(p_dir, dirl);
+
+  return ERR_GHOSTFS_NO_ERROR;
+}
+
 /* add an entry to a directory
  * does NOT verify if it already exists.
  */
@@ -132,10 +354,18 @@ static int Add_Dir_Entry(GHOSTFS_item_t * dir_item,
                          GHOSTFS_handle_t object_handle, char *object_name)
 {
   GHOSTFS_dirlist_t *p_entry;
+  GHOSTFS_dir_t *p_dir;
 
   if((dir_item == NULL) || (object_name == NULL) || (object_handle.inode == NULL))
     return ERR_GHOSTFS_INTERNAL;
 
+  p_dir = &dir_item->ITEM_DIR;
+
+  /* keep about one entry per bucket */
+  if(p_dir->nb_entries >= p_dir->hash_size)
+    if(Hash_Grow(p_dir) && p_dir->hash_tab == NULL)
+      return ERR_GHOSTFS_MALLOC;
+
   /* allocates a dirent */
   p_entry = (GHOSTFS_dirlist_t *) Mem_Alloc(sizeof(GHOSTFS_dirlist_t));
 
@@ -146,23 +376,48 @@ static int Add_Dir_Entry(GHOSTFS_item_t * dir_item,
 
   p_entry->handle = object_handle;
   strncpy(p_entry->name, object_name, GHOSTFS_MAX_FILENAME);
+  p_entry->cookie = ++p_dir->last_cookie;
   p_entry->next = NULL;
 
   /* insertion */
-  if(dir_item->ITEM_DIR.lastentry == NULL)
+  if(p_dir->lastentry == NULL)
     {
-      dir_item->ITEM_DIR.direntries = dir_item->ITEM_DIR.lastentry = p_entry;
+      p_dir->direntries = p_dir->lastentry = p_entry;
     }
   else
     {
-      dir_item->ITEM_DIR.lastentry->next = p_entry;
-      dir_item->ITEM_DIR.lastentry = p_entry;
+      p_entry->prev = p_dir->lastentry;
+      p_dir->lastentry->next = p_entry;
+      p_dir->lastentry = p_entry;
     }
 
+  Hash_Insert(p_dir, p_entry);
+  p_dir->nb_entries++;
+
   return ERR_GHOSTFS_NO_ERROR;
 
 }
 
+/* returns the dirent of a name in a directory, or NULL */
+static GHOSTFS_dirlist_t *Get_Dir_Entry(GHOSTFS_item_t * p_parent, char *entry_name)
+{
+  GHOSTFS_dirlist_t *dirl;
+
+  if(p_parent->ITEM_DIR.hash_size == 0)
+    return NULL;
+
+  dirl = p_parent->ITEM_DIR.hash_tab[hash_name(entry_name) % p_parent->ITEM_DIR.hash_size];
+
+  while(dirl)
+    {
+      if(!strncmp(dirl->name, entry_name, GHOSTFS_MAX_FILENAME))
+        return dirl;
+      dirl = dirl->hash_next;
+    }
+
+  return NULL;
+}
+
 /**
  * find an entry in a directory list
  * @return ERR_GHOSTFS_NO_ERROR if it was found,
@@ -174,22 +429,16 @@ static int Find_Entry(GHOSTFS_item_t * p_parent,
 {
   GHOSTFS_dirlist_t *dirl;
 
-  dirl = p_parent->ITEM_DIR.direntries;
+  dirl = Get_Dir_Entry(p_parent, entry_name);
 
-  while(dirl)
-    {
-      if(!strncmp(dirl->name, entry_name, GHOSTFS_MAX_FILENAME))
-        {
-          *p_found_hdl = dirl->handle;
+  /* item not found */
+  if(dirl == NULL)
+    return ERR_GHOSTFS_NOENT;
 
-          /* item found */
-          return ERR_GHOSTFS_NO_ERROR;
-        }
-      dirl = dirl->next;
-    }
+  *p_found_hdl = dirl->handle;
 
-  /* item not found */
-  return ERR_GHOSTFS_NOENT;
+  /* item found */
+  return ERR_GHOSTFS_NO_ERROR;
 }
 
 /**
@@ -203,22 +452,20 @@ static int Rename_Entry(GHOSTFS_item_t * p_parent,
 {
   GHOSTFS_dirlist_t *dirl;
 
-  dirl = p_parent->ITEM_DIR.direntries;
+  dirl = Get_Dir_Entry(p_parent, entry_old_name);
 
-  while(dirl)
-    {
-      if(!strncmp(dirl->name, entry_old_name, GHOSTFS_MAX_FILENAME))
-        {
-          strncpy(dirl->name, entry_new_name, GHOSTFS_MAX_FILENAME);
+  /* item not found */
+  if(dirl == NULL)
+    return ERR_GHOSTFS_NOENT;
 
-          /* item found */
-          return ERR_GHOSTFS_NO_ERROR;
-        }
-      dirl = dirl->next;
-    }
+  /* the entry keeps its place (and cookie) in the list */
+  Hash_Remove(&p_parent->ITEM_DIR, dirl);
+  strncpy(dirl->name, entry_new_name, GHOSTFS_MAX_FILENAME - 1);
+  dirl->name[GHOSTFS_MAX_FILENAME - 1] = '\0';
+  Hash_Insert(&p_parent->ITEM_DIR, dirl);
 
-  /* item not found */
-  return ERR_GHOSTFS_NOENT;
+  /* item found */
+  return ERR_GHOSTFS_NO_ERROR;
 }
 
 /**
@@ -232,22 +479,16 @@ static int Change_Entry_Handle(GHOSTFS_item_t * p_parent,
 {
   GHOSTFS_dirlist_t *dirl;
 
-  dirl = p_parent->ITEM_DIR.direntries;
+  dirl = Get_Dir_Entry(p_parent, entry_name);
 
-  while(dirl)
-    {
-      if(!strncmp(dirl->name, entry_name, GHOSTFS_MAX_FILENAME))
-        {
-          dirl->handle = entry_handle;
+  /* item not found */
+  if(dirl == NULL)
+    return ERR_GHOSTFS_NOENT;
 
-          /* item found */
-          return ERR_GHOSTFS_NO_ERROR;
-        }
-      dirl = dirl->next;
-    }
+  dirl->handle = entry_handle;
 
-  /* item not found */
-  return ERR_GHOSTFS_NOENT;
+  /* item found */
+  return ERR_GHOSTFS_NO_ERROR;
 }
 
 /**
@@ -259,35 +500,150 @@ static int Change_Entry_Handle(GHOSTFS_item_t * p_parent,
 static int Remove_Entry(GHOSTFS_item_t * p_parent, char *entry_name)
 {
   GHOSTFS_dirlist_t *dirl;
-  GHOSTFS_dirlist_t *last;
+  GHOSTFS_dir_t *p_dir = &p_parent->ITEM_DIR;
+
+  dirl = Get_Dir_Entry(p_parent, entry_name);
+
+  /* item not found */
+  if(dirl == NULL)
+    return ERR_GHOSTFS_NOENT;
+
+  /* if it was the first entry */
+  if(dirl->prev == NULL)
+    p_dir->direntries = dirl->next;
+  else
+    dirl->prev->next = dirl->next;
+
+  /* if it was the last entry */
+  if(dirl->next == NULL)
+    p_dir->lastentry = dirl->prev;
+  else
+    dirl->next->prev = dirl->prev;
+
+  Hash_Remove(p_dir, dirl);
+  p_dir->nb_entries--;
+
+  /* cookies are not pointers, the dirent can be freed */
+  Mem_Free(dirl);
+
+  return ERR_GHOSTFS_NO_ERROR;
+}
+
+/* frees the entries and the name index of a directory */
+static void Free_Dir_Content(GHOSTFS_item_t * p_dir)
+{
+  GHOSTFS_dirlist_t *dirl;
+  GHOSTFS_dirlist_t *next;
 
-  last = NULL;
-  dirl = p_parent->ITEM_DIR.direntries;
+  dirl = p_dir->ITEM_DIR.direntries;
 
   while(dirl)
     {
-      if(!strncmp(dirl->name, entry_name, GHOSTFS_MAX_FILENAME))
-        {
-          /* item found */
+      next = dirl->next;
+      Mem_Free(dirl);
+      dirl = next;
+    }
 
-          /* if it was the first entry */
-          if(last == NULL)
-            p_parent->ITEM_DIR.direntries = dirl->next;
-          else
-            last->next = dirl->next;
+  if(p_dir->ITEM_DIR.hash_tab != NULL)
+    Mem_Free(p_dir->ITEM_DIR.hash_tab);
 
-          /* if it was the last entry */
-          if(dirl == p_parent->ITEM_DIR.lastentry)
-            p_parent->ITEM_DIR.lastentry = last;
+  memset(&p_dir->ITEM_DIR, 0, sizeof(GHOSTFS_dir_t));
+}
+
+/* makes the block table of a file large enough for nb_blocks blocks */
+static int Grow_Block_Table(GHOSTFS_item_t * p_file, unsigned int nb_blocks)
+{
+  GHOSTFS_file_t *p_data = &p_file->ITEM_FILE;
+  caddr_t *new_tab;
+  unsigned int new_size;
+
+  if(nb_blocks <= p_data->nb_blocks)
+    return ERR_GHOSTFS_NO_ERROR;
+
+  /* at least double it, for files that are written sequentially */
+  new_size = 2 * p_data->nb_blocks;
+  if(new_size < nb_blocks)
+    new_size = nb_blocks;
+
+  new_tab = (caddr_t *) Mem_Realloc(p_data->blocks, new_size * sizeof(caddr_t));
+
+  if(new_tab == NULL)
+    return ERR_GHOSTFS_MALLOC;
+
+  memset(new_tab + p_data->nb_blocks, 0,
+         (new_size - p_data->nb_blocks) * sizeof(caddr_t));
+
+  p_data->blocks = new_tab;
+  p_data->nb_blocks = new_size;
+
+  return ERR_GHOSTFS_NO_ERROR;
+}
+
+/* changes the size of a file.
+ * the data beyond the end of file is always zero:
+ * blocks past the new size are freed and the end of the last one is cleared.
+ */
+static void Set_File_Size(GHOSTFS_item_t * p_file, GHOSTFS_size_t length)
+{
+  GHOSTFS_file_t *p_data = &p_file->ITEM_FILE;
+  unsigned int first_free, i;
+  unsigned int offset_in_block;
+
+  if(length < p_file->attributes.size)
+    {
+      first_free = (length + GHOSTFS_BLOCK_SIZE - 1) / GHOSTFS_BLOCK_SIZE;
+
+      for(i = first_free; i < p_data->nb_blocks; i++)
+        if(p_data->blocks[i] != NULL)
+          {
+            Mem_Free(p_data->blocks[i]);
+            p_data->blocks[i] = NULL;
+            p_data->nb_allocated--;
+          }
+
+      offset_in_block = length % GHOSTFS_BLOCK_SIZE;
+
+      if(offset_in_block != 0 && p_data->blocks[length / GHOSTFS_BLOCK_SIZE] != NULL)
+        memset(p_data->blocks[length / GHOSTFS_BLOCK_SIZE] + offset_in_block, 0,
+               GHOSTFS_BLOCK_SIZE - offset_in_block);
 
-          return ERR_GHOSTFS_NO_ERROR;
-        }
-      last = dirl;
-      dirl = dirl->next;
     }
 
-  /* item not found */
-  return ERR_GHOSTFS_NOENT;
+  if(p_data->nb_allocated == 0 && p_data->blocks != NULL)
+    {
+      Mem_Free(p_data->blocks);
+      p_data->blocks = NULL;
+      p_data->nb_blocks = 0;
+    }
+
+  if(length != p_file->attributes.size)
+    {
+      p_file->attributes.size = length;
+      p_file->attributes.mtime = p_file->attributes.ctime = time(NULL);
+    }
+}
+
+/* destroys an entry that is no longer in the namespace.
+ * the entry is locked for modification, it is unlocked
+ * and put in the free list.
+ */
+static void release_ghostfs_entry(GHOSTFS_item_t * p_entry)
+{
+  if(p_entry->type == GHOSTFS_DIR)
+    Free_Dir_Content(p_entry);
+  else if(p_entry->type == GHOSTFS_FILE)
+    Set_File_Size(p_entry, 0);
+
+  /* the handles on this entry are now stale */
+  p_entry->magic = 0;
+  p_entry->inode = NULL;
+
+  V_w(&p_entry->entry_lock);
+
+  P(free_items_lock);
+  p_entry->next_free = free_items;
+  free_items = p_entry;
+  V(free_items_lock);
 }
 
 /* check that the name does not contain special sequences */
@@ -342,6 +698,12 @@ static void fill_attributes(GHOSTFS_item_t * p_entry, GHOSTFS_Attrs_t * p_out_at
   p_out_attrs->creationTime = p_entry->attributes.creationTime;
   p_out_attrs->size = p_entry->attributes.size;
 
+  if(p_entry->type == GHOSTFS_FILE)
+    p_out_attrs->spaceused =
+        (GHOSTFS_size_t) p_entry->ITEM_FILE.nb_allocated * GHOSTFS_BLOCK_SIZE;
+  else
+    p_out_attrs->spaceused = p_entry->attributes.size;
+
 }
 
 /*------------------------ Library functions -------------------*/
@@ -361,6 +723,9 @@ int GHOSTFS_Init(GHOSTFS_parameter_t init_cfg)
   /* saves the configuration */
   config = init_cfg;
 
+  /* handles from a previous run must not be valid */
+  last_magic = (unsigned int)time(NULL);
+
   /* creates the root entry */
   p_root = create_new_ghostfs_entry(GHOSTFS_DIR);
 
@@ -380,10 +745,6 @@ int GHOSTFS_Init(GHOSTFS_parameter_t init_cfg)
 
   p_root->attributes.size = 0;
 
-  /* empty for the moment */
-  p_root->ITEM_DIR.direntries = NULL;
-  p_root->ITEM_DIR.lastentry = NULL;
-
   roothandle.inode = p_root->inode;
   roothandle.magic = p_root->magic;
 
@@ -460,15 +821,14 @@ int GHOSTFS_Lookup(GHOSTFS_handle_t handle_parent,
   if(strchr(ghostfs_name, '/'))
     return ERR_GHOSTFS_ARGS;
 
-  /* convert inode to item adress */
-  p_parent = GetEntry_From_Handle(handle_parent);
+  inject_delay(config.latency_meta_read, 0, 0);
+
+  /* convert inode to item adress and lock the directory for reading */
+  p_parent = LockEntry_From_Handle(handle_parent, FALSE);
 
   if(p_parent == NULL)
     return ERR_GHOSTFS_STALE;
 
-  /* lock the directory for reading */
-  P_r(&p_parent->entry_lock);
-
   /* check object type */
   if(p_parent->type != GHOSTFS_DIR)
     {
@@ -497,12 +857,12 @@ int GHOSTFS_GetAttrs(GHOSTFS_handle_t handle, GHOSTFS_Attrs_t * object_attribute
   if(!object_attributes)
     return ERR_GHOSTFS_ARGS;
 
-  p_item = GetEntry_From_Handle(handle);
-  if(p_item == NULL)
-    return ERR_GHOSTFS_STALE;
+  inject_delay(config.latency_meta_read, 0, 0);
 
   /* locks the entry for reading */
-  P_r(&p_item->entry_lock);
+  p_item = LockEntry_From_Handle(handle, FALSE);
+  if(p_item == NULL)
+    return ERR_GHOSTFS_STALE;
 
   /* fill in the attribute structure */
 
@@ -528,15 +888,14 @@ int GHOSTFS_Access(GHOSTFS_handle_t handle,
   if(!p_root)
     return ERR_GHOSTFS_NOTINIT;
 
-  /* convert inode to item adress */
+  inject_delay(config.latency_meta_read, 0, 0);
+
+  /* convert inode to item adress and lock the entry for reading */
 
-  p_item = GetEntry_From_Handle(handle);
+  p_item = LockEntry_From_Handle(handle, FALSE);
   if(p_item == NULL)
     return ERR_GHOSTFS_STALE;
 
-  /* locks the entry for reading */
-  P_r(&p_item->entry_lock);
-
   /* if the user is root he can always access the file */
   if((userid == 0) && config.root_access)
     {
@@ -586,15 +945,14 @@ int GHOSTFS_ReadLink(GHOSTFS_handle_t handle, char *buffer, GHOSTFS_mdsize_t buf
   if(!buffer)
     return ERR_GHOSTFS_ARGS;
 
-  /* convert inode to item adress */
+  inject_delay(config.latency_meta_read, 0, 0);
+
+  /* convert inode to item adress and lock the entry for reading */
 
-  p_item = GetEntry_From_Handle(handle);
+  p_item = LockEntry_From_Handle(handle, FALSE);
   if(p_item == NULL)
     return ERR_GHOSTFS_STALE;
 
-  /* locks the entry for reading */
-  P_r(&p_item->entry_lock);
-
   /* check type */
   if(p_item->type != GHOSTFS_LNK)
     {
@@ -617,6 +975,210 @@ int GHOSTFS_ReadLink(GHOSTFS_handle_t handle, char *buffer, GHOSTFS_mdsize_t buf
 
 }
 
+/** Reads data from a file. */
+int GHOSTFS_Read(GHOSTFS_handle_t handle,
+                 GHOSTFS_size_t offset,
+                 GHOSTFS_size_t size,
+                 caddr_t buffer, GHOSTFS_size_t * p_read_size, int *p_end_of_file)
+{
+  GHOSTFS_item_t *p_item;
+  GHOSTFS_size_t done, len;
+  unsigned int offset_in_block;
+  caddr_t block;
+
+  /* checks whether the FS has been loaded. */
+  if(!p_root)
+    return ERR_GHOSTFS_NOTINIT;
+
+  /* checks args. */
+  if(!buffer || !p_read_size || !p_end_of_file)
+    return ERR_GHOSTFS_ARGS;
+
+  *p_read_size = 0;
+  *p_end_of_file = FALSE;
+
+  /* convert inode to item adress and lock the entry for reading */
+
+  p_item = LockEntry_From_Handle(handle, FALSE);
+  if(p_item == NULL)
+    return ERR_GHOSTFS_STALE;
+
+  /* check type */
+  if(p_item->type != GHOSTFS_FILE)
+    {
+      V_r(&p_item->entry_lock);
+      return (p_item->type == GHOSTFS_DIR) ? ERR_GHOSTFS_ISDIR : ERR_GHOSTFS_NOTFILE;
+    }
+
+  /* don't read beyond the end of file */
+  if(offset >= p_item->attributes.size)
+    size = 0;
+  else if(size > p_item->attributes.size - offset)
+    size = p_item->attributes.size - offset;
+
+  for(done = 0; done < size; done += len)
+    {
+      offset_in_block = (offset + done) % GHOSTFS_BLOCK_SIZE;
+
+      len = GHOSTFS_BLOCK_SIZE - offset_in_block;
+      if(len > size - done)
+        len = size - done;
+
+      block = p_item->ITEM_FILE.blocks[(offset + done) / GHOSTFS_BLOCK_SIZE];
+
+      /* holes read as zeros */
+      if(block == NULL)
+        memset(buffer + done, 0, len);
+      else
+        memcpy(buffer + done, block + offset_in_block, len);
+    }
+
+  *p_read_size = size;
+  *p_end_of_file = (offset + size >= p_item->attributes.size);
+
+  /* atime is not updated: this would need the lock for modification */
+
+  V_r(&p_item->entry_lock);
+
+  inject_delay(config.latency_data_read, config.bandwidth_read, size);
+
+  return ERR_GHOSTFS_NO_ERROR;
+
+}                               /* GHOSTFS_Read */
+
+/** Writes data to a file. */
+int GHOSTFS_Write(GHOSTFS_handle_t handle,
+                  GHOSTFS_size_t offset,
+                  GHOSTFS_size_t size,
+                  caddr_t buffer,
+                  GHOSTFS_size_t * p_written_size, GHOSTFS_Attrs_t * p_file_attrs)
+{
+  GHOSTFS_item_t *p_item;
+  GHOSTFS_size_t done, len;
+  unsigned int offset_in_block, index;
+  caddr_t *p_block;
+  int rc = ERR_GHOSTFS_NO_ERROR;
+
+  /* checks whether the FS has been loaded. */
+  if(!p_root)
+    return ERR_GHOSTFS_NOTINIT;
+
+  /* checks args. */
+  if(!buffer || !p_written_size)
+    return ERR_GHOSTFS_ARGS;
+
+  *p_written_size = 0;
+
+  if(offset > GHOSTFS_MAX_FILESIZE || size > GHOSTFS_MAX_FILESIZE - offset)
+    return ERR_GHOSTFS_FBIG;
+
+  inject_delay(config.latency_data_write, config.bandwidth_write, size);
+
+  /* convert inode to item adress and lock the entry for modification */
+
+  p_item = LockEntry_From_Handle(handle, TRUE);
+  if(p_item == NULL)
+    return ERR_GHOSTFS_STALE;
+
+  /* check type */
+  if(p_item->type != GHOSTFS_FILE)
+    {
+      V_w(&p_item->entry_lock);
+      return (p_item->type == GHOSTFS_DIR) ? ERR_GHOSTFS_ISDIR : ERR_GHOSTFS_NOTFILE;
+    }
+
+  if(size > 0)
+    rc = Grow_Block_Table(p_item,
+                          (offset + size + GHOSTFS_BLOCK_SIZE - 1) / GHOSTFS_BLOCK_SIZE);
+
+  for(done = 0; rc == ERR_GHOSTFS_NO_ERROR && done < size; done += len)
+    {
+      index = (offset + done) / GHOSTFS_BLOCK_SIZE;
+      offset_in_block = (offset + done) % GHOSTFS_BLOCK_SIZE;
+
+      len = GHOSTFS_BLOCK_SIZE - offset_in_block;
+      if(len > size - done)
+        len = size - done;
+
+      p_block = &p_item->ITEM_FILE.blocks[index];
+
+      /* allocate the block at its first write */
+      if(*p_block == NULL)
+        {
+          if((*p_block = (caddr_t) Mem_Alloc(GHOSTFS_BLOCK_SIZE)) == NULL)
+            {
+              rc = ERR_GHOSTFS_MALLOC;
+              break;
+            }
+
+          memset(*p_block, 0, GHOSTFS_BLOCK_SIZE);
+          p_item->ITEM_FILE.nb_allocated++;
+        }
+
+      memcpy(*p_block + offset_in_block, buffer + done, len);
+    }
+
+  /* a short write is not an error */
+  if(done > 0)
+    {
+      rc = ERR_GHOSTFS_NO_ERROR;
+
+      if(offset + done > p_item->attributes.size)
+        p_item->attributes.size = offset + done;
+
+      p_item->attributes.mtime = p_item->attributes.ctime = time(NULL);
+    }
+
+  *p_written_size = done;
+
+  if(p_file_attrs != NULL)
+    fill_attributes(p_item, p_file_attrs);
+
+  V_w(&p_item->entry_lock);
+
+  return rc;
+
+}                               /* GHOSTFS_Write */
+
+/** Changes the size of a file. */
+int GHOSTFS_Truncate(GHOSTFS_handle_t handle,
+                     GHOSTFS_size_t length, GHOSTFS_Attrs_t * p_file_attrs)
+{
+  GHOSTFS_item_t *p_item;
+
+  /* checks whether the FS has been loaded. */
+  if(!p_root)
+    return ERR_GHOSTFS_NOTINIT;
+
+  if(length > GHOSTFS_MAX_FILESIZE)
+    return ERR_GHOSTFS_FBIG;
+
+  inject_delay(config.latency_meta_write, 0, 0);
+
+  /* convert inode to item adress and lock the entry for modification */
+
+  p_item = LockEntry_From_Handle(handle, TRUE);
+  if(p_item == NULL)
+    return ERR_GHOSTFS_STALE;
+
+  /* check type */
+  if(p_item->type != GHOSTFS_FILE)
+    {
+      V_w(&p_item->entry_lock);
+      return (p_item->type == GHOSTFS_DIR) ? ERR_GHOSTFS_ISDIR : ERR_GHOSTFS_NOTFILE;
+    }
+
+  Set_File_Size(p_item, length);
+
+  if(p_file_attrs != NULL)
+    fill_attributes(p_item, p_file_attrs);
+
+  V_w(&p_item->entry_lock);
+
+  return ERR_GHOSTFS_NO_ERROR;
+
+}                               /* GHOSTFS_Truncate */
+
 /** Opens a directory stream. */
 
 int GHOSTFS_Opendir(GHOSTFS_handle_t handle, dir_descriptor_t * dir)
@@ -631,15 +1193,14 @@ int GHOSTFS_Opendir(GHOSTFS_handle_t handle, dir_descriptor_t * dir)
   if(!dir)
     return ERR_GHOSTFS_ARGS;
 
-  /* convert inode to item adress */
+  inject_delay(config.latency_meta_read, 0, 0);
 
-  p_item = GetEntry_From_Handle(handle);
+  /* convert inode to item adress and lock the entry for reading */
+
+  p_item = LockEntry_From_Handle(handle, FALSE);
   if(p_item == NULL)
     return ERR_GHOSTFS_STALE;
 
-  /* locks the entry for reading */
-  P_r(&p_item->entry_lock);
-
   /* check type */
   if(p_item->type != GHOSTFS_DIR)
     {
@@ -693,7 +1254,7 @@ int GHOSTFS_Readdir(dir_descriptor_t * dir, GHOSTFS_dirent_t * dirent)
   /* fill in dirent */
   dirent->handle = dir->current_dir_entry->handle;
   strncpy(dirent->name, dir->current_dir_entry->name, GHOSTFS_MAX_FILENAME);
-  dirent->cookie = dir->current_dir_entry;
+  dirent->cookie = dir->current_dir_entry->cookie;
 
   /* updates dir descriptor */
   dir->current_dir_entry = dir->current_dir_entry->next;
@@ -704,6 +1265,7 @@ int GHOSTFS_Readdir(dir_descriptor_t * dir, GHOSTFS_dirent_t * dirent)
 int GHOSTFS_Seekdir(dir_descriptor_t * dir, GHOSTFS_cookie_t cookie)
 {
   GHOSTFS_item_t *p_dir;
+  GHOSTFS_dirlist_t *dirl;
 
   /* checks whether the FS has been loaded. */
   if(!p_root)
@@ -723,17 +1285,16 @@ int GHOSTFS_Seekdir(dir_descriptor_t * dir, GHOSTFS_cookie_t cookie)
      || (dir->master_record != &(p_dir->ITEM_DIR)) || (p_dir->type != GHOSTFS_DIR))
     return ERR_GHOSTFS_NOTOPENED;
 
-  /* updates dir descriptor */
-  if(cookie == NULL)
-    {
-      /* begin of the directory */
-      dir->current_dir_entry = dir->master_record->direntries;
-    }
-  else
-    {
-      /* last read == cookie => next = the one that follows the cookie */
-      dir->current_dir_entry = cookie->next;
-    }
+  /* updates dir descriptor:
+   * last read == cookie => next = the first one with a greater cookie
+   * (the entry of the cookie may have been removed since).
+   */
+  dirl = dir->master_record->direntries;
+
+  while(dirl && dirl->cookie <= cookie)
+    dirl = dirl->next;
+
+  dir->current_dir_entry = dirl;
 
   return ERR_GHOSTFS_NO_ERROR;
 
@@ -782,12 +1343,15 @@ int GHOSTFS_SetAttrs(GHOSTFS_handle_t handle,
   if(!p_root)
     return ERR_GHOSTFS_NOTINIT;
 
-  p_item = GetEntry_From_Handle(handle);
-  if(p_item == NULL)
-    return ERR_GHOSTFS_STALE;
+  if((setattr_mask & SETATTR_SIZE) && attrs_values.size > GHOSTFS_MAX_FILESIZE)
+    return ERR_GHOSTFS_FBIG;
+
+  inject_delay(config.latency_meta_write, 0, 0);
 
   /* locks the entry for modification */
-  P_w(&p_item->entry_lock);
+  p_item = LockEntry_From_Handle(handle, TRUE);
+  if(p_item == NULL)
+    return ERR_GHOSTFS_STALE;
 
   /* check settable attributes */
 
@@ -818,6 +1382,10 @@ int GHOSTFS_SetAttrs(GHOSTFS_handle_t handle,
   if(setattr_mask & SETATTR_ATIME)
     p_item->attributes.atime = attrs_values.atime;
 
+  if(setattr_mask & SETATTR_SIZE)
+    Set_File_Size(p_item, attrs_values.size);
+
+  /* after the size, that changes the mtime */
   if(setattr_mask & SETATTR_MTIME)
     p_item->attributes.mtime = attrs_values.mtime;
 
@@ -856,12 +1424,12 @@ int GHOSTFS_MkDir(GHOSTFS_handle_t parent_handle,
 
   /* get the parent and lock it for writing */
 
-  p_parent = GetEntry_From_Handle(parent_handle);
+  inject_delay(config.latency_meta_write, 0, 0);
+
+  p_parent = LockEntry_From_Handle(parent_handle, TRUE);
   if(p_parent == NULL)
     return ERR_GHOSTFS_STALE;
 
-  P_w(&p_parent->entry_lock);
-
   /* check type */
   if(p_parent->type != GHOSTFS_DIR)
     {
@@ -906,10 +1474,6 @@ int GHOSTFS_MkDir(GHOSTFS_handle_t parent_handle,
 
   p_newdir->attributes.size = 0;
 
-  /* empty for the moment */
-  p_newdir->ITEM_DIR.direntries = NULL;
-  p_newdir->ITEM_DIR.lastentry = NULL;
-
   p_new_dir_handle->inode = p_newdir->inode;
   p_new_dir_handle->magic = p_newdir->magic;
 
@@ -919,7 +1483,7 @@ int GHOSTFS_MkDir(GHOSTFS_handle_t parent_handle,
   if(rc)
     {
       V_w(&p_parent->entry_lock);
-      V_w(&p_newdir->entry_lock);
+      release_ghostfs_entry(p_newdir);
       return rc;
     }
   p_newdir->linkcount++;
@@ -930,10 +1494,9 @@ int GHOSTFS_MkDir(GHOSTFS_handle_t parent_handle,
   if(rc)
     {
       V_w(&p_parent->entry_lock);
-      V_w(&p_newdir->entry_lock);
+      release_ghostfs_entry(p_newdir);
       return rc;
     }
-  p_parent->linkcount++;
 
   /* add named entry into the parent directory */
 
@@ -941,9 +1504,10 @@ int GHOSTFS_MkDir(GHOSTFS_handle_t parent_handle,
   if(rc)
     {
       V_w(&p_parent->entry_lock);
-      V_w(&p_newdir->entry_lock);
+      release_ghostfs_entry(p_newdir);
       return rc;
     }
+  p_parent->linkcount++;
   p_newdir->linkcount++;
 
   /* update parent mtime and ctime */
@@ -991,12 +1555,12 @@ int GHOSTFS_Create(GHOSTFS_handle_t parent_handle,
 
   /* get the parent and lock it for writing */
 
-  p_parent = GetEntry_From_Handle(parent_handle);
+  inject_delay(config.latency_meta_write, 0, 0);
+
+  p_parent = LockEntry_From_Handle(parent_handle, TRUE);
   if(p_parent == NULL)
     return ERR_GHOSTFS_STALE;
 
-  P_w(&p_parent->entry_lock);
-
   /* check type */
   if(p_parent->type != GHOSTFS_DIR)
     {
@@ -1050,7 +1614,7 @@ int GHOSTFS_Create(GHOSTFS_handle_t parent_handle,
   if(rc)
     {
       V_w(&p_parent->entry_lock);
-      V_w(&p_new_file->entry_lock);
+      release_ghostfs_entry(p_new_file);
       return rc;
     }
   p_new_file->linkcount++;
@@ -1080,6 +1644,7 @@ int GHOSTFS_Link(GHOSTFS_handle_t parent_handle,
   GHOSTFS_handle_t tmphandle;
   GHOSTFS_item_t *p_parent;
   GHOSTFS_item_t *p_object;
+  GHOSTFS_item_t *entries[2];
 
   /* checks whether the FS is already loaded. */
   if(!p_root)
@@ -1091,61 +1656,62 @@ int GHOSTFS_Link(GHOSTFS_handle_t parent_handle,
   if(!is_name_ok(new_link_name))
     return ERR_GHOSTFS_ARGS;
 
-  /* get the parent and lock it for writing */
+  /* get the parent and the target item, and lock them for modification */
+
+  inject_delay(config.latency_meta_write, 0, 0);
 
   p_parent = GetEntry_From_Handle(parent_handle);
-  if(p_parent == NULL)
+  p_object = GetEntry_From_Handle(target_handle);
+
+  if(p_parent == NULL || p_object == NULL)
     return ERR_GHOSTFS_STALE;
 
-  P_w(&p_parent->entry_lock);
+  entries[0] = p_parent;
+  entries[1] = p_object;
+  LockEntries_Ordered(entries, 2);
 
-  /* check type */
+  /* one of them may have been removed while we were waiting */
+  if(p_parent->magic != parent_handle.magic || p_object->magic != target_handle.magic)
+    {
+      UnlockEntries_Ordered(entries, 2);
+      return ERR_GHOSTFS_STALE;
+    }
+
+  /* check types */
   if(p_parent->type != GHOSTFS_DIR)
     {
-      V_w(&p_parent->entry_lock);
+      UnlockEntries_Ordered(entries, 2);
       return ERR_GHOSTFS_NOTDIR;
     }
 
+  if(p_object->type == GHOSTFS_DIR)
+    {
+      UnlockEntries_Ordered(entries, 2);
+      return ERR_GHOSTFS_ISDIR;
+    }
+
   /* First try looking up the entry (check if it does not exist) */
 
   rc = Find_Entry(p_parent, new_link_name, &tmphandle);
 
   if(rc == 0)
     {
-      V_w(&p_parent->entry_lock);
+      UnlockEntries_Ordered(entries, 2);
       return ERR_GHOSTFS_EXIST;
     }
 
   if(rc != ERR_GHOSTFS_NOENT)
     {
-      V_w(&p_parent->entry_lock);
+      UnlockEntries_Ordered(entries, 2);
       return rc;
     }
 
-  /* get the target item and lock it for mofification */
-  p_object = GetEntry_From_Handle(target_handle);
-
-  if(p_object == NULL)
-    {
-      V_w(&p_parent->entry_lock);
-      return ERR_GHOSTFS_STALE;
-    }
-
-  if(p_object->type == GHOSTFS_DIR)
-    {
-      V_w(&p_parent->entry_lock);
-      return ERR_GHOSTFS_ISDIR;
-    }
-
-  P_w(&p_object->entry_lock);
-
   /* add named entry into the parent directory */
 
   rc = Add_Dir_Entry(p_parent, target_handle, new_link_name);
   if(rc)
     {
-      V_w(&p_parent->entry_lock);
-      V_w(&p_object->entry_lock);
+      UnlockEntries_Ordered(entries, 2);
       return rc;
     }
 
@@ -1161,8 +1727,7 @@ int GHOSTFS_Link(GHOSTFS_handle_t parent_handle,
 
   /* unlock and return */
 
-  V_w(&p_parent->entry_lock);
-  V_w(&p_object->entry_lock);
+  UnlockEntries_Ordered(entries, 2);
 
   return ERR_GHOSTFS_NO_ERROR;
 
@@ -1197,12 +1762,12 @@ int GHOSTFS_Symlink(GHOSTFS_handle_t parent_handle,
 
   /* get the parent and lock it for writing */
 
-  p_parent = GetEntry_From_Handle(parent_handle);
+  inject_delay(config.latency_meta_write, 0, 0);
+
+  p_parent = LockEntry_From_Handle(parent_handle, TRUE);
   if(p_parent == NULL)
     return ERR_GHOSTFS_STALE;
 
-  P_w(&p_parent->entry_lock);
-
   /* check type */
   if(p_parent->type != GHOSTFS_DIR)
     {
@@ -1256,7 +1821,7 @@ int GHOSTFS_Symlink(GHOSTFS_handle_t parent_handle,
   if(rc)
     {
       V_w(&p_parent->entry_lock);
-      V_w(&p_new_lnk->entry_lock);
+      release_ghostfs_entry(p_new_lnk);
       return rc;
     }
   p_new_lnk->linkcount++;
@@ -1286,7 +1851,9 @@ int GHOSTFS_Unlink(GHOSTFS_handle_t parent_handle,      /* IN */
   GHOSTFS_item_t *p_parent;
   GHOSTFS_item_t *p_object;
 
-  GHOSTFS_handle_t obj_handle;
+  GHOSTFS_item_t *entries[2];
+
+  GHOSTFS_handle_t obj_handle, tmphandle;
   int rc;
 
   /* checks whether the FS is already loaded. */
@@ -1303,12 +1870,12 @@ int GHOSTFS_Unlink(GHOSTFS_handle_t parent_handle,      /* IN */
 
   /* get the parent and lock it for writing */
 
-  p_parent = GetEntry_From_Handle(parent_handle);
+  inject_delay(config.latency_meta_write, 0, 0);
+
+  p_parent = LockEntry_From_Handle(parent_handle, TRUE);
   if(p_parent == NULL)
     return ERR_GHOSTFS_STALE;
 
-  P_w(&p_parent->entry_lock);
-
   /* check type */
 
   if(p_parent->type != GHOSTFS_DIR)
@@ -1327,13 +1894,31 @@ int GHOSTFS_Unlink(GHOSTFS_handle_t parent_handle,      /* IN */
       return rc;
     }
 
-  /* get the object to be deleted and lock it for writing */
+  /* get the object to be deleted and lock it for writing.
+   * it can't be removed meanwhile, as it is still in the parent.
+   */
 
   p_object = GetEntry_From_Handle(obj_handle);
   if(p_object == NULL)
-    return ERR_GHOSTFS_STALE;
+    {
+      V_w(&p_parent->entry_lock);
+      return ERR_GHOSTFS_STALE;
+    }
 
-  P_w(&p_object->entry_lock);
+  entries[0] = p_parent;
+  entries[1] = p_object;
+
+  if(!RelockEntries_Ordered(entries, 1, 2))
+    {
+      /* the parent was unlocked meanwhile: the name must still be the object */
+      if(p_parent->magic != parent_handle.magic || p_object->magic != obj_handle.magic
+         || Find_Entry(p_parent, object_name, &tmphandle)
+         || tmphandle.inode != obj_handle.inode || tmphandle.magic != obj_handle.magic)
+        {
+          UnlockEntries_Ordered(entries, 2);
+          return GHOSTFS_Unlink(parent_handle, object_name, p_parent_attrs);
+        }
+    }
 
   /* test if it is a non empty directory */
 
@@ -1362,24 +1947,10 @@ int GHOSTFS_Unlink(GHOSTFS_handle_t parent_handle,      /* IN */
    */
   if(p_object->type == GHOSTFS_DIR)
     {
-      GHOSTFS_dirlist_t *dirl;
-      GHOSTFS_dirlist_t *next;
-
-      dirl = p_object->ITEM_DIR.direntries;
-
-      while(dirl)
-        {
-          next = dirl->next;
-          Mem_Free(dirl);
-          dirl = next;
-        }
-
       p_parent->linkcount--;
 
       /* destroy the entry */
-
-      rw_lock_destroy(&p_object->entry_lock);
-      Mem_Free(p_object);
+      release_ghostfs_entry(p_object);
 
     }                           /* dir */
   else
@@ -1393,11 +1964,13 @@ int GHOSTFS_Unlink(GHOSTFS_handle_t parent_handle,      /* IN */
       if(p_object->linkcount == 0)
         {
           /* destroy the entry */
-          rw_lock_destroy(&p_object->entry_lock);
-          Mem_Free(p_object);
+          release_ghostfs_entry(p_object);
         }
       else
         {
+          /* the object has changed (linkcount) */
+          p_object->attributes.ctime = time(NULL);
+
           /* unlock the object */
           V_w(&p_object->entry_lock);
         }
@@ -1432,8 +2005,11 @@ int GHOSTFS_Rename(GHOSTFS_handle_t src_dir_handle,
   GHOSTFS_item_t *p_parent2;
   GHOSTFS_item_t *p_object1;
   GHOSTFS_item_t *p_object2;
+  GHOSTFS_item_t *p_child = NULL;
+  GHOSTFS_item_t *entries[4];
+  int nb_entries;
 
-  GHOSTFS_handle_t tmphandle, srchandle;
+  GHOSTFS_handle_t tmphandle, srchandle, checkhandle;
   int rc;
 
   int src_eq_tgt = ((src_dir_handle.inode == tgt_dir_handle.inode) &&
@@ -1450,27 +2026,26 @@ int GHOSTFS_Rename(GHOSTFS_handle_t src_dir_handle,
 
   if(!src_name)
     return ERR_GHOSTFS_ARGS;
+  if(!is_name_ok(src_name))
+    return ERR_GHOSTFS_ARGS;
   if(!tgt_name)
     return ERR_GHOSTFS_ARGS;
   if(!is_name_ok(tgt_name))
     return ERR_GHOSTFS_ARGS;
 
+  inject_delay(config.latency_meta_write, 0, 0);
+
   /* if the source directory = target directory, lock only once */
   if(src_eq_tgt)
     {
       /* get the parent and lock it for writing */
 
-      p_parent1 = GetEntry_From_Handle(src_dir_handle);
+      p_parent1 = LockEntry_From_Handle(src_dir_handle, TRUE);
       if(p_parent1 == NULL)
         return ERR_GHOSTFS_STALE;
 
-      /* check type */
-      if(p_parent1->type != GHOSTFS_DIR)
-        return ERR_GHOSTFS_NOTDIR;
-
-      P_w(&p_parent1->entry_lock);
-
       p_parent2 = p_parent1;
+      entries[0] = p_parent1;
     }
   else
     {
@@ -1482,23 +2057,30 @@ int GHOSTFS_Rename(GHOSTFS_handle_t src_dir_handle,
       if(p_parent1 == NULL || p_parent2 == NULL)
         return ERR_GHOSTFS_STALE;
 
-      /* check type */
-      if(p_parent1->type != GHOSTFS_DIR || p_parent2->type != GHOSTFS_DIR)
-        return ERR_GHOSTFS_NOTDIR;
+      /* always lock entries in the same order for avoiding deadlocks */
+      entries[0] = p_parent1;
+      entries[1] = p_parent2;
+      LockEntries_Ordered(entries, 2);
 
-      /* always lock dirs in the same order for avoiding deadlocks */
-      if(src_dir_handle.inode > tgt_dir_handle.inode)
+      /* one of them may have been removed while we were waiting */
+      if(p_parent1->magic != src_dir_handle.magic
+         || p_parent2->magic != tgt_dir_handle.magic)
         {
-          P_w(&p_parent1->entry_lock);
-          P_w(&p_parent2->entry_lock);
-        }
-      else
-        {
-          P_w(&p_parent2->entry_lock);
-          P_w(&p_parent1->entry_lock);
+          V_w(&p_parent1->entry_lock);
+          V_w(&p_parent2->entry_lock);
+          return ERR_GHOSTFS_STALE;
         }
     }
 
+  /* check type */
+  if(p_parent1->type != GHOSTFS_DIR || p_parent2->type != GHOSTFS_DIR)
+    {
+      V_w(&p_parent1->entry_lock);
+      if(!src_eq_tgt)
+        V_w(&p_parent2->entry_lock);
+      return ERR_GHOSTFS_NOTDIR;
+    }
+
   /* 1- First try looking up the source entry (check if it exists) */
 
   rc = Find_Entry(p_parent1, src_name, &srchandle);
@@ -1521,6 +2103,15 @@ int GHOSTFS_Rename(GHOSTFS_handle_t src_dir_handle,
       return ERR_GHOSTFS_STALE;
     }
 
+  /* a directory can't be moved into itself */
+  if(srchandle.inode == tgt_dir_handle.inode)
+    {
+      V_w(&p_parent1->entry_lock);
+      if(!src_eq_tgt)
+        V_w(&p_parent2->entry_lock);
+      return ERR_GHOSTFS_ARGS;
+    }
+
   /* 2- try looking up the target entry (check if it does not exist) */
 
   target_exists = FALSE;
@@ -1539,7 +2130,8 @@ int GHOSTFS_Rename(GHOSTFS_handle_t src_dir_handle,
   /* 3 - if source handle = destination handle,
    *     return attributes and do nothing.
    */
-  if((srchandle.inode == tmphandle.inode) && (tmphandle.magic == tgt_dir_handle.magic))
+  if(target_exists && (srchandle.inode == tmphandle.inode)
+     && (srchandle.magic == tmphandle.magic))
     {
       if(p_src_dir_attrs)
         fill_attributes(p_parent1, p_src_dir_attrs);
@@ -1547,13 +2139,14 @@ int GHOSTFS_Rename(GHOSTFS_handle_t src_dir_handle,
         fill_attributes(p_parent2, p_tgt_dir_attrs);
       LogFullDebug(COMPONENT_FSAL, "src=tgt");
       V_w(&p_parent1->entry_lock);
+      if(!src_eq_tgt)
+        V_w(&p_parent2->entry_lock);
       return ERR_GHOSTFS_NO_ERROR;
     }
 
-  /* 4- if the target exists it must be compatible (for removal) */
+  /* 4- get the target object */
   if(target_exists)
     {
-      /* get target object */
 
       p_object2 = GetEntry_From_Handle(tmphandle);
 
@@ -1565,9 +2158,50 @@ int GHOSTFS_Rename(GHOSTFS_handle_t src_dir_handle,
           return ERR_GHOSTFS_STALE;
         }
 
-      /* lock the target before removal */
+      /* the target is the source directory, which is not empty */
+      if(p_object2 == p_parent1)
+        {
+          V_w(&p_parent1->entry_lock);
+          if(!src_eq_tgt)
+            V_w(&p_parent2->entry_lock);
+          return (p_object1->type == GHOSTFS_DIR) ? ERR_GHOSTFS_NOTEMPTY : ERR_GHOSTFS_EXIST;
+        }
+    }
+  else
+    p_object2 = NULL;
+
+  /* 5- lock the target before removal, and the directory moved to another parent
+   *    (its '..' entry changes), in the same order as the parents.
+   */
+  nb_entries = (src_eq_tgt ? 1 : 2);
+  if(p_object2 != NULL)
+    entries[nb_entries++] = p_object2;
+  if(!src_eq_tgt && p_object1->type == GHOSTFS_DIR)
+    entries[nb_entries++] = p_child = p_object1;
+
+  /* the parents are already in entries, sorted by LockEntries_Ordered */
+  if(!RelockEntries_Ordered(entries, (src_eq_tgt ? 1 : 2), nb_entries))
+    {
+      /* the parents were unlocked meanwhile: check that the names
+       * still refer to the same objects, or start again.
+       */
+      if(p_parent1->magic != src_dir_handle.magic
+         || p_parent2->magic != tgt_dir_handle.magic
+         || Find_Entry(p_parent1, src_name, &checkhandle)
+         || checkhandle.inode != srchandle.inode || checkhandle.magic != srchandle.magic
+         || (Find_Entry(p_parent2, tgt_name, &checkhandle) == 0) != target_exists
+         || (target_exists && (checkhandle.inode != tmphandle.inode
+                               || checkhandle.magic != tmphandle.magic)))
+        {
+          UnlockEntries_Ordered(entries, nb_entries);
+          return GHOSTFS_Rename(src_dir_handle, tgt_dir_handle, src_name, tgt_name,
+                                p_src_dir_attrs, p_tgt_dir_attrs);
+        }
+    }
 
-      P_w(&p_object2->entry_lock);
+  /* 6- if the target exists it must be compatible (for removal) */
+  if(target_exists)
+    {
 
       /* check compatibility */
       LogFullDebug(COMPONENT_FSAL, "type1=%d, type2=%d, dir=%d", p_object1->type, p_object2->type,
@@ -1580,6 +2214,8 @@ int GHOSTFS_Rename(GHOSTFS_handle_t src_dir_handle,
 
           if(!is_empty_dir(p_object2))
             {
+              if(p_child != NULL)
+                V_w(&p_child->entry_lock);
               V_w(&p_object2->entry_lock);
               V_w(&p_parent1->entry_lock);
               if(!src_eq_tgt)
@@ -1589,13 +2225,12 @@ int GHOSTFS_Rename(GHOSTFS_handle_t src_dir_handle,
 
           /* compatible types, we remove the target directory */
 
-          GHOSTFS_dirlist_t *dirl;
-          GHOSTFS_dirlist_t *next;
-
           /* removes the object from the directory */
 
           if((rc = Remove_Entry(p_parent2, tgt_name)))
             {
+              if(p_child != NULL)
+                V_w(&p_child->entry_lock);
               V_w(&p_object2->entry_lock);
               V_w(&p_parent1->entry_lock);
               if(!src_eq_tgt)
@@ -1606,26 +2241,13 @@ int GHOSTFS_Rename(GHOSTFS_handle_t src_dir_handle,
           /* update parent mtime and ctime */
           p_parent2->attributes.mtime = p_parent2->attributes.ctime = time(NULL);
 
-          /* destroy '.' and '..' from the list
-           * and then the directory itself.
+          /* destroy the directory itself.
            * update parent's linkcount.
            */
 
-          dirl = p_object2->ITEM_DIR.direntries;
-
-          while(dirl)
-            {
-              next = dirl->next;
-              Mem_Free(dirl);
-              dirl = next;
-            }
-
           p_parent2->linkcount--;
 
-          /* destroy the entry */
-
-          rw_lock_destroy(&p_object2->entry_lock);
-          Mem_Free(p_object2);
+          release_ghostfs_entry(p_object2);
 
         }
       else if((p_object1->type != GHOSTFS_DIR) && (p_object2->type != GHOSTFS_DIR))
@@ -1636,6 +2258,8 @@ int GHOSTFS_Rename(GHOSTFS_handle_t src_dir_handle,
 
           if((rc = Remove_Entry(p_parent2, tgt_name)))
             {
+              if(p_child != NULL)
+                V_w(&p_child->entry_lock);
               V_w(&p_object2->entry_lock);
               V_w(&p_parent1->entry_lock);
               if(!src_eq_tgt)
@@ -1655,8 +2279,7 @@ int GHOSTFS_Rename(GHOSTFS_handle_t src_dir_handle,
           if(p_object2->linkcount == 0)
             {
               /* destroy the entry */
-              rw_lock_destroy(&p_object2->entry_lock);
-              Mem_Free(p_object2);
+              release_ghostfs_entry(p_object2);
             }
           else
             {
@@ -1668,6 +2291,8 @@ int GHOSTFS_Rename(GHOSTFS_handle_t src_dir_handle,
       else
         {
           /* incompatible types or non empty target dir, return an error */
+          if(p_child != NULL)
+            V_w(&p_child->entry_lock);
           V_w(&p_object2->entry_lock);
           V_w(&p_parent1->entry_lock);
           if(!src_eq_tgt)
@@ -1698,11 +2323,8 @@ int GHOSTFS_Rename(GHOSTFS_handle_t src_dir_handle,
       /* we must remove the directory from the source dir,
        * and put it into the new dir.
        */
-      GHOSTFS_dirlist_t *dirl;
-      GHOSTFS_dirlist_t *next;
 
-      /* lock the child directory */
-      P_w(&p_object1->entry_lock);
+      /* the child directory is locked since step 5 */
 
       /* removes the dir from the parent */
 
@@ -1766,7 +2388,6 @@ int GHOSTFS_Rename(GHOSTFS_handle_t src_dir_handle,
       if((rc = Remove_Entry(p_parent1, src_name)))
         {
           /* unexpected error !!! */
-          V_w(&p_object1->entry_lock);
           V_w(&p_parent1->entry_lock);
           V_w(&p_parent2->entry_lock);
           return ERR_GHOSTFS_INTERNAL;
@@ -1780,7 +2401,6 @@ int GHOSTFS_Rename(GHOSTFS_handle_t src_dir_handle,
       if((rc = Add_Dir_Entry(p_parent2, srchandle, tgt_name)))
         {
           /* unexpected error !!! */
-          V_w(&p_object1->entry_lock);
           V_w(&p_parent1->entry_lock);
           V_w(&p_parent2->entry_lock);
           return ERR_GHOSTFS_INTERNAL;
@@ -306,6 +306,8 @@ void usage(char *cmd)
   fprintf(stderr, "         test access on a file for a given couple (uid,gid).\n");
   fprintf(stderr, "  %s -mkdir <dir_name> <owner> <group>\n", cmd);
   fprintf(stderr, "         create a directory with the specified owner.\n");
+  fprintf(stderr, "  %s -data <file_name> <nb_files> <file_size>\n", cmd);
+  fprintf(stderr, "         write, read back, truncate and remove sparse files.\n");
 
 }
 
@@ -433,6 +435,119 @@ void launch_mkdir(char *name, int uid, int gid)
 
 }
 
+/* checks that a range of a file holds the expected pattern (0 for holes) */
+void check_data(GHOSTFS_handle_t handle, GHOSTFS_size_t offset, GHOSTFS_size_t size,
+                int pattern)
+{
+  char *buffer;
+  GHOSTFS_size_t read_size, i;
+  int eof, rc;
+
+  if((buffer = malloc(size)) == NULL)
+    Exit(ERR_GHOSTFS_MALLOC, "malloc");
+
+  if(rc = GHOSTFS_Read(handle, offset, size, buffer, &read_size, &eof))
+    Exit(rc, "GHOSTFS_Read");
+
+  if(read_size != size)
+    {
+      fprintf(stderr, "Short read at %llu: %llu instead of %llu\n", offset, read_size, size);
+      exit(-1);
+    }
+
+  for(i = 0; i < size; i++)
+    if(buffer[i] != (char)pattern)
+      {
+        fprintf(stderr, "Bad data at offset %llu: %d instead of %d\n", offset + i,
+                buffer[i], pattern);
+        exit(-1);
+      }
+
+  free(buffer);
+}
+
+void launch_data(char *name, int nb_files, GHOSTFS_size_t file_size)
+{
+  GHOSTFS_handle_t root_handle, file_handle;
+  GHOSTFS_Attrs_t attrs;
+  GHOSTFS_size_t written, read_size;
+  char file_name[GHOSTFS_MAX_FILENAME];
+  char *buffer;
+  int i, eof, rc;
+
+  if((buffer = malloc(file_size)) == NULL)
+    Exit(ERR_GHOSTFS_MALLOC, "malloc");
+
+  /* get root handle */
+  if(rc = GHOSTFS_GetRoot(&root_handle))
+    Exit(rc, "GHOSTFS_GetRoot");
+
+  for(i = 0; i < nb_files; i++)
+    {
+      snprintf(file_name, GHOSTFS_MAX_FILENAME, "%s.%d", name, i);
+
+      if(rc = GHOSTFS_Create(root_handle, file_name, 0, 0, 0644, &file_handle, NULL))
+        Exit(rc, "GHOSTFS_Create");
+
+      /* the first half of the file is a hole */
+      memset(buffer, 'a' + i % 26, file_size);
+
+      if(rc = GHOSTFS_Write(file_handle, file_size, file_size, buffer, &written, &attrs))
+        Exit(rc, "GHOSTFS_Write");
+
+      if(written != file_size || attrs.size != 2 * file_size)
+        {
+          fprintf(stderr, "Bad write: %llu bytes written, size=%llu\n", written, attrs.size);
+          exit(-1);
+        }
+
+      check_data(file_handle, 0, file_size, 0);
+      check_data(file_handle, file_size, file_size, 'a' + i % 26);
+
+      /* reading beyond the end of file */
+      if(rc = GHOSTFS_Read(file_handle, 2 * file_size, file_size, buffer, &read_size, &eof))
+        Exit(rc, "GHOSTFS_Read");
+
+      if(read_size != 0 || !eof)
+        {
+          fprintf(stderr, "Read beyond EOF returned %llu bytes, eof=%d\n", read_size, eof);
+          exit(-1);
+        }
+
+      /* shrink then extend: the truncated part must read as zeros */
+      if(rc = GHOSTFS_Truncate(file_handle, file_size + file_size / 2, NULL))
+        Exit(rc, "GHOSTFS_Truncate");
+      if(rc = GHOSTFS_Truncate(file_handle, 2 * file_size, &attrs))
+        Exit(rc, "GHOSTFS_Truncate");
+
+      check_data(file_handle, file_size, file_size / 2, 'a' + i % 26);
+      check_data(file_handle, file_size + file_size / 2, file_size - file_size / 2, 0);
+
+      printf("%s: size=%llu spaceused=%llu\n", file_name, attrs.size, attrs.spaceused);
+    }
+
+  printf("\nFilesystem content :\n");
+  print_dir_rec(stdout, root_handle, "", 0);
+
+  for(i = 0; i < nb_files; i++)
+    {
+      snprintf(file_name, GHOSTFS_MAX_FILENAME, "%s.%d", name, i);
+
+      if(rc = GHOSTFS_Unlink(root_handle, file_name, NULL))
+        Exit(rc, "GHOSTFS_Unlink");
+    }
+
+  /* the handle of a removed file is stale */
+  if((rc = GHOSTFS_Read(file_handle, 0, file_size, buffer, &read_size, &eof))
+     != ERR_GHOSTFS_STALE)
+    Exit(rc, "GHOSTFS_Read on a removed file");
+
+  printf("\nFilesystem content after removal :\n");
+  print_dir_rec(stdout, root_handle, "", 0);
+
+  free(buffer);
+}
+
 static GHOSTFS_parameter_t config_ghostfs = {
   .root_mode = 0755,
   .root_owner = 0,
@@ -449,7 +564,8 @@ int main(int argc, char **argv)
     ACTION_NULL,
     ACTION_LS,
     ACTION_ACCES,
-    ACTION_MKDIR
+    ACTION_MKDIR,
+    ACTION_DATA
   } action_t;
 
   action_t action = ACTION_NULL;
@@ -473,6 +589,8 @@ int main(int argc, char **argv)
         action = ACTION_LS;
       else if(!strcmp(argv[1], "-mkdir"))
         action = ACTION_MKDIR;
+      else if(!strcmp(argv[1], "-data"))
+        action = ACTION_DATA;
     }
 
   if((action == ACTION_ACCES || action == ACTION_MKDIR) && (argc == 5))
@@ -496,6 +614,12 @@ int main(int argc, char **argv)
         }
       gid = atoi(str_gid);
 
+    }
+  else if((action == ACTION_DATA) && (argc == 5) && is_num(argv[3]) && is_num(argv[4]))
+    {
+
+      lookup_path = argv[2];
+
     }
   else if((action == ACTION_LS) && (argc == 4))
     {
@@ -532,6 +656,10 @@ int main(int argc, char **argv)
     case ACTION_MKDIR:
       launch_mkdir(lookup_path, uid, gid);
       break;
+
+    case ACTION_DATA:
+      launch_data(lookup_path, atoi(argv[3]), strtoull(argv[4], NULL, 10));
+      break;
     }
 
   exit(0);
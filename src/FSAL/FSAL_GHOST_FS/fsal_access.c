@@ -56,10 +56,10 @@
  *        - ERR_FSAL_IO           (corrupted FS)
  *        - ERR_FSAL_SERVERFAULT  (unexpected error)
  */
-fsal_status_t FSAL_access(fsal_handle_t * object_handle,        /* IN */
-                          fsal_op_context_t * p_context,        /* IN */
-                          fsal_accessflags_t access_type,       /* IN */
-                          fsal_attrib_list_t * object_attributes        /* [ IN/OUT ] */
+fsal_status_t GHOSTFSAL_access(fsal_handle_t * object_handle,        /* IN */
+                               fsal_op_context_t * p_context,        /* IN */
+                               fsal_accessflags_t access_type,       /* IN */
+                               fsal_attrib_list_t * object_attributes        /* [ IN/OUT ] */
     )
 {
 
@@ -32,9 +32,9 @@
  *        - ERR_FSAL_NOT_INIT     (ghostfs not initialize)
  *        - ERR_FSAL_SERVERFAULT  (unexpected error)
  */
-fsal_status_t FSAL_getattrs(fsal_handle_t * filehandle, /* IN */
-                            fsal_op_context_t * p_context,      /* IN */
-                            fsal_attrib_list_t * object_attributes      /* IN/OUT */
+fsal_status_t GHOSTFSAL_getattrs(fsal_handle_t * filehandle, /* IN */
+                                 fsal_op_context_t * p_context,      /* IN */
+                                 fsal_attrib_list_t * object_attributes      /* IN/OUT */
     )
 {
 
@@ -84,10 +84,10 @@ fsal_status_t FSAL_getattrs(fsal_handle_t * filehandle, /* IN */
 
 }
 
-fsal_status_t FSAL_setattrs(fsal_handle_t * filehandle, /* IN */
-                            fsal_op_context_t * p_context,      /* IN */
-                            fsal_attrib_list_t * attrib_set,    /* IN */
-                            fsal_attrib_list_t * object_attributes      /* [ IN/OUT ] */
+fsal_status_t GHOSTFSAL_setattrs(fsal_handle_t * filehandle, /* IN */
+                                 fsal_op_context_t * p_context,      /* IN */
+                                 fsal_attrib_list_t * attrib_set,    /* IN */
+                                 fsal_attrib_list_t * object_attributes      /* [ IN/OUT ] */
     )
 {
   GHOSTFS_setattr_mask_t set_mask = 0;
@@ -207,9 +207,9 @@ fsal_status_t FSAL_setattrs(fsal_handle_t * filehandle, /* IN */
  *        - ERR_FSAL_NO_ERROR     (no error)
  *        - Another error code if an error occured.
  */
-fsal_status_t FSAL_getextattrs(fsal_handle_t * p_filehandle, /* IN */
-                               fsal_op_context_t * p_context,        /* IN */
-                               fsal_extattrib_list_t * p_object_attributes /* OUT */
+fsal_status_t GHOSTFSAL_getextattrs(fsal_handle_t * p_filehandle, /* IN */
+                                    fsal_op_context_t * p_context,        /* IN */
+                                    fsal_extattrib_list_t * p_object_attributes /* OUT */
     )
 {
   Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_getextattrs);
@@ -0,0 +1,124 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ */
+
+/**
+ * \file    fsal_compat.c
+ * \brief   FSAL glue functions
+ *
+ * GHOST_FS is only built in the FSAL non shared mode, where the generic
+ * FSAL types are the GHOST_FS ones: the functions are given to the glue
+ * layer as they are, with no wrapper.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fsal.h"
+#include "fsal_types.h"
+#include "fsal_glue.h"
+#include "fsal_internal.h"
+
+fsal_functions_t fsal_ghostfs_functions = {
+  .fsal_access = GHOSTFSAL_access,
+  .fsal_getattrs = GHOSTFSAL_getattrs,
+  .fsal_getattrs_descriptor = NULL,
+  .fsal_setattrs = GHOSTFSAL_setattrs,
+  .fsal_buildexportcontext = GHOSTFSAL_BuildExportContext,
+  .fsal_cleanupexportcontext = GHOSTFSAL_CleanUpExportContext,
+  .fsal_initclientcontext = GHOSTFSAL_InitClientContext,
+  .fsal_getclientcontext = GHOSTFSAL_GetClientContext,
+  .fsal_create = GHOSTFSAL_create,
+  .fsal_mkdir = GHOSTFSAL_mkdir,
+  .fsal_link = GHOSTFSAL_link,
+  .fsal_mknode = GHOSTFSAL_mknode,
+  .fsal_opendir = GHOSTFSAL_opendir,
+  .fsal_readdir = GHOSTFSAL_readdir,
+  .fsal_closedir = GHOSTFSAL_closedir,
+  .fsal_open_by_name = GHOSTFSAL_open_by_name,
+  .fsal_open = GHOSTFSAL_open,
+  .fsal_read = GHOSTFSAL_read,
+  .fsal_write = GHOSTFSAL_write,
+  .fsal_close = GHOSTFSAL_close,
+  .fsal_open_by_fileid = GHOSTFSAL_open_by_fileid,
+  .fsal_close_by_fileid = GHOSTFSAL_close_by_fileid,
+  .fsal_static_fsinfo = GHOSTFSAL_static_fsinfo,
+  .fsal_dynamic_fsinfo = GHOSTFSAL_dynamic_fsinfo,
+  .fsal_init = GHOSTFSAL_Init,
+  .fsal_terminate = GHOSTFSAL_terminate,
+  .fsal_test_access = GHOSTFSAL_test_access,
+  .fsal_setattr_access = GHOSTFSAL_setattr_access,
+  .fsal_rename_access = GHOSTFSAL_rename_access,
+  .fsal_create_access = GHOSTFSAL_create_access,
+  .fsal_unlink_access = GHOSTFSAL_unlink_access,
+  .fsal_link_access = GHOSTFSAL_link_access,
+  .fsal_merge_attrs = GHOSTFSAL_merge_attrs,
+  .fsal_lookup = GHOSTFSAL_lookup,
+  .fsal_lookuppath = GHOSTFSAL_lookupPath,
+  .fsal_lookupjunction = GHOSTFSAL_lookupJunction,
+  .fsal_lock = GHOSTFSAL_lock,
+  .fsal_changelock = GHOSTFSAL_changelock,
+  .fsal_unlock = GHOSTFSAL_unlock,
+  .fsal_getlock = GHOSTFSAL_getlock,
+  .fsal_cleanobjectresources = GHOSTFSAL_CleanObjectResources,
+  .fsal_set_quota = GHOSTFSAL_set_quota,
+  .fsal_get_quota = GHOSTFSAL_get_quota,
+  .fsal_rcp = GHOSTFSAL_rcp,
+  .fsal_rcp_by_fileid = GHOSTFSAL_rcp_by_fileid,
+  .fsal_rename = GHOSTFSAL_rename,
+  .fsal_get_stats = GHOSTFSAL_get_stats,
+  .fsal_readlink = GHOSTFSAL_readlink,
+  .fsal_symlink = GHOSTFSAL_symlink,
+  .fsal_handlecmp = GHOSTFSAL_handlecmp,
+  .fsal_handle_to_hashindex = GHOSTFSAL_Handle_to_HashIndex,
+  .fsal_handle_to_rbtindex = GHOSTFSAL_Handle_to_RBTIndex,
+  .fsal_handle_to_hash_both = NULL,
+  .fsal_digesthandle = GHOSTFSAL_DigestHandle,
+  .fsal_expandhandle = GHOSTFSAL_ExpandHandle,
+  .fsal_setdefault_fsal_parameter = GHOSTFSAL_SetDefault_FSAL_parameter,
+  .fsal_setdefault_fs_common_parameter = GHOSTFSAL_SetDefault_FS_common_parameter,
+  .fsal_setdefault_fs_specific_parameter = GHOSTFSAL_SetDefault_FS_specific_parameter,
+  .fsal_load_fsal_parameter_from_conf = GHOSTFSAL_load_FSAL_parameter_from_conf,
+  .fsal_load_fs_common_parameter_from_conf = GHOSTFSAL_load_FS_common_parameter_from_conf,
+  .fsal_load_fs_specific_parameter_from_conf = GHOSTFSAL_load_FS_specific_parameter_from_conf,
+  .fsal_truncate = GHOSTFSAL_truncate,
+  .fsal_unlink = GHOSTFSAL_unlink,
+  .fsal_getfsname = GHOSTFSAL_GetFSName,
+  .fsal_getxattrattrs = GHOSTFSAL_GetXAttrAttrs,
+  .fsal_listxattrs = GHOSTFSAL_ListXAttrs,
+  .fsal_getxattrvaluebyid = GHOSTFSAL_GetXAttrValueById,
+  .fsal_getxattridbyname = GHOSTFSAL_GetXAttrIdByName,
+  .fsal_getxattrvaluebyname = GHOSTFSAL_GetXAttrValueByName,
+  .fsal_setxattrvalue = GHOSTFSAL_SetXAttrValue,
+  .fsal_setxattrvaluebyid = GHOSTFSAL_SetXAttrValueById,
+  .fsal_removexattrbyid = GHOSTFSAL_RemoveXAttrById,
+  .fsal_removexattrbyname = GHOSTFSAL_RemoveXAttrByName,
+  .fsal_getextattrs = GHOSTFSAL_getextattrs,
+  .fsal_getfileno = GHOSTFSAL_GetFileno,
+  .fsal_sync = GHOSTFSAL_sync,
+  .fsal_readv = NULL,
+  .fsal_writev = NULL
+};
+
+fsal_const_t fsal_ghostfs_consts = {
+  .fsal_handle_t_size = sizeof(fsal_handle_t),
+  .fsal_op_context_t_size = sizeof(fsal_op_context_t),
+  .fsal_export_context_t_size = sizeof(fsal_export_context_t),
+  .fsal_file_t_size = sizeof(fsal_file_t),
+  .fsal_cookie_t_size = sizeof(fsal_cookie_t),
+  .fsal_lockdesc_t_size = sizeof(fsal_lockdesc_t),
+  .fsal_cred_t_size = sizeof(fsal_cred_t),
+  .fs_specific_initinfo_t_size = sizeof(fs_specific_initinfo_t),
+  .fsal_dir_t_size = sizeof(fsal_dir_t)
+};
+
+fsal_functions_t FSAL_GetFunctions(void)
+{
+  return fsal_ghostfs_functions;
+}                               /* FSAL_GetFunctions */
+
+fsal_const_t FSAL_GetConsts(void)
+{
+  return fsal_ghostfs_consts;
+}                               /* FSAL_GetConsts */
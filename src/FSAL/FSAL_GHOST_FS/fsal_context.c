@@ -31,9 +31,9 @@
  * Parse FS specific option string
  * to build the export entry option.
  */
-fsal_status_t FSAL_BuildExportContext(fsal_export_context_t * p_export_context, /* OUT */
-                                      fsal_path_t * p_export_path,      /* IN */
-                                      char *fs_specific_options /* IN */
+fsal_status_t GHOSTFSAL_BuildExportContext(fsal_export_context_t * p_export_context, /* OUT */
+                                           fsal_path_t * p_export_path,      /* IN */
+                                           char *fs_specific_options /* IN */
     )
 {
   SetFuncID(INDEX_FSAL_BuildExportContext);
@@ -42,7 +42,17 @@ fsal_status_t FSAL_BuildExportContext(fsal_export_context_t * p_export_context,
   Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_BuildExportContext);
 }
 
-fsal_status_t FSAL_InitClientContext(fsal_op_context_t * p_thr_context)
+/**
+ * FSAL_CleanUpExportContext :
+ * this will clean up and state in an export that was created during
+ * the BuildExportContext phase. Nothing to do for GHOST_FS.
+ */
+fsal_status_t GHOSTFSAL_CleanUpExportContext(fsal_export_context_t * p_export_context)
+{
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_CleanUpExportContext);
+}
+
+fsal_status_t GHOSTFSAL_InitClientContext(fsal_op_context_t * p_thr_context)
 {
   SetFuncID(INDEX_FSAL_InitClientContext);
 
@@ -65,12 +75,12 @@ fsal_status_t FSAL_InitClientContext(fsal_op_context_t * p_thr_context)
  * FSAL_GetClientContext :
  * Get a user credential from its uid.
  */
-fsal_status_t FSAL_GetClientContext(fsal_op_context_t * p_thr_context,  /* IN/OUT  */
-                                    fsal_export_context_t * p_export_context,   /* IN */
-                                    fsal_uid_t uid,     /* IN */
-                                    fsal_gid_t gid,     /* IN */
-                                    fsal_gid_t * alt_groups,    /* IN */
-                                    fsal_count_t nb_alt_groups  /* IN */
+fsal_status_t GHOSTFSAL_GetClientContext(fsal_op_context_t * p_thr_context,  /* IN/OUT  */
+                                         fsal_export_context_t * p_export_context,   /* IN */
+                                         fsal_uid_t uid,     /* IN */
+                                         fsal_gid_t gid,     /* IN */
+                                         fsal_gid_t * alt_groups,    /* IN */
+                                         fsal_count_t nb_alt_groups  /* IN */
     )
 {
   SetFuncID(INDEX_FSAL_GetClientContext);
@@ -230,6 +230,8 @@ int ghost2fsal_error(int code)
       return ERR_FSAL_EXIST;
     case ERR_GHOSTFS_NOTEMPTY:
       return ERR_FSAL_NOTEMPTY;
+    case ERR_GHOSTFS_FBIG:
+      return ERR_FSAL_FBIG;
 
     case ERR_GHOSTFS_ACCES:
       return ERR_FSAL_ACCESS;
@@ -245,6 +247,8 @@ int ghost2fsal_error(int code)
       return ERR_FSAL_ATTRNOTSUPP;
     case ERR_GHOSTFS_ARGS:
       return ERR_FSAL_INVAL;
+    case ERR_GHOSTFS_NOTFILE:
+      return ERR_FSAL_INVAL;
 
     case ERR_GHOSTFS_CORRUPT:
     case ERR_GHOSTFS_INTERNAL:
@@ -317,7 +321,7 @@ int ghost2fsal_attrs(fsal_attrib_list_t * p_fsal_attrs, GHOSTFS_Attrs_t * p_ghos
     }
   if(FSAL_TEST_MASK(p_fsal_attrs->asked_attributes, FSAL_ATTR_SPACEUSED))
     {
-      p_fsal_attrs->spaceused = p_ghost_attrs->size;
+      p_fsal_attrs->spaceused = p_ghost_attrs->spaceused;
     }
   if(FSAL_TEST_MASK(p_fsal_attrs->asked_attributes, FSAL_ATTR_CHGTIME))
     {
@@ -19,12 +19,12 @@
 #include "fsal_internal.h"
 #include "fsal_convertions.h"
 
-fsal_status_t FSAL_create(fsal_handle_t * parent_directory_handle,      /* IN */
-                          fsal_name_t * p_filename,     /* IN */
-                          fsal_op_context_t * p_context,        /* IN */
-                          fsal_accessmode_t accessmode, /* IN */
-                          fsal_handle_t * object_handle,        /* OUT */
-                          fsal_attrib_list_t * object_attributes        /* [ IN/OUT ] */
+fsal_status_t GHOSTFSAL_create(fsal_handle_t * parent_directory_handle,      /* IN */
+                               fsal_name_t * p_filename,     /* IN */
+                               fsal_op_context_t * p_context,        /* IN */
+                               fsal_accessmode_t accessmode, /* IN */
+                               fsal_handle_t * object_handle,        /* OUT */
+                               fsal_attrib_list_t * object_attributes        /* [ IN/OUT ] */
     )
 {
 
@@ -72,12 +72,12 @@ fsal_status_t FSAL_create(fsal_handle_t * parent_directory_handle,      /* IN */
   Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_create);
 }
 
-fsal_status_t FSAL_mkdir(fsal_handle_t * parent_directory_handle,       /* IN */
-                         fsal_name_t * p_dirname,       /* IN */
-                         fsal_op_context_t * p_context, /* IN */
-                         fsal_accessmode_t accessmode,  /* IN */
-                         fsal_handle_t * object_handle, /* OUT */
-                         fsal_attrib_list_t * object_attributes /* [ IN/OUT ] */
+fsal_status_t GHOSTFSAL_mkdir(fsal_handle_t * parent_directory_handle,       /* IN */
+                              fsal_name_t * p_dirname,       /* IN */
+                              fsal_op_context_t * p_context, /* IN */
+                              fsal_accessmode_t accessmode,  /* IN */
+                              fsal_handle_t * object_handle, /* OUT */
+                              fsal_attrib_list_t * object_attributes /* [ IN/OUT ] */
     )
 {
 
@@ -126,11 +126,11 @@ fsal_status_t FSAL_mkdir(fsal_handle_t * parent_directory_handle,       /* IN */
 
 }
 
-fsal_status_t FSAL_link(fsal_handle_t * target_handle,  /* IN */
-                        fsal_handle_t * dir_handle,     /* IN */
-                        fsal_name_t * p_link_name,      /* IN */
-                        fsal_op_context_t * p_context,  /* IN */
-                        fsal_attrib_list_t * attributes /* [ IN/OUT ] */
+fsal_status_t GHOSTFSAL_link(fsal_handle_t * target_handle,  /* IN */
+                             fsal_handle_t * dir_handle,     /* IN */
+                             fsal_name_t * p_link_name,      /* IN */
+                             fsal_op_context_t * p_context,  /* IN */
+                             fsal_attrib_list_t * attributes /* [ IN/OUT ] */
     )
 {
 
@@ -172,14 +172,14 @@ fsal_status_t FSAL_link(fsal_handle_t * target_handle,  /* IN */
 
 }
 
-fsal_status_t FSAL_mknode(fsal_handle_t * parentdir_handle,     /* IN */
-                          fsal_name_t * p_node_name,    /* IN */
-                          fsal_op_context_t * p_context,        /* IN */
-                          fsal_accessmode_t accessmode, /* IN */
-                          fsal_nodetype_t nodetype,     /* IN */
-                          fsal_dev_t * dev,     /* IN */
-                          fsal_handle_t * p_object_handle,      /* OUT (handle to the created node) */
-                          fsal_attrib_list_t * node_attributes  /* [ IN/OUT ] */
+fsal_status_t GHOSTFSAL_mknode(fsal_handle_t * parentdir_handle,     /* IN */
+                               fsal_name_t * p_node_name,    /* IN */
+                               fsal_op_context_t * p_context,        /* IN */
+                               fsal_accessmode_t accessmode, /* IN */
+                               fsal_nodetype_t nodetype,     /* IN */
+                               fsal_dev_t * dev,     /* IN */
+                               fsal_handle_t * p_object_handle,      /* OUT (handle to the created node) */
+                               fsal_attrib_list_t * node_attributes  /* [ IN/OUT ] */
     )
 {
 
@@ -37,10 +37,10 @@
  *         May be NULL.
  * 
  */
-fsal_status_t FSAL_opendir(fsal_handle_t * dir_handle,  /* IN */
-                           fsal_op_context_t * p_context,       /* IN */
-                           fsal_dir_t * dir_descriptor, /* OUT */
-                           fsal_attrib_list_t * dir_attributes  /* [ IN/OUT ] */
+fsal_status_t GHOSTFSAL_opendir(fsal_handle_t * dir_handle,  /* IN */
+                                fsal_op_context_t * p_context,       /* IN */
+                                fsal_dir_t * dir_descriptor, /* OUT */
+                                fsal_attrib_list_t * dir_attributes  /* [ IN/OUT ] */
     )
 {
   int rc;
@@ -103,14 +103,14 @@ fsal_status_t FSAL_opendir(fsal_handle_t * dir_handle,  /* IN */
 
 }
 
-fsal_status_t FSAL_readdir(fsal_dir_t * dir_descriptor, /* IN */
-                           fsal_cookie_t start_position,        /* IN */
-                           fsal_attrib_mask_t get_attr_mask,    /* IN */
-                           fsal_mdsize_t buffersize,    /* IN */
-                           fsal_dirent_t * pdirent,     /* OUT */
-                           fsal_cookie_t * end_position,        /* OUT */
-                           fsal_count_t * nb_entries,   /* OUT */
-                           fsal_boolean_t * end_of_dir  /* OUT */
+fsal_status_t GHOSTFSAL_readdir(fsal_dir_t * dir_descriptor, /* IN */
+                                fsal_cookie_t start_position,        /* IN */
+                                fsal_attrib_mask_t get_attr_mask,    /* IN */
+                                fsal_mdsize_t buffersize,    /* IN */
+                                fsal_dirent_t * pdirent,     /* OUT */
+                                fsal_cookie_t * end_position,        /* OUT */
+                                fsal_count_t * nb_entries,   /* OUT */
+                                fsal_boolean_t * end_of_dir  /* OUT */
     )
 {
   int rc;
@@ -212,7 +212,7 @@ fsal_status_t FSAL_readdir(fsal_dir_t * dir_descriptor, /* IN */
 
 }
 
-fsal_status_t FSAL_closedir(fsal_dir_t * dir_descriptor /* IN */
+fsal_status_t GHOSTFSAL_closedir(fsal_dir_t * dir_descriptor /* IN */
     )
 {
 
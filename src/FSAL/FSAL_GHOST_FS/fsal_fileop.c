@@ -17,6 +17,44 @@
 
 #include "fsal.h"
 #include "fsal_internal.h"
+#include "fsal_convertions.h"
+#include <string.h>
+
+/* computes the position of an I/O from a seek descriptor */
+static int ghostfs_seek(fsal_file_t * file_descriptor,
+                        fsal_seek_t * seek_descriptor, GHOSTFS_size_t * p_offset)
+{
+  GHOSTFS_Attrs_t ghost_attrs;
+  fsal_off_t base;
+  int rc;
+
+  switch (seek_descriptor->whence)
+    {
+    case FSAL_SEEK_SET:
+      base = 0;
+      break;
+
+    case FSAL_SEEK_CUR:
+      base = file_descriptor->current_offset;
+      break;
+
+    case FSAL_SEEK_END:
+      if((rc = GHOSTFS_GetAttrs(file_descriptor->handle, &ghost_attrs)))
+        return rc;
+      base = ghost_attrs.size;
+      break;
+
+    default:
+      return ERR_GHOSTFS_ARGS;
+    }
+
+  if(base + seek_descriptor->offset < 0)
+    return ERR_GHOSTFS_ARGS;
+
+  *p_offset = base + seek_descriptor->offset;
+
+  return ERR_GHOSTFS_NO_ERROR;
+}
 
 /**
  * FSAL_open_byname:
@@ -57,12 +95,12 @@
  *        ERR_FSAL_IO, ...
  */
 
-fsal_status_t FSAL_open_by_name(fsal_handle_t * dirhandle,      /* IN */
-                                fsal_name_t * filename, /* IN */
-                                fsal_op_context_t * p_context,  /* IN */
-                                fsal_openflags_t openflags,     /* IN */
-                                fsal_file_t * file_descriptor,  /* OUT */
-                                fsal_attrib_list_t * file_attributes /* [ IN/OUT ] */ )
+fsal_status_t GHOSTFSAL_open_by_name(fsal_handle_t * dirhandle,      /* IN */
+                                     fsal_name_t * filename, /* IN */
+                                     fsal_op_context_t * p_context,  /* IN */
+                                     fsal_openflags_t openflags,     /* IN */
+                                     fsal_file_t * file_descriptor,  /* OUT */
+                                     fsal_attrib_list_t * file_attributes /* [ IN/OUT ] */ )
 {
   fsal_status_t fsal_status;
   fsal_handle_t filehandle;
@@ -77,22 +115,24 @@ fsal_status_t FSAL_open_by_name(fsal_handle_t * dirhandle,      /* IN */
   return FSAL_open(&filehandle, p_context, openflags, file_descriptor, file_attributes);
 }
 
-fsal_status_t FSAL_rcp_by_fileid(fsal_handle_t * filehandle,    /* IN */
-                                 fsal_u64_t fileid,     /* IN */
-                                 fsal_op_context_t * p_context, /* IN */
-                                 fsal_path_t * p_local_path,    /* IN */
-                                 fsal_rcpflag_t transfer_opt /* IN */ )
+fsal_status_t GHOSTFSAL_rcp_by_fileid(fsal_handle_t * filehandle,    /* IN */
+                                      fsal_u64_t fileid,     /* IN */
+                                      fsal_op_context_t * p_context, /* IN */
+                                      fsal_path_t * p_local_path,    /* IN */
+                                      fsal_rcpflag_t transfer_opt /* IN */ )
 {
   Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_open_by_fileid);
 }
 
-fsal_status_t FSAL_open(fsal_handle_t * filehandle,     /* IN */
-                        fsal_op_context_t * p_context,  /* IN */
-                        fsal_openflags_t openflags,     /* IN */
-                        fsal_file_t * file_descriptor,  /* OUT */
-                        fsal_attrib_list_t * file_attributes    /* [ IN/OUT ] */
+fsal_status_t GHOSTFSAL_open(fsal_handle_t * filehandle,     /* IN */
+                             fsal_op_context_t * p_context,  /* IN */
+                             fsal_openflags_t openflags,     /* IN */
+                             fsal_file_t * file_descriptor,  /* OUT */
+                             fsal_attrib_list_t * file_attributes    /* [ IN/OUT ] */
     )
 {
+  GHOSTFS_Attrs_t ghost_attrs;
+  int rc;
 
   /* For logging */
   SetFuncID(INDEX_FSAL_open);
@@ -103,18 +143,69 @@ fsal_status_t FSAL_open(fsal_handle_t * filehandle,     /* IN */
   if(!filehandle || !p_context || !file_descriptor)
     Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_open);
 
-  Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_open);
+  /* flags conflicts. */
+  if((openflags & FSAL_O_RDONLY)
+     && (openflags & (FSAL_O_RDWR | FSAL_O_WRONLY | FSAL_O_APPEND | FSAL_O_TRUNC)))
+    {
+      LogEvent(COMPONENT_FSAL, "Invalid/conflicting flags : %#X", openflags);
+      Return(ERR_FSAL_INVAL, 0, INDEX_FSAL_open);
+    }
+
+  rc = GHOSTFS_GetAttrs((GHOSTFS_handle_t) (*filehandle), &ghost_attrs);
+  if(rc)
+    Return(ghost2fsal_error(rc), rc, INDEX_FSAL_open);
+
+  if(ghost_attrs.type != GHOSTFS_FILE)
+    Return(ERR_FSAL_INVAL, 0, INDEX_FSAL_open);
+
+  /* GHOSTFS_Access succeeds if any of the tested rights is granted,
+   * so test them one by one.
+   */
+  if(openflags & (FSAL_O_RDONLY | FSAL_O_RDWR))
+    {
+      rc = GHOSTFS_Access((GHOSTFS_handle_t) (*filehandle), GHOSTFS_TEST_READ,
+                          p_context->credential.user, p_context->credential.group);
+      if(rc)
+        Return(ghost2fsal_error(rc), rc, INDEX_FSAL_open);
+    }
+
+  if(openflags & (FSAL_O_RDWR | FSAL_O_WRONLY | FSAL_O_APPEND | FSAL_O_TRUNC))
+    {
+      rc = GHOSTFS_Access((GHOSTFS_handle_t) (*filehandle), GHOSTFS_TEST_WRITE,
+                          p_context->credential.user, p_context->credential.group);
+      if(rc)
+        Return(ghost2fsal_error(rc), rc, INDEX_FSAL_open);
+    }
+
+  if(openflags & FSAL_O_TRUNC)
+    {
+      rc = GHOSTFS_Truncate((GHOSTFS_handle_t) (*filehandle), 0, &ghost_attrs);
+      if(rc)
+        Return(ghost2fsal_error(rc), rc, INDEX_FSAL_open);
+    }
+
+  file_descriptor->handle = *filehandle;
+  file_descriptor->openflags = openflags;
+  file_descriptor->current_offset = 0;
+
+  /* output attributes */
+  if(file_attributes)
+    ghost2fsal_attrs(file_attributes, &ghost_attrs);
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_open);
 
 }
 
-fsal_status_t FSAL_read(fsal_file_t * file_descriptor,  /* IN */
-                        fsal_seek_t * seek_descriptor,  /* IN */
-                        fsal_size_t buffer_size,        /* IN */
-                        caddr_t buffer, /* OUT */
-                        fsal_size_t * read_amount,      /* OUT */
-                        fsal_boolean_t * end_of_file    /* OUT */
+fsal_status_t GHOSTFSAL_read(fsal_file_t * file_descriptor,  /* IN */
+                             fsal_seek_t * seek_descriptor,  /* IN */
+                             fsal_size_t buffer_size,        /* IN */
+                             caddr_t buffer, /* OUT */
+                             fsal_size_t * read_amount,      /* OUT */
+                             fsal_boolean_t * end_of_file    /* OUT */
     )
 {
+  GHOSTFS_size_t offset, read_size;
+  int eof, rc;
 
   /* For logging */
   SetFuncID(INDEX_FSAL_read);
@@ -123,17 +214,36 @@ fsal_status_t FSAL_read(fsal_file_t * file_descriptor,  /* IN */
   if(!file_descriptor || !seek_descriptor || !buffer || !read_amount || !end_of_file)
     Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_read);
 
-  Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_read);
+  if(file_descriptor->openflags & FSAL_O_WRONLY)
+    Return(ERR_FSAL_PERM, 0, INDEX_FSAL_read);
+
+  if((rc = ghostfs_seek(file_descriptor, seek_descriptor, &offset)))
+    Return(ghost2fsal_error(rc), rc, INDEX_FSAL_read);
+
+  rc = GHOSTFS_Read(file_descriptor->handle, offset, buffer_size, buffer,
+                    &read_size, &eof);
+  if(rc)
+    Return(ghost2fsal_error(rc), rc, INDEX_FSAL_read);
+
+  file_descriptor->current_offset = offset + read_size;
+
+  *read_amount = read_size;
+  *end_of_file = (eof ? TRUE : FALSE);
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_read);
 
 }
 
-fsal_status_t FSAL_write(fsal_file_t * file_descriptor, /* IN */
-                         fsal_seek_t * seek_descriptor, /* IN */
-                         fsal_size_t buffer_size,       /* IN */
-                         caddr_t buffer,        /* IN */
-                         fsal_size_t * write_amount     /* OUT */
+fsal_status_t GHOSTFSAL_write(fsal_file_t * file_descriptor, /* IN */
+                              fsal_seek_t * seek_descriptor, /* IN */
+                              fsal_size_t buffer_size,       /* IN */
+                              caddr_t buffer,        /* IN */
+                              fsal_size_t * write_amount     /* OUT */
     )
 {
+  GHOSTFS_size_t offset, written_size;
+  fsal_seek_t end_of_file = { FSAL_SEEK_END, 0 };
+  int rc;
 
   /* For logging */
   SetFuncID(INDEX_FSAL_write);
@@ -142,10 +252,29 @@ fsal_status_t FSAL_write(fsal_file_t * file_descriptor, /* IN */
   if(!file_descriptor || !seek_descriptor || !buffer || !write_amount)
     Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_write);
 
-  Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_write);
+  if(file_descriptor->openflags & FSAL_O_RDONLY)
+    Return(ERR_FSAL_PERM, 0, INDEX_FSAL_write);
+
+  /* always write at the end of the file in append mode */
+  if(file_descriptor->openflags & FSAL_O_APPEND)
+    seek_descriptor = &end_of_file;
+
+  if((rc = ghostfs_seek(file_descriptor, seek_descriptor, &offset)))
+    Return(ghost2fsal_error(rc), rc, INDEX_FSAL_write);
+
+  rc = GHOSTFS_Write(file_descriptor->handle, offset, buffer_size, buffer,
+                     &written_size, NULL);
+  if(rc)
+    Return(ghost2fsal_error(rc), rc, INDEX_FSAL_write);
+
+  file_descriptor->current_offset = offset + written_size;
+
+  *write_amount = written_size;
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_write);
 }
 
-fsal_status_t FSAL_close(fsal_file_t * file_descriptor  /* IN */
+fsal_status_t GHOSTFSAL_close(fsal_file_t * file_descriptor  /* IN */
     )
 {
 
@@ -156,27 +285,30 @@ fsal_status_t FSAL_close(fsal_file_t * file_descriptor  /* IN */
   if(!file_descriptor)
     Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_close);
 
-  Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_close);
+  /* nothing is attached to an opened file */
+  memset(file_descriptor, 0, sizeof(fsal_file_t));
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_close);
 }
 
 /* Some unsupported calls used in FSAL_PROXY, just for permit the ganeshell to compile */
-fsal_status_t FSAL_open_by_fileid(fsal_handle_t * filehandle,   /* IN */
-                                  fsal_u64_t fileid,    /* IN */
-                                  fsal_op_context_t * p_context,        /* IN */
-                                  fsal_openflags_t openflags,   /* IN */
-                                  fsal_file_t * file_descriptor,        /* OUT */
-                                  fsal_attrib_list_t * file_attributes /* [ IN/OUT ] */ )
+fsal_status_t GHOSTFSAL_open_by_fileid(fsal_handle_t * filehandle,   /* IN */
+                                       fsal_u64_t fileid,    /* IN */
+                                       fsal_op_context_t * p_context,        /* IN */
+                                       fsal_openflags_t openflags,   /* IN */
+                                       fsal_file_t * file_descriptor,        /* OUT */
+                                       fsal_attrib_list_t * file_attributes /* [ IN/OUT ] */ )
 {
   Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_open_by_fileid);
 }
 
-fsal_status_t FSAL_close_by_fileid(fsal_file_t * file_descriptor /* IN */ ,
-                                   fsal_u64_t fileid)
+fsal_status_t GHOSTFSAL_close_by_fileid(fsal_file_t * file_descriptor /* IN */ ,
+                                        fsal_u64_t fileid)
 {
   Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_open_by_fileid);
 }
 
-unsigned int FSAL_GetFileno(fsal_file_t * pfile)
+unsigned int GHOSTFSAL_GetFileno(fsal_file_t * pfile)
 {
   return 1;
 }
@@ -194,25 +326,12 @@ unsigned int FSAL_GetFileno(fsal_file_t * pfile)
  *      - ERR_FSAL_NO_ERROR: no error.
  *      - Another error code if an error occured during this call.
  */
-fsal_status_t FSAL_sync(fsal_file_t * p_file_descriptor   /* IN */)
+fsal_status_t GHOSTFSAL_sync(fsal_file_t * p_file_descriptor   /* IN */)
 {
-  int rc, errsv;
-
   /* sanity checks. */
   if(!p_file_descriptor)
     Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_sync);
 
-  /* Flush data. */
-  TakeTokenFSCall();
-  //  rc = fsync(p_file_descriptor->fd);
-  //  errsv = errno;
-  ReleaseTokenFSCall();
-  
-  //  if(rc)
-  //    {
-  //      LogEvent(COMPONENT_FSAL, "Error in fsync operation");
-  //      Return(posix2fsal_error(errsv), errsv, INDEX_FSAL_sync);
-  //    }
-
+  /* The data of GHOST_FS is in memory: nothing to flush. */
   Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_sync);
 }
@@ -49,3 +49,384 @@ void fsal_internal_getstats(fsal_statistics_t * output_stats);
 /* automaticaly sets the function name, from the function index. */
 /*#define SetFuncID(_f_) SetNameFunction(fsal_function_names[_f_])*/
 #define SetFuncID(_f_)
+
+/* The GHOST_FS functions, called through the function table of fsal_compat.c */
+
+fsal_status_t GHOSTFSAL_access(fsal_handle_t * object_handle,        /* IN */
+                               fsal_op_context_t * p_context,        /* IN */
+                               fsal_accessflags_t access_type,       /* IN */
+                               fsal_attrib_list_t * object_attributes        /* [ IN/OUT ] */
+    );
+
+fsal_status_t GHOSTFSAL_getattrs(fsal_handle_t * filehandle, /* IN */
+                                 fsal_op_context_t * p_context,      /* IN */
+                                 fsal_attrib_list_t * object_attributes      /* IN/OUT */
+    );
+
+fsal_status_t GHOSTFSAL_setattrs(fsal_handle_t * filehandle, /* IN */
+                                 fsal_op_context_t * p_context,      /* IN */
+                                 fsal_attrib_list_t * attrib_set,    /* IN */
+                                 fsal_attrib_list_t * object_attributes      /* [ IN/OUT ] */
+    );
+
+fsal_status_t GHOSTFSAL_getextattrs(fsal_handle_t * p_filehandle, /* IN */
+                                    fsal_op_context_t * p_context,        /* IN */
+                                    fsal_extattrib_list_t * p_object_attributes /* OUT */
+    );
+
+fsal_status_t GHOSTFSAL_BuildExportContext(fsal_export_context_t * p_export_context, /* OUT */
+                                           fsal_path_t * p_export_path,      /* IN */
+                                           char *fs_specific_options /* IN */
+    );
+
+fsal_status_t GHOSTFSAL_CleanUpExportContext(fsal_export_context_t * p_export_context);
+
+fsal_status_t GHOSTFSAL_InitClientContext(fsal_op_context_t * p_thr_context);
+
+fsal_status_t GHOSTFSAL_GetClientContext(fsal_op_context_t * p_thr_context,  /* IN/OUT  */
+                                         fsal_export_context_t * p_export_context,   /* IN */
+                                         fsal_uid_t uid,     /* IN */
+                                         fsal_gid_t gid,     /* IN */
+                                         fsal_gid_t * alt_groups,    /* IN */
+                                         fsal_count_t nb_alt_groups  /* IN */
+    );
+
+fsal_status_t GHOSTFSAL_create(fsal_handle_t * parent_directory_handle,      /* IN */
+                               fsal_name_t * p_filename,     /* IN */
+                               fsal_op_context_t * p_context,        /* IN */
+                               fsal_accessmode_t accessmode, /* IN */
+                               fsal_handle_t * object_handle,        /* OUT */
+                               fsal_attrib_list_t * object_attributes        /* [ IN/OUT ] */
+    );
+
+fsal_status_t GHOSTFSAL_mkdir(fsal_handle_t * parent_directory_handle,       /* IN */
+                              fsal_name_t * p_dirname,       /* IN */
+                              fsal_op_context_t * p_context, /* IN */
+                              fsal_accessmode_t accessmode,  /* IN */
+                              fsal_handle_t * object_handle, /* OUT */
+                              fsal_attrib_list_t * object_attributes /* [ IN/OUT ] */
+    );
+
+fsal_status_t GHOSTFSAL_link(fsal_handle_t * target_handle,  /* IN */
+                             fsal_handle_t * dir_handle,     /* IN */
+                             fsal_name_t * p_link_name,      /* IN */
+                             fsal_op_context_t * p_context,  /* IN */
+                             fsal_attrib_list_t * attributes /* [ IN/OUT ] */
+    );
+
+fsal_status_t GHOSTFSAL_mknode(fsal_handle_t * parentdir_handle,     /* IN */
+                               fsal_name_t * p_node_name,    /* IN */
+                               fsal_op_context_t * p_context,        /* IN */
+                               fsal_accessmode_t accessmode, /* IN */
+                               fsal_nodetype_t nodetype,     /* IN */
+                               fsal_dev_t * dev,     /* IN */
+                               fsal_handle_t * p_object_handle,      /* OUT (handle to the created node) */
+                               fsal_attrib_list_t * node_attributes  /* [ IN/OUT ] */
+    );
+
+fsal_status_t GHOSTFSAL_opendir(fsal_handle_t * dir_handle,  /* IN */
+                                fsal_op_context_t * p_context,       /* IN */
+                                fsal_dir_t * dir_descriptor, /* OUT */
+                                fsal_attrib_list_t * dir_attributes  /* [ IN/OUT ] */
+    );
+
+fsal_status_t GHOSTFSAL_readdir(fsal_dir_t * dir_descriptor, /* IN */
+                                fsal_cookie_t start_position,        /* IN */
+                                fsal_attrib_mask_t get_attr_mask,    /* IN */
+                                fsal_mdsize_t buffersize,    /* IN */
+                                fsal_dirent_t * pdirent,     /* OUT */
+                                fsal_cookie_t * end_position,        /* OUT */
+                                fsal_count_t * nb_entries,   /* OUT */
+                                fsal_boolean_t * end_of_dir  /* OUT */
+    );
+
+fsal_status_t GHOSTFSAL_closedir(fsal_dir_t * dir_descriptor /* IN */
+    );
+
+fsal_status_t GHOSTFSAL_open_by_name(fsal_handle_t * dirhandle,      /* IN */
+                                     fsal_name_t * filename, /* IN */
+                                     fsal_op_context_t * p_context,  /* IN */
+                                     fsal_openflags_t openflags,     /* IN */
+                                     fsal_file_t * file_descriptor,  /* OUT */
+                                     fsal_attrib_list_t * file_attributes /* [ IN/OUT ] */ );
+
+fsal_status_t GHOSTFSAL_rcp_by_fileid(fsal_handle_t * filehandle,    /* IN */
+                                      fsal_u64_t fileid,     /* IN */
+                                      fsal_op_context_t * p_context, /* IN */
+                                      fsal_path_t * p_local_path,    /* IN */
+                                      fsal_rcpflag_t transfer_opt /* IN */ );
+
+fsal_status_t GHOSTFSAL_open(fsal_handle_t * filehandle,     /* IN */
+                             fsal_op_context_t * p_context,  /* IN */
+                             fsal_openflags_t openflags,     /* IN */
+                             fsal_file_t * file_descriptor,  /* OUT */
+                             fsal_attrib_list_t * file_attributes    /* [ IN/OUT ] */
+    );
+
+fsal_status_t GHOSTFSAL_read(fsal_file_t * file_descriptor,  /* IN */
+                             fsal_seek_t * seek_descriptor,  /* IN */
+                             fsal_size_t buffer_size,        /* IN */
+                             caddr_t buffer, /* OUT */
+                             fsal_size_t * read_amount,      /* OUT */
+                             fsal_boolean_t * end_of_file    /* OUT */
+    );
+
+fsal_status_t GHOSTFSAL_write(fsal_file_t * file_descriptor, /* IN */
+                              fsal_seek_t * seek_descriptor, /* IN */
+                              fsal_size_t buffer_size,       /* IN */
+                              caddr_t buffer,        /* IN */
+                              fsal_size_t * write_amount     /* OUT */
+    );
+
+fsal_status_t GHOSTFSAL_close(fsal_file_t * file_descriptor  /* IN */
+    );
+
+fsal_status_t GHOSTFSAL_open_by_fileid(fsal_handle_t * filehandle,   /* IN */
+                                       fsal_u64_t fileid,    /* IN */
+                                       fsal_op_context_t * p_context,        /* IN */
+                                       fsal_openflags_t openflags,   /* IN */
+                                       fsal_file_t * file_descriptor,        /* OUT */
+                                       fsal_attrib_list_t * file_attributes /* [ IN/OUT ] */ );
+
+fsal_status_t GHOSTFSAL_close_by_fileid(fsal_file_t * file_descriptor /* IN */ ,
+                                        fsal_u64_t fileid);
+
+unsigned int GHOSTFSAL_GetFileno(fsal_file_t * pfile);
+
+fsal_status_t GHOSTFSAL_sync(fsal_file_t * p_file_descriptor   /* IN */);
+
+fsal_status_t GHOSTFSAL_static_fsinfo(fsal_handle_t * filehandle,    /* IN */
+                                      fsal_op_context_t * p_context, /* IN */
+                                      fsal_staticfsinfo_t * staticinfo       /* OUT */
+    );
+
+fsal_status_t GHOSTFSAL_dynamic_fsinfo(fsal_handle_t * filehandle,   /* IN */
+                                       fsal_op_context_t * p_context,        /* IN */
+                                       fsal_dynamicfsinfo_t * dynamicinfo    /* OUT */
+    );
+
+fsal_status_t GHOSTFSAL_Init(fsal_parameter_t * init_info    /* IN */
+    );
+
+fsal_status_t GHOSTFSAL_terminate();
+
+fsal_status_t GHOSTFSAL_test_access(fsal_op_context_t * p_context,   /* IN */
+                                    fsal_accessflags_t access_type,  /* IN */
+                                    fsal_attrib_list_t * object_attributes   /* IN */
+    );
+
+fsal_status_t GHOSTFSAL_setattr_access(fsal_op_context_t * p_context,        /* IN */
+                                       fsal_attrib_list_t * candidate_attributes,    /* IN */
+                                       fsal_attrib_list_t * object_attributes        /* IN */
+    );
+
+fsal_status_t GHOSTFSAL_rename_access(fsal_op_context_t * pcontext,  /* IN */
+                                      fsal_attrib_list_t * pattrsrc, /* IN */
+                                      fsal_attrib_list_t * pattrdest)        /* IN */;
+
+fsal_status_t GHOSTFSAL_create_access(fsal_op_context_t * pcontext,  /* IN */
+                                      fsal_attrib_list_t * pattr)    /* IN */;
+
+fsal_status_t GHOSTFSAL_unlink_access(fsal_op_context_t * pcontext,  /* IN */
+                                      fsal_attrib_list_t * pattr)    /* IN */;
+
+fsal_status_t GHOSTFSAL_link_access(fsal_op_context_t * pcontext,    /* IN */
+                                    fsal_attrib_list_t * pattr)      /* IN */;
+
+fsal_status_t GHOSTFSAL_merge_attrs(fsal_attrib_list_t * pinit_attr,
+                                    fsal_attrib_list_t * pnew_attr,
+                                    fsal_attrib_list_t * presult_attr);
+
+fsal_status_t GHOSTFSAL_lock(fsal_file_t * obj_handle,       /* IN */
+                             fsal_lockdesc_t * ldesc,        /*IN/OUT */
+                             fsal_boolean_t callback /* IN */
+    );
+
+fsal_status_t GHOSTFSAL_changelock(fsal_lockdesc_t * lock_descriptor,        /* IN / OUT */
+                                   fsal_lockparam_t * lock_info      /* IN */
+    );
+
+fsal_status_t GHOSTFSAL_unlock(fsal_file_t * obj_handle,     /* IN */
+                               fsal_lockdesc_t * ldesc       /*IN/OUT */
+    );
+
+fsal_status_t GHOSTFSAL_getlock(fsal_file_t * obj_handle,    /* IN */
+                                fsal_lockdesc_t * ldesc      /*IN/OUT */
+    );
+
+fsal_status_t GHOSTFSAL_lookupJunction(fsal_handle_t * p_junction_handle,    /* IN */
+                                       fsal_op_context_t * p_context,        /* IN */
+                                       fsal_handle_t * p_fsoot_handle,       /* OUT */
+                                       fsal_attrib_list_t * p_fsroot_attributes      /* [ IN/OUT ] */
+    );
+
+fsal_status_t GHOSTFSAL_lookup(fsal_handle_t * parent_directory_handle,      /* IN */
+                               fsal_name_t * p_filename,     /* IN */
+                               fsal_op_context_t * p_context,        /* IN */
+                               fsal_handle_t * object_handle,        /* OUT */
+                               fsal_attrib_list_t * object_attributes        /* [ IN/OUT ] */
+    );
+
+fsal_status_t GHOSTFSAL_lookupPath(fsal_path_t * p_path,     /* IN */
+                                   fsal_op_context_t * p_context,    /* IN */
+                                   fsal_handle_t * object_handle,    /* OUT */
+                                   fsal_attrib_list_t * object_attributes    /* [ IN/OUT ] */
+    );
+
+fsal_status_t GHOSTFSAL_CleanObjectResources(fsal_handle_t * in_fsal_handle);
+
+fsal_status_t GHOSTFSAL_get_quota(fsal_path_t * pfsal_path,  /* IN */
+                                  int quota_type,    /* IN */
+                                  fsal_uid_t fsal_uid, fsal_quota_t * pquota)        /* OUT */;
+
+fsal_status_t GHOSTFSAL_set_quota(fsal_path_t * pfsal_path,  /* IN */
+                                  int quota_type,    /* IN */
+                                  fsal_uid_t fsal_uid,       /* IN */
+                                  fsal_quota_t * pquot,      /* IN */
+                                  fsal_quota_t * presquot)   /* OUT */;
+
+fsal_status_t GHOSTFSAL_rcp(fsal_handle_t * filehandle,      /* IN */
+                            fsal_op_context_t * p_context,   /* IN */
+                            fsal_path_t * p_local_path,      /* IN */
+                            fsal_rcpflag_t transfer_opt      /* IN */
+    );
+
+fsal_status_t GHOSTFSAL_rename(fsal_handle_t * old_parentdir_handle, /* IN */
+                               fsal_name_t * p_old_name,     /* IN */
+                               fsal_handle_t * new_parentdir_handle, /* IN */
+                               fsal_name_t * p_new_name,     /* IN */
+                               fsal_op_context_t * p_context,        /* IN */
+                               fsal_attrib_list_t * src_dir_attributes,      /* [ IN/OUT ] */
+                               fsal_attrib_list_t * tgt_dir_attributes       /* [ IN/OUT ] */
+    );
+
+void GHOSTFSAL_get_stats(fsal_statistics_t * stats,  /* OUT */
+                         fsal_boolean_t reset        /* IN */
+    );
+
+fsal_status_t GHOSTFSAL_readlink(fsal_handle_t * linkhandle, /* IN */
+                                 fsal_op_context_t * p_context,      /* IN */
+                                 fsal_path_t * p_link_content,       /* OUT */
+                                 fsal_attrib_list_t * link_attributes        /* [ IN/OUT ] */
+    );
+
+fsal_status_t GHOSTFSAL_symlink(fsal_handle_t * parent_directory_handle,     /* IN */
+                                fsal_name_t * p_linkname,    /* IN */
+                                fsal_path_t * p_linkcontent, /* IN */
+                                fsal_op_context_t * p_context,       /* IN */
+                                fsal_accessmode_t accessmode,        /* IN  */
+                                fsal_handle_t * link_handle, /* OUT */
+                                fsal_attrib_list_t * link_attributes /* [ IN/OUT ] */
+    );
+
+char *GHOSTFSAL_GetFSName();
+
+int GHOSTFSAL_handlecmp(fsal_handle_t * handle1, fsal_handle_t * handle2,
+                        fsal_status_t * status);
+
+unsigned int GHOSTFSAL_Handle_to_HashIndex(fsal_handle_t * p_handle,
+                                           unsigned int cookie,
+                                           unsigned int alphabet_len, unsigned int index_size);
+
+unsigned int GHOSTFSAL_Handle_to_RBTIndex(fsal_handle_t * p_handle, unsigned int cookie);
+
+fsal_status_t GHOSTFSAL_DigestHandle(fsal_export_context_t * p_expcontext,   /* IN */
+                                     fsal_digesttype_t output_type,  /* IN */
+                                     fsal_handle_t * in_fsal_handle, /* IN */
+                                     caddr_t out_buff        /* OUT */
+    );
+
+fsal_status_t GHOSTFSAL_ExpandHandle(fsal_export_context_t * p_expcontext,   /* IN */
+                                     fsal_digesttype_t in_type,      /* IN */
+                                     caddr_t in_buff,        /* IN */
+                                     fsal_handle_t * out_fsal_handle /* OUT */
+    );
+
+fsal_status_t GHOSTFSAL_SetDefault_FSAL_parameter(fsal_parameter_t * out_parameter);
+
+fsal_status_t GHOSTFSAL_SetDefault_FS_common_parameter(fsal_parameter_t * out_parameter);
+
+fsal_status_t GHOSTFSAL_SetDefault_FS_specific_parameter(fsal_parameter_t * out_parameter);
+
+fsal_status_t GHOSTFSAL_load_FSAL_parameter_from_conf(config_file_t in_config,
+                                                      fsal_parameter_t * out_parameter);
+
+fsal_status_t GHOSTFSAL_load_FS_common_parameter_from_conf(config_file_t in_config,
+                                                           fsal_parameter_t * out_parameter);
+
+fsal_status_t GHOSTFSAL_load_FS_specific_parameter_from_conf(config_file_t in_config,
+                                                             fsal_parameter_t * out_parameter);
+
+fsal_status_t GHOSTFSAL_truncate(fsal_handle_t * filehandle, /* IN */
+                                 fsal_op_context_t * p_context,      /* IN */
+                                 fsal_size_t length, /* IN */
+                                 fsal_file_t * file_descriptor,      /* Unused in this FSAL */
+                                 fsal_attrib_list_t * object_attributes      /* [ IN/OUT ] */
+    );
+
+fsal_status_t GHOSTFSAL_unlink(fsal_handle_t * parentdir_handle,     /* IN */
+                               fsal_name_t * p_object_name,  /* IN */
+                               fsal_op_context_t * p_context,        /* IN */
+                               fsal_attrib_list_t * parentdir_attributes     /* [IN/OUT ] */
+    );
+
+fsal_status_t GHOSTFSAL_GetXAttrAttrs(fsal_handle_t * p_objecthandle,        /* IN */
+                                      fsal_op_context_t * p_context, /* IN */
+                                      unsigned int xattr_id, /* IN */
+                                      fsal_attrib_list_t * p_attrs
+                                               /**< IN/OUT xattr attributes (if supported) */
+    );
+
+fsal_status_t GHOSTFSAL_ListXAttrs(fsal_handle_t * p_objecthandle,   /* IN */
+                                   unsigned int cookie,      /* IN */
+                                   fsal_op_context_t * p_context,    /* IN */
+                                   fsal_xattrent_t * xattrs_tab,     /* IN/OUT */
+                                   unsigned int xattrs_tabsize,      /* IN */
+                                   unsigned int *p_nb_returned,      /* OUT */
+                                   int *end_of_list  /* OUT */
+    );
+
+fsal_status_t GHOSTFSAL_GetXAttrValueById(fsal_handle_t * p_objecthandle,    /* IN */
+                                          unsigned int xattr_id,     /* IN */
+                                          fsal_op_context_t * p_context,     /* IN */
+                                          caddr_t buffer_addr,       /* IN/OUT */
+                                          size_t buffer_size,        /* IN */
+                                          size_t * p_output_size     /* OUT */
+    );
+
+fsal_status_t GHOSTFSAL_GetXAttrIdByName(fsal_handle_t * p_objecthandle,     /* IN */
+                                         const fsal_name_t * xattr_name,     /* IN */
+                                         fsal_op_context_t * p_context,      /* IN */
+                                         unsigned int *pxattr_id     /* OUT */
+    );
+
+fsal_status_t GHOSTFSAL_GetXAttrValueByName(fsal_handle_t * p_objecthandle,  /* IN */
+                                            const fsal_name_t * xattr_name,  /* IN */
+                                            fsal_op_context_t * p_context,   /* IN */
+                                            caddr_t buffer_addr,     /* IN/OUT */
+                                            size_t buffer_size,      /* IN */
+                                            size_t * p_output_size   /* OUT */
+    );
+
+fsal_status_t GHOSTFSAL_SetXAttrValue(fsal_handle_t * p_objecthandle,        /* IN */
+                                      const fsal_name_t * xattr_name,        /* IN */
+                                      fsal_op_context_t * p_context, /* IN */
+                                      caddr_t buffer_addr,   /* IN */
+                                      size_t buffer_size,    /* IN */
+                                      int create     /* IN */
+    );
+
+fsal_status_t GHOSTFSAL_SetXAttrValueById(fsal_handle_t * p_objecthandle,    /* IN */
+                                          unsigned int xattr_id,     /* IN */
+                                          fsal_op_context_t * p_context,     /* IN */
+                                          caddr_t buffer_addr,       /* IN */
+                                          size_t buffer_size /* IN */
+    );
+
+fsal_status_t GHOSTFSAL_RemoveXAttrById(fsal_handle_t * p_objecthandle,      /* IN */
+                                        fsal_op_context_t * p_context,       /* IN */
+                                        unsigned int xattr_id)       /* IN */;
+
+fsal_status_t GHOSTFSAL_RemoveXAttrByName(fsal_handle_t * p_objecthandle,    /* IN */
+                                          fsal_op_context_t * p_context,     /* IN */
+                                          const fsal_name_t * xattr_name)    /* IN */;
@@ -18,10 +18,9 @@
 #include "fsal.h"
 #include "fsal_internal.h"
 
-fsal_status_t FSAL_lock(fsal_handle_t * objecthandle,   /* IN */
-                        fsal_op_context_t * p_context,  /* IN */
-                        fsal_lockparam_t * lock_info,   /* IN */
-                        fsal_lockdesc_t * lock_descriptor       /* OUT */
+fsal_status_t GHOSTFSAL_lock(fsal_file_t * obj_handle,       /* IN */
+                             fsal_lockdesc_t * ldesc,        /*IN/OUT */
+                             fsal_boolean_t callback /* IN */
     )
 {
 
@@ -29,14 +28,14 @@ fsal_status_t FSAL_lock(fsal_handle_t * objecthandle,   /* IN */
   SetFuncID(INDEX_FSAL_lock);
 
   /* sanity checks. */
-  if(!objecthandle || !p_context || !lock_descriptor)
+  if(!obj_handle || !ldesc)
     Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_lock);
 
   Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_lock);
 }
 
-fsal_status_t FSAL_changelock(fsal_lockdesc_t * lock_descriptor,        /* IN / OUT */
-                              fsal_lockparam_t * lock_info      /* IN */
+fsal_status_t GHOSTFSAL_changelock(fsal_lockdesc_t * lock_descriptor,        /* IN / OUT */
+                                   fsal_lockparam_t * lock_info      /* IN */
     )
 {
   /* for logging */
@@ -50,7 +49,8 @@ fsal_status_t FSAL_changelock(fsal_lockdesc_t * lock_descriptor,        /* IN /
 
 }
 
-fsal_status_t FSAL_unlock(fsal_lockdesc_t * lock_descriptor     /* IN/OUT */
+fsal_status_t GHOSTFSAL_unlock(fsal_file_t * obj_handle,     /* IN */
+                               fsal_lockdesc_t * ldesc       /*IN/OUT */
     )
 {
 
@@ -58,9 +58,25 @@ fsal_status_t FSAL_unlock(fsal_lockdesc_t * lock_descriptor     /* IN/OUT */
   SetFuncID(INDEX_FSAL_unlock);
 
   /* sanity checks. */
-  if(!lock_descriptor)
+  if(!obj_handle || !ldesc)
     Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_unlock);
 
   Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_unlock);
 
 }
+
+fsal_status_t GHOSTFSAL_getlock(fsal_file_t * obj_handle,    /* IN */
+                                fsal_lockdesc_t * ldesc      /*IN/OUT */
+    )
+{
+
+  /* for logging */
+  SetFuncID(INDEX_FSAL_getlock);
+
+  /* sanity checks. */
+  if(!obj_handle || !ldesc)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_getlock);
+
+  Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_getlock);
+
+}
@@ -19,10 +19,10 @@
 #include "fsal_internal.h"
 #include "fsal_convertions.h"
 
-fsal_status_t FSAL_lookupJunction(fsal_handle_t * p_junction_handle,    /* IN */
-                                  fsal_op_context_t * p_context,        /* IN */
-                                  fsal_handle_t * p_fsoot_handle,       /* OUT */
-                                  fsal_attrib_list_t * p_fsroot_attributes      /* [ IN/OUT ] */
+fsal_status_t GHOSTFSAL_lookupJunction(fsal_handle_t * p_junction_handle,    /* IN */
+                                       fsal_op_context_t * p_context,        /* IN */
+                                       fsal_handle_t * p_fsoot_handle,       /* OUT */
+                                       fsal_attrib_list_t * p_fsroot_attributes      /* [ IN/OUT ] */
     )
 {
   /* no junctions in ghostfs */
@@ -56,11 +56,11 @@ fsal_status_t FSAL_lookupJunction(fsal_handle_t * p_junction_handle,    /* IN */
  *          
  */
 
-fsal_status_t FSAL_lookup(fsal_handle_t * parent_directory_handle,      /* IN */
-                          fsal_name_t * p_filename,     /* IN */
-                          fsal_op_context_t * p_context,        /* IN */
-                          fsal_handle_t * object_handle,        /* OUT */
-                          fsal_attrib_list_t * object_attributes        /* [ IN/OUT ] */
+fsal_status_t GHOSTFSAL_lookup(fsal_handle_t * parent_directory_handle,      /* IN */
+                               fsal_name_t * p_filename,     /* IN */
+                               fsal_op_context_t * p_context,        /* IN */
+                               fsal_handle_t * object_handle,        /* OUT */
+                               fsal_attrib_list_t * object_attributes        /* [ IN/OUT ] */
     )
 {
 
@@ -170,10 +170,10 @@ fsal_status_t FSAL_lookup(fsal_handle_t * parent_directory_handle,      /* IN */
  *        It can be NULL (increases performances).
  */
 
-fsal_status_t FSAL_lookupPath(fsal_path_t * p_path,     /* IN */
-                              fsal_op_context_t * p_context,    /* IN */
-                              fsal_handle_t * object_handle,    /* OUT */
-                              fsal_attrib_list_t * object_attributes    /* [ IN/OUT ] */
+fsal_status_t GHOSTFSAL_lookupPath(fsal_path_t * p_path,     /* IN */
+                                   fsal_op_context_t * p_context,    /* IN */
+                                   fsal_handle_t * object_handle,    /* OUT */
+                                   fsal_attrib_list_t * object_attributes    /* [ IN/OUT ] */
     )
 {
 
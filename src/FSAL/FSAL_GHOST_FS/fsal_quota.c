@@ -41,6 +41,8 @@
  *
  * \param  pfsal_path
  *        path to the filesystem whose quota are requested
+ * \param  quota_type
+ *        the kind of quota (blocks or inodes)
  * \param  fsal_uid
  * 	  uid for the user whose quota are requested
  * \param pquota (input):
@@ -50,8 +52,9 @@
  *        - ERR_FSAL_NO_ERROR     (no error)
  *        - Another error code if an error occured.
  */
-fsal_status_t FSAL_get_quota(fsal_path_t * pfsal_path,  /* IN */
-                             fsal_uid_t fsal_uid, fsal_quota_t * pquota)        /* OUT */
+fsal_status_t GHOSTFSAL_get_quota(fsal_path_t * pfsal_path,  /* IN */
+                                  int quota_type,    /* IN */
+                                  fsal_uid_t fsal_uid, fsal_quota_t * pquota)        /* OUT */
 {
   ReturnCode(ERR_FSAL_NO_QUOTA, 0);
 }                               /*  FSAL_get_quota */
@@ -62,6 +65,8 @@ fsal_status_t FSAL_get_quota(fsal_path_t * pfsal_path,  /* IN */
  *
  * \param  pfsal_path
  *        path to the filesystem whose quota are requested
+ * \param  quota_type
+ *        the kind of quota (blocks or inodes)
  * \param  fsal_uid
  * 	  uid for the user whose quota are requested
  * \param pquota (input):
@@ -74,10 +79,11 @@ fsal_status_t FSAL_get_quota(fsal_path_t * pfsal_path,  /* IN */
  *        - Another error code if an error occured.
  */
 
-fsal_status_t FSAL_set_quota(fsal_path_t * pfsal_path,  /* IN */
-                             fsal_uid_t fsal_uid,       /* IN */
-                             fsal_quota_t * pquot,      /* IN */
-                             fsal_quota_t * presquot)   /* OUT */
+fsal_status_t GHOSTFSAL_set_quota(fsal_path_t * pfsal_path,  /* IN */
+                                  int quota_type,    /* IN */
+                                  fsal_uid_t fsal_uid,       /* IN */
+                                  fsal_quota_t * pquot,      /* IN */
+                                  fsal_quota_t * presquot)   /* OUT */
 {
   ReturnCode(ERR_FSAL_NO_QUOTA, 0);
 }                               /*  FSAL_set_quota */
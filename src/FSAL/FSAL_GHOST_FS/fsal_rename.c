@@ -19,13 +19,13 @@
 #include "fsal_internal.h"
 #include "fsal_convertions.h"
 
-fsal_status_t FSAL_rename(fsal_handle_t * old_parentdir_handle, /* IN */
-                          fsal_name_t * p_old_name,     /* IN */
-                          fsal_handle_t * new_parentdir_handle, /* IN */
-                          fsal_name_t * p_new_name,     /* IN */
-                          fsal_op_context_t * p_context,        /* IN */
-                          fsal_attrib_list_t * src_dir_attributes,      /* [ IN/OUT ] */
-                          fsal_attrib_list_t * tgt_dir_attributes       /* [ IN/OUT ] */
+fsal_status_t GHOSTFSAL_rename(fsal_handle_t * old_parentdir_handle, /* IN */
+                               fsal_name_t * p_old_name,     /* IN */
+                               fsal_handle_t * new_parentdir_handle, /* IN */
+                               fsal_name_t * p_new_name,     /* IN */
+                               fsal_op_context_t * p_context,        /* IN */
+                               fsal_attrib_list_t * src_dir_attributes,      /* [ IN/OUT ] */
+                               fsal_attrib_list_t * tgt_dir_attributes       /* [ IN/OUT ] */
     )
 {
   int rc;
@@ -17,8 +17,8 @@
 #include "fsal.h"
 #include "fsal_internal.h"
 
-void FSAL_get_stats(fsal_statistics_t * stats,  /* OUT */
-                    fsal_boolean_t reset        /* IN */
+void GHOSTFSAL_get_stats(fsal_statistics_t * stats,  /* OUT */
+                         fsal_boolean_t reset        /* IN */
     )
 {
 
@@ -20,10 +20,10 @@
 #include "fsal_convertions.h"
 #include <string.h>
 
-fsal_status_t FSAL_readlink(fsal_handle_t * linkhandle, /* IN */
-                            fsal_op_context_t * p_context,      /* IN */
-                            fsal_path_t * p_link_content,       /* OUT */
-                            fsal_attrib_list_t * link_attributes        /* [ IN/OUT ] */
+fsal_status_t GHOSTFSAL_readlink(fsal_handle_t * linkhandle, /* IN */
+                                 fsal_op_context_t * p_context,      /* IN */
+                                 fsal_path_t * p_link_content,       /* OUT */
+                                 fsal_attrib_list_t * link_attributes        /* [ IN/OUT ] */
     )
 {
 
@@ -69,13 +69,13 @@ fsal_status_t FSAL_readlink(fsal_handle_t * linkhandle, /* IN */
 
 }
 
-fsal_status_t FSAL_symlink(fsal_handle_t * parent_directory_handle,     /* IN */
-                           fsal_name_t * p_linkname,    /* IN */
-                           fsal_path_t * p_linkcontent, /* IN */
-                           fsal_op_context_t * p_context,       /* IN */
-                           fsal_accessmode_t accessmode,        /* IN  */
-                           fsal_handle_t * link_handle, /* OUT */
-                           fsal_attrib_list_t * link_attributes /* [ IN/OUT ] */
+fsal_status_t GHOSTFSAL_symlink(fsal_handle_t * parent_directory_handle,     /* IN */
+                                fsal_name_t * p_linkname,    /* IN */
+                                fsal_path_t * p_linkcontent, /* IN */
+                                fsal_op_context_t * p_context,       /* IN */
+                                fsal_accessmode_t accessmode,        /* IN  */
+                                fsal_handle_t * link_handle, /* OUT */
+                                fsal_attrib_list_t * link_attributes /* [ IN/OUT ] */
     )
 {
   int rc;
@@ -17,14 +17,17 @@
 
 #include "fsal.h"
 #include "fsal_internal.h"
+#include "fsal_convertions.h"
 
-fsal_status_t FSAL_truncate(fsal_handle_t * filehandle, /* IN */
-                            fsal_op_context_t * p_context,      /* IN */
-                            fsal_size_t length, /* IN */
-                            fsal_file_t * file_descriptor,      /* Unused in this FSAL */
-                            fsal_attrib_list_t * object_attributes      /* [ IN/OUT ] */
+fsal_status_t GHOSTFSAL_truncate(fsal_handle_t * filehandle, /* IN */
+                                 fsal_op_context_t * p_context,      /* IN */
+                                 fsal_size_t length, /* IN */
+                                 fsal_file_t * file_descriptor,      /* Unused in this FSAL */
+                                 fsal_attrib_list_t * object_attributes      /* [ IN/OUT ] */
     )
 {
+  GHOSTFS_Attrs_t ghost_attrs;
+  int rc;
 
   /* for logging */
   SetFuncID(INDEX_FSAL_truncate);
@@ -35,7 +38,14 @@ fsal_status_t FSAL_truncate(fsal_handle_t * filehandle, /* IN */
   if(!filehandle || !p_context)
     Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_truncate);
 
-  /* GHOSTFS is read only */
-  Return(ERR_FSAL_ROFS, 0, INDEX_FSAL_truncate);
+  rc = GHOSTFS_Truncate((GHOSTFS_handle_t) (*filehandle), length, &ghost_attrs);
+
+  if(rc)
+    Return(ghost2fsal_error(rc), rc, INDEX_FSAL_truncate);
+
+  if(object_attributes)
+    ghost2fsal_attrs(object_attributes, &ghost_attrs);
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_truncate);
 
 }
@@ -19,10 +19,10 @@
 #include "fsal_internal.h"
 #include "fsal_convertions.h"
 
-fsal_status_t FSAL_unlink(fsal_handle_t * parentdir_handle,     /* IN */
-                          fsal_name_t * p_object_name,  /* IN */
-                          fsal_op_context_t * p_context,        /* IN */
-                          fsal_attrib_list_t * parentdir_attributes     /* [IN/OUT ] */
+fsal_status_t GHOSTFSAL_unlink(fsal_handle_t * parentdir_handle,     /* IN */
+                               fsal_name_t * p_object_name,  /* IN */
+                               fsal_op_context_t * p_context,        /* IN */
+                               fsal_attrib_list_t * parentdir_attributes     /* [IN/OUT ] */
     )
 {
   int rc;
@@ -232,25 +232,33 @@ static int file_attributes_to_xattr_attrs(fsal_attrib_list_t * file_attrs,
  * \param xattr_cookie xattr's cookie (as returned by listxattrs).
  * \param p_attrs xattr's attributes.
  */
-fsal_status_t FSAL_GetXAttrAttrs(fsal_handle_t * p_objecthandle,        /* IN */
-                                 fsal_op_context_t * p_context, /* IN */
-                                 unsigned int xattr_id, /* IN */
-                                 fsal_attrib_list_t * p_attrs
-                                          /**< IN/OUT xattr attributes (if supported) */
+fsal_status_t GHOSTFSAL_GetXAttrAttrs(fsal_handle_t * p_objecthandle,        /* IN */
+                                      fsal_op_context_t * p_context, /* IN */
+                                      unsigned int xattr_id, /* IN */
+                                      fsal_attrib_list_t * p_attrs
+                                               /**< IN/OUT xattr attributes (if supported) */
     )
 {
   int rc;
   char buff[MAXNAMLEN];
   fsal_status_t st;
   fsal_attrib_list_t file_attrs;
+  GHOSTFS_Attrs_t attrs;
+  fsal_nodetype_t objtype;
 
   /* sanity checks */
   if(!p_objecthandle || !p_context || !p_attrs)
     Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_GetXAttrAttrs);
 
+  /* get object type */
+  rc = GHOSTFS_GetAttrs((GHOSTFS_handle_t) (*p_objecthandle), &attrs);
+  if(rc)
+    Return(ghost2fsal_error(rc), rc, INDEX_FSAL_GetXAttrAttrs);
+
+  objtype = ghost2fsal_type(attrs.type);
+
   /* check that this index match the type of entry */
-  if(xattr_id >= XATTR_COUNT
-     || !do_match_type(xattr_list[xattr_id].flags, p_objecthandle->obj_type))
+  if(xattr_id >= XATTR_COUNT || !do_match_type(xattr_list[xattr_id].flags, objtype))
     {
       Return(ERR_FSAL_INVAL, 0, INDEX_FSAL_GetXAttrAttrs);
     }
@@ -290,13 +298,13 @@ fsal_status_t FSAL_GetXAttrAttrs(fsal_handle_t * p_objecthandle,        /* IN */
  * \param p_nb_returned the number of xattr entries actually stored in xattrs_tab.
  * \param end_of_list this boolean indicates that the end of xattrs list has been reached.
  */
-fsal_status_t FSAL_ListXAttrs(fsal_handle_t * p_objecthandle,   /* IN */
-                              unsigned int cookie,      /* IN */
-                              fsal_op_context_t * p_context,    /* IN */
-                              fsal_xattrent_t * xattrs_tab,     /* IN/OUT */
-                              unsigned int xattrs_tabsize,      /* IN */
-                              unsigned int *p_nb_returned,      /* OUT */
-                              int *end_of_list  /* OUT */
+fsal_status_t GHOSTFSAL_ListXAttrs(fsal_handle_t * p_objecthandle,   /* IN */
+                                   unsigned int cookie,      /* IN */
+                                   fsal_op_context_t * p_context,    /* IN */
+                                   fsal_xattrent_t * xattrs_tab,     /* IN/OUT */
+                                   unsigned int xattrs_tabsize,      /* IN */
+                                   unsigned int *p_nb_returned,      /* OUT */
+                                   int *end_of_list  /* OUT */
     )
 {
   int rc;
@@ -375,12 +383,12 @@ fsal_status_t FSAL_ListXAttrs(fsal_handle_t * p_objecthandle,   /* IN */
  * \param buffer_size size of the buffer where the xattr value is to be stored.
  * \param p_output_size size of the data actually stored into the buffer.
  */
-fsal_status_t FSAL_GetXAttrValueById(fsal_handle_t * p_objecthandle,    /* IN */
-                                     unsigned int xattr_id,     /* IN */
-                                     fsal_op_context_t * p_context,     /* IN */
-                                     caddr_t buffer_addr,       /* IN/OUT */
-                                     size_t buffer_size,        /* IN */
-                                     size_t * p_output_size     /* OUT */
+fsal_status_t GHOSTFSAL_GetXAttrValueById(fsal_handle_t * p_objecthandle,    /* IN */
+                                          unsigned int xattr_id,     /* IN */
+                                          fsal_op_context_t * p_context,     /* IN */
+                                          caddr_t buffer_addr,       /* IN/OUT */
+                                          size_t buffer_size,        /* IN */
+                                          size_t * p_output_size     /* OUT */
     )
 {
   int rc;
@@ -421,19 +429,29 @@ fsal_status_t FSAL_GetXAttrValueById(fsal_handle_t * p_objecthandle,    /* IN */
  *   
  *  \return ERR_FSAL_NO_ERROR if xattr_name exists, ERR_FSAL_NOENT otherwise
  */
-fsal_status_t FSAL_GetXAttrIdByName(fsal_handle_t * p_objecthandle,     /* IN */
-                                    const fsal_name_t * xattr_name,     /* IN */
-                                    fsal_op_context_t * p_context,      /* IN */
-                                    unsigned int *pxattr_id     /* OUT */
+fsal_status_t GHOSTFSAL_GetXAttrIdByName(fsal_handle_t * p_objecthandle,     /* IN */
+                                         const fsal_name_t * xattr_name,     /* IN */
+                                         fsal_op_context_t * p_context,      /* IN */
+                                         unsigned int *pxattr_id     /* OUT */
     )
 {
+  int rc;
   unsigned int index;
   int found = FALSE;
+  GHOSTFS_Attrs_t attrs;
+  fsal_nodetype_t objtype;
 
   /* sanity checks */
   if(!p_objecthandle || !xattr_name)
     Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_GetXAttrValue);
 
+  /* get object type */
+  rc = GHOSTFS_GetAttrs((GHOSTFS_handle_t) (*p_objecthandle), &attrs);
+  if(rc)
+    Return(ghost2fsal_error(rc), rc, INDEX_FSAL_GetXAttrValue);
+
+  objtype = ghost2fsal_type(attrs.type);
+
   for(index = 0; index < XATTR_COUNT; index++)
     {
       if(do_match_type(xattr_list[index].flags, objtype)
@@ -463,12 +481,12 @@ fsal_status_t FSAL_GetXAttrIdByName(fsal_handle_t * p_objecthandle,     /* IN */
  * \param buffer_size size of the buffer where the xattr value is to be stored.
  * \param p_output_size size of the data actually stored into the buffer.
  */
-fsal_status_t FSAL_GetXAttrValueByName(fsal_handle_t * p_objecthandle,  /* IN */
-                                       const fsal_name_t * xattr_name,  /* IN */
-                                       fsal_op_context_t * p_context,   /* IN */
-                                       caddr_t buffer_addr,     /* IN/OUT */
-                                       size_t buffer_size,      /* IN */
-                                       size_t * p_output_size   /* OUT */
+fsal_status_t GHOSTFSAL_GetXAttrValueByName(fsal_handle_t * p_objecthandle,  /* IN */
+                                            const fsal_name_t * xattr_name,  /* IN */
+                                            fsal_op_context_t * p_context,   /* IN */
+                                            caddr_t buffer_addr,     /* IN/OUT */
+                                            size_t buffer_size,      /* IN */
+                                            size_t * p_output_size   /* OUT */
     )
 {
   unsigned int index;
@@ -506,22 +524,22 @@ fsal_status_t FSAL_GetXAttrValueByName(fsal_handle_t * p_objecthandle,  /* IN */
 
 }
 
-fsal_status_t FSAL_SetXAttrValue(fsal_handle_t * p_objecthandle,        /* IN */
-                                 const fsal_name_t * xattr_name,        /* IN */
-                                 fsal_op_context_t * p_context, /* IN */
-                                 caddr_t buffer_addr,   /* IN */
-                                 size_t buffer_size,    /* IN */
-                                 int create     /* IN */
+fsal_status_t GHOSTFSAL_SetXAttrValue(fsal_handle_t * p_objecthandle,        /* IN */
+                                      const fsal_name_t * xattr_name,        /* IN */
+                                      fsal_op_context_t * p_context, /* IN */
+                                      caddr_t buffer_addr,   /* IN */
+                                      size_t buffer_size,    /* IN */
+                                      int create     /* IN */
     )
 {
   Return(ERR_FSAL_PERM, 0, INDEX_FSAL_SetXAttrValue);
 }
 
-fsal_status_t FSAL_SetXAttrValueById(fsal_handle_t * p_objecthandle,    /* IN */
-                                     unsigned int xattr_id,     /* IN */
-                                     fsal_op_context_t * p_context,     /* IN */
-                                     caddr_t buffer_addr,       /* IN */
-                                     size_t buffer_size /* IN */
+fsal_status_t GHOSTFSAL_SetXAttrValueById(fsal_handle_t * p_objecthandle,    /* IN */
+                                          unsigned int xattr_id,     /* IN */
+                                          fsal_op_context_t * p_context,     /* IN */
+                                          caddr_t buffer_addr,       /* IN */
+                                          size_t buffer_size /* IN */
     )
 {
   Return(ERR_FSAL_PERM, 0, INDEX_FSAL_SetXAttrValue);
@@ -534,9 +552,9 @@ fsal_status_t FSAL_SetXAttrValueById(fsal_handle_t * p_objecthandle,    /* IN */
  * \param p_context pointer to the current security context.
  * \param xattr_id xattr's id
  */
-fsal_status_t FSAL_RemoveXAttrById(fsal_handle_t * p_objecthandle,      /* IN */
-                                   fsal_op_context_t * p_context,       /* IN */
-                                   unsigned int xattr_id)       /* IN */
+fsal_status_t GHOSTFSAL_RemoveXAttrById(fsal_handle_t * p_objecthandle,      /* IN */
+                                        fsal_op_context_t * p_context,       /* IN */
+                                        unsigned int xattr_id)       /* IN */
 {
   ReturnCode(ERR_FSAL_NO_ERROR, 0);
 }                               /* FSAL_RemoveXAttrById */
@@ -548,9 +566,9 @@ fsal_status_t FSAL_RemoveXAttrById(fsal_handle_t * p_objecthandle,      /* IN */
  * \param p_context pointer to the current security context.
  * \param xattr_name xattr's name
  */
-fsal_status_t FSAL_RemoveXAttrByName(fsal_handle_t * p_objecthandle,    /* IN */
-                                     fsal_op_context_t * p_context,     /* IN */
-                                     const fsal_name_t * xattr_name)    /* IN */
+fsal_status_t GHOSTFSAL_RemoveXAttrByName(fsal_handle_t * p_objecthandle,    /* IN */
+                                          fsal_op_context_t * p_context,     /* IN */
+                                          const fsal_name_t * xattr_name)    /* IN */
 {
   ReturnCode(ERR_FSAL_NO_ERROR, 0);
 }                               /* FSAL_RemoveXAttrById */
@@ -202,6 +202,10 @@ int main(int argc, char **argv)
   AddFamilyError(ERR_FSAL, "FSAL related Errors", tab_errstatus_FSAL);
   AddFamilyError(ERR_GHOSTFS, "GhostFS Errors", tab_errstatus_GHOSTFS);
 
+  /* load the GHOST_FS functions in the FSAL glue layer */
+  FSAL_LoadFunctions();
+  FSAL_LoadConsts();
+
   /* prepare fsal_init */
 
   /* 1 - fs specific info */
@@ -220,6 +220,25 @@ fsal_status_t WRAP_GPFSFSAL_write(fsal_file_t * p_file_descriptor,       /* IN *
                        buffer_size, buffer, p_write_amount);
 }
 
+fsal_status_t WRAP_GPFSFSAL_readv(fsal_file_t * p_file_descriptor,       /* IN */
+                                fsal_count_t nb_segments,       /* IN */
+                                fsal_io_segment_t * p_segments, /* IN/OUT */
+                                fsal_size_t * p_read_amount,    /* OUT */
+                                fsal_boolean_t * p_end_of_file /* OUT */ )
+{
+  return GPFSFSAL_readv((gpfsfsal_file_t *) p_file_descriptor, nb_segments, p_segments,
+                      p_read_amount, p_end_of_file);
+}
+
+fsal_status_t WRAP_GPFSFSAL_writev(fsal_file_t * p_file_descriptor,      /* IN */
+                                 fsal_count_t nb_segments,      /* IN */
+                                 fsal_io_segment_t * p_segments,        /* IN/OUT */
+                                 fsal_size_t * p_write_amount /* OUT */ )
+{
+  return GPFSFSAL_writev((gpfsfsal_file_t *) p_file_descriptor, nb_segments, p_segments,
+                       p_write_amount);
+}
+
 fsal_status_t WRAP_GPFSFSAL_sync(fsal_file_t * p_file_descriptor       /* IN */)
 {
   return GPFSFSAL_sync((gpfsfsal_file_t *) p_file_descriptor);
@@ -696,6 +715,8 @@ fsal_functions_t fsal_gpfs_functions = {
   .fsal_read = WRAP_GPFSFSAL_read,
   .fsal_write = WRAP_GPFSFSAL_write,
   .fsal_sync = WRAP_GPFSFSAL_sync,
+  .fsal_readv = WRAP_GPFSFSAL_readv,
+  .fsal_writev = WRAP_GPFSFSAL_writev,
   .fsal_close = WRAP_GPFSFSAL_close,
   .fsal_open_by_fileid = WRAP_GPFSFSAL_open_by_fileid,
   .fsal_close_by_fileid = WRAP_GPFSFSAL_close_by_fileid,
@@ -475,4 +475,15 @@ fsal_status_t GPFSFSAL_getextattrs(fsal_handle_t * p_filehandle, /* IN */
                                    fsal_op_context_t * p_context,        /* IN */
                                    fsal_extattrib_list_t * p_object_attributes /* OUT */) ;
 
+fsal_status_t GPFSFSAL_readv(gpfsfsal_file_t * p_file_descriptor,  /* IN */
+                           fsal_count_t nb_segments,    /* IN */
+                           fsal_io_segment_t * p_segments,      /* IN/OUT */
+                           fsal_size_t * p_read_amount, /* OUT */
+                           fsal_boolean_t * p_end_of_file /* OUT */ );
+
+fsal_status_t GPFSFSAL_writev(gpfsfsal_file_t * p_file_descriptor, /* IN */
+                            fsal_count_t nb_segments,   /* IN */
+                            fsal_io_segment_t * p_segments,     /* IN/OUT */
+                            fsal_size_t * p_write_amount /* OUT */ );
+
 fsal_status_t GPFSFSAL_sync(gpfsfsal_file_t * p_file_descriptor /* IN */);
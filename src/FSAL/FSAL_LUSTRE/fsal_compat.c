@@ -210,6 +210,25 @@ fsal_status_t WRAP_LUSTREFSAL_write(fsal_file_t * p_file_descriptor,    /* IN */
                           buffer_size, buffer, p_write_amount);
 }
 
+fsal_status_t WRAP_LUSTREFSAL_readv(fsal_file_t * p_file_descriptor,       /* IN */
+                                fsal_count_t nb_segments,       /* IN */
+                                fsal_io_segment_t * p_segments, /* IN/OUT */
+                                fsal_size_t * p_read_amount,    /* OUT */
+                                fsal_boolean_t * p_end_of_file /* OUT */ )
+{
+  return LUSTREFSAL_readv((lustrefsal_file_t *) p_file_descriptor, nb_segments, p_segments,
+                      p_read_amount, p_end_of_file);
+}
+
+fsal_status_t WRAP_LUSTREFSAL_writev(fsal_file_t * p_file_descriptor,      /* IN */
+                                 fsal_count_t nb_segments,      /* IN */
+                                 fsal_io_segment_t * p_segments,        /* IN/OUT */
+                                 fsal_size_t * p_write_amount /* OUT */ )
+{
+  return LUSTREFSAL_writev((lustrefsal_file_t *) p_file_descriptor, nb_segments, p_segments,
+                       p_write_amount);
+}
+
 fsal_status_t WRAP_LUSTREFSAL_sync(fsal_file_t * p_file_descriptor    /* IN */)
 {
   return LUSTREFSAL_sync((lustrefsal_file_t *) p_file_descriptor);
@@ -698,6 +717,8 @@ fsal_functions_t fsal_lustre_functions = {
   .fsal_read = WRAP_LUSTREFSAL_read,
   .fsal_write = WRAP_LUSTREFSAL_write,
   .fsal_sync = WRAP_LUSTREFSAL_sync,
+  .fsal_readv = WRAP_LUSTREFSAL_readv,
+  .fsal_writev = WRAP_LUSTREFSAL_writev,
   .fsal_close = WRAP_LUSTREFSAL_close,
   .fsal_open_by_fileid = WRAP_LUSTREFSAL_open_by_fileid,
   .fsal_close_by_fileid = WRAP_LUSTREFSAL_close_by_fileid,
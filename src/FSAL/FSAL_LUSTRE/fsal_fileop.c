@@ -455,6 +455,108 @@ fsal_status_t LUSTREFSAL_write(lustrefsal_file_t * p_file_descriptor,   /* IN */
 
 }
 
+/**
+ * FSAL_readv:
+ * Perform a vectored read operation on an opened file.
+ * Contiguous segments are read with a single preadv call.
+ *
+ * \param file_descriptor (input):
+ *        The file descriptor returned by FSAL_open.
+ * \param nb_segments (input):
+ *        Number of segments to be read.
+ * \param segments (input/output):
+ *        The segments (offset, size, buffer) to be read. The amount
+ *        read for each segment is returned in io_amount.
+ * \param read_amount (output):
+ *        Pointer to the total amount of data (in bytes) that have been read.
+ * \param end_of_file (output):
+ *        Pointer to a boolean that indicates whether the end of file
+ *        has been reached during this call.
+ *
+ * \return Major error codes:
+ *      - ERR_FSAL_NO_ERROR: no error.
+ *      - Another error code if an error occured during this call.
+ */
+fsal_status_t LUSTREFSAL_readv(lustrefsal_file_t * p_file_descriptor,  /* IN */
+                           fsal_count_t nb_segments,    /* IN */
+                           fsal_io_segment_t * p_segments,      /* IN/OUT */
+                           fsal_size_t * p_read_amount, /* OUT */
+                           fsal_boolean_t * p_end_of_file       /* OUT */
+    )
+{
+  int errsv;
+
+  /* sanity checks. */
+  if(!p_file_descriptor || !p_segments || !p_read_amount || !p_end_of_file)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_readv);
+
+  TakeTokenFSCall();
+
+  errsv = fsal_posix_preadv(p_file_descriptor->fd, nb_segments, p_segments,
+                            p_read_amount, p_end_of_file);
+
+  ReleaseTokenFSCall();
+
+  if(errsv)
+    Return(posix2fsal_error(errsv), errsv, INDEX_FSAL_readv);
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_readv);
+
+}
+
+/**
+ * FSAL_writev:
+ * Perform a vectored write operation on an opened file.
+ * Contiguous segments are written with a single pwritev call.
+ *
+ * \param file_descriptor (input):
+ *        The file descriptor returned by FSAL_open.
+ * \param nb_segments (input):
+ *        Number of segments to be written.
+ * \param segments (input/output):
+ *        The segments (offset, size, buffer) to be written. The amount
+ *        written for each segment is returned in io_amount.
+ * \param write_amount (output):
+ *        Pointer to the total amount of data (in bytes) that have been written.
+ *
+ * \return Major error codes:
+ *      - ERR_FSAL_NO_ERROR: no error.
+ *      - Another error code if an error occured during this call.
+ */
+fsal_status_t LUSTREFSAL_writev(lustrefsal_file_t * p_file_descriptor, /* IN */
+                            fsal_count_t nb_segments,   /* IN */
+                            fsal_io_segment_t * p_segments,     /* IN/OUT */
+                            fsal_size_t * p_write_amount        /* OUT */
+    )
+{
+  int errsv;
+
+  /* sanity checks. */
+  if(!p_file_descriptor || !p_segments || !p_write_amount)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_writev);
+
+  if(p_file_descriptor->ro)
+    Return(ERR_FSAL_PERM, 0, INDEX_FSAL_writev);
+
+  TakeTokenFSCall();
+
+  errsv = fsal_posix_pwritev(p_file_descriptor->fd, nb_segments, p_segments,
+                             p_write_amount);
+
+  ReleaseTokenFSCall();
+
+  if(errsv)
+    {
+      LogDebug(COMPONENT_FSAL,
+               "Vectored write of %lu segments failed. fd=%d, errno=%d.",
+               nb_segments, p_file_descriptor->fd, errsv);
+      Return(posix2fsal_error(errsv), errsv, INDEX_FSAL_writev);
+    }
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_writev);
+
+}
+
 /**
  * FSAL_close:
  * Free the resources allocated by the FSAL_open call.
@@ -191,6 +191,17 @@ fsal_status_t LUSTREFSAL_write(lustrefsal_file_t * p_file_descriptor,   /* IN */
                                caddr_t buffer,  /* IN */
                                fsal_size_t * p_write_amount /* OUT */ );
 
+fsal_status_t LUSTREFSAL_readv(lustrefsal_file_t * p_file_descriptor,  /* IN */
+                           fsal_count_t nb_segments,    /* IN */
+                           fsal_io_segment_t * p_segments,      /* IN/OUT */
+                           fsal_size_t * p_read_amount, /* OUT */
+                           fsal_boolean_t * p_end_of_file /* OUT */ );
+
+fsal_status_t LUSTREFSAL_writev(lustrefsal_file_t * p_file_descriptor, /* IN */
+                            fsal_count_t nb_segments,   /* IN */
+                            fsal_io_segment_t * p_segments,     /* IN/OUT */
+                            fsal_size_t * p_write_amount /* OUT */ );
+
 fsal_status_t LUSTREFSAL_sync(lustrefsal_file_t * p_file_descriptor  /* IN */);
 
 fsal_status_t LUSTREFSAL_close(lustrefsal_file_t * p_file_descriptor /* IN */ );
@@ -210,6 +210,27 @@ fsal_status_t WRAP_POSIXFSAL_write(fsal_file_t * p_file_descriptor,     /* IN */
                          buffer_size, buffer, p_write_amount);
 }
 
+#ifndef _FSAL_POSIX_USE_STREAM
+fsal_status_t WRAP_POSIXFSAL_readv(fsal_file_t * p_file_descriptor,       /* IN */
+                                fsal_count_t nb_segments,       /* IN */
+                                fsal_io_segment_t * p_segments, /* IN/OUT */
+                                fsal_size_t * p_read_amount,    /* OUT */
+                                fsal_boolean_t * p_end_of_file /* OUT */ )
+{
+  return POSIXFSAL_readv((posixfsal_file_t *) p_file_descriptor, nb_segments, p_segments,
+                      p_read_amount, p_end_of_file);
+}
+
+fsal_status_t WRAP_POSIXFSAL_writev(fsal_file_t * p_file_descriptor,      /* IN */
+                                 fsal_count_t nb_segments,      /* IN */
+                                 fsal_io_segment_t * p_segments,        /* IN/OUT */
+                                 fsal_size_t * p_write_amount /* OUT */ )
+{
+  return POSIXFSAL_writev((posixfsal_file_t *) p_file_descriptor, nb_segments, p_segments,
+                       p_write_amount);
+}
+#endif
+
 fsal_status_t WRAP_POSIXFSAL_sync(fsal_file_t * p_file_descriptor     /* IN */)
 {
   return POSIXFSAL_sync((posixfsal_file_t *) p_file_descriptor);
@@ -693,6 +714,10 @@ fsal_functions_t fsal_xfs_functions = {
   .fsal_read = WRAP_POSIXFSAL_read,
   .fsal_write = WRAP_POSIXFSAL_write,
   .fsal_sync = WRAP_POSIXFSAL_sync,
+#ifndef _FSAL_POSIX_USE_STREAM
+  .fsal_readv = WRAP_POSIXFSAL_readv,
+  .fsal_writev = WRAP_POSIXFSAL_writev,
+#endif
   .fsal_close = WRAP_POSIXFSAL_close,
   .fsal_open_by_fileid = WRAP_POSIXFSAL_open_by_fileid,
   .fsal_close_by_fileid = WRAP_POSIXFSAL_close_by_fileid,
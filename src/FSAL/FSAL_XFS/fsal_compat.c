@@ -207,6 +207,25 @@ fsal_status_t WRAP_XFSFSAL_write(fsal_file_t * p_file_descriptor,       /* IN */
                        buffer_size, buffer, p_write_amount);
 }
 
+fsal_status_t WRAP_XFSFSAL_readv(fsal_file_t * p_file_descriptor,       /* IN */
+                                fsal_count_t nb_segments,       /* IN */
+                                fsal_io_segment_t * p_segments, /* IN/OUT */
+                                fsal_size_t * p_read_amount,    /* OUT */
+                                fsal_boolean_t * p_end_of_file /* OUT */ )
+{
+  return XFSFSAL_readv((xfsfsal_file_t *) p_file_descriptor, nb_segments, p_segments,
+                      p_read_amount, p_end_of_file);
+}
+
+fsal_status_t WRAP_XFSFSAL_writev(fsal_file_t * p_file_descriptor,      /* IN */
+                                 fsal_count_t nb_segments,      /* IN */
+                                 fsal_io_segment_t * p_segments,        /* IN/OUT */
+                                 fsal_size_t * p_write_amount /* OUT */ )
+{
+  return XFSFSAL_writev((xfsfsal_file_t *) p_file_descriptor, nb_segments, p_segments,
+                       p_write_amount);
+}
+
 fsal_status_t WRAP_XFSFSAL_sync(fsal_file_t * p_file_descriptor    /* IN */)
 {
   return XFSFSAL_sync((xfsfsal_file_t *) p_file_descriptor);
@@ -681,6 +700,8 @@ fsal_functions_t fsal_xfs_functions = {
   .fsal_read = WRAP_XFSFSAL_read,
   .fsal_write = WRAP_XFSFSAL_write,
   .fsal_sync = WRAP_XFSFSAL_sync,
+  .fsal_readv = WRAP_XFSFSAL_readv,
+  .fsal_writev = WRAP_XFSFSAL_writev,
   .fsal_close = WRAP_XFSFSAL_close,
   .fsal_open_by_fileid = WRAP_XFSFSAL_open_by_fileid,
   .fsal_close_by_fileid = WRAP_XFSFSAL_close_by_fileid,
@@ -215,6 +215,98 @@ fsal_status_t FSAL_write(fsal_file_t * p_file_descriptor,       /* IN */
                                    buffer, p_write_amount);
 }
 
+fsal_status_t FSAL_readv(fsal_file_t * p_file_descriptor,       /* IN */
+                         fsal_count_t nb_segments,      /* IN */
+                         fsal_io_segment_t * p_segments,        /* IN/OUT */
+                         fsal_size_t * p_read_amount,   /* OUT */
+                         fsal_boolean_t * p_end_of_file /* OUT */ )
+{
+  fsal_status_t status;
+  fsal_seek_t seek_descriptor;
+  fsal_count_t i;
+
+  if(fsal_functions.fsal_readv != NULL)
+    return fsal_functions.fsal_readv(p_file_descriptor, nb_segments, p_segments,
+                                     p_read_amount, p_end_of_file);
+
+  if(!p_segments || !p_read_amount || !p_end_of_file)
+    {
+      status.major = ERR_FSAL_FAULT;
+      status.minor = 0;
+      return status;
+    }
+
+  /* Default: one FSAL_read per segment */
+  *p_read_amount = 0;
+  *p_end_of_file = FALSE;
+  status.major = ERR_FSAL_NO_ERROR;
+  status.minor = 0;
+
+  for(i = 0; i < nb_segments; i++)
+    p_segments[i].io_amount = 0;
+
+  for(i = 0; i < nb_segments && !*p_end_of_file; i++)
+    {
+      seek_descriptor.whence = FSAL_SEEK_SET;
+      seek_descriptor.offset = p_segments[i].offset;
+
+      status = fsal_functions.fsal_read(p_file_descriptor, &seek_descriptor,
+                                        p_segments[i].length, p_segments[i].buffer,
+                                        &p_segments[i].io_amount, p_end_of_file);
+      if(FSAL_IS_ERROR(status))
+        return status;
+
+      *p_read_amount += p_segments[i].io_amount;
+    }
+
+  return status;
+}
+
+fsal_status_t FSAL_writev(fsal_file_t * p_file_descriptor,      /* IN */
+                          fsal_count_t nb_segments,     /* IN */
+                          fsal_io_segment_t * p_segments,       /* IN/OUT */
+                          fsal_size_t * p_write_amount /* OUT */ )
+{
+  fsal_status_t status;
+  fsal_seek_t seek_descriptor;
+  fsal_count_t i;
+
+  if(fsal_functions.fsal_writev != NULL)
+    return fsal_functions.fsal_writev(p_file_descriptor, nb_segments, p_segments,
+                                      p_write_amount);
+
+  if(!p_segments || !p_write_amount)
+    {
+      status.major = ERR_FSAL_FAULT;
+      status.minor = 0;
+      return status;
+    }
+
+  /* Default: one FSAL_write per segment */
+  *p_write_amount = 0;
+  status.major = ERR_FSAL_NO_ERROR;
+  status.minor = 0;
+
+  for(i = 0; i < nb_segments; i++)
+    p_segments[i].io_amount = 0;
+
+  for(i = 0; i < nb_segments; i++)
+    {
+      seek_descriptor.whence = FSAL_SEEK_SET;
+      seek_descriptor.offset = p_segments[i].offset;
+
+      status = fsal_functions.fsal_write(p_file_descriptor, &seek_descriptor,
+                                         p_segments[i].length, p_segments[i].buffer,
+                                         &p_segments[i].io_amount);
+      if(FSAL_IS_ERROR(status))
+        return status;
+
+      *p_write_amount += p_segments[i].io_amount;
+    }
+
+  return status;
+}
+
 fsal_status_t FSAL_sync(fsal_file_t * p_file_descriptor)
 {
   return fsal_functions.fsal_sync(p_file_descriptor);
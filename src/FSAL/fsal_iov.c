@@ -0,0 +1,176 @@
+/*
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+
+/**
+ *
+ * \file    fsal_iov.c
+ * \brief   Vectored I/O helpers for the FSALs built on POSIX file descriptors.
+ *
+ * The segments given to FSAL_readv/FSAL_writev are grouped into runs of
+ * contiguous segments, and each run is submitted with a single preadv/pwritev.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "fsal.h"
+
+/**
+ * fsal_build_run:
+ * Builds the iovec for the run of contiguous segments starting at 'first'.
+ *
+ * \return The number of segments in the run.
+ */
+static fsal_count_t fsal_build_run(fsal_count_t first,
+                                   fsal_count_t nb_segments,
+                                   fsal_io_segment_t * segments,
+                                   struct iovec *iov, size_t * p_run_length)
+{
+  fsal_count_t i;
+  fsal_off_t next = segments[first].offset;
+
+  *p_run_length = 0;
+
+  for(i = first; i < nb_segments && i - first < FSAL_IO_MAX_SEGMENTS; i++)
+    {
+      if(segments[i].offset != next)
+        break;
+
+      iov[i - first].iov_base = segments[i].buffer;
+      iov[i - first].iov_len = (size_t) segments[i].length;
+
+      next += segments[i].length;
+      *p_run_length += segments[i].length;
+    }
+
+  return i - first;
+}                               /* fsal_build_run */
+
+/**
+ * fsal_dispatch_run:
+ * Spreads the amount done by a preadv/pwritev over the segments of the run.
+ */
+static void fsal_dispatch_run(fsal_count_t first,
+                              fsal_count_t nb_run,
+                              fsal_io_segment_t * segments, size_t done)
+{
+  fsal_count_t i;
+
+  for(i = first; i < first + nb_run; i++)
+    {
+      segments[i].io_amount = (done < segments[i].length) ? done : segments[i].length;
+      done -= segments[i].io_amount;
+    }
+}                               /* fsal_dispatch_run */
+
+/**
+ * fsal_posix_preadv:
+ * Reads a set of segments from a file descriptor.
+ *
+ * \param fd (input):
+ *        The file descriptor to read from.
+ * \param nb_segments (input):
+ *        Number of entries in 'segments'.
+ * \param segments (input/output):
+ *        Segments to be read, their io_amount is set on return.
+ * \param read_amount (output):
+ *        Total amount of data read.
+ * \param end_of_file (output):
+ *        Set if a segment hit the end of the file.
+ *
+ * \return 0 if ok, the errno of the failed call otherwise.
+ */
+int fsal_posix_preadv(int fd,
+                      fsal_count_t nb_segments,
+                      fsal_io_segment_t * segments,
+                      fsal_size_t * read_amount, fsal_boolean_t * end_of_file)
+{
+  struct iovec iov[FSAL_IO_MAX_SEGMENTS];
+  fsal_count_t first, nb_run, i;
+  size_t run_length;
+  ssize_t rc;
+
+  *read_amount = 0;
+  *end_of_file = FALSE;
+
+  for(i = 0; i < nb_segments; i++)
+    segments[i].io_amount = 0;
+
+  for(first = 0; first < nb_segments; first += nb_run)
+    {
+      nb_run = fsal_build_run(first, nb_segments, segments, iov, &run_length);
+
+      rc = preadv(fd, iov, (int)nb_run, segments[first].offset);
+
+      if(rc < 0)
+        return errno;
+
+      fsal_dispatch_run(first, nb_run, segments, (size_t) rc);
+      *read_amount += rc;
+
+      /* A short read means the end of the file was reached */
+      if((size_t) rc < run_length)
+        {
+          *end_of_file = TRUE;
+          break;
+        }
+    }
+
+  return 0;
+}                               /* fsal_posix_preadv */
+
+/**
+ * fsal_posix_pwritev:
+ * Writes a set of segments to a file descriptor.
+ *
+ * \param fd (input):
+ *        The file descriptor to write to.
+ * \param nb_segments (input):
+ *        Number of entries in 'segments'.
+ * \param segments (input/output):
+ *        Segments to be written, their io_amount is set on return.
+ * \param write_amount (output):
+ *        Total amount of data written.
+ *
+ * \return 0 if ok, the errno of the failed call otherwise.
+ */
+int fsal_posix_pwritev(int fd,
+                       fsal_count_t nb_segments,
+                       fsal_io_segment_t * segments, fsal_size_t * write_amount)
+{
+  struct iovec iov[FSAL_IO_MAX_SEGMENTS];
+  fsal_count_t first, nb_run, i;
+  size_t run_length;
+  ssize_t rc;
+
+  *write_amount = 0;
+
+  for(i = 0; i < nb_segments; i++)
+    segments[i].io_amount = 0;
+
+  for(first = 0; first < nb_segments; first += nb_run)
+    {
+      nb_run = fsal_build_run(first, nb_segments, segments, iov, &run_length);
+
+      rc = pwritev(fd, iov, (int)nb_run, segments[first].offset);
+
+      if(rc < 0)
+        return errno;
+
+      fsal_dispatch_run(first, nb_run, segments, (size_t) rc);
+      *write_amount += rc;
+
+      /* Short write (e.g. ENOSPC pending), let the caller deal with the rest */
+      if((size_t) rc < run_length)
+        break;
+    }
+
+  return 0;
+}                               /* fsal_posix_pwritev */
@@ -167,6 +167,9 @@ cache_content_entry_t *cache_content_new_entry(cache_entry_t * pentry_inode,
       return NULL;
     }
 
+  /* The entry is in the manifest before it is in the local cache */
+  cache_content_manifest_add(cache_content_get_inum(pfc_pentry->local_fs_entry.cache_path_index));
+
   LogDebug(COMPONENT_CACHE_CONTENT,
                     "added file content cache entry: Data=%s Index=%s",
                     pfc_pentry->local_fs_entry.cache_path_data,
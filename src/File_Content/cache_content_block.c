@@ -0,0 +1,1334 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * \file    cache_content_block.c
+ * \brief   Management of the file content cache: in-memory block cache.
+ *
+ * cache_content_block.c : Management of the file content cache, in-memory block cache.
+ *
+ * File data are cached in memory by blocks of Block_Size bytes (1MB by default). A
+ * block is allocated when a range of the file is accessed, and only the pages
+ * (4KB) that are read or written are filled, so a small read on a big file
+ * never stages the whole file, as the local directory cache does.
+ *
+ * Blocks are spread in partitions depending on the FSAL handle of the file, each
+ * with its own mutex, hash tables, LRU and share of the Block_Cache_Size budget.
+ * When the budget is reached, the buffers of the least recently used clean
+ * blocks are recycled. Dirty or pinned blocks are never recycled.
+ *
+ * Unstable writes within the file are kept in memory (write back) and sent to
+ * FSAL when the client does a COMMIT, as long as the dirty blocks use less
+ * than half of the partition's budget. The other writes are sent to FSAL at
+ * once and update the cached pages (write through).
+ *
+ * Cached data are keyed by the FSAL handle, not by the cache_inode entry, so
+ * they survive the garbage collection of the cache_inode entries. They are
+ * dropped when the mtime of the file changes while there is no dirty page.
+ *
+ * The caller must hold the lock of the related cache_inode entry: I/O on the
+ * blocks of a file are never done concurrently.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef _SOLARIS
+#include "solaris_port.h"
+#endif                          /* _SOLARIS */
+
+#include "LRU_List.h"
+#include "log_macros.h"
+#include "HashData.h"
+#include "HashTable.h"
+#include "fsal.h"
+#include "cache_inode.h"
+#include "cache_content.h"
+#include "stuff_alloc.h"
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/param.h>
+#include <time.h>
+#include <pthread.h>
+#include <string.h>
+
+#define CACHE_CONTENT_BLOCK_NB_PARTITIONS 16
+#define CACHE_CONTENT_BLOCK_HASH_RANGE    1048573
+#define CACHE_CONTENT_BLOCK_BITMAP_WORDS  (CACHE_CONTENT_BLOCK_MAX_PAGES/32)
+
+/* Up to this many valid clean pages between two dirty runs are written with them */
+#define CACHE_CONTENT_BLOCK_MAX_CLEAN_GAP 8
+
+#define PAGE_TEST( bitmap, page )  ( (bitmap)[(page) >> 5] & ( 1U << ( (page) & 31 ) ) )
+#define PAGE_SET( bitmap, page )   ( (bitmap)[(page) >> 5] |= ( 1U << ( (page) & 31 ) ) )
+#define PAGE_CLEAR( bitmap, page ) ( (bitmap)[(page) >> 5] &= ~( 1U << ( (page) & 31 ) ) )
+
+typedef struct cache_content_block_file__ cache_content_block_file_t;
+
+typedef struct cache_content_block__
+{
+  cache_content_block_file_t *pfile;                      /**< file this block belongs to           */
+  uint64_t blocknum;                                      /**< offset of the block / block size     */
+  char *data;                                             /**< block_size bytes of file data        */
+  unsigned int refcount;                                  /**< pinned while I/O is done on it       */
+  unsigned int nb_dirty;                                  /**< number of dirty pages                */
+  unsigned int is_dirty;                                  /**< counted in the dirty blocks          */
+  unsigned int on_lru;                                    /**< in the LRU of its partition          */
+  size_t dirty_end;                                       /**< end of the dirty data in the block   */
+  uint32_t valid[CACHE_CONTENT_BLOCK_BITMAP_WORDS];       /**< pages whose content is up to date    */
+  uint32_t dirty[CACHE_CONTENT_BLOCK_BITMAP_WORDS];       /**< pages not yet written to FSAL        */
+  struct cache_content_block__ *hash_next;                /**< collision list in the partition      */
+  struct cache_content_block__ *file_prev;                /**< list of the blocks of the file       */
+  struct cache_content_block__ *file_next;
+  struct cache_content_block__ *lru_prev;                 /**< LRU of clean and unpinned blocks     */
+  struct cache_content_block__ *lru_next;
+} cache_content_block_t;
+
+struct cache_content_block_file__
+{
+  fsal_handle_t handle;                                   /**< FSAL handle of the file              */
+  unsigned int hashval;                                   /**< hash of the handle                   */
+  unsigned int users;                                     /**< operations in progress on the file   */
+  fsal_time_t mtime;                                      /**< mtime the cached data matches        */
+  unsigned int self_modified;                             /**< mtime changes because of our writes  */
+  unsigned int nb_blocks;                                 /**< number of blocks of the file         */
+  unsigned int nb_dirty_blocks;                           /**< blocks with dirty pages              */
+  cache_content_block_t *blocks;                          /**< blocks of the file                   */
+  struct cache_content_block_file__ *hash_next;           /**< collision list in the partition      */
+};
+
+typedef struct cache_content_block_partition__
+{
+  pthread_mutex_t lock;                                   /**< protects everything in the partition */
+  cache_content_block_file_t **files;                     /**< hash table of the files              */
+  cache_content_block_t **blocks;                         /**< hash table of the blocks             */
+  cache_content_block_t *lru_first;                       /**< most recently used clean block       */
+  cache_content_block_t *lru_last;                        /**< least recently used clean block      */
+  unsigned int nb_blocks;
+  unsigned int max_blocks;
+  unsigned int nb_dirty_blocks;
+  unsigned int max_dirty_blocks;
+  cache_content_block_stat_t stat;
+} cache_content_block_partition_t;
+
+static int cache_content_block_on = FALSE;
+static size_t block_size;
+static unsigned int block_pages;
+static unsigned int block_nb_buckets;
+static cache_content_block_partition_t partitions[CACHE_CONTENT_BLOCK_NB_PARTITIONS];
+
+/**
+ *
+ * cache_content_block_init: initializes the block cache.
+ *
+ * Initializes the block cache. Nothing is done if Block_Cache_Size is 0.
+ *
+ * @param param [IN] the file content client parameters.
+ *
+ * @return 0 if ok, -1 otherwise.
+ *
+ */
+int cache_content_block_init(cache_content_client_parameter_t param)
+{
+  unsigned int i;
+  unsigned int nb_blocks;
+
+  if(param.block_cache_size == 0)
+    return 0;
+
+  block_size = param.block_size;
+  if(block_size == 0)
+    block_size = CACHE_CONTENT_BLOCK_DEFAULT_SIZE;
+
+  /* A block is made of whole pages */
+  block_size = (block_size + CACHE_CONTENT_BLOCK_PAGE_SIZE - 1)
+      & ~((size_t) CACHE_CONTENT_BLOCK_PAGE_SIZE - 1);
+  if(block_size > CACHE_CONTENT_BLOCK_MAX_PAGES * CACHE_CONTENT_BLOCK_PAGE_SIZE)
+    block_size = CACHE_CONTENT_BLOCK_MAX_PAGES * CACHE_CONTENT_BLOCK_PAGE_SIZE;
+
+  block_pages = block_size / CACHE_CONTENT_BLOCK_PAGE_SIZE;
+
+  nb_blocks = param.block_cache_size / block_size / CACHE_CONTENT_BLOCK_NB_PARTITIONS;
+  if(nb_blocks == 0)
+    nb_blocks = 1;
+
+  block_nb_buckets = nb_blocks | 1;
+
+  for(i = 0; i < CACHE_CONTENT_BLOCK_NB_PARTITIONS; i++)
+    {
+      memset(&partitions[i], 0, sizeof(cache_content_block_partition_t));
+      pthread_mutex_init(&partitions[i].lock, NULL);
+
+      partitions[i].max_blocks = nb_blocks;
+      partitions[i].max_dirty_blocks = nb_blocks / 2;
+
+      partitions[i].files =
+          (cache_content_block_file_t **) Mem_Calloc_Label(block_nb_buckets,
+                                                           sizeof(cache_content_block_file_t
+                                                                  *),
+                                                           "cache_content_block files");
+      partitions[i].blocks =
+          (cache_content_block_t **) Mem_Calloc_Label(block_nb_buckets,
+                                                      sizeof(cache_content_block_t *),
+                                                      "cache_content_block blocks");
+
+      if(partitions[i].files == NULL || partitions[i].blocks == NULL)
+        {
+          LogCrit(COMPONENT_CACHE_CONTENT,
+                  "cache_content_block_init: could not allocate the hash tables of the block cache");
+          return -1;
+        }
+    }
+
+  LogEvent(COMPONENT_CACHE_CONTENT,
+           "Block cache: %u partitions of %u blocks of %llu bytes",
+           CACHE_CONTENT_BLOCK_NB_PARTITIONS, nb_blocks,
+           (unsigned long long)block_size);
+
+  cache_content_block_on = TRUE;
+
+  return 0;
+}                               /* cache_content_block_init */
+
+/**
+ *
+ * cache_content_block_enabled: tells if the block cache is in use.
+ *
+ * @return TRUE if the block cache was initialized, FALSE otherwise.
+ *
+ */
+int cache_content_block_enabled(void)
+{
+  return cache_content_block_on;
+}                               /* cache_content_block_enabled */
+
+/* Both hash functions work on the hash value of the handle */
+static unsigned int file_bucket(unsigned int hashval)
+{
+  return (hashval / CACHE_CONTENT_BLOCK_NB_PARTITIONS) % block_nb_buckets;
+}
+
+static unsigned int block_bucket(unsigned int hashval, uint64_t blocknum)
+{
+  return (unsigned int)((hashval + blocknum * 2654435761ULL) % block_nb_buckets);
+}
+
+static cache_content_block_partition_t *partition_of(fsal_handle_t * phandle,
+                                                     unsigned int *phashval)
+{
+  *phashval = FSAL_Handle_to_HashIndex(phandle, 0, 251, CACHE_CONTENT_BLOCK_HASH_RANGE);
+
+  return &partitions[*phashval % CACHE_CONTENT_BLOCK_NB_PARTITIONS];
+}
+
+/* The following functions must be called with the partition's lock held */
+
+static void lru_remove(cache_content_block_partition_t * part,
+                       cache_content_block_t * pblock)
+{
+  if(!pblock->on_lru)
+    return;
+
+  if(pblock->lru_prev != NULL)
+    pblock->lru_prev->lru_next = pblock->lru_next;
+  else
+    part->lru_first = pblock->lru_next;
+
+  if(pblock->lru_next != NULL)
+    pblock->lru_next->lru_prev = pblock->lru_prev;
+  else
+    part->lru_last = pblock->lru_prev;
+
+  pblock->lru_prev = pblock->lru_next = NULL;
+  pblock->on_lru = FALSE;
+}
+
+static void lru_push(cache_content_block_partition_t * part,
+                     cache_content_block_t * pblock)
+{
+  pblock->lru_prev = NULL;
+  pblock->lru_next = part->lru_first;
+
+  if(part->lru_first != NULL)
+    part->lru_first->lru_prev = pblock;
+  else
+    part->lru_last = pblock;
+
+  part->lru_first = pblock;
+  pblock->on_lru = TRUE;
+}
+
+/* Accounts the dirty state of a block, and puts it in the LRU if it can be recycled */
+static void block_update_state(cache_content_block_partition_t * part,
+                               cache_content_block_t * pblock)
+{
+  if(pblock->nb_dirty > 0 && !pblock->is_dirty)
+    {
+      pblock->is_dirty = TRUE;
+      part->nb_dirty_blocks += 1;
+      pblock->pfile->nb_dirty_blocks += 1;
+    }
+  else if(pblock->nb_dirty == 0 && pblock->is_dirty)
+    {
+      pblock->is_dirty = FALSE;
+      part->nb_dirty_blocks -= 1;
+      pblock->pfile->nb_dirty_blocks -= 1;
+      pblock->dirty_end = 0;
+    }
+
+  if(pblock->refcount == 0 && pblock->nb_dirty == 0)
+    {
+      if(!pblock->on_lru)
+        lru_push(part, pblock);
+    }
+  else
+    lru_remove(part, pblock);
+}
+
+static cache_content_block_file_t *file_lookup(cache_content_block_partition_t * part,
+                                               fsal_handle_t * phandle,
+                                               unsigned int hashval, int create)
+{
+  cache_content_block_file_t *pfile;
+  fsal_status_t fsal_status;
+  unsigned int bucket = file_bucket(hashval);
+
+  for(pfile = part->files[bucket]; pfile != NULL; pfile = pfile->hash_next)
+    if(pfile->hashval == hashval && !FSAL_handlecmp(&pfile->handle, phandle, &fsal_status))
+      return pfile;
+
+  if(!create)
+    return NULL;
+
+  if((pfile = (cache_content_block_file_t *) Mem_Alloc_Label(sizeof(cache_content_block_file_t),
+                                                             "cache_content_block_file_t")) == NULL)
+    return NULL;
+
+  memset(pfile, 0, sizeof(cache_content_block_file_t));
+  pfile->handle = *phandle;
+  pfile->hashval = hashval;
+
+  pfile->hash_next = part->files[bucket];
+  part->files[bucket] = pfile;
+
+  return pfile;
+}
+
+/* Frees a file record once it has no block and nobody is using it */
+static void file_release(cache_content_block_partition_t * part,
+                         cache_content_block_file_t * pfile)
+{
+  cache_content_block_file_t **ppfile;
+
+  if(pfile->nb_blocks > 0 || pfile->users > 0)
+    return;
+
+  for(ppfile = &part->files[file_bucket(pfile->hashval)]; *ppfile != NULL;
+      ppfile = &(*ppfile)->hash_next)
+    if(*ppfile == pfile)
+      {
+        *ppfile = pfile->hash_next;
+        break;
+      }
+
+  Mem_Free(pfile);
+}
+
+/* Removes a block from the hash table, its file and the LRU. The buffers are kept */
+static void block_unlink(cache_content_block_partition_t * part,
+                         cache_content_block_t * pblock)
+{
+  cache_content_block_t **ppblock;
+  cache_content_block_file_t *pfile = pblock->pfile;
+
+  for(ppblock = &part->blocks[block_bucket(pfile->hashval, pblock->blocknum)];
+      *ppblock != NULL; ppblock = &(*ppblock)->hash_next)
+    if(*ppblock == pblock)
+      {
+        *ppblock = pblock->hash_next;
+        break;
+      }
+
+  if(pblock->file_prev != NULL)
+    pblock->file_prev->file_next = pblock->file_next;
+  else
+    pfile->blocks = pblock->file_next;
+
+  if(pblock->file_next != NULL)
+    pblock->file_next->file_prev = pblock->file_prev;
+
+  lru_remove(part, pblock);
+
+  if(pblock->is_dirty)
+    {
+      part->nb_dirty_blocks -= 1;
+      pfile->nb_dirty_blocks -= 1;
+    }
+
+  part->nb_blocks -= 1;
+  pfile->nb_blocks -= 1;
+}
+
+static void block_free(cache_content_block_t * pblock)
+{
+  Mem_Free(pblock->data);
+  Mem_Free(pblock);
+}
+
+/* Drops all the unpinned blocks of a file, from a given block number */
+static void file_drop_blocks(cache_content_block_partition_t * part,
+                             cache_content_block_file_t * pfile, uint64_t from_blocknum)
+{
+  cache_content_block_t *pblock;
+  cache_content_block_t *pnext;
+
+  for(pblock = pfile->blocks; pblock != NULL; pblock = pnext)
+    {
+      pnext = pblock->file_next;
+
+      if(pblock->refcount > 0 || pblock->blocknum < from_blocknum)
+        continue;
+
+      block_unlink(part, pblock);
+      block_free(pblock);
+      part->stat.nb_invalidated += 1;
+    }
+}
+
+/**
+ * block_get: finds a block of a file, or makes it.
+ *
+ * Finds a block of a file and pins it. If the block is not cached, a new one
+ * is allocated, or the least recently used clean block of the partition is
+ * recycled when the budget is reached.
+ *
+ * @return the pinned block, NULL if the block is not cached and no block can be made.
+ */
+static cache_content_block_t *block_get(cache_content_block_partition_t * part,
+                                        cache_content_block_file_t * pfile,
+                                        uint64_t blocknum)
+{
+  cache_content_block_t *pblock;
+  cache_content_block_file_t *pvictim_file;
+  unsigned int bucket = block_bucket(pfile->hashval, blocknum);
+
+  for(pblock = part->blocks[bucket]; pblock != NULL; pblock = pblock->hash_next)
+    if(pblock->pfile == pfile && pblock->blocknum == blocknum)
+      {
+        lru_remove(part, pblock);
+        pblock->refcount += 1;
+        return pblock;
+      }
+
+  if(part->nb_blocks < part->max_blocks)
+    {
+      if((pblock = (cache_content_block_t *) Mem_Alloc_Label(sizeof(cache_content_block_t),
+                                                             "cache_content_block_t")) == NULL)
+        return NULL;
+
+      if((pblock->data = (char *)Mem_Alloc_Label(block_size,
+                                                 "cache_content_block data")) == NULL)
+        {
+          Mem_Free(pblock);
+          return NULL;
+        }
+    }
+  else
+    {
+      /* Recycle the least recently used clean block */
+      if((pblock = part->lru_last) == NULL)
+        return NULL;
+
+      pvictim_file = pblock->pfile;
+      block_unlink(part, pblock);
+      part->stat.nb_evicted += 1;
+
+      if(pvictim_file != pfile)
+        file_release(part, pvictim_file);
+    }
+
+  pblock->pfile = pfile;
+  pblock->blocknum = blocknum;
+  pblock->refcount = 1;
+  pblock->nb_dirty = 0;
+  pblock->is_dirty = FALSE;
+  pblock->on_lru = FALSE;
+  pblock->dirty_end = 0;
+  memset(pblock->valid, 0, sizeof(pblock->valid));
+  memset(pblock->dirty, 0, sizeof(pblock->dirty));
+  pblock->lru_prev = pblock->lru_next = NULL;
+
+  pblock->hash_next = part->blocks[bucket];
+  part->blocks[bucket] = pblock;
+
+  pblock->file_prev = NULL;
+  pblock->file_next = pfile->blocks;
+  if(pfile->blocks != NULL)
+    pfile->blocks->file_prev = pblock;
+  pfile->blocks = pblock;
+
+  part->nb_blocks += 1;
+  pfile->nb_blocks += 1;
+
+  return pblock;
+}                               /* block_get */
+
+static void block_put(cache_content_block_partition_t * part,
+                      cache_content_block_t * pblock)
+{
+  pblock->refcount -= 1;
+  block_update_state(part, pblock);
+}
+
+/**
+ * file_begin: gets the file record at the beginning of an operation.
+ *
+ * The cached data are dropped if the mtime of the file has changed and there
+ * is no dirty data in the cache.
+ *
+ * @return the file record, NULL if it could not be allocated.
+ */
+static cache_content_block_file_t *file_begin(cache_content_block_partition_t * part,
+                                              fsal_handle_t * phandle,
+                                              unsigned int hashval,
+                                              fsal_attrib_list_t * pattr)
+{
+  cache_content_block_file_t *pfile;
+
+  P(part->lock);
+
+  if((pfile = file_lookup(part, phandle, hashval, TRUE)) != NULL)
+    {
+      if(pfile->nb_blocks > 0 && !pfile->self_modified && pfile->nb_dirty_blocks == 0
+         && (pfile->mtime.seconds != pattr->mtime.seconds
+             || pfile->mtime.nseconds != pattr->mtime.nseconds))
+        file_drop_blocks(part, pfile, 0);
+
+      pfile->mtime = pattr->mtime;
+      pfile->self_modified = FALSE;
+      pfile->users += 1;
+    }
+
+  V(part->lock);
+
+  return pfile;
+}
+
+static void file_end(cache_content_block_partition_t * part,
+                     cache_content_block_file_t * pfile, int modified)
+{
+  P(part->lock);
+
+  if(modified)
+    pfile->self_modified = TRUE;
+
+  pfile->users -= 1;
+  file_release(part, pfile);
+
+  V(part->lock);
+}
+
+/**
+ * block_fill: reads from FSAL the pages of a block that are not valid.
+ *
+ * Contiguous invalid pages are read at once. Pages beyond the end of the
+ * file are zeroed. If FSAL reads less than expected, the end of file is
+ * updated in *pfilesize.
+ *
+ * @return the FSAL status.
+ */
+static fsal_status_t block_fill(cache_content_block_t * pblock,
+                                fsal_file_t * pfd,
+                                unsigned int first,
+                                unsigned int last,
+                                fsal_size_t * pfilesize,
+                                unsigned int *pnb_hit, unsigned int *pnb_miss)
+{
+  fsal_status_t fsal_status;
+  fsal_seek_t seek;
+  fsal_size_t read_size;
+  fsal_boolean_t eof;
+  fsal_off_t block_offset = pblock->blocknum * block_size;
+  size_t start;
+  size_t end;
+  unsigned int page;
+  unsigned int run;
+
+  fsal_status.major = ERR_FSAL_NO_ERROR;
+  fsal_status.minor = 0;
+
+  for(page = first; page <= last;)
+    {
+      if(PAGE_TEST(pblock->valid, page))
+        {
+          *pnb_hit += 1;
+          page += 1;
+          continue;
+        }
+
+      for(run = page; run <= last && !PAGE_TEST(pblock->valid, run); run++) ;
+
+      start = page * CACHE_CONTENT_BLOCK_PAGE_SIZE;
+      end = run * CACHE_CONTENT_BLOCK_PAGE_SIZE;
+
+      read_size = 0;
+      if(block_offset + start < *pfilesize)
+        {
+          seek.whence = FSAL_SEEK_SET;
+          seek.offset = block_offset + start;
+
+          if(block_offset + end > *pfilesize)
+            end = *pfilesize - block_offset;
+
+          fsal_status = FSAL_read(pfd, &seek, end - start, pblock->data + start,
+                                  &read_size, &eof);
+          if(FSAL_IS_ERROR(fsal_status))
+            return fsal_status;
+
+          if(read_size < end - start)
+            *pfilesize = block_offset + start + read_size;
+        }
+
+      /* What is beyond the end of file reads as zero */
+      end = run * CACHE_CONTENT_BLOCK_PAGE_SIZE;
+      if(start + read_size < end)
+        memset(pblock->data + start + read_size, 0, end - start - read_size);
+
+      *pnb_miss += run - page;
+
+      for(; page < run; page++)
+        PAGE_SET(pblock->valid, page);
+    }
+
+  return fsal_status;
+}                               /* block_fill */
+
+/* I/O done directly on FSAL, when no block can be used */
+static fsal_status_t block_direct_io(fsal_file_t * pfd,
+                                     cache_content_io_direction_t direction,
+                                     fsal_off_t offset,
+                                     fsal_size_t size,
+                                     caddr_t buffer, fsal_size_t * pio_size)
+{
+  fsal_seek_t seek;
+  fsal_boolean_t eof;
+
+  seek.whence = FSAL_SEEK_SET;
+  seek.offset = offset;
+
+  if(direction == CACHE_CONTENT_READ)
+    return FSAL_read(pfd, &seek, size, buffer, pio_size, &eof);
+  else
+    return FSAL_write(pfd, &seek, size, buffer, pio_size);
+}
+
+/**
+ *
+ * cache_content_block_read: reads file data through the block cache.
+ *
+ * Reads file data through the block cache. Missing pages are read from FSAL
+ * with the opened file descriptor. The read is limited to the size of the
+ * file found in the attributes.
+ *
+ * @param phandle [IN] FSAL handle of the file.
+ * @param pfd [IN] FSAL file descriptor, opened for reading.
+ * @param pattr [INOUT] attributes of the file, the size is updated if FSAL finds an early end of file.
+ * @param offset [IN] where to read.
+ * @param size [IN] how many bytes to read.
+ * @param pio_size [OUT] how many bytes were read.
+ * @param buffer [OUT] the data read.
+ * @param p_fsal_eof [OUT] TRUE if the end of file was reached.
+ * @param pfsal_status [OUT] FSAL status if an FSAL call failed.
+ * @param pstatus [OUT] returned status.
+ *
+ * @return CACHE_CONTENT_SUCCESS if ok, CACHE_CONTENT_FSAL_ERROR if an FSAL call failed.
+ *
+ */
+cache_content_status_t cache_content_block_read(fsal_handle_t * phandle,
+                                                fsal_file_t * pfd,
+                                                fsal_attrib_list_t * pattr,
+                                                fsal_off_t offset,
+                                                fsal_size_t size,
+                                                fsal_size_t * pio_size,
+                                                caddr_t buffer,
+                                                fsal_boolean_t * p_fsal_eof,
+                                                fsal_status_t * pfsal_status,
+                                                cache_content_status_t * pstatus)
+{
+  cache_content_block_partition_t *part;
+  cache_content_block_file_t *pfile;
+  cache_content_block_t *pblock;
+  fsal_size_t filesize = pattr->filesize;
+  fsal_size_t done = 0;
+  fsal_size_t len;
+  fsal_size_t direct_size;
+  size_t in_block;
+  unsigned int hashval;
+  unsigned int nb_hit = 0;
+  unsigned int nb_miss = 0;
+
+  *pstatus = CACHE_CONTENT_SUCCESS;
+  *pio_size = 0;
+  *p_fsal_eof = FALSE;
+  pfsal_status->major = ERR_FSAL_NO_ERROR;
+  pfsal_status->minor = 0;
+
+  if(offset >= filesize)
+    {
+      *p_fsal_eof = TRUE;
+      return *pstatus;
+    }
+
+  if(offset + size > filesize)
+    size = filesize - offset;
+
+  part = partition_of(phandle, &hashval);
+
+  if((pfile = file_begin(part, phandle, hashval, pattr)) == NULL)
+    {
+      *pfsal_status = block_direct_io(pfd, CACHE_CONTENT_READ, offset, size, buffer, pio_size);
+      if(FSAL_IS_ERROR(*pfsal_status))
+        *pstatus = CACHE_CONTENT_FSAL_ERROR;
+      *p_fsal_eof = (offset + *pio_size >= filesize);
+      return *pstatus;
+    }
+
+  while(done < size && offset + done < filesize)
+    {
+      in_block = (offset + done) % block_size;
+      len = block_size - in_block;
+      if(len > size - done)
+        len = size - done;
+
+      P(part->lock);
+      pblock = block_get(part, pfile, (offset + done) / block_size);
+      V(part->lock);
+
+      if(pblock == NULL)
+        {
+          /* The partition is full of dirty or busy blocks */
+          *pfsal_status = block_direct_io(pfd, CACHE_CONTENT_READ, offset + done, len,
+                                          buffer + done, &direct_size);
+          if(FSAL_IS_ERROR(*pfsal_status))
+            break;
+
+          done += direct_size;
+          if(direct_size < len)
+            {
+              filesize = offset + done;
+              break;
+            }
+          continue;
+        }
+
+      *pfsal_status = block_fill(pblock, pfd,
+                                 in_block / CACHE_CONTENT_BLOCK_PAGE_SIZE,
+                                 (in_block + len - 1) / CACHE_CONTENT_BLOCK_PAGE_SIZE,
+                                 &filesize, &nb_hit, &nb_miss);
+
+      if(!FSAL_IS_ERROR(*pfsal_status))
+        {
+          if(offset + done + len > filesize)
+            len = filesize > offset + done ? filesize - (offset + done) : 0;
+
+          memcpy(buffer + done, pblock->data + in_block, len);
+          done += len;
+        }
+
+      P(part->lock);
+      block_put(part, pblock);
+      V(part->lock);
+
+      if(FSAL_IS_ERROR(*pfsal_status))
+        break;
+    }
+
+  P(part->lock);
+  part->stat.nb_read += 1;
+  part->stat.nb_page_hit += nb_hit;
+  part->stat.nb_page_miss += nb_miss;
+  V(part->lock);
+
+  file_end(part, pfile, FALSE);
+
+  if(FSAL_IS_ERROR(*pfsal_status))
+    {
+      *pstatus = CACHE_CONTENT_FSAL_ERROR;
+      return *pstatus;
+    }
+
+  if(filesize < pattr->filesize)
+    pattr->filesize = filesize;
+
+  *pio_size = done;
+  *p_fsal_eof = (offset + done >= filesize);
+
+  return *pstatus;
+}                               /* cache_content_block_read */
+
+/**
+ *
+ * cache_content_block_write: writes file data through the block cache.
+ *
+ * Writes file data through the block cache. If write_back is TRUE, the write
+ * does not extend the file and the partition has room for dirty blocks, the
+ * data are kept in memory until cache_content_block_flush is called. Otherwise
+ * they are written to FSAL at once, and the cached pages are updated.
+ *
+ * @param phandle [IN] FSAL handle of the file.
+ * @param pfd [IN] FSAL file descriptor, opened for reading and writing.
+ * @param pattr [INOUT] attributes of the file, the size is updated if the file grows.
+ * @param offset [IN] where to write.
+ * @param size [IN] how many bytes to write.
+ * @param pio_size [OUT] how many bytes were written.
+ * @param buffer [IN] the data to write.
+ * @param write_back [IN] TRUE if the data can be kept in memory until a flush.
+ * @param pfsal_status [OUT] FSAL status if an FSAL call failed.
+ * @param pstatus [OUT] returned status.
+ *
+ * @return CACHE_CONTENT_SUCCESS if ok, CACHE_CONTENT_FSAL_ERROR if an FSAL call failed.
+ *
+ */
+cache_content_status_t cache_content_block_write(fsal_handle_t * phandle,
+                                                 fsal_file_t * pfd,
+                                                 fsal_attrib_list_t * pattr,
+                                                 fsal_off_t offset,
+                                                 fsal_size_t size,
+                                                 fsal_size_t * pio_size,
+                                                 caddr_t buffer,
+                                                 fsal_boolean_t write_back,
+                                                 fsal_status_t * pfsal_status,
+                                                 cache_content_status_t * pstatus)
+{
+  cache_content_block_partition_t *part;
+  cache_content_block_file_t *pfile;
+  cache_content_block_t *pblock;
+  fsal_size_t filesize = pattr->filesize;
+  fsal_size_t done = 0;
+  fsal_size_t len;
+  fsal_size_t direct_size;
+  size_t in_block;
+  size_t page_start;
+  size_t copy_start;
+  size_t copy_end;
+  unsigned int first;
+  unsigned int last;
+  unsigned int page;
+  unsigned int hashval;
+  unsigned int nb_hit = 0;
+  unsigned int nb_miss = 0;
+  int deferred = FALSE;
+
+  *pstatus = CACHE_CONTENT_SUCCESS;
+  *pio_size = 0;
+  pfsal_status->major = ERR_FSAL_NO_ERROR;
+  pfsal_status->minor = 0;
+
+  if(size == 0)
+    return *pstatus;
+
+  part = partition_of(phandle, &hashval);
+
+  if((pfile = file_begin(part, phandle, hashval, pattr)) == NULL)
+    {
+      *pfsal_status = block_direct_io(pfd, CACHE_CONTENT_WRITE, offset, size, buffer, pio_size);
+      if(FSAL_IS_ERROR(*pfsal_status))
+        *pstatus = CACHE_CONTENT_FSAL_ERROR;
+      else if(offset + *pio_size > pattr->filesize)
+        pattr->filesize = offset + *pio_size;
+      return *pstatus;
+    }
+
+  if(write_back && offset + size <= filesize)
+    {
+      P(part->lock);
+      deferred = (part->nb_dirty_blocks + (offset + size - 1) / block_size - offset / block_size
+                  + 1 <= part->max_dirty_blocks);
+      V(part->lock);
+    }
+
+  if(!deferred)
+    {
+      *pfsal_status = block_direct_io(pfd, CACHE_CONTENT_WRITE, offset, size, buffer, &size);
+      if(FSAL_IS_ERROR(*pfsal_status))
+        {
+          file_end(part, pfile, FALSE);
+          *pstatus = CACHE_CONTENT_FSAL_ERROR;
+          return *pstatus;
+        }
+    }
+
+  while(done < size)
+    {
+      in_block = (offset + done) % block_size;
+      len = block_size - in_block;
+      if(len > size - done)
+        len = size - done;
+
+      first = in_block / CACHE_CONTENT_BLOCK_PAGE_SIZE;
+      last = (in_block + len - 1) / CACHE_CONTENT_BLOCK_PAGE_SIZE;
+
+      P(part->lock);
+      pblock = block_get(part, pfile, (offset + done) / block_size);
+      V(part->lock);
+
+      if(pblock == NULL)
+        {
+          if(deferred)
+            {
+              *pfsal_status = block_direct_io(pfd, CACHE_CONTENT_WRITE, offset + done, len,
+                                              buffer + done, &direct_size);
+              if(FSAL_IS_ERROR(*pfsal_status))
+                break;
+            }
+
+          done += len;
+          continue;
+        }
+
+      if(deferred)
+        {
+          /* Pages partly written must be read first */
+          if(!PAGE_TEST(pblock->valid, first) && in_block % CACHE_CONTENT_BLOCK_PAGE_SIZE)
+            *pfsal_status = block_fill(pblock, pfd, first, first, &filesize, &nb_hit, &nb_miss);
+
+          if(!FSAL_IS_ERROR(*pfsal_status) && !PAGE_TEST(pblock->valid, last)
+             && (in_block + len) % CACHE_CONTENT_BLOCK_PAGE_SIZE)
+            *pfsal_status = block_fill(pblock, pfd, last, last, &filesize, &nb_hit, &nb_miss);
+
+          if(FSAL_IS_ERROR(*pfsal_status))
+            {
+              P(part->lock);
+              block_put(part, pblock);
+              V(part->lock);
+              break;
+            }
+
+          memcpy(pblock->data + in_block, buffer + done, len);
+
+          for(page = first; page <= last; page++)
+            {
+              PAGE_SET(pblock->valid, page);
+              if(!PAGE_TEST(pblock->dirty, page))
+                {
+                  PAGE_SET(pblock->dirty, page);
+                  pblock->nb_dirty += 1;
+                }
+            }
+
+          if(pblock->dirty_end < in_block + len)
+            pblock->dirty_end = in_block + len;
+        }
+      else
+        {
+          /* Update the pages that are valid or fully written */
+          for(page = first; page <= last; page++)
+            {
+              page_start = page * CACHE_CONTENT_BLOCK_PAGE_SIZE;
+              copy_start = page_start > in_block ? page_start : in_block;
+              copy_end = page_start + CACHE_CONTENT_BLOCK_PAGE_SIZE;
+              if(copy_end > in_block + len)
+                copy_end = in_block + len;
+
+              if(copy_end - copy_start == CACHE_CONTENT_BLOCK_PAGE_SIZE)
+                PAGE_SET(pblock->valid, page);
+              else if(!PAGE_TEST(pblock->valid, page))
+                continue;
+
+              memcpy(pblock->data + copy_start, buffer + done + (copy_start - in_block),
+                     copy_end - copy_start);
+            }
+        }
+
+      P(part->lock);
+      block_put(part, pblock);
+      V(part->lock);
+
+      done += len;
+    }
+
+  P(part->lock);
+  part->stat.nb_write += 1;
+  if(deferred)
+    part->stat.nb_write_back += 1;
+  else
+    part->stat.nb_write_through += 1;
+  part->stat.nb_page_hit += nb_hit;
+  part->stat.nb_page_miss += nb_miss;
+  V(part->lock);
+
+  file_end(part, pfile, TRUE);
+
+  if(FSAL_IS_ERROR(*pfsal_status))
+    {
+      *pstatus = CACHE_CONTENT_FSAL_ERROR;
+      return *pstatus;
+    }
+
+  if(offset + size > pattr->filesize)
+    pattr->filesize = offset + size;
+
+  *pio_size = size;
+
+  return *pstatus;
+}                               /* cache_content_block_write */
+
+/* Marks pages [first, last) of a pinned block as clean */
+static void block_clear_dirty(cache_content_block_t * pblock, unsigned int first,
+                              unsigned int last, unsigned int *pnb_flushed)
+{
+  unsigned int page;
+
+  for(page = first; page < last; page++)
+    if(PAGE_TEST(pblock->dirty, page))
+      {
+        PAGE_CLEAR(pblock->dirty, page);
+        pblock->nb_dirty -= 1;
+        *pnb_flushed += 1;
+      }
+}                               /* block_clear_dirty */
+
+/* Writes the dirty runs of a pinned block gathered in segments, with a single FSAL_writev */
+static fsal_status_t block_write_segments(cache_content_block_t * pblock,
+                                          fsal_file_t * pfd,
+                                          fsal_io_segment_t * segments,
+                                          unsigned int *first_page,
+                                          unsigned int *last_page,
+                                          unsigned int nb_segments,
+                                          unsigned int *pnb_flushed)
+{
+  fsal_status_t fsal_status;
+  fsal_size_t written;
+  unsigned int i;
+
+  fsal_status = FSAL_writev(pfd, nb_segments, segments, &written);
+  if(FSAL_IS_ERROR(fsal_status))
+    return fsal_status;
+
+  for(i = 0; i < nb_segments; i++)
+    {
+      if(segments[i].io_amount < segments[i].length)
+        {
+          fsal_status.major = ERR_FSAL_IO;
+          fsal_status.minor = 0;
+          return fsal_status;
+        }
+
+      block_clear_dirty(pblock, first_page[i], last_page[i], pnb_flushed);
+    }
+
+  return fsal_status;
+}                               /* block_write_segments */
+
+/* Writes the dirty pages of a pinned block to FSAL, up to FSAL_IO_MAX_SEGMENTS runs
+ * of contiguous dirty pages per FSAL_writev.
+ * A run goes on over a short gap of valid clean pages when more dirty pages follow:
+ * rewriting the gap costs less than a write call per run (the native FSAL_writev
+ * does one pwritev per run of contiguous segments). */
+static fsal_status_t block_write_dirty(cache_content_block_t * pblock,
+                                       fsal_file_t * pfd, unsigned int *pnb_flushed)
+{
+  fsal_io_segment_t segments[FSAL_IO_MAX_SEGMENTS];
+  unsigned int first_page[FSAL_IO_MAX_SEGMENTS];
+  unsigned int last_page[FSAL_IO_MAX_SEGMENTS];
+  unsigned int nb_segments = 0;
+  fsal_status_t fsal_status;
+  size_t start;
+  size_t end;
+  unsigned int page;
+  unsigned int run;
+  unsigned int gap;
+
+  fsal_status.major = ERR_FSAL_NO_ERROR;
+  fsal_status.minor = 0;
+
+  if(pblock->nb_dirty == 0)
+    return fsal_status;
+
+  for(page = 0; page < block_pages;)
+    {
+      if(!PAGE_TEST(pblock->dirty, page))
+        {
+          page += 1;
+          continue;
+        }
+
+      for(run = page; run < block_pages;)
+        {
+          if(PAGE_TEST(pblock->dirty, run))
+            {
+              run += 1;
+              continue;
+            }
+
+          for(gap = run; gap < block_pages && gap - run < CACHE_CONTENT_BLOCK_MAX_CLEAN_GAP
+              && !PAGE_TEST(pblock->dirty, gap) && PAGE_TEST(pblock->valid, gap); gap++) ;
+
+          if(gap < block_pages && PAGE_TEST(pblock->dirty, gap))
+            run = gap;
+          else
+            break;
+        }
+
+      start = page * CACHE_CONTENT_BLOCK_PAGE_SIZE;
+      end = run * CACHE_CONTENT_BLOCK_PAGE_SIZE;
+
+      /* Never write what is beyond the dirty data: the file would grow */
+      if(end > pblock->dirty_end)
+        end = pblock->dirty_end;
+
+      if(end > start)
+        {
+          segments[nb_segments].offset = pblock->blocknum * block_size + start;
+          segments[nb_segments].length = end - start;
+          segments[nb_segments].buffer = pblock->data + start;
+          first_page[nb_segments] = page;
+          last_page[nb_segments] = run;
+          nb_segments += 1;
+
+          if(nb_segments == FSAL_IO_MAX_SEGMENTS)
+            {
+              fsal_status = block_write_segments(pblock, pfd, segments, first_page,
+                                                 last_page, nb_segments, pnb_flushed);
+              if(FSAL_IS_ERROR(fsal_status))
+                return fsal_status;
+
+              nb_segments = 0;
+            }
+        }
+      else
+        block_clear_dirty(pblock, page, run, pnb_flushed);
+
+      page = run;
+    }
+
+  if(nb_segments > 0)
+    fsal_status = block_write_segments(pblock, pfd, segments, first_page, last_page,
+                                       nb_segments, pnb_flushed);
+
+  return fsal_status;
+}                               /* block_write_dirty */
+
+/**
+ *
+ * cache_content_block_flush: writes the dirty data of a file to FSAL.
+ *
+ * Writes the dirty data of a file to FSAL. This is to be called before
+ * syncing the file, when a client commits its unstable writes.
+ *
+ * @param phandle [IN] FSAL handle of the file.
+ * @param pfd [IN] FSAL file descriptor, opened for writing.
+ * @param pfsal_status [OUT] FSAL status if an FSAL call failed.
+ * @param pstatus [OUT] returned status.
+ *
+ * @return CACHE_CONTENT_SUCCESS if ok, CACHE_CONTENT_FSAL_ERROR if an FSAL call failed.
+ *
+ */
+cache_content_status_t cache_content_block_flush(fsal_handle_t * phandle,
+                                                 fsal_file_t * pfd,
+                                                 fsal_status_t * pfsal_status,
+                                                 cache_content_status_t * pstatus)
+{
+  cache_content_block_partition_t *part;
+  cache_content_block_file_t *pfile;
+  cache_content_block_t *pblock;
+  unsigned int hashval;
+  unsigned int nb_flushed = 0;
+
+  *pstatus = CACHE_CONTENT_SUCCESS;
+  pfsal_status->major = ERR_FSAL_NO_ERROR;
+  pfsal_status->minor = 0;
+
+  if(!cache_content_block_on)
+    return *pstatus;
+
+  part = partition_of(phandle, &hashval);
+
+  P(part->lock);
+
+  if((pfile = file_lookup(part, phandle, hashval, FALSE)) == NULL
+     || pfile->nb_dirty_blocks == 0)
+    {
+      V(part->lock);
+      return *pstatus;
+    }
+
+  pfile->users += 1;
+
+  while(pfile->nb_dirty_blocks > 0)
+    {
+      for(pblock = pfile->blocks; pblock != NULL; pblock = pblock->file_next)
+        if(pblock->nb_dirty > 0 && pblock->refcount == 0)
+          break;
+
+      if(pblock == NULL)
+        break;
+
+      pblock->refcount += 1;
+      V(part->lock);
+
+      *pfsal_status = block_write_dirty(pblock, pfd, &nb_flushed);
+
+      P(part->lock);
+      block_put(part, pblock);
+
+      if(FSAL_IS_ERROR(*pfsal_status))
+        break;
+    }
+
+  part->stat.nb_flushed_pages += nb_flushed;
+  pfile->users -= 1;
+  file_release(part, pfile);
+
+  V(part->lock);
+
+  if(FSAL_IS_ERROR(*pfsal_status))
+    {
+      LogMajor(COMPONENT_CACHE_CONTENT,
+               "cache_content_block_flush: FSAL_write failed, fsal_status.major = %d",
+               pfsal_status->major);
+      *pstatus = CACHE_CONTENT_FSAL_ERROR;
+    }
+
+  return *pstatus;
+}                               /* cache_content_block_flush */
+
+/**
+ *
+ * cache_content_block_invalidate: drops the cached data of a file from an offset.
+ *
+ * Drops the cached data of a file from an offset, dirty data included. This is
+ * to be called when a file is truncated (from its new size) or removed (from 0).
+ *
+ * @param phandle [IN] FSAL handle of the file.
+ * @param from_offset [IN] the data from this offset are dropped.
+ *
+ * @return nothing (void function).
+ *
+ */
+void cache_content_block_invalidate(fsal_handle_t * phandle, fsal_off_t from_offset)
+{
+  cache_content_block_partition_t *part;
+  cache_content_block_file_t *pfile;
+  cache_content_block_t *pblock;
+  unsigned int hashval;
+  unsigned int page;
+  size_t in_block;
+
+  if(!cache_content_block_on)
+    return;
+
+  part = partition_of(phandle, &hashval);
+
+  P(part->lock);
+
+  if((pfile = file_lookup(part, phandle, hashval, FALSE)) == NULL)
+    {
+      V(part->lock);
+      return;
+    }
+
+  /* The block that holds the new end of file keeps its beginning */
+  if(from_offset % block_size)
+    {
+      for(pblock = pfile->blocks; pblock != NULL; pblock = pblock->file_next)
+        if(pblock->blocknum == from_offset / block_size)
+          break;
+
+      if(pblock != NULL && pblock->refcount == 0)
+        {
+          in_block = from_offset % block_size;
+          page = in_block / CACHE_CONTENT_BLOCK_PAGE_SIZE;
+
+          if(in_block % CACHE_CONTENT_BLOCK_PAGE_SIZE)
+            {
+              if(PAGE_TEST(pblock->valid, page))
+                memset(pblock->data + in_block, 0,
+                       (page + 1) * CACHE_CONTENT_BLOCK_PAGE_SIZE - in_block);
+              page += 1;
+            }
+
+          for(; page < block_pages; page++)
+            {
+              PAGE_CLEAR(pblock->valid, page);
+              if(PAGE_TEST(pblock->dirty, page))
+                {
+                  PAGE_CLEAR(pblock->dirty, page);
+                  pblock->nb_dirty -= 1;
+                }
+            }
+
+          if(pblock->dirty_end > in_block)
+            pblock->dirty_end = in_block;
+
+          block_update_state(part, pblock);
+        }
+    }
+
+  file_drop_blocks(part, pfile, (from_offset + block_size - 1) / block_size);
+  file_release(part, pfile);
+
+  V(part->lock);
+}                               /* cache_content_block_invalidate */
+
+/**
+ *
+ * cache_content_block_get_stats: gets the statistics of the block cache.
+ *
+ * @param pstat [OUT] the statistics, summed over the partitions.
+ *
+ * @return nothing (void function).
+ *
+ */
+void cache_content_block_get_stats(cache_content_block_stat_t * pstat)
+{
+  unsigned int i;
+
+  memset(pstat, 0, sizeof(cache_content_block_stat_t));
+
+  if(!cache_content_block_on)
+    return;
+
+  for(i = 0; i < CACHE_CONTENT_BLOCK_NB_PARTITIONS; i++)
+    {
+      P(partitions[i].lock);
+
+      pstat->nb_read += partitions[i].stat.nb_read;
+      pstat->nb_write += partitions[i].stat.nb_write;
+      pstat->nb_page_hit += partitions[i].stat.nb_page_hit;
+      pstat->nb_page_miss += partitions[i].stat.nb_page_miss;
+      pstat->nb_write_back += partitions[i].stat.nb_write_back;
+      pstat->nb_write_through += partitions[i].stat.nb_write_through;
+      pstat->nb_flushed_pages += partitions[i].stat.nb_flushed_pages;
+      pstat->nb_evicted += partitions[i].stat.nb_evicted;
+      pstat->nb_invalidated += partitions[i].stat.nb_invalidated;
+      pstat->nb_blocks += partitions[i].nb_blocks;
+      pstat->nb_dirty_blocks += partitions[i].nb_dirty_blocks;
+
+      V(partitions[i].lock);
+    }
+}                               /* cache_content_block_get_stats */
@@ -0,0 +1,875 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * \file    cache_content_manifest.c
+ * \brief   Management of the file content cache: manifest of the cached entries.
+ *
+ * cache_content_manifest.c : Management of the file content cache, manifest of the cached entries.
+ *
+ * The fileids of the entries in the local data cache are logged in an append-only
+ * file, <cache_dir>/export_id=0/manifest, made of fixed size records (ADD or DEL).
+ * The manifest is rewritten with only the live entries when the records of removed
+ * entries make up more than half of it.
+ *
+ * At startup, the manifest is replayed by Recovery_Threads threads into an
+ * in-memory set, partitioned by fileid. The data cache entries are then recovered
+ * lazily, when cache_inode_new_entry meets the file, and the set spares a stat
+ * in the local cache to every file which is not data cached. A data cache built
+ * before the manifest existed is scanned once, with one thread per part of the
+ * directory tree, and the manifest is written from what was found.
+ *
+ * An ADD record is written before the index file of the entry is created, a DEL
+ * record after its files are removed: the manifest may list entries that are no
+ * longer in the local cache, never the opposite. If a record can not be written,
+ * the manifest is removed and the local cache is scanned at the next startup.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef _SOLARIS
+#include "solaris_port.h"
+#endif                          /* _SOLARIS */
+
+#include "LRU_List.h"
+#include "log_macros.h"
+#include "HashData.h"
+#include "HashTable.h"
+#include "fsal.h"
+#include "cache_inode.h"
+#include "cache_content.h"
+#include "stuff_alloc.h"
+#include "nfs_exports.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/param.h>
+#include <pthread.h>
+#include <errno.h>
+#include <dirent.h>
+#include <string.h>
+
+#define CACHE_CONTENT_MANIFEST_MAGIC      0x4d4e4631  /* "MNF1" */
+#define CACHE_CONTENT_MANIFEST_ADD        1
+#define CACHE_CONTENT_MANIFEST_DEL        2
+
+#define CACHE_CONTENT_MANIFEST_EMPTY      0ULL
+#define CACHE_CONTENT_MANIFEST_DELETED    (~0ULL)
+
+#define CACHE_CONTENT_MANIFEST_MIN_SLOTS  64
+#define CACHE_CONTENT_MANIFEST_MIN_GARBAGE 4096       /**< records before a rewrite is worth it */
+#define CACHE_CONTENT_MANIFEST_WRITE_BUFF 512         /**< records written at once by a rewrite */
+
+typedef struct cache_content_manifest_record__
+{
+  u_int32_t op;                                           /**< MAGIC (header), ADD or DEL           */
+  u_int32_t reserved;
+  u_int64_t fileid4;                                      /**< fileid of the cached entry           */
+} cache_content_manifest_record_t;
+
+typedef struct cache_content_manifest_partition__
+{
+  pthread_mutex_t lock;
+  u_int64_t *slots;                                       /**< open addressing set of fileids       */
+  unsigned int nb_slots;                                  /**< a power of 2                         */
+  unsigned int nb_used;                                   /**< live and deleted slots               */
+  unsigned int nb_live;
+} cache_content_manifest_partition_t;
+
+typedef struct cache_content_manifest_thread_arg__
+{
+  unsigned int index;
+  cache_content_manifest_record_t *records;               /**< replay: the mapped manifest          */
+  size_t nb_records;
+  char *export_dir;                                       /**< scan: the local cache directory      */
+  unsigned int nb_found;
+  int rc;
+} cache_content_manifest_thread_arg_t;
+
+static int manifest_enabled = FALSE;
+static char manifest_path[MAXPATHLEN];
+static char manifest_new_path[MAXPATHLEN];
+static int manifest_fd = -1;
+static unsigned long long manifest_nb_records = 0;        /**< records in the manifest file         */
+static unsigned long long manifest_nb_live = 0;           /**< entries in the set                   */
+
+/* Protects the manifest file and the counters, taken before a partition lock */
+static pthread_mutex_t manifest_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned int nb_partitions = 0;
+static cache_content_manifest_partition_t *partitions = NULL;
+
+static u_int64_t manifest_hash(u_int64_t fileid4)
+{
+  return fileid4 * 0x9E3779B97F4A7C15ULL;
+}
+
+static cache_content_manifest_partition_t *manifest_partition(u_int64_t fileid4)
+{
+  return &partitions[(manifest_hash(fileid4) >> 48) % nb_partitions];
+}
+
+/**
+ *
+ * manifest_part_resize: rehashes the live fileids of a partition in a new slot array.
+ *
+ * @param ppart    [INOUT] the partition, locked.
+ * @param nb_slots [IN]    the new number of slots, a power of 2.
+ *
+ * @return 0 if ok, -1 if the slots could not be allocated.
+ *
+ */
+static int manifest_part_resize(cache_content_manifest_partition_t * ppart,
+                                unsigned int nb_slots)
+{
+  u_int64_t *slots;
+  unsigned int i, slot;
+
+  if((slots = (u_int64_t *) Mem_Calloc_Label(nb_slots, sizeof(u_int64_t),
+                                             "cache_content_manifest slots")) == NULL)
+    return -1;
+
+  for(i = 0; i < ppart->nb_slots; i++)
+    {
+      if(ppart->slots[i] == CACHE_CONTENT_MANIFEST_EMPTY ||
+         ppart->slots[i] == CACHE_CONTENT_MANIFEST_DELETED)
+        continue;
+
+      slot = (unsigned int)(manifest_hash(ppart->slots[i]) >> 16) & (nb_slots - 1);
+      while(slots[slot] != CACHE_CONTENT_MANIFEST_EMPTY)
+        slot = (slot + 1) & (nb_slots - 1);
+      slots[slot] = ppart->slots[i];
+    }
+
+  if(ppart->slots != NULL)
+    Mem_Free(ppart->slots);
+
+  ppart->slots = slots;
+  ppart->nb_slots = nb_slots;
+  ppart->nb_used = ppart->nb_live;
+
+  return 0;
+}                               /* manifest_part_resize */
+
+/**
+ *
+ * manifest_part_insert: adds a fileid to a partition.
+ *
+ * @param ppart   [INOUT] the partition, locked.
+ * @param fileid4 [IN]    the fileid.
+ *
+ * @return 1 if the fileid was added, 0 if it was already there, -1 if out of memory.
+ *
+ */
+static int manifest_part_insert(cache_content_manifest_partition_t * ppart,
+                                u_int64_t fileid4)
+{
+  unsigned int slot, nb_slots;
+  int free_slot = -1;
+
+  if(2 * (ppart->nb_used + 1) > ppart->nb_slots)
+    {
+      /* grow if most of the used slots are live, else just drop the deleted ones */
+      nb_slots = (ppart->nb_slots < CACHE_CONTENT_MANIFEST_MIN_SLOTS) ?
+          CACHE_CONTENT_MANIFEST_MIN_SLOTS : ppart->nb_slots;
+      while(4 * (ppart->nb_live + 1) > nb_slots)
+        nb_slots *= 2;
+
+      if(manifest_part_resize(ppart, nb_slots) != 0)
+        return -1;
+    }
+
+  slot = (unsigned int)(manifest_hash(fileid4) >> 16) & (ppart->nb_slots - 1);
+
+  while(ppart->slots[slot] != CACHE_CONTENT_MANIFEST_EMPTY)
+    {
+      if(ppart->slots[slot] == fileid4)
+        return 0;
+
+      if(ppart->slots[slot] == CACHE_CONTENT_MANIFEST_DELETED && free_slot == -1)
+        free_slot = slot;
+
+      slot = (slot + 1) & (ppart->nb_slots - 1);
+    }
+
+  if(free_slot == -1)
+    {
+      free_slot = slot;
+      ppart->nb_used += 1;
+    }
+
+  ppart->slots[free_slot] = fileid4;
+  ppart->nb_live += 1;
+
+  return 1;
+}                               /* manifest_part_insert */
+
+/**
+ *
+ * manifest_part_find: finds the slot of a fileid in a partition.
+ *
+ * @param ppart   [IN] the partition, locked.
+ * @param fileid4 [IN] the fileid.
+ *
+ * @return the slot, or -1 if the fileid is not in the partition.
+ *
+ */
+static int manifest_part_find(cache_content_manifest_partition_t * ppart,
+                              u_int64_t fileid4)
+{
+  unsigned int slot;
+
+  if(ppart->nb_slots == 0)
+    return -1;
+
+  slot = (unsigned int)(manifest_hash(fileid4) >> 16) & (ppart->nb_slots - 1);
+
+  while(ppart->slots[slot] != CACHE_CONTENT_MANIFEST_EMPTY)
+    {
+      if(ppart->slots[slot] == fileid4)
+        return slot;
+
+      slot = (slot + 1) & (ppart->nb_slots - 1);
+    }
+
+  return -1;
+}                               /* manifest_part_find */
+
+/**
+ *
+ * manifest_part_remove: removes a fileid from a partition.
+ *
+ * @param ppart   [INOUT] the partition, locked.
+ * @param fileid4 [IN]    the fileid.
+ *
+ * @return 1 if the fileid was removed, 0 if it was not there.
+ *
+ */
+static int manifest_part_remove(cache_content_manifest_partition_t * ppart,
+                                u_int64_t fileid4)
+{
+  int slot;
+
+  if((slot = manifest_part_find(ppart, fileid4)) < 0)
+    return 0;
+
+  ppart->slots[slot] = CACHE_CONTENT_MANIFEST_DELETED;
+  ppart->nb_live -= 1;
+
+  return 1;
+}                               /* manifest_part_remove */
+
+/**
+ *
+ * manifest_disable: stops using the manifest after an I/O error.
+ *
+ * The manifest file is removed, so that the local cache is scanned at next startup.
+ * Must be called with manifest_mutex held.
+ *
+ */
+static void manifest_disable(void)
+{
+  LogCrit(COMPONENT_CACHE_CONTENT,
+          "cache_content_manifest: could not update %s, errno=%d (%s). The data cache will be scanned at next startup",
+          manifest_path, errno, strerror(errno));
+
+  manifest_enabled = FALSE;
+
+  if(manifest_fd >= 0)
+    close(manifest_fd);
+  manifest_fd = -1;
+
+  unlink(manifest_path);
+}                               /* manifest_disable */
+
+/**
+ *
+ * manifest_rewrite: writes a new manifest with the live entries only.
+ *
+ * The new manifest is written aside and renamed over the old one.
+ * Must be called with manifest_mutex held.
+ *
+ * @return 0 if ok, -1 otherwise.
+ *
+ */
+static int manifest_rewrite(void)
+{
+  cache_content_manifest_record_t buff[CACHE_CONTENT_MANIFEST_WRITE_BUFF];
+  unsigned int nb_buff = 0;
+  unsigned long long nb_written = 0;
+  unsigned int i, j;
+  int fd, rc = 0;
+
+  if((fd = open(manifest_new_path, O_WRONLY | O_CREAT | O_TRUNC, 0640)) < 0)
+    return -1;
+
+  memset(buff, 0, sizeof(buff));
+  buff[nb_buff++].op = CACHE_CONTENT_MANIFEST_MAGIC;
+
+  for(i = 0; i < nb_partitions && rc == 0; i++)
+    {
+      P(partitions[i].lock);
+
+      for(j = 0; j < partitions[i].nb_slots && rc == 0; j++)
+        {
+          if(partitions[i].slots[j] == CACHE_CONTENT_MANIFEST_EMPTY ||
+             partitions[i].slots[j] == CACHE_CONTENT_MANIFEST_DELETED)
+            continue;
+
+          buff[nb_buff].op = CACHE_CONTENT_MANIFEST_ADD;
+          buff[nb_buff].fileid4 = partitions[i].slots[j];
+          nb_buff += 1;
+          nb_written += 1;
+
+          if(nb_buff == CACHE_CONTENT_MANIFEST_WRITE_BUFF)
+            {
+              if(write(fd, buff, sizeof(buff)) != sizeof(buff))
+                rc = -1;
+              nb_buff = 0;
+            }
+        }
+
+      V(partitions[i].lock);
+    }
+
+  if(rc == 0 && nb_buff > 0 &&
+     write(fd, buff, nb_buff * sizeof(cache_content_manifest_record_t)) !=
+     (ssize_t) (nb_buff * sizeof(cache_content_manifest_record_t)))
+    rc = -1;
+
+  if(rc == 0)
+    rc = fsync(fd);
+
+  close(fd);
+
+  if(rc == 0)
+    rc = rename(manifest_new_path, manifest_path);
+
+  if(rc != 0)
+    {
+      unlink(manifest_new_path);
+      return -1;
+    }
+
+  if(manifest_fd >= 0)
+    close(manifest_fd);
+
+  if((manifest_fd = open(manifest_path, O_WRONLY | O_APPEND)) < 0)
+    return -1;
+
+  manifest_nb_records = nb_written;
+
+  LogDebug(COMPONENT_CACHE_CONTENT, "cache_content_manifest: %llu entries in %s",
+           nb_written, manifest_path);
+
+  return 0;
+}                               /* manifest_rewrite */
+
+/**
+ *
+ * manifest_append: logs an operation on an entry.
+ *
+ * Must be called with manifest_mutex held.
+ *
+ * @param op      [IN] CACHE_CONTENT_MANIFEST_ADD or CACHE_CONTENT_MANIFEST_DEL.
+ * @param fileid4 [IN] the fileid of the entry.
+ *
+ */
+static void manifest_append(u_int32_t op, u_int64_t fileid4)
+{
+  cache_content_manifest_record_t record;
+
+  record.op = op;
+  record.reserved = 0;
+  record.fileid4 = fileid4;
+
+  if(write(manifest_fd, &record, sizeof(record)) != sizeof(record))
+    {
+      manifest_disable();
+      return;
+    }
+
+  manifest_nb_records += 1;
+
+  if(manifest_nb_records > 2 * manifest_nb_live + CACHE_CONTENT_MANIFEST_MIN_GARBAGE)
+    if(manifest_rewrite() != 0)
+      manifest_disable();
+}                               /* manifest_append */
+
+/**
+ *
+ * manifest_replay_thread: replays the records of the manifest that belong to some partitions.
+ *
+ * Thread #i owns the partitions whose index modulo the number of threads is i, so
+ * the records of a given fileid are applied in order, by a single thread.
+ *
+ * @param arg [INOUT] the thread's cache_content_manifest_thread_arg_t.
+ *
+ * @return NULL
+ *
+ */
+static void *manifest_replay_thread(void *arg)
+{
+  cache_content_manifest_thread_arg_t *parg = (cache_content_manifest_thread_arg_t *) arg;
+  cache_content_manifest_partition_t *ppart;
+  unsigned int nb_threads = nb_partitions;
+  size_t i;
+
+#ifndef _NO_BUDDY_SYSTEM
+  if(BuddyInit(NULL) != BUDDY_SUCCESS)
+    {
+      parg->rc = -1;
+      return NULL;
+    }
+#endif
+
+  /* record #0 is the header */
+  for(i = 1; i < parg->nb_records; i++)
+    {
+      ppart = manifest_partition(parg->records[i].fileid4);
+
+      if((ppart - partitions) % nb_threads != parg->index)
+        continue;
+
+      switch (parg->records[i].op)
+        {
+        case CACHE_CONTENT_MANIFEST_ADD:
+          if(manifest_part_insert(ppart, parg->records[i].fileid4) < 0)
+            {
+              parg->rc = -1;
+              return NULL;
+            }
+          break;
+
+        case CACHE_CONTENT_MANIFEST_DEL:
+          manifest_part_remove(ppart, parg->records[i].fileid4);
+          break;
+
+        default:
+          LogCrit(COMPONENT_CACHE_CONTENT,
+                  "cache_content_manifest: bad record #%llu in %s",
+                  (unsigned long long)i, manifest_path);
+          parg->rc = -1;
+          return NULL;
+        }
+    }
+
+  parg->rc = 0;
+  return NULL;
+}                               /* manifest_replay_thread */
+
+/**
+ *
+ * manifest_scan_thread: adds the entries found in a part of the local cache.
+ *
+ * @param arg [INOUT] the thread's cache_content_manifest_thread_arg_t.
+ *
+ * @return NULL
+ *
+ */
+static void *manifest_scan_thread(void *arg)
+{
+  cache_content_manifest_thread_arg_t *parg = (cache_content_manifest_thread_arg_t *) arg;
+  cache_content_manifest_partition_t *ppart;
+  cache_content_dirinfo_t directory;
+  struct dirent dirent_entry;
+  u_int64_t inum;
+  int rc;
+
+#ifndef _NO_BUDDY_SYSTEM
+  if(BuddyInit(NULL) != BUDDY_SUCCESS)
+    {
+      parg->rc = -1;
+      return NULL;
+    }
+#endif
+
+  if(cache_content_local_cache_opendir(parg->export_dir, &directory) == FALSE)
+    {
+      parg->rc = -1;
+      return NULL;
+    }
+
+  parg->rc = 0;
+
+  while(cache_content_local_cache_dir_iter(&directory, &dirent_entry,
+                                           parg->index, nb_partitions))
+    {
+      if((inum = cache_content_get_inum(dirent_entry.d_name)) == 0)
+        continue;
+
+      ppart = manifest_partition(inum);
+
+      P(ppart->lock);
+      rc = manifest_part_insert(ppart, inum);
+      V(ppart->lock);
+
+      if(rc < 0)
+        {
+          parg->rc = -1;
+          break;
+        }
+
+      parg->nb_found += rc;
+    }
+
+  cache_content_local_cache_closedir(&directory);
+
+  return NULL;
+}                               /* manifest_scan_thread */
+
+/**
+ *
+ * manifest_run_threads: runs the replay or the scan on nb_partitions threads.
+ *
+ * @param func [IN]    the thread function.
+ * @param args [INOUT] one argument per thread, index filled here.
+ *
+ * @return 0 if all the threads succeeded, -1 otherwise.
+ *
+ */
+static int manifest_run_threads(void *(*func) (void *),
+                                cache_content_manifest_thread_arg_t * args)
+{
+  pthread_t thrid[CACHE_CONTENT_MANIFEST_MAX_THREADS];
+  pthread_attr_t attr_thr;
+  unsigned int i;
+  int rc = 0;
+
+  pthread_attr_init(&attr_thr);
+  pthread_attr_setscope(&attr_thr, PTHREAD_SCOPE_SYSTEM);
+  pthread_attr_setdetachstate(&attr_thr, PTHREAD_CREATE_JOINABLE);
+
+  for(i = 0; i < nb_partitions; i++)
+    {
+      args[i].index = i;
+      args[i].rc = -1;
+
+      if(pthread_create(&thrid[i], &attr_thr, func, &args[i]) != 0)
+        {
+          LogCrit(COMPONENT_CACHE_CONTENT,
+                  "cache_content_manifest: could not start recovery thread #%u", i);
+          break;
+        }
+    }
+
+  while(i > 0)
+    {
+      i -= 1;
+      pthread_join(thrid[i], NULL);
+      if(args[i].rc != 0)
+        rc = -1;
+    }
+
+  return rc;
+}                               /* manifest_run_threads */
+
+/**
+ *
+ * manifest_load: rebuilds the set of the cached entries from the manifest or from the local cache.
+ *
+ * @param export_dir [IN] the directory of the local cache.
+ *
+ * @return 0 if ok, -1 otherwise.
+ *
+ */
+static int manifest_load(char *export_dir)
+{
+  cache_content_manifest_thread_arg_t args[CACHE_CONTENT_MANIFEST_MAX_THREADS];
+  struct stat buffstat;
+  void *map;
+  size_t nb_records;
+  unsigned int i;
+  int fd, rc;
+
+  memset(args, 0, sizeof(args));
+
+  if((fd = open(manifest_path, O_RDONLY)) >= 0)
+    {
+      if(fstat(fd, &buffstat) != 0)
+        {
+          close(fd);
+          return -1;
+        }
+
+      /* a record torn by a crash is ignored */
+      nb_records = buffstat.st_size / sizeof(cache_content_manifest_record_t);
+
+      if(nb_records > 0 &&
+         (map = mmap(NULL, nb_records * sizeof(cache_content_manifest_record_t),
+                     PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED)
+        {
+          if(((cache_content_manifest_record_t *) map)->op == CACHE_CONTENT_MANIFEST_MAGIC)
+            {
+              LogEvent(COMPONENT_CACHE_CONTENT,
+                       "cache_content_manifest: replaying %llu records of %s with %u threads",
+                       (unsigned long long)nb_records, manifest_path, nb_partitions);
+
+              for(i = 0; i < nb_partitions; i++)
+                {
+                  args[i].records = (cache_content_manifest_record_t *) map;
+                  args[i].nb_records = nb_records;
+                }
+
+              rc = manifest_run_threads(manifest_replay_thread, args);
+
+              munmap(map, nb_records * sizeof(cache_content_manifest_record_t));
+              close(fd);
+
+              return rc;
+            }
+
+          munmap(map, nb_records * sizeof(cache_content_manifest_record_t));
+        }
+
+      close(fd);
+
+      LogCrit(COMPONENT_CACHE_CONTENT,
+              "cache_content_manifest: %s is not a manifest, scanning the data cache",
+              manifest_path);
+    }
+  else if(errno != ENOENT)
+    return -1;
+
+  /* No manifest yet: find the entries in the local cache */
+  LogEvent(COMPONENT_CACHE_CONTENT,
+           "cache_content_manifest: scanning %s with %u threads", export_dir,
+           nb_partitions);
+
+  for(i = 0; i < nb_partitions; i++)
+    args[i].export_dir = export_dir;
+
+  return manifest_run_threads(manifest_scan_thread, args);
+}                               /* manifest_load */
+
+/**
+ *
+ * cache_content_manifest_init: loads the manifest of the local data cache.
+ *
+ * Nothing is done if no export entry is data cached.
+ *
+ * @param pexportlist [IN]  export list.
+ * @param cache_dir   [IN]  root of the local data cache.
+ * @param nb_threads  [IN]  number of threads for replaying the manifest.
+ * @param pstatus     [OUT] returned status.
+ *
+ * @return CACHE_CONTENT_SUCCESS if ok, CACHE_CONTENT_LOCAL_CACHE_ERROR otherwise.
+ *
+ */
+cache_content_status_t cache_content_manifest_init(exportlist_t * pexportlist,
+                                                   char *cache_dir,
+                                                   unsigned int nb_threads,
+                                                   cache_content_status_t * pstatus)
+{
+  exportlist_t *pexport = NULL;
+  char export_dir[MAXPATHLEN];
+  unsigned int i;
+
+  *pstatus = CACHE_CONTENT_SUCCESS;
+
+  for(pexport = pexportlist; pexport != NULL; pexport = pexport->next)
+    if(pexport->options & EXPORT_OPTION_USE_DATACACHE)
+      break;
+
+  if(pexport == NULL)
+    return *pstatus;
+
+  if(nb_threads == 0)
+    nb_threads = 1;
+  if(nb_threads > CACHE_CONTENT_MANIFEST_MAX_THREADS)
+    nb_threads = CACHE_CONTENT_MANIFEST_MAX_THREADS;
+
+  /* The data cache keeps all its entries under export_id=0, whatever their export:
+   * a single manifest covers them all */
+  if(snprintf(export_dir, MAXPATHLEN, "%s/export_id=%d", cache_dir, 0) >= MAXPATHLEN ||
+     snprintf(manifest_path, MAXPATHLEN, "%s/manifest", export_dir) >= MAXPATHLEN ||
+     snprintf(manifest_new_path, MAXPATHLEN, "%s/manifest.new", export_dir) >= MAXPATHLEN)
+    {
+      LogCrit(COMPONENT_CACHE_CONTENT,
+              "cache_content_manifest: path of the manifest in %s is too long", cache_dir);
+      *pstatus = CACHE_CONTENT_LOCAL_CACHE_ERROR;
+      return *pstatus;
+    }
+
+  nb_partitions = nb_threads;
+
+  if((partitions =
+      (cache_content_manifest_partition_t *) Mem_Calloc_Label(nb_partitions,
+                                                              sizeof
+                                                              (cache_content_manifest_partition_t),
+                                                              "cache_content_manifest partitions"))
+     == NULL)
+    {
+      *pstatus = CACHE_CONTENT_MALLOC_ERROR;
+      return *pstatus;
+    }
+
+  for(i = 0; i < nb_partitions; i++)
+    pthread_mutex_init(&partitions[i].lock, NULL);
+
+  if(manifest_load(export_dir) != 0)
+    {
+      LogCrit(COMPONENT_CACHE_CONTENT,
+              "cache_content_manifest: could not load the entries of the data cache");
+      *pstatus = CACHE_CONTENT_LOCAL_CACHE_ERROR;
+      return *pstatus;
+    }
+
+  for(i = 0; i < nb_partitions; i++)
+    manifest_nb_live += partitions[i].nb_live;
+
+  /* Start from a compact manifest */
+  P(manifest_mutex);
+
+  if(manifest_rewrite() != 0)
+    {
+      LogCrit(COMPONENT_CACHE_CONTENT,
+              "cache_content_manifest: could not write %s, errno=%d (%s)",
+              manifest_path, errno, strerror(errno));
+      V(manifest_mutex);
+
+      *pstatus = CACHE_CONTENT_LOCAL_CACHE_ERROR;
+      return *pstatus;
+    }
+
+  manifest_enabled = TRUE;
+
+  V(manifest_mutex);
+
+  LogEvent(COMPONENT_CACHE_CONTENT,
+           "cache_content_manifest: %llu entries in the data cache, recovered on first access",
+           manifest_nb_live);
+
+  return *pstatus;
+}                               /* cache_content_manifest_init */
+
+/**
+ *
+ * cache_content_manifest_add: logs a new entry in the manifest.
+ *
+ * To be called before the files of the entry are created in the local cache.
+ *
+ * @param fileid4 [IN] the fileid of the entry.
+ *
+ */
+void cache_content_manifest_add(u_int64_t fileid4)
+{
+  cache_content_manifest_partition_t *ppart;
+  int rc;
+
+  if(!manifest_enabled || fileid4 == CACHE_CONTENT_MANIFEST_EMPTY ||
+     fileid4 == CACHE_CONTENT_MANIFEST_DELETED)
+    return;
+
+  ppart = manifest_partition(fileid4);
+
+  P(manifest_mutex);
+
+  if(manifest_enabled)
+    {
+      P(ppart->lock);
+      rc = manifest_part_insert(ppart, fileid4);
+      V(ppart->lock);
+
+      if(rc < 0)
+        manifest_disable();
+      else if(rc > 0)
+        {
+          manifest_nb_live += 1;
+          manifest_append(CACHE_CONTENT_MANIFEST_ADD, fileid4);
+        }
+    }
+
+  V(manifest_mutex);
+}                               /* cache_content_manifest_add */
+
+/**
+ *
+ * cache_content_manifest_remove: logs the removal of an entry in the manifest.
+ *
+ * To be called after the files of the entry are removed from the local cache.
+ *
+ * @param fileid4 [IN] the fileid of the entry.
+ *
+ */
+void cache_content_manifest_remove(u_int64_t fileid4)
+{
+  cache_content_manifest_partition_t *ppart;
+  int rc;
+
+  if(!manifest_enabled)
+    return;
+
+  ppart = manifest_partition(fileid4);
+
+  P(manifest_mutex);
+
+  if(manifest_enabled)
+    {
+      P(ppart->lock);
+      rc = manifest_part_remove(ppart, fileid4);
+      V(ppart->lock);
+
+      if(rc > 0)
+        {
+          manifest_nb_live -= 1;
+          manifest_append(CACHE_CONTENT_MANIFEST_DEL, fileid4);
+        }
+    }
+
+  V(manifest_mutex);
+}                               /* cache_content_manifest_remove */
+
+/**
+ *
+ * cache_content_manifest_lookup: tells if an entry may be in the local data cache.
+ *
+ * @param fileid4 [IN] the fileid of the entry.
+ *
+ * @return FALSE if the entry is not in the local cache, TRUE if it may be there.
+ *
+ */
+int cache_content_manifest_lookup(u_int64_t fileid4)
+{
+  cache_content_manifest_partition_t *ppart;
+  int found;
+
+  if(!manifest_enabled || fileid4 == CACHE_CONTENT_MANIFEST_EMPTY ||
+     fileid4 == CACHE_CONTENT_MANIFEST_DELETED)
+    return TRUE;
+
+  ppart = manifest_partition(fileid4);
+
+  P(ppart->lock);
+  found = (manifest_part_find(ppart, fileid4) >= 0);
+  V(ppart->lock);
+
+  return found;
+}                               /* cache_content_manifest_lookup */
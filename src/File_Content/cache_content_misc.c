@@ -183,6 +183,34 @@ cache_content_status_t cache_content_create_name(char *path,
   return CACHE_CONTENT_SUCCESS;
 }                               /* cache_content_create_name */
 
+/**
+ *
+ * cache_content_get_fileid4: gets the fileid used for naming the cached files of an entry.
+ *
+ * @param pentry_inode [IN] Entry in Cache inode layer.
+ * @param pcontext     [IN] the related FSAL Context
+ *
+ * @return the fileid, or 0 if it could not be computed.
+ *
+ */
+u_int64_t cache_content_get_fileid4(cache_entry_t * pentry_inode,
+                                    fsal_op_context_t * pcontext)
+{
+  u_int64_t fileid4;
+  fsal_handle_t *pfsal_handle = NULL;
+  cache_inode_status_t cache_status;
+
+  if((pfsal_handle = cache_inode_get_fsal_handle(pentry_inode, &cache_status)) == NULL)
+    return 0;
+
+  if(FSAL_IS_ERROR(FSAL_DigestHandle(FSAL_GET_EXP_CTX(pcontext),
+                                     FSAL_DIGEST_FILEID4, pfsal_handle,
+                                     (caddr_t) & fileid4)))
+    return 0;
+
+  return fileid4;
+}                               /* cache_content_get_fileid4 */
+
 /**
  *
  * cache_content_get_export_id: gets an export id from an export dirname. 
@@ -708,6 +736,14 @@ cache_content_status_t cache_content_test_cached(cache_entry_t * pentry_inode,
       return *pstatus;
     }
 
+  /* Most files are not in the data cache: the manifest tells it without a stat */
+  if(cache_content_manifest_lookup(cache_content_get_fileid4(pentry_inode, pcontext)) ==
+     FALSE)
+    {
+      *pstatus = CACHE_CONTENT_NOT_FOUND;
+      return CACHE_CONTENT_NOT_FOUND;
+    }
+
   /* Build the cache index path */
   if((*pstatus = cache_content_create_name(cache_path_index,
                                            CACHE_CONTENT_INDEX_FILE,
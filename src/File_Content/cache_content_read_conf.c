@@ -58,6 +58,7 @@
 #include <time.h>
 #include <pthread.h>
 #include <string.h>
+#include <stdlib.h>
 
 char fcc_log_path[MAXPATHLEN];
 int fcc_debug_level = -1;
@@ -169,6 +170,18 @@ cache_content_status_t cache_content_read_conf_client_parameter(config_file_t in
         {
           pparam->use_cache = StrToBoolean(key_value);
         }
+      else if(!strcasecmp(key_name, "Block_Cache_Size"))
+        {
+          pparam->block_cache_size = strtoull(key_value, NULL, 10);
+        }
+      else if(!strcasecmp(key_name, "Block_Size"))
+        {
+          pparam->block_size = strtoull(key_value, NULL, 10);
+        }
+      else if(!strcasecmp(key_name, "Recovery_Threads"))
+        {
+          pparam->nb_recovery_threads = atoi(key_value);
+        }
       else
         {
           fprintf(stderr,
@@ -220,6 +233,12 @@ void cache_content_print_conf_client_parameter(FILE * output,
   fprintf(output, "FileContent Client: Entry_Prealloc_PoolSize = %d\n",
           param.nb_prealloc_entry);
   fprintf(output, "FileContent Client: Cache Directory         = %s\n", param.cache_dir);
+  fprintf(output, "FileContent Client: Block_Cache_Size        = %llu\n",
+          (unsigned long long)param.block_cache_size);
+  fprintf(output, "FileContent Client: Block_Size              = %llu\n",
+          (unsigned long long)param.block_size);
+  fprintf(output, "FileContent Client: Recovery_Threads        = %u\n",
+          param.nb_recovery_threads);
 }                               /* cache_content_print_conf_client_parameter */
 
 /**
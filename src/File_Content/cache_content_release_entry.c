@@ -80,6 +80,8 @@ cache_content_status_t cache_content_release_entry(cache_content_entry_t * pentr
                                                    cache_content_client_t * pclient,
                                                    cache_content_status_t * pstatus)
 {
+  u_int64_t inum;
+
   /* By default, operation status is successful */
   *pstatus = CACHE_CONTENT_SUCCESS;
 
@@ -96,6 +98,8 @@ cache_content_status_t cache_content_release_entry(cache_content_entry_t * pentr
       pentry->local_fs_entry.opened_file.last_op = 0;
     }
 
+  inum = cache_content_get_inum(pentry->local_fs_entry.cache_path_index);
+
   /* Finally puts the entry back to entry pool for future use */
   ReleaseToPool(pentry, &pclient->content_pool);
 
@@ -118,5 +122,7 @@ cache_content_status_t cache_content_release_entry(cache_content_entry_t * pentr
                           pentry->local_fs_entry.cache_path_data, errno, strerror(errno));
     }
 
+  cache_content_manifest_remove(inum);
+
   return *pstatus;
 }                               /* cache_content_release_entry */
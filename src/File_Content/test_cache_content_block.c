@@ -0,0 +1,369 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ * Test for the block cache of the File Content layer
+ *
+ * The file is a buffer in memory: FSAL_read, FSAL_write and FSAL_writev are
+ * replaced by stubs working on it, and the handle functions by stubs working
+ * on a file number. The file hashes to a single partition of 4 blocks of 4
+ * pages, at most 2 of them dirty.
+ * The test checks a partial-page write back, the write back of the dirty
+ * pages by cache_content_block_flush, and that a block pinned by a read in
+ * progress is not evicted while other reads recycle the blocks of the
+ * partition.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "BuddyMalloc.h"
+#include "LRU_List.h"
+#include "log_macros.h"
+#include "HashData.h"
+#include "HashTable.h"
+#include "fsal.h"
+#include "cache_inode.h"
+#include "cache_content.h"
+
+#define PAGE_SIZE_TEST  CACHE_CONTENT_BLOCK_PAGE_SIZE
+#define BLOCK_SIZE_TEST (4 * PAGE_SIZE_TEST)
+#define NB_FILE_BLOCKS  16
+#define FILE_SIZE_TEST  (NB_FILE_BLOCKS * BLOCK_SIZE_TEST)
+
+/* 16 partitions of 4 blocks */
+#define CACHE_SIZE_TEST (16 * 4 * BLOCK_SIZE_TEST)
+
+static char file_data[FILE_SIZE_TEST];      /* the file, as FSAL sees it      */
+static char expected[FILE_SIZE_TEST];       /* the file, as the client sees it */
+
+static fsal_handle_t handle;
+static fsal_file_t fd;
+static fsal_attrib_list_t attr;
+
+static unsigned int nb_fsal_read = 0;
+static unsigned int nb_fsal_writev = 0;
+static unsigned int nb_fsal_segments = 0;
+
+/* Block whose read from FSAL triggers the reads of the other blocks, -1 for none */
+static int pinned_block = -1;
+
+static void read_blocks(int first, int last);
+
+/* Stubs of the FSAL: the file is file_data, the handle is a file number */
+int FSAL_handlecmp(fsal_handle_t * handle1, fsal_handle_t * handle2,
+                   fsal_status_t * status)
+{
+  status->major = ERR_FSAL_NO_ERROR;
+  status->minor = 0;
+
+  return memcmp(handle1, handle2, sizeof(fsal_handle_t));
+}                               /* FSAL_handlecmp */
+
+unsigned int FSAL_Handle_to_HashIndex(fsal_handle_t * p_handle,
+                                      unsigned int cookie,
+                                      unsigned int alphabet_len, unsigned int index_size)
+{
+  return (*(unsigned int *)p_handle + cookie) % index_size;
+}                               /* FSAL_Handle_to_HashIndex */
+
+fsal_status_t FSAL_read(fsal_file_t * file_descriptor,
+                        fsal_seek_t * seek_descriptor,
+                        fsal_size_t buffer_size,
+                        caddr_t buffer,
+                        fsal_size_t * read_amount, fsal_boolean_t * end_of_file)
+{
+  fsal_status_t status = { ERR_FSAL_NO_ERROR, 0 };
+  fsal_off_t offset = seek_descriptor->offset;
+
+  nb_fsal_read += 1;
+
+  if(pinned_block >= 0 && offset / BLOCK_SIZE_TEST == pinned_block)
+    {
+      /* The block is pinned and the lock of its partition is not held:
+       * read enough other blocks to recycle every block of the partition */
+      pinned_block = -1;
+      read_blocks(4, NB_FILE_BLOCKS - 1);
+    }
+
+  if(offset >= FILE_SIZE_TEST)
+    buffer_size = 0;
+  else if(offset + buffer_size > FILE_SIZE_TEST)
+    buffer_size = FILE_SIZE_TEST - offset;
+
+  memcpy(buffer, file_data + offset, buffer_size);
+  *read_amount = buffer_size;
+  *end_of_file = (offset + buffer_size >= FILE_SIZE_TEST);
+
+  return status;
+}                               /* FSAL_read */
+
+fsal_status_t FSAL_write(fsal_file_t * file_descriptor,
+                         fsal_seek_t * seek_descriptor,
+                         fsal_size_t buffer_size,
+                         caddr_t buffer, fsal_size_t * write_amount)
+{
+  fsal_status_t status = { ERR_FSAL_NO_ERROR, 0 };
+
+  memcpy(file_data + seek_descriptor->offset, buffer, buffer_size);
+  *write_amount = buffer_size;
+
+  return status;
+}                               /* FSAL_write */
+
+fsal_status_t FSAL_writev(fsal_file_t * file_descriptor,
+                          fsal_count_t nb_segments,
+                          fsal_io_segment_t * segments, fsal_size_t * write_amount)
+{
+  fsal_status_t status = { ERR_FSAL_NO_ERROR, 0 };
+  fsal_count_t i;
+
+  nb_fsal_writev += 1;
+  *write_amount = 0;
+
+  for(i = 0; i < nb_segments; i++)
+    {
+      if(segments[i].offset + segments[i].length > FILE_SIZE_TEST)
+        {
+          LogTest("Test FAILED: segment [%llu, +%llu] is beyond the end of file",
+                  (unsigned long long)segments[i].offset,
+                  (unsigned long long)segments[i].length);
+          exit(1);
+        }
+
+      memcpy(file_data + segments[i].offset, segments[i].buffer, segments[i].length);
+      segments[i].io_amount = segments[i].length;
+      *write_amount += segments[i].length;
+      nb_fsal_segments += 1;
+    }
+
+  return status;
+}                               /* FSAL_writev */
+
+static void check_read(fsal_off_t offset, fsal_size_t size)
+{
+  char buffer[BLOCK_SIZE_TEST];
+  cache_content_status_t status;
+  fsal_status_t fsal_status;
+  fsal_size_t io_size;
+  fsal_boolean_t eof;
+
+  if(cache_content_block_read(&handle, &fd, &attr, offset, size, &io_size, buffer, &eof,
+                              &fsal_status, &status) != CACHE_CONTENT_SUCCESS
+     || io_size != size)
+    {
+      LogTest("Test FAILED: read of %llu bytes at %llu returned %d, %llu bytes",
+              (unsigned long long)size, (unsigned long long)offset, status,
+              (unsigned long long)io_size);
+      exit(1);
+    }
+
+  if(memcmp(buffer, expected + offset, size))
+    {
+      LogTest("Test FAILED: read of %llu bytes at %llu returned bad data",
+              (unsigned long long)size, (unsigned long long)offset);
+      exit(1);
+    }
+}                               /* check_read */
+
+static void read_blocks(int first, int last)
+{
+  int i;
+
+  for(i = first; i <= last; i++)
+    check_read((fsal_off_t) i * BLOCK_SIZE_TEST, BLOCK_SIZE_TEST);
+}                               /* read_blocks */
+
+static void write_back(fsal_off_t offset, fsal_size_t size, char c)
+{
+  char buffer[BLOCK_SIZE_TEST];
+  cache_content_status_t status;
+  fsal_status_t fsal_status;
+  fsal_size_t io_size;
+
+  memset(buffer, c, size);
+  memset(expected + offset, c, size);
+
+  if(cache_content_block_write(&handle, &fd, &attr, offset, size, &io_size, buffer, TRUE,
+                               &fsal_status, &status) != CACHE_CONTENT_SUCCESS
+     || io_size != size)
+    {
+      LogTest("Test FAILED: write of %llu bytes at %llu returned %d, %llu bytes",
+              (unsigned long long)size, (unsigned long long)offset, status,
+              (unsigned long long)io_size);
+      exit(1);
+    }
+}                               /* write_back */
+
+int main(int argc, char *argv[])
+{
+  SetDefaultLogging("TEST");
+  SetNamePgm("test_cache_content_block");
+
+  cache_content_client_parameter_t param;
+  cache_content_block_stat_t stat;
+  cache_content_status_t status;
+  fsal_status_t fsal_status;
+  int i;
+
+  BuddyInit(NULL);
+
+  memset(&param, 0, sizeof(param));
+  param.block_cache_size = CACHE_SIZE_TEST;
+  param.block_size = BLOCK_SIZE_TEST;
+
+  if(cache_content_block_init(param) != 0 || !cache_content_block_enabled())
+    {
+      LogTest("Test FAILED: Bad Init");
+      exit(1);
+    }
+
+  for(i = 0; i < FILE_SIZE_TEST; i++)
+    file_data[i] = (char)(i * 7 + i / PAGE_SIZE_TEST);
+  memcpy(expected, file_data, FILE_SIZE_TEST);
+
+  memset(&handle, 0, sizeof(handle));
+  memset(&fd, 0, sizeof(fd));
+  memset(&attr, 0, sizeof(attr));
+  attr.filesize = FILE_SIZE_TEST;
+
+  /* 1- A partial-page write is kept in the cache, with the rest of the page read from FSAL */
+  write_back(100, 50, 'a');
+
+  cache_content_block_get_stats(&stat);
+  if(stat.nb_write_back != 1 || stat.nb_page_miss != 1 || stat.nb_dirty_blocks != 1
+     || nb_fsal_read != 1)
+    {
+      LogTest("Test FAILED: partial-page write: write_back=%llu miss=%llu dirty=%llu reads=%u",
+              stat.nb_write_back, stat.nb_page_miss, stat.nb_dirty_blocks, nb_fsal_read);
+      exit(1);
+    }
+
+  if(!memcmp(file_data + 100, expected + 100, 50))
+    {
+      LogTest("Test FAILED: partial-page write went to FSAL before the flush");
+      exit(1);
+    }
+
+  check_read(0, PAGE_SIZE_TEST);
+
+  cache_content_block_get_stats(&stat);
+  if(stat.nb_page_hit != 1 || nb_fsal_read != 1)
+    {
+      LogTest("Test FAILED: the written page was read again from FSAL");
+      exit(1);
+    }
+
+  LogTest("Partial-page write: OK");
+
+  /* 2- Dirty write back: block 0 has dirty pages 0 and 2 around a valid clean page 1,
+   *    block 1 has a dirty page 3. Each block is written as a single segment */
+  check_read(PAGE_SIZE_TEST, PAGE_SIZE_TEST);
+  write_back(2 * PAGE_SIZE_TEST + 10, 20, 'b');
+  write_back(BLOCK_SIZE_TEST + 3 * PAGE_SIZE_TEST, PAGE_SIZE_TEST, 'c');
+
+  cache_content_block_get_stats(&stat);
+  if(stat.nb_dirty_blocks != 2 || stat.nb_write_back != 3)
+    {
+      LogTest("Test FAILED: %llu dirty blocks, %llu writes back before the flush",
+              stat.nb_dirty_blocks, stat.nb_write_back);
+      exit(1);
+    }
+
+  if(cache_content_block_flush(&handle, &fd, &fsal_status, &status) != CACHE_CONTENT_SUCCESS)
+    {
+      LogTest("Test FAILED: flush returned %d", status);
+      exit(1);
+    }
+
+  cache_content_block_get_stats(&stat);
+  if(stat.nb_dirty_blocks != 0 || stat.nb_flushed_pages != 3)
+    {
+      LogTest("Test FAILED: %llu dirty blocks, %llu flushed pages after the flush",
+              stat.nb_dirty_blocks, stat.nb_flushed_pages);
+      exit(1);
+    }
+
+  if(nb_fsal_writev != 2 || nb_fsal_segments != 2)
+    {
+      LogTest("Test FAILED: flush made %u FSAL_writev of %u segments, 2 of 2 expected",
+              nb_fsal_writev, nb_fsal_segments);
+      exit(1);
+    }
+
+  if(memcmp(file_data, expected, FILE_SIZE_TEST))
+    {
+      LogTest("Test FAILED: the file does not hold the written data after the flush");
+      exit(1);
+    }
+
+  LogTest("Dirty write back: OK");
+
+  /* 3- Block 2 is pinned while it is read from FSAL, and the reads of blocks 4 to 15
+   *    recycle the other blocks of the partition. A dirty block must not be evicted either */
+  write_back(3 * BLOCK_SIZE_TEST + 10, 10, 'd');
+
+  pinned_block = 2;
+  read_blocks(2, 2);
+
+  if(pinned_block != -1)
+    {
+      LogTest("Test FAILED: block 2 was not read from FSAL");
+      exit(1);
+    }
+
+  cache_content_block_get_stats(&stat);
+  if(stat.nb_evicted == 0 || stat.nb_blocks > 4 || stat.nb_dirty_blocks != 1)
+    {
+      LogTest("Test FAILED: evicted=%llu blocks=%llu dirty=%llu",
+              stat.nb_evicted, stat.nb_blocks, stat.nb_dirty_blocks);
+      exit(1);
+    }
+
+  /* If block 2 had been recycled while pinned, its data would have been copied
+   * in the block that took it over */
+  read_blocks(0, NB_FILE_BLOCKS - 1);
+
+  if(cache_content_block_flush(&handle, &fd, &fsal_status, &status) != CACHE_CONTENT_SUCCESS
+     || memcmp(file_data, expected, FILE_SIZE_TEST))
+    {
+      LogTest("Test FAILED: the dirty block was lost");
+      exit(1);
+    }
+
+  LogTest("Eviction of a pinned block: OK");
+
+  cache_content_block_get_stats(&stat);
+  LogTest("read=%llu write=%llu hit=%llu miss=%llu write_back=%llu flushed=%llu evicted=%llu",
+          stat.nb_read, stat.nb_write, stat.nb_page_hit, stat.nb_page_miss,
+          stat.nb_write_back, stat.nb_flushed_pages, stat.nb_evicted);
+
+  LogTest("\n-----------------------------------------");
+  LogTest("Test succeeded: all tests pass successfully");
+
+  exit(0);
+}                               /* main */
@@ -51,7 +51,8 @@
  * @param pclient [IN]  ressource allocated by the client for the nfs management.
  * @pstatus [OUT] returned status.
  *
- * @return CACHE_CONTENT_FULLY_CACHED if file is to be cached
+ * @return CACHE_CONTENT_FULLY_CACHED if file is to be cached, CACHE_CONTENT_BLOCK_CACHED if
+ *         its data is to be cached by blocks in memory (the file is then flagged for cache_inode_rdwr).
  *
  */
 
@@ -71,6 +72,14 @@ cache_content_caching_type_t cache_content_cache_behaviour(cache_entry_t * pentr
       return *pstatus;
     }
 
+  /* The block cache holds pieces of files, their size does not matter */
+  if(cache_content_block_enabled())
+    {
+      pentry_inode->object.file.use_block_cache = TRUE;
+      *pstatus = CACHE_CONTENT_BLOCK_CACHED;
+      return *pstatus;
+    }
+
   if(ppolicy_data->UseMaxCacheSize)
     {
       if(pentry_inode->object.file.attributes.filesize > ppolicy_data->MaxCacheSize)
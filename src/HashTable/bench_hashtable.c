@@ -0,0 +1,196 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ *
+ * Micro-benchmark of the hash tables: HashTable_Set, HashTable_Get and
+ * HashTable_Del from several threads, on a table already holding
+ * NB_PREFILL entries. Every thread sets, then deletes, its own keys.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "BuddyMalloc.h"
+#include "HashTable.h"
+#include "BenchStats.h"
+#include "log_macros.h"
+
+#define NB_PREFILL   100000
+#define DEFAULT_OPS  100000
+#define PRIME        1009
+#define NB_PREALLOC  1000
+#define KEY_LEN      24
+
+unsigned long simple_hash_func(hash_parameter_t * p_hparam, hash_buffer_t * buffclef);
+unsigned long rbt_hash_func(hash_parameter_t * p_hparam, hash_buffer_t * buffclef);
+
+typedef struct bench_ht_arg__
+{
+  hash_table_t *ht;
+  char (*prefill_keys)[KEY_LEN];
+  char (*thread_keys)[KEY_LEN]; /* nb_ops keys per thread */
+  unsigned long long nb_ops;
+} bench_ht_arg_t;
+
+static int compare_string_buffer(hash_buffer_t * buff1, hash_buffer_t * buff2)
+{
+  return strcmp(buff1->pdata, buff2->pdata);
+}
+
+static int display_buff(hash_buffer_t * pbuff, char *str)
+{
+  return snprintf(str, HASHTABLE_DISPLAY_STRLEN, "%s", (char *)pbuff->pdata);
+}
+
+static int bench_thread_init(void *arg, unsigned int thread)
+{
+  return (BuddyInit(NULL) == BUDDY_SUCCESS) ? 0 : -1;
+}
+
+static int bench_set(void *arg, unsigned int thread, unsigned long long iter)
+{
+  bench_ht_arg_t *p_arg = (bench_ht_arg_t *) arg;
+  hash_buffer_t buffkey;
+  hash_buffer_t buffval;
+
+  buffkey.pdata = p_arg->thread_keys[thread * p_arg->nb_ops + iter];
+  buffkey.len = strlen(buffkey.pdata);
+  buffval = buffkey;
+
+  return HashTable_Set(p_arg->ht, &buffkey, &buffval);
+}
+
+static int bench_get(void *arg, unsigned int thread, unsigned long long iter)
+{
+  bench_ht_arg_t *p_arg = (bench_ht_arg_t *) arg;
+  hash_buffer_t buffkey;
+  hash_buffer_t buffval;
+
+  /* spread the threads over the whole table */
+  buffkey.pdata = p_arg->prefill_keys[(iter * 2654435761ULL + thread * 40503) % NB_PREFILL];
+  buffkey.len = strlen(buffkey.pdata);
+
+  return HashTable_Get(p_arg->ht, &buffkey, &buffval);
+}
+
+static int bench_del(void *arg, unsigned int thread, unsigned long long iter)
+{
+  bench_ht_arg_t *p_arg = (bench_ht_arg_t *) arg;
+  hash_buffer_t buffkey;
+
+  buffkey.pdata = p_arg->thread_keys[thread * p_arg->nb_ops + iter];
+  buffkey.len = strlen(buffkey.pdata);
+
+  return HashTable_Del(p_arg->ht, &buffkey, NULL, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+  bench_options_t options;
+  bench_ht_arg_t arg;
+  hash_parameter_t hparam;
+  hash_buffer_t buffkey;
+  hash_buffer_t buffval;
+  unsigned long long i;
+  unsigned int t;
+  int rc = 0;
+
+  bench_def_t benches[] = {
+    {"HashTable_Set", bench_set, bench_thread_init, NULL, &arg},
+    {"HashTable_Get", bench_get, bench_thread_init, NULL, &arg},
+    {"HashTable_Del", bench_del, bench_thread_init, NULL, &arg},
+    {NULL, NULL, NULL, NULL, NULL}
+  };
+  bench_def_t *p_bench;
+
+  SetDefaultLogging("TEST");
+  SetNamePgm("bench_hashtable");
+
+  if((rc = BenchStats_GetOptions(argc, argv, DEFAULT_OPS, &options)) != 0)
+    exit(rc > 0 ? 0 : 1);
+
+  BuddyInit(NULL);
+
+  memset(&hparam, 0, sizeof(hparam));
+  hparam.index_size = PRIME;
+  hparam.alphabet_length = 10;
+  hparam.nb_node_prealloc = NB_PREALLOC;
+  hparam.hash_func_key = simple_hash_func;
+  hparam.hash_func_rbt = rbt_hash_func;
+  hparam.hash_func_both = NULL;
+  hparam.compare_key = compare_string_buffer;
+  hparam.key_to_str = display_buff;
+  hparam.val_to_str = display_buff;
+  hparam.name = "bench";
+
+  if((arg.ht = HashTable_Init(hparam)) == NULL)
+    {
+      LogTest("bench_hashtable: HashTable_Init failed");
+      exit(1);
+    }
+
+  arg.nb_ops = options.nb_ops;
+  arg.prefill_keys = malloc(NB_PREFILL * KEY_LEN);
+  arg.thread_keys = malloc(options.max_threads * options.nb_ops * KEY_LEN);
+
+  if(arg.prefill_keys == NULL || arg.thread_keys == NULL)
+    {
+      LogTest("bench_hashtable: not enough memory for the keys");
+      exit(1);
+    }
+
+  /* keys are numbers, as the hash functions expect */
+  for(i = 0; i < NB_PREFILL; i++)
+    {
+      snprintf(arg.prefill_keys[i], KEY_LEN, "%llu", i);
+
+      buffkey.pdata = arg.prefill_keys[i];
+      buffkey.len = strlen(buffkey.pdata);
+      buffval = buffkey;
+
+      if(HashTable_Set(arg.ht, &buffkey, &buffval) != HASHTABLE_SUCCESS)
+        {
+          LogTest("bench_hashtable: could not fill the table");
+          exit(1);
+        }
+    }
+
+  for(i = 0; i < options.max_threads * options.nb_ops; i++)
+    snprintf(arg.thread_keys[i], KEY_LEN, "%llu", NB_PREFILL + i);
+
+  BenchStats_Begin(&options, "HashTable");
+
+  for(t = 0; t < options.nb_thread_counts; t++)
+    for(p_bench = benches; p_bench->name != NULL; p_bench++)
+      if(BenchStats_Run(&options, p_bench, options.thread_counts[t]) != 0)
+        rc = 1;
+
+  BenchStats_End(&options);
+
+  exit(rc);
+}
@@ -102,6 +102,58 @@
 #include "stuff_alloc.h"
 #include "log_macros.h"
 
+#define P( _mutex_ ) pthread_mutex_lock( &_mutex_ )
+#define V( _mutex_ ) pthread_mutex_unlock( &_mutex_ )
+
+/* ------ Chain management, called with the lock of the list ----- */
+
+/* Adds an entry as the MRU entry */
+static void LRU_link_mru(LRU_list_t * plru, LRU_entry_t * pentry)
+{
+  pentry->next = NULL;
+
+  if(plru->MRU == NULL)
+    {
+      pentry->prev = NULL;
+      plru->LRU = pentry;
+    }
+  else
+    {
+      pentry->prev = plru->MRU;
+      plru->MRU->next = pentry;
+    }
+
+  plru->MRU = pentry;
+}                               /* LRU_link_mru */
+
+/* Takes an entry out of the chain of the valid entries. Its own next and prev
+ * pointers are kept, so that a walk standing on it can go on. */
+static void LRU_unlink(LRU_list_t * plru, LRU_entry_t * pentry)
+{
+  if(pentry->prev != NULL)
+    pentry->prev->next = pentry->next;
+  else
+    plru->LRU = pentry->next;
+
+  if(pentry->next != NULL)
+    pentry->next->prev = pentry->prev;
+  else
+    plru->MRU = pentry->prev;
+}                               /* LRU_unlink */
+
+static void LRU_invalidate_locked(LRU_list_t * plru, LRU_entry_t * pentry)
+{
+  if(pentry->valid_state == LRU_ENTRY_INVALID)
+    return;
+
+  LRU_unlink(plru, pentry);
+
+  pentry->valid_state = LRU_ENTRY_INVALID;
+  pentry->next_invalid = plru->invalid;
+  plru->invalid = pentry;
+  plru->nb_invalid += 1;
+}                               /* LRU_invalidate_locked */
+
 /* ------ This group contains all the functions used to manipulate the LRU from outside this module ----- */
 
 /**
@@ -142,8 +194,15 @@ LRU_list_t *LRU_Init(LRU_parameter_t lru_param, LRU_status_t * pstatus)
   plru->nb_invalid = 0;
   plru->nb_call_gc = 0;
   plru->MRU = plru->LRU = NULL;
+  plru->invalid = NULL;
   plru->parameter = lru_param;
 
+  if(pthread_mutex_init(&plru->lock, NULL) != 0)
+    {
+      *pstatus = LRU_LIST_MALLOC_ERROR;
+      return NULL;
+    }
+
   /* Pre allocate entries */
   MakePool(&plru->lru_entry_pool, lru_param.nb_entry_prealloc, LRU_entry_t, NULL, NULL);
   NamePool(&plru->lru_entry_pool, "%s LRU Entry Pool", name);
@@ -162,7 +221,7 @@ LRU_list_t *LRU_Init(LRU_parameter_t lru_param, LRU_status_t * pstatus)
  * LRU_invalidate: Tag an entry as invalid. 
  *
  * Tag an entry as invalid, this kind of entry will be put off the LRU (and sent back to the pool) when 
- * a garbagge collection will be performed.
+ * a garbagge collection will be performed. The entry leaves the chain of the valid entries at once.
  *
  * @param plru Pointer to the list to be managed.
  * @param pentry Pointer to the entry to be tagged.
@@ -173,11 +232,9 @@ LRU_list_t *LRU_Init(LRU_parameter_t lru_param, LRU_status_t * pstatus)
  */
 int LRU_invalidate(LRU_list_t * plru, LRU_entry_t * pentry)
 {
-  if(pentry->valid_state != LRU_ENTRY_INVALID)
-    {
-      pentry->valid_state = LRU_ENTRY_INVALID;
-      plru->nb_invalid += 1;
-    }
+  P(plru->lock);
+  LRU_invalidate_locked(plru, pentry);
+  V(plru->lock);
 
   return LRU_LIST_SUCCESS;
 }                               /* LRU_invalidate */
@@ -202,30 +259,27 @@ LRU_entry_t *LRU_new_entry(LRU_list_t * plru, LRU_status_t * pstatus)
   LogDebug(COMPONENT_LRU, "==> LRU_new_entry: nb_entry = %d nb_entry_prealloc = %d", plru->nb_entry,
          plru->parameter.nb_entry_prealloc);
 
+  P(plru->lock);
+
   GetFromPool(new_entry, &plru->lru_entry_pool, LRU_entry_t);
   if(new_entry == NULL)
     {
+      V(plru->lock);
       *pstatus = LRU_LIST_MALLOC_ERROR;
       return NULL;
     }
 
   new_entry->valid_state = LRU_ENTRY_VALID;
-  new_entry->next = NULL;       /* Entry is added as the MRU entry */
+  new_entry->referenced = FALSE;
+  new_entry->next_invalid = NULL;
 
-  if(plru->MRU == NULL)
-    {
-      new_entry->prev = NULL;
-      plru->LRU = new_entry;
-    }
-  else
-    {
-      new_entry->prev = plru->MRU;
-      plru->MRU->next = new_entry;
-    }
+  /* Entry is added as the MRU entry */
+  LRU_link_mru(plru, new_entry);
 
   plru->nb_entry += 1;
   plru->nb_call_gc += 1;
-  plru->MRU = new_entry;
+
+  V(plru->lock);
 
   *pstatus = LRU_LIST_SUCCESS;
   return new_entry;
@@ -235,7 +289,8 @@ LRU_entry_t *LRU_new_entry(LRU_list_t * plru, LRU_status_t * pstatus)
  * 
  * LRU_gc_invalid : garbagge collection for invalid entries.
  *
- * Read the whole LRU list and put the invalid entries back to the pool.
+ * Put the invalid entries back to the pool. Only the chain of the invalid
+ * entries is walked, and clean_entry is called without the lock of the list.
  *
  * @param plru Pointer to the list to be managed.
  * @return An integer to contain the status for the operation. 
@@ -246,6 +301,8 @@ int LRU_gc_invalid(LRU_list_t * plru, void *cleanparam)
 {
   LRU_entry_t *pentry = NULL;
   LRU_entry_t *pentrynext = NULL;
+  LRU_entry_t *pinvalid = NULL;
+  unsigned int nb_cleaned = 0;
   int rc = 0;
 
   if(plru == NULL)
@@ -254,48 +311,42 @@ int LRU_gc_invalid(LRU_list_t * plru, void *cleanparam)
   if(plru->nb_invalid == 0)
     return LRU_LIST_SUCCESS;    /* Nothing to be done in this case */
 
-  if(plru->MRU == NULL)
-    return LRU_LIST_EMPTY_LIST;
-
-  if(plru->MRU->prev == NULL)   /* One entry only, returns success (the MRU cannot be invalid) */
-    return LRU_LIST_SUCCESS;
-
   /* Do nothing if not enough calls were done */
   if(plru->nb_call_gc < plru->parameter.nb_call_gc_invalid)
     return LRU_LIST_SUCCESS;
 
-  /* From the LRU to the entry BEFORE the MRU */
+  /* Take the whole chain of the invalid entries */
+  P(plru->lock);
+  pinvalid = plru->invalid;
+  plru->invalid = NULL;
+  V(plru->lock);
+
   rc = LRU_LIST_SUCCESS;
 
-  for(pentry = plru->LRU; pentry != plru->MRU; pentry = pentrynext)
+  for(pentry = pinvalid; pentry != NULL; pentry = pentry->next_invalid)
     {
-      pentrynext = pentry->next;
-
-      if(pentry->valid_state == LRU_ENTRY_INVALID)
+      if(plru->parameter.clean_entry(pentry, cleanparam) != 0)
         {
-          if(plru->parameter.clean_entry(pentry, cleanparam) != 0)
-            {
-              LogDebug(COMPONENT_LRU, "Error cleaning pentry %p", pentry);
-              rc = LRU_LIST_BAD_RELEASE_ENTRY;
-            }
-
-          if(pentry->prev != NULL)
-            pentry->prev->next = pentry->next;
-          else
-            plru->LRU = pentry->next;
-
-          if(pentry->next != NULL)
-            pentry->next->prev = pentry->prev;
-          else
-            LogDebug(COMPONENT_LRU, "SHOULD Never appear  !!!! line %d file %s", __LINE__, __FILE__);
-          plru->nb_entry -= 1;
-          plru->nb_invalid -= 1;
-
-          /* Put it back to pre-allocated pool */
-          ReleaseToPool(pentry, &plru->lru_entry_pool);
+          LogDebug(COMPONENT_LRU, "Error cleaning pentry %p", pentry);
+          rc = LRU_LIST_BAD_RELEASE_ENTRY;
         }
+      nb_cleaned += 1;
     }
 
+  /* Put them back to pre-allocated pool */
+  P(plru->lock);
+
+  for(pentry = pinvalid; pentry != NULL; pentry = pentrynext)
+    {
+      pentrynext = pentry->next_invalid;
+      ReleaseToPool(pentry, &plru->lru_entry_pool);
+    }
+
+  plru->nb_entry -= nb_cleaned;
+  plru->nb_invalid -= nb_cleaned;
+
+  V(plru->lock);
+
   return rc;
 }                               /* LRU_gc_invalid */
 
@@ -303,7 +354,8 @@ int LRU_gc_invalid(LRU_list_t * plru, void *cleanparam)
  *
  * LRU_invalidate_by_function: Browse the lru to test if entries should ne invalidated.
  *
- * Browse the lru to test if entries should ne invalidated. This function is used for garbagge collection
+ * Browse the lru to test if entries should ne invalidated. This function is used for garbagge collection.
+ * testfunc is called with the lock of the list held, it must not call the LRU functions on this list.
  *
  * @param plru [INOUT] LRU list to be managed.
  * @param testfunc [IN] function used to identify an entry to be tagged invalid. This function returns TRUE if entry will be tagged invalid
@@ -321,45 +373,36 @@ int LRU_invalidate_by_function(LRU_list_t * plru,
 {
   LRU_entry_t *pentry = NULL;
   LRU_entry_t *pentry_next = NULL;
-  int rc = 0;
 
   if(plru == NULL)
     return LRU_LIST_EMPTY_LIST;
 
-  if(plru->nb_entry == 0)
+  if(plru->nb_entry == plru->nb_invalid)
     return LRU_LIST_SUCCESS;    /* Nothing to be done in this case */
 
-  if(plru->MRU == NULL)
-    return LRU_LIST_EMPTY_LIST;
-
-  if(plru->MRU->prev == NULL)   /* One entry only, returns success (the MRU cannot be set invalid) */
-    return LRU_LIST_SUCCESS;
-
-  /* From the LRU to the entry BEFORE the MRU */
-  rc = LRU_LIST_SUCCESS;
+  P(plru->lock);
 
-  for(pentry = plru->LRU; pentry != plru->MRU; pentry = pentry_next)
+  /* From the LRU to the MRU, there are only valid entries in the chain */
+  for(pentry = plru->LRU; pentry != NULL; pentry = pentry_next)
     {
       pentry_next = pentry->next;
-      if(pentry->valid_state != LRU_ENTRY_INVALID)
-        {
-          /* Use test function on the entry to know if it should be set invalid or not */
-          if(testfunc(pentry, addparam) == LRU_LIST_SET_INVALID)
-            {
-              if((rc = LRU_invalidate(plru, pentry)) != LRU_LIST_SUCCESS)
-                break;          /* end of loop, error will be returned */
-            }
-        }
+
+      /* Use test function on the entry to know if it should be set invalid or not */
+      if(testfunc(pentry, addparam) == LRU_LIST_SET_INVALID)
+        LRU_invalidate_locked(plru, pentry);
     }
 
-  return rc;
+  V(plru->lock);
+
+  return LRU_LIST_SUCCESS;
 }                               /* LRU_invalidate_by_function */
 
 /**
  *
  * LRU_apply_function: apply the same function to every LRU entry, but do not change their states.
  *
- * apply the same function to every LRU entry, but do not change their states.
+ * apply the same function to every valid LRU entry, from the MRU to the LRU, but do not change their states.
+ * myfunc is called with the lock of the list held, it must not call the LRU functions on this list.
  * 
  * @param plru [INOUT] LRU list to be managed.
  * @param myfunc [IN] function used to be runned on every entry. If this function return FALSE, the loop stops.
@@ -376,37 +419,109 @@ int LRU_apply_function(LRU_list_t * plru, int (*myfunc) (LRU_entry_t *, void *ad
                        void *addparam)
 {
   LRU_entry_t *pentry = NULL;
-  int rc = 0;
 
   if(plru == NULL)
     return LRU_LIST_EMPTY_LIST;
 
-  if(plru->nb_entry == 0)
+  if(plru->nb_entry == plru->nb_invalid)
     return LRU_LIST_SUCCESS;    /* Nothing to be done in this case */
 
-  if(plru->MRU == NULL)
-    return LRU_LIST_EMPTY_LIST;
+  P(plru->lock);
 
-  if(plru->MRU->prev == NULL)   /* One entry only, returns success (the MRU cannot be set invalid) */
-    return LRU_LIST_SUCCESS;
+  for(pentry = plru->MRU; pentry != NULL; pentry = pentry->prev)
+    {
+      if(myfunc(pentry, addparam) == FALSE)
+        break;                  /* end of loop */
+    }
 
-  /* From the LRU to the entry BEFORE the MRU */
-  rc = LRU_LIST_SUCCESS;
-  for(pentry = plru->MRU->prev; pentry != NULL; pentry = pentry->prev)
+  V(plru->lock);
+
+  return LRU_LIST_SUCCESS;
+
+}                               /* LRU_apply_function */
+
+/**
+ *
+ * LRU_touch: tells that an entry was used.
+ *
+ * The entry is not moved, which would need the lock of the list: it gets a second
+ * chance the next time LRU_reclaim meets it. This never blocks, and may be called
+ * by any thread.
+ *
+ * @param plru [IN] LRU list of the entry.
+ * @param pentry [INOUT] the entry used.
+ *
+ * @return nothing (void function)
+ *
+ * @see LRU_reclaim
+ *
+ */
+void LRU_touch(LRU_list_t * plru, LRU_entry_t * pentry)
+{
+  if(!pentry->referenced)
+    pentry->referenced = TRUE;
+}                               /* LRU_touch */
+
+/**
+ *
+ * LRU_reclaim: invalidates up to nb_to_reclaim entries, from the LRU (CLOCK policy).
+ *
+ * The entries are met from the LRU. An entry touched since it was last met gets
+ * a second chance: it is moved to the MRU. Otherwise, it is invalidated if testfunc
+ * (if not NULL) returns LRU_LIST_SET_INVALID, and moved to the MRU if not. The
+ * walk stops when nb_to_reclaim entries were invalidated, or when every valid entry
+ * was met twice (once to use its second chance). The invalid entries are not met,
+ * LRU_gc_invalid puts them back to the pool afterwards.
+ * testfunc is called with the lock of the list held, it must not call the LRU functions on this list.
+ *
+ * @param plru [INOUT] LRU list to be managed.
+ * @param nb_to_reclaim [IN] number of entries wanted.
+ * @param testfunc [IN] function telling if an entry can be invalidated, or NULL.
+ * @param addparam [IN] parameter for the input function.
+ *
+ * @return the number of entries invalidated.
+ *
+ * @see LRU_touch
+ * @see LRU_gc_invalid
+ *
+ */
+unsigned int LRU_reclaim(LRU_list_t * plru, unsigned int nb_to_reclaim,
+                         int (*testfunc) (LRU_entry_t *, void *addparam), void *addparam)
+{
+  LRU_entry_t *pentry = NULL;
+  unsigned int nb_to_meet;
+  unsigned int nb_reclaimed = 0;
+
+  if(plru == NULL || nb_to_reclaim == 0)
+    return 0;
+
+  P(plru->lock);
+
+  for(nb_to_meet = 2 * (plru->nb_entry - plru->nb_invalid);
+      nb_to_meet > 0 && nb_reclaimed < nb_to_reclaim && (pentry = plru->LRU) != NULL;
+      nb_to_meet--)
     {
-      if(pentry->valid_state != LRU_ENTRY_INVALID)
+      if(!pentry->referenced &&
+         (testfunc == NULL || testfunc(pentry, addparam) == LRU_LIST_SET_INVALID))
         {
-          /* Use test function on the entry to know if it should be set invalid or not */
-          if(myfunc(pentry, addparam) == FALSE)
-            {
-              break;            /* end of loop */
-            }
+          LRU_invalidate_locked(plru, pentry);
+          nb_reclaimed += 1;
+          continue;
         }
-    }                           /* for */
 
-  return rc;
+      /* Second chance, or not to be reclaimed now: the hand moves on */
+      pentry->referenced = FALSE;
+      if(pentry != plru->MRU)
+        {
+          LRU_unlink(plru, pentry);
+          LRU_link_mru(plru, pentry);
+        }
+    }
 
-}                               /* LRU_apply_function */
+  V(plru->lock);
+
+  return nb_reclaimed;
+}                               /* LRU_reclaim */
 
 /**
  * 
@@ -424,12 +539,17 @@ void LRU_Print(LRU_list_t * plru)
   LRU_entry_t *pentry = NULL;
   char dispdata[LRU_DISPLAY_STRLEN];
 
+  P(plru->lock);
+
   for(pentry = plru->LRU; pentry != NULL; pentry = pentry->next)
     {
       plru->parameter.entry_to_str(pentry->buffdata, dispdata);
       LogFullDebug(COMPONENT_LRU, "Entry value = %s, valid_state = %d", dispdata, pentry->valid_state);
     }
+  LogFullDebug(COMPONENT_LRU, "%u invalid entries", plru->nb_invalid);
   LogFullDebug(COMPONENT_LRU, "-----------------------------------------");
+
+  V(plru->lock);
 }                               /* LRU_Print */
 
 /* @} */
@@ -0,0 +1,172 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ *
+ * Micro-benchmark of the LRU lists. As in the server, every thread works on
+ * its own list:
+ *   LRU_new_entry  : adds nb_ops entries to the list
+ *   LRU_invalidate : invalidates them
+ *   LRU_gc_invalid : adds an entry, invalidates the previous one and
+ *                    garbages it (the steady state of a cache that evicts as
+ *                    much as it adds)
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "BuddyMalloc.h"
+#include "LRU_List.h"
+#include "BenchStats.h"
+#include "log_macros.h"
+
+#define DEFAULT_OPS  100000
+#define NB_PREALLOC  1000
+
+typedef struct bench_lru_arg__
+{
+  LRU_list_t **lists;           /* one per thread */
+  LRU_entry_t **entries;        /* nb_ops per thread */
+  unsigned long long nb_ops;
+} bench_lru_arg_t;
+
+static int print_entry(LRU_data_t data, char *str)
+{
+  return sprintf(str, "%p", data.pdata);
+}
+
+static int clean_entry(LRU_entry_t * pentry, void *addparam)
+{
+  return 0;
+}
+
+static int bench_thread_init(void *arg, unsigned int thread)
+{
+  bench_lru_arg_t *p_arg = (bench_lru_arg_t *) arg;
+  LRU_parameter_t param;
+  LRU_status_t status;
+
+  if(BuddyInit(NULL) != BUDDY_SUCCESS)
+    return -1;
+
+  if(p_arg->lists[thread] != NULL)
+    return 0;
+
+  param.nb_entry_prealloc = NB_PREALLOC;
+  param.nb_call_gc_invalid = 1;
+  param.entry_to_str = print_entry;
+  param.clean_entry = clean_entry;
+  param.name = "bench";
+
+  p_arg->lists[thread] = LRU_Init(param, &status);
+
+  return (p_arg->lists[thread] != NULL) ? 0 : -1;
+}
+
+static int bench_new_entry(void *arg, unsigned int thread, unsigned long long iter)
+{
+  bench_lru_arg_t *p_arg = (bench_lru_arg_t *) arg;
+  LRU_status_t status;
+  LRU_entry_t *pentry;
+
+  pentry = LRU_new_entry(p_arg->lists[thread], &status);
+  p_arg->entries[thread * p_arg->nb_ops + iter] = pentry;
+
+  return (pentry != NULL) ? 0 : -1;
+}
+
+static int bench_invalidate(void *arg, unsigned int thread, unsigned long long iter)
+{
+  bench_lru_arg_t *p_arg = (bench_lru_arg_t *) arg;
+  LRU_entry_t *pentry = p_arg->entries[thread * p_arg->nb_ops + iter];
+
+  if(pentry == NULL)
+    return -1;
+
+  return LRU_invalidate(p_arg->lists[thread], pentry);
+}
+
+static int bench_gc(void *arg, unsigned int thread, unsigned long long iter)
+{
+  bench_lru_arg_t *p_arg = (bench_lru_arg_t *) arg;
+  LRU_list_t *plru = p_arg->lists[thread];
+  LRU_entry_t *pprevious = plru->MRU;
+  LRU_status_t status;
+
+  if(LRU_new_entry(plru, &status) == NULL)
+    return -1;
+
+  if(pprevious != NULL)
+    LRU_invalidate(plru, pprevious);
+
+  return LRU_gc_invalid(plru, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+  bench_options_t options;
+  bench_lru_arg_t arg;
+  unsigned int t;
+  int rc = 0;
+
+  bench_def_t benches[] = {
+    {"LRU_new_entry", bench_new_entry, bench_thread_init, NULL, &arg},
+    {"LRU_invalidate", bench_invalidate, bench_thread_init, NULL, &arg},
+    {"LRU_gc_invalid", bench_gc, bench_thread_init, NULL, &arg},
+    {NULL, NULL, NULL, NULL, NULL}
+  };
+  bench_def_t *p_bench;
+
+  SetDefaultLogging("TEST");
+  SetNamePgm("bench_lru");
+
+  if((rc = BenchStats_GetOptions(argc, argv, DEFAULT_OPS, &options)) != 0)
+    exit(rc > 0 ? 0 : 1);
+
+  BuddyInit(NULL);
+
+  arg.nb_ops = options.nb_ops;
+  arg.lists = calloc(options.max_threads, sizeof(LRU_list_t *));
+  arg.entries = calloc(options.max_threads * options.nb_ops, sizeof(LRU_entry_t *));
+
+  if(arg.lists == NULL || arg.entries == NULL)
+    {
+      LogTest("bench_lru: not enough memory");
+      exit(1);
+    }
+
+  BenchStats_Begin(&options, "LRU");
+
+  for(t = 0; t < options.nb_thread_counts; t++)
+    for(p_bench = benches; p_bench->name != NULL; p_bench++)
+      if(BenchStats_Run(&options, p_bench, options.thread_counts[t]) != 0)
+        rc = 1;
+
+  BenchStats_End(&options);
+
+  exit(rc);
+}
@@ -94,6 +94,7 @@ int main(int argc, char *argv[])
   param.nb_entry_prealloc = PREALLOC;
   param.entry_to_str = print_entry;
   param.clean_entry = clean_entry;
+  param.nb_call_gc_invalid = 0;
   param.name = "Test";
 
   BuddyInit(NULL);
@@ -137,6 +138,39 @@ int main(int argc, char *argv[])
     }
   LRU_Print(plru);
 
+  if(plru->nb_entry != MAXTEST - 1 || plru->nb_invalid != 0)
+    {
+      LogTest("Test FAILED: %u entries and %u invalid after gc", plru->nb_entry,
+              plru->nb_invalid);
+      exit(1);
+    }
+
+  /* Touched entries get a second chance: the LRU (entry 0) is reclaimed after them */
+  for(entry = plru->LRU; entry != NULL; entry = entry->next)
+    if(entry->buffdata.pdata != strtab[0])
+      LRU_touch(plru, entry);
+
+  if(LRU_reclaim(plru, 2, NULL, NULL) != 2)
+    {
+      LogTest("Test FAILED: bad reclaim");
+      exit(1);
+    }
+
+  if(plru->nb_invalid != 2 || plru->LRU->buffdata.pdata != strtab[2] ||
+     plru->MRU->buffdata.pdata != strtab[MAXTEST - 1])
+    {
+      LogTest("Test FAILED: bad CLOCK order after reclaim, LRU=%s MRU=%s",
+              (char *)plru->LRU->buffdata.pdata, (char *)plru->MRU->buffdata.pdata);
+      exit(1);
+    }
+
+  if(LRU_gc_invalid(plru, NULL) != LRU_LIST_SUCCESS || plru->nb_entry != MAXTEST - 3)
+    {
+      LogTest("Test FAILED: bad gc after reclaim");
+      exit(1);
+    }
+  LRU_Print(plru);
+
   /* Tous les tests sont ok */
   LogTest("\n-----------------------------------------");
   LogTest("Test succeeded: all tests pass successfully");
@@ -41,6 +41,11 @@
 #include "mfsl_types.h"
 #include "mfsl.h"
 #include "common_utils.h"
+#include "log_macros.h"
+#include "config_parsing.h"
+
+#include <strings.h>
+#include <string.h>
 
 #ifndef _USE_SWIG
 /******************************************************
@@ -56,12 +61,10 @@
  */
 fsal_status_t MFSL_SetDefault_parameter(mfsl_parameter_t * out_parameter)
 {
-  fsal_status_t status;
-
-  status.major = ERR_FSAL_NO_ERROR;
-  status.minor = 0;
+  out_parameter->nb_io_threads = MFSL_AIO_DEFAULT_NB_IO_THREADS;
+  out_parameter->readahead_max = MFSL_AIO_DEFAULT_READAHEAD_MAX;
 
-  return status;
+  MFSL_return(ERR_FSAL_NO_ERROR, 0);
 }                               /* MFSL_SetDefault_parameter */
 
 /**
@@ -85,12 +88,62 @@ fsal_status_t MFSL_SetDefault_parameter(mfsl_parameter_t * out_parameter)
 fsal_status_t MFSL_load_parameter_from_conf(config_file_t in_config,
                                             mfsl_parameter_t * out_parameter)
 {
-  fsal_status_t status;
-
-  status.major = ERR_FSAL_NO_ERROR;
-  status.minor = 0;
-
-  return status;
+  int err;
+  int var_max, var_index;
+  char *key_name;
+  char *key_value;
+  config_item_t block;
+  size_t size;
+
+  /* Is the config tree initialized ? */
+  if(in_config == NULL || out_parameter == NULL)
+    MFSL_return(ERR_FSAL_INVAL, 0);
+
+  /* Get the config BLOCK */
+  if((block = config_FindItemByName(in_config, CONF_LABEL_MFSL_AIO)) == NULL)
+    MFSL_return(ERR_FSAL_NOENT, 0);
+
+  var_max = config_GetNbItems(block);
+
+  for(var_index = 0; var_index < var_max; var_index++)
+    {
+      config_item_t item;
+
+      item = config_GetItemByIndex(block, var_index);
+
+      if((err = config_GetKeyValue(item, &key_name, &key_value)) > 0)
+        {
+          LogMajor(COMPONENT_MFSL,
+              "MFSL AIO LOAD PARAMETER: ERROR reading key[%d] from section \"%s\" of configuration file.",
+               var_index, CONF_LABEL_MFSL_AIO);
+          MFSL_return(ERR_FSAL_SERVERFAULT, err);
+        }
+
+      if(!strcasecmp(key_name, "Nb_IO_Threads"))
+        {
+          out_parameter->nb_io_threads = atoi(key_value);
+        }
+      else if(!strcasecmp(key_name, "ReadAhead_Max"))
+        {
+          if(s_read_size(key_value, &size) != 0)
+            {
+              LogMajor(COMPONENT_MFSL,
+                  "MFSL AIO LOAD PARAMETER: Invalid value for ReadAhead_Max: \"%s\".",
+                   key_value);
+              MFSL_return(ERR_FSAL_INVAL, 0);
+            }
+          out_parameter->readahead_max = size;
+        }
+      else
+        {
+          LogMajor(COMPONENT_MFSL,
+              "MFSL AIO LOAD PARAMETER: Unknown or unsettable key %s from section \"%s\" of configuration file.",
+               key_name, CONF_LABEL_MFSL_AIO);
+          MFSL_return(ERR_FSAL_INVAL, 0);
+        }
+    }                           /* for */
+
+  MFSL_return(ERR_FSAL_NO_ERROR, 0);
 }
 
 /** 
@@ -100,12 +153,7 @@ fsal_status_t MFSL_load_parameter_from_conf(config_file_t in_config,
 fsal_status_t MFSL_Init(mfsl_parameter_t * init_info    /* IN */
     )
 {
-  fsal_status_t status;
-
-  status.major = ERR_FSAL_NO_ERROR;
-  status.minor = 0;
-
-  return status;
+  return mfsl_aio_readahead_init(init_info);
 }
 
 fsal_status_t MFSL_GetContext(mfsl_context_t * pcontext,
@@ -306,8 +354,15 @@ fsal_status_t MFSL_open(mfsl_object_t * filehandle,     /* IN */
 			void * pextra
     )
 {
-  return FSAL_open(&filehandle->handle,
-                   p_context, openflags, &file_descriptor->fsal_file, file_attributes);
+  fsal_status_t fsal_status;
+
+  fsal_status = FSAL_open(&filehandle->handle,
+                          p_context, openflags, &file_descriptor->fsal_file, file_attributes);
+
+  if(!FSAL_IS_ERROR(fsal_status))
+    mfsl_aio_readahead_open(file_descriptor);
+
+  return fsal_status;
 }                               /* MFSL_open */
 
 fsal_status_t MFSL_open_by_name(mfsl_object_t * dirhandle,      /* IN */
@@ -319,9 +374,16 @@ fsal_status_t MFSL_open_by_name(mfsl_object_t * dirhandle,      /* IN */
                                 fsal_attrib_list_t * file_attributes, /* [ IN/OUT ] */ 
 				void * pextra )
 {
-  return FSAL_open_by_name(&dirhandle->handle,
-                           filename,
-                           p_context, openflags, &file_descriptor->fsal_file, file_attributes);
+  fsal_status_t fsal_status;
+
+  fsal_status = FSAL_open_by_name(&dirhandle->handle,
+                                  filename,
+                                  p_context, openflags, &file_descriptor->fsal_file, file_attributes);
+
+  if(!FSAL_IS_ERROR(fsal_status))
+    mfsl_aio_readahead_open(file_descriptor);
+
+  return fsal_status;
 }                               /* MFSL_open_by_name */
 
 fsal_status_t MFSL_open_by_fileid(mfsl_object_t * filehandle,   /* IN */
@@ -333,9 +395,16 @@ fsal_status_t MFSL_open_by_fileid(mfsl_object_t * filehandle,   /* IN */
                                   fsal_attrib_list_t * file_attributes, /* [ IN/OUT ] */ 
 				  void * pextra )
 {
-  return FSAL_open_by_fileid(&filehandle->handle,
-                             fileid,
-                             p_context, openflags, &file_descriptor->fsal_file, file_attributes);
+  fsal_status_t fsal_status;
+
+  fsal_status = FSAL_open_by_fileid(&filehandle->handle,
+                                    fileid,
+                                    p_context, openflags, &file_descriptor->fsal_file, file_attributes);
+
+  if(!FSAL_IS_ERROR(fsal_status))
+    mfsl_aio_readahead_open(file_descriptor);
+
+  return fsal_status;
 }                               /* MFSL_open_by_fileid */
 
 fsal_status_t MFSL_read(mfsl_file_t * file_descriptor,  /*  IN  */
@@ -348,8 +417,8 @@ fsal_status_t MFSL_read(mfsl_file_t * file_descriptor,  /*  IN  */
 			void * pextra
     )
 {
-  return FSAL_read(&file_descriptor->fsal_file,
-                   seek_descriptor, buffer_size, buffer, read_amount, end_of_file);
+  return mfsl_aio_read(file_descriptor,
+                       seek_descriptor, buffer_size, buffer, read_amount, end_of_file);
 }                               /* MFSL_read */
 
 fsal_status_t MFSL_write(mfsl_file_t * file_descriptor, /* IN */
@@ -361,7 +430,16 @@ fsal_status_t MFSL_write(mfsl_file_t * file_descriptor, /* IN */
 			 void * pextra
     )
 {
-  return FSAL_write(&file_descriptor->fsal_file, seek_descriptor, buffer_size, buffer, write_amount);
+  fsal_status_t fsal_status;
+
+  /* what was read ahead before, or during, the write is outdated */
+  mfsl_aio_readahead_invalidate(file_descriptor);
+
+  fsal_status = FSAL_write(&file_descriptor->fsal_file, seek_descriptor, buffer_size, buffer, write_amount);
+
+  mfsl_aio_readahead_invalidate(file_descriptor);
+
+  return fsal_status;
 }                               /* MFSL_write */
 
 fsal_status_t MFSL_close(mfsl_file_t * file_descriptor, /* IN */
@@ -369,6 +447,8 @@ fsal_status_t MFSL_close(mfsl_file_t * file_descriptor, /* IN */
 			 void * pextra
     )
 {
+  mfsl_aio_readahead_close(file_descriptor);
+
   return FSAL_close(&file_descriptor->fsal_file);
 }                               /* MFSL_close */
 
@@ -383,6 +463,8 @@ fsal_status_t MFSL_close_by_fileid(mfsl_file_t * file_descriptor /* IN */ ,
 				   mfsl_context_t * p_mfsl_context,  /* IN */
 				   void * pextra )
 {
+  mfsl_aio_readahead_close(file_descriptor);
+
   return FSAL_close_by_fileid(&file_descriptor->fsal_file, fileid);
 }                               /* MFSL_close_by_fileid */
 
@@ -0,0 +1,415 @@
+/*
+ *
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * \file    mfsl_aio_readahead.c
+ * \brief   I/O threads of MFSL_AIO.
+ *
+ * When a file is read sequentially, the chunk that follows each read is
+ * queued to a pool of I/O threads, that read it in the read ahead buffer of
+ * the file. The worker which asks for this chunk then just copies it (or
+ * waits for the end of the read that is already in progress), instead of
+ * waiting for a full FSAL_read.
+ *
+ * The I/O threads call FSAL_read with the fsal_file_t of the worker that
+ * opened the file, at the same time as this worker may use it. This is only
+ * safe with the FSALs whose read is a pread on a file descriptor: with
+ * FSAL_PROXY for instance, the file holds the RPC client of the opener's
+ * context, which can not be used by two threads. Read ahead is disabled with
+ * the other FSALs.
+ *
+ */
+
+#include "config.h"
+
+/* fsal_types contains constants and type definitions for FSAL */
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+#include "fsal_types.h"
+#include "fsal.h"
+#include "mfsl_types.h"
+#include "mfsl.h"
+#include "common_utils.h"
+#include "stuff_alloc.h"
+#include "log_macros.h"
+#include "RW_Lock.h"
+
+#ifndef _USE_SWIG
+
+#if defined(_USE_POSIX) || defined(_USE_XFS) || defined(_USE_GPFS) || defined(_USE_LUSTRE)
+#define MFSL_AIO_PREAD_FSAL
+#endif
+
+static mfsl_parameter_t mfsl_aio_param;
+
+static pthread_t *mfsl_aio_io_thrid = NULL;
+
+/* The read aheads waiting for an I/O thread */
+static pthread_mutex_t mfsl_aio_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t mfsl_aio_queue_condvar = PTHREAD_COND_INITIALIZER;
+static mfsl_aio_readahead_t *mfsl_aio_queue_first = NULL;
+static mfsl_aio_readahead_t *mfsl_aio_queue_last = NULL;
+
+/**
+ *
+ * mfsl_aio_readahead_submit: queues the read ahead of a file to the I/O threads.
+ *
+ * The read ahead must be locked and not pending. If its buffer can not be
+ * allocated, the read ahead is just not done.
+ *
+ * @param pra    [INOUT] the read ahead of the file
+ * @param offset [IN]    where to read
+ * @param size   [IN]    how much to read
+ *
+ */
+static void mfsl_aio_readahead_submit(mfsl_aio_readahead_t * pra,
+                                      fsal_off_t offset, fsal_size_t size)
+{
+  if(pra->buffer_size < size)
+    {
+      if(pra->buffer != NULL)
+        Mem_Free(pra->buffer);
+
+      if((pra->buffer = (caddr_t) Mem_Alloc_Label(size, "mfsl_aio_readahead")) == NULL)
+        {
+          pra->buffer_size = 0;
+          pra->state = MFSL_AIO_RA_IDLE;
+          return;
+        }
+      pra->buffer_size = size;
+    }
+
+  pra->offset = offset;
+  pra->size = size;
+  pra->state = MFSL_AIO_RA_PENDING;
+  pra->next = NULL;
+
+  P(mfsl_aio_queue_mutex);
+
+  if(mfsl_aio_queue_last == NULL)
+    mfsl_aio_queue_first = pra;
+  else
+    mfsl_aio_queue_last->next = pra;
+  mfsl_aio_queue_last = pra;
+
+  pthread_cond_signal(&mfsl_aio_queue_condvar);
+
+  V(mfsl_aio_queue_mutex);
+}                               /* mfsl_aio_readahead_submit */
+
+/**
+ *
+ * mfsl_aio_readahead_wait: waits for the end of a pending read ahead.
+ *
+ * @param pra [INOUT] the read ahead of the file, locked.
+ *
+ */
+static void mfsl_aio_readahead_wait(mfsl_aio_readahead_t * pra)
+{
+  while(pra->state == MFSL_AIO_RA_PENDING)
+    pthread_cond_wait(&pra->cond, &pra->lock);
+}                               /* mfsl_aio_readahead_wait */
+
+/**
+ *
+ * mfsl_aio_io_thread: thread that does the read aheads.
+ *
+ * @param Arg the index for the thread
+ *
+ * @return Pointer to the result (but this function will mostly loop forever).
+ *
+ */
+static void *mfsl_aio_io_thread(void *Arg)
+{
+  long index = (long)Arg;
+  char namestr[64];
+  mfsl_aio_readahead_t *pra;
+  fsal_seek_t seek;
+  fsal_size_t read_amount;
+  fsal_boolean_t end_of_file;
+  fsal_status_t status;
+
+  sprintf(namestr, "MFSL_AIO IO #%ld", index);
+  SetNameFunction(namestr);
+
+#ifndef _NO_BUDDY_SYSTEM
+  if(BuddyInit(NULL) != BUDDY_SUCCESS)
+    {
+      /* Failed init */
+      LogMajor(COMPONENT_MFSL, "Memory manager could not be initialized, exiting...");
+      exit(1);
+    }
+#endif
+
+  LogEvent(COMPONENT_MFSL, "Started...");
+
+  while(1)
+    {
+      P(mfsl_aio_queue_mutex);
+
+      while(mfsl_aio_queue_first == NULL)
+        pthread_cond_wait(&mfsl_aio_queue_condvar, &mfsl_aio_queue_mutex);
+
+      pra = mfsl_aio_queue_first;
+      mfsl_aio_queue_first = pra->next;
+      if(mfsl_aio_queue_first == NULL)
+        mfsl_aio_queue_last = NULL;
+
+      V(mfsl_aio_queue_mutex);
+
+      /* offset, size and buffer do not change while the read ahead is pending */
+      seek.whence = FSAL_SEEK_SET;
+      seek.offset = pra->offset;
+      read_amount = 0;
+      end_of_file = FALSE;
+
+      status = FSAL_read(pra->pfsal_file, &seek, pra->size, pra->buffer,
+                         &read_amount, &end_of_file);
+
+      P(pra->lock);
+
+      pra->status = status;
+      pra->read_amount = read_amount;
+      pra->end_of_file = end_of_file;
+      pra->state = MFSL_AIO_RA_READY;
+
+      pthread_cond_broadcast(&pra->cond);
+
+      V(pra->lock);
+    }
+
+  return NULL;
+}                               /* mfsl_aio_io_thread */
+
+/**
+ *
+ * mfsl_aio_readahead_init: starts the I/O threads.
+ *
+ * @param pparam [IN] the MFSL parameters
+ *
+ * @return a FSAL status
+ *
+ */
+fsal_status_t mfsl_aio_readahead_init(mfsl_parameter_t * pparam)
+{
+  pthread_attr_t attr_thr;
+  unsigned long i;
+  int rc;
+
+  mfsl_aio_param = *pparam;
+
+#ifndef MFSL_AIO_PREAD_FSAL
+  if(mfsl_aio_param.nb_io_threads != 0)
+    {
+      LogMajor(COMPONENT_MFSL,
+               "MFSL_AIO: read ahead is not supported with this FSAL, Nb_IO_Threads is ignored");
+      mfsl_aio_param.nb_io_threads = 0;
+    }
+#endif
+
+  if(mfsl_aio_param.nb_io_threads == 0)
+    MFSL_return(ERR_FSAL_NO_ERROR, 0);
+
+  pthread_attr_init(&attr_thr);
+  pthread_attr_setscope(&attr_thr, PTHREAD_SCOPE_SYSTEM);
+  pthread_attr_setdetachstate(&attr_thr, PTHREAD_CREATE_DETACHED);
+
+  if((mfsl_aio_io_thrid =
+      (pthread_t *) Mem_Alloc(mfsl_aio_param.nb_io_threads * sizeof(pthread_t))) == NULL)
+    MFSL_return(ERR_FSAL_NOMEM, errno);
+
+  for(i = 0; i < mfsl_aio_param.nb_io_threads; i++)
+    {
+      if((rc = pthread_create(&mfsl_aio_io_thrid[i],
+                              &attr_thr, mfsl_aio_io_thread, (void *)i)) != 0)
+        MFSL_return(ERR_FSAL_SERVERFAULT, -rc);
+    }
+
+  LogEvent(COMPONENT_MFSL, "MFSL_AIO: %u I/O threads, read ahead up to %llu bytes",
+           mfsl_aio_param.nb_io_threads,
+           (unsigned long long)mfsl_aio_param.readahead_max);
+
+  MFSL_return(ERR_FSAL_NO_ERROR, 0);
+}                               /* mfsl_aio_readahead_init */
+
+/**
+ *
+ * mfsl_aio_readahead_open: sets up the read ahead of a file that was just opened.
+ *
+ * @param pfile [INOUT] the opened file
+ *
+ */
+void mfsl_aio_readahead_open(mfsl_file_t * pfile)
+{
+  mfsl_aio_readahead_t *pra;
+
+  /* the descriptor given to open is not initialized */
+  pfile->readahead = NULL;
+
+  if(mfsl_aio_param.nb_io_threads == 0)
+    return;
+
+  if((pra = (mfsl_aio_readahead_t *) Mem_Alloc_Label(sizeof(mfsl_aio_readahead_t),
+                                                      "mfsl_aio_readahead_t")) == NULL)
+    return;
+
+  memset(pra, 0, sizeof(mfsl_aio_readahead_t));
+  pthread_mutex_init(&pra->lock, NULL);
+  pthread_cond_init(&pra->cond, NULL);
+  pra->pfsal_file = &pfile->fsal_file;
+  pra->state = MFSL_AIO_RA_IDLE;
+
+  pfile->readahead = pra;
+}                               /* mfsl_aio_readahead_open */
+
+/**
+ *
+ * mfsl_aio_readahead_close: releases the read ahead of a file before it is closed.
+ *
+ * @param pfile [INOUT] the file to be closed
+ *
+ */
+void mfsl_aio_readahead_close(mfsl_file_t * pfile)
+{
+  mfsl_aio_readahead_t *pra = pfile->readahead;
+
+  if(pra == NULL)
+    return;
+
+  P(pra->lock);
+  mfsl_aio_readahead_wait(pra);
+  V(pra->lock);
+
+  pthread_mutex_destroy(&pra->lock);
+  pthread_cond_destroy(&pra->cond);
+
+  if(pra->buffer != NULL)
+    Mem_Free(pra->buffer);
+  Mem_Free(pra);
+
+  pfile->readahead = NULL;
+}                               /* mfsl_aio_readahead_close */
+
+/**
+ *
+ * mfsl_aio_readahead_invalidate: drops the data read ahead in a file.
+ *
+ * Used around writes, so that no read is served with data older than them.
+ *
+ * @param pfile [INOUT] the file
+ *
+ */
+void mfsl_aio_readahead_invalidate(mfsl_file_t * pfile)
+{
+  mfsl_aio_readahead_t *pra = pfile->readahead;
+
+  if(pra == NULL)
+    return;
+
+  P(pra->lock);
+  mfsl_aio_readahead_wait(pra);
+  pra->state = MFSL_AIO_RA_IDLE;
+  V(pra->lock);
+}                               /* mfsl_aio_readahead_invalidate */
+
+/**
+ *
+ * mfsl_aio_read: reads a file, using and feeding its read ahead.
+ *
+ * Same parameters as FSAL_read.
+ *
+ */
+fsal_status_t mfsl_aio_read(mfsl_file_t * pfile,        /*  IN  */
+                            fsal_seek_t * seek_descriptor,      /* [IN] */
+                            fsal_size_t buffer_size,    /*  IN  */
+                            caddr_t buffer,     /* OUT  */
+                            fsal_size_t * read_amount,  /* OUT  */
+                            fsal_boolean_t * end_of_file        /* OUT  */
+    )
+{
+  mfsl_aio_readahead_t *pra = pfile->readahead;
+  fsal_status_t status;
+  fsal_off_t offset;
+  fsal_size_t copied;
+
+  if(pra == NULL || seek_descriptor == NULL ||
+     seek_descriptor->whence != FSAL_SEEK_SET ||
+     buffer_size > mfsl_aio_param.readahead_max)
+    return FSAL_read(&pfile->fsal_file,
+                     seek_descriptor, buffer_size, buffer, read_amount, end_of_file);
+
+  offset = seek_descriptor->offset;
+
+  P(pra->lock);
+
+  /* This very chunk is being read ahead: no need to read it twice */
+  while(pra->state == MFSL_AIO_RA_PENDING &&
+        pra->offset == offset && pra->size >= buffer_size)
+    pthread_cond_wait(&pra->cond, &pra->lock);
+
+  if(pra->state == MFSL_AIO_RA_READY && pra->offset == offset &&
+     !FSAL_IS_ERROR(pra->status) &&
+     (pra->read_amount >= buffer_size || pra->end_of_file))
+    {
+      copied = (pra->read_amount < buffer_size) ? pra->read_amount : buffer_size;
+
+      memcpy(buffer, pra->buffer, copied);
+      *read_amount = copied;
+      *end_of_file = (pra->end_of_file && copied == pra->read_amount);
+
+      pra->state = MFSL_AIO_RA_IDLE;
+      pra->next_offset = offset + copied;
+
+      if(!*end_of_file)
+        mfsl_aio_readahead_submit(pra, offset + copied, buffer_size);
+
+      V(pra->lock);
+
+      MFSL_return(ERR_FSAL_NO_ERROR, 0);
+    }
+
+  V(pra->lock);
+
+  status = FSAL_read(&pfile->fsal_file,
+                     seek_descriptor, buffer_size, buffer, read_amount, end_of_file);
+  if(FSAL_IS_ERROR(status))
+    return status;
+
+  P(pra->lock);
+
+  /* A sequential reader will ask for the next chunk soon */
+  if(offset == pra->next_offset && pra->state != MFSL_AIO_RA_PENDING &&
+     *read_amount > 0 && !*end_of_file)
+    mfsl_aio_readahead_submit(pra, offset + *read_amount, buffer_size);
+
+  pra->next_offset = offset + *read_amount;
+
+  V(pra->lock);
+
+  return status;
+}                               /* mfsl_aio_read */
+
+#endif                          /* ! _USE_SWIG */
@@ -87,6 +87,9 @@ int Svc_dg_enablecache(SVCXPRT *, u_int);
 
 extern void Xprt_register(SVCXPRT *);
 extern void Xprt_unregister(SVCXPRT *);
+extern ssize_t Svc_mmsg_sendto(int, void *, size_t, struct sockaddr *, socklen_t);
+bool_t Svc_dg_recv_buffered(SVCXPRT *, struct rpc_msg *, size_t, struct sockaddr *,
+                            socklen_t);
 /*
  * Usage:
  *	xprt = svc_dg_create(sock, sendsize, recvsize);
@@ -182,11 +185,8 @@ SVCXPRT *xprt;
 struct rpc_msg *msg;
 {
   struct svc_dg_data *su = su_data(xprt);
-  XDR *xdrs = &(su->su_xdrs);
-  char *reply;
   struct sockaddr_storage ss;
   socklen_t alen;
-  size_t replylen;
   ssize_t rlen;
 
  again:
@@ -195,7 +195,40 @@ struct rpc_msg *msg;
                   (struct sockaddr *)(void *)&ss, &alen);
   if(rlen == -1 && errno == EINTR)
     goto again;
-  if(rlen == -1 || (rlen < (ssize_t) (4 * sizeof(u_int32_t))))
+  if(rlen == -1)
+    return (FALSE);
+  return Svc_dg_recv_buffered(xprt, msg, (size_t) rlen, (struct sockaddr *)(void *)&ss,
+                              alen);
+}
+
+/*
+ * Gives the buffer a datagram for this xprt is to be received in, when the
+ * datagrams are received in batch by the dispatcher.
+ */
+char *Svc_dg_getbuf(xprt, psize)
+SVCXPRT *xprt;
+u_int *psize;
+{
+  *psize = su_data(xprt)->su_iosz;
+  return rpc_buffer(xprt);
+}
+
+/*
+ * Decodes a datagram of rlen bytes, received from ss in the buffer of xprt.
+ */
+bool_t Svc_dg_recv_buffered(xprt, msg, rlen, ss, alen)
+SVCXPRT *xprt;
+struct rpc_msg *msg;
+size_t rlen;
+struct sockaddr *ss;
+socklen_t alen;
+{
+  struct svc_dg_data *su = su_data(xprt);
+  XDR *xdrs = &(su->su_xdrs);
+  char *reply;
+  size_t replylen;
+
+  if(rlen < 4 * sizeof(u_int32_t))
     return (FALSE);
   if(xprt->xp_rtaddr.len < alen)
     {
@@ -204,9 +237,9 @@ struct rpc_msg *msg;
       xprt->xp_rtaddr.buf = Mem_Alloc(alen);
       xprt->xp_rtaddr.len = alen;
     }
-  memcpy(xprt->xp_rtaddr.buf, &ss, alen);
+  memcpy(xprt->xp_rtaddr.buf, ss, alen);
 #ifdef PORTMAP
-  if(ss.ss_family == AF_INET6)
+  if(ss->sa_family == AF_INET6)
     {
       xprt->xp_raddr = *(struct sockaddr_in6 *)xprt->xp_rtaddr.buf;
       xprt->xp_addrlen = sizeof(struct sockaddr_in6);
@@ -223,8 +256,7 @@ struct rpc_msg *msg;
     {
       if(cache_get(xprt, msg, &reply, &replylen))
         {
-          (void)sendto(xprt->xp_fd, reply, replylen, 0,
-                       (struct sockaddr *)(void *)&ss, alen);
+          (void)sendto(xprt->xp_fd, reply, replylen, 0, ss, alen);
           return (FALSE);
         }
     }
@@ -246,9 +278,9 @@ struct rpc_msg *msg;
   if(xdr_replymsg(xdrs, msg))
     {
       slen = XDR_GETPOS(xdrs);
-      if(sendto(xprt->xp_fd, rpc_buffer(xprt), slen, 0,
-                (struct sockaddr *)xprt->xp_rtaddr.buf,
-                (socklen_t) xprt->xp_rtaddr.len) == (ssize_t) slen)
+      if(Svc_mmsg_sendto(xprt->xp_fd, rpc_buffer(xprt), slen,
+                         (struct sockaddr *)xprt->xp_rtaddr.buf,
+                         (socklen_t) xprt->xp_rtaddr.len) == (ssize_t) slen)
         {
           stat = TRUE;
           if(su->su_cache)
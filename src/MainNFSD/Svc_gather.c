@@ -0,0 +1,424 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * \file    Svc_gather.c
+ * \brief   Scatter-gather reply path for the connection oriented transports.
+ *
+ * Svc_gather.c : the replies are XDR-encoded into a small per-thread buffer,
+ * but every large opaque (typically the data of a READ reply) is not copied:
+ * it is kept as a reference to the caller's buffer and sent with writev
+ * next to the encoded headers. The RPC record marking is done here, so the
+ * xdrrec stream of the transport is not used for such replies.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef _SOLARIS
+#include "solaris_port.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/poll.h>
+
+#ifdef _USE_GSSRPC
+#include <gssrpc/rpc.h>
+#include <gssrpc/svc.h>
+#else
+#include <rpc/rpc.h>
+#include <rpc/svc.h>
+#endif
+
+#include "log_macros.h"
+#include "stuff_alloc.h"
+#include "nfs_core.h"
+
+extern nfs_parameter_t nfs_param;
+
+/* Size of the per-thread buffer used for the encoded (non bulk) part of the replies */
+#define SVC_GATHER_BUFFER_SIZE       NFS_SEND_BUFFER_SIZE
+
+/* Opaques smaller than this are copied into the buffer, bigger ones are sent in place */
+#define SVC_GATHER_MIN_SEGMENT_SIZE  1024
+
+/* Max number of in place segments per record fragment */
+#define SVC_GATHER_MAX_SEGMENTS      16
+
+/* Last fragment flag for RPC record marking (RFC 1831, section 10) */
+#define SVC_GATHER_LAST_FRAG         0x80000000
+
+/* A write that makes no progress for this long kills the connection */
+#define SVC_GATHER_WRITE_TIMEOUT     35
+
+#ifndef RPCSEC_GSS
+#define RPCSEC_GSS                   6
+#endif
+
+typedef struct svc_gather_segment__
+{
+  u_int offset;                 /* position in the buffer where the segment is to be inserted */
+  char *base;
+  u_int len;
+} svc_gather_segment_t;
+
+typedef struct svc_gather__
+{
+  XDR xdrs;
+  int fd;
+  bool_t died;
+  unsigned int nb_fragments;    /* non-final fragments already sent */
+  unsigned int nb_segments;
+  u_int segments_len;
+  svc_gather_segment_t segments[SVC_GATHER_MAX_SEGMENTS];
+  char buffer[SVC_GATHER_BUFFER_SIZE];
+} svc_gather_t;
+
+static pthread_key_t gather_key;
+static pthread_once_t gather_once = PTHREAD_ONCE_INIT;
+
+static pthread_mutex_t gather_ops_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct xdr_ops gather_ops;
+static const struct xdr_ops *mem_ops = NULL;
+
+static void Svc_gather_reset(svc_gather_t * pgather);
+
+/* Frees the gather context of a thread when it exits */
+static void Svc_gather_free_context(void *ptr)
+{
+  free(ptr);
+}                               /* Svc_gather_free_context */
+
+/* Init of pthread_keys */
+static void Svc_gather_init_keys(void)
+{
+  if(pthread_key_create(&gather_key, Svc_gather_free_context) == -1)
+    LogCrit(COMPONENT_DISPATCH, "Svc_gather_init_keys - pthread_key_create returned %d",
+            errno);
+}                               /* Svc_gather_init_keys */
+
+/**
+ * Svc_gather_GetThreadContext: returns the gather context of the current thread.
+ */
+static svc_gather_t *Svc_gather_GetThreadContext(void)
+{
+  svc_gather_t *pgather;
+
+  if(pthread_once(&gather_once, Svc_gather_init_keys) != 0)
+    return NULL;
+
+  pgather = (svc_gather_t *) pthread_getspecific(gather_key);
+
+  if(pgather == NULL)
+    {
+      /* This lives as long as the thread, do not take it from a thread's buddy context */
+      pgather = (svc_gather_t *) malloc(sizeof(svc_gather_t));
+      if(pgather == NULL)
+        return NULL;
+
+      pthread_setspecific(gather_key, (void *)pgather);
+    }
+
+  return pgather;
+}                               /* Svc_gather_GetThreadContext */
+
+/**
+ * Svc_gather_write: writes an iovec to the socket, handling short writes.
+ *
+ * @return 0 if ok, -1 if the connection is to be considered as dead.
+ */
+static int Svc_gather_write(int fd, struct iovec *iov, int iovcnt)
+{
+  ssize_t rc;
+  struct pollfd pollfd;
+
+  /* Queue what the client does not accept at once, instead of waiting for it */
+  if(Svc_sendq_active())
+    return (Svc_sendq_writev(fd, iov, iovcnt) < 0) ? -1 : 0;
+
+  while(iovcnt > 0)
+    {
+      rc = writev(fd, iov, iovcnt);
+
+      if(rc < 0)
+        {
+          if(errno == EINTR)
+            continue;
+
+          if(errno != EAGAIN)
+            return -1;
+
+          /* Socket buffer is full, wait for the client to consume it */
+          pollfd.fd = fd;
+          pollfd.events = POLLOUT;
+          pollfd.revents = 0;
+          if(poll(&pollfd, 1, SVC_GATHER_WRITE_TIMEOUT * 1000) <= 0)
+            return -1;
+
+          continue;
+        }
+
+      /* Skip what was written */
+      while(iovcnt > 0 && rc >= (ssize_t) iov->iov_len)
+        {
+          rc -= iov->iov_len;
+          iov++;
+          iovcnt--;
+        }
+
+      if(iovcnt > 0)
+        {
+          iov->iov_base = (char *)iov->iov_base + rc;
+          iov->iov_len -= rc;
+        }
+    }
+
+  return 0;
+}                               /* Svc_gather_write */
+
+/**
+ * Svc_gather_flush: sends what was encoded so far as one record fragment.
+ *
+ * @param pgather [INOUT] the gather context.
+ * @param last    [IN]    TRUE if this is the last fragment of the record.
+ *
+ * @return TRUE if ok, FALSE otherwise.
+ */
+static bool_t Svc_gather_flush(svc_gather_t * pgather, bool_t last)
+{
+  struct iovec iov[2 * SVC_GATHER_MAX_SEGMENTS + 2];
+  u_int32_t mark;
+  u_int pos;
+  u_int len;
+  u_int offset = 0;
+  int iovcnt = 0;
+  unsigned int i;
+
+  if(pgather->died)
+    return FALSE;
+
+  pos = mem_ops->x_getpostn(&pgather->xdrs);
+  len = pos + pgather->segments_len;
+
+  mark = htonl((last ? SVC_GATHER_LAST_FRAG : 0) | len);
+  iov[iovcnt].iov_base = (char *)&mark;
+  iov[iovcnt].iov_len = sizeof(mark);
+  iovcnt++;
+
+  /* Interleave the encoded buffer with the in place segments */
+  for(i = 0; i < pgather->nb_segments; i++)
+    {
+      if(pgather->segments[i].offset > offset)
+        {
+          iov[iovcnt].iov_base = pgather->buffer + offset;
+          iov[iovcnt].iov_len = pgather->segments[i].offset - offset;
+          iovcnt++;
+          offset = pgather->segments[i].offset;
+        }
+
+      iov[iovcnt].iov_base = pgather->segments[i].base;
+      iov[iovcnt].iov_len = pgather->segments[i].len;
+      iovcnt++;
+    }
+
+  if(pos > offset)
+    {
+      iov[iovcnt].iov_base = pgather->buffer + offset;
+      iov[iovcnt].iov_len = pos - offset;
+      iovcnt++;
+    }
+
+  if(Svc_gather_write(pgather->fd, iov, iovcnt) != 0)
+    {
+      LogDebug(COMPONENT_DISPATCH,
+               "Svc_gather_flush: write of %u bytes failed on socket %d, errno=%u",
+               len, pgather->fd, errno);
+      pgather->died = TRUE;
+      return FALSE;
+    }
+
+  if(!last)
+    pgather->nb_fragments++;
+
+  Svc_gather_reset(pgather);
+
+  return TRUE;
+}                               /* Svc_gather_flush */
+
+static bool_t Svc_gather_putlong(XDR * xdrs, const long *lp)
+{
+  svc_gather_t *pgather = (svc_gather_t *) xdrs->x_public;
+
+  if(mem_ops->x_putlong(xdrs, lp))
+    return TRUE;
+
+  /* Buffer is full, send it as a non-final fragment */
+  if(!Svc_gather_flush(pgather, FALSE))
+    return FALSE;
+
+  return mem_ops->x_putlong(xdrs, lp);
+}                               /* Svc_gather_putlong */
+
+static bool_t Svc_gather_putbytes(XDR * xdrs, const char *addr, u_int len)
+{
+  svc_gather_t *pgather = (svc_gather_t *) xdrs->x_public;
+  svc_gather_segment_t *pseg;
+  u_int chunk;
+
+  if(len >= SVC_GATHER_MIN_SEGMENT_SIZE)
+    {
+      if(pgather->nb_segments == SVC_GATHER_MAX_SEGMENTS)
+        if(!Svc_gather_flush(pgather, FALSE))
+          return FALSE;
+
+      /* Keep a reference, the caller's buffer remains valid until the reply is sent */
+      pseg = &pgather->segments[pgather->nb_segments++];
+      pseg->offset = mem_ops->x_getpostn(xdrs);
+      pseg->base = (char *)addr;
+      pseg->len = len;
+      pgather->segments_len += len;
+
+      return TRUE;
+    }
+
+  while(len > 0)
+    {
+      chunk = (len < xdrs->x_handy) ? len : xdrs->x_handy;
+
+      if(chunk > 0)
+        {
+          if(!mem_ops->x_putbytes(xdrs, addr, chunk))
+            return FALSE;
+          addr += chunk;
+          len -= chunk;
+        }
+
+      if(len > 0)
+        if(!Svc_gather_flush(pgather, FALSE))
+          return FALSE;
+    }
+
+  return TRUE;
+}                               /* Svc_gather_putbytes */
+
+/**
+ * Svc_gather_reset: makes the context ready for a new fragment.
+ */
+static void Svc_gather_reset(svc_gather_t * pgather)
+{
+  xdrmem_create(&pgather->xdrs, pgather->buffer, SVC_GATHER_BUFFER_SIZE, XDR_ENCODE);
+
+  /* Inherit everything from the memory stream, only override the encoding side */
+  if(mem_ops == NULL)
+    {
+      P(gather_ops_lock);
+      if(mem_ops == NULL)
+        {
+          gather_ops = *(pgather->xdrs.x_ops);
+          gather_ops.x_putlong = Svc_gather_putlong;
+          gather_ops.x_putbytes = Svc_gather_putbytes;
+          mem_ops = pgather->xdrs.x_ops;
+        }
+      V(gather_ops_lock);
+    }
+
+  pgather->xdrs.x_ops = &gather_ops;
+  pgather->xdrs.x_public = (caddr_t) pgather;
+  pgather->nb_segments = 0;
+  pgather->segments_len = 0;
+}                               /* Svc_gather_reset */
+
+/**
+ * Svc_gather_active: tells if a reply should use the gather path.
+ *
+ * The gather path encodes the results with xdr_replymsg, without SVCAUTH_WRAP:
+ * the replies to RPCSEC_GSS requests, whose results may have to be checksummed
+ * or encrypted, go through the xdrrec stream of the transport instead.
+ */
+bool_t Svc_gather_active(struct rpc_msg * msg)
+{
+  if(!nfs_param.core_param.zero_copy_read)
+    return FALSE;
+
+  if(msg->rm_reply.rp_stat == MSG_ACCEPTED &&
+     msg->acpted_rply.ar_verf.oa_flavor == RPCSEC_GSS)
+    return FALSE;
+
+  return TRUE;
+}                               /* Svc_gather_active */
+
+/**
+ * Svc_gather_reply: encodes and sends a reply on a connection oriented transport.
+ *
+ * Encodes a reply message without copying the large opaques it contains,
+ * then sends it (with record marking) using writev. This is to be called
+ * instead of xdr_replymsg + xdrrec_endofrecord, with the per-socket mutex
+ * held by the caller, as the other reply paths.
+ *
+ * @param fd    [IN]  the socket the reply is to be sent on.
+ * @param msg   [IN]  the reply message.
+ * @param pdied [OUT] set to TRUE if the connection should be considered as dead.
+ *
+ * @return TRUE if the reply was sent, FALSE otherwise.
+ */
+bool_t Svc_gather_reply(int fd, struct rpc_msg * msg, bool_t * pdied)
+{
+  svc_gather_t *pgather;
+
+  *pdied = FALSE;
+
+  if((pgather = Svc_gather_GetThreadContext()) == NULL)
+    {
+      LogCrit(COMPONENT_DISPATCH, "Svc_gather_reply: could not get a gather context");
+      return FALSE;
+    }
+
+  pgather->fd = fd;
+  pgather->died = FALSE;
+  pgather->nb_fragments = 0;
+  Svc_gather_reset(pgather);
+
+  if(!xdr_replymsg(&pgather->xdrs, msg))
+    {
+      /* A partially sent record can't be recovered */
+      *pdied = (pgather->died || pgather->nb_fragments != 0);
+      return FALSE;
+    }
+
+  if(!Svc_gather_flush(pgather, TRUE))
+    {
+      *pdied = TRUE;
+      return FALSE;
+    }
+
+  return TRUE;
+}                               /* Svc_gather_reply */
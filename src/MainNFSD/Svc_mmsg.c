@@ -0,0 +1,344 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * \file    Svc_mmsg.c
+ * \brief   Batched receive and send for the datagram transports.
+ *
+ * Svc_mmsg.c : the dispatcher reads all the datagrams waiting on a UDP
+ * socket with a single recvmmsg, each one in the buffer of its own request.
+ * The replies of the workers are queued per socket, and sent with sendmmsg
+ * by one of the workers replying: the first one to find nobody sending
+ * takes the lead, sends every reply queued at that time, and goes on until
+ * its own reply is sent, while the others wait for theirs. A worker alone
+ * thus sends its reply at once, and workers replying together share the
+ * system calls.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef _SOLARIS
+#include "solaris_port.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+
+#ifdef _USE_GSSRPC
+#include <gssrpc/rpc.h>
+#include <gssrpc/svc.h>
+#else
+#include <rpc/rpc.h>
+#include <rpc/svc.h>
+#endif
+
+#include "log_macros.h"
+#include "stuff_alloc.h"
+#include "nfs_core.h"
+
+/* Max number of datagrams received or sent with one system call */
+#define SVC_MMSG_MAX    64
+
+#if defined( HAVE_RECVMMSG ) || defined( HAVE_SENDMMSG )
+typedef struct mmsghdr svc_mmsghdr_t;
+#else
+/* Without recvmmsg and sendmmsg, the datagrams go one per system call */
+typedef struct svc_mmsghdr__
+{
+  struct msghdr msg_hdr;
+  unsigned int msg_len;
+} svc_mmsghdr_t;
+#endif
+
+typedef struct svc_mmsg_reply__
+{
+  struct iovec iov;
+  struct sockaddr *addr;
+  socklen_t addrlen;
+  ssize_t rc;
+  bool_t done;
+  struct svc_mmsg_reply__ *next;
+} svc_mmsg_reply_t;
+
+typedef struct svc_mmsg_queue__
+{
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  bool_t sending;               /* a worker is sending the queued replies */
+  svc_mmsg_reply_t *head;
+  svc_mmsg_reply_t *tail;
+} svc_mmsg_queue_t;
+
+/* Reply queues, per socket. Sockets without one are sent to directly. */
+static svc_mmsg_queue_t *svc_mmsg_queues[FD_SETSIZE];
+
+static unsigned int svc_mmsg_batch = 1;
+
+/**
+ *
+ * Svc_mmsg_init: Sets the replies on a datagram socket to be batched.
+ *
+ * Called at startup, for each UDP socket, before any request is received.
+ *
+ * @param fd         [IN] the socket
+ * @param batch_size [IN] max number of datagrams received per system call
+ *
+ * @return 0 if successful, -1 otherwise.
+ *
+ */
+int Svc_mmsg_init(int fd, unsigned int batch_size)
+{
+  svc_mmsg_queue_t *pqueue;
+
+  if(fd < 0 || fd >= FD_SETSIZE)
+    return -1;
+
+  svc_mmsg_batch = (batch_size > SVC_MMSG_MAX) ? SVC_MMSG_MAX : batch_size;
+
+  if(svc_mmsg_queues[fd] != NULL)
+    return 0;
+
+  if((pqueue = (svc_mmsg_queue_t *) Mem_Alloc(sizeof(svc_mmsg_queue_t))) == NULL)
+    return -1;
+
+  pthread_mutex_init(&pqueue->lock, NULL);
+  pthread_cond_init(&pqueue->cond, NULL);
+  pqueue->sending = FALSE;
+  pqueue->head = NULL;
+  pqueue->tail = NULL;
+
+  svc_mmsg_queues[fd] = pqueue;
+
+  return 0;
+}                               /* Svc_mmsg_init */
+
+/**
+ *
+ * Svc_mmsg_batch_size: Returns how many datagrams are received at once.
+ *
+ * @return the batch size, 1 when the datagrams are not batched.
+ *
+ */
+unsigned int Svc_mmsg_batch_size(void)
+{
+  return svc_mmsg_batch;
+}                               /* Svc_mmsg_batch_size */
+
+/**
+ *
+ * Svc_mmsg_recv: Receives the datagrams waiting on a socket.
+ *
+ * @param fd      [IN]    the socket, non blocking
+ * @param iov     [IN]    one buffer per datagram
+ * @param addrs   [OUT]   address of the sender of each datagram
+ * @param addrlen [OUT]   length of each address
+ * @param len     [OUT]   length of each datagram
+ * @param vlen    [IN]    number of buffers
+ *
+ * @return the number of datagrams received, -1 with errno set if none was.
+ *
+ */
+int Svc_mmsg_recv(int fd, struct iovec *iov, struct sockaddr_storage *addrs,
+                  socklen_t * addrlen, size_t * len, unsigned int vlen)
+{
+  svc_mmsghdr_t msgs[SVC_MMSG_MAX];
+  unsigned int i;
+  int rc;
+
+  if(vlen > SVC_MMSG_MAX)
+    vlen = SVC_MMSG_MAX;
+
+  memset(msgs, 0, vlen * sizeof(svc_mmsghdr_t));
+  for(i = 0; i < vlen; i++)
+    {
+      msgs[i].msg_hdr.msg_iov = &iov[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+      msgs[i].msg_hdr.msg_name = &addrs[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+    }
+
+#ifdef HAVE_RECVMMSG
+  do
+    rc = recvmmsg(fd, msgs, vlen, MSG_DONTWAIT, NULL);
+  while(rc == -1 && errno == EINTR);
+#else
+  for(rc = 0; rc < (int)vlen; rc++)
+    {
+      ssize_t rlen;
+
+      do
+        rlen = recvmsg(fd, &msgs[rc].msg_hdr, MSG_DONTWAIT);
+      while(rlen == -1 && errno == EINTR);
+
+      if(rlen == -1)
+        break;
+
+      msgs[rc].msg_len = rlen;
+    }
+  if(rc == 0)
+    rc = -1;
+#endif
+
+  for(i = 0; rc > 0 && i < (unsigned int)rc; i++)
+    {
+      len[i] = msgs[i].msg_len;
+      addrlen[i] = msgs[i].msg_hdr.msg_namelen;
+    }
+
+  return rc;
+}                               /* Svc_mmsg_recv */
+
+/* Sends a batch of replies, taken out of the queue. Called without the lock. */
+static void Svc_mmsg_send_batch(int fd, svc_mmsg_reply_t ** replies, unsigned int nb)
+{
+  svc_mmsghdr_t msgs[SVC_MMSG_MAX];
+  unsigned int i;
+  unsigned int sent;
+  int rc;
+
+  memset(msgs, 0, nb * sizeof(svc_mmsghdr_t));
+  for(i = 0; i < nb; i++)
+    {
+      msgs[i].msg_hdr.msg_iov = &replies[i]->iov;
+      msgs[i].msg_hdr.msg_iovlen = 1;
+      msgs[i].msg_hdr.msg_name = replies[i]->addr;
+      msgs[i].msg_hdr.msg_namelen = replies[i]->addrlen;
+    }
+
+  for(sent = 0; sent < nb;)
+    {
+#ifdef HAVE_SENDMMSG
+      rc = sendmmsg(fd, &msgs[sent], nb - sent, MSG_DONTWAIT);
+#else
+      rc = sendmsg(fd, &msgs[sent].msg_hdr, MSG_DONTWAIT);
+      if(rc >= 0)
+        {
+          msgs[sent].msg_len = rc;
+          rc = 1;
+        }
+#endif
+      if(rc == -1 && errno == EINTR)
+        continue;
+
+      if(rc <= 0)
+        {
+          /* This reply is lost, as with sendto: the client will retry */
+          replies[sent]->rc = -1;
+          sent += 1;
+          continue;
+        }
+
+      for(i = sent; i < sent + rc; i++)
+        replies[i]->rc = msgs[i].msg_len;
+      sent += rc;
+    }
+}                               /* Svc_mmsg_send_batch */
+
+/**
+ *
+ * Svc_mmsg_sendto: Sends a reply on a datagram socket.
+ *
+ * Same as sendto. If the socket batches its replies, the reply is queued
+ * and this function returns once it was sent, by this worker or another.
+ *
+ * @return the number of bytes sent, -1 if the reply could not be sent.
+ *
+ */
+ssize_t Svc_mmsg_sendto(int fd, void *buf, size_t len, struct sockaddr * addr,
+                        socklen_t addrlen)
+{
+  svc_mmsg_queue_t *pqueue;
+  svc_mmsg_reply_t reply;
+  svc_mmsg_reply_t *batch[SVC_MMSG_MAX];
+  unsigned int nb;
+
+  if(fd < 0 || fd >= FD_SETSIZE || (pqueue = svc_mmsg_queues[fd]) == NULL)
+    return sendto(fd, buf, len, 0, addr, addrlen);
+
+  reply.iov.iov_base = buf;
+  reply.iov.iov_len = len;
+  reply.addr = addr;
+  reply.addrlen = addrlen;
+  reply.rc = -1;
+  reply.done = FALSE;
+  reply.next = NULL;
+
+  P(pqueue->lock);
+
+  if(pqueue->tail == NULL)
+    pqueue->head = &reply;
+  else
+    pqueue->tail->next = &reply;
+  pqueue->tail = &reply;
+
+  while(!reply.done)
+    {
+      if(pqueue->sending)
+        {
+          pthread_cond_wait(&pqueue->cond, &pqueue->lock);
+          continue;
+        }
+
+      /* Nobody is sending: send what is queued, up to our own reply */
+      pqueue->sending = TRUE;
+
+      while(!reply.done)
+        {
+          for(nb = 0; nb < SVC_MMSG_MAX && pqueue->head != NULL; nb++)
+            {
+              batch[nb] = pqueue->head;
+              pqueue->head = pqueue->head->next;
+            }
+          if(pqueue->head == NULL)
+            pqueue->tail = NULL;
+
+          V(pqueue->lock);
+
+          Svc_mmsg_send_batch(fd, batch, nb);
+
+          P(pqueue->lock);
+
+          while(nb > 0)
+            batch[--nb]->done = TRUE;
+          pthread_cond_broadcast(&pqueue->cond);
+        }
+
+      /* A waiter whose reply is still queued takes the lead */
+      pqueue->sending = FALSE;
+    }
+
+  V(pqueue->lock);
+
+  return reply.rc;
+}                               /* Svc_mmsg_sendto */
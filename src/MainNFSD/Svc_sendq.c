@@ -0,0 +1,504 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * \file    Svc_sendq.c
+ * \brief   Asynchronous send queues for the connection oriented transports.
+ *
+ * Svc_sendq.c : the replies written on a TCP connection are sent without
+ * blocking. What the socket does not accept at once is copied to a queue
+ * kept per connection, and the replies written while the queue is not
+ * empty are appended to it, so that the order of the records is kept. The
+ * queues are drained by a sender thread, which waits with epoll for the
+ * sockets to become writable and sends every queued reply of a connection
+ * with a single sendmsg. A worker replying to a slow client thus goes back
+ * to its requests at once, unless the client lets more than
+ * TCP_Send_Queue_Size bytes pile up.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef _SOLARIS
+#include "solaris_port.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+
+#ifdef _USE_GSSRPC
+#include <gssrpc/rpc.h>
+#include <gssrpc/svc.h>
+#else
+#include <rpc/rpc.h>
+#include <rpc/svc.h>
+#endif
+
+#include "log_macros.h"
+#include "stuff_alloc.h"
+#include "nfs_core.h"
+
+extern nfs_parameter_t nfs_param;
+
+/* Max number of queued replies sent with one sendmsg */
+#define SVC_SENDQ_MAX_IOV            64
+
+/* Max number of events handled by the sender after one epoll_wait */
+#define SVC_SENDQ_EVENTS             64
+
+/* A writer waiting that long for room in a queue kills the connection */
+#define SVC_SENDQ_WRITE_TIMEOUT      35
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+typedef struct svc_sendq_entry__
+{
+  struct svc_sendq_entry__ *next;
+  size_t len;
+  size_t off;                   /* bytes already sent */
+  char data[1];
+} svc_sendq_entry_t;
+
+/* Send queue of a connection, kept in an array indexed by the socket (as Xports) */
+typedef struct svc_sendq__
+{
+  pthread_mutex_t lock;
+  pthread_cond_t room_cond;     /* signaled when the queue shrinks */
+  svc_sendq_entry_t *head;
+  svc_sendq_entry_t *tail;
+  size_t queued;                /* bytes not sent yet */
+  unsigned int generation;      /* bumped when the connection is closed */
+  bool_t registered;            /* the socket is in the epoll set of the sender */
+  bool_t died;
+} svc_sendq_t;
+
+static svc_sendq_t *sendq = NULL;
+static int sendq_epoll_fd = -1;
+static size_t sendq_max_size = 0;
+
+/**
+ * Svc_sendq_send: sends what a socket accepts without blocking.
+ *
+ * @return the number of bytes sent (maybe 0), -1 if the connection is dead.
+ */
+static ssize_t Svc_sendq_send(int fd, struct iovec *iov, int iovcnt, int flags)
+{
+  struct msghdr msg;
+  ssize_t rc;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = iovcnt;
+
+  do
+    rc = sendmsg(fd, &msg, flags | MSG_DONTWAIT | MSG_NOSIGNAL);
+  while(rc < 0 && errno == EINTR);
+
+  if(rc < 0)
+    {
+      if(errno == EAGAIN || errno == EWOULDBLOCK)
+        return 0;
+
+      LogDebug(COMPONENT_DISPATCH, "Svc_sendq_send: send failed on socket %d, errno=%d",
+               fd, errno);
+      return -1;
+    }
+
+  return rc;
+}                               /* Svc_sendq_send */
+
+/* Asks the sender to wake up when the socket is writable. Called with the queue locked. */
+static void Svc_sendq_arm(int fd, svc_sendq_t * pq)
+{
+  struct epoll_event ev;
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLOUT | EPOLLONESHOT;
+  ev.data.fd = fd;
+
+  if(epoll_ctl(sendq_epoll_fd, pq->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) != 0)
+    {
+      LogCrit(COMPONENT_DISPATCH, "Svc_sendq_arm: epoll_ctl failed on socket %d, errno=%d",
+              fd, errno);
+      pq->died = TRUE;
+      return;
+    }
+
+  pq->registered = TRUE;
+}                               /* Svc_sendq_arm */
+
+/* Frees the queued replies. Called with the queue locked. */
+static void Svc_sendq_purge(svc_sendq_t * pq)
+{
+  svc_sendq_entry_t *pentry;
+
+  while((pentry = pq->head) != NULL)
+    {
+      pq->head = pentry->next;
+      Mem_Free(pentry);
+    }
+
+  pq->tail = NULL;
+  pq->queued = 0;
+  pthread_cond_broadcast(&pq->room_cond);
+}                               /* Svc_sendq_purge */
+
+/**
+ * Svc_sendq_drain: sends the queued replies of a writable socket.
+ *
+ * All the replies of the queue are given to one sendmsg. When they do not
+ * fit in one call, MSG_MORE tells the TCP stack not to push a partial
+ * segment between two calls.
+ *
+ * @param fd [IN] the socket
+ *
+ */
+static void Svc_sendq_drain(int fd)
+{
+  svc_sendq_t *pq = &sendq[fd];
+  svc_sendq_entry_t *pentry;
+  struct iovec iov[SVC_SENDQ_MAX_IOV];
+  int iovcnt;
+  ssize_t rc;
+
+  P(pq->lock);
+
+  while(pq->head != NULL && !pq->died)
+    {
+      for(iovcnt = 0, pentry = pq->head; pentry != NULL && iovcnt < SVC_SENDQ_MAX_IOV;
+          pentry = pentry->next, iovcnt++)
+        {
+          iov[iovcnt].iov_base = pentry->data + pentry->off;
+          iov[iovcnt].iov_len = pentry->len - pentry->off;
+        }
+
+      rc = Svc_sendq_send(fd, iov, iovcnt, (pentry != NULL) ? MSG_MORE : 0);
+
+      if(rc < 0)
+        {
+          pq->died = TRUE;
+          break;
+        }
+
+      if(rc == 0)
+        break;
+
+      pq->queued -= rc;
+
+      /* Free what was sent */
+      while(rc > 0)
+        {
+          pentry = pq->head;
+
+          if((size_t) rc < pentry->len - pentry->off)
+            {
+              pentry->off += rc;
+              break;
+            }
+
+          rc -= pentry->len - pentry->off;
+          pq->head = pentry->next;
+          Mem_Free(pentry);
+        }
+
+      if(pq->head == NULL)
+        pq->tail = NULL;
+
+      pthread_cond_broadcast(&pq->room_cond);
+    }
+
+  if(pq->died)
+    Svc_sendq_purge(pq);
+  else if(pq->head != NULL)
+    Svc_sendq_arm(fd, pq);
+
+  V(pq->lock);
+}                               /* Svc_sendq_drain */
+
+/**
+ * Svc_sendq_thread: sends the queued replies when the sockets are writable.
+ *
+ * @param Arg not used.
+ *
+ * @return Pointer to the result (but this function will mostly loop forever).
+ *
+ */
+static void *Svc_sendq_thread(void *Arg)
+{
+  struct epoll_event events[SVC_SENDQ_EVENTS];
+  int nb_events;
+  int i;
+
+  SetNameFunction("tcp_sender");
+
+#ifndef _NO_BUDDY_SYSTEM
+  if(BuddyInit(&nfs_param.buddy_param_tcp_mgr) != BUDDY_SUCCESS)
+    {
+      /* Failed init */
+      LogCrit(COMPONENT_DISPATCH, "Memory manager could not be initialized");
+      exit(1);
+    }
+#endif
+
+  for(;;)
+    {
+      nb_events = epoll_wait(sendq_epoll_fd, events, SVC_SENDQ_EVENTS, -1);
+
+      if(nb_events < 0)
+        {
+          if(errno != EINTR)
+            LogCrit(COMPONENT_DISPATCH, "Svc_sendq_thread: epoll_wait failed, errno=%d",
+                    errno);
+          continue;
+        }
+
+      for(i = 0; i < nb_events; i++)
+        Svc_sendq_drain(events[i].data.fd);
+    }
+
+  return NULL;
+}                               /* Svc_sendq_thread */
+
+/**
+ * Svc_sendq_init: allocates the send queues and starts the sender thread.
+ *
+ * @param max_size [IN] max number of bytes queued per connection, 0 to send the replies synchronously.
+ *
+ * @return 0 if ok, -1 otherwise.
+ *
+ */
+int Svc_sendq_init(size_t max_size)
+{
+  pthread_attr_t attr_thr;
+  pthread_t thrid;
+  int nb_fd = nfs_param.core_param.nb_max_fd;
+  int i;
+
+  if(max_size == 0)
+    return 0;
+
+  if((sendq = (svc_sendq_t *) Mem_Calloc_Label(nb_fd, sizeof(svc_sendq_t),
+                                               "sendq array")) == NULL)
+    {
+      LogCrit(COMPONENT_DISPATCH, "Svc_sendq_init: could not allocate the send queues");
+      return -1;
+    }
+
+  for(i = 0; i < nb_fd; i++)
+    {
+      pthread_mutex_init(&sendq[i].lock, NULL);
+      pthread_cond_init(&sendq[i].room_cond, NULL);
+    }
+
+  if((sendq_epoll_fd = epoll_create(SVC_SENDQ_EVENTS)) < 0)
+    {
+      LogCrit(COMPONENT_DISPATCH, "Svc_sendq_init: epoll_create failed, errno=%d", errno);
+      return -1;
+    }
+
+  pthread_attr_init(&attr_thr);
+  pthread_attr_setscope(&attr_thr, PTHREAD_SCOPE_SYSTEM);
+  pthread_attr_setdetachstate(&attr_thr, PTHREAD_CREATE_DETACHED);
+
+  if(pthread_create(&thrid, &attr_thr, Svc_sendq_thread, NULL) != 0)
+    {
+      LogCrit(COMPONENT_DISPATCH, "Svc_sendq_init: could not create the sender thread");
+      return -1;
+    }
+
+  sendq_max_size = max_size;
+
+  LogEvent(COMPONENT_DISPATCH,
+           "Svc_sendq_init: TCP replies are queued, up to %lu bytes per connection",
+           (unsigned long)sendq_max_size);
+
+  return 0;
+}                               /* Svc_sendq_init */
+
+/**
+ * Svc_sendq_active: tells if the replies should go through the send queues.
+ */
+bool_t Svc_sendq_active(void)
+{
+  return (sendq_max_size > 0) ? TRUE : FALSE;
+}                               /* Svc_sendq_active */
+
+/**
+ * Svc_sendq_writev: sends data on a connection, without waiting for the client.
+ *
+ * The data is sent at once if the queue of the connection is empty and the
+ * socket accepts it. What is left is copied to the queue, so the caller's
+ * buffers can be reused as soon as this returns.
+ *
+ * @param fd     [IN] the socket
+ * @param iov    [IN] the data to be sent
+ * @param iovcnt [IN] number of items in iov
+ *
+ * @return the number of bytes sent or queued, -1 if the connection is dead.
+ *
+ */
+ssize_t Svc_sendq_writev(int fd, struct iovec * iov, int iovcnt)
+{
+  svc_sendq_t *pq;
+  svc_sendq_entry_t *pentry;
+  size_t total = 0;
+  size_t skip;
+  ssize_t sent = 0;
+  unsigned int generation;
+  struct timespec timeout;
+  char *pos;
+  int i;
+
+  if(fd < 0 || fd >= nfs_param.core_param.nb_max_fd)
+    return -1;
+
+  for(i = 0; i < iovcnt; i++)
+    total += iov[i].iov_len;
+
+  pq = &sendq[fd];
+
+  P(pq->lock);
+
+  generation = pq->generation;
+
+  /* A client that does not read its replies can't make us hold unbounded memory */
+  if(pq->queued > 0 && pq->queued + total > sendq_max_size)
+    {
+      timeout.tv_sec = time(NULL) + SVC_SENDQ_WRITE_TIMEOUT;
+      timeout.tv_nsec = 0;
+
+      while(pq->queued > 0 && pq->queued + total > sendq_max_size &&
+            !pq->died && pq->generation == generation)
+        if(pthread_cond_timedwait(&pq->room_cond, &pq->lock, &timeout) == ETIMEDOUT)
+          {
+            LogEvent(COMPONENT_DISPATCH,
+                     "Svc_sendq_writev: client on socket %d does not read its replies",
+                     fd);
+            pq->died = TRUE;
+            Svc_sendq_purge(pq);
+          }
+    }
+
+  if(pq->died || pq->generation != generation)
+    {
+      V(pq->lock);
+      return -1;
+    }
+
+  if(pq->head == NULL)
+    {
+      if((sent = Svc_sendq_send(fd, iov, iovcnt, 0)) < 0)
+        {
+          pq->died = TRUE;
+          V(pq->lock);
+          return -1;
+        }
+    }
+
+  if((size_t) sent < total)
+    {
+      pentry = (svc_sendq_entry_t *) Mem_Alloc(sizeof(svc_sendq_entry_t) + total - sent);
+      if(pentry == NULL)
+        {
+          LogCrit(COMPONENT_DISPATCH, "Svc_sendq_writev: could not queue %lu bytes",
+                  (unsigned long)(total - sent));
+          pq->died = TRUE;
+          Svc_sendq_purge(pq);
+          V(pq->lock);
+          return -1;
+        }
+
+      pentry->next = NULL;
+      pentry->len = total - sent;
+      pentry->off = 0;
+
+      /* Copy what was not sent */
+      for(i = 0, skip = sent, pos = pentry->data; i < iovcnt; i++)
+        {
+          if(skip >= iov[i].iov_len)
+            {
+              skip -= iov[i].iov_len;
+              continue;
+            }
+
+          memcpy(pos, (char *)iov[i].iov_base + skip, iov[i].iov_len - skip);
+          pos += iov[i].iov_len - skip;
+          skip = 0;
+        }
+
+      if(pq->tail != NULL)
+        pq->tail->next = pentry;
+      else
+        {
+          pq->head = pentry;
+          Svc_sendq_arm(fd, pq);
+        }
+      pq->tail = pentry;
+      pq->queued += pentry->len;
+    }
+
+  V(pq->lock);
+
+  return total;
+}                               /* Svc_sendq_writev */
+
+/**
+ * Svc_sendq_discard: drops the queue of a connection before its socket is closed.
+ *
+ * @param fd [IN] the socket
+ *
+ */
+void Svc_sendq_discard(int fd)
+{
+  svc_sendq_t *pq;
+
+  if(sendq == NULL || fd < 0 || fd >= nfs_param.core_param.nb_max_fd)
+    return;
+
+  pq = &sendq[fd];
+
+  P(pq->lock);
+
+  if(pq->registered)
+    epoll_ctl(sendq_epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+
+  Svc_sendq_purge(pq);
+  pq->registered = FALSE;
+  pq->died = FALSE;
+  pq->generation += 1;
+
+  V(pq->lock);
+}                               /* Svc_sendq_discard */
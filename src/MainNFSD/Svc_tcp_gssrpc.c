@@ -37,6 +37,12 @@
 
 #include "log_macros.h"
 int fridgethr_get( pthread_t * pthrid, void *(*thrfunc)(void*), void * thrarg ) ;
+int nfs_rpc_tcp_receiver_enabled(void);
+int nfs_rpc_tcp_receiver_add(int fd);
+int nfs_rpc_tcp_receiver_owns(int fd);
+int nfs_rpc_tcp_receiver_read(int fd, char *buf, int len);
+int Svc_sendq_active(void);
+void Svc_sendq_discard(int fd);
 
 /*
  * svc_tcp.c, Server side for TCP/IP based RPC. 
@@ -60,6 +66,10 @@ int fridgethr_get( pthread_t * pthrid, void *(*thrfunc)(void*), void * thrarg )
 #include <errno.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <sys/uio.h>
+
+ssize_t Svc_sendq_writev(int fd, struct iovec *iov, int iovcnt);
+
 /*extern bool_t abort();
 extern errno;
 */
@@ -305,9 +315,13 @@ static bool_t Rendezvous_request(register SVCXPRT * xprt, struct rpc_msg *msg)
 
   etat_xprt[xprt->xp_sock] = 0;
 
-  if((rc =
-      fridgethr_get(&sockmgr_thrid, rpc_tcp_socket_manager_thread,
-                     (void *)(xprt->xp_sock))) != 0)
+  /* Let the shared TCP receivers wait for the requests, or give the connection its own thread */
+  if(nfs_rpc_tcp_receiver_enabled())
+    rc = nfs_rpc_tcp_receiver_add(xprt->xp_sock);
+  else
+    rc = fridgethr_get(&sockmgr_thrid, rpc_tcp_socket_manager_thread,
+                       (void *)(xprt->xp_sock));
+  if(rc != 0)
     {
       return FALSE;
     }
@@ -326,6 +340,7 @@ static void Svctcp_destroy(register SVCXPRT * xprt)
   register struct tcp_conn *cd = (struct tcp_conn *)xprt->xp_p1;
 
   Xprt_unregister(xprt);
+  Svc_sendq_discard(xprt->xp_sock);
   (void)close(xprt->xp_sock);
   if(xprt->xp_port != 0)
     {
@@ -377,6 +392,15 @@ static int Readtcp(char *xprtptr, caddr_t buf, register int len)
 #else
 #define loopcond (readfds != mask)
 #endif
+
+  /* The records of a socket multiplexed by a TCP receiver are already received */
+  if(nfs_rpc_tcp_receiver_owns(sock))
+    {
+      if((len = nfs_rpc_tcp_receiver_read(sock, buf, len)) > 0)
+        return (len);
+      goto fatal_err;
+    }
+
   do
     {
       readfds = mask;
@@ -409,6 +433,21 @@ static int Writetcp(char *xprtptr, caddr_t buf, int len)
   register SVCXPRT *xprt = (SVCXPRT *) (void *)xprtptr;
   register int i, cnt;
 
+  /* Queue what the client does not accept at once, instead of waiting for it */
+  if(Svc_sendq_active())
+    {
+      struct iovec iov;
+
+      iov.iov_base = buf;
+      iov.iov_len = len;
+      if(Svc_sendq_writev(xprt->xp_sock, &iov, 1) < 0)
+        {
+          ((struct tcp_conn *)(xprt->xp_p1))->strm_stat = XPRT_DIED;
+          return (-1);
+        }
+      return (len);
+    }
+
   for(cnt = len; cnt > 0; cnt -= i, buf += i)
     {
       if((i = write(xprt->xp_sock, buf, (size_t) cnt)) < 0)
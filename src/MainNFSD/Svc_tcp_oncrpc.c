@@ -13,6 +13,7 @@ typedef unsigned int u_int32_t;
 
 #include   <sys/types.h>
 #include   <sys/poll.h>
+#include   <sys/uio.h>
 
 #include   <stdio.h>
 #include   <stdlib.h>
@@ -380,9 +381,13 @@ static bool_t Rendezvous_request(register SVCXPRT * xprt)
     return FALSE;
   etat_xprt[xprt->xp_fd] = 0;
 
-  if((rc =
-	fridgethr_get( &sockmgr_thrid, rpc_tcp_socket_manager_thread,
-                     (void *)((unsigned long)xprt->xp_fd))) != 0 )
+  /* Let the shared TCP receivers wait for the requests, or give the connection its own thread */
+  if(nfs_rpc_tcp_receiver_enabled())
+    rc = nfs_rpc_tcp_receiver_add(xprt->xp_fd);
+  else
+    rc = fridgethr_get( &sockmgr_thrid, rpc_tcp_socket_manager_thread,
+                        (void *)((unsigned long)xprt->xp_fd));
+  if(rc != 0)
     return FALSE;
 #else
   if(pthread_cond_init(&condvar_xprt[xprt->xp_sock], NULL) != 0)
@@ -392,9 +397,13 @@ static bool_t Rendezvous_request(register SVCXPRT * xprt)
     return FALSE;
   etat_xprt[xprt->xp_sock] = 0;
 
-  if((rc =
-	fridgethr_get( &sockmgr_thrid, rpc_tcp_socket_manager_thread,
-                     (void *)((unsigned long)xprt->xp_sock))) != 0 )
+  /* Let the shared TCP receivers wait for the requests, or give the connection its own thread */
+  if(nfs_rpc_tcp_receiver_enabled())
+    rc = nfs_rpc_tcp_receiver_add(xprt->xp_sock);
+  else
+    rc = fridgethr_get( &sockmgr_thrid, rpc_tcp_socket_manager_thread,
+                        (void *)((unsigned long)xprt->xp_sock));
+  if(rc != 0)
     return FALSE;
 
 #endif
@@ -413,8 +422,10 @@ static void Svctcp_destroy(register SVCXPRT * xprt)
 
   Xprt_unregister(xprt);
 #ifdef _FREEBSD
+  Svc_sendq_discard(xprt->xp_fd);
   (void)close(xprt->xp_fd);
 #else
+  Svc_sendq_discard(xprt->xp_sock);
   (void)close(xprt->xp_sock);
 #endif
 
@@ -454,6 +465,15 @@ int Readtcp(register SVCXPRT * xprt, caddr_t buf, register int len)
   struct pollfd pollfd;
 
   LogFullDebug(COMPONENT_DISPATCH, "Readtcp socket %d", sock);
+
+  /* The records of a socket multiplexed by a TCP receiver are already received */
+  if(nfs_rpc_tcp_receiver_owns(sock))
+    {
+      if((len = nfs_rpc_tcp_receiver_read(sock, buf, len)) > 0)
+        return (len);
+      goto fatal_err;
+    }
+
   do
     {
       pollfd.fd = sock;
@@ -511,6 +531,25 @@ int Writetcp(register SVCXPRT * xprt, caddr_t buf, int len)
   /* LogFullDebug(COMPONENT_DISPATCH, "Writetcp: xprt=%p len=%d", xprt, len ) ; */
   /* print_xdrrec_fbtbc( "WriteTcp", xprt ) ; */
 
+  /* Queue what the client does not accept at once, instead of waiting for it */
+  if(Svc_sendq_active())
+    {
+      struct iovec iov;
+
+      iov.iov_base = buf;
+      iov.iov_len = len;
+#ifdef _FREEBSD
+      if(Svc_sendq_writev(xprt->xp_fd, &iov, 1) < 0)
+#else
+      if(Svc_sendq_writev(xprt->xp_sock, &iov, 1) < 0)
+#endif
+        {
+          ((struct tcp_conn *)(xprt->xp_p1))->strm_stat = XPRT_DIED;
+          return (-1);
+        }
+      return (len);
+    }
+
   for(cnt = len; cnt > 0; cnt -= i, buf += i)
     {
 #ifdef _FREEBSD
@@ -575,10 +614,26 @@ static bool_t Svctcp_reply(SVCXPRT * xprt, register struct rpc_msg *msg)
   register XDR *xdrs = &(cd->xdrs);
   xdrproc_t xdr_proc;
   caddr_t xdr_where;
+  bool_t rstat;
+  bool_t died;
 
-  xdrs->x_op = XDR_ENCODE;
   msg->rm_xid = cd->x_id;
 
+  /* Send the bulk data in place instead of copying it into the xdrrec buffer */
+  if(Svc_gather_active(msg))
+    {
+#ifdef _FREEBSD
+      rstat = Svc_gather_reply(xprt->xp_fd, msg, &died);
+#else
+      rstat = Svc_gather_reply(xprt->xp_sock, msg, &died);
+#endif
+      if(died)
+        cd->strm_stat = XPRT_DIED;
+      return (rstat);
+    }
+
+  xdrs->x_op = XDR_ENCODE;
+
   if(msg->rm_reply.rp_stat == MSG_ACCEPTED && msg->rm_reply.rp_acpt.ar_stat == SUCCESS)
     {
       xdr_proc = msg->acpted_rply.ar_results.proc;
@@ -81,6 +81,10 @@ static void Svcudp_destroy(SVCXPRT *);
 
 void Xprt_register(SVCXPRT * xprt);
 void Xprt_unregister(SVCXPRT * xprt);
+ssize_t Svc_mmsg_sendto(int fd, void *buf, size_t len, struct sockaddr *addr,
+                        socklen_t addrlen);
+bool_t Svcudp_recv_buffered(SVCXPRT * xprt, struct rpc_msg *msg, size_t rlen,
+                            struct sockaddr *addr, socklen_t addrlen);
 
 static struct xp_ops Svcudp_op = {
   Svcudp_recv,
@@ -198,10 +202,7 @@ static bool_t Svcudp_recv(register SVCXPRT * xprt, struct rpc_msg *msg)
   struct msghdr dummy;
   struct iovec dummy_iov[1];
   register struct svcudp_data *su = su_data(xprt);
-  register XDR *xdrs = &(su->su_xdrs);
   register int rlen;
-  char *reply;
-  uint32_t replylen;
 
  again:
   memset((char *)&dummy, 0, sizeof(dummy));
@@ -225,8 +226,46 @@ static bool_t Svcudp_recv(register SVCXPRT * xprt, struct rpc_msg *msg)
                   0, (struct sockaddr *)&(xprt->xp_raddr), &(xprt->xp_addrlen));
   if(rlen == -1 && errno == EINTR)
     goto again;
-  if(rlen < (int)4 * sizeof(uint32_t))
+  if(rlen == -1)
     return (FALSE);
+
+  return Svcudp_recv_buffered(xprt, msg, rlen, NULL, 0);
+}
+
+/*
+ * Gives the buffer a datagram for this xprt is to be received in, when the
+ * datagrams are received in batch by the dispatcher.
+ */
+char *Svcudp_getbuf(SVCXPRT * xprt, u_int * psize)
+{
+  *psize = su_data(xprt)->su_iosz;
+  return rpc_buffer(xprt);
+}
+
+/*
+ * Decodes a datagram of rlen bytes, received in the buffer of xprt from addr,
+ * or from xp_raddr if addr is NULL.
+ */
+bool_t Svcudp_recv_buffered(SVCXPRT * xprt, struct rpc_msg *msg, size_t rlen,
+                            struct sockaddr *addr, socklen_t addrlen)
+{
+  register struct svcudp_data *su = su_data(xprt);
+  register XDR *xdrs = &(su->su_xdrs);
+
+  if(rlen < 4 * sizeof(uint32_t))
+    return (FALSE);
+
+  if(addr != NULL)
+    {
+      /* What the MSG_PEEK of Svcudp_recv would have given */
+      if(addrlen > sizeof(xprt->xp_raddr))
+        addrlen = sizeof(xprt->xp_raddr);
+      memcpy(&xprt->xp_raddr, addr, addrlen);
+      memcpy(&xprt->xp_laddr, addr, addrlen);
+      xprt->xp_addrlen = addrlen;
+      xprt->xp_laddrlen = addrlen;
+    }
+
   xdrs->x_op = XDR_DECODE;
   XDR_SETPOS(xdrs, 0);
   if(!xdr_callmsg(xdrs, msg))
@@ -266,8 +305,8 @@ static bool_t Svcudp_reply(register SVCXPRT * xprt, struct rpc_msg *msg)
      (!has_args || (SVCAUTH_WRAP(xprt->xp_auth, xdrs, xdr_results, xdr_location))))
     {
       slen = (int)XDR_GETPOS(xdrs);
-      if(sendto(xprt->xp_sock, rpc_buffer(xprt), slen, 0,
-                (struct sockaddr *)&(xprt->xp_raddr), xprt->xp_addrlen) == slen)
+      if(Svc_mmsg_sendto(xprt->xp_sock, rpc_buffer(xprt), slen,
+                         (struct sockaddr *)&(xprt->xp_raddr), xprt->xp_addrlen) == slen)
         {
           stat = TRUE;
         }
@@ -47,6 +47,10 @@ typedef unsigned int u_int32_t;
 
 void Xprt_register(SVCXPRT * xprt);
 void Xprt_unregister(SVCXPRT * xprt);
+ssize_t Svc_mmsg_sendto(int fd, void *buf, size_t len, struct sockaddr *addr,
+                        socklen_t addrlen);
+bool_t Svcudp_recv_buffered(SVCXPRT * xprt, struct rpc_msg *msg, size_t rlen,
+                            struct sockaddr *addr, socklen_t addrlen);
 bool_t svcauth_wrap_dummy(XDR * xdrs, xdrproc_t xdr_func, caddr_t xdr_ptr);
 
 #define SVCAUTH_WRAP(auth, xdrs, xfunc, xwhere) svcauth_wrap_dummy( xdrs, xfunc, xwhere)
@@ -209,7 +213,6 @@ static enum xprt_stat Svcudp_stat(SVCXPRT * xprt)
 static bool_t Svcudp_recv(register SVCXPRT * xprt, struct rpc_msg *msg)
 {
   register struct Svcudp_data *su = Su_data(xprt);
-  register XDR *xdrs = &(su->su_xdrs);
   register int rlen;
 
  again:
@@ -225,9 +228,43 @@ static bool_t Svcudp_recv(register SVCXPRT * xprt, struct rpc_msg *msg)
   if(rlen == -1 && errno == EINTR)
     goto again;
 
-  if(rlen == -1 || rlen < 4 * sizeof(u_int32_t))
+  if(rlen == -1)
     return (FALSE);
 
+  return Svcudp_recv_buffered(xprt, msg, rlen, NULL, 0);
+}
+
+/*
+ * Gives the buffer a datagram for this xprt is to be received in, when the
+ * datagrams are received in batch by the dispatcher.
+ */
+char *Svcudp_getbuf(SVCXPRT * xprt, u_int * psize)
+{
+  *psize = Su_data(xprt)->su_iosz;
+  return rpc_buffer(xprt);
+}
+
+/*
+ * Decodes a datagram of rlen bytes, received in the buffer of xprt from addr,
+ * or from xp_raddr if addr is NULL.
+ */
+bool_t Svcudp_recv_buffered(SVCXPRT * xprt, struct rpc_msg *msg, size_t rlen,
+                            struct sockaddr *addr, socklen_t addrlen)
+{
+  register struct Svcudp_data *su = Su_data(xprt);
+  register XDR *xdrs = &(su->su_xdrs);
+
+  if(rlen < 4 * sizeof(u_int32_t))
+    return (FALSE);
+
+  if(addr != NULL)
+    {
+      if(addrlen > sizeof(xprt->xp_raddr))
+        addrlen = sizeof(xprt->xp_raddr);
+      memcpy(&xprt->xp_raddr, addr, addrlen);
+      xprt->xp_addrlen = addrlen;
+    }
+
   xdrs->x_op = XDR_DECODE;
 
   XDR_SETPOS(xdrs, 0);
@@ -270,12 +307,12 @@ static bool_t Svcudp_reply(register SVCXPRT * xprt, struct rpc_msg *msg)
   slen = (int)XDR_GETPOS(xdrs);
 
 #ifdef _FREEBSD
-  if(sendto(xprt->xp_fd,
+  if(Svc_mmsg_sendto(xprt->xp_fd,
 #else
-  if(sendto(xprt->xp_sock,
+  if(Svc_mmsg_sendto(xprt->xp_sock,
 #endif
-            rpc_buffer(xprt),
-            slen, 0, (struct sockaddr *)&(xprt->xp_raddr), xprt->xp_addrlen) != slen)
+                     rpc_buffer(xprt),
+                     slen, (struct sockaddr *)&(xprt->xp_raddr), xprt->xp_addrlen) != slen)
     {
       return (FALSE);
     }
@@ -85,6 +85,15 @@ extern fd_set Svc_fdset;
 extern void Xprt_register(SVCXPRT *);
 extern void Xprt_unregister(SVCXPRT *);
 extern void *rpc_tcp_socket_manager_thread(void *Arg);
+extern bool_t Svc_gather_active(struct rpc_msg *msg);
+extern bool_t Svc_gather_reply(int fd, struct rpc_msg *msg, bool_t * pdied);
+extern bool_t nfs_rpc_tcp_receiver_enabled(void);
+extern int nfs_rpc_tcp_receiver_add(int fd);
+extern bool_t nfs_rpc_tcp_receiver_owns(int fd);
+extern int nfs_rpc_tcp_receiver_read(int fd, char *buf, int len);
+extern bool_t Svc_sendq_active(void);
+extern ssize_t Svc_sendq_writev(int fd, struct iovec *iov, int iovcnt);
+extern void Svc_sendq_discard(int fd);
 
 static SVCXPRT *Makefd_xprt(int, u_int, u_int);
 static bool_t Rendezvous_request(SVCXPRT *, struct rpc_msg *);
@@ -442,9 +451,13 @@ struct rpc_msg *msg;
 
   etat_xprt[newxprt->xp_fd] = 0;
 
-  if((rc =
-      fridgethr_get(&sockmgr_thrid, rpc_tcp_socket_manager_thread,
-                     (void *)(newxprt->xp_fd))) != 0)
+  /* Let the shared TCP receivers wait for the requests, or give the connection its own thread */
+  if(nfs_rpc_tcp_receiver_enabled())
+    rc = nfs_rpc_tcp_receiver_add(newxprt->xp_fd);
+  else
+    rc = fridgethr_get(&sockmgr_thrid, rpc_tcp_socket_manager_thread,
+                       (void *)(newxprt->xp_fd));
+  if(rc != 0)
     return FALSE;
 
   return (FALSE);               /* there is never an rpc msg to be processed */
@@ -475,7 +488,10 @@ SVCXPRT *xprt;
   cd = (struct cf_conn *)xprt->xp_p1;
 
   if(xprt->xp_fd != RPC_ANYFD)
-    (void)close(xprt->xp_fd);
+    {
+      Svc_sendq_discard(xprt->xp_fd);
+      (void)close(xprt->xp_fd);
+    }
   if(xprt->xp_port != 0)
     {
       /* a rendezvouser socket */
@@ -557,6 +573,17 @@ int len;
 
   cfp = (struct cf_conn *)xprt->xp_p1;
 
+  /* The records of a socket multiplexed by a TCP receiver are already received */
+  if(nfs_rpc_tcp_receiver_owns(sock))
+    {
+      if((len = nfs_rpc_tcp_receiver_read(sock, buf, len)) > 0)
+        {
+          gettimeofday(&cfp->last_recv_time, NULL);
+          return (len);
+        }
+      goto fatal_err;
+    }
+
   if(cfp->nonblock)
     {
       len = read(sock, buf, (size_t) len);
@@ -621,6 +648,21 @@ int len;
 
   cd = (struct cf_conn *)xprt->xp_p1;
 
+  /* Queue what the client does not accept at once, instead of waiting for it */
+  if(Svc_sendq_active())
+    {
+      struct iovec iov;
+
+      iov.iov_base = buf;
+      iov.iov_len = len;
+      if(Svc_sendq_writev(xprt->xp_fd, &iov, 1) < 0)
+        {
+          cd->strm_stat = XPRT_DIED;
+          return (-1);
+        }
+      return (len);
+    }
+
   if(cd->nonblock)
     gettimeofday(&tv0, NULL);
 
@@ -736,6 +778,7 @@ struct rpc_msg *msg;
   struct cf_conn *cd;
   XDR *xdrs;
   bool_t rstat;
+  bool_t died;
 
   assert(xprt != NULL);
   assert(msg != NULL);
@@ -743,8 +786,18 @@ struct rpc_msg *msg;
   cd = (struct cf_conn *)(xprt->xp_p1);
   xdrs = &(cd->xdrs);
 
-  xdrs->x_op = XDR_ENCODE;
   msg->rm_xid = cd->x_id;
+
+  /* Send the bulk data in place instead of copying it into the xdrrec buffer */
+  if(Svc_gather_active(msg))
+    {
+      rstat = Svc_gather_reply(xprt->xp_fd, msg, &died);
+      if(died)
+        cd->strm_stat = XPRT_DIED;
+      return (rstat);
+    }
+
+  xdrs->x_op = XDR_ENCODE;
   rstat = xdr_replymsg(xdrs, msg);
   (void)xdrrec_endofrecord(xdrs, TRUE);
   return (rstat);
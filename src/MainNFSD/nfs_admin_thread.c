@@ -47,6 +47,7 @@
 #include <string.h>
 #include <pthread.h>
 #include "nfs_core.h"
+#include "nfs_proto_functions.h"
 #include "stuff_alloc.h"
 #include "log_macros.h"
 
@@ -112,8 +113,10 @@ static int pause_workers_for_export_reload()
   while(1)
     {
       all_blocked = 1;
+      /* A worker not started yet will block as soon as it is */
       for(i = 0; i < nfs_param.core_param.nb_worker; i++)
-	if (pmydata->workers_data[i].waiting_for_exports == FALSE)
+	if (pmydata->workers_data[i].waiting_for_exports == FALSE
+	    && nfs_worker_pool_started(i))
 	  all_blocked = 0;
       if (all_blocked)
 	break;
@@ -211,6 +214,15 @@ int rebuild_export_list(char *config_file)
   /* We no longer need the head that was created for
    * the new list since the export list is built as a linked list. */
   Mem_Free(temp_pexportlist);
+
+  /* The pseudo fs junctions point to the old export entries: swap in a tree built
+   * from the new list before the workers are woken up. */
+  if(nfs4_ExportToPseudoFS(nfs_param.pexportlist) != 0)
+    {
+      LogCrit(COMPONENT_MAIN, "rebuild_export_list: CRITICAL ERROR while rebuilding the NFSv4 pseudo file system.");
+      status = 0;
+    }
+
   wake_workers_for_export_reload();
   return status; /* 1 if success */
 }
@@ -255,6 +255,9 @@ int nfs_print_param_config(nfs_parameter_t * p_nfs_param)
   printf("\tNFS_Program = %u ;\n", p_nfs_param->core_param.nfs_program);
   printf("\tMNT_Program = %u ;\n", p_nfs_param->core_param.mnt_program);
   printf("\tNb_Worker = %u ; \n", p_nfs_param->core_param.nb_worker);
+  printf("\tNb_Min_Worker = %u ; \n", p_nfs_param->core_param.nb_min_worker);
+  printf("\tWorker_Target_Wait = %u ; \n", p_nfs_param->core_param.worker_target_wait);
+  printf("\tWorker_Idle_Delay = %u ; \n", p_nfs_param->core_param.worker_idle_delay);
   printf("\tb_Call_Before_Queue_Avg = %u ; \n", p_nfs_param->core_param.nb_call_before_queue_avg);
   printf("\tNb_MaxConcurrentGC = %u ; \n", p_nfs_param->core_param.nb_max_concurrent_gc);
   printf("\tDupReq_Expiration = %lu ; \n", p_nfs_param->core_param.expiration_dupreq);
@@ -263,6 +266,10 @@ int nfs_print_param_config(nfs_parameter_t * p_nfs_param)
   printf("\tStats_File_Path = %s ; \n", p_nfs_param->core_param.stats_file_path);
   printf("\tStats_Update_Delay = %d ; \n", p_nfs_param->core_param.stats_update_delay);
   printf("\tTCP_Fridge_Expiration_Delay = %d ; \n", p_nfs_param->core_param.tcp_fridge_expiration_delay);
+  printf("\tNb_TCP_Receivers = %u ; \n", p_nfs_param->core_param.nb_tcp_receivers);
+  printf("\tTCP_Send_Queue_Size = %lu ; \n",
+         (unsigned long)p_nfs_param->core_param.tcp_send_queue_size);
+  printf("\tUDP_Batch_Size = %u ; \n", p_nfs_param->core_param.udp_batch_size);
   printf("\tStats_Per_Client_Directory = %s ; \n",
          p_nfs_param->core_param.stats_per_client_directory);
 
@@ -280,6 +287,11 @@ int nfs_print_param_config(nfs_parameter_t * p_nfs_param)
     printf("\tDrop_Inval_Errors = TRUE ; \n");
   else
     printf("\tDrop_Inval_Errors = FALSE ;\n");
+
+  if(p_nfs_param->core_param.zero_copy_read)
+    printf("\tZero_Copy_Read = TRUE ; \n");
+  else
+    printf("\tZero_Copy_Read = FALSE ;\n");
   printf("}\n\n");
 
   printf("NFS_Worker_Param\n{\n");
@@ -298,6 +310,9 @@ int nfs_set_param_default(nfs_parameter_t * p_nfs_param)
 
   /* Core parameters */
   p_nfs_param->core_param.nb_worker = NB_WORKER_THREAD_DEFAULT;
+  p_nfs_param->core_param.nb_min_worker = NB_MIN_WORKER_THREAD_DEFAULT;
+  p_nfs_param->core_param.worker_target_wait = WORKER_TARGET_WAIT_DEFAULT;
+  p_nfs_param->core_param.worker_idle_delay = WORKER_IDLE_DELAY_DEFAULT;
   p_nfs_param->core_param.nb_call_before_queue_avg = NB_REQUEST_BEFORE_QUEUE_AVG;
   p_nfs_param->core_param.nb_max_concurrent_gc = NB_MAX_CONCURRENT_GC;
   p_nfs_param->core_param.expiration_dupreq = DUPREQ_EXPIRATION;
@@ -317,6 +332,10 @@ int nfs_set_param_default(nfs_parameter_t * p_nfs_param)
   p_nfs_param->core_param.nb_max_fd = -1;       /* Use OS's default */
   p_nfs_param->core_param.stats_update_delay = 60;
   p_nfs_param->core_param.tcp_fridge_expiration_delay = -1;
+  p_nfs_param->core_param.nb_tcp_receivers = 4;
+  p_nfs_param->core_param.tcp_send_queue_size = 16 * 1024 * 1024;
+  p_nfs_param->core_param.udp_batch_size = 16;
+  p_nfs_param->core_param.zero_copy_read = TRUE;
 /* only NFSv4 is supported for the FSAL_PROXY */
 #if ! defined( _USE_PROXY ) || defined ( _HANDLE_MAPPING )
   p_nfs_param->core_param.core_options = CORE_OPTION_NFSV3 | CORE_OPTION_NFSV4;
@@ -600,9 +619,12 @@ int nfs_set_param_default(nfs_parameter_t * p_nfs_param)
   p_nfs_param->cache_layers_param.cache_inode_client_param.attrmask =
       FSAL_ATTR_MASK_V2_V3;
   p_nfs_param->cache_layers_param.cache_inode_client_param.max_fd_per_thread = 20;
+  p_nfs_param->cache_layers_param.cache_inode_client_param.max_open_fd = 0;
   p_nfs_param->cache_layers_param.cache_inode_client_param.use_cache = 0;
   p_nfs_param->cache_layers_param.cache_inode_client_param.use_fsal_hash = 1;
   p_nfs_param->cache_layers_param.cache_inode_client_param.retention = 60;
+  p_nfs_param->cache_layers_param.cache_inode_client_param.nb_attr_prefetch_threads = 4;
+  p_nfs_param->cache_layers_param.cache_inode_client_param.nb_neg_dirent = 8;
 
   /* Data cache client parameters */
   p_nfs_param->cache_layers_param.cache_content_client_param.nb_prealloc_entry = 128;
@@ -610,6 +632,10 @@ int nfs_set_param_default(nfs_parameter_t * p_nfs_param)
   p_nfs_param->cache_layers_param.cache_content_client_param.max_fd_per_thread = 20;
   p_nfs_param->cache_layers_param.cache_content_client_param.use_cache = 0;
   p_nfs_param->cache_layers_param.cache_content_client_param.retention = 60;
+  p_nfs_param->cache_layers_param.cache_content_client_param.block_cache_size = 0;   /* No block cache */
+  p_nfs_param->cache_layers_param.cache_content_client_param.block_size =
+      CACHE_CONTENT_BLOCK_DEFAULT_SIZE;
+  p_nfs_param->cache_layers_param.cache_content_client_param.nb_recovery_threads = 4;
 
   strcpy(p_nfs_param->cache_layers_param.cache_content_client_param.cache_dir,
          "/tmp/ganesha.datacache");
@@ -725,6 +751,10 @@ int nfs_set_param_from_conf(nfs_parameter_t * p_nfs_param,
 
   /* Do not use a too big page size for TCP connection manager */
   p_nfs_param->buddy_param_tcp_mgr.memory_area_size = 1048576LL ;
+  p_nfs_param->buddy_param_tcp_mgr.use_hugepages = FALSE;
+
+  /* The allocation profiler is shared by all the threads */
+  BuddySetProfileRate(p_nfs_param->buddy_param_worker.profile_sample_rate);
 
 #endif
 
@@ -1257,6 +1287,8 @@ void nfs_reset_stats(void)
       workers_data[i].cache_inode_client.stat.nb_gc_lru_active = 0;
       workers_data[i].cache_inode_client.stat.nb_gc_lru_total = 0;
       workers_data[i].cache_inode_client.stat.nb_call_total = 0;
+      workers_data[i].cache_inode_client.stat.nb_neg_hit = 0;
+      workers_data[i].cache_inode_client.stat.nb_neg_set = 0;
 
       for(j = 0; j < CACHE_INODE_NB_COMMAND; j++)
         {
@@ -1371,18 +1403,29 @@ static void nfs_Start_threads(nfs_parameter_t * pnfs_param)
      exit( 1 ) ;
    }
 
-  /* Starting all of the worker thread */
-  for(i = 0; i < pnfs_param->core_param.nb_worker; i++)
+  /* Starting the first worker threads, the others are started when the load needs them */
+  if(nfs_worker_pool_init(pnfs_param->core_param.nb_min_worker,
+                          pnfs_param->core_param.nb_worker) != 0)
     {
-      if((rc =
-          pthread_create(&(worker_thrid[i]), &attr_thr, worker_thread, (void *)i)) != 0)
-        {
-          LogError(COMPONENT_INIT, ERR_SYS, ERR_PTHREAD_CREATE, rc);
-          exit(1);
-        }
+      LogCrit(COMPONENT_INIT, "Worker threads could not be started... exiting");
+      exit(1);
+    }
+  LogEvent(COMPONENT_INIT, "%u worker threads were started successfully",
+	   nfs_worker_pool_size());
+
+  /* Starting the receivers of the TCP connections, before any is accepted */
+  if(nfs_rpc_tcp_receiver_init(pnfs_param->core_param.nb_tcp_receivers) != 0)
+    {
+      LogCrit(COMPONENT_INIT, "TCP receivers could not be started... exiting");
+      exit(1);
+    }
+
+  /* Starting the thread that sends the queued TCP replies */
+  if(Svc_sendq_init(pnfs_param->core_param.tcp_send_queue_size) != 0)
+    {
+      LogCrit(COMPONENT_INIT, "TCP sender could not be started... exiting");
+      exit(1);
     }
-  LogEvent(COMPONENT_INIT, "%d worker threads were started successfully",
-	   pnfs_param->core_param.nb_worker);
 
   /* Starting the rpc dispatcher thread */
   if((rc =
@@ -1502,6 +1545,13 @@ static void nfs_Init(const nfs_start_info_t * p_start_info)
   /* Set the cache content GC policy */
   cache_content_set_gc_policy(nfs_param.cache_layers_param.dcgcpol);
 
+  /* Data cache by blocks in memory, if configured */
+  if(cache_content_block_init(nfs_param.cache_layers_param.cache_content_client_param) != 0)
+    {
+      LogMajor(COMPONENT_INIT, "NFS_INIT: Block cache could not be initialized");
+      exit(1);
+    }
+
   /* If only 'basic' init for having FSAL anc Cache Inode is required, stop init now */
   if(p_start_info->flush_datacache_mode)
     {
@@ -1512,6 +1562,21 @@ static void nfs_Init(const nfs_start_info_t * p_start_info)
   cache_inode_async_init(nfs_param.cache_layers_param.cache_inode_client_param);
 #endif
 
+  /* Set up the fds kept open by the workers */
+  if(cache_inode_fd_cache_init(nfs_param.cache_layers_param.cache_inode_client_param,
+                               nfs_param.core_param.nb_worker) != 0)
+    {
+      LogMajor(COMPONENT_INIT, "NFS_INIT: FSAL file descriptors cache could not be initialized");
+      exit(1);
+    }
+
+  /* Start the threads renewing attributes for READDIRPLUS and NFSv4 READDIR */
+  if(cache_inode_prefetch_init(nfs_param.cache_layers_param.cache_inode_client_param) != 0)
+    {
+      LogMajor(COMPONENT_INIT, "NFS_INIT: Attribute prefetch threads could not be started");
+      exit(1);
+    }
+
   /* If rpcsec_gss is used, set the path to the keytab */
 #ifdef HAVE_KRB5
 #ifdef _HAVE_GSSAPI
@@ -1640,11 +1705,14 @@ static void nfs_Init(const nfs_start_info_t * p_start_info)
         }
       workers_data[i].ht_ip_stats = ht_ip_stats[i];
 
+      /* Heavy hitters sketch of the worker */
+      nfs_hh_init(&workers_data[i].hh_sketch);
+
       /* Allocation of the nfs request pool */
-      MakePool(&workers_data[i].request_pool,
-               nfs_param.worker_param.nb_pending_prealloc,
-               nfs_request_data_t,
-               constructor_nfs_request_data_t, NULL);
+      MakeSharedPool(&workers_data[i].request_pool,
+                     nfs_param.worker_param.nb_pending_prealloc,
+                     nfs_request_data_t,
+                     constructor_nfs_request_data_t, NULL);
       NamePool(&workers_data[i].request_pool, "Request Data Pool %d", i);
                
       if(!IsPoolPreallocated(&workers_data[i].request_pool))
@@ -1655,9 +1723,9 @@ static void nfs_Init(const nfs_start_info_t * p_start_info)
         }
 
       /* Allocation of the nfs dupreq pool */
-      MakePool(&workers_data[i].dupreq_pool,
-               nfs_param.worker_param.nb_dupreq_prealloc,
-               dupreq_entry_t, NULL, NULL);
+      MakeSharedPool(&workers_data[i].dupreq_pool,
+                     nfs_param.worker_param.nb_dupreq_prealloc,
+                     dupreq_entry_t, NULL, NULL);
       NamePool(&workers_data[i].dupreq_pool, "Duplicate Request Pool %d", i);
 
       if(!IsPoolPreallocated(&workers_data[i].dupreq_pool))
@@ -1668,9 +1736,9 @@ static void nfs_Init(const nfs_start_info_t * p_start_info)
         }
 
       /* Allocation of the IP/name pool */
-      MakePool(&workers_data[i].ip_stats_pool,
-               nfs_param.worker_param.nb_ip_stats_prealloc,
-               nfs_ip_stats_t, NULL, NULL);
+      MakeSharedPool(&workers_data[i].ip_stats_pool,
+                     nfs_param.worker_param.nb_ip_stats_prealloc,
+                     nfs_ip_stats_t, NULL, NULL);
       NamePool(&workers_data[i].ip_stats_pool, "IP Stats Cache Pool %d", i);
 
       if(!IsPoolPreallocated(&workers_data[i].ip_stats_pool))
@@ -1681,9 +1749,9 @@ static void nfs_Init(const nfs_start_info_t * p_start_info)
         }
 
       /* Initialize, but do not pre-alloc client-id pool */
-      InitPool(&workers_data[i].clientid_pool,
-               nfs_param.worker_param.nb_client_id_prealloc,
-               nfs_client_id_t, NULL, NULL);
+      InitSharedPool(&workers_data[i].clientid_pool,
+                     nfs_param.worker_param.nb_client_id_prealloc,
+                     nfs_client_id_t, NULL, NULL);
       NamePool(&workers_data[i].clientid_pool, "Client ID Pool %d", i);
 
       LogDebug(COMPONENT_INIT, "NFS_INIT: worker data #%d successfully initialized", i);
@@ -2025,6 +2093,20 @@ int nfs_start(nfs_parameter_t * p_nfs_param, nfs_start_info_t * p_start_info)
   else
     LogEvent(COMPONENT_INIT, "File Content Cache directory initialized");
 
+  /* Find what is in the datacache, the entries are recovered when they are used.
+   * The emergency flush walks the datacache itself. */
+  if(!p_start_info->flush_datacache_mode &&
+     cache_content_manifest_init(nfs_param.pexportlist,
+                                 nfs_param.cache_layers_param.
+                                 cache_content_client_param.cache_dir,
+                                 nfs_param.cache_layers_param.
+                                 cache_content_client_param.nb_recovery_threads,
+                                 &content_status) != CACHE_CONTENT_SUCCESS)
+    {
+      LogCrit(COMPONENT_INIT, "File Content Cache manifest could not be loaded, exiting...");
+      exit(1);
+    }
+
   /* Print the worker parameters in log */
   Print_param_worker_in_log(&(nfs_param.worker_param));
 
@@ -1638,6 +1638,30 @@ int nfs_Init_svc()
 
 #endif                          /* _NO_PORTMAPPER */
 
+  /* Receive and send the datagrams in batches */
+  if(nfs_param.core_param.udp_batch_size > 1)
+    {
+      nfs_svc_data_t *psvc = &nfs_param.worker_param.nfs_svc_data;
+      int rc_mmsg = 0;
+
+      rc_mmsg |= Svc_mmsg_init(psvc->socket_nfs_udp, nfs_param.core_param.udp_batch_size);
+      rc_mmsg |= Svc_mmsg_init(psvc->socket_mnt_udp, nfs_param.core_param.udp_batch_size);
+#ifdef _USE_NLM
+      rc_mmsg |= Svc_mmsg_init(psvc->socket_nlm_udp, nfs_param.core_param.udp_batch_size);
+#endif                          /* _USE_NLM */
+#ifdef _USE_QUOTA
+      rc_mmsg |= Svc_mmsg_init(psvc->socket_rquota_udp, nfs_param.core_param.udp_batch_size);
+#endif                          /* _USE_QUOTA */
+
+      if(rc_mmsg != 0)
+        LogCrit(COMPONENT_DISPATCH,
+                "NFS_DISPATCHER: UDP replies could not be batched on every socket");
+      else
+        LogEvent(COMPONENT_DISPATCH,
+                 "NFS_DISPATCHER: UDP datagrams are received and sent by batches of %u",
+                 Svc_mmsg_batch_size());
+    }
+
 #if _USE_TIRPC
   freenetconfigent(netconfig_udpv4);
   freenetconfigent(netconfig_tcpv4);
@@ -1667,6 +1691,7 @@ static unsigned int select_worker_queue()
   unsigned int i;
   static unsigned int last;
   unsigned int cpt = 0;
+  unsigned int nb_workers = nfs_worker_pool_size();     /* the parked workers are left out */
 
   P(lock_worker_selection);
   counter++;
@@ -1674,20 +1699,20 @@ static unsigned int select_worker_queue()
   /* Calculate the average queue length if counter is bigger than configured value. */
   if(counter > nfs_param.core_param.nb_call_before_queue_avg)
     {
-      for(i = 0; i < nfs_param.core_param.nb_worker; i++)
+      for(i = 0; i < nb_workers; i++)
         {
           total_number_pending += workers_data[i].pending_request->nb_entry;
         }
-      avg_number_pending = total_number_pending / nfs_param.core_param.nb_worker;
+      avg_number_pending = total_number_pending / nb_workers;
       /* Reset counter. */
       counter = 0;
     }
   V(lock_worker_selection);
 
   /* Choose the queue whose length is smaller than average. */
-      for(i = (last + 1) % nfs_param.core_param.nb_worker, cpt = 0;
-          cpt < nfs_param.core_param.nb_worker;
-          cpt++, i = (i + 1) % nfs_param.core_param.nb_worker)
+      for(i = (last + 1) % nb_workers, cpt = 0;
+          cpt < nb_workers;
+          cpt++, i = (i + 1) % nb_workers)
         {
       /* Choose only fully initialized workers and that does not gc. */
           if((workers_data[i].gc_in_progress == FALSE)
@@ -1707,7 +1732,7 @@ static unsigned int select_worker_queue()
         }
 
   if(worker_index == NO_VALUE_CHOOSEN)
-    worker_index = (last + 1) % nfs_param.core_param.nb_worker;
+    worker_index = (last + 1) % nb_workers;
 
   last = worker_index;
 
@@ -1741,6 +1766,208 @@ int nfs_rpc_get_worker_index(int mount_protocol_flag)
   return worker_index;
 }                               /* nfs_rpc_get_worker_index */
 
+/* Max number of datagrams received at once on a UDP socket */
+#define NFS_RPC_UDP_BATCH_MAX 64
+
+#ifdef _USE_TIRPC
+#define Svc_udp_getbuf( xprt, psize ) Svc_dg_getbuf( xprt, psize )
+#define Svc_udp_recv_buffered( xprt, msg, rlen, addr, addrlen ) \
+  Svc_dg_recv_buffered( xprt, msg, rlen, addr, addrlen )
+#else
+#define Svc_udp_getbuf( xprt, psize ) Svcudp_getbuf( xprt, psize )
+#define Svc_udp_recv_buffered( xprt, msg, rlen, addr, addrlen ) \
+  Svcudp_recv_buffered( xprt, msg, rlen, addr, addrlen )
+#endif
+
+/**
+ *
+ * nfs_rpc_udp_xprt: Returns the UDP xprt of a request for a socket.
+ *
+ * @param pnfsreq [IN] the request
+ * @param fd      [IN] the socket
+ *
+ * @return the xprt, NULL if fd is not one of the UDP sockets.
+ *
+ */
+static SVCXPRT *nfs_rpc_udp_xprt(nfs_request_data_t * pnfsreq, int fd)
+{
+  if(nfs_param.worker_param.nfs_svc_data.socket_nfs_udp == fd)
+    return pnfsreq->nfs_udp_xprt;
+  if(nfs_param.worker_param.nfs_svc_data.socket_mnt_udp == fd)
+    return pnfsreq->mnt_udp_xprt;
+#ifdef _USE_NLM
+  if(nfs_param.worker_param.nfs_svc_data.socket_nlm_udp == fd)
+    return pnfsreq->nlm_udp_xprt;
+#endif                          /* _USE_NLM */
+#ifdef _USE_QUOTA
+  if(nfs_param.worker_param.nfs_svc_data.socket_rquota_udp == fd)
+    return pnfsreq->rquota_udp_xprt;
+#endif                          /* _USE_QUOTA */
+  return NULL;
+}                               /* nfs_rpc_udp_xprt */
+
+/* Tells if fd is one of the UDP sockets */
+static bool_t nfs_rpc_is_udp_socket(int fd)
+{
+  nfs_svc_data_t *psvc = &nfs_param.worker_param.nfs_svc_data;
+
+  if(fd == psvc->socket_nfs_udp || fd == psvc->socket_mnt_udp)
+    return TRUE;
+#ifdef _USE_NLM
+  if(fd == psvc->socket_nlm_udp)
+    return TRUE;
+#endif                          /* _USE_NLM */
+#ifdef _USE_QUOTA
+  if(fd == psvc->socket_rquota_udp)
+    return TRUE;
+#endif                          /* _USE_QUOTA */
+  return FALSE;
+}                               /* nfs_rpc_is_udp_socket */
+
+/**
+ *
+ * nfs_rpc_enqueue_request: Queues a received request to a worker, and wakes it up.
+ *
+ * @param worker_index [IN] the worker whose pool the request comes from
+ * @param pnfsreq      [IN] the request
+ *
+ * @return nothing (void function), exits if the request cannot be queued.
+ *
+ */
+static void nfs_rpc_enqueue_request(int worker_index, nfs_request_data_t * pnfsreq)
+{
+  LRU_entry_t *pentry = NULL;
+  LRU_status_t status;
+
+  LogFullDebug(COMPONENT_DISPATCH, "Awaking thread #%d", worker_index);
+
+  gettimeofday(&pnfsreq->time_queued, NULL);
+
+  P(workers_data[worker_index].mutex_req_condvar);
+  P(workers_data[worker_index].request_pool_mutex);
+
+  if((pentry =
+      LRU_new_entry(workers_data[worker_index].pending_request, &status)) == NULL)
+    {
+      V(workers_data[worker_index].mutex_req_condvar);
+      V(workers_data[worker_index].request_pool_mutex);
+      LogMajor(COMPONENT_DISPATCH,
+               "Error while inserting pending request to Thread #%d... exiting",
+               worker_index);
+      exit(1);
+    }
+  pentry->buffdata.pdata = (caddr_t) pnfsreq;
+  pentry->buffdata.len = sizeof(*pnfsreq);
+
+  if(pthread_cond_signal(&(workers_data[worker_index].req_condvar)) == -1)
+    {
+      V(workers_data[worker_index].mutex_req_condvar);
+      V(workers_data[worker_index].request_pool_mutex);
+      LogCrit(COMPONENT_DISPATCH, "NFS DISPATCH: Cond signal failed for thr#%d , errno = %d",
+              worker_index, errno);
+      exit(1);
+    }
+  V(workers_data[worker_index].mutex_req_condvar);
+  V(workers_data[worker_index].request_pool_mutex);
+}                               /* nfs_rpc_enqueue_request */
+
+/**
+ *
+ * nfs_rpc_getreq_udp: Receives the datagrams waiting on a UDP socket in one go.
+ *
+ * A request is taken for each datagram that may be received, from the pool of
+ * the worker that will process it, and the datagrams are received straight
+ * in the buffers of the requests' xprts. The requests that got no datagram go
+ * back to their pool.
+ *
+ * @param fd         [IN] the UDP socket
+ * @param mount_flag [IN] TRUE if this is the MOUNT socket
+ *
+ * @return nothing (void function)
+ *
+ */
+static void nfs_rpc_getreq_udp(int fd, int mount_flag)
+{
+  nfs_request_data_t *reqs[NFS_RPC_UDP_BATCH_MAX];
+  int workers[NFS_RPC_UDP_BATCH_MAX];
+  struct iovec iov[NFS_RPC_UDP_BATCH_MAX];
+  struct sockaddr_storage addrs[NFS_RPC_UDP_BATCH_MAX];
+  socklen_t addrlen[NFS_RPC_UDP_BATCH_MAX];
+  size_t len[NFS_RPC_UDP_BATCH_MAX];
+  nfs_request_data_t *pnfsreq;
+  char *cred_area;
+  u_int size;
+  unsigned int nb;
+  unsigned int i;
+  int rc;
+
+  nb = Svc_mmsg_batch_size();
+  if(nb > NFS_RPC_UDP_BATCH_MAX)
+    nb = NFS_RPC_UDP_BATCH_MAX;
+
+  for(i = 0; i < nb; i++)
+    {
+      if((workers[i] = nfs_rpc_get_worker_index(mount_flag)) < 0)
+        {
+          LogCrit(COMPONENT_DISPATCH, "CRITICAL ERROR: Couldn't choose a worker ! Exiting...");
+          exit(1);
+        }
+
+      P(workers_data[workers[i]].request_pool_mutex);
+
+      GetFromPool(pnfsreq, &workers_data[workers[i]].request_pool, nfs_request_data_t);
+
+      V(workers_data[workers[i]].request_pool_mutex);
+
+      if(pnfsreq == NULL)
+        {
+          LogCrit(COMPONENT_DISPATCH,
+                  "CRITICAL ERROR: empty request pool for the chosen worker ! Exiting...");
+          exit(0);
+        }
+
+      cred_area = pnfsreq->cred_area;
+      pnfsreq->msg.rm_call.cb_cred.oa_base = cred_area;
+      pnfsreq->msg.rm_call.cb_verf.oa_base = &(cred_area[MAX_AUTH_BYTES]);
+      pnfsreq->req.rq_clntcred = &(cred_area[2 * MAX_AUTH_BYTES]);
+
+      pnfsreq->xprt = nfs_rpc_udp_xprt(pnfsreq, fd);
+      pnfsreq->ipproto = IPPROTO_UDP;
+
+      iov[i].iov_base = Svc_udp_getbuf(pnfsreq->xprt, &size);
+      iov[i].iov_len = size;
+
+      reqs[i] = pnfsreq;
+    }
+
+  rc = Svc_mmsg_recv(fd, iov, addrs, addrlen, len, nb);
+
+  LogFullDebug(COMPONENT_DISPATCH, "%d datagrams received on UDP socket %d", rc, fd);
+
+  for(i = 0; i < nb; i++)
+    {
+      pnfsreq = reqs[i];
+
+      if(rc > 0 && i < (unsigned int)rc)
+        pnfsreq->status = Svc_udp_recv_buffered(pnfsreq->xprt, &(pnfsreq->msg), len[i],
+                                                (struct sockaddr *)&addrs[i], addrlen[i]);
+      else
+        pnfsreq->status = FALSE;
+
+      if(pnfsreq->status)
+        {
+          nfs_rpc_enqueue_request(workers[i], pnfsreq);
+        }
+      else
+        {
+          /* No datagram, or not a valid RPC call: the request goes back unused */
+          P(workers_data[workers[i]].request_pool_mutex);
+          ReleaseToPool(pnfsreq, &workers_data[workers[i]].request_pool);
+          V(workers_data[workers[i]].request_pool_mutex);
+        }
+    }
+}                               /* nfs_rpc_getreq_udp */
+
 /**
  * nfs_rpc_getreq: Do half of the work done by svc_getreqset.
  *
@@ -1766,8 +1993,6 @@ void nfs_rpc_getreq(fd_set * readfds, nfs_parameter_t * pnfs_para)
   struct sockaddr_in *pdead_caller = NULL;
   char dead_caller[MAXNAMLEN];
 
-  LRU_entry_t *pentry = NULL;
-  LRU_status_t status;
   nfs_request_data_t *pnfsreq = NULL;
   int worker_index;
   int mount_flag = FALSE;
@@ -1796,6 +2021,13 @@ void nfs_rpc_getreq(fd_set * readfds, nfs_parameter_t * pnfs_para)
           else
             mount_flag = FALSE;
 
+          /* The datagrams waiting on a UDP socket are received all together */
+          if(Svc_mmsg_batch_size() > 1 && nfs_rpc_is_udp_socket(sock + bit - 1))
+            {
+              nfs_rpc_getreq_udp(sock + bit - 1, mount_flag);
+              continue;
+            }
+
           /* Get a worker to do the job */
           if((worker_index = nfs_rpc_get_worker_index(mount_flag)) < 0)
             {
@@ -2006,35 +2238,7 @@ void nfs_rpc_getreq(fd_set * readfds, nfs_parameter_t * pnfs_para)
           else
             {
               /* This should be used for UDP requests only, TCP request have dedicted management threads */
-              LogFullDebug(COMPONENT_DISPATCH, "Awaking thread #%d", worker_index);
-
-              P(workers_data[worker_index].mutex_req_condvar);
-              P(workers_data[worker_index].request_pool_mutex);
-
-              if((pentry =
-                  LRU_new_entry(workers_data[worker_index].pending_request,
-                                &status)) == NULL)
-                {
-                  V(workers_data[worker_index].mutex_req_condvar);
-                  V(workers_data[worker_index].request_pool_mutex);
-                  LogMajor(COMPONENT_DISPATCH,
-                           "Error while inserting pending request to Thread #%d... exiting",
-                           worker_index);
-                  exit(1);
-                }
-              pentry->buffdata.pdata = (caddr_t) pnfsreq;
-              pentry->buffdata.len = sizeof(*pnfsreq);
-
-              if(pthread_cond_signal(&(workers_data[worker_index].req_condvar)) == -1)
-                {
-                  V(workers_data[worker_index].mutex_req_condvar);
-                  V(workers_data[worker_index].request_pool_mutex);
-                  LogCrit(COMPONENT_DISPATCH, "NFS DISPATCH: Cond signal failed for thr#%d , errno = %d",
-                             worker_index, errno);
-                  exit(1);
-                }
-              V(workers_data[worker_index].mutex_req_condvar);
-              V(workers_data[worker_index].request_pool_mutex);
+              nfs_rpc_enqueue_request(worker_index, pnfsreq);
             }
         }
     }
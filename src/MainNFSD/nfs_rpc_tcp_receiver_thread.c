@@ -0,0 +1,509 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * \file    nfs_rpc_tcp_receiver_thread.c
+ * \brief   Shared receiver threads for the connected TCP sockets.
+ *
+ * nfs_rpc_tcp_receiver_thread.c : Shared receiver threads for the connected TCP sockets.
+ *
+ * Instead of one socket manager thread per TCP connection, a small pool of
+ * receiver threads waits on all the connections with epoll. Each connection
+ * is given to one receiver when it is accepted. The receiver reads what is
+ * available on the socket without blocking and reassembles the RPC records
+ * (record marking, RFC 1831) in a buffer kept per connection. When a record
+ * is complete, it is decoded by the usual SVC_RECV path (the read routine of
+ * the xdrrec stream takes its bytes from that buffer) and queued to a worker
+ * by rpc_tcp_dispatch_request.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef _SOLARIS
+#include "solaris_port.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+
+#if defined( _USE_TIRPC )
+#include <rpc/rpc.h>
+#elif defined( _USE_GSSRPC )
+#include <gssapi/gssapi.h>
+#include <gssrpc/rpc.h>
+#include <gssrpc/svc.h>
+#else
+#include <rpc/rpc.h>
+#include <rpc/svc.h>
+#endif
+
+#include "log_macros.h"
+#include "stuff_alloc.h"
+#include "nfs_core.h"
+
+/* Record marking: the high bit of a fragment header tells the last fragment of a record */
+#define NFS_TCP_LAST_FRAG            0x80000000U
+#define NFS_TCP_FRAG_HEADER_SIZE     4
+
+/* Reassembly buffers start with this size and grow when a record does not fit */
+#define NFS_TCP_RECORD_INIT_SIZE     65536
+
+/* A receive is not tried with less room than this in the buffer */
+#define NFS_TCP_RECORD_MIN_READ      4096
+
+/* Records bigger than this are refused, and the connection is closed */
+#define NFS_TCP_RECORD_MAX_SIZE      (8 * 1024 * 1024)
+
+/* Max number of events handled by a receiver after one epoll_wait */
+#define NFS_TCP_RECEIVER_EVENTS      64
+
+extern nfs_parameter_t nfs_param;
+
+/* Reassembly state of a connection, kept in an array indexed by the socket (as Xports) */
+typedef struct nfs_tcp_record__
+{
+  int receiver;                 /**< receiver owning the socket, -1 if none */
+  bool_t died;                  /**< the socket was closed or broken        */
+  char *buff;                   /**< received bytes, with fragment headers  */
+  size_t size;                  /**< size of buff                           */
+  size_t len;                   /**< number of received bytes in buff       */
+  size_t off;                   /**< bytes already given to the xdrrec stream */
+  size_t scan;                  /**< next fragment header to be parsed      */
+  size_t complete;              /**< end of the last complete record        */
+  size_t record_len;            /**< data length of the incomplete record   */
+  unsigned int nb_ready;        /**< complete records not received yet      */
+} nfs_tcp_record_t;
+
+static nfs_tcp_record_t *tcp_records = NULL;
+static int *receiver_epoll_fd = NULL;
+static unsigned int nb_receivers = 0;
+static unsigned int next_receiver = 0;
+
+/**
+ * nfs_tcp_record_fill: reads what is available on a socket, without blocking.
+ *
+ * The bytes are appended to the reassembly buffer of the connection, then the
+ * fragment headers are parsed to count the records that are now complete.
+ *
+ * @param fd   [IN]    the socket
+ * @param prec [INOUT] reassembly state of the socket
+ *
+ */
+static void nfs_tcp_record_fill(int fd, nfs_tcp_record_t * prec)
+{
+  ssize_t rc;
+  size_t new_size;
+  char *new_buff;
+  u_int32_t header;
+  size_t frag_len;
+
+  /* Drop what the xdrrec stream already consumed */
+  if(prec->off > 0)
+    {
+      memmove(prec->buff, prec->buff + prec->off, prec->len - prec->off);
+      prec->len -= prec->off;
+      prec->scan -= prec->off;
+      prec->complete -= prec->off;
+      prec->off = 0;
+    }
+
+  if(prec->size - prec->len < NFS_TCP_RECORD_MIN_READ)
+    {
+      new_size = (prec->size == 0) ? NFS_TCP_RECORD_INIT_SIZE : 2 * prec->size;
+
+      if(new_size > 2 * NFS_TCP_RECORD_MAX_SIZE)
+        {
+          LogEvent(COMPONENT_DISPATCH,
+                   "TCP RECEIVER Sock=%d: no room left to reassemble records, closing",
+                   fd);
+          prec->died = TRUE;
+          return;
+        }
+
+      if((new_buff = (char *)Mem_Realloc(prec->buff, new_size)) == NULL)
+        {
+          LogCrit(COMPONENT_DISPATCH,
+                  "TCP RECEIVER Sock=%d: could not allocate a %lu bytes record buffer",
+                  fd, (unsigned long)new_size);
+          prec->died = TRUE;
+          return;
+        }
+      prec->buff = new_buff;
+      prec->size = new_size;
+    }
+
+  rc = recv(fd, prec->buff + prec->len, prec->size - prec->len, MSG_DONTWAIT);
+
+  if(rc == 0)
+    {
+      /* Half closed stream */
+      prec->died = TRUE;
+      return;
+    }
+  else if(rc < 0)
+    {
+      if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        {
+          LogDebug(COMPONENT_DISPATCH, "TCP RECEIVER Sock=%d: recv failed, errno=%d",
+                   fd, errno);
+          prec->died = TRUE;
+        }
+      return;
+    }
+
+  prec->len += rc;
+
+  /* Find the records completed by these bytes */
+  while(prec->len - prec->scan >= NFS_TCP_FRAG_HEADER_SIZE)
+    {
+      memcpy(&header, prec->buff + prec->scan, NFS_TCP_FRAG_HEADER_SIZE);
+      header = ntohl(header);
+      frag_len = header & ~NFS_TCP_LAST_FRAG;
+
+      if(prec->record_len + frag_len > NFS_TCP_RECORD_MAX_SIZE)
+        {
+          LogEvent(COMPONENT_DISPATCH,
+                   "TCP RECEIVER Sock=%d: record bigger than %u bytes, closing",
+                   fd, NFS_TCP_RECORD_MAX_SIZE);
+          prec->died = TRUE;
+          return;
+        }
+
+      if(prec->len - prec->scan - NFS_TCP_FRAG_HEADER_SIZE < frag_len)
+        break;
+
+      prec->scan += NFS_TCP_FRAG_HEADER_SIZE + frag_len;
+      prec->record_len += frag_len;
+
+      if(header & NFS_TCP_LAST_FRAG)
+        {
+          prec->complete = prec->scan;
+          prec->record_len = 0;
+          prec->nb_ready += 1;
+        }
+    }
+}                               /* nfs_tcp_record_fill */
+
+/**
+ * nfs_tcp_receiver_process: handles a readable socket.
+ *
+ * @param fd [IN] the socket
+ *
+ */
+static void nfs_tcp_receiver_process(int fd)
+{
+  nfs_tcp_record_t *prec = &tcp_records[fd];
+  int rc;
+
+  nfs_tcp_record_fill(fd, prec);
+
+  while(prec->nb_ready > 0)
+    {
+      prec->nb_ready -= 1;
+
+      rc = rpc_tcp_dispatch_request(fd);
+
+      /* The transport is destroyed, and so is the reassembly state */
+      if(rc == 1)
+        return;
+
+      if(rc < 0)
+        {
+          LogCrit(COMPONENT_DISPATCH,
+                  "TCP RECEIVER Sock=%d: request could not be dispatched", fd);
+          return;
+        }
+    }
+
+  if(prec->died)
+    {
+      /* SVC_RECV finds out that the stream is broken, and the transport is destroyed */
+      if(rpc_tcp_dispatch_request(fd) == 1)
+        return;
+
+      LogCrit(COMPONENT_DISPATCH,
+              "TCP RECEIVER Sock=%d: broken connection was not released, destroying it",
+              fd);
+      nfs_rpc_tcp_receiver_remove(fd);
+      if(Xports[fd] != NULL)
+        SVC_DESTROY(Xports[fd]);
+      return;
+    }
+
+  /* Idle connections do not keep big buffers */
+  if(prec->off == prec->len && prec->size > NFS_TCP_RECORD_INIT_SIZE)
+    {
+      Mem_Free(prec->buff);
+      prec->buff = NULL;
+      prec->size = 0;
+      prec->len = prec->off = prec->scan = prec->complete = 0;
+    }
+}                               /* nfs_tcp_receiver_process */
+
+/**
+ * nfs_rpc_tcp_receiver_thread: waits for the requests of the connected TCP clients.
+ *
+ * @param Arg index of the receiver.
+ *
+ * @return Pointer to the result (but this function will mostly loop forever).
+ *
+ */
+static void *nfs_rpc_tcp_receiver_thread(void *Arg)
+{
+  unsigned long index = (unsigned long)Arg;
+  char thr_name[32];
+  struct epoll_event events[NFS_TCP_RECEIVER_EVENTS];
+  int nb_events;
+  int i;
+
+  snprintf(thr_name, sizeof(thr_name), "tcp_receiver#%lu", index);
+  SetNameFunction(thr_name);
+
+#ifndef _NO_BUDDY_SYSTEM
+  if(BuddyInit(&nfs_param.buddy_param_tcp_mgr) != BUDDY_SUCCESS)
+    {
+      /* Failed init */
+      LogCrit(COMPONENT_DISPATCH, "Memory manager could not be initialized");
+      exit(1);
+    }
+#endif
+
+  LogDebug(COMPONENT_DISPATCH, "TCP RECEIVER #%lu: Starting with pthread id #%p",
+           index, (caddr_t) pthread_self());
+
+  for(;;)
+    {
+      nb_events = epoll_wait(receiver_epoll_fd[index], events, NFS_TCP_RECEIVER_EVENTS, -1);
+
+      if(nb_events < 0)
+        {
+          if(errno != EINTR)
+            LogCrit(COMPONENT_DISPATCH, "TCP RECEIVER #%lu: epoll_wait failed, errno=%d",
+                    index, errno);
+          continue;
+        }
+
+      for(i = 0; i < nb_events; i++)
+        nfs_tcp_receiver_process(events[i].data.fd);
+    }
+
+  return NULL;
+}                               /* nfs_rpc_tcp_receiver_thread */
+
+/**
+ * nfs_rpc_tcp_receiver_init: starts the shared TCP receivers.
+ *
+ * @param nb [IN] number of receiver threads, 0 to give a socket manager thread to each connection.
+ *
+ * @return 0 if ok, -1 otherwise.
+ *
+ */
+int nfs_rpc_tcp_receiver_init(unsigned int nb)
+{
+  pthread_attr_t attr_thr;
+  pthread_t thrid;
+  unsigned long i;
+  int nb_fd = nfs_param.core_param.nb_max_fd;
+
+  if(nb == 0)
+    {
+      LogEvent(COMPONENT_DISPATCH,
+               "nfs_rpc_tcp_receiver_init: each TCP connection will have its own socket manager thread");
+      return 0;
+    }
+
+  tcp_records = (nfs_tcp_record_t *) Mem_Calloc_Label(nb_fd, sizeof(nfs_tcp_record_t),
+                                                      "tcp_records array");
+  receiver_epoll_fd = (int *)Mem_Alloc_Label(nb * sizeof(int), "receiver_epoll_fd array");
+  if(tcp_records == NULL || receiver_epoll_fd == NULL)
+    {
+      LogCrit(COMPONENT_DISPATCH, "nfs_rpc_tcp_receiver_init: could not allocate the receivers");
+      return -1;
+    }
+
+  for(i = 0; i < nb_fd; i++)
+    tcp_records[i].receiver = -1;
+
+  pthread_attr_init(&attr_thr);
+  pthread_attr_setscope(&attr_thr, PTHREAD_SCOPE_SYSTEM);
+  pthread_attr_setdetachstate(&attr_thr, PTHREAD_CREATE_DETACHED);
+
+  for(i = 0; i < nb; i++)
+    {
+      if((receiver_epoll_fd[i] = epoll_create(NFS_TCP_RECEIVER_EVENTS)) < 0)
+        {
+          LogCrit(COMPONENT_DISPATCH,
+                  "nfs_rpc_tcp_receiver_init: epoll_create failed, errno=%d", errno);
+          return -1;
+        }
+
+      if(pthread_create(&thrid, &attr_thr, nfs_rpc_tcp_receiver_thread, (void *)i) != 0)
+        {
+          LogCrit(COMPONENT_DISPATCH,
+                  "nfs_rpc_tcp_receiver_init: could not create TCP receiver #%lu", i);
+          return -1;
+        }
+    }
+
+  nb_receivers = nb;
+
+  LogEvent(COMPONENT_DISPATCH, "nfs_rpc_tcp_receiver_init: %u TCP receivers started",
+           nb_receivers);
+
+  return 0;
+}                               /* nfs_rpc_tcp_receiver_init */
+
+/**
+ * nfs_rpc_tcp_receiver_enabled: tells if the connections are managed by the shared TCP receivers.
+ *
+ * @return TRUE if so, FALSE if each connection has its own socket manager thread.
+ *
+ */
+bool_t nfs_rpc_tcp_receiver_enabled(void)
+{
+  return (nb_receivers > 0) ? TRUE : FALSE;
+}                               /* nfs_rpc_tcp_receiver_enabled */
+
+/**
+ * nfs_rpc_tcp_receiver_add: gives a newly accepted connection to a receiver.
+ *
+ * Only called from the rendezvous of the dispatcher thread.
+ *
+ * @param fd [IN] the connected socket
+ *
+ * @return 0 if ok, an errno otherwise.
+ *
+ */
+int nfs_rpc_tcp_receiver_add(int fd)
+{
+  nfs_tcp_record_t *prec;
+  struct epoll_event ev;
+
+  if(fd < 0 || fd >= nfs_param.core_param.nb_max_fd)
+    return EINVAL;
+
+  prec = &tcp_records[fd];
+  memset(prec, 0, sizeof(nfs_tcp_record_t));
+  prec->receiver = next_receiver;
+  next_receiver = (next_receiver + 1) % nb_receivers;
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = fd;
+
+  if(epoll_ctl(receiver_epoll_fd[prec->receiver], EPOLL_CTL_ADD, fd, &ev) != 0)
+    {
+      LogCrit(COMPONENT_DISPATCH, "TCP RECEIVER Sock=%d: epoll_ctl failed, errno=%d",
+              fd, errno);
+      prec->receiver = -1;
+      return errno;
+    }
+
+  LogFullDebug(COMPONENT_DISPATCH, "TCP RECEIVER #%d: now managing sock=%d",
+               prec->receiver, fd);
+
+  return 0;
+}                               /* nfs_rpc_tcp_receiver_add */
+
+/**
+ * nfs_rpc_tcp_receiver_remove: forgets a connection before its socket is closed.
+ *
+ * Does nothing if the socket is not managed by a receiver.
+ *
+ * @param fd [IN] the connected socket
+ *
+ */
+void nfs_rpc_tcp_receiver_remove(int fd)
+{
+  nfs_tcp_record_t *prec;
+
+  if(!nfs_rpc_tcp_receiver_owns(fd))
+    return;
+
+  prec = &tcp_records[fd];
+
+  epoll_ctl(receiver_epoll_fd[prec->receiver], EPOLL_CTL_DEL, fd, NULL);
+
+  if(prec->buff != NULL)
+    Mem_Free(prec->buff);
+
+  memset(prec, 0, sizeof(nfs_tcp_record_t));
+  prec->receiver = -1;
+}                               /* nfs_rpc_tcp_receiver_remove */
+
+/**
+ * nfs_rpc_tcp_receiver_owns: tells if a socket is managed by a receiver.
+ *
+ * @param fd [IN] the connected socket
+ *
+ * @return TRUE if so, FALSE otherwise.
+ *
+ */
+bool_t nfs_rpc_tcp_receiver_owns(int fd)
+{
+  if(tcp_records == NULL || fd < 0 || fd >= nfs_param.core_param.nb_max_fd)
+    return FALSE;
+
+  return (tcp_records[fd].receiver >= 0) ? TRUE : FALSE;
+}                               /* nfs_rpc_tcp_receiver_owns */
+
+/**
+ * nfs_rpc_tcp_receiver_read: read routine of the xdrrec stream of a managed socket.
+ *
+ * Gives the bytes of the complete records of the reassembly buffer. This
+ * never blocks: the records are only decoded once they are complete.
+ *
+ * @param fd  [IN]  the connected socket
+ * @param buf [OUT] where to copy the bytes
+ * @param len [IN]  max number of bytes to copy
+ *
+ * @return the number of bytes copied, -1 if nothing is left (the stream is broken).
+ *
+ */
+int nfs_rpc_tcp_receiver_read(int fd, char *buf, int len)
+{
+  nfs_tcp_record_t *prec = &tcp_records[fd];
+  size_t avail = prec->complete - prec->off;
+
+  if(avail == 0)
+    return -1;
+
+  if((size_t) len > avail)
+    len = avail;
+
+  memcpy(buf, prec->buff + prec->off, len);
+  prec->off += len;
+
+  return len;
+}                               /* nfs_rpc_tcp_receiver_read */
@@ -98,20 +98,22 @@ extern buddy_parameter_t buddy_param_worker;
 #endif
 
 /**
- * rpc_tcp_socket_manager_thread: manages a TCP socket connected to a client.
+ * rpc_tcp_dispatch_request: receives one request from a connected TCP client.
  *
- * this thread will manage a connection related to a specific TCP client.
- * 
- * @param IndexArg contains the socket number to be managed by this thread
- * 
- * @return Pointer to the result (but this function will mostly loop forever).
+ * Receives one RPC request on a connected TCP socket, decodes its arguments
+ * and queues it to a worker. If the client went away, the transport is
+ * destroyed. This is used by the per connection socket managers and by the
+ * shared TCP receivers (see nfs_rpc_tcp_receiver_thread.c).
+ *
+ * @param tcp_sock [IN] the socket to receive the request from
+ *
+ * @return 0 if the connection is still alive, 1 if the client disappeared,
+ * -1 if a fatal error occured.
  *
  */
-void *rpc_tcp_socket_manager_thread(void *Arg)
+int rpc_tcp_dispatch_request(long int tcp_sock)
 {
   int rc = 0;
-  long int tcp_sock = (long int)Arg;
-
   enum xprt_stat stat;
   struct rpc_msg *pmsg;
   struct svc_req *preq;
@@ -122,287 +124,318 @@ void *rpc_tcp_socket_manager_thread(void *Arg)
   LRU_status_t status;
   nfs_request_data_t *pnfsreq = NULL;
   int worker_index;
-  static char my_name[MAXNAMLEN];
 
   struct sockaddr_in *paddr_caller = NULL;
   char str_caller[MAXNAMLEN];
   nfs_function_desc_t funcdesc;
-  fridge_entry_t * pfe = NULL ;
 
-  snprintf(my_name, MAXNAMLEN, "tcp_sock_mgr#fd=%ld", tcp_sock);
-  SetNameFunction(my_name);
+  /* Get a worker to do the job */
+  if((worker_index = nfs_rpc_get_worker_index(FALSE)) < 0)
+    {
+      LogCrit(COMPONENT_DISPATCH, "CRITICAL ERROR: Couldn't choose a worker !!");
+      return -1;
+    }
 
-#ifndef _NO_BUDDY_SYSTEM
-  if((rc = BuddyInit(&nfs_param.buddy_param_tcp_mgr)) != BUDDY_SUCCESS)
+  /* Get a pnfsreq from the worker's pool */
+  P(workers_data[worker_index].request_pool_mutex);
+
+  GetFromPool(pnfsreq, &workers_data[worker_index].request_pool,
+              nfs_request_data_t);
+
+  V(workers_data[worker_index].request_pool_mutex);
+
+  if(pnfsreq == NULL)
     {
-      /* Failed init */
-      LogCrit(COMPONENT_DISPATCH, "Memory manager could not be initialized");
-      #ifdef _DEBUG_MEMLEAKS
-      {
-        FILE *output = fopen("/tmp/buddymem", "w");
-        if (output != NULL)
-          BuddyDumpAll(output);
-      }
-      #endif
-      exit(1);
+      LogCrit(COMPONENT_DISPATCH,
+              "CRITICAL ERROR: empty request pool for the chosen worker ! Exiting...");
+      exit(0);
     }
+
+  xprt = Xports[tcp_sock];
+  if(xprt == NULL)
+    {
+      /* But do we control sock? */
+      LogCrit(COMPONENT_DISPATCH,
+              "CRITICAL ERROR: Incoherency found in Xports array, sock=%d",
+              (int)tcp_sock);
+      return -1;
+    }
+#if defined( _USE_TIRPC ) || defined( _FREEBSD )
+  LogFullDebug(COMPONENT_DISPATCH, "Use request from spool #%d, xprt->xp_fd=%d",
+               worker_index, xprt->xp_fd);
+#else
+  LogFullDebug(COMPONENT_DISPATCH, "Use request from spool #%d, xprt->xp_sock=%d",
+               worker_index, xprt->xp_sock);
 #endif
+  LogFullDebug(COMPONENT_DISPATCH, "Thread #%d has now %d pending requests",
+               worker_index, workers_data[worker_index].pending_request->nb_entry);
+
+  /* Set up pointers */
+
+  cred_area = pnfsreq->cred_area;
+  preq = &(pnfsreq->req);
+  pmsg = &(pnfsreq->msg);
+
+  pmsg->rm_call.cb_cred.oa_base = cred_area;
+  pmsg->rm_call.cb_verf.oa_base = &(cred_area[MAX_AUTH_BYTES]);
+  preq->rq_clntcred = &(cred_area[2 * MAX_AUTH_BYTES]);
+
+  /*
+   * UDP RPCs are quite simple: everything comes to the same socket, so several SVCXPRT
+   * can be defined, one per tbuf to handle the stuff
+   * TCP RPCs are more complex:
+   *   - a unique SVCXPRT exists that deals with initial tcp rendez vous. It does the accept
+   *     with the client, but recv no message from the client. But SVC_RECV on it creates
+   *     a new SVCXPRT dedicated to the client. This specific SVXPRT is bound on TCPSocket
+   *
+   * while receiving something on the Svc_fdset, I must know if this is a UDP request,
+   * an initial TCP request or a TCP socket from an already connected client.
+   * This is how to distinguish the cases:
+   * UDP connections are bound to socket NFS_UDPSocket
+   * TCP initial connections are bound to socket NFS_TCPSocket
+   * all the other cases are requests from already connected TCP Clients
+   */
+
+  LogFullDebug(COMPONENT_DISPATCH,
+               "TCP SOCKET MANAGER : A NFS TCP request from an already connected client");
+  pnfsreq->tcp_xprt = xprt;
+  pnfsreq->xprt = pnfsreq->tcp_xprt;
+  pnfsreq->ipproto = IPPROTO_TCP;
 
-  /* Calling dispatcher main loop */
-  LogDebug(COMPONENT_DISPATCH,
-           "TCP SOCKET MANAGER Sock=%ld(%p): Starting with pthread id #%p",
-           tcp_sock, Arg, (caddr_t) pthread_self());
+#if defined( _USE_TIRPC ) || defined( _FREEBSD )
+  if(pnfsreq->xprt->xp_fd != tcp_sock)
+#else
+  if(pnfsreq->xprt->xp_sock != tcp_sock)
+#endif
+    LogCrit(COMPONENT_DISPATCH,
+         "TCP SOCKET MANAGER : /!\\ Trying to access a bad socket ! Check the source file=%s, line=%u",
+         __FILE__, __LINE__);
 
-  for(;;)
+  LogFullDebug(COMPONENT_DISPATCH, "Before calling SVC_RECV on socket %d", (int)tcp_sock);
+
+  /* Will block until the client operates on the socket, unless the socket
+   * is multiplexed by a TCP receiver that already holds a complete record */
+  pnfsreq->status = SVC_RECV(pnfsreq->xprt, pmsg);
+  LogFullDebug(COMPONENT_DISPATCH, "Status for SVC_RECV on socket %d is %d", (int)tcp_sock,
+               pnfsreq->status);
+
+  /* If status is ok, the request will be processed by the related
+   * worker, otherwise, it should be released by being tagged as invalid*/
+  if(!pnfsreq->status)
     {
-      /* Get a worker to do the job */
-      if((worker_index = nfs_rpc_get_worker_index(FALSE)) < 0)
+      /* RPC over TCP specific: RPC/UDP's xprt know only one state: XPRT_IDLE, because UDP is mostly
+       * a stateless protocol. With RPC/TCP, they can be XPRT_DIED especially when the client closes
+       * the peer's socket. We have to cope with this aspect in the next lines */
+
+      stat = SVC_STAT(pnfsreq->xprt);
+
+      if(stat == XPRT_DIED)
         {
-          LogCrit(COMPONENT_DISPATCH, "CRITICAL ERROR: Couldn't choose a worker !!");
-          return NULL;
-        }
+#ifndef _USE_TIRPC
+          if((paddr_caller = svc_getcaller(pnfsreq->xprt)) != NULL)
+            {
+              snprintf(str_caller, MAXNAMLEN, "0x%x=%d.%d.%d.%d",
+                       ntohl(paddr_caller->sin_addr.s_addr),
+                       (ntohl(paddr_caller->sin_addr.s_addr) & 0xFF000000) >> 24,
+                       (ntohl(paddr_caller->sin_addr.s_addr) & 0x00FF0000) >> 16,
+                       (ntohl(paddr_caller->sin_addr.s_addr) & 0x0000FF00) >> 8,
+                       (ntohl(paddr_caller->sin_addr.s_addr) & 0x000000FF));
+            }
+          else
+#endif                          /* _USE_TIRPC */
+            strncpy(str_caller, "unresolved", MAXNAMLEN);
 
-      /* Get a pnfsreq from the worker's pool */
-      P(workers_data[worker_index].request_pool_mutex);
+          LogEvent(COMPONENT_DISPATCH,
+                   "TCP SOCKET MANAGER Sock=%d: the client (%s) disappeared...",
+                   (int)tcp_sock, str_caller);
 
-      GetFromPool(pnfsreq, &workers_data[worker_index].request_pool,
-                  nfs_request_data_t);
- 
-      V(workers_data[worker_index].request_pool_mutex);
+          /* The socket is closed by SVC_DESTROY, forget it before its number is reused */
+          nfs_rpc_tcp_receiver_remove((int)tcp_sock);
 
-      if(pnfsreq == NULL)
-        {
-          LogCrit(COMPONENT_DISPATCH,
-                  "CRITICAL ERROR: empty request pool for the chosen worker ! Exiting...");
-          exit(0);
-        }
+          if(Xports[tcp_sock] != NULL)
+            SVC_DESTROY(Xports[tcp_sock]);
+          else
+            LogCrit(COMPONENT_DISPATCH,
+                 "TCP SOCKET MANAGER : /!\\ **** ERROR **** Mismatch between tcp_sock and xprt array");
 
-      xprt = Xports[tcp_sock];
-      if(xprt == NULL)
+          P(workers_data[worker_index].request_pool_mutex);
+          ReleaseToPool(pnfsreq, &workers_data[worker_index].request_pool);
+          V(workers_data[worker_index].request_pool_mutex);
+
+          return 1;
+        }
+      else if(stat == XPRT_MOREREQS)
         {
-          /* But do we control sock? */
-          LogCrit(COMPONENT_DISPATCH,
-                  "CRITICAL ERROR: Incoherency found in Xports array, sock=%d",
-                  (int)tcp_sock);
-          return NULL;
+          LogDebug(COMPONENT_DISPATCH,
+                   "TCP SOCKET MANAGER Sock=%d: XPRT has MOREREQS status",
+                   (int)tcp_sock);
         }
-#if defined( _USE_TIRPC ) || defined( _FREEBSD )
-      LogFullDebug(COMPONENT_DISPATCH, "Use request from spool #%d, xprt->xp_fd=%d",
-                   worker_index, xprt->xp_fd);
-#else
-      LogFullDebug(COMPONENT_DISPATCH, "Use request from spool #%d, xprt->xp_sock=%d",
-                   worker_index, xprt->xp_sock);
-#endif
-      LogFullDebug(COMPONENT_DISPATCH, "Thread #%d has now %d pending requests",
-                   worker_index, workers_data[worker_index].pending_request->nb_entry);
-
-      /* Set up pointers */
-
-      cred_area = pnfsreq->cred_area;
-      preq = &(pnfsreq->req);
-      pmsg = &(pnfsreq->msg);
-
-      pmsg->rm_call.cb_cred.oa_base = cred_area;
-      pmsg->rm_call.cb_verf.oa_base = &(cred_area[MAX_AUTH_BYTES]);
-      preq->rq_clntcred = &(cred_area[2 * MAX_AUTH_BYTES]);
-
-      /*
-       * UDP RPCs are quite simple: everything comes to the same socket, so several SVCXPRT
-       * can be defined, one per tbuf to handle the stuff
-       * TCP RPCs are more complex:
-       *   - a unique SVCXPRT exists that deals with initial tcp rendez vous. It does the accept
-       *     with the client, but recv no message from the client. But SVC_RECV on it creates
-       *     a new SVCXPRT dedicated to the client. This specific SVXPRT is bound on TCPSocket
-       *
-       * while receiving something on the Svc_fdset, I must know if this is a UDP request,
-       * an initial TCP request or a TCP socket from an already connected client.
-       * This is how to distinguish the cases:
-       * UDP connections are bound to socket NFS_UDPSocket
-       * TCP initial connections are bound to socket NFS_TCPSocket
-       * all the other cases are requests from already connected TCP Clients
-       */
 
+      /* Release the entry */
       LogFullDebug(COMPONENT_DISPATCH,
-                   "TCP SOCKET MANAGER : A NFS TCP request from an already connected client");
-      pnfsreq->tcp_xprt = xprt;
-      pnfsreq->xprt = pnfsreq->tcp_xprt;
-      pnfsreq->ipproto = IPPROTO_TCP;
+                   "TCP SOCKET MANAGER Sock=%d: Invalidating entry with xprt_stat=%d",
+                   (int)tcp_sock, stat);
+      workers_data[worker_index].passcounter += 1;
+    }
+  else
+    {
+      struct timeval timer_start;
+      struct timeval timer_end;
+      struct timeval timer_diff;
 
-#if defined( _USE_TIRPC ) || defined( _FREEBSD )
-      if(pnfsreq->xprt->xp_fd != tcp_sock)
-#else
-      if(pnfsreq->xprt->xp_sock != tcp_sock)
-#endif
-        LogCrit(COMPONENT_DISPATCH,
-             "TCP SOCKET MANAGER : /!\\ Trying to access a bad socket ! Check the source file=%s, line=%u",
-             __FILE__, __LINE__);
+      nfs_stat_type_t stat_type;
+      nfs_request_latency_stat_t latency_stat;
 
-      //TODO FSF: I think this is a redundant message
-      LogFullDebug(COMPONENT_DISPATCH, "Before waiting on select for socket %d", (int)tcp_sock);
+      memset(&timer_start, 0, sizeof(struct timeval));
+      memset(&timer_end, 0, sizeof(struct timeval));
+      memset(&timer_diff, 0, sizeof(struct timeval));
 
-      LogFullDebug(COMPONENT_DISPATCH, "Before calling SVC_RECV on socket %d", (int)tcp_sock);
+      gettimeofday(&timer_start, NULL);
 
-      /* Will block until the client operates on the socket */
-      pnfsreq->status = SVC_RECV(pnfsreq->xprt, pmsg);
-      LogFullDebug(COMPONENT_DISPATCH, "Status for SVC_RECV on socket %d is %d", (int)tcp_sock,
-                   pnfsreq->status);
+      /* Regular management of the request (UDP request or TCP request on connected handler */
+      LogFullDebug(COMPONENT_DISPATCH, "Awaking thread #%d Xprt=%p", worker_index,
+                   pnfsreq->xprt);
+      gettimeofday(&pnfsreq->time_queued, NULL);
+      P(workers_data[worker_index].mutex_req_condvar);
+      P(workers_data[worker_index].request_pool_mutex);
 
-      /* If status is ok, the request will be processed by the related
-       * worker, otherwise, it should be released by being tagged as invalid*/
-      if(!pnfsreq->status)
+      if((pentry =
+          LRU_new_entry(workers_data[worker_index].pending_request, &status)) == NULL)
         {
-          /* RPC over TCP specific: RPC/UDP's xprt know only one state: XPRT_IDLE, because UDP is mostly
-           * a stateless protocol. With RPC/TCP, they can be XPRT_DIED especially when the client closes
-           * the peer's socket. We have to cope with this aspect in the next lines */
+          V(workers_data[worker_index].mutex_req_condvar);
+          V(workers_data[worker_index].request_pool_mutex);
+          LogMajor(COMPONENT_DISPATCH,
+                   "Error while inserting pending request to Thread #%d",
+                   worker_index);
+          return -1;
+        }
 
-          stat = SVC_STAT(pnfsreq->xprt);
+      /* Call svc_getargs before making copy to prevent race conditions. */
+      pnfsreq->req.rq_prog = pmsg->rm_call.cb_prog;
+      pnfsreq->req.rq_vers = pmsg->rm_call.cb_vers;
+      pnfsreq->req.rq_proc = pmsg->rm_call.cb_proc;
 
-          if(stat == XPRT_DIED)
-            {
-#ifndef _USE_TIRPC
-              if((paddr_caller = svc_getcaller(pnfsreq->xprt)) != NULL)
-                {
-                  snprintf(str_caller, MAXNAMLEN, "0x%x=%d.%d.%d.%d",
-                           ntohl(paddr_caller->sin_addr.s_addr),
-                           (ntohl(paddr_caller->sin_addr.s_addr) & 0xFF000000) >> 24,
-                           (ntohl(paddr_caller->sin_addr.s_addr) & 0x00FF0000) >> 16,
-                           (ntohl(paddr_caller->sin_addr.s_addr) & 0x0000FF00) >> 8,
-                           (ntohl(paddr_caller->sin_addr.s_addr) & 0x000000FF));
-                }
-              else
-#endif                          /* _USE_TIRPC */
-                strncpy(str_caller, "unresolved", MAXNAMLEN);
-
-              LogEvent(COMPONENT_DISPATCH,
-                   "TCP SOCKET MANAGER Sock=%d: the client (%s) disappeared... Freezing thread %p",
-                   (int)tcp_sock, str_caller, (caddr_t)pthread_self());
-
-              if(Xports[tcp_sock] != NULL)
-                SVC_DESTROY(Xports[tcp_sock]);
-              else
-                LogCrit(COMPONENT_DISPATCH,
-                     "TCP SOCKET MANAGER : /!\\ **** ERROR **** Mismatch between tcp_sock and xprt array");
-
-              P(workers_data[worker_index].request_pool_mutex);
-              ReleaseToPool(pnfsreq, &workers_data[worker_index].request_pool);
-              V(workers_data[worker_index].request_pool_mutex);
-
-             
-              if( ( pfe = fridgethr_freeze( ) ) == NULL ) 
-                {
-		  /* Fridge expiration, the thread and exit */
-                  LogEvent( COMPONENT_DISPATCH,
-		            "TCP connection manager has expired in the fridge, let's kill it" ) ;
-#ifndef _NO_BUDDY_SYSTEM
-              /* Free stuff allocated by BuddyMalloc before thread exists */
-		  /*              sleep(nfs_param.core_param.expiration_dupreq * 2);   / ** @todo : remove this for a cleaner fix */
-              if((rc = BuddyDestroy()) != BUDDY_SUCCESS)
-                LogCrit(COMPONENT_DISPATCH,
-                        "TCP SOCKET MANAGER Sock=%d (on exit): got error %d from BuddyDestroy",
-                        (int)tcp_sock, (int)rc);
-#endif                          /*  _NO_BUDDY_SYSTEM */
+      rc = nfs_rpc_get_funcdesc(pnfsreq, &funcdesc);
+      if (rc != FALSE)
+        nfs_rpc_get_args(pnfsreq, &funcdesc);
 
-                  return NULL  ;
-                }
+      /* Update a copy of SVCXPRT and pass it to the worker thread to use it. */
+      xprt_copy = pnfsreq->xprt_copy;
+      Svcxprt_copy(xprt_copy, xprt);
+      pnfsreq->xprt = xprt_copy;
 
-              tcp_sock = (long int )pfe->arg ;
-              LogEvent( COMPONENT_DISPATCH,
-			"TCP SOCKET MANAGER Now working on sock=%d after going out of the fridge", (int)tcp_sock ) ;
-         
-              continue ;
-		
-            }
-          else if(stat == XPRT_MOREREQS)
-            {
-              LogDebug(COMPONENT_DISPATCH,
-                       "TCP SOCKET MANAGER Sock=%d: XPRT has MOREREQS status",
-                       (int)tcp_sock);
-            }
+      pentry->buffdata.pdata = (caddr_t) pnfsreq;
+      pentry->buffdata.len = sizeof(*pnfsreq);
 
-          /* Release the entry */
-          LogFullDebug(COMPONENT_DISPATCH,
-                       "TCP SOCKET MANAGER Sock=%d: Invalidating entry with xprt_stat=%d",
-                       (int)tcp_sock, stat);
-          workers_data[worker_index].passcounter += 1;
+      if(pthread_cond_signal(&(workers_data[worker_index].req_condvar)) == -1)
+        {
+          V(workers_data[worker_index].mutex_req_condvar);
+          V(workers_data[worker_index].request_pool_mutex);
+          LogCrit(COMPONENT_DISPATCH,
+               "TCP SOCKET MANAGER Sock=%d: Cond signal failed for thr#%d , errno = %d",
+               (int)tcp_sock, worker_index, errno);
         }
-      else
+      V(workers_data[worker_index].mutex_req_condvar);
+      V(workers_data[worker_index].request_pool_mutex);
+      LogFullDebug(COMPONENT_DISPATCH, "Waiting for commit from thread #%d",
+                   worker_index);
+
+      if (rc != FALSE)
         {
-          struct timeval timer_start;
-          struct timeval timer_end;
-          struct timeval timer_diff;
+          gettimeofday(&timer_end, NULL);
+          timer_diff = time_diff(timer_start, timer_end);
+
+          /* Update await time. */
+          stat_type = GANESHA_STAT_SUCCESS;
+          latency_stat.type = AWAIT_TIME;
+          latency_stat.latency = timer_diff.tv_sec * 1000000 + timer_diff.tv_usec; /* microseconds */
+          nfs_stat_update(stat_type, &(workers_data[worker_index].stats.stat_req), &(pnfsreq->req), &latency_stat);
+
+          LogFullDebug(COMPONENT_DISPATCH, "Thread #%d has committed the operation: end_time %llu.%.6llu await %llu.%.6llu",
+                       worker_index, (unsigned long long int)timer_end.tv_sec, (unsigned long long int)timer_end.tv_usec,
+                       (unsigned long long int)timer_diff.tv_sec,(unsigned long long int)timer_diff.tv_usec);
+        }
+    }
 
-          nfs_stat_type_t stat_type;
-          nfs_request_latency_stat_t latency_stat;
+  return 0;
+}                               /* rpc_tcp_dispatch_request */
 
-          memset(&timer_start, 0, sizeof(struct timeval));
-          memset(&timer_end, 0, sizeof(struct timeval));
-          memset(&timer_diff, 0, sizeof(struct timeval));
+/**
+ * rpc_tcp_socket_manager_thread: manages a TCP socket connected to a client.
+ *
+ * this thread will manage a connection related to a specific TCP client.
+ * It is only used when no shared TCP receivers are configured (Nb_TCP_Receivers = 0).
+ * 
+ * @param IndexArg contains the socket number to be managed by this thread
+ * 
+ * @return Pointer to the result (but this function will mostly loop forever).
+ *
+ */
+void *rpc_tcp_socket_manager_thread(void *Arg)
+{
+  int rc = 0;
+  long int tcp_sock = (long int)Arg;
+  static char my_name[MAXNAMLEN];
+  fridge_entry_t * pfe = NULL ;
 
-          gettimeofday(&timer_start, NULL);
+  snprintf(my_name, MAXNAMLEN, "tcp_sock_mgr#fd=%ld", tcp_sock);
+  SetNameFunction(my_name);
 
-          /* Regular management of the request (UDP request or TCP request on connected handler */
-          LogFullDebug(COMPONENT_DISPATCH, "Awaking thread #%d Xprt=%p", worker_index,
-                       pnfsreq->xprt);
-          P(workers_data[worker_index].mutex_req_condvar);
-          P(workers_data[worker_index].request_pool_mutex);
+#ifndef _NO_BUDDY_SYSTEM
+  if((rc = BuddyInit(&nfs_param.buddy_param_tcp_mgr)) != BUDDY_SUCCESS)
+    {
+      /* Failed init */
+      LogCrit(COMPONENT_DISPATCH, "Memory manager could not be initialized");
+      #ifdef _DEBUG_MEMLEAKS
+      {
+        FILE *output = fopen("/tmp/buddymem", "w");
+        if (output != NULL)
+          BuddyDumpAll(output);
+      }
+      #endif
+      exit(1);
+    }
+#endif
 
-          if((pentry =
-              LRU_new_entry(workers_data[worker_index].pending_request, &status)) == NULL)
-            {
-              V(workers_data[worker_index].mutex_req_condvar);
-              V(workers_data[worker_index].request_pool_mutex);
-              LogMajor(COMPONENT_DISPATCH,
-                       "Error while inserting pending request to Thread #%d",
-                       worker_index);
-              return NULL;
-            }
+  /* Calling dispatcher main loop */
+  LogDebug(COMPONENT_DISPATCH,
+           "TCP SOCKET MANAGER Sock=%ld(%p): Starting with pthread id #%p",
+           tcp_sock, Arg, (caddr_t) pthread_self());
 
-          /* Call svc_getargs before making copy to prevent race conditions. */
-          pnfsreq->req.rq_prog = pmsg->rm_call.cb_prog;
-          pnfsreq->req.rq_vers = pmsg->rm_call.cb_vers;
-          pnfsreq->req.rq_proc = pmsg->rm_call.cb_proc;
+  for(;;)
+    {
+      rc = rpc_tcp_dispatch_request(tcp_sock);
 
-          rc = nfs_rpc_get_funcdesc(pnfsreq, &funcdesc);
-          if (rc != FALSE)
-            nfs_rpc_get_args(pnfsreq, &funcdesc);
+      if(rc < 0)
+        return NULL;
 
-          /* Update a copy of SVCXPRT and pass it to the worker thread to use it. */
-          xprt_copy = pnfsreq->xprt_copy;
-          Svcxprt_copy(xprt_copy, xprt);
-          pnfsreq->xprt = xprt_copy;
+      if(rc == 0)
+        continue;
 
-          pentry->buffdata.pdata = (caddr_t) pnfsreq;
-          pentry->buffdata.len = sizeof(*pnfsreq);
+      /* The client disappeared, wait in the fridge for another connection */
+      LogEvent(COMPONENT_DISPATCH,
+               "TCP SOCKET MANAGER Sock=%d: Freezing thread %p",
+               (int)tcp_sock, (caddr_t)pthread_self());
 
-          if(pthread_cond_signal(&(workers_data[worker_index].req_condvar)) == -1)
-            {
-              V(workers_data[worker_index].mutex_req_condvar);
-              V(workers_data[worker_index].request_pool_mutex);
-              LogCrit(COMPONENT_DISPATCH,
-                   "TCP SOCKET MANAGER Sock=%d: Cond signal failed for thr#%d , errno = %d",
-                   (int)tcp_sock, worker_index, errno);
-            }
-          V(workers_data[worker_index].mutex_req_condvar);
-          V(workers_data[worker_index].request_pool_mutex);
-          LogFullDebug(COMPONENT_DISPATCH, "Waiting for commit from thread #%d",
-                       worker_index);
+      if( ( pfe = fridgethr_freeze( ) ) == NULL ) 
+        {
+          /* Fridge expiration, the thread and exit */
+          LogEvent( COMPONENT_DISPATCH,
+                    "TCP connection manager has expired in the fridge, let's kill it" ) ;
+#ifndef _NO_BUDDY_SYSTEM
+          /* Free stuff allocated by BuddyMalloc before thread exists */
+          if((rc = BuddyDestroy()) != BUDDY_SUCCESS)
+            LogCrit(COMPONENT_DISPATCH,
+                    "TCP SOCKET MANAGER Sock=%d (on exit): got error %d from BuddyDestroy",
+                    (int)tcp_sock, (int)rc);
+#endif                          /*  _NO_BUDDY_SYSTEM */
 
-          if (rc != FALSE)
-            {
-              gettimeofday(&timer_end, NULL);
-              timer_diff = time_diff(timer_start, timer_end);
-            
-              /* Update await time. */
-              stat_type = GANESHA_STAT_SUCCESS;
-              latency_stat.type = AWAIT_TIME;
-              latency_stat.latency = timer_diff.tv_sec * 1000000 + timer_diff.tv_usec; /* microseconds */
-              nfs_stat_update(stat_type, &(workers_data[worker_index].stats.stat_req), &(pnfsreq->req), &latency_stat);
-            
-              LogFullDebug(COMPONENT_DISPATCH, "Thread #%d has committed the operation: end_time %llu.%.6llu await %llu.%.6llu",
-                           worker_index, (unsigned long long int)timer_end.tv_sec, (unsigned long long int)timer_end.tv_usec, 
-                           (unsigned long long int)timer_diff.tv_sec,(unsigned long long int)timer_diff.tv_usec);
-            }
+          return NULL  ;
         }
+
+      tcp_sock = (long int )pfe->arg ;
+      LogEvent( COMPONENT_DISPATCH,
+                "TCP SOCKET MANAGER Now working on sock=%d after going out of the fridge", (int)tcp_sock ) ;
     }
 
   LogDebug(COMPONENT_DISPATCH, "TCP SOCKET MANAGER Sock=%d: Stopping", (int)tcp_sock);
@@ -513,6 +513,85 @@ int merge_nfs_stats(char *stat_buf, nfs_stat_client_req_t *stat_client_req,
   return rc;
 }
 
+int write_heavy_hitters(char *stat_buf, size_t size, nfs_stat_client_req_t *stat_client_req,
+                        nfs_worker_data_t *workers_data)
+{
+  unsigned int i = 0;
+  size_t len = 0;
+  nfs_hh_report_type_t type;
+  nfs_hh_report_t report;
+  nfs_hh_sketch_t *sketches[nfs_param.core_param.nb_worker];
+
+  switch(stat_client_req->stat_type)
+    {
+      case PER_CLIENT:
+        type = NFS_HH_BY_CLIENT;
+      break;
+
+      case PER_SHARE:
+        type = NFS_HH_BY_EXPORT;
+      break;
+
+      default:
+        type = NFS_HH_BY_TUPLE;
+      break;
+    }
+
+  for(i = 0; i < nfs_param.core_param.nb_worker; i++)
+    sketches[i] = &workers_data[i].hh_sketch;
+
+  /* The stats thread starts a new window at each of its passes */
+  if(nfs_hh_merge(sketches, nfs_param.core_param.nb_worker, type, &report) != 0)
+    {
+      LogCrit(COMPONENT_MAIN, "Error: Could not merge the heavy hitters statistics.");
+      return ERR_STAT_ERROR;
+    }
+
+  len = snprintf(stat_buf, size, "%u", (unsigned int)(time(NULL) - report.since));
+  for(i = 0; i < report.nb_items && len < size; i++)
+    {
+      len += snprintf(stat_buf + len, size - len, " ");
+      if(len < size)
+        len += nfs_hh_sprint_item(stat_buf + len, size - len, type, &report.items[i]);
+    }
+
+  return ERR_STAT_NO_ERROR;
+}
+
+int write_memory_profile(char *stat_buf, size_t size)
+{
+#ifndef _NO_BUDDY_SYSTEM
+  unsigned int i = 0;
+  unsigned int nb;
+  size_t len = 0;
+  unsigned int top[NFS_MEM_PROFILE_TOP];
+  buddy_profile_snapshot_t *psnap;
+
+  if((psnap = (buddy_profile_snapshot_t *) Mem_Alloc(sizeof(buddy_profile_snapshot_t))) == NULL)
+    {
+      LogCrit(COMPONENT_MAIN, "Error: Could not allocate the memory profile.");
+      return ERR_STAT_ERROR;
+    }
+
+  /* Cumulative counters: the growth is the difference between two queries */
+  BuddyProfileSnapshot(psnap);
+  nb = BuddyProfileTop(psnap, FALSE, top, NFS_MEM_PROFILE_TOP);
+
+  len = snprintf(stat_buf, size, "%lu %lu", (unsigned long)psnap->when,
+                 (unsigned long)psnap->sample_rate);
+  for(i = 0; i < nb && len < size; i++)
+    {
+      len += snprintf(stat_buf + len, size - len, "|");
+      if(len < size)
+        len += BuddyProfileSprintSite(stat_buf + len, size - len, &psnap->sites[top[i]]);
+    }
+
+  Mem_Free(psnap);
+#endif
+
+  return ERR_STAT_NO_ERROR;
+}
+
 int process_stat_request(void *addr, int new_fd)
 {
   int rc = ERR_STAT_NO_ERROR;
@@ -558,6 +637,22 @@ int process_stat_request(void *addr, int new_fd)
           {
             stat_client_req.stat_type = PER_SERVER_DETAIL;
           }
+        else if(strcmp(value, "clients") == 0)
+          {
+            stat_client_req.stat_type = PER_CLIENT;
+          }
+        else if(strcmp(value, "exports") == 0)
+          {
+            stat_client_req.stat_type = PER_SHARE;
+          }
+        else if(strcmp(value, "clients_exports") == 0)
+          {
+            stat_client_req.stat_type = PER_CLIENTSHARE;
+          }
+        else if(strcmp(value, "memory") == 0)
+          {
+            stat_client_req.stat_type = PER_MEMORY;
+          }
       }
     }
 
@@ -565,7 +660,13 @@ int process_stat_request(void *addr, int new_fd)
   }
 
   memset(stat_buf, 0, 4096);
-  merge_nfs_stats(stat_buf, &stat_client_req, &global_worker_stat, workers_data);
+  if(stat_client_req.stat_type == PER_CLIENT || stat_client_req.stat_type == PER_SHARE ||
+     stat_client_req.stat_type == PER_CLIENTSHARE)
+    write_heavy_hitters(stat_buf, 4096, &stat_client_req, workers_data);
+  else if(stat_client_req.stat_type == PER_MEMORY)
+    write_memory_profile(stat_buf, 4096);
+  else
+    merge_nfs_stats(stat_buf, &stat_client_req, &global_worker_stat, workers_data);
   if((rc = send(new_fd, stat_buf, 4096, 0)) == -1)
     LogError(COMPONENT_MAIN, ERR_SYS, errno, rc);
 
@@ -591,6 +692,15 @@ void *stat_exporter_thread(void *addr)
 
   SetNameFunction("statistics_exporter");
 
+#ifndef _NO_BUDDY_SYSTEM
+  /* The heavy hitters and the memory profile use buffers from the memory manager */
+  if((rc = BuddyInit(NULL)) != BUDDY_SUCCESS)
+    {
+      LogCrit(COMPONENT_MAIN, "Stat export server: Memory manager could not be initialized");
+      return NULL;
+    }
+#endif
+
   memset(&hints, 0, sizeof hints);
 
 #ifndef _USE_TIRPC_IPV6
@@ -105,9 +105,21 @@ void *stats_thread(void *addr)
   unsigned int len_pending_request = 0;
 
   unsigned int avg_latency;
+  cache_content_block_stat_t block_stat;
+  cache_inode_fd_cache_stat_t fd_stat;
+  nfs_hh_sketch_t *hh_sketches[nfs_param.core_param.nb_worker];
+  nfs_hh_report_t hh_report;
+  char hh_item[256];
 
 #ifndef _NO_BUDDY_SYSTEM
   buddy_stats_t global_buddy_stat;
+  buddy_profile_snapshot_t *prof_prev = NULL;
+  buddy_profile_snapshot_t *prof_cur = NULL;
+  buddy_profile_snapshot_t *prof_diff = NULL;
+  buddy_profile_snapshot_t *prof_tmp;
+  unsigned int prof_top[NFS_MEM_PROFILE_TOP];
+  unsigned int prof_nb;
+  char prof_site[256];
 #endif
 
   SetNameFunction("stat_thr");
@@ -120,6 +132,19 @@ void *stats_thread(void *addr)
       exit(1);
     }
   LogEvent(COMPONENT_MAIN, "NFS STATS : Memory manager successfully initialized");
+
+  /* The memory profile of each pass is diffed against the one of the pass before */
+  if(BuddyGetProfileRate() != 0)
+    {
+      prof_prev = (buddy_profile_snapshot_t *) Mem_Alloc(sizeof(buddy_profile_snapshot_t));
+      prof_cur = (buddy_profile_snapshot_t *) Mem_Alloc(sizeof(buddy_profile_snapshot_t));
+      prof_diff = (buddy_profile_snapshot_t *) Mem_Alloc(sizeof(buddy_profile_snapshot_t));
+
+      if(prof_prev == NULL || prof_cur == NULL || prof_diff == NULL)
+        LogCrit(COMPONENT_MAIN, "NFS STATS : Could not allocate the memory profile");
+      else
+        BuddyProfileSnapshot(prof_prev);
+    }
 #endif
 
   /* Open the stats file, in append mode */
@@ -212,6 +237,8 @@ void *stats_thread(void *addr)
       global_cache_inode_stat.nb_gc_lru_active = 0;
       global_cache_inode_stat.nb_gc_lru_total = 0;
       global_cache_inode_stat.nb_call_total = 0;
+      global_cache_inode_stat.nb_neg_hit = 0;
+      global_cache_inode_stat.nb_neg_set = 0;
 
       memset(global_cache_inode_stat.func_stats.nb_err_unrecover, 0,
              sizeof(unsigned int) * CACHE_INODE_NB_COMMAND);
@@ -225,6 +252,10 @@ void *stats_thread(void *addr)
               workers_data[i].cache_inode_client.stat.nb_gc_lru_total;
           global_cache_inode_stat.nb_call_total +=
               workers_data[i].cache_inode_client.stat.nb_call_total;
+          global_cache_inode_stat.nb_neg_hit +=
+              workers_data[i].cache_inode_client.stat.nb_neg_hit;
+          global_cache_inode_stat.nb_neg_set +=
+              workers_data[i].cache_inode_client.stat.nb_neg_set;
 
           for(j = 0; j < CACHE_INODE_NB_COMMAND; j++)
             {
@@ -273,6 +304,12 @@ void *stats_thread(void *addr)
                 global_cache_inode_stat.func_stats.nb_err_unrecover[j]);
       fprintf(stats_file, "\n");
 
+      /* Printing the negative lookup cache stat */
+      fprintf(stats_file, "CACHE_INODE_NEG,%s;%u,%u\n",
+              strdate,
+              global_cache_inode_stat.nb_neg_hit,
+              global_cache_inode_stat.nb_neg_set);
+
       /* Pinting the cache inode hash stat */
       /* This is done only on worker[0]: the hashtable is shared and worker 0 always exists */
       HashTable_GetStats(workers_data[0].ht, &hstat);
@@ -827,6 +864,8 @@ void *stats_thread(void *addr)
           global_buddy_stat.StdMemSpace += workers_data[i].stats.buddy_stats.StdMemSpace;
           global_buddy_stat.StdUsedSpace +=
               workers_data[i].stats.buddy_stats.StdUsedSpace;
+          global_buddy_stat.StdReleasedSpace +=
+              workers_data[i].stats.buddy_stats.StdReleasedSpace;
 
           if(workers_data[i].stats.buddy_stats.StdUsedSpace >
              global_buddy_stat.WM_StdUsedSpace)
@@ -858,8 +897,107 @@ void *stats_thread(void *addr)
               global_buddy_stat.NbStdUsed / nfs_param.core_param.nb_worker,
               global_buddy_stat.WM_NbStdUsed);
 
+      /* resident memory, used memory | per worker: resident, used */
+      fprintf(stats_file, "BUDDY_RESIDENT,%s;%lu,%lu", strdate,
+              (unsigned long)(global_buddy_stat.TotalMemSpace -
+                              global_buddy_stat.StdReleasedSpace),
+              (unsigned long)(global_buddy_stat.StdUsedSpace +
+                              global_buddy_stat.ExtraMemSpace));
+      for(i = 0; i < nfs_param.core_param.nb_worker; i++)
+        fprintf(stats_file, "|%lu,%lu",
+                (unsigned long)(workers_data[i].stats.buddy_stats.TotalMemSpace -
+                                workers_data[i].stats.buddy_stats.StdReleasedSpace),
+                (unsigned long)(workers_data[i].stats.buddy_stats.StdUsedSpace +
+                                workers_data[i].stats.buddy_stats.ExtraMemSpace));
+      fprintf(stats_file, "\n");
+
+      /* memory profile: rate | sites that allocated the most during this pass, as
+       * label@file:line growth allocated freed nb_alloc nb_free */
+      if(prof_prev != NULL && prof_cur != NULL && prof_diff != NULL)
+        {
+          BuddyProfileSnapshot(prof_cur);
+          BuddyProfileDiff(prof_prev, prof_cur, prof_diff);
+          prof_nb = BuddyProfileTop(prof_diff, TRUE, prof_top, NFS_MEM_PROFILE_TOP);
+
+          fprintf(stats_file, "MEM_PROFILE,%s;%lu", strdate,
+                  (unsigned long)prof_diff->sample_rate);
+          for(i = 0; i < prof_nb; i++)
+            {
+              BuddyProfileSprintSite(prof_site, sizeof(prof_site),
+                                     &prof_diff->sites[prof_top[i]]);
+              fprintf(stats_file, "|%s", prof_site);
+            }
+          fprintf(stats_file, "\n");
+
+          prof_tmp = prof_prev;
+          prof_prev = prof_cur;
+          prof_cur = prof_tmp;
+        }
+
 #endif
 
+      /* slab caches: name, object size | allocs, frees, in use | depot gets, depot puts | slabs, objects | full, empty magazines */
+      SlabDumpStats(stats_file, strdate);
+
+      /* block cache: reads, writes | page hits, page misses | write back, write through, flushed pages | evicted, invalidated | blocks, dirty blocks */
+      if(cache_content_block_enabled())
+        {
+          cache_content_block_get_stats(&block_stat);
+
+          fprintf(stats_file,
+                  "BLOCK_CACHE,%s;%llu,%llu|%llu,%llu|%llu,%llu,%llu|%llu,%llu|%llu,%llu\n",
+                  strdate, block_stat.nb_read, block_stat.nb_write,
+                  block_stat.nb_page_hit, block_stat.nb_page_miss,
+                  block_stat.nb_write_back, block_stat.nb_write_through,
+                  block_stat.nb_flushed_pages, block_stat.nb_evicted,
+                  block_stat.nb_invalidated, block_stat.nb_blocks,
+                  block_stat.nb_dirty_blocks);
+        }
+
+      /* fd cache: max, open | opened, reused | evicted, expired, not kept */
+      if(nfs_param.cache_layers_param.cache_inode_client_param.use_cache)
+        {
+          cache_inode_fd_cache_get_stats(&fd_stat);
+
+          fprintf(stats_file, "FD_CACHE,%s;%u,%u|%llu,%llu|%llu,%llu,%llu\n",
+                  strdate, fd_stat.nb_max, fd_stat.nb_open,
+                  fd_stat.nb_opened, fd_stat.nb_reused,
+                  fd_stat.nb_evicted, fd_stat.nb_expired, fd_stat.nb_not_kept);
+        }
+
+      /* Top clients and exports since the last pass, then start a new window */
+      for(i = 0; i < nfs_param.core_param.nb_worker; i++)
+        hh_sketches[i] = &workers_data[i].hh_sketch;
+
+      if(nfs_hh_merge(hh_sketches, nfs_param.core_param.nb_worker,
+                      NFS_HH_BY_CLIENT, &hh_report) == 0)
+        {
+          fprintf(stats_file, "TOP_CLIENTS,%s;%u", strdate, hh_report.nb_items);
+          for(i = 0; i < hh_report.nb_items; i++)
+            {
+              nfs_hh_sprint_item(hh_item, sizeof(hh_item), NFS_HH_BY_CLIENT,
+                                 &hh_report.items[i]);
+              fprintf(stats_file, "|%s", hh_item);
+            }
+          fprintf(stats_file, "\n");
+        }
+
+      if(nfs_hh_merge(hh_sketches, nfs_param.core_param.nb_worker,
+                      NFS_HH_BY_EXPORT, &hh_report) == 0)
+        {
+          fprintf(stats_file, "TOP_EXPORTS,%s;%u", strdate, hh_report.nb_items);
+          for(i = 0; i < hh_report.nb_items; i++)
+            {
+              nfs_hh_sprint_item(hh_item, sizeof(hh_item), NFS_HH_BY_EXPORT,
+                                 &hh_report.items[i]);
+              fprintf(stats_file, "|%s", hh_item);
+            }
+          fprintf(stats_file, "\n");
+        }
+
+      /* Both tables are merged, all of them start the next window together */
+      nfs_hh_new_window(hh_sketches, nfs_param.core_param.nb_worker);
+
       /* Flush the data written */
       fprintf(stats_file, "END, ----- NO MORE STATS FOR THIS PASS ----\n");
       fflush(stats_file);
@@ -0,0 +1,281 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * \file    nfs_worker_pool_thread.c
+ * \brief   Sizing of the pool of worker threads after the load.
+ *
+ * nfs_worker_pool_thread.c : Sizing of the pool of worker threads after the load.
+ *
+ * Nb_Worker worker slots are set up at startup, but only Nb_Min_Worker of
+ * them are given requests at first. The requests are given to the workers
+ * [0, nb_active_workers[ only. Every second, the pool thread computes how
+ * long the requests dequeued during the last second waited in the queues.
+ * When it is above Worker_Target_Wait, one more worker is given requests,
+ * its thread being started the first time it is needed. When the wait has
+ * stayed below a quarter of the target for Worker_Idle_Delay seconds, the
+ * last active worker is parked: it gets no new request, processes the ones
+ * it has, and gives its slab magazines back to the shared depots before it
+ * waits, so that its cache_inode pools are reused by the other workers.
+ * It also gives the free pages of its buddy context back to the OS at once.
+ * A parked worker keeps its thread and stack, its request pools, its
+ * cache_inode and content clients, and the buddy pages still in use by them.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef _SOLARIS
+#include "solaris_port.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#ifdef _USE_GSSRPC
+#include <gssrpc/rpc.h>
+#include <gssrpc/svc.h>
+#else
+#include <rpc/rpc.h>
+#include <rpc/svc.h>
+#endif
+
+#include "log_macros.h"
+#include "stuff_alloc.h"
+#include "nfs_core.h"
+
+/* Period of the load checks, in seconds */
+#define NFS_WORKER_POOL_PERIOD 1
+
+extern nfs_parameter_t nfs_param;
+extern nfs_worker_data_t *workers_data;
+extern pthread_t worker_thrid[NB_MAX_WORKER_THREAD];
+
+static unsigned int nb_active_workers = 0;      /* workers given requests */
+static unsigned int nb_started_workers = 0;     /* workers whose thread was started */
+static unsigned int nb_min_workers = 0;
+static pthread_attr_t worker_attr;
+
+/* Starts the thread of the next worker slot. Only called by a single thread at a time. */
+static int nfs_worker_pool_start_worker(void)
+{
+  long index = nb_started_workers;
+  int rc;
+
+  if((rc = pthread_create(&(worker_thrid[index]), &worker_attr, worker_thread,
+                          (void *)index)) != 0)
+    {
+      LogError(COMPONENT_DISPATCH, ERR_SYS, ERR_PTHREAD_CREATE, rc);
+      return -1;
+    }
+
+  nb_started_workers += 1;
+
+  return 0;
+}                               /* nfs_worker_pool_start_worker */
+
+/**
+ * nfs_worker_pool_thread: grows and shrinks the set of active workers.
+ *
+ * @param Arg unused
+ *
+ * @return never returns.
+ *
+ */
+static void *nfs_worker_pool_thread(void *Arg)
+{
+  unsigned long long wait_total;
+  unsigned long long wait_count;
+  unsigned long long last_wait_total = 0;
+  unsigned long long last_wait_count = 0;
+  unsigned long long avg_wait;
+  unsigned int target = nfs_param.core_param.worker_target_wait;
+  unsigned int nb_pending;
+  unsigned int nb_calm = 0;
+  unsigned int i;
+
+  SetNameFunction("worker_pool");
+
+#ifndef _NO_BUDDY_SYSTEM
+  if(BuddyInit(NULL) != BUDDY_SUCCESS)
+    {
+      /* Failed init */
+      LogCrit(COMPONENT_DISPATCH, "Memory manager could not be initialized");
+      exit(1);
+    }
+#endif
+
+  LogDebug(COMPONENT_DISPATCH, "WORKER POOL: Starting with pthread id #%p",
+           (caddr_t) pthread_self());
+
+  for(;;)
+    {
+      sleep(NFS_WORKER_POOL_PERIOD);
+
+      wait_total = 0;
+      wait_count = 0;
+      nb_pending = 0;
+
+      for(i = 0; i < nb_started_workers; i++)
+        {
+          wait_total += workers_data[i].wait_total;
+          wait_count += workers_data[i].wait_count;
+          nb_pending += workers_data[i].pending_request->nb_entry
+              - workers_data[i].pending_request->nb_invalid;
+        }
+
+      if(wait_count > last_wait_count)
+        avg_wait = (wait_total - last_wait_total) / (wait_count - last_wait_count);
+      else
+        avg_wait = 0;
+
+      if(avg_wait > target || (wait_count == last_wait_count && nb_pending > 0))
+        {
+          /* Requests wait too long, or nothing was dequeued while some were waiting */
+          nb_calm = 0;
+
+          if(nb_active_workers < nfs_param.core_param.nb_worker)
+            {
+              if(nb_active_workers == nb_started_workers &&
+                 nfs_worker_pool_start_worker() != 0)
+                LogCrit(COMPONENT_DISPATCH,
+                        "WORKER POOL: could not start worker #%u", nb_active_workers);
+              else
+                {
+                  nb_active_workers += 1;
+                  LogEvent(COMPONENT_DISPATCH,
+                           "WORKER POOL: average wait %llu usec, now %u active workers",
+                           avg_wait, nb_active_workers);
+                }
+            }
+        }
+      else if(avg_wait < target / 4)
+        {
+          nb_calm += 1;
+
+          if(nb_calm >= nfs_param.core_param.worker_idle_delay &&
+             nb_active_workers > nb_min_workers)
+            {
+              /* The parked worker processes what it was given, then gives back its magazines */
+              nb_active_workers -= 1;
+              nb_calm = 0;
+              LogEvent(COMPONENT_DISPATCH,
+                       "WORKER POOL: worker #%u parked, now %u active workers",
+                       nb_active_workers, nb_active_workers);
+            }
+        }
+      else
+        nb_calm = 0;
+
+      last_wait_total = wait_total;
+      last_wait_count = wait_count;
+    }
+
+  return NULL;
+}                               /* nfs_worker_pool_thread */
+
+/**
+ * nfs_worker_pool_init: starts the first workers, and the thread sizing the pool.
+ *
+ * The worker slots must have been initialized (nfs_Init_worker_data) before.
+ *
+ * @param nb_min [IN] number of workers kept active, 0 or Nb_Worker for a fixed pool.
+ * @param nb_max [IN] number of worker slots.
+ *
+ * @return 0 if ok, -1 otherwise.
+ *
+ */
+int nfs_worker_pool_init(unsigned int nb_min, unsigned int nb_max)
+{
+  pthread_attr_t attr_thr;
+  pthread_t thrid;
+  int rc;
+
+  if(nb_min == 0 || nb_min > nb_max)
+    nb_min = nb_max;
+
+  pthread_attr_init(&worker_attr);
+  pthread_attr_setscope(&worker_attr, PTHREAD_SCOPE_SYSTEM);
+  pthread_attr_setdetachstate(&worker_attr, PTHREAD_CREATE_JOINABLE);
+  pthread_attr_setstacksize(&worker_attr, THREAD_STACK_SIZE);
+
+  nb_min_workers = nb_min;
+
+  while(nb_started_workers < nb_min)
+    if(nfs_worker_pool_start_worker() != 0)
+      return -1;
+
+  nb_active_workers = nb_min;
+
+  if(nb_min == nb_max)
+    {
+      LogEvent(COMPONENT_DISPATCH,
+               "nfs_worker_pool_init: fixed pool of %u workers", nb_max);
+      return 0;
+    }
+
+  pthread_attr_init(&attr_thr);
+  pthread_attr_setscope(&attr_thr, PTHREAD_SCOPE_SYSTEM);
+  pthread_attr_setdetachstate(&attr_thr, PTHREAD_CREATE_DETACHED);
+
+  if((rc = pthread_create(&thrid, &attr_thr, nfs_worker_pool_thread, NULL)) != 0)
+    {
+      LogError(COMPONENT_DISPATCH, ERR_SYS, ERR_PTHREAD_CREATE, rc);
+      return -1;
+    }
+
+  LogEvent(COMPONENT_DISPATCH,
+           "nfs_worker_pool_init: between %u and %u workers, target wait %u usec",
+           nb_min, nb_max, nfs_param.core_param.worker_target_wait);
+
+  return 0;
+}                               /* nfs_worker_pool_init */
+
+/**
+ * nfs_worker_pool_size: returns the number of workers that are given requests.
+ *
+ * @return the workers [0, nfs_worker_pool_size()[ are active.
+ *
+ */
+unsigned int nfs_worker_pool_size(void)
+{
+  return nb_active_workers;
+}                               /* nfs_worker_pool_size */
+
+/**
+ * nfs_worker_pool_started: tells if the thread of a worker slot was started.
+ *
+ * @param index [IN] the worker slot
+ *
+ * @return TRUE if the worker runs (active or parked), FALSE otherwise.
+ *
+ */
+bool_t nfs_worker_pool_started(unsigned int index)
+{
+  return (index < nb_started_workers) ? TRUE : FALSE;
+}                               /* nfs_worker_pool_started */
@@ -724,6 +724,8 @@ static void nfs_rpc_execute(nfs_request_data_t * preqnfs,
   struct timeval timer_end;
   struct timeval timer_diff;
   nfs_request_latency_stat_t latency_stat;
+  unsigned short hh_export_id;
+  unsigned long long hh_bytes;
 
   /* daemon is terminating, do not process any new request */
   if(nfs_do_terminate)
@@ -1109,6 +1111,11 @@ static void nfs_rpc_execute(nfs_request_data_t * preqnfs,
       LogFullDebug(COMPONENT_DISPATCH, "NFS DISPATCHER: Function %s exited with status %d end_time %llu.%.6llu latency %llu.%.6llu",
                    funcdesc.funcname, rc, (unsigned long long)timer_end.tv_sec, (unsigned long long)timer_end.tv_usec,
                    (unsigned long long)timer_diff.tv_sec, (unsigned long long)timer_diff.tv_usec);
+
+      /* Account the request to its client and export, for the heavy hitters */
+      nfs_hh_request_info(ptr_req, pexport, parg_nfs, &res_nfs, &hh_export_id, &hh_bytes);
+      nfs_hh_update(&pworker_data->hh_sketch, &pworker_data->hostaddr, hh_export_id,
+                    ptr_req, hh_bytes, timer_diff.tv_sec * 1000000 + timer_diff.tv_usec);
     }
 
   /* Perform statistics here */
@@ -1338,6 +1345,10 @@ void *worker_thread(void *IndexArg)
   char thr_name[128];
   char auth_str[AUTH_STR_LEN];
   bool_t no_dispatch = FALSE;
+  bool_t parked = FALSE;
+  bool_t just_parked;
+  struct timeval time_dequeued;
+  struct timeval time_waited;
   fsal_status_t fsal_status;
 #ifdef _USE_GSSRPC
   struct rpc_gss_cred *gc;
@@ -1468,6 +1479,26 @@ void *worker_thread(void *IndexArg)
                "NFS WORKER #%lu: waiting for requests to process, nb_entry=%d, nb_invalid=%d",
                index, pmydata->pending_request->nb_entry,
                pmydata->pending_request->nb_invalid);
+
+      /* Going idle: give our slab magazines back to the other threads */
+      if(pmydata->pending_request->nb_entry == pmydata->pending_request->nb_invalid)
+        {
+          SlabThreadFlush();
+
+          /* The pool thread may have parked this worker: it gets no more request */
+          just_parked = (!parked && index >= nfs_worker_pool_size()) ? TRUE : FALSE;
+          if(just_parked)
+            LogDebug(COMPONENT_DISPATCH, "NFS WORKER #%lu: parked", index);
+          parked = (index >= nfs_worker_pool_size()) ? TRUE : FALSE;
+
+#ifndef _NO_BUDDY_SYSTEM
+          /* and the free pages of our std pages back to the OS, at most every Trim_Delay,
+           * or at once when parked, as the wait may then be long */
+          if(BuddyTrim(just_parked) > 0)
+            BuddyGetStats(&pmydata->stats.buddy_stats);
+#endif
+        }
+
       P(pmydata->mutex_req_condvar);
       while(pmydata->pending_request->nb_entry == pmydata->pending_request->nb_invalid
 	    || pmydata->reparse_exports_in_progress == TRUE)
@@ -1511,6 +1542,12 @@ void *worker_thread(void *IndexArg)
 
       pnfsreq = (nfs_request_data_t *) (pentry->buffdata.pdata);
 
+      /* Time spent in the queue, that the worker pool is sized after */
+      gettimeofday(&time_dequeued, NULL);
+      time_waited = time_diff(pnfsreq->time_queued, time_dequeued);
+      pmydata->wait_total += time_waited.tv_sec * 1000000ULL + time_waited.tv_usec;
+      pmydata->wait_count += 1;
+
       LogDebug(COMPONENT_DISPATCH,
                "NFS WORKER #%lu : I have some work to do, length=%d, invalid=%d",
                index, pmydata->pending_request->nb_entry,
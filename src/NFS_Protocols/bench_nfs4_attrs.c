@@ -0,0 +1,219 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ *
+ * Micro-benchmark of nfs4_FSALattr_To_Fattr, with the attributes a client
+ * asks for in its GETATTR calls. The attributes that need a statfs
+ * (FILES_*, SPACE_AVAIL/FREE/TOTAL) are left out: they go to the FSAL through
+ * cache_inode.
+ * The owners are converted by the id mapper, whose caches are set up as the
+ * server does it.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef _SOLARIS
+#include "solaris_port.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef _USE_GSSRPC
+#include <gssrpc/types.h>
+#include <gssrpc/rpc.h>
+#else
+#include <rpc/types.h>
+#include <rpc/rpc.h>
+#endif
+#include "BuddyMalloc.h"
+#include "stuff_alloc.h"
+#include "log_macros.h"
+#include "nfs23.h"
+#include "nfs4.h"
+#include "nfs_core.h"
+#include "nfs_exports.h"
+#include "nfs_file_handle.h"
+#include "nfs_proto_functions.h"
+#include "BenchStats.h"
+
+#define DEFAULT_OPS  100000
+
+nfs_parameter_t nfs_param;
+time_t ServerBootTime = 0;
+
+typedef struct bench_attrs_arg__
+{
+  exportlist_t export;
+  fsal_attrib_list_t attr;
+  file_handle_v4_t fh;
+  nfs_fh4 objFH;
+  bitmap4 bitmap;
+  uint32_t bitmap_val[2];
+} bench_attrs_arg_t;
+
+static uint32_t getattr_list[] = {
+  FATTR4_TYPE, FATTR4_CHANGE, FATTR4_SIZE, FATTR4_FSID, FATTR4_FILEID,
+  FATTR4_MODE, FATTR4_NUMLINKS, FATTR4_OWNER, FATTR4_OWNER_GROUP,
+  FATTR4_RAWDEV, FATTR4_SPACE_USED, FATTR4_TIME_ACCESS,
+  FATTR4_TIME_METADATA, FATTR4_TIME_MODIFY, FATTR4_MOUNTED_ON_FILEID
+};
+
+/* there is no RPC request here, as in the ganeshell */
+unsigned int get_rpc_xid(struct svc_req *reqp)
+{
+  return 0;
+}
+
+static int init_idmapper(void)
+{
+  nfs_idmap_cache_parameter_t idparam;
+  nfs_idmap_cache_parameter_t nameparam;
+
+  memset(&idparam, 0, sizeof(idparam));
+  idparam.hash_param.index_size = PRIME_ID_MAPPER;
+  idparam.hash_param.alphabet_length = 10;
+  idparam.hash_param.nb_node_prealloc = NB_PREALLOC_ID_MAPPER;
+  idparam.hash_param.hash_func_key = idmapper_value_hash_func;
+  idparam.hash_param.hash_func_rbt = idmapper_rbt_hash_func;
+  idparam.hash_param.compare_key = compare_idmapper;
+  idparam.hash_param.key_to_str = display_idmapper_key;
+  idparam.hash_param.val_to_str = display_idmapper_val;
+  idparam.hash_param.name = "Bench ID Map Cache";
+
+  memset(&nameparam, 0, sizeof(nameparam));
+  nameparam.hash_param.index_size = PRIME_ID_MAPPER;
+  nameparam.hash_param.alphabet_length = 10;
+  nameparam.hash_param.nb_node_prealloc = NB_PREALLOC_ID_MAPPER;
+  nameparam.hash_param.hash_func_key = namemapper_value_hash_func;
+  nameparam.hash_param.hash_func_rbt = namemapper_rbt_hash_func;
+  nameparam.hash_param.compare_key = compare_namemapper;
+  nameparam.hash_param.key_to_str = display_idmapper_val;
+  nameparam.hash_param.val_to_str = display_idmapper_key;
+  nameparam.hash_param.name = "Bench NAME Map Cache";
+
+  if(idmap_uid_init(idparam) != ID_MAPPER_SUCCESS ||
+     idmap_gid_init(idparam) != ID_MAPPER_SUCCESS ||
+     idmap_uname_init(nameparam) != ID_MAPPER_SUCCESS ||
+     idmap_gname_init(nameparam) != ID_MAPPER_SUCCESS)
+    return -1;
+
+  return 0;
+}                               /* init_idmapper */
+
+static int bench_thread_init(void *arg, unsigned int thread)
+{
+  return (BuddyInit(NULL) == BUDDY_SUCCESS) ? 0 : -1;
+}
+
+static int bench_fattr(void *arg, unsigned int thread, unsigned long long iter)
+{
+  bench_attrs_arg_t *p_arg = (bench_attrs_arg_t *) arg;
+  compound_data_t data;
+  fattr4 fattr;
+
+  memset(&data, 0, sizeof(data));
+  data.pexport = &p_arg->export;
+
+  if(nfs4_FSALattr_To_Fattr(&p_arg->export, &p_arg->attr, &fattr, &data,
+                            &p_arg->objFH, &p_arg->bitmap) != 0)
+    return -1;
+
+  Mem_Free(fattr.attrmask.bitmap4_val);
+  if(fattr.attr_vals.attrlist4_val != NULL)
+    Mem_Free(fattr.attr_vals.attrlist4_val);
+
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  bench_options_t options;
+  bench_attrs_arg_t arg;
+  uint_t listlen = sizeof(getattr_list) / sizeof(uint32_t);
+  unsigned int t;
+  int rc = 0;
+
+  bench_def_t benches[] = {
+    {"nfs4_FSALattr_To_Fattr", bench_fattr, bench_thread_init, NULL, &arg},
+    {NULL, NULL, NULL, NULL, NULL}
+  };
+  bench_def_t *p_bench;
+
+  SetDefaultLogging("TEST");
+  SetNamePgm("bench_nfs4_attrs");
+
+  if((rc = BenchStats_GetOptions(argc, argv, DEFAULT_OPS, &options)) != 0)
+    exit(rc > 0 ? 0 : 1);
+
+  BuddyInit(NULL);
+
+  if(init_idmapper() != 0)
+    {
+      LogTest("bench_nfs4_attrs: could not init the id mapper");
+      exit(1);
+    }
+
+  memset(&arg, 0, sizeof(arg));
+  arg.export.id = 1;
+  arg.export.filesystem_id.major = 152;
+  arg.export.filesystem_id.minor = 152;
+
+  /* a regular file, as the server gets it from cache_inode */
+  arg.attr.asked_attributes = FSAL_ATTRS_POSIX;
+  arg.attr.supported_attributes = FSAL_ATTRS_POSIX;
+  arg.attr.type = FSAL_TYPE_FILE;
+  arg.attr.filesize = 1048576;
+  arg.attr.spaceused = 1048576;
+  arg.attr.fsid.major = 152;
+  arg.attr.fsid.minor = 152;
+  arg.attr.fileid = 1234;
+  arg.attr.mode = 0644;
+  arg.attr.numlinks = 1;
+  arg.attr.owner = getuid();
+  arg.attr.group = getgid();
+  arg.attr.atime.seconds = arg.attr.mtime.seconds = arg.attr.ctime.seconds = 1234567890;
+  arg.attr.chgtime = arg.attr.ctime;
+  arg.attr.change = 1234567890;
+
+  arg.objFH.nfs_fh4_len = sizeof(file_handle_v4_t);
+  arg.objFH.nfs_fh4_val = (char *)&arg.fh;
+
+  arg.bitmap.bitmap4_val = arg.bitmap_val;
+  nfs4_list_to_bitmap4(&arg.bitmap, &listlen, getattr_list);
+
+  BenchStats_Begin(&options, "NFS_Protocols");
+
+  for(t = 0; t < options.nb_thread_counts; t++)
+    for(p_bench = benches; p_bench->name != NULL; p_bench++)
+      if(BenchStats_Run(&options, p_bench, options.thread_counts[t]) != 0)
+        rc = 1;
+
+  BenchStats_End(&options);
+
+  exit(rc);
+}
@@ -262,6 +262,9 @@ int nfs3_Readdirplus(nfs_arg_t * parg,
           "-- Readdirplus3 -> Call to cache_inode_readdir( cookie=%d, asked=%lu ) -> num_entries = %u",
            cache_inode_cookie, asked_num_entries, num_entries);
 
+      /* Renew the expired attributes of the whole page at once, before encoding */
+      cache_inode_prefetch_attributes(dirent_array, num_entries, pclient, pcontext);
+
       if(eod_met == END_OF_DIR)
         {
           LogFullDebug(COMPONENT_NFS_READDIR, "+++++++++++++++++++++++++++++++++++++++++> EOD MET ");
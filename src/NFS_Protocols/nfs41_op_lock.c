@@ -116,8 +116,10 @@ int nfs41_op_lock(struct nfs_argop4 *op, compound_data_t * data, struct nfs_reso
   cache_inode_open_owner_t *popen_owner = NULL;
   cache_inode_open_owner_t *powner_exists = NULL;
   cache_inode_open_owner_name_t *powner_name = NULL;
-  uint64_t a, b, a1, b1;
-  unsigned int overlap = FALSE;
+#ifndef _WITH_NO_NFSV41_LOCKS
+  cache_inode_state_t *pstate_conflict = NULL;
+  open_owner4 lock_owner;
+#endif
   cache_inode_open_owner_name_t owner_name;
 
   /* Lock are not supported */
@@ -235,7 +237,7 @@ int nfs41_op_lock(struct nfs_argop4 *op, compound_data_t * data, struct nfs_reso
   /* Check for conflicts with previously obtained states */
   /* At this step of the code, if pstate_exists == NULL, then all-0 or all-1 stateid is used */
 
-  /* loop into the states related to this pentry to find the related lock */
+  /* loop into the open states related to this pentry, the locks are not in this loop */
   pstate_found_iterate = NULL;
   pstate_previous_iterate = pstate_found;
   do
@@ -253,83 +255,6 @@ int nfs41_op_lock(struct nfs_argop4 *op, compound_data_t * data, struct nfs_reso
 
       if(pstate_found_iterate != NULL)
         {
-          if(pstate_found_iterate->state_type == CACHE_INODE_STATE_LOCK)
-            {
-              /* Check lock upgrade/downgrade */
-              if(pstate_exists != NULL)
-                {
-                  if((pstate_exists == pstate_found_iterate) &&
-                     (pstate_exists->state_data.lock.lock_type != arg_LOCK4.locktype))
-                    LogCrit(COMPONENT_NFS_V4,
-                        "&&&&&&&& CAS FOIREUX !!!!!!!!!!!!!!!!!!\n");
-                }
-
-              a = pstate_found_iterate->state_data.lock.offset;
-              b = pstate_found_iterate->state_data.lock.offset +
-                  pstate_found_iterate->state_data.lock.length;
-              a1 = arg_LOCK4.offset;
-              b1 = arg_LOCK4.offset + arg_LOCK4.length;
-
-              /* Locks overlap is a <= a1 < b or a < b1 <= b */
-              overlap = FALSE;
-              if(a <= a1)
-                {
-                  if(a1 < b)
-                    overlap = TRUE;
-                }
-              else
-                {
-                  if(a < b1)
-                    {
-                      if(b1 <= b)
-                        overlap = TRUE;
-                    }
-                }
-
-              if(overlap == TRUE)
-
-                /* Locks overlap is a < a1 < b or a < b1 < b */
-                if(overlap == TRUE)
-                  {
-                    /* Locks are overlapping */
-
-                    /* If both lock are READ, this is not a case of error  */
-                    if((arg_LOCK4.locktype != READ_LT)
-                       || (pstate_found_iterate->state_data.lock.lock_type != READ_LT))
-                      {
-                        /* Overlapping lock is found, if owner is different than the calling owner, return NFS4ERR_DENIED */
-                        if((pstate_exists != NULL) &&   /* all-O/all-1 stateid is considered a different owner */
-                           ((powner_exists->owner_len ==
-                             pstate_found_iterate->powner->owner_len)
-                            &&
-                            (!memcmp
-                             (powner_exists->owner_val,
-                              pstate_found_iterate->powner->owner_val,
-                              pstate_found_iterate->powner->owner_len))))
-                          {
-                            /* The calling state owner is the same. There is a discussion on this case at page 161 of RFC3530. I choose to ignore this
-                             * lock and continue iterating on the other states */
-                          }
-                        else
-                          {
-                            /* A  conflicting lock from a different lock_owner, returns NFS4ERR_DENIED */
-                            res_LOCK4.LOCK4res_u.denied.offset =
-                                pstate_found_iterate->state_data.lock.offset;
-                            res_LOCK4.LOCK4res_u.denied.length =
-                                pstate_found_iterate->state_data.lock.length;
-                            res_LOCK4.LOCK4res_u.denied.locktype =
-                                pstate_found_iterate->state_data.lock.lock_type;
-                            res_LOCK4.LOCK4res_u.denied.owner.owner.owner_len =
-                                pstate_found_iterate->powner->owner_len;
-                            res_LOCK4.LOCK4res_u.denied.owner.owner.owner_val =
-                                pstate_found_iterate->powner->owner_val;
-                            res_LOCK4.status = NFS4ERR_DENIED;
-                            return res_LOCK4.status;
-                          }
-                      }
-                  }
-            }
-          /* if( ... == CACHE_INODE_STATE_LOCK */
           if(pstate_found_iterate->state_type == CACHE_INODE_STATE_SHARE)
             {
               /* In a correct POSIX behavior, a write lock should not be allowed on a read-mode file */
@@ -352,6 +277,64 @@ int nfs41_op_lock(struct nfs_argop4 *op, compound_data_t * data, struct nfs_reso
     }
   while(pstate_found_iterate != NULL);
 
+  if(pstate_exists != NULL)
+    {
+      /* We can do the following 'cast', lock_owner4 and open_owner4 have the same definition */
+      lock_owner.clientid = powner_exists->clientid;
+      lock_owner.owner.owner_len = powner_exists->owner_len;
+      lock_owner.owner.owner_val = powner_exists->owner_val;
+
+      /* Check lock upgrade/downgrade on the locks of this owner overlapping the range */
+      pstate_found_iterate = NULL;
+      do
+        {
+          cache_inode_find_state_by_owner(data->current_entry,
+                                          &lock_owner,
+                                          &pstate_found_iterate,
+                                          pstate_found_iterate,
+                                          data->pclient, data->pcontext, &cache_status);
+          if(cache_status != CACHE_INODE_SUCCESS)
+            break;
+
+          if(pstate_found_iterate != NULL &&
+             pstate_found_iterate->state_data.lock.lock_type != arg_LOCK4.locktype &&
+             (arg_LOCK4.length == CACHE_INODE_LOCK_OFFSET_EOF ||
+              pstate_found_iterate->state_data.lock.offset <
+              arg_LOCK4.offset + arg_LOCK4.length) &&
+             (pstate_found_iterate->state_data.lock.length == CACHE_INODE_LOCK_OFFSET_EOF ||
+              arg_LOCK4.offset <
+              pstate_found_iterate->state_data.lock.offset +
+              pstate_found_iterate->state_data.lock.length))
+            LogCrit(COMPONENT_NFS_V4,
+                     "&&&&&&&& CAS FOIREUX !!!!!!!!!!!!!!!!!!\n");
+        }
+      while(pstate_found_iterate != NULL);
+    }
+
+  /* Look for a conflicting lock from another owner in the lock index of the file */
+  if(cache_inode_lock_test(data->current_entry,
+                           arg_LOCK4.offset,
+                           arg_LOCK4.length,
+                           arg_LOCK4.locktype,
+                           (pstate_exists != NULL) ? &lock_owner : NULL,
+                           &pstate_conflict,
+                           data->pclient, &cache_status) == CACHE_INODE_STATE_CONFLICT)
+    {
+      /* A  conflicting lock from a different lock_owner, returns NFS4ERR_DENIED */
+      res_LOCK4.LOCK4res_u.denied.offset = pstate_conflict->state_data.lock.offset;
+      res_LOCK4.LOCK4res_u.denied.length = pstate_conflict->state_data.lock.length;
+      res_LOCK4.LOCK4res_u.denied.locktype = pstate_conflict->state_data.lock.lock_type;
+      res_LOCK4.LOCK4res_u.denied.owner.owner.owner_len = pstate_conflict->powner->owner_len;
+      res_LOCK4.LOCK4res_u.denied.owner.owner.owner_val = pstate_conflict->powner->owner_val;
+      res_LOCK4.status = NFS4ERR_DENIED;
+      return res_LOCK4.status;
+    }
+  else if(cache_status != CACHE_INODE_SUCCESS)
+    {
+      res_LOCK4.status = NFS4ERR_INVAL;
+      return res_LOCK4.status;
+    }
+
   switch (arg_LOCK4.locker.new_lock_owner)
     {
     case TRUE:
@@ -101,8 +101,6 @@ int nfs41_op_lockt(struct nfs_argop4 *op, compound_data_t * data, struct nfs_res
 
   cache_inode_status_t cache_status;
   cache_inode_state_t *pstate_found = NULL;
-  uint64_t a, b, a1, b1;
-  unsigned int overlap = FALSE;
 
   /* Lock are not supported */
   resp->resop = NFS4_OP_LOCKT;
@@ -170,88 +168,30 @@ int nfs41_op_lockt(struct nfs_argop4 *op, compound_data_t * data, struct nfs_res
         }
     }
 
-  /* loop into the states related to this pentry to find the related lock */
-  pstate_found = NULL;
-  do
+  /* Look for a conflicting lock from another owner in the lock index of the file.
+   * We can do the following 'cast', lock_owner4 and open_owner4 have the same definition */
+  if(cache_inode_lock_test(data->current_entry,
+                           arg_LOCKT4.offset,
+                           arg_LOCKT4.length,
+                           arg_LOCKT4.locktype,
+                           (open_owner4 *) & arg_LOCKT4.owner,
+                           &pstate_found,
+                           data->pclient, &cache_status) == CACHE_INODE_STATE_CONFLICT)
     {
-      cache_inode_state_iterate(data->current_entry,
-                                &pstate_found,
-                                pstate_found,
-                                data->pclient, data->pcontext, &cache_status);
-      if((cache_status == CACHE_INODE_STATE_ERROR)
-         || (cache_status == CACHE_INODE_INVALID_ARGUMENT))
-        {
-          res_LOCKT4.status = NFS4ERR_INVAL;
-          return res_LOCKT4.status;
-        }
-
-      if(pstate_found != NULL)
-        {
-          if(pstate_found->state_type == CACHE_INODE_STATE_LOCK)
-            {
-
-              /* We found a lock, check is they overlap */
-              a = pstate_found->state_data.lock.offset;
-              b = pstate_found->state_data.lock.offset +
-                  pstate_found->state_data.lock.length;
-              a1 = arg_LOCKT4.offset;
-              b1 = arg_LOCKT4.offset + arg_LOCKT4.length;
-
-              /* Locks overlap is a <= a1 < b or a < b1 <= b */
-              overlap = FALSE;
-              if(a <= a1)
-                {
-                  if(a1 < b)
-                    overlap = TRUE;
-                }
-              else
-                {
-                  if(a < b1)
-                    {
-                      if(b1 <= b)
-                        overlap = TRUE;
-                    }
-                }
-
-              if(overlap == TRUE)
-                {
-                  if((arg_LOCKT4.locktype != READ_LT)
-                     || (pstate_found->state_data.lock.lock_type != READ_LT))
-                    {
-                      /* Overlapping lock is found, if owner is different than the calling owner, return NFS4ERR_DENIED */
-                      if((arg_LOCKT4.owner.owner.owner_len ==
-                          pstate_found->powner->owner_len)
-                         &&
-                         (!memcmp
-                          (arg_LOCKT4.owner.owner.owner_val,
-                           pstate_found->powner->owner_val,
-                           pstate_found->powner->owner_len)))
-                        {
-                          /* The calling state owner is the same. There is a discussion on this case at page 161 of RFC3530. I choose to ignore this
-                           * lock and continue iterating on the other states */
-                        }
-                      else
-                        {
-                          /* A  conflicting lock from a different lock_owner, returns NFS4ERR_DENIED */
-                          res_LOCKT4.LOCKT4res_u.denied.offset =
-                              pstate_found->state_data.lock.offset;
-                          res_LOCKT4.LOCKT4res_u.denied.length =
-                              pstate_found->state_data.lock.length;
-                          res_LOCKT4.LOCKT4res_u.denied.locktype =
-                              pstate_found->state_data.lock.lock_type;
-                          res_LOCKT4.LOCKT4res_u.denied.owner.owner.owner_len =
-                              pstate_found->powner->owner_len;
-                          res_LOCKT4.LOCKT4res_u.denied.owner.owner.owner_val =
-                              pstate_found->powner->owner_val;
-                          res_LOCKT4.status = NFS4ERR_DENIED;
-                          return res_LOCKT4.status;
-                        }
-                    }
-                }
-            }
-        }
+      /* A  conflicting lock from a different lock_owner, returns NFS4ERR_DENIED */
+      res_LOCKT4.LOCKT4res_u.denied.offset = pstate_found->state_data.lock.offset;
+      res_LOCKT4.LOCKT4res_u.denied.length = pstate_found->state_data.lock.length;
+      res_LOCKT4.LOCKT4res_u.denied.locktype = pstate_found->state_data.lock.lock_type;
+      res_LOCKT4.LOCKT4res_u.denied.owner.owner.owner_len = pstate_found->powner->owner_len;
+      res_LOCKT4.LOCKT4res_u.denied.owner.owner.owner_val = pstate_found->powner->owner_val;
+      res_LOCKT4.status = NFS4ERR_DENIED;
+      return res_LOCKT4.status;
+    }
+  else if(cache_status != CACHE_INODE_SUCCESS)
+    {
+      res_LOCKT4.status = NFS4ERR_INVAL;
+      return res_LOCKT4.status;
     }
-  while(pstate_found != NULL);
 
   /* Succssful exit, no conflicting lock were found */
   res_LOCKT4.status = NFS4_OK;
@@ -91,17 +91,17 @@
 
 int CreatePUBFH4(nfs_fh4 * fh, compound_data_t * data)
 {
-  pseudofs_entry_t psfsentry;
+  pseudofs_entry_t *psfsentry;
   int status = 0;
   char fhstr[LEN_FH_STR];
 
 
-  psfsentry = *(data->pseudofs->reverse_tab[0]);
+  psfsentry = &(data->pseudofs->root);
 
   if((status = nfs4_AllocateFH(&(data->publicFH))) != NFS4_OK)
     return status;
 
-  if(!nfs4_PseudoToFhandle(&(data->publicFH), &psfsentry))
+  if(!nfs4_PseudoToFhandle(&(data->publicFH), psfsentry))
     {
       return NFS4ERR_BADHANDLE;
     }
@@ -92,16 +92,16 @@
 
 int CreateROOTFH4(nfs_fh4 * fh, compound_data_t * data)
 {
-  pseudofs_entry_t psfsentry;
+  pseudofs_entry_t *psfsentry;
   int status = 0;
   char fhstr[LEN_FH_STR];
 
-  psfsentry = *(data->pseudofs->reverse_tab[0]);
+  psfsentry = &(data->pseudofs->root);
 
   if((status = nfs4_AllocateFH(&(data->rootFH))) != NFS4_OK)
     return status;
 
-  if(!nfs4_PseudoToFhandle(&(data->rootFH), &psfsentry))
+  if(!nfs4_PseudoToFhandle(&(data->rootFH), psfsentry))
     {
       return NFS4ERR_BADHANDLE;
     }
@@ -64,6 +64,9 @@
 
 extern time_t ServerBootTime;
 
+/* Entries read from the cache at once: one chunk of a cached directory */
+#define NFS4_READDIR_CHUNK CHILDREN_ARRAY_SIZE
+
 /**
  * nfs4_op_readdir: The NFS4_OP_READDIR.
  * 
@@ -91,24 +94,28 @@ int nfs4_op_readdir(struct nfs_argop4 *op,
 
   unsigned long dircount;
   unsigned long maxcount;
-  entry4 *entry_nfs_array;
-  cache_inode_dir_entry_t *dirent_array;
+  nfs4_readdir_page_t page;
+  nfs_cookie4 entry_cookie;
+  fattr4 entry_attrs;
+  uint32_t entry_bitmap[2];
+  char entry_attrvals[NFS4_ATTRVALS_BUFFLEN];
+  cache_inode_dir_entry_t dirent_array[NFS4_READDIR_CHUNK];
   verifier4 cookie_verifier;
   unsigned int cookie = 0;
   unsigned int end_cookie = 0;
-  unsigned int *cookie_array;
+  unsigned int cookie_array[NFS4_READDIR_CHUNK];
   fsal_handle_t *entry_FSALhandle;
   nfs_fh4 entryFH;
   char val_fh[NFS4_FHSIZE];
-  entry_name_array_item_t *entry_name_array;
   unsigned long space_used;
   unsigned int estimated_num_entries;
   unsigned int num_entries;
+  int page_full;
 
   unsigned int i = 0;
 
-  bitmap4 RdAttrErrorBitmap;
-  attrlist4 RdAttrErrorVals;
+  bitmap4 RdAttrErrorBitmap = { 1, (uint32_t *) "\0\0\0\b" };   /* 0xB = 11 = FATTR4_RDATTR_ERROR */
+  attrlist4 RdAttrErrorVals = { 0, NULL };      /* Nothing to be seen here */
 
   resp->resop = NFS4_OP_READDIR;
   res_READDIR4.status = NFS4_OK;
@@ -157,6 +164,10 @@ int nfs4_op_readdir(struct nfs_argop4 *op,
   dircount = arg_READDIR4.dircount;
   maxcount = arg_READDIR4.maxcount;
   cookie = (unsigned int)arg_READDIR4.cookie;
+
+  /* The reply is allocated from maxcount, which is bounded like the replies to READ */
+  if(maxcount > data->pexport->MaxRead)
+    maxcount = data->pexport->MaxRead;
   space_used = sizeof(entry4);
 
   /* dircount is considered meaningless by many nfsv4 client (like the CITI one). we use maxcount instead */
@@ -223,88 +234,58 @@ int nfs4_op_readdir(struct nfs_argop4 *op,
    * will let us know if eod was reached or not */
   res_READDIR4.READDIR4res_u.resok4.reply.eof = FALSE;
 
-  /* Get prepared for readdir */
-  if((dirent_array =
-      (cache_inode_dir_entry_t *) Mem_Alloc(estimated_num_entries *
-                                            sizeof(cache_inode_dir_entry_t))) == NULL)
-    {
-      res_READDIR4.status = NFS4ERR_SERVERFAULT;
-      return res_READDIR4.status;
-    }
-
-  if((cookie_array =
-      (unsigned int *)Mem_Alloc(estimated_num_entries * sizeof(unsigned int))) == NULL)
+  /* Allocation of the reply, its size is bounded by maxcount */
+  if(nfs4_readdir_page_init(&page, estimated_num_entries, maxcount) != 0)
     {
-      Mem_Free((char *)dirent_array);
-
+      LogError(COMPONENT_NFS_V4, ERR_SYS, ERR_MALLOC, errno);
       res_READDIR4.status = NFS4ERR_SERVERFAULT;
       return res_READDIR4.status;
     }
 
-  /* Perform the readdir operation */
-  if(cache_inode_readdir(dir_pentry,
-                         cookie,
-                         estimated_num_entries,
-                         &num_entries,
-                         &end_cookie,
-                         &eod_met,
-                         dirent_array,
-                         cookie_array,
-                         data->ht,
-                         data->pclient,
-                         data->pcontext, &cache_status) != CACHE_INODE_SUCCESS)
-    {
-      res_READDIR4.status = nfs4_Errno(cache_status);
-      return res_READDIR4.status;
-    }
+  /* The directory is read by chunks of NFS4_READDIR_CHUNK entries, until the reply
+   * is full or the end of the directory is met: only the entries of a chunk are copied
+   * out of the cache, whatever maxcount is */
+  eod_met = TO_BE_CONTINUED;
+  page_full = FALSE;
 
-  /* For an empty directory, we will find only . and .., so reply af if the end if reached */
-  if(num_entries == 0)
-    {
-      /* only . and .. */
-      res_READDIR4.READDIR4res_u.resok4.reply.entries = NULL;
-      res_READDIR4.READDIR4res_u.resok4.reply.eof = TRUE;
-      memcpy(res_READDIR4.READDIR4res_u.resok4.cookieverf, cookie_verifier,
-             NFS4_VERIFIER_SIZE);
-    }
-  else
+  while(!page_full && eod_met != END_OF_DIR)
     {
-      /* Allocation of reply structures */
-      if((entry_name_array =
-          (entry_name_array_item_t *) Mem_Alloc(num_entries *
-                                                (FSAL_MAX_NAME_LEN + 1))) == NULL)
+      /* Perform the readdir operation */
+      if(cache_inode_readdir(dir_pentry,
+                             cookie,
+                             NFS4_READDIR_CHUNK,
+                             &num_entries,
+                             &end_cookie,
+                             &eod_met,
+                             dirent_array,
+                             cookie_array,
+                             data->ht,
+                             data->pclient,
+                             data->pcontext, &cache_status) != CACHE_INODE_SUCCESS)
         {
-          LogError(COMPONENT_NFS_V4, ERR_SYS, ERR_MALLOC, errno);
-          res_READDIR4.status = NFS4ERR_SERVERFAULT;
+          Mem_Free((char *)page.entries);
+          res_READDIR4.status = nfs4_Errno(cache_status);
           return res_READDIR4.status;
         }
-      memset((char *)entry_name_array, 0, num_entries * (FSAL_MAX_NAME_LEN + 1));
 
-      if((entry_nfs_array = (entry4 *) Mem_Alloc(num_entries * sizeof(entry4))) == NULL)
-        {
-          LogError(COMPONENT_NFS_V4, ERR_SYS, ERR_MALLOC, errno);
-          res_READDIR4.status = NFS4ERR_SERVERFAULT;
-          return res_READDIR4.status;
-        }
+      /* A short chunk is the last one */
+      if(num_entries == 0)
+        break;
+
+      /* Renew the expired attributes of the whole chunk at once, before encoding */
+      cache_inode_prefetch_attributes(dirent_array, num_entries, data->pclient,
+                                      data->pcontext);
 
       for(i = 0; i < num_entries; i++)
         {
-          entry_nfs_array[i].name.utf8string_val = entry_name_array[i];
-
-          if(str2utf8(dirent_array[i].name.name, &entry_nfs_array[i].name) == -1)
-            {
-              res_READDIR4.status = NFS4ERR_SERVERFAULT;
-              return res_READDIR4.status;
-            }
-
           /* Set the cookie value */
           if(i != num_entries - 1)
-            entry_nfs_array[i].cookie = cookie_array[i + 1] + 2;        /* 0, 1 and 2 are reserved */
+            entry_cookie = cookie_array[i + 1] + 2;     /* 0, 1 and 2 are reserved */
           else
-            entry_nfs_array[i].cookie = end_cookie + 2;
+            entry_cookie = end_cookie + 2;
 
           LogFullDebug(COMPONENT_NFS_V4, " === nfs4_op_readdir ===>   i=%d name=%s cookie=%"PRIu64,
-                 i, dirent_array[i].name.name, entry_nfs_array[i].cookie);
+                 i, dirent_array[i].name.name, entry_cookie);
 
           /* Get the pentry for the object's attributes and filehandle */
           if((pentry = cache_inode_lookup(dir_pentry,
@@ -314,12 +295,7 @@ int nfs4_op_readdir(struct nfs_argop4 *op,
                                           data->pclient,
                                           data->pcontext, &cache_status)) == NULL)
             {
-              Mem_Free((char *)entry_nfs_array);
-              Mem_Free((char *)dirent_array);
-              Mem_Free((char *)cookie_array);
-              /* Return the fattr4_rdattr_error , cf RFC3530, page 192 */
-              entry_nfs_array[i].attrs.attrmask = RdAttrErrorBitmap;
-              entry_nfs_array[i].attrs.attr_vals = RdAttrErrorVals;
+              Mem_Free((char *)page.entries);
               res_READDIR4.status = NFS4ERR_SERVERFAULT;
               return res_READDIR4.status;
             }
@@ -332,9 +308,7 @@ int nfs4_op_readdir(struct nfs_argop4 *op,
                   cache_inode_get_fsal_handle(pentry, &cache_status_attr)) == NULL)
                 {
                   /* Faulty Handle or pentry */
-                  Mem_Free((char *)entry_nfs_array);
-                  Mem_Free((char *)dirent_array);
-                  Mem_Free((char *)cookie_array);
+                  Mem_Free((char *)page.entries);
                   res_READDIR4.status = NFS4ERR_SERVERFAULT;
                   return res_READDIR4.status;
                 }
@@ -342,55 +316,65 @@ int nfs4_op_readdir(struct nfs_argop4 *op,
               if(!nfs4_FSALToFhandle(&entryFH, entry_FSALhandle, data))
                 {
                   /* Faulty type */
-                  Mem_Free((char *)entry_nfs_array);
-                  Mem_Free((char *)dirent_array);
-                  Mem_Free((char *)cookie_array);
+                  Mem_Free((char *)page.entries);
                   res_READDIR4.status = NFS4ERR_SERVERFAULT;
                   return res_READDIR4.status;
                 }
             }
 
-          if(nfs4_FSALattr_To_Fattr(data->pexport,
-                                    &attrlookup,
-                                    &(entry_nfs_array[i].attrs),
-                                    data, &entryFH, &(arg_READDIR4.attr_request)) != 0)
+          /* The attributes are built on the stack, the page keeps a copy */
+          if(nfs4_FSALattr_To_Fattr_Buffer(data->pexport,
+                                           &attrlookup,
+                                           &entry_attrs,
+                                           data, &entryFH, &(arg_READDIR4.attr_request),
+                                           entry_bitmap, entry_attrvals) != 0)
             {
               /* Return the fattr4_rdattr_error , cf RFC3530, page 192 */
-              entry_nfs_array[i].attrs.attrmask = RdAttrErrorBitmap;
-              entry_nfs_array[i].attrs.attr_vals = RdAttrErrorVals;
+              entry_attrs.attrmask = RdAttrErrorBitmap;
+              entry_attrs.attr_vals = RdAttrErrorVals;
             }
 
-          /* Chain the entries together */
-          entry_nfs_array[i].nextentry = NULL;
-          if(i != 0)
-            entry_nfs_array[i - 1].nextentry = &(entry_nfs_array[i]);
-
-          /* This test is there to avoid going further than the buffer provided by the client 
-           * the factor "9/10" is there for safety. Its value could be change as beta tests will be done */
-          if((caddr_t)
-             ((caddr_t) (&entry_nfs_array[i]) - (caddr_t) (&entry_nfs_array[0])) >
-             (caddr_t) (maxcount * 9 / 10))
-            break;
+          /* Stop before going further than the buffer provided by the client */
+          if(nfs4_readdir_page_add(&page, dirent_array[i].name.name,
+                                   entry_cookie, &entry_attrs) == NULL)
+            {
+              page_full = TRUE;
+              break;
+            }
         }                       /* for i */
 
-      if((eod_met == END_OF_DIR) && (i == num_entries))
+      cookie = end_cookie;
+    }                           /* while */
+
+  if(page.nb_entries == 0)
+    {
+      Mem_Free((char *)page.entries);
+
+      /* Not even one entry fits in maxcount */
+      if(page_full)
         {
-          /* This is the end of the directory */
-          res_READDIR4.READDIR4res_u.resok4.reply.eof = TRUE;
-          memcpy(res_READDIR4.READDIR4res_u.resok4.cookieverf, cookie_verifier,
-                 NFS4_VERIFIER_SIZE);
+          res_READDIR4.status = NFS4ERR_TOOSMALL;
+          return res_READDIR4.status;
         }
 
+      /* For an empty directory, we will find only . and .., so reply af if the end if reached */
+      res_READDIR4.READDIR4res_u.resok4.reply.entries = NULL;
+      res_READDIR4.READDIR4res_u.resok4.reply.eof = TRUE;
+    }
+  else
+    {
+      /* This is the end of the directory if no entry was left out of the reply */
+      if(!page_full && eod_met == END_OF_DIR)
+        res_READDIR4.READDIR4res_u.resok4.reply.eof = TRUE;
+
       /* Put the entry's list in the READDIR reply */
-      res_READDIR4.READDIR4res_u.resok4.reply.entries = entry_nfs_array;
+      res_READDIR4.READDIR4res_u.resok4.reply.entries = page.entries;
     }
 
   /* Do not forget to set the verifier */
   memcpy((char *)res_READDIR4.READDIR4res_u.resok4.cookieverf, cookie_verifier,
          NFS4_VERIFIER_SIZE);
 
-  Mem_Free((char *)dirent_array);
-  Mem_Free((char *)cookie_array);
   res_READDIR4.status = NFS4_OK;
 
   return res_READDIR4.status;
@@ -408,24 +392,10 @@ int nfs4_op_readdir(struct nfs_argop4 *op,
  */
 void nfs4_op_readdir_Free(READDIR4res * resp)
 {
-  entry4 *entries;
-
-  if(resp->status == NFS4_OK)
-    {
-      for(entries = resp->READDIR4res_u.resok4.reply.entries; entries != NULL;
-          entries = entries->nextentry)
-        {
-          Mem_Free((char *)entries->attrs.attrmask.bitmap4_val);
-          /** @todo Fixeme , bad Free here Mem_Free( (char *)entries->attrs.attr_vals.attrlist4_val ) ; */
-        }
-
-      if(resp->READDIR4res_u.resok4.reply.entries != NULL)
-        {
-          Mem_Free((char *)resp->READDIR4res_u.resok4.reply.entries[0].name.
-                   utf8string_val);
-          Mem_Free((char *)resp->READDIR4res_u.resok4.reply.entries);
-        }
-    }
+  /* The entries, their names and attributes were built in a single block
+   * (see nfs4_readdir_page_init) */
+  if(resp->status == NFS4_OK && resp->READDIR4res_u.resok4.reply.entries != NULL)
+    Mem_Free((char *)resp->READDIR4res_u.resok4.reply.entries);
 
   return;
 }                               /* nfs4_op_readdir_Free */
@@ -78,7 +78,9 @@
 /* The boot time of the server */
 extern time_t ServerBootTime;
 
-static pseudofs_t gPseudoFs;
+/* The current pseudo fs. It is never modified once published: a new tree
+ * is built on export reload and replaces it. */
+static pseudofs_t *gPseudoFs = NULL;
 
 /**
  * nfs4_PseudoToId: TConverts a file handle (to a pseudo object) to the id of this pseudo object in the pseudofs
@@ -109,6 +111,7 @@ uint64_t nfs4_PseudoToId(nfs_fh4 * fh4p)
  * nfs4_GetPseudoFs: Gets the root of the pseudo file system.
  * 
  * Gets the root of the pseudo file system. This is only a wrapper to static variable gPseudoFs. 
+ * The returned tree stays valid as long as the worker threads are not paused for an export reload.
  *
  * @return the pseudo fs root 
  * 
@@ -116,15 +119,200 @@ uint64_t nfs4_PseudoToId(nfs_fh4 * fh4p)
 
 pseudofs_t *nfs4_GetPseudoFs(void)
 {
-  return &gPseudoFs;
+  return gPseudoFs;
 }                               /*  nfs4_GetExportList */
 
+/**
+ * nfs4_PseudoHashName: computes the hash value of an entry name.
+ *
+ * @param name [IN] the name to hash
+ *
+ * @return the hash value
+ *
+ */
+
+static unsigned int nfs4_PseudoHashName(char *name)
+{
+  unsigned int h = 0;
+  unsigned char *p;
+
+  for(p = (unsigned char *)name; *p != '\0'; p++)
+    h = h * 31 + *p;
+
+  return h;
+}                               /* nfs4_PseudoHashName */
+
+/**
+ * nfs4_PseudoLookupSon: looks for a son of an entry in the pseudo fs.
+ *
+ * @param parent [IN] the directory entry
+ * @param name   [IN] the name of the son
+ *
+ * @return the son, or NULL if parent has no son with this name.
+ *
+ */
+
+static pseudofs_entry_t *nfs4_PseudoLookupSon(pseudofs_entry_t * parent, char *name)
+{
+  pseudofs_entry_t *iter;
+  unsigned int h;
+
+  if(parent->sons_hash == NULL)
+    return NULL;
+
+  h = nfs4_PseudoHashName(name);
+
+  for(iter = parent->sons_hash[h & (parent->sons_hash_size - 1)]; iter != NULL;
+      iter = iter->hash_next)
+    if(iter->name_hash == h && !strcmp(iter->name, name))
+      return iter;
+
+  return NULL;
+}                               /* nfs4_PseudoLookupSon */
+
+/**
+ * nfs4_PseudoAddSon: attaches a new entry to its parent.
+ *
+ * The son is appended to the list of sons and inserted in the sons hash, which
+ * is doubled when it holds as many entries as buckets.
+ *
+ * @param parent [INOUT] the directory entry
+ * @param son    [INOUT] the new entry, with its name set
+ *
+ * @return 0 if successfull, ENOMEM otherwise.
+ *
+ */
+
+static int nfs4_PseudoAddSon(pseudofs_entry_t * parent, pseudofs_entry_t * son)
+{
+  pseudofs_entry_t **new_hash;
+  pseudofs_entry_t *iter;
+  unsigned int new_size;
+
+  if(parent->nb_sons >= parent->sons_hash_size)
+    {
+      new_size = (parent->sons_hash_size == 0) ?
+          PSEUDOFS_SONS_HASH_SIZE : 2 * parent->sons_hash_size;
+
+      if((new_hash =
+          (pseudofs_entry_t **) Mem_Alloc(new_size * sizeof(pseudofs_entry_t *))) == NULL)
+        return ENOMEM;
+      memset(new_hash, 0, new_size * sizeof(pseudofs_entry_t *));
+
+      /* rehash the sons from the list, it holds all of them */
+      for(iter = parent->sons; iter != NULL; iter = iter->next)
+        {
+          iter->hash_next = new_hash[iter->name_hash & (new_size - 1)];
+          new_hash[iter->name_hash & (new_size - 1)] = iter;
+        }
+
+      if(parent->sons_hash != NULL)
+        Mem_Free(parent->sons_hash);
+
+      parent->sons_hash = new_hash;
+      parent->sons_hash_size = new_size;
+    }
+
+  son->name_hash = nfs4_PseudoHashName(son->name);
+  son->hash_next = parent->sons_hash[son->name_hash & (parent->sons_hash_size - 1)];
+  parent->sons_hash[son->name_hash & (parent->sons_hash_size - 1)] = son;
+
+  son->next = NULL;
+  son->last = son;
+  if(parent->sons == NULL)
+    parent->sons = son;
+  else
+    {
+      parent->sons->last->next = son;
+      parent->sons->last = son;
+    }
+  son->parent = parent;
+  parent->nb_sons += 1;
+
+  return 0;
+}                               /* nfs4_PseudoAddSon */
+
+/**
+ * nfs4_PseudoSetId: gives an id to an entry and registers it in the reverse tab.
+ *
+ * @param PseudoFs [INOUT] the pseudo fs being built
+ * @param entry    [INOUT] the new entry
+ * @param id       [IN]    the id to give
+ *
+ * @return 0 if successfull, ENOMEM otherwise.
+ *
+ */
+
+static int nfs4_PseudoSetId(pseudofs_t * PseudoFs, pseudofs_entry_t * entry,
+                            unsigned int id)
+{
+  pseudofs_entry_t **new_tab;
+  unsigned int new_size;
+
+  if(id >= PseudoFs->reverse_tab_size)
+    {
+      for(new_size = PseudoFs->reverse_tab_size; new_size <= id; new_size *= 2) ;
+
+      if((new_tab =
+          (pseudofs_entry_t **) Mem_Alloc(new_size * sizeof(pseudofs_entry_t *))) == NULL)
+        return ENOMEM;
+      memset(new_tab, 0, new_size * sizeof(pseudofs_entry_t *));
+      memcpy(new_tab, PseudoFs->reverse_tab,
+             PseudoFs->reverse_tab_size * sizeof(pseudofs_entry_t *));
+
+      Mem_Free(PseudoFs->reverse_tab);
+      PseudoFs->reverse_tab = new_tab;
+      PseudoFs->reverse_tab_size = new_size;
+    }
+
+  entry->pseudo_id = id;
+  PseudoFs->reverse_tab[id] = entry;
+  if(id > PseudoFs->last_pseudo_id)
+    PseudoFs->last_pseudo_id = id;
+
+  return 0;
+}                               /* nfs4_PseudoSetId */
+
+/**
+ * nfs4_FreePseudoFS: releases a pseudo fs tree.
+ *
+ * @param PseudoFs [INOUT] the tree to free. No thread may be using it.
+ *
+ */
+
+static void nfs4_FreePseudoFS(pseudofs_t * PseudoFs)
+{
+  unsigned int i;
+
+  if(PseudoFs == NULL)
+    return;
+
+  /* every entry but the root is in the reverse tab */
+  for(i = 1; i < PseudoFs->reverse_tab_size; i++)
+    if(PseudoFs->reverse_tab[i] != NULL)
+      {
+        if(PseudoFs->reverse_tab[i]->sons_hash != NULL)
+          Mem_Free(PseudoFs->reverse_tab[i]->sons_hash);
+        Mem_Free(PseudoFs->reverse_tab[i]);
+      }
+
+  if(PseudoFs->root.sons_hash != NULL)
+    Mem_Free(PseudoFs->root.sons_hash);
+
+  Mem_Free(PseudoFs->reverse_tab);
+  Mem_Free(PseudoFs);
+}                               /* nfs4_FreePseudoFS */
+
 /**
  * nfs4_ExportToPseudoFS: Build a pseudo fs from an exportlist
  * 
  * Build a pseudo fs from an exportlist. This export list itself is obtained by reading the configuration file. 
+ * The new tree replaces the current one, which is freed: on export reload, this must be called while the
+ * worker threads are paused.
+ * A path that already was in the previous tree keeps its pseudo id, so that the file handles the clients
+ * hold remain valid across the reload.
  *
- * @return the pseudo fs root 
+ * @return 0 if successfull, an errno value otherwise. The current tree is left unchanged on error.
  * 
  */
 
@@ -134,19 +322,33 @@ int nfs4_ExportToPseudoFS(exportlist_t * pexportlist)
   exportlist_t *next;           /* exportlist entry   */
   int i = 0;
   int j = 0;
-  int found = 0;
+  int rc = 0;
+  unsigned int next_pseudo_id;
   char tmp_pseudopath[MAXPATHLEN];
   char *PathTok[NB_TOK_PATH];
   int NbTokPath;
   pseudofs_t *PseudoFs = NULL;
-  pseudofs_entry_t *PseudoFsRoot = NULL;
+  pseudofs_t *OldPseudoFs = gPseudoFs;
   pseudofs_entry_t *PseudoFsCurrent = NULL;
+  pseudofs_entry_t *OldPseudoFsCurrent = NULL;
   pseudofs_entry_t *newPseudoFsEntry = NULL;
   pseudofs_entry_t *iterPseudoFs = NULL;
 
   entry = pexportlist;
 
-  PseudoFs = &gPseudoFs;
+  if((PseudoFs = (pseudofs_t *) Mem_Alloc(sizeof(pseudofs_t))) == NULL)
+    return ENOMEM;
+  memset(PseudoFs, 0, sizeof(pseudofs_t));
+
+  if((PseudoFs->reverse_tab =
+      (pseudofs_entry_t **) Mem_Alloc(PSEUDOFS_SONS_HASH_SIZE *
+                                      sizeof(pseudofs_entry_t *))) == NULL)
+    {
+      Mem_Free(PseudoFs);
+      return ENOMEM;
+    }
+  memset(PseudoFs->reverse_tab, 0, PSEUDOFS_SONS_HASH_SIZE * sizeof(pseudofs_entry_t *));
+  PseudoFs->reverse_tab_size = PSEUDOFS_SONS_HASH_SIZE;
 
   /* Init Root of the Pseudo FS tree */
   strncpy(PseudoFs->root.name, "/", MAXNAMLEN);
@@ -154,20 +356,29 @@ int nfs4_ExportToPseudoFS(exportlist_t * pexportlist)
   PseudoFs->root.pseudo_id = 0;
   PseudoFs->root.junction_export = NULL;
   PseudoFs->root.next = NULL;
-  PseudoFs->root.last = PseudoFsRoot;
+  PseudoFs->root.last = NULL;
   PseudoFs->root.sons = NULL;
   PseudoFs->root.parent = &(PseudoFs->root);    /* root is its own parent */
+  PseudoFs->reverse_tab[0] = &(PseudoFs->root);
+
+  /* The ids of the previous tree are kept, new entries get ids after them */
+  next_pseudo_id = (OldPseudoFs != NULL) ? OldPseudoFs->last_pseudo_id + 1 : 1;
 
   /* Allocation of the parsing table */
   for(i = 0; i < NB_TOK_PATH; i++)
     if((PathTok[i] = (char *)Mem_Alloc(MAXNAMLEN)) == NULL)
-      return ENOMEM;
+      {
+        while(--i >= 0)
+          Mem_Free(PathTok[i]);
+        nfs4_FreePseudoFS(PseudoFs);
+        return ENOMEM;
+      }
 
   while(entry)
     {
       /* To not forget to init "/" entry */
       PseudoFsCurrent = &(PseudoFs->root);
-      PseudoFs->reverse_tab[0] = &(PseudoFs->root);
+      OldPseudoFsCurrent = (OldPseudoFs != NULL) ? &(OldPseudoFs->root) : NULL;
 
       /* skip exports that aren't for NFS v4 */
       if((entry->options & EXPORT_OPTION_NFSV4) == 0)
@@ -226,54 +437,65 @@ int nfs4_ExportToPseudoFS(exportlist_t * pexportlist)
 
           for(j = 1; j < NbTokPath; j++)
             {
-              found = 0;
-              for(iterPseudoFs = PseudoFsCurrent->sons; iterPseudoFs != NULL;
-                  iterPseudoFs = iterPseudoFs->next)
-                {
-                  /* Looking for a matching entry */
-                  if(!strcmp(iterPseudoFs->name, PathTok[j]))
-                    {
-                      found = 1;
-                      break;
-                    }
-                }               /* for iterPseudoFs */
-
-              if(found)
+              /* Follow the same path in the previous tree, to find the entry's former id */
+              if(OldPseudoFsCurrent != NULL)
+                OldPseudoFsCurrent = nfs4_PseudoLookupSon(OldPseudoFsCurrent, PathTok[j]);
+
+              if((iterPseudoFs = nfs4_PseudoLookupSon(PseudoFsCurrent, PathTok[j])) != NULL)
                 {
                   /* a matching entry was found in the tree */
                   PseudoFsCurrent = iterPseudoFs;
+                  continue;
+                }
+
+              /* a new entry is to be created */
+              if((newPseudoFsEntry =
+                  (pseudofs_entry_t *) Mem_Alloc(sizeof(pseudofs_entry_t))) == NULL)
+                {
+                  rc = ENOMEM;
+                  goto out;
+                }
+              memset(newPseudoFsEntry, 0, sizeof(pseudofs_entry_t));
+
+              strncpy(newPseudoFsEntry->name, PathTok[j], MAXNAMLEN - 1);
+              newPseudoFsEntry->name[MAXNAMLEN - 1] = '\0';
+              newPseudoFsEntry->junction_export = NULL;
+
+              if(snprintf(newPseudoFsEntry->fullname, MAXPATHLEN, "%s/%s",
+                          PseudoFsCurrent->fullname, PathTok[j]) >= MAXPATHLEN)
+                {
+                  LogCrit(COMPONENT_NFS_V4_PSEUDO,
+                          "BUILDING PSEUDOFS: pseudo path %s is too long", entry->pseudopath);
+                  Mem_Free(newPseudoFsEntry);
+                  rc = ENAMETOOLONG;
+                  goto out;
                 }
+
+              /* Creating the new entry, allocate an id for it and add it to reverse tab */
+              if(OldPseudoFsCurrent != NULL)
+                rc = nfs4_PseudoSetId(PseudoFs, newPseudoFsEntry,
+                                      OldPseudoFsCurrent->pseudo_id);
+              else if(next_pseudo_id < MAX_PSEUDO_ENTRY)
+                rc = nfs4_PseudoSetId(PseudoFs, newPseudoFsEntry, next_pseudo_id++);
               else
                 {
-                  /* a new entry is to be created */
-                  if((newPseudoFsEntry =
-                      (pseudofs_entry_t *) Mem_Alloc(sizeof(pseudofs_entry_t))) == NULL)
-                    return ENOMEM;
-
-                  /* Creating the new entry, allocate an id for it and add it to reverse tab */
-                  strncpy(newPseudoFsEntry->name, PathTok[j], MAXNAMLEN);
-                  newPseudoFsEntry->pseudo_id = PseudoFs->last_pseudo_id + 1;
-                  PseudoFs->last_pseudo_id = newPseudoFsEntry->pseudo_id;
-                  PseudoFs->reverse_tab[PseudoFs->last_pseudo_id] = newPseudoFsEntry;
-                  newPseudoFsEntry->junction_export = NULL;
-                  newPseudoFsEntry->last = newPseudoFsEntry;
-                  newPseudoFsEntry->next = NULL;
-                  newPseudoFsEntry->sons = NULL;
-                  snprintf(newPseudoFsEntry->fullname, MAXPATHLEN, "%s/%s",
-                           PseudoFsCurrent->fullname, PathTok[j]);
-
-                  /* Step into the new entry and attach it to the tree */
-                  if(PseudoFsCurrent->sons == NULL)
-                    PseudoFsCurrent->sons = newPseudoFsEntry;
-                  else
-                    {
-                      PseudoFsCurrent->sons->last->next = newPseudoFsEntry;
-                      PseudoFsCurrent->sons->last = newPseudoFsEntry;
-                    }
-                  newPseudoFsEntry->parent = PseudoFsCurrent;
-                  PseudoFsCurrent = newPseudoFsEntry;
+                  LogCrit(COMPONENT_NFS_V4_PSEUDO,
+                          "BUILDING PSEUDOFS: more than %d entries, cannot add %s",
+                          MAX_PSEUDO_ENTRY, entry->pseudopath);
+                  rc = ENOSPC;
+                }
+
+              if(rc != 0)
+                {
+                  Mem_Free(newPseudoFsEntry);
+                  goto out;
                 }
 
+              /* Step into the new entry and attach it to the tree */
+              if((rc = nfs4_PseudoAddSon(PseudoFsCurrent, newPseudoFsEntry)) != 0)
+                goto out;
+
+              PseudoFsCurrent = newPseudoFsEntry;
             }                   /* for j */
 
           /* Now that all entries are added to pseudofs tree, add the junction to the pseudofs */
@@ -286,12 +508,27 @@ int nfs4_ExportToPseudoFS(exportlist_t * pexportlist)
       entry = next;
     }                           /* while( entry ) */
 
+  /* Keep the ids of the removed entries out of the next reload */
+  if(next_pseudo_id - 1 > PseudoFs->last_pseudo_id)
+    PseudoFs->last_pseudo_id = next_pseudo_id - 1;
+
+  /* The tree is complete, publish it */
+  __sync_synchronize();
+  gPseudoFs = PseudoFs;
+  __sync_synchronize();
+
+  nfs4_FreePseudoFS(OldPseudoFs);
+
+ out:
   /* desalocation of the parsing table */
   for(i = 0; i < NB_TOK_PATH; i++)
     Mem_Free(PathTok[i]);
 
-  return (0);
-}
+  if(rc != 0)
+    nfs4_FreePseudoFS(PseudoFs);
+
+  return rc;
+}                               /* nfs4_ExportToPseudoFS */
 
 /**
  * nfs4_PseudoToFattr: Gets the attributes for an entry in the pseudofs
@@ -1236,14 +1473,15 @@ int nfs4_PseudoToFattr(pseudofs_entry_t * psfsp,
  * 
  * Converts  a NFSv4 file handle fs to an id in the pseudo, and check if the fh is related to a pseudo entry
  *
- * @param fh4p      [IN] pointer to nfsv4 filehandle
- * @param psfsentry [OUT]  pointer to pseudofs entry
+ * @param fh4p       [IN]  pointer to nfsv4 filehandle
+ * @param psfstree   [IN]  the pseudo fs
+ * @param ppsfsentry [OUT] pointer to the pseudofs entry, which is not to be modified
  * 
  * @return TRUE if successfull, FALSE if an error occured (this means the fh4 was not related to a pseudo entry)
  * 
  */
 int nfs4_FhandleToPseudo(nfs_fh4 * fh4p, pseudofs_t * psfstree,
-                         pseudofs_entry_t * psfsentry)
+                         pseudofs_entry_t ** ppsfsentry)
 {
   file_handle_v4_t *pfhandle4;
 
@@ -1254,9 +1492,13 @@ int nfs4_FhandleToPseudo(nfs_fh4 * fh4p, pseudofs_t * psfstree,
   if(pfhandle4->pseudofs_flag == FALSE)
     return FALSE;
 
+  /* The id may be the one of an entry removed by an export reload */
+  if(pfhandle4->pseudofs_id >= psfstree->reverse_tab_size ||
+     psfstree->reverse_tab[pfhandle4->pseudofs_id] == NULL)
+    return FALSE;
+
   /* Get the object pointer by using the reverse tab in the pseudofs structure */
-  memcpy(psfsentry, psfstree->reverse_tab[pfhandle4->pseudofs_id],
-         sizeof(pseudofs_entry_t));
+  *ppsfsentry = psfstree->reverse_tab[pfhandle4->pseudofs_id];
 
   return TRUE;
 }                               /* nfs4_FhandleToPseudo */
@@ -1305,18 +1547,18 @@ int nfs4_PseudoToFhandle(nfs_fh4 * fh4p, pseudofs_entry_t * psfsentry)
 
 int nfs4_CreateROOTFH4(nfs_fh4 * fh4p, compound_data_t * data)
 {
-  pseudofs_entry_t psfsentry;
+  pseudofs_entry_t *psfsentry;
   int i, status = 0;
 
-  psfsentry = *(data->pseudofs->reverse_tab[0]);
+  psfsentry = &(data->pseudofs->root);
 
   LogFullDebug(COMPONENT_NFS_V4_PSEUDO, "CREATE ROOTFH (pseudo): root to pseudofs = #%s#",
-                  psfsentry.name);
+                  psfsentry->name);
 
   if((status = nfs4_AllocateFH(&(data->rootFH))) != NFS4_OK)
     return status;
 
-  if(!nfs4_PseudoToFhandle(&(data->rootFH), &psfsentry))
+  if(!nfs4_PseudoToFhandle(&(data->rootFH), psfsentry))
     {
       LogFullDebug(COMPONENT_NFS_V4_PSEUDO,
                       "CREATE ROOTFH (pseudo): Creation of root fh is impossible");
@@ -1351,7 +1593,7 @@ int nfs4_CreateROOTFH4(nfs_fh4 * fh4p, compound_data_t * data)
 int nfs4_op_getattr_pseudo(struct nfs_argop4 *op,
                            compound_data_t * data, struct nfs_resop4 *resp)
 {
-  pseudofs_entry_t psfsentry;
+  pseudofs_entry_t *psfsentry = NULL;
   char __attribute__ ((__unused__)) funcname[] = "nfs4_op_getattr";
 
   resp->resop = NFS4_OP_GETATTR;
@@ -1364,7 +1606,7 @@ int nfs4_op_getattr_pseudo(struct nfs_argop4 *op,
     }
 
   /* All directories in pseudo fs have the same Fattr */
-  if(nfs4_PseudoToFattr(&psfsentry,
+  if(nfs4_PseudoToFattr(psfsentry,
                         &(res_GETATTR4.GETATTR4res_u.resok4.obj_attributes),
                         data, &(data->currentFH), &(arg_GETATTR4.attr_request)) != 0)
     res_GETATTR4.status = NFS4ERR_SERVERFAULT;
@@ -1435,7 +1677,7 @@ int nfs4_op_lookup_pseudo(struct nfs_argop4 *op,
 {
   char name[MAXNAMLEN];
   char __attribute__ ((__unused__)) funcname[] = "nfs4_op_lookup_pseudo";
-  pseudofs_entry_t psfsentry;
+  pseudofs_entry_t *psfsentry = NULL;
   pseudofs_entry_t *iter = NULL;
   int found = FALSE;
   int pseudo_is_slash = FALSE ;
@@ -1467,25 +1709,18 @@ int nfs4_op_lookup_pseudo(struct nfs_argop4 *op,
     }
 
  
-  /* If "/" is set as pseudopath, then gPseudoFS.root.junction_export is not NULL but 
-   * gPseudoFS.root has no son */
-  if( ( gPseudoFs.root.junction_export != NULL ) && ( gPseudoFs.root.sons == NULL )  )
+  /* If "/" is set as pseudopath, then the root's junction_export is not NULL but 
+   * the root has no son */
+  if( ( data->pseudofs->root.junction_export != NULL ) && ( data->pseudofs->root.sons == NULL )  )
    {
-	iter = &gPseudoFs.root ;
+	iter = &data->pseudofs->root ;
         pseudo_is_slash = TRUE ;
         found = TRUE ;
    }
   else
    {
-     found = FALSE;
-     for(iter = psfsentry.sons; iter != NULL; iter = iter->next)
-       {
-         if(!strcmp(iter->name, name))
-           {
-             found = TRUE;
-             break;
-           } 
-       } /* for */
+     iter = nfs4_PseudoLookupSon(psfsentry, name);
+     found = (iter != NULL);
     } /* else */
 
   if(!found)
@@ -1661,7 +1896,7 @@ int nfs4_op_lookupp_pseudo(struct nfs_argop4 *op,
                            compound_data_t * data, struct nfs_resop4 *resp)
 {
   char __attribute__ ((__unused__)) funcname[] = "nfs4_op_lookup_pseudo";
-  pseudofs_entry_t psfsentry;
+  pseudofs_entry_t *psfsentry = NULL;
 
   resp->resop = NFS4_OP_LOOKUPP;
 
@@ -1673,14 +1908,14 @@ int nfs4_op_lookupp_pseudo(struct nfs_argop4 *op,
     }
 
   /* lookupp on the root on the pseudofs should return NFS4ERR_NOENT (RFC3530, page 166) */
-  if(!memcmp(&psfsentry, data->pseudofs->reverse_tab[0], sizeof(psfsentry)))
+  if(psfsentry->pseudo_id == 0)
     {
       res_LOOKUPP4.status = NFS4ERR_NOENT;
       return res_LOOKUPP4.status;
     }
 
   /* A matching entry was found */
-  if(!nfs4_PseudoToFhandle(&(data->currentFH), psfsentry.parent))
+  if(!nfs4_PseudoToFhandle(&(data->currentFH), psfsentry->parent))
     {
       res_LOOKUPP4.status = NFS4ERR_SERVERFAULT;
       return res_LOOKUPP4.status;
@@ -1722,14 +1957,14 @@ int nfs4_op_readdir_pseudo(struct nfs_argop4 *op,
   unsigned long dircount = 0;
   unsigned long maxcount = 0;
   unsigned long estimated_num_entries = 0;
-  unsigned long i = 0;
   nfs_cookie4 cookie;
   verifier4 cookie_verifier;
   unsigned long space_used = 0;
-  pseudofs_entry_t psfsentry;
+  pseudofs_entry_t *psfsentry = NULL;
   pseudofs_entry_t *iter = NULL;
-  entry4 *entry_nfs_array = NULL;
-  entry_name_array_item_t *entry_name_array = NULL;
+  nfs4_readdir_page_t page;
+  fattr4 entry_attrs;
+  entry4 *entry = NULL;
   nfs_fh4 entryFH;
   cache_inode_fsal_data_t fsdata;
   fsal_path_t exportpath_fsal;
@@ -1785,19 +2020,19 @@ int nfs4_op_readdir_pseudo(struct nfs_argop4 *op,
       return res_READDIR4.status;
     }
   LogFullDebug(COMPONENT_NFS_V4_PSEUDO,
-                    "PSEUDOFS READDIR in #%s#", psfsentry.name);
+                    "PSEUDOFS READDIR in #%s#", psfsentry->name);
 
   /* If this a junction filehandle ? */
-  if(psfsentry.junction_export != NULL)
+  if(psfsentry->junction_export != NULL)
     {
       /* This is a junction */
       LogFullDebug(COMPONENT_NFS_V4_PSEUDO,
                         "PSEUDOFS READDIR : DIR #%s# id=%u is a junction",
-                        psfsentry.name, psfsentry.junction_export->id);
+                        psfsentry->name, psfsentry->junction_export->id);
 
       /* Step up the compound data */
-      data->pexport = psfsentry.junction_export;
-      strncpy(data->MntPath, psfsentry.fullname, NFS_MAXPATHLEN);
+      data->pexport = psfsentry->junction_export;
+      strncpy(data->MntPath, psfsentry->fullname, NFS_MAXPATHLEN);
 
       /* Build the credentials */
       if(nfs4_MakeCred(data) != 0)
@@ -1913,19 +2148,8 @@ int nfs4_op_readdir_pseudo(struct nfs_argop4 *op,
       return nfs4_op_readdir(op, data, resp);
     }
 
-  /* Allocation of the entries array */
-  if((entry_name_array =
-      (entry_name_array_item_t *) Mem_Alloc(estimated_num_entries *
-                                            (FSAL_MAX_NAME_LEN + 1))) == NULL)
-    {
-      LogError(COMPONENT_NFS_V4_PSEUDO, ERR_SYS, ERR_MALLOC, errno);
-      res_READDIR4.status = NFS4ERR_SERVERFAULT;
-      return res_READDIR4.status;
-    }
-  memset((char *)entry_name_array, 0, estimated_num_entries * (FSAL_MAX_NAME_LEN + 1));
-
-  if((entry_nfs_array =
-      (entry4 *) Mem_Alloc(estimated_num_entries * sizeof(entry4))) == NULL)
+  /* Allocation of the reply, its size is bounded by maxcount */
+  if(nfs4_readdir_page_init(&page, estimated_num_entries, maxcount) != 0)
     {
       LogError(COMPONENT_NFS_V4_PSEUDO, ERR_SYS, ERR_MALLOC, errno);
       res_READDIR4.status = NFS4ERR_SERVERFAULT;
@@ -1944,7 +2168,7 @@ int nfs4_op_readdir_pseudo(struct nfs_argop4 *op,
           if(memcmp(cookie_verifier, arg_READDIR4.cookieverf, NFS4_VERIFIER_SIZE) != 0)
             {
               res_READDIR4.status = NFS4ERR_BAD_COOKIE;
-              Mem_Free(entry_nfs_array);
+              Mem_Free(page.entries);
               return res_READDIR4.status;
             }
         }
@@ -1958,27 +2182,22 @@ int nfs4_op_readdir_pseudo(struct nfs_argop4 *op,
    * Entries '.' and '..' are not returned also
    * For these reason, there will be an offset of 3 between NFS4 cookie and HPSS cookie */
 
-  /* make sure to start at the right position given by the cookie */
-  iter = psfsentry.sons;
-  if(cookie != 0)
-    {
-      for(; iter != NULL; iter = iter->next)
-        if((iter->pseudo_id + 3) == cookie)
-          break;
-    }
+  /* make sure to start at the right position given by the cookie: the cookie is the one
+   * of the last entry returned, whose id gives the entry in the reverse tab */
+  if(cookie == 0)
+    iter = psfsentry->sons;
+  else if(cookie - 3 < data->pseudofs->reverse_tab_size &&
+          data->pseudofs->reverse_tab[cookie - 3] != NULL &&
+          data->pseudofs->reverse_tab[cookie - 3]->parent == psfsentry)
+    iter = data->pseudofs->reverse_tab[cookie - 3]->next;
+  else
+    iter = NULL;
 
   /* Here, where are sure that iter is set to the position indicated eventually by the cookie */
-  i = 0;
   for(; iter != NULL; iter = iter->next)
     {
       LogFullDebug(COMPONENT_NFS_V4_PSEUDO, "PSEUDO FS: Found entry %s", iter->name);
 
-      entry_nfs_array[i].name.utf8string_len = strlen(iter->name);
-      strncpy(entry_name_array[i], iter->name, FSAL_MAX_NAME_LEN);
-
-      entry_nfs_array[i].name.utf8string_val = entry_name_array[i];
-      entry_nfs_array[i].cookie = iter->pseudo_id + 3;
-
       /* If file handle is asked in the attributes, provide it */
       if(arg_READDIR4.attr_request.bitmap4_val[0] & FATTR4_FILEHANDLE)
         {
@@ -1986,6 +2205,8 @@ int nfs4_op_readdir_pseudo(struct nfs_argop4 *op,
             {
               if(nfs4_AllocateFH(&entryFH) != NFS4_OK)
                 {
+                  Mem_Free(page.entries);
+                  res_READDIR4.status = NFS4ERR_SERVERFAULT;
                   return res_READDIR4.status;
                 }
             }
@@ -1993,53 +2214,54 @@ int nfs4_op_readdir_pseudo(struct nfs_argop4 *op,
           if(!nfs4_PseudoToFhandle(&entryFH, iter))
             {
               res_READDIR4.status = NFS4ERR_SERVERFAULT;
-              Mem_Free(entry_nfs_array);
+              Mem_Free(page.entries);
               return res_READDIR4.status;
             }
         }
 
+      memset(&entry_attrs, 0, sizeof(entry_attrs));
       if(nfs4_PseudoToFattr(iter,
-                            &(entry_nfs_array[i].attrs),
+                            &entry_attrs,
                             data, &entryFH, &(arg_READDIR4.attr_request)) != 0)
         {
           /* Should never occured, but the is no reason for leaving the section without any information */
-          entry_nfs_array[i].attrs.attrmask = RdAttrErrorBitmap;
-          entry_nfs_array[i].attrs.attr_vals = RdAttrErrorVals;
+          entry_attrs.attrmask = RdAttrErrorBitmap;
+          entry_attrs.attr_vals = RdAttrErrorVals;
+          entry = nfs4_readdir_page_add(&page, iter->name, iter->pseudo_id + 3, &entry_attrs);
+        }
+      else
+        {
+          /* The page keeps a copy of the attributes */
+          entry = nfs4_readdir_page_add(&page, iter->name, iter->pseudo_id + 3, &entry_attrs);
+          if(entry_attrs.attrmask.bitmap4_val != NULL)
+            Mem_Free(entry_attrs.attrmask.bitmap4_val);
+          if(entry_attrs.attr_vals.attrlist4_val != NULL)
+            Mem_Free(entry_attrs.attr_vals.attrlist4_val);
         }
 
-      /* Chain the entry together */
-      entry_nfs_array[i].nextentry = NULL;
-      if(i != 0)
-        entry_nfs_array[i - 1].nextentry = &(entry_nfs_array[i]);
-
-      /* Increment the counter */
-      i += 1;
-
-      /* Did we reach the maximum number of entries */
-      if(i == estimated_num_entries)
+      /* Did we reach the size asked by the client ? */
+      if(entry == NULL)
         break;
     }
 
-  /* Resize entry_nfs_array */
-  /* @todo : Is this reallocation actually needed ? */
-#ifdef BUGAZOMEU
-  if(i < estimated_num_entries)
-    if((entry_nfs_array = Mem_Realloc_Label(entry_nfs_array, i * sizeof(entry4),
-                                            "entry4")) == NULL)
-      {
-        LogError(COMPONENT_NFS_V4_PSEUDO, ERR_SYS, ERR_MALLOC, errno);
-        res_READDIR4.status = NFS4ERR_SERVERFAULT;
-        Mem_Free(entry_nfs_array);
-        return res_READDIR4.status;
-      }
-#endif
+  /* Not even one entry fits in maxcount */
+  if(iter != NULL && page.nb_entries == 0)
+    {
+      Mem_Free(page.entries);
+      res_READDIR4.status = NFS4ERR_TOOSMALL;
+      return res_READDIR4.status;
+    }
+
   /* Build the reply */
   memcpy(res_READDIR4.READDIR4res_u.resok4.cookieverf, cookie_verifier,
          NFS4_VERIFIER_SIZE);
-  if(i == 0)
-    res_READDIR4.READDIR4res_u.resok4.reply.entries = NULL;
+  if(page.nb_entries == 0)
+    {
+      Mem_Free(page.entries);
+      res_READDIR4.READDIR4res_u.resok4.reply.entries = NULL;
+    }
   else
-    res_READDIR4.READDIR4res_u.resok4.reply.entries = entry_nfs_array;
+    res_READDIR4.READDIR4res_u.resok4.reply.entries = page.entries;
 
   /* did we reach the end ? */
   if(iter == NULL)
@@ -1234,8 +1234,9 @@ int nfs4_op_readdir_xattr(struct nfs_argop4 *op,
   nfs_cookie4 cookie;
   verifier4 cookie_verifier;
   unsigned long space_used = 0;
-  entry4 *entry_nfs_array = NULL;
-  entry_name_array_item_t *entry_name_array = NULL;
+  nfs4_readdir_page_t page;
+  fattr4 entry_attrs;
+  entry4 *entry = NULL;
   nfs_fh4 entryFH;
   cache_inode_fsal_data_t fsdata;
   fsal_path_t exportpath_fsal;
@@ -1273,6 +1274,8 @@ int nfs4_op_readdir_xattr(struct nfs_argop4 *op,
 
   /* dircount is considered meaningless by many nfsv4 client (like the CITI one). we use maxcount instead */
   estimated_num_entries = maxcount / sizeof(entry4);
+  if(estimated_num_entries > sizeof(xattrs_tab) / sizeof(fsal_xattrent_t))
+    estimated_num_entries = sizeof(xattrs_tab) / sizeof(fsal_xattrent_t);
 
   LogFullDebug(COMPONENT_NFS_V4_XATTR,
                     "PSEUDOFS READDIR: dircount=%lu, maxcount=%lu, cookie=%"PRIu64", sizeof(entry4)=%lu num_entries=%lu",
@@ -1329,7 +1332,6 @@ int nfs4_op_readdir_xattr(struct nfs_argop4 *op,
           if(memcmp(cookie_verifier, arg_READDIR4.cookieverf, NFS4_VERIFIER_SIZE) != 0)
             {
               res_READDIR4.status = NFS4ERR_BAD_COOKIE;
-              Mem_Free(entry_nfs_array);
               return res_READDIR4.status;
             }
         }
@@ -1378,20 +1380,8 @@ int nfs4_op_readdir_xattr(struct nfs_argop4 *op,
     }
   else
     {
-      /* Allocation of reply structures */
-      if((entry_name_array =
-          (entry_name_array_item_t *) Mem_Alloc(estimated_num_entries *
-                                                (FSAL_MAX_NAME_LEN + 1))) == NULL)
-        {
-          LogError(COMPONENT_NFS_V4_XATTR, ERR_SYS, ERR_MALLOC, errno);
-          res_READDIR4.status = NFS4ERR_SERVERFAULT;
-          return res_READDIR4.status;
-        }
-      memset((char *)entry_name_array, 0,
-             estimated_num_entries * (FSAL_MAX_NAME_LEN + 1));
-
-      if((entry_nfs_array =
-          (entry4 *) Mem_Alloc(estimated_num_entries * sizeof(entry4))) == NULL)
+      /* Allocation of the reply, its size is bounded by maxcount */
+      if(nfs4_readdir_page_init(&page, nb_xattrs_read, maxcount) != 0)
         {
           LogError(COMPONENT_NFS_V4_XATTR, ERR_SYS, ERR_MALLOC, errno);
           res_READDIR4.status = NFS4ERR_SERVERFAULT;
@@ -1400,49 +1390,53 @@ int nfs4_op_readdir_xattr(struct nfs_argop4 *op,
 
       for(i = 0; i < nb_xattrs_read; i++)
         {
-          entry_nfs_array[i].name.utf8string_val = entry_name_array[i];
-
-          if(str2utf8(xattrs_tab[i].xattr_name.name, &entry_nfs_array[i].name) == -1)
-            {
-              res_READDIR4.status = NFS4ERR_SERVERFAULT;
-              return res_READDIR4.status;
-            }
-
-          /* Set the cookie value */
-          entry_nfs_array[i].cookie = cookie + i + 3;   /* 0, 1 and 2 are reserved */
-
           file_handle.xattr_pos = xattrs_tab[i].xattr_id + 2;
-          if(nfs4_XattrToFattr(&(entry_nfs_array[i].attrs),
+
+          /* The cookie value is cookie + i + 3: 0, 1 and 2 are reserved */
+          memset(&entry_attrs, 0, sizeof(entry_attrs));
+          if(nfs4_XattrToFattr(&entry_attrs,
                                data, &nfsfh, &(arg_READDIR4.attr_request)) != 0)
             {
               /* Return the fattr4_rdattr_error , cf RFC3530, page 192 */
-              entry_nfs_array[i].attrs.attrmask = RdAttrErrorBitmap;
-              entry_nfs_array[i].attrs.attr_vals = RdAttrErrorVals;
+              entry_attrs.attrmask = RdAttrErrorBitmap;
+              entry_attrs.attr_vals = RdAttrErrorVals;
+              entry = nfs4_readdir_page_add(&page, xattrs_tab[i].xattr_name.name,
+                                            cookie + i + 3, &entry_attrs);
+            }
+          else
+            {
+              /* The page keeps a copy of the attributes */
+              entry = nfs4_readdir_page_add(&page, xattrs_tab[i].xattr_name.name,
+                                            cookie + i + 3, &entry_attrs);
+              if(entry_attrs.attrmask.bitmap4_val != NULL)
+                Mem_Free(entry_attrs.attrmask.bitmap4_val);
+              if(entry_attrs.attr_vals.attrlist4_val != NULL)
+                Mem_Free(entry_attrs.attr_vals.attrlist4_val);
             }
 
-          /* Chain the entries together */
-          entry_nfs_array[i].nextentry = NULL;
-          if(i != 0)
-            entry_nfs_array[i - 1].nextentry = &(entry_nfs_array[i]);
-
-          /* This test is there to avoid going further than the buffer provided by the client 
-           * the factor "9/10" is there for safety. Its value could be change as beta tests will be done */
-          if((caddr_t)
-             ((caddr_t) (&entry_nfs_array[i]) - (caddr_t) (&entry_nfs_array[0])) >
-             (caddr_t) (maxcount * 9 / 10))
+          /* Stop before going further than the buffer provided by the client */
+          if(entry == NULL)
             break;
-
         }                       /* for */
 
+      /* Not even one entry fits in maxcount */
+      if(page.nb_entries == 0)
+        {
+          Mem_Free(page.entries);
+          res_READDIR4.status = NFS4ERR_TOOSMALL;
+          return res_READDIR4.status;
+        }
+
+      /* The end is not reached if the page got full */
+      if(i != nb_xattrs_read)
+        res_READDIR4.READDIR4res_u.resok4.reply.eof = FALSE;
+
+      res_READDIR4.READDIR4res_u.resok4.reply.entries = page.entries;
     }                           /* else */
 
   /* Build the reply */
   memcpy(res_READDIR4.READDIR4res_u.resok4.cookieverf, cookie_verifier,
          NFS4_VERIFIER_SIZE);
-  if(i == 0)
-    res_READDIR4.READDIR4res_u.resok4.reply.entries = NULL;
-  else
-    res_READDIR4.READDIR4res_u.resok4.reply.entries = entry_nfs_array;
 
   res_READDIR4.status = NFS4_OK;
 
@@ -427,24 +427,29 @@ void nfs_SetFailedStatus(fsal_op_context_t * pcontext,
 
 /**
  *
- * nfs4_FSALattr_To_Fattr: Converts FSAL Attributes to NFSv4 Fattr buffer.
- *
- * Converts FSAL Attributes to NFSv4 Fattr buffer.
- *
- * @param pexport [IN]  the related export entry.
- * @param pattr   [IN]  pointer to FSAL attributes.
- * @param Fattr   [OUT] NFSv4 Fattr buffer
- * @param data    [IN]  NFSv4 compoud request's data.
- * @param Bitmap  [OUT] NFSv4 attributes bitmap to the Fattr buffer.
+ * nfs4_FSALattr_To_Fattr_Common: Converts FSAL Attributes to NFSv4 Fattr buffer.
+ *
+ * Converts FSAL Attributes to NFSv4 Fattr buffer. The result bitmap and values are
+ * put in the buffers given by the caller, or allocated if they are NULL.
+ *
+ * @param pexport    [IN]  the related export entry.
+ * @param pattr      [IN]  pointer to FSAL attributes.
+ * @param Fattr      [OUT] NFSv4 Fattr buffer
+ * @param data       [IN]  NFSv4 compoud request's data.
+ * @param Bitmap     [OUT] NFSv4 attributes bitmap to the Fattr buffer.
+ * @param bitmap_buf [OUT] 2 words for the result bitmap, or NULL.
+ * @param vals_buf   [OUT] NFS4_ATTRVALS_BUFFLEN bytes for the values, or NULL.
  * 
  * @return -1 if failed, 0 if successful.
  *
  */
 
-int nfs4_FSALattr_To_Fattr(exportlist_t * pexport,
-                           fsal_attrib_list_t * pattr,
-                           fattr4 * Fattr,
-                           compound_data_t * data, nfs_fh4 * objFH, bitmap4 * Bitmap)
+static int nfs4_FSALattr_To_Fattr_Common(exportlist_t * pexport,
+                                         fsal_attrib_list_t * pattr,
+                                         fattr4 * Fattr,
+                                         compound_data_t * data, nfs_fh4 * objFH,
+                                         bitmap4 * Bitmap,
+                                         uint32_t * bitmap_buf, char *vals_buf)
 {
   fattr4_type file_type;
   fattr4_link_support link_support;
@@ -1550,8 +1555,10 @@ int nfs4_FSALattr_To_Fattr(exportlist_t * pexport,
     }                           /* for i */
 
   /* Set the bitmap for result */
-  if((Fattr->attrmask.bitmap4_val = (uint32_t *) Mem_Alloc_Label(2 * sizeof(uint32_t),
-                                                                 "FSALattr_To_Fattr:bitmap")) == NULL)
+  if(bitmap_buf != NULL)
+    Fattr->attrmask.bitmap4_val = bitmap_buf;
+  else if((Fattr->attrmask.bitmap4_val = (uint32_t *) Mem_Alloc_Label(2 * sizeof(uint32_t),
+                                                                      "FSALattr_To_Fattr:bitmap")) == NULL)
     return -1;
   memset((char *)Fattr->attrmask.bitmap4_val, 0, 2 * sizeof(uint32_t));
 
@@ -1559,7 +1566,13 @@ int nfs4_FSALattr_To_Fattr(exportlist_t * pexport,
 
   /* Set the attrlist4 */
   Fattr->attr_vals.attrlist4_len = LastOffset;
-  if(LastOffset != 0)           /* No need to allocate an empty buffer */
+  if(vals_buf != NULL)
+    {
+      Fattr->attr_vals.attrlist4_val = vals_buf;
+      memcpy(Fattr->attr_vals.attrlist4_val, attrvalsBuffer,
+             Fattr->attr_vals.attrlist4_len);
+    }
+  else if(LastOffset != 0)           /* No need to allocate an empty buffer */
     {
       if((Fattr->attr_vals.attrlist4_val =
           Mem_Alloc_Label(Fattr->attr_vals.attrlist4_len,
@@ -1572,8 +1585,171 @@ int nfs4_FSALattr_To_Fattr(exportlist_t * pexport,
   /* LastOffset contains the length of the attrvalsBuffer usefull data */
 
   return 0;
+}                               /* nfs4_FSALattr_To_Fattr_Common */
+
+/**
+ *
+ * nfs4_FSALattr_To_Fattr: Converts FSAL Attributes to NFSv4 Fattr buffer.
+ *
+ * Converts FSAL Attributes to NFSv4 Fattr buffer.
+ *
+ * @param pexport [IN]  the related export entry.
+ * @param pattr   [IN]  pointer to FSAL attributes.
+ * @param Fattr   [OUT] NFSv4 Fattr buffer, whose bitmap and values are allocated
+ * @param data    [IN]  NFSv4 compoud request's data.
+ * @param Bitmap  [OUT] NFSv4 attributes bitmap to the Fattr buffer.
+ * 
+ * @return -1 if failed, 0 if successful.
+ *
+ */
+
+int nfs4_FSALattr_To_Fattr(exportlist_t * pexport,
+                           fsal_attrib_list_t * pattr,
+                           fattr4 * Fattr,
+                           compound_data_t * data, nfs_fh4 * objFH, bitmap4 * Bitmap)
+{
+  return nfs4_FSALattr_To_Fattr_Common(pexport, pattr, Fattr, data, objFH, Bitmap,
+                                       NULL, NULL);
 }                               /* nfs4_FSALattr_To_Fattr */
 
+/**
+ *
+ * nfs4_FSALattr_To_Fattr_Buffer: Converts FSAL Attributes to NFSv4 Fattr buffer, without allocation.
+ *
+ * Converts FSAL Attributes to NFSv4 Fattr buffer. The Fattr points to the buffers
+ * given by the caller, which is used by the loops that convert many entries.
+ *
+ * @param pexport    [IN]  the related export entry.
+ * @param pattr      [IN]  pointer to FSAL attributes.
+ * @param Fattr      [OUT] NFSv4 Fattr buffer
+ * @param data       [IN]  NFSv4 compoud request's data.
+ * @param Bitmap     [OUT] NFSv4 attributes bitmap to the Fattr buffer.
+ * @param bitmap_buf [OUT] 2 words for the result bitmap.
+ * @param vals_buf   [OUT] NFS4_ATTRVALS_BUFFLEN bytes for the values.
+ * 
+ * @return -1 if failed, 0 if successful.
+ *
+ */
+
+int nfs4_FSALattr_To_Fattr_Buffer(exportlist_t * pexport,
+                                  fsal_attrib_list_t * pattr,
+                                  fattr4 * Fattr,
+                                  compound_data_t * data, nfs_fh4 * objFH,
+                                  bitmap4 * Bitmap, uint32_t * bitmap_buf, char *vals_buf)
+{
+  return nfs4_FSALattr_To_Fattr_Common(pexport, pattr, Fattr, data, objFH, Bitmap,
+                                       bitmap_buf, vals_buf);
+}                               /* nfs4_FSALattr_To_Fattr_Buffer */
+
+/**
+ *
+ * nfs4_readdir_page_init: Prepares the reply of a NFSv4 READDIR.
+ *
+ * The entries, their names and their attributes are all kept in a single block,
+ * whose size only depends on maxcount: nothing is allocated per entry, and
+ * nfs4_op_readdir_Free has only this block to release.
+ *
+ * @param ppage    [OUT] the page to initialize.
+ * @param nb_max   [IN]  the maximum number of entries.
+ * @param maxcount [IN]  the maxcount of the request (size of the READDIR4resok on the wire).
+ *
+ * @return 0 if successful, -1 if the block could not be allocated.
+ *
+ */
+
+int nfs4_readdir_page_init(nfs4_readdir_page_t * ppage, unsigned int nb_max,
+                           unsigned long maxcount)
+{
+  memset(ppage, 0, sizeof(nfs4_readdir_page_t));
+
+  if((ppage->entries =
+      (entry4 *) Mem_Alloc_Label(nb_max * sizeof(entry4) + maxcount,
+                                 "nfs4_readdir_page")) == NULL)
+    return -1;
+
+  ppage->nb_max = nb_max;
+  ppage->pool = (char *)(ppage->entries + nb_max);
+  ppage->pool_size = maxcount;
+  ppage->maxcount = maxcount;
+
+  /* status, cookieverf, the last value_follows and eof */
+  ppage->space_used = 5 * BYTES_PER_XDR_UNIT;
+
+  return 0;
+}                               /* nfs4_readdir_page_init */
+
+/**
+ *
+ * nfs4_readdir_page_add: Adds an entry to the reply of a NFSv4 READDIR.
+ *
+ * The name and the attributes are copied in the page, so the caller may reuse its
+ * buffers for the next entry. The entry is not added if its XDR encoding would make
+ * the reply go beyond maxcount.
+ *
+ * @param ppage  [INOUT] the page.
+ * @param name   [IN]    the entry name.
+ * @param cookie [IN]    the entry cookie.
+ * @param pattrs [IN]    the entry attributes.
+ *
+ * @return the new entry, or NULL if the page is full.
+ *
+ */
+
+entry4 *nfs4_readdir_page_add(nfs4_readdir_page_t * ppage, char *name,
+                              nfs_cookie4 cookie, fattr4 * pattrs)
+{
+  entry4 *pentry;
+  unsigned int namelen = strlen(name);
+  unsigned long xdr_size;
+  unsigned long pool_size;
+  unsigned int bitmap_size = pattrs->attrmask.bitmap4_len * sizeof(uint32_t);
+
+  if(ppage->nb_entries == ppage->nb_max)
+    return NULL;
+
+  /* value_follows, cookie, name, attrmask, attr_vals */
+  xdr_size = BYTES_PER_XDR_UNIT + 2 * BYTES_PER_XDR_UNIT
+      + BYTES_PER_XDR_UNIT + RNDUP(namelen)
+      + BYTES_PER_XDR_UNIT + bitmap_size
+      + BYTES_PER_XDR_UNIT + RNDUP(pattrs->attr_vals.attrlist4_len);
+
+  /* the name is kept '\0' terminated, everything stays aligned on XDR units */
+  pool_size = RNDUP(namelen + 1) + bitmap_size + RNDUP(pattrs->attr_vals.attrlist4_len);
+
+  if(ppage->space_used + xdr_size > ppage->maxcount ||
+     ppage->pool_used + pool_size > ppage->pool_size)
+    return NULL;
+
+  pentry = &ppage->entries[ppage->nb_entries];
+  pentry->cookie = cookie;
+  pentry->nextentry = NULL;
+
+  pentry->name.utf8string_len = namelen;
+  pentry->name.utf8string_val = ppage->pool + ppage->pool_used;
+  memcpy(pentry->name.utf8string_val, name, namelen + 1);
+  ppage->pool_used += RNDUP(namelen + 1);
+
+  pentry->attrs.attrmask.bitmap4_len = pattrs->attrmask.bitmap4_len;
+  pentry->attrs.attrmask.bitmap4_val = (uint32_t *) (ppage->pool + ppage->pool_used);
+  memcpy(pentry->attrs.attrmask.bitmap4_val, pattrs->attrmask.bitmap4_val, bitmap_size);
+  ppage->pool_used += bitmap_size;
+
+  pentry->attrs.attr_vals.attrlist4_len = pattrs->attr_vals.attrlist4_len;
+  pentry->attrs.attr_vals.attrlist4_val = ppage->pool + ppage->pool_used;
+  memcpy(pentry->attrs.attr_vals.attrlist4_val, pattrs->attr_vals.attrlist4_val,
+         pattrs->attr_vals.attrlist4_len);
+  ppage->pool_used += RNDUP(pattrs->attr_vals.attrlist4_len);
+
+  /* Chain the entries together */
+  if(ppage->nb_entries != 0)
+    ppage->entries[ppage->nb_entries - 1].nextentry = pentry;
+
+  ppage->nb_entries += 1;
+  ppage->space_used += xdr_size;
+
+  return pentry;
+}                               /* nfs4_readdir_page_add */
+
 /**
  *
  * nfs3_Sattr_To_FSALattr: Converts NFSv3 Sattr to FSAL Attributes.
@@ -41,6 +41,234 @@
 #include <string.h>
 #include "RW_Lock.h"
 
+/*
+ * The sequence of the lock is bumped by the writer when it gets the lock and
+ * when it releases it: it is odd while the writer is active. The barrier
+ * orders the bump with the writer's stores to the data the lock protects.
+ * It is only called by the writer, while it holds the lock.
+ */
+static void rw_lock_seq_write(rw_lock_t * plock)
+{
+  __sync_synchronize();
+  plock->seq++;
+  __sync_synchronize();
+}                               /* rw_lock_seq_write */
+
+/*
+ * Start a lockless read: returns the sequence to give to rw_lock_seq_retry
+ */
+unsigned int rw_lock_seq_begin(rw_lock_t * plock)
+{
+  unsigned int seq = plock->seq;
+
+  __sync_synchronize();
+
+  return seq;
+}                               /* rw_lock_seq_begin */
+
+/*
+ * End a lockless read: returns 1 if a writer was active at rw_lock_seq_begin
+ * or got the lock since then, meaning what was read may be inconsistent.
+ */
+int rw_lock_seq_retry(rw_lock_t * plock, unsigned int seq)
+{
+  __sync_synchronize();
+
+  return (seq & 1) || plock->seq != seq;
+}                               /* rw_lock_seq_retry */
+
+#ifdef __linux__
+
+#include <unistd.h>
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#ifndef FUTEX_PRIVATE_FLAG
+#define FUTEX_PRIVATE_FLAG 0
+#endif
+
+/*
+ * The lock state is a single word: the number of active readers, or
+ * RW_LOCK_WRITER when a writer holds the lock. P_r and V_r are a single
+ * atomic operation on it when nobody has to wait. Waiters sleep on one of
+ * two futexes, whose value is bumped before every wake up so that a wake
+ * up between the check of the state and the sleep is never lost.
+ */
+
+static void rw_futex_wait(volatile int *addr, int val)
+{
+  syscall(SYS_futex, addr, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, val, NULL, NULL, 0);
+}                               /* rw_futex_wait */
+
+static void rw_futex_wake(volatile int *addr, int nb)
+{
+  __sync_fetch_and_add(addr, 1);
+  syscall(SYS_futex, addr, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, nb, NULL, NULL, 0);
+}                               /* rw_futex_wake */
+
+/* Lets a writer go if the lock is free, or all the readers if no writer waits */
+static void rw_lock_wake(rw_lock_t * plock)
+{
+  if(plock->nbw_waiting > 0)
+    rw_futex_wake(&plock->seq_write, 1);
+  else if(plock->nbr_waiting > 0)
+    rw_futex_wake(&plock->seq_read, INT_MAX);
+}                               /* rw_lock_wake */
+
+/* A reader can go if no writer is active or waiting */
+static int rw_lock_try_read(rw_lock_t * plock)
+{
+  int state = plock->state;
+
+  if((state & RW_LOCK_WRITER) || plock->nbw_waiting > 0)
+    return 0;
+
+  return __sync_bool_compare_and_swap(&plock->state, state, state + 1);
+}                               /* rw_lock_try_read */
+
+/* 
+ * Take the lock for reading 
+ */
+int P_r(rw_lock_t * plock)
+{
+  int seq;
+
+  if(rw_lock_try_read(plock))
+    return 0;
+
+  __sync_fetch_and_add(&plock->nbr_waiting, 1);
+
+  for(;;)
+    {
+      seq = plock->seq_read;
+      __sync_synchronize();
+
+      if(rw_lock_try_read(plock))
+        break;
+
+      if((plock->state & RW_LOCK_WRITER) || plock->nbw_waiting > 0)
+        rw_futex_wait(&plock->seq_read, seq);
+    }
+
+  __sync_fetch_and_sub(&plock->nbr_waiting, 1);
+
+  return 0;
+}                               /* P_r */
+
+/*
+ * Release the lock after reading 
+ */
+int V_r(rw_lock_t * plock)
+{
+  /* The last active reader lets a waiting writer go */
+  if(__sync_sub_and_fetch(&plock->state, 1) == 0 && plock->nbw_waiting > 0)
+    rw_futex_wake(&plock->seq_write, 1);
+
+  return 0;
+}                               /* V_r */
+
+/*
+ * Take the lock for writting 
+ */
+int P_w(rw_lock_t * plock)
+{
+  int seq;
+
+  if(__sync_bool_compare_and_swap(&plock->state, 0, RW_LOCK_WRITER))
+    {
+      rw_lock_seq_write(plock);
+      return 0;
+    }
+
+  __sync_fetch_and_add(&plock->nbw_waiting, 1);
+
+  for(;;)
+    {
+      seq = plock->seq_write;
+      __sync_synchronize();
+
+      if(__sync_bool_compare_and_swap(&plock->state, 0, RW_LOCK_WRITER))
+        break;
+
+      rw_futex_wait(&plock->seq_write, seq);
+    }
+
+  __sync_fetch_and_sub(&plock->nbw_waiting, 1);
+
+  rw_lock_seq_write(plock);
+
+  return 0;
+}                               /* P_w */
+
+/*
+ * Release the lock after writting 
+ */
+int V_w(rw_lock_t * plock)
+{
+  rw_lock_seq_write(plock);
+
+  __sync_fetch_and_sub(&plock->state, RW_LOCK_WRITER);
+
+  rw_lock_wake(plock);
+
+  return 0;
+}                               /* V_w */
+
+/*
+ * Take the lock for writting if nobody holds it, without waiting.
+ * Returns 0 if the lock was taken, 1 otherwise.
+ */
+int rw_lock_try_w(rw_lock_t * plock)
+{
+  if(!__sync_bool_compare_and_swap(&plock->state, 0, RW_LOCK_WRITER))
+    return 1;
+
+  rw_lock_seq_write(plock);
+
+  return 0;
+}                               /* rw_lock_try_w */
+
+/* Roughly, downgrading a writer lock is making a V_w atomically followed by a P_r */
+int rw_lock_downgrade(rw_lock_t * plock)
+{
+  rw_lock_seq_write(plock);
+
+  /* Nobody else changes the state while a writer is active */
+  __sync_fetch_and_sub(&plock->state, RW_LOCK_WRITER - 1);
+
+  /* Waiting readers may go along with the caller, unless writers are waiting */
+  if(plock->nbr_waiting > 0 && plock->nbw_waiting == 0)
+    rw_futex_wake(&plock->seq_read, INT_MAX);
+
+  return 0;
+}                               /* rw_lock_downgrade */
+
+/*
+ * Routine for initializing a lock
+ */
+int rw_lock_init(rw_lock_t * plock)
+{
+  memset(plock, 0, sizeof(rw_lock_t));
+
+  return 0;
+}                               /* rw_lock_init */
+
+/*
+ * Routine for destroying a lock
+ */
+int rw_lock_destroy(rw_lock_t * plock)
+{
+  if(plock->state != 0)
+    return 1;
+
+  memset(plock, 0, sizeof(rw_lock_t));
+
+  return 0;
+}                               /* rw_lock_destroy */
+
+#else                           /* __linux__ */
+
 /*
  * Debugging function
  */
@@ -123,6 +351,7 @@ int P_w(rw_lock_t * plock)
   /* I become active and no more waiting */
   plock->nbw_waiting--;
   plock->nbw_active++;
+  rw_lock_seq_write(plock);
 
   V(plock->mutexProtect);
 
@@ -140,6 +369,7 @@ int V_w(rw_lock_t * plock)
   print_lock("V_w.1", plock);
 
   /* I was the active writter, I am not it any more */
+  rw_lock_seq_write(plock);
   plock->nbw_active--;
 
   if(plock->nbw_waiting > 0)
@@ -169,6 +399,28 @@ int V_w(rw_lock_t * plock)
   return 0;
 }                               /* V_w */
 
+/*
+ * Take the lock for writting if nobody holds it, without waiting.
+ * Returns 0 if the lock was taken, 1 otherwise.
+ */
+int rw_lock_try_w(rw_lock_t * plock)
+{
+  int rc = 1;
+
+  P(plock->mutexProtect);
+
+  if(plock->nbr_active == 0 && plock->nbw_active == 0)
+    {
+      plock->nbw_active++;
+      rw_lock_seq_write(plock);
+      rc = 0;
+    }
+
+  V(plock->mutexProtect);
+
+  return rc;
+}                               /* rw_lock_try_w */
+
 /* Roughly, downgrading a writer lock is making a V_w atomically followed by a P_r */
 int rw_lock_downgrade(rw_lock_t * plock)
 {
@@ -177,6 +429,7 @@ int rw_lock_downgrade(rw_lock_t * plock)
   print_lock("downgrade.1", plock);
 
   /* I was the active writter, I am not it any more */
+  rw_lock_seq_write(plock);
   plock->nbw_active--;
 
   if(plock->nbr_waiting > 0)
@@ -229,6 +482,8 @@ int rw_lock_init(rw_lock_t * plock)
   plock->nbw_waiting = 0;
   plock->nbw_active = 0;
 
+  plock->seq = 0;
+
   return 0;
 }                               /* rw_lock_init */
 
@@ -251,3 +506,5 @@ int rw_lock_destroy(rw_lock_t * plock)
 
   return 0;
 }                               /* rw_lock_init */
+
+#endif                          /* __linux__ */
@@ -37,6 +37,7 @@
 #include <errno.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
 #include "RW_Lock.h"
 #include "log_macros.h"
 
@@ -82,6 +83,93 @@ void *thread_reader(void *arg)
   return NULL;
 }                               /* thread_writter */
 
+/*
+ * Contention benchmark: test_rw -b [nb_threads] [write_percent]
+ * Each thread takes the lock in a loop for BENCH_DURATION seconds, as a
+ * writer for write_percent of the iterations and as a reader otherwise.
+ */
+#define BENCH_DURATION 5
+#define BENCH_MAX_THREADS 256
+
+volatile int bench_stop = 0;
+int bench_write_percent = 0;
+volatile int bench_writers_in = 0;
+volatile int bench_readers_in = 0;
+int bench_errors = 0;
+unsigned long long bench_ops[BENCH_MAX_THREADS];
+
+void *thread_bench(void *arg)
+{
+  unsigned long index = (unsigned long)arg;
+  unsigned int seed = index;
+  unsigned long long nb_ops = 0;
+
+  while(!bench_stop)
+    {
+      if((rand_r(&seed) % 100) < bench_write_percent)
+        {
+          P_w(&lock);
+          if(__sync_add_and_fetch(&bench_writers_in, 1) != 1 || bench_readers_in != 0)
+            bench_errors++;
+          __sync_sub_and_fetch(&bench_writers_in, 1);
+          V_w(&lock);
+        }
+      else
+        {
+          P_r(&lock);
+          __sync_add_and_fetch(&bench_readers_in, 1);
+          if(bench_writers_in != 0)
+            bench_errors++;
+          __sync_sub_and_fetch(&bench_readers_in, 1);
+          V_r(&lock);
+        }
+      nb_ops++;
+    }
+
+  bench_ops[index] = nb_ops;
+  return NULL;
+}                               /* thread_bench */
+
+int bench(int nb_threads)
+{
+  pthread_t thrid[BENCH_MAX_THREADS];
+  unsigned long long total = 0;
+  unsigned long i;
+
+  if(nb_threads <= 0 || nb_threads > BENCH_MAX_THREADS)
+    nb_threads = 4;
+
+  rw_lock_init(&lock);
+
+  for(i = 0; i < nb_threads; i++)
+    if(pthread_create(&thrid[i], NULL, thread_bench, (void *)i) != 0)
+      {
+        LogTest("RW_Lock bench FAILED: Bad allocation thread");
+        return 1;
+      }
+
+  sleep(BENCH_DURATION);
+  bench_stop = 1;
+
+  for(i = 0; i < nb_threads; i++)
+    {
+      pthread_join(thrid[i], NULL);
+      total += bench_ops[i];
+    }
+
+  LogTest("RW_Lock bench: %d threads, %d%% writers: %llu lock/unlock per second (%llu per thread)",
+          nb_threads, bench_write_percent, total / BENCH_DURATION,
+          total / BENCH_DURATION / nb_threads);
+
+  if(bench_errors != 0)
+    {
+      LogTest("RW_Lock bench FAILED: %d exclusion errors", bench_errors);
+      return 1;
+    }
+
+  return 0;
+}                               /* bench */
+
 int main(int argc, char *argv[])
 {
   SetDefaultLogging("TEST");
@@ -92,6 +180,13 @@ int main(int argc, char *argv[])
   int i;
   int rc;
 
+  if(argc > 1 && !strcmp(argv[1], "-b"))
+    {
+      if(argc > 3)
+        bench_write_percent = atoi(argv[3]);
+      exit(bench((argc > 2) ? atoi(argv[2]) : 4));
+    }
+
   pthread_attr_init(&attr_thr);
   pthread_attr_setscope(&attr_thr, PTHREAD_SCOPE_SYSTEM);
   pthread_attr_setdetachstate(&attr_thr, PTHREAD_CREATE_JOINABLE);
@@ -0,0 +1,265 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ *
+ * Micro-benchmark of the XDR routines of the two biggest replies:
+ *   READDIRPLUS3res : NB_ENTRIES entries, each with attributes and handle
+ *   COMPOUND4res    : PUTFH, LOOKUP, GETFH, GETATTR (ATTR_VALS_LEN bytes)
+ * Each is encoded in a per-thread buffer, and decoded from the bytes of a
+ * first encoding into a structure that is xdr_free'd afterwards.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef _SOLARIS
+#include "solaris_port.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _USE_GSSRPC
+#include <gssrpc/types.h>
+#include <gssrpc/rpc.h>
+#else
+#include <rpc/types.h>
+#include <rpc/rpc.h>
+#endif
+#include "nfs23.h"
+#include "nfs4.h"
+#include "BenchStats.h"
+#include "log_macros.h"
+
+#define DEFAULT_OPS    100000
+#define NB_ENTRIES     32
+#define FH_LEN         32
+#define ATTR_VALS_LEN  128
+#define XDR_BUFF_SIZE  65536
+
+typedef struct bench_xdr_arg__
+{
+  xdrproc_t proc;
+  void *res;                    /* structure to encode */
+  size_t res_size;
+  char *encoded;                /* bytes to decode */
+  unsigned int encoded_len;
+  char **buffers;               /* one encoding buffer per thread */
+} bench_xdr_arg_t;
+
+static READDIRPLUS3res readdirplus_res;
+static entryplus3 entries[NB_ENTRIES];
+static char names[NB_ENTRIES][16];
+static char handles[NB_ENTRIES][FH_LEN];
+
+static COMPOUND4res compound_res;
+static nfs_resop4 resops[4];
+static char compound_fh[FH_LEN];
+static uint32_t attrmask[2] = { 0x0010011a, 0x00b0a23a };
+static char attr_vals[ATTR_VALS_LEN];
+
+static void build_readdirplus(void)
+{
+  READDIRPLUS3resok *resok = &readdirplus_res.READDIRPLUS3res_u.resok;
+  fattr3 attr;
+  int i;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.type = NF3REG;
+  attr.mode = 0644;
+  attr.nlink = 1;
+  attr.size = 4096;
+  attr.used = 4096;
+  attr.fsid = 1;
+  attr.atime.seconds = attr.mtime.seconds = attr.ctime.seconds = 1234567890;
+
+  readdirplus_res.status = NFS3_OK;
+  resok->dir_attributes.attributes_follow = TRUE;
+  resok->dir_attributes.post_op_attr_u.attributes = attr;
+  resok->dir_attributes.post_op_attr_u.attributes.type = NF3DIR;
+  memset(resok->cookieverf, 0, sizeof(cookieverf3));
+  resok->reply.entries = &entries[0];
+  resok->reply.eof = TRUE;
+
+  for(i = 0; i < NB_ENTRIES; i++)
+    {
+      snprintf(names[i], sizeof(names[i]), "file.%d", i);
+      memset(handles[i], i, FH_LEN);
+
+      entries[i].fileid = i + 3;
+      entries[i].name = names[i];
+      entries[i].cookie = i + 3;
+      entries[i].name_attributes.attributes_follow = TRUE;
+      entries[i].name_attributes.post_op_attr_u.attributes = attr;
+      entries[i].name_attributes.post_op_attr_u.attributes.fileid = i + 3;
+      entries[i].name_handle.handle_follows = TRUE;
+      entries[i].name_handle.post_op_fh3_u.handle.data.data_len = FH_LEN;
+      entries[i].name_handle.post_op_fh3_u.handle.data.data_val = handles[i];
+      entries[i].nextentry = (i + 1 < NB_ENTRIES) ? &entries[i + 1] : NULL;
+    }
+}                               /* build_readdirplus */
+
+static void build_compound(void)
+{
+  GETATTR4resok *getattr;
+
+  memset(compound_fh, 0x5a, FH_LEN);
+  memset(attr_vals, 0xa5, ATTR_VALS_LEN);
+  memset(resops, 0, sizeof(resops));
+
+  compound_res.status = NFS4_OK;
+  compound_res.tag.utf8string_len = 0;
+  compound_res.tag.utf8string_val = NULL;
+  compound_res.resarray.resarray_len = 4;
+  compound_res.resarray.resarray_val = resops;
+
+  resops[0].resop = NFS4_OP_PUTFH;
+  resops[0].nfs_resop4_u.opputfh.status = NFS4_OK;
+
+  resops[1].resop = NFS4_OP_LOOKUP;
+  resops[1].nfs_resop4_u.oplookup.status = NFS4_OK;
+
+  resops[2].resop = NFS4_OP_GETFH;
+  resops[2].nfs_resop4_u.opgetfh.status = NFS4_OK;
+  resops[2].nfs_resop4_u.opgetfh.GETFH4res_u.resok4.object.nfs_fh4_len = FH_LEN;
+  resops[2].nfs_resop4_u.opgetfh.GETFH4res_u.resok4.object.nfs_fh4_val = compound_fh;
+
+  resops[3].resop = NFS4_OP_GETATTR;
+  resops[3].nfs_resop4_u.opgetattr.status = NFS4_OK;
+  getattr = &resops[3].nfs_resop4_u.opgetattr.GETATTR4res_u.resok4;
+  getattr->obj_attributes.attrmask.bitmap4_len = 2;
+  getattr->obj_attributes.attrmask.bitmap4_val = attrmask;
+  getattr->obj_attributes.attr_vals.attrlist4_len = ATTR_VALS_LEN;
+  getattr->obj_attributes.attr_vals.attrlist4_val = attr_vals;
+}                               /* build_compound */
+
+static int bench_encode(void *arg, unsigned int thread, unsigned long long iter)
+{
+  bench_xdr_arg_t *p_arg = (bench_xdr_arg_t *) arg;
+  XDR xdrs;
+  int rc;
+
+  xdrmem_create(&xdrs, p_arg->buffers[thread], XDR_BUFF_SIZE, XDR_ENCODE);
+  rc = (*p_arg->proc) (&xdrs, p_arg->res);
+  xdr_destroy(&xdrs);
+
+  return rc ? 0 : -1;
+}
+
+static int bench_decode(void *arg, unsigned int thread, unsigned long long iter)
+{
+  bench_xdr_arg_t *p_arg = (bench_xdr_arg_t *) arg;
+  char res[sizeof(READDIRPLUS3res) > sizeof(COMPOUND4res) ?
+           sizeof(READDIRPLUS3res) : sizeof(COMPOUND4res)];
+  XDR xdrs;
+  int rc;
+
+  memset(res, 0, p_arg->res_size);
+
+  xdrmem_create(&xdrs, p_arg->encoded, p_arg->encoded_len, XDR_DECODE);
+  rc = (*p_arg->proc) (&xdrs, res);
+  xdr_destroy(&xdrs);
+
+  xdr_free(p_arg->proc, res);
+
+  return rc ? 0 : -1;
+}
+
+static int bench_prepare(bench_xdr_arg_t * p_arg, unsigned int max_threads)
+{
+  XDR xdrs;
+  unsigned int i;
+
+  if((p_arg->buffers = calloc(max_threads, sizeof(char *))) == NULL)
+    return -1;
+
+  for(i = 0; i < max_threads; i++)
+    if((p_arg->buffers[i] = malloc(XDR_BUFF_SIZE)) == NULL)
+      return -1;
+
+  if((p_arg->encoded = malloc(XDR_BUFF_SIZE)) == NULL)
+    return -1;
+
+  xdrmem_create(&xdrs, p_arg->encoded, XDR_BUFF_SIZE, XDR_ENCODE);
+  if(!(*p_arg->proc) (&xdrs, p_arg->res))
+    return -1;
+  p_arg->encoded_len = xdr_getpos(&xdrs);
+  xdr_destroy(&xdrs);
+
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  bench_options_t options;
+  bench_xdr_arg_t readdirplus_arg;
+  bench_xdr_arg_t compound_arg;
+  unsigned int t;
+  int rc = 0;
+
+  bench_def_t benches[] = {
+    {"xdr_READDIRPLUS3res_encode", bench_encode, NULL, NULL, &readdirplus_arg},
+    {"xdr_READDIRPLUS3res_decode", bench_decode, NULL, NULL, &readdirplus_arg},
+    {"xdr_COMPOUND4res_encode", bench_encode, NULL, NULL, &compound_arg},
+    {"xdr_COMPOUND4res_decode", bench_decode, NULL, NULL, &compound_arg},
+    {NULL, NULL, NULL, NULL, NULL}
+  };
+  bench_def_t *p_bench;
+
+  SetDefaultLogging("TEST");
+  SetNamePgm("bench_xdr");
+
+  if((rc = BenchStats_GetOptions(argc, argv, DEFAULT_OPS, &options)) != 0)
+    exit(rc > 0 ? 0 : 1);
+
+  build_readdirplus();
+  build_compound();
+
+  readdirplus_arg.proc = (xdrproc_t) xdr_READDIRPLUS3res;
+  readdirplus_arg.res = &readdirplus_res;
+  readdirplus_arg.res_size = sizeof(READDIRPLUS3res);
+
+  compound_arg.proc = (xdrproc_t) xdr_COMPOUND4res;
+  compound_arg.res = &compound_res;
+  compound_arg.res_size = sizeof(COMPOUND4res);
+
+  if(bench_prepare(&readdirplus_arg, options.max_threads) != 0 ||
+     bench_prepare(&compound_arg, options.max_threads) != 0)
+    {
+      LogTest("bench_xdr: could not encode the sample replies");
+      exit(1);
+    }
+
+  BenchStats_Begin(&options, "XDR");
+
+  for(t = 0; t < options.nb_thread_counts; t++)
+    for(p_bench = benches; p_bench->name != NULL; p_bench++)
+      if(BenchStats_Run(&options, p_bench, options.thread_counts[t]) != 0)
+        rc = 1;
+
+  BenchStats_End(&options);
+
+  exit(rc);
+}
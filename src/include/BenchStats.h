@@ -0,0 +1,93 @@
+/*
+ * Header of the micro-benchmark tools
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ *
+ * A benchmark is an operation called nb_ops times by each of nb_threads
+ * threads. Every call is timed and goes in a log-linear latency histogram
+ * (32 linear sub-buckets per power of 2, as HDR histograms do), so that
+ * percentiles are known within 3%. The results of a suite are printed as
+ * one JSON document, whose (suite, bench, threads) keys are stable from
+ * one commit to the next.
+ *
+ */
+
+#ifndef _BENCHSTATS_H
+#define _BENCHSTATS_H
+
+#include <stdio.h>
+
+#define BENCH_HIST_SUB_BITS  5
+#define BENCH_HIST_SUB       (1 << BENCH_HIST_SUB_BITS)
+#define BENCH_HIST_MAX_BITS  40 /* latencies up to 2^40 ns (18 minutes) */
+#define BENCH_HIST_SIZE      ((BENCH_HIST_MAX_BITS - BENCH_HIST_SUB_BITS + 1) * BENCH_HIST_SUB)
+
+#define BENCH_MAX_THREAD_COUNTS 16
+
+typedef struct bench_stat__
+{
+  unsigned long long count;
+  unsigned long long errors;
+  unsigned long long sum_ns;
+  unsigned long long min_ns;
+  unsigned long long max_ns;
+  unsigned long long hist[BENCH_HIST_SIZE];
+} bench_stat_t;
+
+/* one timed operation: returns 0 if it succeeded */
+typedef int (*bench_op_t) (void *arg, unsigned int thread, unsigned long long iter);
+
+/* called by each thread around its timed loop (not timed) */
+typedef int (*bench_thread_func_t) (void *arg, unsigned int thread);
+
+typedef struct bench_def__
+{
+  char *name;
+  bench_op_t op;
+  bench_thread_func_t thread_init;      /* may be NULL */
+  bench_thread_func_t thread_fini;      /* may be NULL */
+  void *arg;
+} bench_def_t;
+
+typedef struct bench_options__
+{
+  unsigned int thread_counts[BENCH_MAX_THREAD_COUNTS];
+  unsigned int nb_thread_counts;
+  unsigned int max_threads;
+  unsigned long long nb_ops;    /* per thread */
+  FILE *output;
+  unsigned int nb_results;      /* already printed in the current suite */
+} bench_options_t;
+
+unsigned long long BenchStats_Now(void);
+void BenchStats_Record(bench_stat_t * p_stat, unsigned long long ns, int is_error);
+void BenchStats_Merge(bench_stat_t * p_to, bench_stat_t * p_from);
+unsigned long long BenchStats_Percentile(bench_stat_t * p_stat, double percent);
+
+int BenchStats_GetOptions(int argc, char **argv, unsigned long long default_nb_ops,
+                          bench_options_t * p_options);
+void BenchStats_Begin(bench_options_t * p_options, char *suite);
+int BenchStats_Run(bench_options_t * p_options, bench_def_t * p_bench,
+                   unsigned int nb_threads);
+void BenchStats_End(bench_options_t * p_options);
+
+#endif                          /* _BENCHSTATS_H */
@@ -137,6 +137,23 @@ typedef struct buddy_paremeter__
    */
   unsigned int keep_minimum;
 
+  /* Mean number of bytes allocated between two
+   * blocks sampled by the allocation profiler.
+   * 0 disables the profiler.
+   */
+  size_t profile_sample_rate;
+
+  /* Minimum delay between two BuddyTrim calls
+   * giving the free pages back to the OS, in seconds.
+   * 0 never gives them back.
+   */
+  unsigned int trim_delay;
+
+  /* Standard pages are aligned and backed by transparent
+   * hugepages, when they are at least 2MB large.
+   */
+  int use_hugepages;
+
 } buddy_parameter_t;
 
 /**
@@ -228,6 +245,9 @@ typedef struct buddy_stats__
   unsigned int NbExtraPages;    /* Number of extra pages (current) */
   unsigned int WM_NbExtraPages; /* Watermark of extra pages */
 
+  size_t StdReleasedSpace;      /* Free space of std pages given back to the OS
+                                 * (resident = TotalMemSpace - StdReleasedSpace) */
+
 } buddy_stats_t;
 
 /**
@@ -235,6 +255,86 @@ typedef struct buddy_stats__
  */
 void BuddyGetStats(buddy_stats_t * budd_stats);
 
+/**
+ *  Gives the free pages of the current thread back to the OS,
+ *  if trim_delay seconds passed since the last time, or at once
+ *  if force is TRUE (trim_delay = 0 still never gives them back).
+ *  Returns the number of bytes given back.
+ */
+size_t BuddyTrim(int force);
+
+/**
+ * Sampled allocation profiler.
+ * About one block per profile_sample_rate allocated bytes is sampled,
+ * and counted for its call site as if it stood for max(size, rate) bytes.
+ * The sites are identified by their file, line and label, and keep
+ * their index (sites[] of a snapshot) for the life of the process.
+ */
+#define BUDDY_PROFILE_NB_SITES   1024   /* power of 2 */
+#define BUDDY_PROFILE_LABEL_LEN  32
+
+typedef struct buddy_profile_site__
+{
+  const char *file;             /* NULL if the slot is not used */
+  unsigned int line;
+  char label[BUDDY_PROFILE_LABEL_LEN];
+  unsigned long long nb_alloc;          /* estimated, cumulative */
+  unsigned long long nb_free;           /* estimated, cumulative */
+  unsigned long long alloc_bytes;       /* estimated, cumulative */
+  unsigned long long free_bytes;        /* estimated, cumulative */
+} buddy_profile_site_t;
+
+typedef struct buddy_profile_snapshot__
+{
+  time_t when;
+  size_t sample_rate;
+  unsigned int nb_sites;        /* sites[0] is not used */
+  buddy_profile_site_t sites[BUDDY_PROFILE_NB_SITES];
+} buddy_profile_snapshot_t;
+
+#define BuddyProfileLiveBytes( _psite_ ) ( (_psite_)->alloc_bytes - (_psite_)->free_bytes )
+
+void BuddySetProfileRate(size_t sample_rate);
+size_t BuddyGetProfileRate();
+
+BUDDY_ADDR_T BuddyMalloc_Sampled(size_t sz, const char *file, unsigned int line,
+                                 const char *label);
+
+BUDDY_ADDR_T BuddyCalloc_Sampled(size_t NumberOfElements, size_t ElementSize,
+                                 const char *file, unsigned int line, const char *label);
+
+BUDDY_ADDR_T BuddyRealloc_Sampled(BUDDY_ADDR_T ptr, size_t Size,
+                                  const char *file, unsigned int line, const char *label);
+
+/* Used by BuddyMalloc when a block is sampled, and when it is freed */
+unsigned int BuddyProfileRecordAlloc(const char *file, unsigned int line,
+                                     const char *label, size_t size, size_t weight);
+void BuddyProfileRecordFree(unsigned int site, size_t size, size_t weight);
+
+/**
+ * Copies the counters of all the sites.
+ */
+void BuddyProfileSnapshot(buddy_profile_snapshot_t * psnap);
+
+/**
+ * What was allocated and freed between two snapshots (pold may be NULL).
+ * The live bytes of pdiff are the growth of each site.
+ */
+void BuddyProfileDiff(buddy_profile_snapshot_t * pold,
+                      buddy_profile_snapshot_t * pnew, buddy_profile_snapshot_t * pdiff);
+
+/**
+ * Indexes of the nb sites having the most live bytes (or allocated
+ * bytes if by_alloc), in decreasing order. Returns how many were found.
+ */
+unsigned int BuddyProfileTop(buddy_profile_snapshot_t * psnap, int by_alloc,
+                             unsigned int *indexes, unsigned int nb);
+
+/**
+ * Prints a site as label@file:line live_bytes alloc_bytes free_bytes nb_alloc nb_free
+ */
+int BuddyProfileSprintSite(char *str, size_t size, buddy_profile_site_t * psite);
+
 #ifdef _DEBUG_MEMLEAKS
 
 /**
@@ -57,28 +57,6 @@
 /* prefered readdir size */
 #define FSAL_READDIR_SIZE 2048
 
-/** object name.  */
-
-typedef struct fsal_name__
-{
-  char name[FSAL_MAX_NAME_LEN];
-  unsigned int len;
-} fsal_name_t;
-
-/** object path.  */
-
-typedef struct fsal_path__
-{
-  char path[FSAL_MAX_PATH_LEN];
-  unsigned int len;
-} fsal_path_t;
-
-#define FSAL_NAME_INITIALIZER {"",0}
-#define FSAL_PATH_INITIALIZER {"",0}
-
-static fsal_name_t FSAL_DOT = { ".", 1 };
-static fsal_name_t FSAL_DOT_DOT = { "..", 2 };
-
 typedef GHOSTFS_handle_t fsal_handle_t;    /**< FS object handle.            */
 
 /** Authentification context.    */
@@ -112,6 +90,14 @@ typedef struct fs_specific_initinfo__
 
   ghostfs_dir_def_t *dir_list;
 
+  /* injected latency (microseconds) and bandwidth (MB/s, 0 = unlimited) */
+  unsigned int latency_meta_read;
+  unsigned int latency_meta_write;
+  unsigned int latency_data_read;
+  unsigned int latency_data_write;
+  unsigned int bandwidth_read;
+  unsigned int bandwidth_write;
+
 } fs_specific_initinfo_t;
 
 /**< directory cookie */
@@ -121,7 +107,7 @@ typedef struct fsal_cookie__
   GHOSTFS_cookie_t cookie;
 } fsal_cookie_t;
 
-static fsal_cookie_t FSAL_READDIR_FROM_BEGINNING = { (GHOSTFS_cookie_t) NULL };
+static fsal_cookie_t FSAL_READDIR_FROM_BEGINNING = { (GHOSTFS_cookie_t) 0 };
 
 typedef void *fsal_lockdesc_t;   /**< not implemented in ghostfs */
 typedef void *fsal_export_context_t;
@@ -144,7 +130,12 @@ typedef struct fsal_dir__
   fsal_op_context_t context;    /* credential for readdir operations */
 } fsal_dir_t;
 
-typedef void *fsal_file_t;      /**< not implemented in ghostfs */
+typedef struct fsal_file__
+{
+  GHOSTFS_handle_t handle;      /* the opened file */
+  fsal_ushort_t openflags;      /* FSAL_O_* flags given to FSAL_open */
+  fsal_off_t current_offset;    /* for FSAL_SEEK_CUR */
+} fsal_file_t;
 
 /* no fd in ghostfs for the moment */
 //#define FSAL_FILENO( p_fsal_file )  ( 1 )
@@ -29,7 +29,7 @@
  * \date    $Date: 2005/11/28 17:03:23 $
  * \version $Revision: 1.17 $
  * \brief   Interface of a very simple file system in memory,
- *          used for basic tests.
+ *          used for basic tests and as a benchmark backend.
  *          Thread-safe.
  *
  */
@@ -45,6 +45,15 @@
 #define GHOSTFS_MAX_FILENAME    256
 #define GHOSTFS_MAX_PATH        1024
 
+/* File data is kept in blocks of this size, holes are not allocated */
+#define GHOSTFS_BLOCK_SIZE      65536
+
+/* Maximum file size (bounds the size of the block table of a file) */
+#define GHOSTFS_MAX_FILESIZE    (1ULL << 40)
+
+/* Initial size of the name index of a directory (grows with it) */
+#define GHOSTFS_DIR_HASH_SIZE   16
+
 /* types */
 
 /** link count type */
@@ -99,8 +108,21 @@ typedef struct GHOSTFS_parameter__
   int dot_dot_root_eq_root;
   int root_access;
 
+  /* latency injected in each operation class, in microseconds */
+  unsigned int latency_meta_read;       /* lookup, getattr, access, readlink, opendir */
+  unsigned int latency_meta_write;      /* setattr, create, mkdir, link, symlink, unlink, rename, truncate */
+  unsigned int latency_data_read;       /* read */
+  unsigned int latency_data_write;      /* write */
+
+  /* bandwidth of data transfers, in MB/s (0 = unlimited) */
+  unsigned int bandwidth_read;
+  unsigned int bandwidth_write;
+
 } GHOSTFS_parameter_t;
 
+/** Position of an entry in a directory (0 = beginning of the directory) */
+typedef unsigned long long GHOSTFS_cookie_t;
+
 /* ********* INTERNAL DATA TYPES ************** */
 
 /** List of the entries of a directory */
@@ -109,25 +131,41 @@ typedef struct GHOSTFS_dirlist__
 
   GHOSTFS_handle_t handle;
   char name[GHOSTFS_MAX_FILENAME];
+  GHOSTFS_cookie_t cookie;      /* increases along the list */
+
   struct GHOSTFS_dirlist__ *next;
+  struct GHOSTFS_dirlist__ *prev;
+
+  struct GHOSTFS_dirlist__ *hash_next;  /* next entry in the same bucket */
 
 } GHOSTFS_dirlist_t;
 
 /** Directory metadatas */
 typedef struct GHOSTFS_dir__
 {
-  /* directory content */
+  /* directory content, in insertion order */
   GHOSTFS_dirlist_t *direntries;
 
   /* used for insertion */
   GHOSTFS_dirlist_t *lastentry;
 
+  /* name index */
+  GHOSTFS_dirlist_t **hash_tab;
+  unsigned int hash_size;
+  unsigned int nb_entries;
+
+  /* cookie of the last inserted entry */
+  GHOSTFS_cookie_t last_cookie;
+
 } GHOSTFS_dir_t;
 
 /** File metadatas */
 typedef struct GHOSTFS_file__
 {
-  int unused;
+  /* data blocks of GHOSTFS_BLOCK_SIZE bytes, NULL for holes */
+  caddr_t *blocks;
+  unsigned int nb_blocks;       /* size of the blocks table */
+  unsigned int nb_allocated;    /* number of non NULL blocks */
 } GHOSTFS_file_t;
 
 /** Symlink metadatas */
@@ -170,6 +208,8 @@ typedef struct GHOSTFS_item__
 
   GHOSTFS_metadata_t attributes;        /* attributes of this element */
 
+  struct GHOSTFS_item__ *next_free;     /* next item in the free list */
+
   union
   {
 
@@ -202,8 +242,6 @@ typedef struct GHOSTFS_stats__
  *  Output data types
  */
 
-typedef GHOSTFS_dirlist_t *GHOSTFS_cookie_t;
-
 /** Entry in a directory */
 typedef struct GHOSTFS_dirent__
 {
@@ -229,6 +267,7 @@ typedef struct GHOSTFS_Attrs__
   GHOSTFS_time_t ctime;
   GHOSTFS_time_t creationTime;
   GHOSTFS_size_t size;
+  GHOSTFS_size_t spaceused;
 
 } GHOSTFS_Attrs_t;
 
@@ -281,6 +320,25 @@ int GHOSTFS_Access(GHOSTFS_handle_t handle,
                    GHOSTFS_testperm_t test_set,
                    GHOSTFS_user_t userid, GHOSTFS_group_t groupid);
 
+/** Reads data from a file.
+ *  Holes and data beyond the end of file read as zeros.
+ */
+int GHOSTFS_Read(GHOSTFS_handle_t handle,
+                 GHOSTFS_size_t offset,
+                 GHOSTFS_size_t size,
+                 caddr_t buffer, GHOSTFS_size_t * p_read_size, int *p_end_of_file);
+
+/** Writes data to a file, extending it if needed. */
+int GHOSTFS_Write(GHOSTFS_handle_t handle,
+                  GHOSTFS_size_t offset,
+                  GHOSTFS_size_t size,
+                  caddr_t buffer,
+                  GHOSTFS_size_t * p_written_size, GHOSTFS_Attrs_t * p_file_attrs);
+
+/** Changes the size of a file. */
+int GHOSTFS_Truncate(GHOSTFS_handle_t handle,
+                     GHOSTFS_size_t length, GHOSTFS_Attrs_t * p_file_attrs);
+
 /** Reads the content of a symlink */
 int GHOSTFS_ReadLink(GHOSTFS_handle_t handle, char *buffer, GHOSTFS_mdsize_t buff_size);
 
@@ -291,7 +349,7 @@ int GHOSTFS_Opendir(GHOSTFS_handle_t handle, dir_descriptor_t * dir);
 int GHOSTFS_Readdir(dir_descriptor_t * dir, GHOSTFS_dirent_t * dirent);
 
 /** sets the position into a directory stream.
- *  If cookie = NULL, it restarts from the beginning.
+ *  If cookie = 0, it restarts from the beginning.
  */
 int GHOSTFS_Seekdir(dir_descriptor_t * dir, GHOSTFS_cookie_t cookie);
 
@@ -60,7 +60,9 @@ typedef struct lru_entry__
 {
   struct lru_entry__ *next;
   struct lru_entry__ *prev;
+  struct lru_entry__ *next_invalid;     /**< Chain of the invalid entries, waiting for LRU_gc_invalid */
   LRU_List_state_t valid_state;
+  int referenced;                       /**< Set by LRU_touch, second chance in LRU_reclaim */
   LRU_data_t buffdata;
 } LRU_entry_t;
 
@@ -73,15 +75,21 @@ typedef struct lru_param__
   char *name;                                      /**< Name for LRU list */
 } LRU_parameter_t;
 
+/* The valid entries are chained from LRU to MRU. An entry leaves this chain
+ * as soon as it is invalidated, for the chain of the invalid entries: the
+ * walks never see the invalid entries, and LRU_gc_invalid only walks those.
+ * The chains are protected by the lock of the list, except LRU_touch. */
 typedef struct lru_list__
 {
   LRU_entry_t *LRU;
   LRU_entry_t *MRU;
-  unsigned int nb_entry;
+  LRU_entry_t *invalid;
+  unsigned int nb_entry;                /**< valid and invalid entries */
   unsigned int nb_invalid;
   unsigned int nb_call_gc;
   LRU_parameter_t parameter;
   struct prealloc_pool lru_entry_pool;
+  pthread_mutex_t lock;
 } LRU_list_t;
 
 typedef int LRU_status_t;
@@ -95,6 +103,9 @@ int LRU_invalidate_by_function(LRU_list_t * plru,
                                void *addparam);
 int LRU_apply_function(LRU_list_t * plru, int (*myfunc) (LRU_entry_t *, void *addparam),
                        void *addparam);
+void LRU_touch(LRU_list_t * plru, LRU_entry_t * pentry);
+unsigned int LRU_reclaim(LRU_list_t * plru, unsigned int nb_to_reclaim,
+                         int (*testfunc) (LRU_entry_t *, void *addparam), void *addparam);
 void LRU_Print(LRU_list_t * plru);
 
 /* How many character used to display a key or value */
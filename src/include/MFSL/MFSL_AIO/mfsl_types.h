@@ -44,18 +44,24 @@
 
 #define CONF_LABEL_MFSL_AIO          "MFSL_AIO"
 
+/* No read ahead unless Nb_IO_Threads is set: the I/O threads read with the
+ * fsal_file_t of the worker that opened the file, see mfsl_aio_readahead.c */
+#define MFSL_AIO_DEFAULT_NB_IO_THREADS   0
+#define MFSL_AIO_DEFAULT_READAHEAD_MAX   1048576
+
 /* other includes */
 #include <sys/types.h>
 #include <sys/param.h>
 #include <dirent.h>             /* for MAXNAMLEN */
+#include <pthread.h>
 #include "config_parsing.h"
 #include "err_fsal.h"
 #include "err_mfsl.h"
 
 typedef struct mfsl_parameter__
 {
-
-  int nothing;
+  unsigned int nb_io_threads;   /* 0 means reads are never done ahead */
+  fsal_size_t readahead_max;    /* bigger reads are not done ahead */
 } mfsl_parameter_t;
 
 typedef struct mfsl_context__
@@ -69,9 +75,45 @@ typedef struct mfsl_object__
   fsal_handle_t handle;
 } mfsl_object_t;
 
+typedef enum mfsl_aio_readahead_state__
+{ MFSL_AIO_RA_IDLE = 0,
+  MFSL_AIO_RA_PENDING = 1,
+  MFSL_AIO_RA_READY = 2
+} mfsl_aio_readahead_state_t;
+
+/* The read ahead of an open file: while the client works on a chunk,
+ * an I/O thread reads the next one in buffer. */
+typedef struct mfsl_aio_readahead__
+{
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  fsal_file_t *pfsal_file;
+  mfsl_aio_readahead_state_t state;
+  fsal_off_t next_offset;       /* where a sequential reader goes on */
+  fsal_off_t offset;            /* what is (being) read in buffer */
+  fsal_size_t size;
+  fsal_size_t read_amount;
+  fsal_boolean_t end_of_file;
+  fsal_status_t status;
+  fsal_size_t buffer_size;
+  caddr_t buffer;
+  struct mfsl_aio_readahead__ *next;    /* in the I/O threads queue */
+} mfsl_aio_readahead_t;
+
 typedef struct mfsl_file__
 {
   fsal_file_t fsal_file ;
+  mfsl_aio_readahead_t *readahead;      /* NULL when the I/O threads are off */
 } mfsl_file_t ;
 
+fsal_status_t mfsl_aio_readahead_init(mfsl_parameter_t * pparam);
+void mfsl_aio_readahead_open(mfsl_file_t * pfile);
+void mfsl_aio_readahead_close(mfsl_file_t * pfile);
+void mfsl_aio_readahead_invalidate(mfsl_file_t * pfile);
+fsal_status_t mfsl_aio_read(mfsl_file_t * pfile,
+                            fsal_seek_t * seek_descriptor,
+                            fsal_size_t buffer_size,
+                            caddr_t buffer,
+                            fsal_size_t * read_amount, fsal_boolean_t * end_of_file);
+
 #endif                          /* _MFSL_AIO_TYPES_H */
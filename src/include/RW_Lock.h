@@ -49,6 +49,28 @@
   } while (0)
 
 /* Type representing the lock itself */
+#ifdef __linux__
+
+/* On Linux, the lock is a word updated with atomic operations: readers and
+ * writers that do not have to wait never enter the kernel, and sleep on a
+ * futex when they do. Writers have priority over new readers.
+ * __linux__ is tested instead of _LINUX because the layout of the lock must
+ * not depend on config.h being included before this file. */
+
+#define RW_LOCK_WRITER 0x40000000       /* set in state when a writer is active */
+
+typedef struct _RW_LOCK
+{
+  volatile int state;           /* number of active readers, or RW_LOCK_WRITER */
+  volatile int nbw_waiting;     /* writers waiting for the lock */
+  volatile int nbr_waiting;     /* readers waiting for the lock */
+  volatile int seq_write;       /* futex the writers sleep on */
+  volatile int seq_read;        /* futex the readers sleep on */
+  volatile unsigned int seq;    /* odd while a writer holds the lock */
+} rw_lock_t;
+
+#else
+
 typedef struct _RW_LOCK
 {
   unsigned int nbr_active;
@@ -59,15 +81,25 @@ typedef struct _RW_LOCK
   pthread_cond_t condWrite;
   pthread_cond_t condRead;
   pthread_mutex_t mcond;
+  volatile unsigned int seq;    /* odd while a writer holds the lock */
 } rw_lock_t;
 
+#endif                          /* __linux__ */
+
 int rw_lock_init(rw_lock_t * plock);
 int rw_lock_destroy(rw_lock_t * plock);
 int P_w(rw_lock_t * plock);
 int V_w(rw_lock_t * plock);
+int rw_lock_try_w(rw_lock_t * plock);
 int P_r(rw_lock_t * plock);
 int V_r(rw_lock_t * plock);
 int rw_lock_downgrade(rw_lock_t * plock);
 int rw_lock_upgrade(rw_lock_t * plock);
 
+/* Lockless readers: the sequence of the lock is bumped when a writer gets
+ * and releases it, so data protected by the lock can be read without taking
+ * it, provided the read is retried when rw_lock_seq_retry says so. */
+unsigned int rw_lock_seq_begin(rw_lock_t * plock);
+int rw_lock_seq_retry(rw_lock_t * plock, unsigned int seq);
+
 #endif                          /* _RW_LOCK */
@@ -0,0 +1,125 @@
+/*
+ *
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * \file    SlabAlloc.h
+ * \brief   Thread-safe slab allocator with per-thread magazines.
+ *
+ * SlabAlloc.h : Thread-safe slab allocator with per-thread magazines.
+ *
+ * A slab cache holds fixed size objects shared by every thread. Each
+ * thread keeps two magazines (small stacks of free objects) per cache, so
+ * that most allocations and releases, including releases of objects
+ * allocated by another thread, are served without any lock. Magazines
+ * are exchanged with a per-cache depot protected by a mutex when they
+ * are empty or full; this is how memory moves from a thread that frees a
+ * lot to a thread that allocates a lot.
+ *
+ * Slab caches back the pools made with MakeSharedPool (see stuff_alloc.h),
+ * so that GetFromPool/ReleaseToPool can be called from any thread on them.
+ *
+ * A slab is carved from the buddy context of the thread that grows the
+ * cache and is never given back: the memory stats of that thread include
+ * it, whichever thread uses its objects. The objects are counted by the
+ * cache, in SlabCacheGetStats.
+ *
+ */
+
+#ifndef _SLAB_ALLOC_H
+#define _SLAB_ALLOC_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+/** Max number of slab caches in the process. */
+#define SLAB_MAX_CACHES           64
+
+/** Max number of objects in a magazine. */
+#define SLAB_MAGAZINE_MAX_ROUNDS  32
+
+/** Magazines of big objects are shrinked to hold about this amount of memory. */
+#define SLAB_MAGAZINE_BYTES       65536
+
+/** Default number of objects in a slab. */
+#define SLAB_DEFAULT_OBJECTS      16
+
+#define SLAB_NAME_LEN             64
+
+typedef struct slab_magazine__
+{
+  struct slab_magazine__ *next;
+  unsigned int rounds;                        /**< number of objects in the magazine */
+  void *objs[SLAB_MAGAZINE_MAX_ROUNDS];
+} slab_magazine_t;
+
+typedef struct slab_stats__
+{
+  unsigned long long nb_alloc;                /**< total number of allocations      */
+  unsigned long long nb_free;                 /**< total number of releases         */
+  unsigned long long nb_depot_get;            /**< full magazines taken from depot  */
+  unsigned long long nb_depot_put;            /**< full magazines given to depot    */
+  unsigned long long nb_grow;                 /**< number of slabs allocated        */
+  unsigned long long nb_objects;              /**< number of objects in the slabs   */
+  unsigned long long nb_in_use;               /**< objects currently allocated      */
+  unsigned int nb_full_magazines;             /**< full magazines in the depot      */
+  unsigned int nb_empty_magazines;            /**< empty magazines in the depot     */
+} slab_stats_t;
+
+typedef struct slab_cache__
+{
+  char name[SLAB_NAME_LEN];
+  unsigned int index;                         /**< slot in the per-thread magazines */
+  size_t entry_size;                          /**< size of the user object          */
+  size_t obj_size;                            /**< size of object with its header   */
+  unsigned int slab_objs;                     /**< objects per slab                 */
+  unsigned int mag_rounds;                    /**< objects per magazine             */
+  void (*ctor) (void *entry);
+  void (*dtor) (void *entry);
+
+  pthread_mutex_t depot_mutex;                /**< protects what follows            */
+  slab_magazine_t *depot_full;
+  slab_magazine_t *depot_empty;
+  slab_stats_t depot_stats;                   /**< depot counters, and counters of
+                                                   exited threads                   */
+} slab_cache_t;
+
+slab_cache_t *SlabCacheCreate(const char *name,
+                              size_t entry_size,
+                              unsigned int slab_objs,
+                              void (*ctor) (void *entry), void (*dtor) (void *entry));
+
+int SlabCacheGrow(slab_cache_t * cache, unsigned int nb_objs);
+
+void *SlabAlloc(slab_cache_t * cache);
+
+void SlabFree(slab_cache_t * cache, void *entry);
+
+void SlabThreadFlush(void);
+
+void SlabCacheGetStats(slab_cache_t * cache, slab_stats_t * pstats);
+
+void SlabDumpStats(FILE * output, char *strdate);
+
+#endif                          /* _SLAB_ALLOC_H */
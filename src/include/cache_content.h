@@ -120,8 +120,35 @@ typedef struct cache_content_client_parameter__
   unsigned int max_fd_per_thread;             /**< Max fd open per client */
   time_t retention;                           /**< Fd retention duration */
   unsigned int use_cache;                     /** Do we cache fd or not ? */
+  size_t block_cache_size;                    /**< Memory budget of the block cache, 0 to disable */
+  size_t block_size;                          /**< Size of a block in the block cache */
+  unsigned int nb_recovery_threads;           /**< Threads replaying the manifest at startup */
 } cache_content_client_parameter_t;
 
+#define CACHE_CONTENT_MANIFEST_MAX_THREADS 64
+
+/* Block cache: file data cached in memory by fixed size blocks, each block
+ * being filled page by page. See cache_content_block.c */
+
+#define CACHE_CONTENT_BLOCK_PAGE_SIZE     4096
+#define CACHE_CONTENT_BLOCK_MAX_PAGES     1024        /**< a block is at most 4MB */
+#define CACHE_CONTENT_BLOCK_DEFAULT_SIZE  (1024*1024)
+
+typedef struct cache_content_block_stat__
+{
+  unsigned long long nb_read;                 /**< reads served by the block cache          */
+  unsigned long long nb_write;                /**< writes done through the block cache      */
+  unsigned long long nb_page_hit;             /**< pages read from memory                   */
+  unsigned long long nb_page_miss;            /**< pages filled from FSAL                   */
+  unsigned long long nb_write_back;           /**< writes kept in memory until COMMIT       */
+  unsigned long long nb_write_through;        /**< writes sent to FSAL at once              */
+  unsigned long long nb_flushed_pages;        /**< dirty pages written to FSAL              */
+  unsigned long long nb_evicted;              /**< blocks recycled by the LRU               */
+  unsigned long long nb_invalidated;          /**< blocks dropped (truncate, remove, mtime) */
+  unsigned long long nb_blocks;               /**< blocks currently allocated               */
+  unsigned long long nb_dirty_blocks;         /**< blocks currently holding dirty pages     */
+} cache_content_block_stat_t;
+
 #define CACHE_CONTENT_SPEC_DATA_SIZE 400
 typedef char cache_content_spec_data_t[CACHE_CONTENT_SPEC_DATA_SIZE];
 
@@ -345,9 +372,15 @@ cache_content_status_t cache_content_crash_recover(unsigned short exportid,
 
 int cache_content_get_export_id(char *dirname);
 u_int64_t cache_content_get_inum(char *filename);
+u_int64_t cache_content_get_fileid4(cache_entry_t * pentry_inode,
+                                    fsal_op_context_t * pcontext);
 int cache_content_get_datapath(char *basepath, u_int64_t inum, char *datapath);
 off_t cache_content_recover_size(char *basepath, u_int64_t inum);
 
+void cache_content_manifest_add(u_int64_t fileid4);
+void cache_content_manifest_remove(u_int64_t fileid4);
+int cache_content_manifest_lookup(u_int64_t fileid4);
+
 cache_inode_status_t cache_content_error_convert(cache_content_status_t status);
 
 cache_content_status_t cache_content_valid(cache_content_entry_t * pentry,
@@ -403,4 +436,39 @@ cache_content_status_t cache_content_test_cached(cache_entry_t * pentry_inode,
                                                  cache_content_status_t * pstatus);
 off_t cache_content_get_cached_size(cache_content_entry_t * pentry);
 
+int cache_content_block_init(cache_content_client_parameter_t param);
+
+int cache_content_block_enabled(void);
+
+cache_content_status_t cache_content_block_read(fsal_handle_t * phandle,
+                                                fsal_file_t * pfd,
+                                                fsal_attrib_list_t * pattr,
+                                                fsal_off_t offset,
+                                                fsal_size_t size,
+                                                fsal_size_t * pio_size,
+                                                caddr_t buffer,
+                                                fsal_boolean_t * p_fsal_eof,
+                                                fsal_status_t * pfsal_status,
+                                                cache_content_status_t * pstatus);
+
+cache_content_status_t cache_content_block_write(fsal_handle_t * phandle,
+                                                 fsal_file_t * pfd,
+                                                 fsal_attrib_list_t * pattr,
+                                                 fsal_off_t offset,
+                                                 fsal_size_t size,
+                                                 fsal_size_t * pio_size,
+                                                 caddr_t buffer,
+                                                 fsal_boolean_t write_back,
+                                                 fsal_status_t * pfsal_status,
+                                                 cache_content_status_t * pstatus);
+
+cache_content_status_t cache_content_block_flush(fsal_handle_t * phandle,
+                                                 fsal_file_t * pfd,
+                                                 fsal_status_t * pfsal_status,
+                                                 cache_content_status_t * pstatus);
+
+void cache_content_block_invalidate(fsal_handle_t * phandle, fsal_off_t from_offset);
+
+void cache_content_block_get_stats(cache_content_block_stat_t * pstat);
+
 #endif                          /* _CACHE_CONTENT_H */
@@ -53,7 +53,8 @@
 typedef enum cache_content_caching_type__
 { CACHE_CONTENT_NO_POLICY = 0,
   CACHE_CONTENT_NOT_CACHED = 1,
-  CACHE_CONTENT_FULLY_CACHED = 2
+  CACHE_CONTENT_FULLY_CACHED = 2,
+  CACHE_CONTENT_BLOCK_CACHED = 3
 } cache_content_caching_type_t;
 
 typedef struct cache_content_policy_data__
@@ -197,6 +197,8 @@ typedef struct cache_inode_stat__
     unsigned int nb_err_unrecover[CACHE_INODE_NB_COMMAND];                /**< failed/unrecoverable calls per function */
   } func_stats;
   unsigned int nb_call_total;                                       /**< Total number of calls */
+  unsigned int nb_neg_hit;                                          /**< Lookups answered by the negative cache */
+  unsigned int nb_neg_set;                                          /**< Names added to the negative cache      */
 } cache_inode_stat_t;
 
 typedef int cache_inode_status_t;
@@ -224,9 +226,12 @@ typedef struct cache_inode_client_parameter__
   unsigned int getattr_dir_invalidation;               /**< Use getattr as cookie for directory invalidation */
   unsigned int use_test_access;                        /**< Is FSAL_test_access to be used ?                 */
   unsigned int max_fd_per_thread;                      /**< Max fd open per client                           */
+  unsigned int max_open_fd;                            /**< Max fd open in the server, 0 for Max_Fd*Nb_Worker */
   time_t retention;                                    /**< Fd retention duration                            */
   unsigned int use_cache;                              /** Do we cache fd or not ?                           */
   unsigned int use_fsal_hash ;                         /** Do we rely on FSAL to hash handle or not ?        */
+  unsigned int nb_attr_prefetch_threads;               /**< Threads renewing attributes for readdir          */
+  unsigned int nb_neg_dirent;                          /**< Size of the negative lookup cache per directory  */
 } cache_inode_client_parameter_t;
 
 typedef struct cache_inode_opened_file__
@@ -239,8 +244,20 @@ typedef struct cache_inode_opened_file__
   unsigned int fileno;
   fsal_openflags_t openflags;
   time_t last_op;
+  int fd_slot;                  /**< slot in the global fd cache, -1 if the fd is not kept */
 } cache_inode_opened_file_t;
 
+typedef struct cache_inode_fd_cache_stat__
+{
+  unsigned int nb_max;                        /**< fds that may be kept open                */
+  unsigned int nb_open;                       /**< fds currently kept open                  */
+  unsigned long long nb_opened;               /**< fds given a slot after an open           */
+  unsigned long long nb_reused;               /**< IOs done on an fd already kept open      */
+  unsigned long long nb_evicted;              /**< fds closed to make room for another one  */
+  unsigned long long nb_expired;              /**< fds closed after OpenFile_Retention      */
+  unsigned long long nb_not_kept;             /**< fds closed after the IO, no slot found   */
+} cache_inode_fd_cache_stat_t;
+
 typedef enum cache_inode_file_type__
 { UNASSIGNED = 1,
   REGULAR_FILE = 2,
@@ -354,6 +371,21 @@ typedef struct cache_inode_unstable_data__
   uint32_t length;
 } cache_inode_unstable_data_t;
 
+typedef struct cache_inode_neg_dirent__
+{
+  fsal_name_t name;                                 /**< A name that does not exist in the directory          */
+  time_t time;                                      /**< When the FSAL answered it does not exist             */
+  fsal_time_t dir_mtime;                            /**< The directory's mtime at that time                   */
+} cache_inode_neg_dirent_t;
+
+typedef struct cache_inode_neg_dir__
+{
+  pthread_mutex_t lock;                             /**< Lookups only read lock the directory                 */
+  unsigned int size;                                /**< Number of slots in entries                           */
+  unsigned int next;                                /**< Slot to be used by the next name, oldest first       */
+  cache_inode_neg_dirent_t entries[1];              /**< Slots, an empty name means an unused slot            */
+} cache_inode_neg_dir_t;
+
 typedef struct cache_entry__
 {
   union cache_inode_fsobj__
@@ -371,8 +403,11 @@ typedef struct cache_entry__
 #endif                          /* _USE_PROXY */
       fsal_attrib_list_t attributes;                                 /**< The FSAL Attributes                                  */
       void *pentry_content;                                          /**< Entry in file content cache (NULL if not cached)     */
+      unsigned int use_block_cache;                                  /**< Data is cached by blocks in file content layer       */
       void *pstate_head;                                             /**< Pointer used for the head of the state chain         */
       void *pstate_tail;                                             /**< Current pointer for the state chain                  */
+      void *plock_root;                                              /**< Root of the interval tree of the lock states         */
+      struct rbt_head lock_owners;                                   /**< Lock states of the file, indexed by lock owner       */
       cache_inode_unstable_data_t unstable_data;                     /**< Unstable data, for use with WRITE/COMMIT             */
     } file;                                   /**< file related filed     */
 
@@ -389,6 +424,7 @@ typedef struct cache_entry__
       unsigned int nbdircont;                   /**< Number of DIR_CONT associated with the DIR_BEGIN        */
       cache_inode_flag_t has_been_readdir;      /**< True if a full readdir was performed on the directory   */
       char *referral;                           /**< NULL is not a referral, is not this a 'referral string' */
+      struct cache_inode_neg_dir__ *pdir_neg;   /**< Names known not to exist, allocated at the first miss   */
 
       struct cache_inode_dir_data__
       {
@@ -472,6 +508,11 @@ typedef struct cache_inode_state__
   cache_inode_open_owner_t *powner;                      /**< Open Owner related to this state           */
   struct cache_inode_state__ *next;                      /**< Next entry in the state list               */
   struct cache_inode_state__ *prev;                      /**< Prev entry in the state list               */
+  struct cache_inode_state__ *lock_left;                 /**< Left subtree in the lock index             */
+  struct cache_inode_state__ *lock_right;                /**< Right subtree in the lock index            */
+  uint64_t lock_end_max;                                 /**< Greatest lock end in this subtree          */
+  int lock_height;                                       /**< Height of this subtree                     */
+  struct rbt_node owner_node;                            /**< Node in the lock owner index               */
   struct cache_entry__ *pentry;                          /**< Related pentry                             */
 } cache_inode_state_t;
 
@@ -527,6 +568,7 @@ typedef struct cache_inode_client__
   time_t retention;                                                /**< Fd retention duration                                    */
   unsigned int use_cache;                                          /** Do we cache fd or not ?                                   */
   int fd_gc_needed;                                                /**< Should we perform fd gc ?                                */
+  unsigned int nb_neg_dirent;                                      /**< Size of the negative lookup cache per directory          */
 #ifdef _USE_MFSL
   mfsl_context_t mfsl_context;                                     /**< Context to be used for MFSL module                       */
 #endif
@@ -634,6 +676,36 @@ int cache_inode_client_init(cache_inode_client_t * pclient,
                             cache_inode_client_parameter_t param,
                             int thread_index, void *pworker_data);
 
+int cache_inode_prefetch_init(cache_inode_client_parameter_t param);
+
+int cache_inode_fd_cache_init(cache_inode_client_parameter_t param, unsigned int nb_worker);
+
+void cache_inode_fd_cache_keep(cache_entry_t * pentry, cache_inode_client_t * pclient);
+
+fsal_status_t cache_inode_fd_cache_close(cache_entry_t * pentry,
+                                         cache_inode_client_t * pclient);
+
+unsigned int cache_inode_fd_cache_expire(cache_inode_client_t * pclient);
+
+void cache_inode_fd_cache_get_stats(cache_inode_fd_cache_stat_t * pstat);
+
+int cache_inode_neg_lookup(cache_entry_t * pentry_parent,
+                           fsal_name_t * pname, cache_inode_client_t * pclient);
+
+void cache_inode_neg_add(cache_entry_t * pentry_parent,
+                         fsal_name_t * pname, cache_inode_client_t * pclient);
+
+void cache_inode_neg_remove(cache_entry_t * pentry_parent, fsal_name_t * pname);
+
+void cache_inode_neg_flush(cache_entry_t * pentry_parent);
+
+void cache_inode_neg_release(cache_entry_t * pentry_parent);
+
+unsigned int cache_inode_prefetch_attributes(cache_inode_dir_entry_t * dirent_array,
+                                             unsigned int nb_entries,
+                                             cache_inode_client_t * pclient,
+                                             fsal_op_context_t * pcontext);
+
 cache_entry_t *cache_inode_get(cache_inode_fsal_data_t * pfsdata,
                                fsal_attrib_list_t * pattr,
                                hash_table_t * ht,
@@ -943,6 +1015,9 @@ cache_inode_status_t cache_inode_renew_entry(cache_entry_t * pentry,
                                              fsal_op_context_t * pcontext,
                                              cache_inode_status_t * pstatus);
 
+int cache_inode_renew_needed(cache_entry_t * pentry,
+                             cache_inode_client_t * pclient, time_t current_time);
+
 cache_inode_status_t cache_inode_add_cached_dirent(cache_entry_t * pdir,
                                                    fsal_name_t * pname,
                                                    cache_entry_t * pentry_added,
@@ -1042,12 +1117,14 @@ cache_inode_status_t cache_inode_lock_check_conflicting_range(cache_entry_t * pe
                                                               uint64_t offset,
                                                               uint64_t length,
                                                               nfs_lock_type4 lock_type,
+                                                              open_owner4 * plockowner,
+                                                              cache_inode_state_t * *ppfilelock,
                                                               cache_inode_status_t *
                                                               pstatus);
 
 void cache_inode_lock_insert(cache_entry_t * pentry, cache_inode_state_t * pfilelock);
 
-void cache_inode_lock_remove(cache_entry_t * pentry, cache_inode_client_t * pclient);
+void cache_inode_lock_remove(cache_entry_t * pentry, cache_inode_state_t * pfilelock);
 
 cache_inode_status_t cache_inode_lock_create(cache_entry_t * pentry,
                                              uint64_t offset,
@@ -1062,6 +1139,8 @@ cache_inode_status_t cache_inode_lock_test(cache_entry_t * pentry,
                                            uint64_t offset,
                                            uint64_t length,
                                            nfs_lock_type4 lock_type,
+                                           open_owner4 * plockowner,
+                                           cache_inode_state_t * *ppfilelock,
                                            cache_inode_client_t * pclient,
                                            cache_inode_status_t * pstatus);
 
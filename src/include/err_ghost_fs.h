@@ -61,6 +61,9 @@ static family_error_t __attribute((__unused__)) tab_errstatus_GHOSTFS[] =
 #define ERR_GHOSTFS_NOTEMPTY   23
   {
   ERR_GHOSTFS_NOTEMPTY, "ERR_GHOSTFS_NOTEMPTY", "Directory is not empty"},
+#define ERR_GHOSTFS_FBIG   27
+  {
+  ERR_GHOSTFS_FBIG, "ERR_GHOSTFS_FBIG", "File too large"},
 #define ERR_GHOSTFS_INTERNAL 1001
   {
   ERR_GHOSTFS_INTERNAL, "ERR_GHOSTFS_INTERNAL", "GhostFS internal error"},
@@ -113,6 +116,9 @@ static family_error_t __attribute((__unused__)) tab_errstatus_GHOSTFS[] =
   {
   ERR_GHOSTFS_ATTR_NOT_SUPP, "ERR_GHOSTFS_ATTR_NOT_SUPP",
         "Unsupported or read-only attribute"},
+#define ERR_GHOSTFS_NOTFILE   1017
+  {
+  ERR_GHOSTFS_NOTFILE, "ERR_GHOSTFS_NOTFILE", "Not a regular file"},
   {
   ERR_NULL, "ERR_NULL", ""}
 };
@@ -560,6 +560,29 @@ fsal_status_t FSAL_write(fsal_file_t * file_descriptor, /* IN */
                          fsal_size_t * write_amount     /* OUT */
     );
 
+fsal_status_t FSAL_readv(fsal_file_t * file_descriptor, /* IN */
+                         fsal_count_t nb_segments,      /* IN */
+                         fsal_io_segment_t * segments,  /* IN/OUT */
+                         fsal_size_t * read_amount,     /* OUT */
+                         fsal_boolean_t * end_of_file   /* OUT */
+    );
+
+fsal_status_t FSAL_writev(fsal_file_t * file_descriptor,        /* IN */
+                          fsal_count_t nb_segments,     /* IN */
+                          fsal_io_segment_t * segments, /* IN/OUT */
+                          fsal_size_t * write_amount    /* OUT */
+    );
+
+/* Helpers for the FSALs that rely on a POSIX file descriptor (see fsal_iov.c) */
+int fsal_posix_preadv(int fd,
+                      fsal_count_t nb_segments,
+                      fsal_io_segment_t * segments,
+                      fsal_size_t * read_amount, fsal_boolean_t * end_of_file);
+
+int fsal_posix_pwritev(int fd,
+                       fsal_count_t nb_segments,
+                       fsal_io_segment_t * segments, fsal_size_t * write_amount);
+
 fsal_status_t FSAL_sync(fsal_file_t * file_descriptor /* IN */);
 
 fsal_status_t FSAL_close(fsal_file_t * file_descriptor  /* IN */
@@ -1342,6 +1365,19 @@ typedef struct fsal_functions__
 
   fsal_status_t(*fsal_sync) (fsal_file_t * p_file_descriptor  /* IN */);
 
+  /* FSAL_readv (optional, FSAL_read is used for each segment if not set) */
+  fsal_status_t(*fsal_readv) (fsal_file_t * p_file_descriptor,  /* IN */
+                              fsal_count_t nb_segments, /* IN */
+                              fsal_io_segment_t * p_segments,   /* IN/OUT */
+                              fsal_size_t * p_read_amount,      /* OUT */
+                              fsal_boolean_t * p_end_of_file /* OUT */ );
+
+  /* FSAL_writev (optional, FSAL_write is used for each segment if not set) */
+  fsal_status_t(*fsal_writev) (fsal_file_t * p_file_descriptor, /* IN */
+                               fsal_count_t nb_segments,        /* IN */
+                               fsal_io_segment_t * p_segments,  /* IN/OUT */
+                               fsal_size_t * p_write_amount /* OUT */ );
+
 } fsal_functions_t;
 
 /* Structure allow assignement, char[<n>] do not */
@@ -124,9 +124,11 @@ typedef unsigned long long int u_int64_t;
 #define INDEX_FSAL_CleanUpExportContext 50
 #define INDEX_FSAL_getextattrs          51
 #define INDEX_FSAL_sync                 52
+#define INDEX_FSAL_readv                53
+#define INDEX_FSAL_writev               54
 
 /* number of FSAL functions */
-#define FSAL_NB_FUNC  52
+#define FSAL_NB_FUNC  55
 
 static const char *fsal_function_names[] = {
   "FSAL_lookup", "FSAL_access", "FSAL_create", "FSAL_mkdir", "FSAL_truncate",
@@ -141,7 +143,7 @@ static const char *fsal_function_names[] = {
   "FSAL_ListXAttrs", "FSAL_GetXAttrValue", "FSAL_SetXAttrValue", "FSAL_GetXAttrAttrs",
   "FSAL_close_by_fileid", "FSAL_setattr_access", "FSAL_merge_attrs", "FSAL_rename_access",
   "FSAL_unlink_access", "FSAL_link_access", "FSAL_create_access", "FSAL_getlock", "FSAL_CleanUpExportContext",
-  "FSAL_getextattrs", "FSAL_sync"
+  "FSAL_getextattrs", "FSAL_sync", "FSAL_readv", "FSAL_writev"
 };
 
 typedef unsigned long long fsal_u64_t;    /**< 64 bit unsigned integer.     */
@@ -544,6 +546,19 @@ typedef struct fsal_seek__
   fsal_off_t offset;
 } fsal_seek_t;
 
+/** A segment for vectored I/O (FSAL_readv/FSAL_writev) */
+
+typedef struct fsal_io_segment__
+{
+  fsal_off_t offset;            /**< position of the segment in the file        */
+  fsal_size_t length;           /**< size of the buffer                         */
+  caddr_t buffer;               /**< data to be written, or read data           */
+  fsal_size_t io_amount;        /**< OUT: amount of data actually read/written  */
+} fsal_io_segment_t;
+
+/* Max number of segments submitted to a single preadv/pwritev call */
+#define FSAL_IO_MAX_SEGMENTS 64
+
 /** File locking info */
 
 typedef enum fsal_locktype_t
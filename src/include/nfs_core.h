@@ -40,6 +40,7 @@
 #include <pthread.h>
 #include <sys/types.h>
 #include <sys/param.h>
+#include <sys/uio.h>
 
 #ifdef _USE_GSSRPC
 #include <gssrpc/rpc.h>
@@ -87,6 +88,9 @@
 
 /* NFS daemon behavior default values */
 #define NB_WORKER_THREAD_DEFAULT  16
+#define NB_MIN_WORKER_THREAD_DEFAULT 4
+#define WORKER_TARGET_WAIT_DEFAULT   2000       /* microseconds */
+#define WORKER_IDLE_DELAY_DEFAULT    30         /* seconds */
 #define NB_FLUSHER_THREAD_DEFAULT 16
 #define NB_REQUEST_BEFORE_QUEUE_AVG  1000
 #define NB_MAX_CONCURRENT_GC 3
@@ -210,8 +214,14 @@ typedef enum nfs_clientid_confirm_state__
 
 #ifdef _USE_TIRPC
 void Svc_dg_soft_destroy(SVCXPRT * xport);
+char *Svc_dg_getbuf(SVCXPRT * xprt, u_int * psize);
+bool_t Svc_dg_recv_buffered(SVCXPRT * xprt, struct rpc_msg *msg, size_t rlen,
+                            struct sockaddr *addr, socklen_t addrlen);
 #else
 void Svcudp_soft_destroy(SVCXPRT * xprt);
+char *Svcudp_getbuf(SVCXPRT * xprt, u_int * psize);
+bool_t Svcudp_recv_buffered(SVCXPRT * xprt, struct rpc_msg *msg, size_t rlen,
+                            struct sockaddr *addr, socklen_t addrlen);
 #endif                          /* _USE_TIRPC */
 
 #ifdef _USE_GSSRPC
@@ -221,6 +231,33 @@ bool_t Svcauth_gss_acquire_cred(void);
 void Xprt_register(SVCXPRT * xprt);
 void Xprt_unregister(SVCXPRT * xprt);
 
+bool_t Svc_gather_active(struct rpc_msg *msg);
+bool_t Svc_gather_reply(int fd, struct rpc_msg *msg, bool_t * pdied);
+
+int Svc_sendq_init(size_t max_size);
+bool_t Svc_sendq_active(void);
+ssize_t Svc_sendq_writev(int fd, struct iovec *iov, int iovcnt);
+void Svc_sendq_discard(int fd);
+
+int Svc_mmsg_init(int fd, unsigned int batch_size);
+unsigned int Svc_mmsg_batch_size(void);
+int Svc_mmsg_recv(int fd, struct iovec *iov, struct sockaddr_storage *addrs,
+                  socklen_t * addrlen, size_t * len, unsigned int vlen);
+ssize_t Svc_mmsg_sendto(int fd, void *buf, size_t len, struct sockaddr *addr,
+                        socklen_t addrlen);
+
+int rpc_tcp_dispatch_request(long int tcp_sock);
+int nfs_rpc_tcp_receiver_init(unsigned int nb);
+bool_t nfs_rpc_tcp_receiver_enabled(void);
+int nfs_rpc_tcp_receiver_add(int fd);
+void nfs_rpc_tcp_receiver_remove(int fd);
+bool_t nfs_rpc_tcp_receiver_owns(int fd);
+int nfs_rpc_tcp_receiver_read(int fd, char *buf, int len);
+
+int nfs_worker_pool_init(unsigned int nb_min, unsigned int nb_max);
+unsigned int nfs_worker_pool_size(void);
+bool_t nfs_worker_pool_started(unsigned int index);
+
 
 /* Declare the various RPC transport dynamic arrays */
 extern SVCXPRT         **Xports;
@@ -294,6 +331,9 @@ typedef struct nfs_core_param__
   unsigned int nlm_program;
   unsigned int rquota_program;
   unsigned int nb_worker;
+  unsigned int nb_min_worker;
+  unsigned int worker_target_wait;
+  unsigned int worker_idle_delay;
   unsigned int nb_call_before_queue_avg;
   unsigned int nb_max_concurrent_gc;
   long core_dump_size;
@@ -308,6 +348,10 @@ typedef struct nfs_core_param__
   char stats_per_client_directory[MAXPATHLEN];
   char fsal_shared_library[MAXPATHLEN];
   int tcp_fridge_expiration_delay ;
+  unsigned int nb_tcp_receivers;
+  size_t tcp_send_queue_size;
+  unsigned int udp_batch_size;
+  unsigned int zero_copy_read;
   unsigned int core_options;
 } nfs_core_parameter_t;
 
@@ -451,6 +495,7 @@ typedef struct nfs_request_data__
   struct rpc_msg msg;
   char cred_area[2 * MAX_AUTH_BYTES + RQCRED_SIZE];
   int status;
+  struct timeval time_queued;   /* when the request was given to its worker */
   nfs_res_t res_nfs;
   nfs_arg_t arg_nfs;
 } nfs_request_data_t;
@@ -507,7 +552,10 @@ typedef struct nfs_worker_data__
   pthread_mutex_t mutex_export_condvar;
 
   nfs_worker_stat_t stats;
+  nfs_hh_sketch_t hh_sketch;
   unsigned int passcounter;
+  unsigned long long wait_total;        /* time spent in the queue by the requests, in usec */
+  unsigned long long wait_count;        /* number of requests in wait_total */
   struct sockaddr_storage hostaddr;
   int is_ready;
   unsigned int gc_in_progress;
@@ -814,6 +862,9 @@ void nfs41_Session_PrintAll(void);
 
 int nfs_Init_ip_name(nfs_ip_name_parameter_t param);
 hash_table_t *nfs_Init_ip_stats(nfs_ip_stats_parameter_t param);
+void nfs_hh_request_info(struct svc_req *preq, exportlist_t * pexport,
+                         nfs_arg_t * parg, nfs_res_t * pres,
+                         unsigned short *pexport_id, unsigned long long *pbytes);
 int nfs_Init_dupreq(nfs_rpc_dupreq_parameter_t param);
 
 void socket_setoptions(int socketFd);
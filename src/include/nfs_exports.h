@@ -238,6 +238,11 @@ typedef struct exportlist__
 
 /*
  * PseudoFs Tree
+ *
+ * The tree is built once from the export list and is never modified
+ * afterwards: an export reload builds a new tree and swaps it in.
+ * The sons of an entry are chained in their creation order (for READDIR)
+ * and indexed by name in a hash table (for LOOKUP).
  */
 typedef struct pseudofs_entry
 {
@@ -249,14 +254,22 @@ typedef struct pseudofs_entry
   struct pseudofs_entry *parent;                /**< reverse pointer (for LOOKUPP)    */
   struct pseudofs_entry *next;                  /**< pointer to the next entry in a list of sons */
   struct pseudofs_entry *last;                  /**< pointer to the last entry in a list of sons */
+  unsigned int name_hash;                       /**< hash value of name */
+  struct pseudofs_entry *hash_next;             /**< next son in the same bucket of the parent's sons_hash */
+  struct pseudofs_entry **sons_hash;            /**< the sons, indexed by name (NULL if no son) */
+  unsigned int sons_hash_size;                  /**< number of buckets in sons_hash (a power of 2) */
+  unsigned int nb_sons;                         /**< number of sons */
 } pseudofs_entry_t;
 
-#define MAX_PSEUDO_ENTRY 100
+#define PSEUDOFS_SONS_HASH_SIZE 8       /* initial size of a sons_hash */
+#define MAX_PSEUDO_ENTRY 65536          /* pseudo_id is an unsigned short in the file handle */
+
 typedef struct pseudofs
 {
   pseudofs_entry_t root;
   unsigned int last_pseudo_id;
-  pseudofs_entry_t *reverse_tab[MAX_PSEUDO_ENTRY];
+  unsigned int reverse_tab_size;                /**< number of slots in reverse_tab */
+  pseudofs_entry_t **reverse_tab;               /**< entries indexed by pseudo_id (NULL for unused ids) */
 } pseudofs_t;
 
 #define NFS_CLIENT_NAME_LEN 256
@@ -330,6 +343,11 @@ cache_content_status_t cache_content_prepare_directories(exportlist_t * pexportl
                                                          cache_content_status_t *
                                                          pstatus);
 
+cache_content_status_t cache_content_manifest_init(exportlist_t * pexportlist,
+                                                   char *cache_dir,
+                                                   unsigned int nb_threads,
+                                                   cache_content_status_t * pstatus);
+
 int nfs_export_check_access(struct sockaddr_storage *pssaddr,
                             struct svc_req *ptr_req,
                             exportlist_t * pexport,
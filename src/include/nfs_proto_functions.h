@@ -958,6 +958,19 @@ typedef struct fattr4_dent
   unsigned int access;          /* The access type for this attributes    */
 } fattr4_dent_t;
 
+/* A NFSv4 READDIR reply, built in a single block bounded by maxcount */
+typedef struct nfs4_readdir_page__
+{
+  entry4 *entries;              /* the entries, followed by the pool */
+  unsigned int nb_max;
+  unsigned int nb_entries;
+  char *pool;                   /* names and attributes of the entries */
+  unsigned long pool_size;
+  unsigned long pool_used;
+  unsigned long space_used;     /* XDR size of the reply */
+  unsigned long maxcount;
+} nfs4_readdir_page_t;
+
 /* This array reflects the tables on page 39-46 of RFC3530 */
 static const fattr4_dent_t __attribute__ ((__unused__)) fattr4tab[] =
 {
@@ -1489,6 +1502,17 @@ int nfs4_FSALattr_To_Fattr(exportlist_t * pexport,
                            fattr4 * Fattr,
                            compound_data_t * data, nfs_fh4 * objFH, bitmap4 * Bitmap);
 
+int nfs4_FSALattr_To_Fattr_Buffer(exportlist_t * pexport,
+                                  fsal_attrib_list_t * pattr,
+                                  fattr4 * Fattr,
+                                  compound_data_t * data, nfs_fh4 * objFH,
+                                  bitmap4 * Bitmap, uint32_t * bitmap_buf, char *vals_buf);
+
+int nfs4_readdir_page_init(nfs4_readdir_page_t * ppage, unsigned int nb_max,
+                           unsigned long maxcount);
+entry4 *nfs4_readdir_page_add(nfs4_readdir_page_t * ppage, char *name,
+                              nfs_cookie4 cookie, fattr4 * pattrs);
+
                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                 /* time_how4          * mtime_set, *//* Out: How to set mtime */
                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                         /* time_how4          * atimen_set ) ; *//* Out: How to set atime */
 
@@ -43,6 +43,7 @@
 #include <sys/param.h>
 #include <time.h>
 #include <pthread.h>
+#include <sys/socket.h>
 
 #ifdef _USE_GSSRPC
 #include <gssrpc/types.h>
@@ -171,9 +172,13 @@ typedef enum
   PER_SERVER_DETAIL,
   PER_CLIENT,
   PER_SHARE,
-  PER_CLIENTSHARE
+  PER_CLIENTSHARE,
+  PER_MEMORY
 } nfs_stat_client_req_type_t;
 
+/* Number of call sites reported by the allocation profiler */
+#define NFS_MEM_PROFILE_TOP  16
+
 typedef struct
 {
   int nfs_version;
@@ -182,6 +187,77 @@ typedef struct
   char share_name[1024];
 } nfs_stat_client_req_t;
 
+/* Heavy hitters: each worker keeps space-saving sketches of its busiest
+ * clients, exports and (client, export, operation) tuples, merged on demand
+ * into top-K reports. A key that is not in a full table takes the slot of the
+ * least busy one, and inherits its count as its error. */
+#define NFS_HH_SKETCH_SIZE   256        /* power of 2 */
+#define NFS_HH_TOP_K         16
+#define NFS_HH_ADDR_LEN      16
+
+typedef enum nfs_hh_report_type__
+{
+  NFS_HH_BY_CLIENT = 0,
+  NFS_HH_BY_EXPORT,
+  NFS_HH_BY_TUPLE,              /* (client, export, operation) */
+  NFS_HH_NB_REPORT_TYPES
+} nfs_hh_report_type_t;
+
+typedef struct nfs_hh_key__
+{
+  unsigned short family;        /* AF_INET or AF_INET6 */
+  unsigned short export_id;     /* 0 when no export is involved (MOUNT, NLM, ...) */
+  unsigned char addr[NFS_HH_ADDR_LEN];
+  unsigned int prog;
+  unsigned short vers;
+  unsigned short proc;
+} nfs_hh_key_t;
+
+typedef struct nfs_hh_counter__
+{
+  nfs_hh_key_t key;
+  unsigned long long nb_ops;
+  unsigned long long error;     /* upper bound of the overestimation of nb_ops */
+  unsigned long long nb_bytes;
+  unsigned long long tot_latency;       /* microseconds */
+  int next;                     /* next slot in the hash chain, -1 at the end */
+} nfs_hh_counter_t;
+
+typedef struct nfs_hh_table__
+{
+  unsigned int nb_used;
+  int heads[NFS_HH_SKETCH_SIZE];
+  nfs_hh_counter_t counters[NFS_HH_SKETCH_SIZE];
+} nfs_hh_table_t;
+
+typedef struct nfs_hh_sketch__
+{
+  pthread_mutex_t lock;         /* only contended when the sketch is merged */
+  time_t since;
+  nfs_hh_table_t tables[NFS_HH_NB_REPORT_TYPES];
+} nfs_hh_sketch_t;
+
+typedef struct nfs_hh_report__
+{
+  time_t since;
+  unsigned int nb_items;
+  nfs_hh_counter_t items[NFS_HH_TOP_K];
+} nfs_hh_report_t;
+
+void nfs_hh_init(nfs_hh_sketch_t * psketch);
+
+void nfs_hh_update(nfs_hh_sketch_t * psketch, struct sockaddr_storage *paddr,
+                   unsigned short export_id, struct svc_req *preq,
+                   unsigned long long nb_bytes, unsigned int latency);
+
+int nfs_hh_merge(nfs_hh_sketch_t ** sketches, unsigned int nb_sketches,
+                 nfs_hh_report_type_t type, nfs_hh_report_t * preport);
+
+void nfs_hh_new_window(nfs_hh_sketch_t ** sketches, unsigned int nb_sketches);
+
+int nfs_hh_sprint_item(char *str, size_t size, nfs_hh_report_type_t type,
+                       nfs_hh_counter_t * pitem);
+
 void nfs_stat_update(nfs_stat_type_t type,
                      nfs_request_stat_t * pstat_req, struct svc_req *preq,
                      nfs_request_latency_stat_t * lstat_req);
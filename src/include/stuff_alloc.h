@@ -43,6 +43,8 @@
 typedef void (*constructor)(void *entry);
 struct prealloc_pool;
 
+#include "SlabAlloc.h"
+
 #ifdef _NO_BUDDY_SYSTEM
 
 #include <malloc.h>
@@ -74,12 +76,12 @@ struct prealloc_pool;
 #  define Mem_Free( a )                   BuddyFree_Autolabel( (caddr_t) (a), __FILE__, __FUNCTION__, __LINE__, "BuddyFree" )
 #  define Mem_Free_Label( a, lbl )        BuddyFree_Autolabel( (caddr_t) (a), __FILE__, __FUNCTION__, __LINE__, lbl )
 #else
-#  define Mem_Alloc( a )                  BuddyMallocExit( a )
-#  define Mem_Calloc( s1, s2 )            BuddyCalloc( s1, s2 )
-#  define Mem_Realloc( p, s)              BuddyRealloc( (caddr_t)(p), s )
-#  define Mem_Alloc_Label( a, lbl )       BuddyMallocExit( a )
-#  define Mem_Calloc_Label( s1, s2, lbl ) BuddyCalloc( s1, s2 )
-#  define Mem_Realloc_Label( p, s, lbl)   BuddyRealloc( (caddr_t)(p), s )
+#  define Mem_Alloc( a )                  BuddyMalloc_Sampled( a, __FILE__, __LINE__, "BuddyMalloc" )
+#  define Mem_Calloc( s1, s2 )            BuddyCalloc_Sampled( s1, s2, __FILE__, __LINE__, "BuddyCalloc" )
+#  define Mem_Realloc( p, s)              BuddyRealloc_Sampled( (caddr_t)(p), s, __FILE__, __LINE__, "BuddyRealloc" )
+#  define Mem_Alloc_Label( a, lbl )       BuddyMalloc_Sampled( a, __FILE__, __LINE__, lbl )
+#  define Mem_Calloc_Label( s1, s2, lbl ) BuddyCalloc_Sampled( s1, s2, __FILE__, __LINE__, lbl )
+#  define Mem_Realloc_Label( p, s, lbl)   BuddyRealloc_Sampled( (caddr_t)(p), s, __FILE__, __LINE__, lbl )
 #  define Mem_Free( a )                   BuddyFree( (caddr_t) (a) )
 #  define Mem_Free_Label( a, lbl )        BuddyFree( (caddr_t) (a) )
 #endif
@@ -118,7 +120,7 @@ typedef struct prealloc_pool
   struct prealloc_pool   *pa_next_pool;   // next pool
   char                    pa_name[256];   // name of pool
   char                   *pa_type;        // data type stored in pool
-  int                     pa_used;        // number of entries in use
+  int                     pa_used;        // number of entries in use (not for shared pools)
   int                     pa_high;        // high water mark of used entries
 #endif
   struct prealloc_header *pa_free;        // free list
@@ -128,8 +130,13 @@ typedef struct prealloc_pool
   int                     pa_num;         // optimized number of entries per block
   int                     pa_blocks;      // number of blocks allocated
   int                     pa_allocated;   // number of entries preallocated
+  struct slab_cache__    *pa_slab;        // shared slab cache (MakeSharedPool), or NULL
 } prealloc_pool;
 
+/* The entries of a shared pool are allocated and released by any thread, so
+ * pa_used, pa_blocks and pa_allocated are not kept up to date for it: the
+ * counters of its slab cache are the ones to read (see SlabCacheGetStats). */
+
 #define IsPoolPreallocated(pool) ((pool)->pa_allocated > 0)
 
 /*******************************************
@@ -199,6 +206,7 @@ do {                                                         \
 do {                                                         \
   int size;                                                  \
   (pool)->pa_free        = NULL;                             \
+  (pool)->pa_slab        = NULL;                             \
   (pool)->pa_constructor = ctor;                             \
   (pool)->pa_destructor  = dtor;                             \
   (pool)->pa_size        = sizeof(type);                     \
@@ -237,17 +245,22 @@ do {                                                         \
  */
 #define GetFromPool(entry, pool, type)                       \
 do {                                                         \
-  if ((pool)->pa_free == NULL)                               \
-    FillPool(pool, __FILE__, __FUNCTION__, __LINE__, # type);\
-  if ((pool)->pa_free != NULL)                               \
+  if ((pool)->pa_slab != NULL)                               \
+    entry = (type *) SlabAlloc((pool)->pa_slab);             \
+  else                                                       \
     {                                                        \
-      prealloc_header *h = (pool)->pa_free;                  \
-      (pool)->pa_free = h->pa_next;                          \
-      h->pa_next = h;                                        \
-      entry = get_prealloc_entry(h, type);                   \
+      if ((pool)->pa_free == NULL)                           \
+        FillPool(pool, __FILE__, __FUNCTION__, __LINE__, # type);\
+      if ((pool)->pa_free != NULL)                           \
+        {                                                    \
+          prealloc_header *h = (pool)->pa_free;              \
+          (pool)->pa_free = h->pa_next;                      \
+          h->pa_next = h;                                    \
+          entry = get_prealloc_entry(h, type);               \
+        }                                                    \
+      else                                                   \
+        entry = NULL;                                        \
     }                                                        \
-  else                                                       \
-    entry = NULL;                                            \
 } while (0)
 
 /**
@@ -265,11 +278,16 @@ do {                                                         \
  */
 #define ReleaseToPool(entry, pool)                           \
 do {                                                         \
-  prealloc_header *h = get_prealloc_header(entry);           \
-  if ((pool)->pa_destructor != NULL)                         \
-    (pool)->pa_destructor(entry);                            \
-  h->pa_next = (pool)->pa_free;                              \
-  (pool)->pa_free = h;                                       \
+  if ((pool)->pa_slab != NULL)                               \
+    SlabFree((pool)->pa_slab, entry);                        \
+  else                                                       \
+    {                                                        \
+      prealloc_header *h = get_prealloc_header(entry);       \
+      if ((pool)->pa_destructor != NULL)                     \
+        (pool)->pa_destructor(entry);                        \
+      h->pa_next = (pool)->pa_free;                          \
+      (pool)->pa_free = h;                                   \
+    }                                                        \
 } while (0)
 
 #else
@@ -360,21 +378,26 @@ void _InitPool(struct prealloc_pool *pool,
  */
 #define GetFromPool(entry, pool, type)                       \
 do {                                                         \
-  if ((pool)->pa_free == NULL && (pool)->pa_num != 0)        \
-    FillPool(pool, __FILE__, __FUNCTION__, __LINE__, # type);\
-  if ((pool)->pa_free != NULL)                               \
+  if ((pool)->pa_slab != NULL)                               \
+    entry = (type *) SlabAlloc((pool)->pa_slab);             \
+  else                                                       \
     {                                                        \
-      prealloc_header *h = (pool)->pa_free;                  \
-      (pool)->pa_free = h->pa_next;                          \
-      h->pa_next = h;                                        \
-      h->pa_inuse = 1;                                       \
-      entry = get_prealloc_entry(h, type);                   \
-      (pool)->pa_used++;                                     \
-      if ((pool)->pa_used > (pool)->pa_high)                 \
-        (pool)->pa_high = (pool)->pa_used;                   \
+      if ((pool)->pa_free == NULL && (pool)->pa_num != 0)    \
+        FillPool(pool, __FILE__, __FUNCTION__, __LINE__, # type);\
+      if ((pool)->pa_free != NULL)                           \
+        {                                                    \
+          prealloc_header *h = (pool)->pa_free;              \
+          (pool)->pa_free = h->pa_next;                      \
+          h->pa_next = h;                                    \
+          h->pa_inuse = 1;                                   \
+          entry = get_prealloc_entry(h, type);               \
+          (pool)->pa_used++;                                 \
+          if ((pool)->pa_used > (pool)->pa_high)             \
+            (pool)->pa_high = (pool)->pa_used;               \
+        }                                                    \
+      else                                                   \
+        entry = NULL;                                        \
     }                                                        \
-  else                                                       \
-    entry = NULL;                                            \
 } while (0)
 
 /**
@@ -392,13 +415,18 @@ do {                                                         \
  */
 #define ReleaseToPool(entry, pool)                           \
 do {                                                         \
-  prealloc_header *h = get_prealloc_header(entry);           \
-  if ((pool)->pa_destructor != NULL)                         \
-    (pool)->pa_destructor(entry);                            \
-  h->pa_next = (pool)->pa_free;                              \
-  h->pa_inuse = 0;                                           \
-  (pool)->pa_free = h;                                       \
-  (pool)->pa_used--;                                         \
+  if ((pool)->pa_slab != NULL)                               \
+    SlabFree((pool)->pa_slab, entry);                        \
+  else                                                       \
+    {                                                        \
+      prealloc_header *h = get_prealloc_header(entry);       \
+      if ((pool)->pa_destructor != NULL)                     \
+        (pool)->pa_destructor(entry);                        \
+      h->pa_next = (pool)->pa_free;                          \
+      h->pa_inuse = 0;                                       \
+      (pool)->pa_free = h;                                   \
+      (pool)->pa_used--;                                     \
+    }                                                        \
 } while (0)
 
 #endif
@@ -422,6 +450,52 @@ do {                                                         \
   FillPool(pool, __FILE__, __FUNCTION__, __LINE__, # type);  \
 } while (0)
 
+/**
+ *
+ * InitSharedPool: Initializes a pool backed by the shared slab cache of its type.
+ *
+ * All the pools initialized this way for a given type (with the same
+ * constructor and destructor) share the same slab cache. GetFromPool and
+ * ReleaseToPool can then be called on them from any thread, without lock,
+ * and an entry can be released to another of these pools than the one it
+ * was taken from.
+ *
+ * @param pool      the pool that we want to init.
+ * @param num_alloc the number of entries to be allocated at once
+ * @param type      the type of the entries to be allocated.
+ * @param ctor      the constructor for the objects
+ * @param dtor      the destructor for the entries
+ *
+ * @return  nothing (this is a macro)
+ *
+ */
+#define InitSharedPool(pool, num_alloc, type, ctor, dtor)    \
+do {                                                         \
+  InitPool(pool, num_alloc, type, ctor, dtor);               \
+  (pool)->pa_slab = SlabCacheCreate(# type, sizeof(type),    \
+                                    (pool)->pa_num, ctor, dtor); \
+} while (0)
+
+/**
+ *
+ * MakeSharedPool: Initializes a shared pool and adds num_alloc entries to its slab cache.
+ *
+ * @param pool      the pool that we want to init.
+ * @param num_alloc the number of entries to be allocated at once
+ * @param type      the type of the entries to be allocated.
+ * @param ctor      the constructor for the objects
+ * @param dtor      the destructor for the entries
+ *
+ * @return  nothing (this is a macro)
+ *
+ */
+#define MakeSharedPool(pool, num_alloc, type, ctor, dtor)    \
+do {                                                         \
+  InitSharedPool(pool, num_alloc, type, ctor, dtor);         \
+  if ((pool)->pa_slab != NULL)                               \
+    (pool)->pa_allocated += SlabCacheGrow((pool)->pa_slab, (pool)->pa_num); \
+} while (0)
+
 #else 
 
 /*******************************************************************************
@@ -448,6 +522,12 @@ do {                                                         \
 #define MakePool(pool, num_alloc, type, ctor, dtor)          \
   InitPool(pool, num_alloc, type, ctor, dtor)
 
+#define InitSharedPool(pool, num_alloc, type, ctor, dtor)    \
+  InitPool(pool, num_alloc, type, ctor, dtor)
+
+#define MakeSharedPool(pool, num_alloc, type, ctor, dtor)    \
+  InitPool(pool, num_alloc, type, ctor, dtor)
+
 #define GetFromPool(entry, pool, type)                       \
 do {                                                         \
   entry = (type *)Mem_Alloc_Label(sizeof(type), # type);     \
@@ -703,6 +703,12 @@ int fn_nfs_remote_id(int argc,  /* IN : number of args in argv */
                      char **argv,       /* IN : arg list               */
                      FILE * output);    /* IN : output stream          */
 
+/** run a multi-threaded load and report latencies */
+int fn_nfs_remote_loadgen(int argc,     /* IN : number of args in argv */
+                          char **argv,  /* IN : arg list               */
+                          FILE * output /* IN : output stream          */
+    );
+
 /*------------------------------------------
  *       Layers and commands definitions
  *-----------------------------------------*/
@@ -1146,6 +1152,8 @@ static command_def_t __attribute__ ((__unused__)) commands_NFS_remote[] =
   {
   "ln", fn_nfs_remote_ln, "create a symbolic link"},
   {
+  "loadgen", fn_nfs_remote_loadgen, "run a multi-threaded load and report latencies"},
+  {
   "ls", fn_nfs_remote_ls, "list contents of directory"},
   {
   "mkdir", fn_nfs_remote_mkdir, "create a directory"},
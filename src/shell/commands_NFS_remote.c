@@ -60,12 +60,17 @@ typedef unsigned short u_short;
 
 #include "nfs23.h"
 #include "mount.h"
+#include "BenchStats.h"
 
 #include <unistd.h>
 #include <sys/types.h>
 #include <pwd.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/time.h>
 
 #define MAXIT 10
 #define MAXRETRY 3
@@ -324,18 +329,15 @@ static char mounted_path[NFS2_MAXPATHLEN];
 static shell_fh3_t current_path_hdl;
 static char current_path[NFS2_MAXPATHLEN];
 
-/** rpc_init */
-int rpc_init(char *hostname,    /* IN */
-             char *name,        /* IN */
-             char *proto,       /* IN */
-             int port,          /* IN */
-             FILE * output      /* IN */
+/** rpc_create_client: creates an authenticated RPC client for a program/version */
+static CLIENT *rpc_create_client(char *hostname,        /* IN */
+                                 u_long prog,   /* IN */
+                                 u_long vers,   /* IN */
+                                 char *proto,   /* IN */
+                                 int port,      /* IN */
+                                 FILE * output  /* IN */
     )
 {
-  int rc;
-  u_long prog = 0;
-  u_long vers = 0;
-
   CLIENT *clnt_res = NULL;
   struct hostent *h;
   struct protoent *p;
@@ -346,92 +348,110 @@ int rpc_init(char *hostname,    /* IN */
   gid_t groups_tab[MAX_GRPS];
   int nb_grp;
 
-  prog_vers_def_t *progvers = progvers_rpcs;
+  h = gethostbyname(hostname);
+  if(h == NULL)
+    {
+      rpc_createerr.cf_stat = RPC_UNKNOWNHOST;
+      fprintf(output, "rpc_init : unknown host %s\n", hostname);
+      return NULL;
+    }
+  if(h->h_addrtype != AF_INET)
+    {
+      /*
+       * Only support INET for now
+       */
+      rpc_createerr.cf_stat = RPC_SYSTEMERROR;
+      rpc_createerr.cf_error.re_errno = EAFNOSUPPORT;
+      return NULL;
+    }
+  memset(&sin, 0, sizeof(sin));
 
-  while(progvers->name != NULL)
+  sin.sin_family = h->h_addrtype;
+  sin.sin_port = htons((u_short) port);
+  memcpy((char *)&sin.sin_addr, h->h_addr, h->h_length);
+
+  p = getprotobyname(proto);
+  if(p == NULL)
     {
-      if(!strcmp(progvers->name, name))
+      fprintf(output, "rpc_init : protocol %s not found\n", proto);
+      return NULL;
+    }
+  sock = RPC_ANYSOCK;
+
+  switch (p->p_proto)
+    {
+    case IPPROTO_UDP:
+      clnt_res = clntudp_bufcreate(&sin, prog, vers,
+                                   timeout, &sock, UDPMSGSIZE, UDPMSGSIZE);
+      if(clnt_res == NULL)
         {
-          prog = progvers->prog;
-          vers = progvers->vers;
-          //fprintf(output, "(%s) Prog : %d - Vers : %d - Proto : %s\n", name, prog, vers, proto);
-          h = gethostbyname(hostname);
-          if(h == NULL)
-            {
-              rpc_createerr.cf_stat = RPC_UNKNOWNHOST;
-              fprintf(output, "rpc_init : unknown host %s\n", hostname);
-              return (-1);
-            }
-          if(h->h_addrtype != AF_INET)
-            {
-              /*
-               * Only support INET for now
-               */
-              rpc_createerr.cf_stat = RPC_SYSTEMERROR;
-              rpc_createerr.cf_error.re_errno = EAFNOSUPPORT;
-              return (-1);
-            }
-          memset(&sin, 0, sizeof(sin));
+          fprintf(output, "rpc_init : Clntudp_bufcreate failed\n");
+          return NULL;
+        }
+      break;
+    case IPPROTO_TCP:
+      clnt_res = clnttcp_create(&sin, prog, vers, &sock, 8800, 8800);
+      if(clnt_res == NULL)
+        {
+          fprintf(output, "rpc_init : Clnttcp_create failed\n");
+          return NULL;
+        }
+      break;
+    default:
+      rpc_createerr.cf_stat = RPC_SYSTEMERROR;
+      rpc_createerr.cf_error.re_errno = EPFNOSUPPORT;
+      fprintf(output, "rpc_init : unknown protocol %d (%s)\n", p->p_proto, proto);
+      return NULL;
+    }
 
-          sin.sin_family = h->h_addrtype;
-          sin.sin_port = htons((u_short) port);
-          memcpy((char *)&sin.sin_addr, h->h_addr, h->h_length);
+  if(current_pw == NULL)
+    {                           // first rpc_init
+      pw_struct = getpwuid(getuid());
+      if(pw_struct == NULL)
+        {
+          fprintf(output, "getpwuid failed\n");
+          clnt_destroy(clnt_res);
+          return NULL;
+        }
+      current_pw = (struct passwd *)malloc(sizeof(struct passwd));
+      memcpy(current_pw, pw_struct, sizeof(struct passwd));
+    }
+  nb_grp = getugroups(MAX_GRPS, groups_tab, current_pw->pw_name, current_pw->pw_gid);
 
-          p = getprotobyname(proto);
-          if(p == NULL)
-            {
-              fprintf(output, "rpc_init : protocol %s not found\n", proto);
-              return (-1);
-            }
-          sock = RPC_ANYSOCK;
+  clnt_res->cl_auth =
+      authunix_create(localmachine, current_pw->pw_uid, current_pw->pw_gid,
+                      nb_grp, groups_tab);
+  if(clnt_res->cl_auth == NULL)
+    {
+      fprintf(stdout, "rpc_init : error during creating Auth\n");
+    }
 
-          switch (p->p_proto)
-            {
-            case IPPROTO_UDP:
-              clnt_res = clntudp_bufcreate(&sin, prog, vers,
-                                           timeout, &sock, UDPMSGSIZE, UDPMSGSIZE);
-              if(clnt_res == NULL)
-                {
-                  fprintf(output, "rpc_init : Clntudp_bufcreate failed\n");
-                  return (-1);
-                }
-              break;
-            case IPPROTO_TCP:
-              clnt_res = clnttcp_create(&sin, prog, vers, &sock, 8800, 8800);
-              if(clnt_res == NULL)
-                {
-                  fprintf(output, "rpc_init : Clnttcp_create failed\n");
-                  return (-1);
-                }
-              break;
-            default:
-              rpc_createerr.cf_stat = RPC_SYSTEMERROR;
-              rpc_createerr.cf_error.re_errno = EPFNOSUPPORT;
-              fprintf(output, "rpc_init : unknown protocol %d (%s)\n", p->p_proto, proto);
-              return (-1);
-            }
+  return clnt_res;
+}                               /* rpc_create_client */
 
-          if(current_pw == NULL)
-            {                   // first rpc_init
-              pw_struct = getpwuid(getuid());
-              if(pw_struct == NULL)
-                {
-                  fprintf(output, "getpwuid failed\n");
-                  return -1;
-                }
-              current_pw = (struct passwd *)malloc(sizeof(struct passwd));
-              memcpy(current_pw, pw_struct, sizeof(struct passwd));
-            }
-          nb_grp =
-              getugroups(MAX_GRPS, groups_tab, current_pw->pw_name, current_pw->pw_gid);
+/** rpc_init */
+int rpc_init(char *hostname,    /* IN */
+             char *name,        /* IN */
+             char *proto,       /* IN */
+             int port,          /* IN */
+             FILE * output      /* IN */
+    )
+{
+  int rc;
 
-          clnt_res->cl_auth =
-              authunix_create(localmachine, current_pw->pw_uid, current_pw->pw_gid,
-                              nb_grp, groups_tab);
-          if(clnt_res->cl_auth == NULL)
-            {
-              fprintf(stdout, "rpc_init : error during creating Auth\n");
-            }
+  CLIENT *clnt_res = NULL;
+
+  prog_vers_def_t *progvers = progvers_rpcs;
+
+  while(progvers->name != NULL)
+    {
+      if(!strcmp(progvers->name, name))
+        {
+          //fprintf(output, "(%s) Prog : %d - Vers : %d - Proto : %s\n", name, progvers->prog, progvers->vers, proto);
+          clnt_res = rpc_create_client(hostname, progvers->prog, progvers->vers,
+                                       proto, port, output);
+          if(clnt_res == NULL)
+            return (-1);
 
           rc = setCLIENT(name, clnt_res);
           if(rc != 0)
@@ -3568,3 +3588,733 @@ int fn_nfs_remote_id(int argc,  /* IN : number of args in argv */
 
   return 0;
 }
+
+/*------------------------------------------------------------
+ *          Load generator
+ *-----------------------------------------------------------*/
+
+/* operations driven by the load generator */
+typedef enum loadgen_op__
+{
+  LOADGEN_GETATTR = 0,
+  LOADGEN_LOOKUP,
+  LOADGEN_READ,
+  LOADGEN_WRITE,
+  LOADGEN_READDIRPLUS,
+  LOADGEN_CREATE,
+  LOADGEN_NB_OPS
+} loadgen_op_t;
+
+static char *loadgen_op_names[LOADGEN_NB_OPS] = {
+  "getattr", "lookup", "read", "write", "readdirplus", "create"
+};
+
+static char loadgen_default_mix[] =
+    "getattr=30,lookup=20,read=20,write=10,readdirplus=10,create=10";
+
+/* largest read/write (UDP transports are limited to UDPMSGSIZE anyway) */
+#define LOADGEN_MAX_IO_SIZE    (1024 * 1024)
+
+/* a worker stops after this many RPC failures in a row (dead connection) */
+#define LOADGEN_MAX_RPC_ERRORS 100
+
+/* a sunrpc CLIENT is not thread safe: the threads sharing it take turns */
+typedef struct loadgen_conn__
+{
+  CLIENT *clnt;
+  pthread_mutex_t lock;
+} loadgen_conn_t;
+
+typedef struct loadgen_ctx__
+{
+  shell_fh3_t dir_hdl;
+  shell_fh3_t *file_hdls;
+  unsigned int nb_files;
+  unsigned int mix[LOADGEN_NB_OPS];
+  unsigned int mix_total;
+  unsigned int io_size;
+  char *write_buff;
+  unsigned long long nb_ops;    /* per thread, 0 = no limit */
+  unsigned long long stop_ns;   /* 0 means no time limit */
+  loadgen_conn_t *conns;
+  unsigned int nb_conns;
+
+  /* start line */
+  pthread_mutex_t start_lock;
+  pthread_cond_t start_cond;
+  int started;
+} loadgen_ctx_t;
+
+typedef struct loadgen_thr__
+{
+  pthread_t thrid;
+  loadgen_ctx_t *ctx;
+  unsigned int index;
+  unsigned int seed;
+  unsigned long long nb_created;
+  bench_stat_t stats[LOADGEN_NB_OPS];  /* in ns, reported in usec */
+} loadgen_thr_t;
+
+/** loadgen_parse_mix: parses "op=weight,op=weight..." */
+static int loadgen_parse_mix(char *str_mix, loadgen_ctx_t * p_ctx, FILE * output)
+{
+  char buff[256];
+  char *item;
+  char *value;
+  char *saveptr;
+  int weight;
+  unsigned int op;
+
+  strncpy(buff, str_mix, sizeof(buff));
+  buff[sizeof(buff) - 1] = '\0';
+
+  memset(p_ctx->mix, 0, sizeof(p_ctx->mix));
+  p_ctx->mix_total = 0;
+
+  for(item = strtok_r(buff, ",", &saveptr); item != NULL;
+      item = strtok_r(NULL, ",", &saveptr))
+    {
+      if((value = strchr(item, '=')) == NULL)
+        {
+          fprintf(output, "loadgen: invalid mix item \"%s\" (expected <op>=<weight>)\n",
+                  item);
+          return -1;
+        }
+      *value++ = '\0';
+
+      for(op = 0; op < LOADGEN_NB_OPS; op++)
+        if(!strcmp(item, loadgen_op_names[op]))
+          break;
+
+      if(op == LOADGEN_NB_OPS)
+        {
+          fprintf(output, "loadgen: unknown operation \"%s\"\n", item);
+          return -1;
+        }
+
+      weight = atoi(value);
+      if(weight < 0)
+        {
+          fprintf(output, "loadgen: invalid weight \"%s\" for %s\n", value, item);
+          return -1;
+        }
+
+      p_ctx->mix[op] = weight;
+      p_ctx->mix_total += weight;
+    }
+
+  if(p_ctx->mix_total == 0)
+    {
+      fprintf(output, "loadgen: the operation mix is empty\n");
+      return -1;
+    }
+
+  return 0;
+}                               /* loadgen_parse_mix */
+
+/** loadgen_getfile: looks up or creates a file of the working set */
+static int loadgen_getfile(CLIENT * clnt, shell_fh3_t * p_dir_hdl, char *name,
+                           unsigned int size, char *buff, shell_fh3_t * p_hdl)
+{
+  CREATE3args create_arg;
+  CREATE3res create_res;
+  WRITE3args write_arg;
+  WRITE3res write_res;
+  int rc;
+
+  /* an unchecked create returns the file if it already exists */
+  memset(&create_arg, 0, sizeof(create_arg));
+  set_nfs_fh3(&create_arg.where.dir, p_dir_hdl);
+  create_arg.where.name = name;
+  create_arg.how.mode = UNCHECKED;
+  create_arg.how.createhow3_u.obj_attributes.mode.set_it = TRUE;
+  create_arg.how.createhow3_u.obj_attributes.mode.set_mode3_u.mode = 0644;
+
+  if(nfs3_remote_Create(clnt, (nfs_arg_t *) & create_arg,
+                        (nfs_res_t *) & create_res) != RPC_SUCCESS)
+    return -1;
+
+  rc = create_res.status;
+  if(rc == NFS3_OK && create_res.CREATE3res_u.resok.obj.handle_follows)
+    set_shell_fh3(p_hdl, &create_res.CREATE3res_u.resok.obj.post_op_fh3_u.handle);
+  else if(rc == NFS3_OK)
+    rc = -1;
+
+  clnt_freeres(clnt, (xdrproc_t) xdr_CREATE3res, (caddr_t) & create_res);
+  if(rc != NFS3_OK)
+    return rc;
+
+  /* so that reads return data */
+  memset(&write_arg, 0, sizeof(write_arg));
+  set_nfs_fh3(&write_arg.file, p_hdl);
+  write_arg.offset = 0;
+  write_arg.count = size;
+  write_arg.stable = FILE_SYNC;
+  write_arg.data.data_len = size;
+  write_arg.data.data_val = buff;
+
+  if(nfs3_remote_Write(clnt, (nfs_arg_t *) & write_arg,
+                       (nfs_res_t *) & write_res) != RPC_SUCCESS)
+    return -1;
+
+  rc = write_res.status;
+  clnt_freeres(clnt, (xdrproc_t) xdr_WRITE3res, (caddr_t) & write_res);
+
+  return rc;
+}                               /* loadgen_getfile */
+
+/** loadgen_remove: removes a file from the tested directory */
+static int loadgen_remove(CLIENT * clnt, shell_fh3_t * p_dir_hdl, char *name)
+{
+  REMOVE3args arg;
+  REMOVE3res res;
+  int rc;
+
+  set_nfs_fh3(&arg.object.dir, p_dir_hdl);
+  arg.object.name = name;
+
+  if(nfs3_remote_Remove(clnt, (nfs_arg_t *) & arg, (nfs_res_t *) & res) != RPC_SUCCESS)
+    return -1;
+
+  rc = res.status;
+  clnt_freeres(clnt, (xdrproc_t) xdr_REMOVE3res, (caddr_t) & res);
+
+  return rc;
+}                               /* loadgen_remove */
+
+/**
+ * loadgen_do_op: sends one operation.
+ *
+ * @return RPC_SUCCESS and the NFS status in *p_status,
+ *         or the RPC error.
+ */
+static int loadgen_do_op(loadgen_thr_t * p_thr, loadgen_op_t op, CLIENT * clnt,
+                         int *p_status)
+{
+  loadgen_ctx_t *p_ctx = p_thr->ctx;
+  shell_fh3_t *p_file = &p_ctx->file_hdls[rand_r(&p_thr->seed) % p_ctx->nb_files];
+  char name[MAXNAMLEN];
+  int rc;
+
+  switch (op)
+    {
+    case LOADGEN_GETATTR:
+      {
+        GETATTR3args arg;
+        GETATTR3res res;
+
+        set_nfs_fh3(&arg.object, p_file);
+        rc = nfs3_remote_Getattr(clnt, (nfs_arg_t *) & arg, (nfs_res_t *) & res);
+        if(rc == RPC_SUCCESS)
+          {
+            *p_status = res.status;
+            clnt_freeres(clnt, (xdrproc_t) xdr_GETATTR3res, (caddr_t) & res);
+          }
+        return rc;
+      }
+
+    case LOADGEN_LOOKUP:
+      {
+        diropargs3 arg;
+        LOOKUP3res res;
+
+        snprintf(name, MAXNAMLEN, "loadgen.%u", (unsigned int)(p_file - p_ctx->file_hdls));
+        set_nfs_fh3(&arg.dir, &p_ctx->dir_hdl);
+        arg.name = name;
+        rc = nfs3_remote_Lookup(clnt, (nfs_arg_t *) & arg, (nfs_res_t *) & res);
+        if(rc == RPC_SUCCESS)
+          {
+            *p_status = res.status;
+            clnt_freeres(clnt, (xdrproc_t) xdr_LOOKUP3res, (caddr_t) & res);
+          }
+        return rc;
+      }
+
+    case LOADGEN_READ:
+      {
+        READ3args arg;
+        READ3res res;
+
+        set_nfs_fh3(&arg.file, p_file);
+        arg.offset = 0;
+        arg.count = p_ctx->io_size;
+        rc = nfs3_remote_Read(clnt, (nfs_arg_t *) & arg, (nfs_res_t *) & res);
+        if(rc == RPC_SUCCESS)
+          {
+            *p_status = res.status;
+            clnt_freeres(clnt, (xdrproc_t) xdr_READ3res, (caddr_t) & res);
+          }
+        return rc;
+      }
+
+    case LOADGEN_WRITE:
+      {
+        WRITE3args arg;
+        WRITE3res res;
+
+        set_nfs_fh3(&arg.file, p_file);
+        arg.offset = 0;
+        arg.count = p_ctx->io_size;
+        arg.stable = UNSTABLE;
+        arg.data.data_len = p_ctx->io_size;
+        arg.data.data_val = p_ctx->write_buff;
+        rc = nfs3_remote_Write(clnt, (nfs_arg_t *) & arg, (nfs_res_t *) & res);
+        if(rc == RPC_SUCCESS)
+          {
+            *p_status = res.status;
+            clnt_freeres(clnt, (xdrproc_t) xdr_WRITE3res, (caddr_t) & res);
+          }
+        return rc;
+      }
+
+    case LOADGEN_READDIRPLUS:
+      {
+        READDIRPLUS3args arg;
+        READDIRPLUS3res res;
+
+        memset(&arg, 0, sizeof(arg));
+        set_nfs_fh3(&arg.dir, &p_ctx->dir_hdl);
+        arg.cookie = 0;
+        arg.dircount = 4096;
+        arg.maxcount = 32768;
+        rc = nfs3_remote_Readdirplus(clnt, (nfs_arg_t *) & arg, (nfs_res_t *) & res);
+        if(rc == RPC_SUCCESS)
+          {
+            *p_status = res.status;
+            clnt_freeres(clnt, (xdrproc_t) xdr_READDIRPLUS3res, (caddr_t) & res);
+          }
+        return rc;
+      }
+
+    case LOADGEN_CREATE:
+      {
+        CREATE3args arg;
+        CREATE3res res;
+
+        snprintf(name, MAXNAMLEN, "loadgen.%d.%u.%llu", (int)getpid(), p_thr->index,
+                 p_thr->nb_created);
+        memset(&arg, 0, sizeof(arg));
+        set_nfs_fh3(&arg.where.dir, &p_ctx->dir_hdl);
+        arg.where.name = name;
+        arg.how.mode = GUARDED;
+        arg.how.createhow3_u.obj_attributes.mode.set_it = TRUE;
+        arg.how.createhow3_u.obj_attributes.mode.set_mode3_u.mode = 0644;
+        rc = nfs3_remote_Create(clnt, (nfs_arg_t *) & arg, (nfs_res_t *) & res);
+        if(rc == RPC_SUCCESS)
+          {
+            *p_status = res.status;
+            clnt_freeres(clnt, (xdrproc_t) xdr_CREATE3res, (caddr_t) & res);
+          }
+        /* the name is consumed even on failure, cleanup will skip it */
+        p_thr->nb_created++;
+        return rc;
+      }
+
+    default:
+      return RPC_FAILED;
+    }
+}                               /* loadgen_do_op */
+
+/** loadgen_thread: the load generating threads */
+static void *loadgen_thread(void *arg)
+{
+  loadgen_thr_t *p_thr = (loadgen_thr_t *) arg;
+  loadgen_ctx_t *p_ctx = p_thr->ctx;
+  loadgen_conn_t *p_conn = &p_ctx->conns[p_thr->index % p_ctx->nb_conns];
+  unsigned long long nb_done = 0;
+  unsigned int rpc_errors = 0;
+  unsigned int draw;
+  loadgen_op_t op;
+  unsigned long long start;
+  unsigned long long end;
+  int status;
+  int rc;
+
+  /* wait for everybody to be ready */
+  P(p_ctx->start_lock);
+  while(!p_ctx->started)
+    pthread_cond_wait(&p_ctx->start_cond, &p_ctx->start_lock);
+  V(p_ctx->start_lock);
+
+  while(p_ctx->nb_ops == 0 || nb_done < p_ctx->nb_ops)
+    {
+      /* pick an operation according to the mix */
+      draw = rand_r(&p_thr->seed) % p_ctx->mix_total;
+      for(op = 0; draw >= p_ctx->mix[op]; op++)
+        draw -= p_ctx->mix[op];
+
+      /* only the RPC is timed, not the wait for a shared connection */
+      P(p_conn->lock);
+      start = BenchStats_Now();
+      status = NFS3_OK;
+      rc = loadgen_do_op(p_thr, op, p_conn->clnt, &status);
+      end = BenchStats_Now();
+      V(p_conn->lock);
+
+      BenchStats_Record(&p_thr->stats[op], end - start,
+                        (rc != RPC_SUCCESS || status != NFS3_OK));
+      nb_done++;
+
+      if(rc != RPC_SUCCESS)
+        {
+          if(++rpc_errors >= LOADGEN_MAX_RPC_ERRORS)
+            break;
+        }
+      else
+        rpc_errors = 0;
+
+      if(p_ctx->stop_ns != 0 && end >= p_ctx->stop_ns)
+        break;
+    }
+
+  return NULL;
+}                               /* loadgen_thread */
+
+/** loadgen_print_stat: prints the figures of an operation, in JSON */
+static void loadgen_print_stat(FILE * out, char *name, bench_stat_t * p_stat,
+                               double elapsed_sec, char *trailer)
+{
+  fprintf(out, "    \"%s\": {\"count\": %llu, \"errors\": %llu, \"ops_per_sec\": %.1f,\n",
+          name, p_stat->count, p_stat->errors, p_stat->count / elapsed_sec);
+  fprintf(out, "      \"latency_usec\": {\"min\": %llu, \"mean\": %.1f, \"p50\": %llu, "
+          "\"p90\": %llu, \"p99\": %llu, \"p99.9\": %llu, \"p99.99\": %llu, "
+          "\"max\": %llu}}%s\n",
+          p_stat->min_ns / 1000,
+          p_stat->count ? (double)p_stat->sum_ns / p_stat->count / 1000.0 : 0.0,
+          BenchStats_Percentile(p_stat, 50.0) / 1000, BenchStats_Percentile(p_stat, 90.0) / 1000,
+          BenchStats_Percentile(p_stat, 99.0) / 1000, BenchStats_Percentile(p_stat, 99.9) / 1000,
+          BenchStats_Percentile(p_stat, 99.99) / 1000, p_stat->max_ns / 1000, trailer);
+}                               /* loadgen_print_stat */
+
+/** run a multi-threaded load against the server and report latencies */
+int fn_nfs_remote_loadgen(int argc,     /* IN : number of args in argv */
+                          char **argv,  /* IN : arg list               */
+                          FILE * output)        /* IN : output stream          */
+{
+  static char format[] = "ht:c:d:n:m:s:f:o:";
+  static char help_loadgen[] =
+      "usage: loadgen [options] <dir>\n"
+      "Runs an NFSv3 load against the files of <dir> and prints throughput and\n"
+      "latency percentiles in JSON.\n"
+      "options :\n"
+      "\t-h print this help\n"
+      "\t-t <nb_threads> number of load generating threads (default 4)\n"
+      "\t-c <nb_conn> number of connections to the server, shared by the threads (default 1)\n"
+      "\t-d <seconds> duration of the run (default 10, 0 for no time limit)\n"
+      "\t-n <nb_ops> number of operations per thread (default: no limit)\n"
+      "\t-m <mix> operation weights (default: \"getattr=30,lookup=20,read=20,\n"
+      "\t         write=10,readdirplus=10,create=10\")\n"
+      "\t-s <io_size> size of reads and writes, in bytes (default 4096)\n"
+      "\t-f <nb_files> number of files in the working set (default 16)\n"
+      "\t-o <file> write the JSON report to <file> instead of the output\n"
+      "The working set files are named loadgen.<n> and are kept for the next runs.\n"
+      "The files made by create operations are removed at the end of the run.\n"
+      "\"rpc_init\" (nfs3) and \"mount\" must have been done before.\n";
+
+  int option;
+  int err_flag = 0;
+  int flag_h = 0;
+  int nb_threads = 4;
+  int nb_conns = 1;
+  int duration = 10;
+  int nb_ops = 0;
+  int io_size = 4096;
+  int nb_files = 16;
+  char *str_mix = loadgen_default_mix;
+  char *str_out = NULL;
+  char *str_name = NULL;
+
+  char glob_path[NFS2_MAXPATHLEN];
+  char name[MAXNAMLEN];
+  loadgen_ctx_t ctx;
+  loadgen_thr_t *threads = NULL;
+  bench_stat_t *p_total = NULL;
+  unsigned long long start;
+  unsigned long long end;
+  double elapsed_sec;
+  unsigned long long total_ops = 0;
+  unsigned long long total_errors = 0;
+  unsigned long long n;
+  unsigned int op;
+  int nb_started = 0;
+  int i;
+  int rc = 0;
+  FILE *out = output;
+  void (*old_sigpipe) (int) = SIG_ERR;
+
+  /* check if a path has been mounted */
+
+  if(is_mounted_path != TRUE)
+    {
+      fprintf(output, "\t%s: no mounted path. Use \"mount\" command first.\n", argv[0]);
+      return -1;
+    }
+
+  /* analysing options */
+  getopt_init();
+
+  while((option = Getopt(argc, argv, format)) != -1)
+    {
+      switch (option)
+        {
+        case 'h':
+          flag_h++;
+          break;
+        case 't':
+          nb_threads = atoi(Optarg);
+          break;
+        case 'c':
+          nb_conns = atoi(Optarg);
+          break;
+        case 'd':
+          duration = atoi(Optarg);
+          break;
+        case 'n':
+          nb_ops = atoi(Optarg);
+          break;
+        case 'm':
+          str_mix = Optarg;
+          break;
+        case 's':
+          io_size = atoi(Optarg);
+          break;
+        case 'f':
+          nb_files = atoi(Optarg);
+          break;
+        case 'o':
+          str_out = Optarg;
+          break;
+        case '?':
+          fprintf(output, "loadgen: unknown option : %c\n", Optopt);
+          err_flag++;
+          break;
+        }
+    }                           /* while */
+
+  if(flag_h)
+    {
+      fprintf(output, help_loadgen);
+      return 0;
+    }
+
+  if(Optind != argc - 1)
+    {
+      fprintf(output, "loadgen: Missing argument: <dir>\n");
+      err_flag++;
+    }
+  else
+    str_name = argv[Optind];
+
+  if(nb_threads <= 0 || nb_conns <= 0 || nb_conns > nb_threads || duration < 0
+     || nb_ops < 0 || io_size <= 0 || io_size > LOADGEN_MAX_IO_SIZE || nb_files <= 0)
+    {
+      fprintf(output, "loadgen: invalid value (connections must not exceed threads)\n");
+      err_flag++;
+    }
+
+  if(duration == 0 && nb_ops == 0)
+    {
+      fprintf(output, "loadgen: -d 0 requires -n\n");
+      err_flag++;
+    }
+
+  memset(&ctx, 0, sizeof(ctx));
+
+  if(!err_flag && loadgen_parse_mix(str_mix, &ctx, output) != 0)
+    err_flag++;
+
+  if(err_flag)
+    {
+      fprintf(output, help_loadgen);
+      return -1;
+    }
+
+  if(*getHostname("nfs3") == '\0')
+    {
+      fprintf(output, "loadgen: NFS3 client not initialized\n");
+      return -1;
+    }
+
+  /* retrieving the handle of the tested directory */
+  strncpy(glob_path, current_path, NFS2_MAXPATHLEN);
+
+  if((rc = nfs_remote_solvepath(&mounted_path_hdl,
+                                glob_path,
+                                NFS2_MAXPATHLEN, str_name, &current_path_hdl,
+                                &ctx.dir_hdl, output)) != 0)
+    return rc;
+
+  ctx.nb_files = nb_files;
+  ctx.io_size = io_size;
+  ctx.nb_ops = nb_ops;
+  ctx.nb_conns = nb_conns;
+  pthread_mutex_init(&ctx.start_lock, NULL);
+  pthread_cond_init(&ctx.start_cond, NULL);
+
+  ctx.file_hdls = (shell_fh3_t *) Mem_Alloc(nb_files * sizeof(shell_fh3_t));
+  ctx.write_buff = (char *)Mem_Alloc(io_size);
+  ctx.conns = (loadgen_conn_t *) Mem_Alloc(nb_conns * sizeof(loadgen_conn_t));
+  threads = (loadgen_thr_t *) Mem_Alloc(nb_threads * sizeof(loadgen_thr_t));
+  p_total = (bench_stat_t *) Mem_Alloc(LOADGEN_NB_OPS * sizeof(bench_stat_t));
+
+  if(ctx.file_hdls == NULL || ctx.write_buff == NULL || ctx.conns == NULL
+     || threads == NULL || p_total == NULL)
+    {
+      fprintf(output, "loadgen: not enough memory\n");
+      rc = -1;
+      goto out;
+    }
+
+  memset(ctx.write_buff, 'g', io_size);
+  memset(ctx.conns, 0, nb_conns * sizeof(loadgen_conn_t));
+  memset(threads, 0, nb_threads * sizeof(loadgen_thr_t));
+  memset(p_total, 0, LOADGEN_NB_OPS * sizeof(bench_stat_t));
+
+  /* a server that dies during the run must show up as errors, not kill the shell */
+  old_sigpipe = signal(SIGPIPE, SIG_IGN);
+
+  /* opening the connections */
+  for(i = 0; i < nb_conns; i++)
+    {
+      ctx.conns[i].clnt = rpc_create_client(getHostname("nfs3"), NFS_PROGRAM, NFS_V3,
+                                            getProto("nfs3"), getPort("nfs3"), output);
+      if(ctx.conns[i].clnt == NULL)
+        {
+          fprintf(output, "loadgen: could not open connection #%d\n", i);
+          rc = -1;
+          goto out;
+        }
+      pthread_mutex_init(&ctx.conns[i].lock, NULL);
+    }
+
+  /* building the working set */
+  for(i = 0; i < nb_files; i++)
+    {
+      snprintf(name, MAXNAMLEN, "loadgen.%d", i);
+      if((rc = loadgen_getfile(ctx.conns[0].clnt, &ctx.dir_hdl, name, io_size,
+                               ctx.write_buff, &ctx.file_hdls[i])) != 0)
+        {
+          fprintf(output, "loadgen: could not prepare %s/%s (error %d)\n", glob_path, name,
+                  rc);
+          goto out;
+        }
+    }
+
+  /* starting the threads, that wait for the start line */
+  for(i = 0; i < nb_threads; i++)
+    {
+      threads[i].ctx = &ctx;
+      threads[i].index = i;
+      threads[i].seed = (unsigned int)getpid() * 31 + i;
+
+      if((rc = pthread_create(&threads[i].thrid, NULL, loadgen_thread, &threads[i])) != 0)
+        {
+          fprintf(output, "loadgen: could not start thread #%d (error %d)\n", i, rc);
+          break;
+        }
+      nb_started++;
+    }
+
+  start = BenchStats_Now();
+  if(duration != 0)
+    ctx.stop_ns = start + duration * 1000000000ULL;
+
+  P(ctx.start_lock);
+  ctx.started = TRUE;
+  pthread_cond_broadcast(&ctx.start_cond);
+  V(ctx.start_lock);
+
+  for(i = 0; i < nb_started; i++)
+    pthread_join(threads[i].thrid, NULL);
+
+  end = BenchStats_Now();
+
+  if(nb_started != nb_threads)
+    {
+      rc = -1;
+      goto cleanup;
+    }
+
+  elapsed_sec = (end - start) / 1000000000.0;
+  if(elapsed_sec <= 0.0)
+    elapsed_sec = 0.000001;
+
+  for(i = 0; i < nb_threads; i++)
+    for(op = 0; op < LOADGEN_NB_OPS; op++)
+      BenchStats_Merge(&p_total[op], &threads[i].stats[op]);
+
+  for(op = 0; op < LOADGEN_NB_OPS; op++)
+    {
+      total_ops += p_total[op].count;
+      total_errors += p_total[op].errors;
+    }
+
+  /* report */
+  if(str_out != NULL && (out = fopen(str_out, "w")) == NULL)
+    {
+      fprintf(output, "loadgen: could not open %s: %s\n", str_out, strerror(errno));
+      out = output;
+      rc = -1;
+    }
+
+  fprintf(out, "{\n");
+  fprintf(out, "  \"loadgen\": {\"server\": \"%s\", \"proto\": \"%s\", \"dir\": \"%s\",\n",
+          getHostname("nfs3"), getProto("nfs3"), glob_path);
+  fprintf(out, "    \"threads\": %d, \"connections\": %d, \"files\": %d, \"io_size\": %d,\n",
+          nb_threads, nb_conns, nb_files, io_size);
+  fprintf(out, "    \"mix\": {");
+  for(op = 0; op < LOADGEN_NB_OPS; op++)
+    fprintf(out, "%s\"%s\": %u", op ? ", " : "", loadgen_op_names[op], ctx.mix[op]);
+  fprintf(out, "}},\n");
+  fprintf(out, "  \"elapsed_sec\": %.3f, \"ops\": %llu, \"errors\": %llu, "
+          "\"ops_per_sec\": %.1f,\n", elapsed_sec, total_ops, total_errors,
+          total_ops / elapsed_sec);
+  fprintf(out, "  \"per_op\": {\n");
+  for(op = 0; op < LOADGEN_NB_OPS; op++)
+    loadgen_print_stat(out, loadgen_op_names[op], &p_total[op], elapsed_sec,
+                       (op == LOADGEN_NB_OPS - 1) ? "" : ",");
+  fprintf(out, "  }\n}\n");
+
+  if(out != output)
+    fclose(out);
+
+ cleanup:
+  /* removing the files made by the create operations (not timed) */
+  for(i = 0; i < nb_started; i++)
+    for(n = 0; n < threads[i].nb_created; n++)
+      {
+        snprintf(name, MAXNAMLEN, "loadgen.%d.%u.%llu", (int)getpid(), threads[i].index,
+                 n);
+        loadgen_remove(ctx.conns[0].clnt, &ctx.dir_hdl, name);
+      }
+
+ out:
+  if(old_sigpipe != SIG_ERR)
+    signal(SIGPIPE, old_sigpipe);
+
+  if(ctx.conns != NULL)
+    for(i = 0; i < nb_conns; i++)
+      if(ctx.conns[i].clnt != NULL)
+        {
+          if(ctx.conns[i].clnt->cl_auth != NULL)
+            auth_destroy(ctx.conns[i].clnt->cl_auth);
+          clnt_destroy(ctx.conns[i].clnt);
+          pthread_mutex_destroy(&ctx.conns[i].lock);
+        }
+
+  pthread_mutex_destroy(&ctx.start_lock);
+  pthread_cond_destroy(&ctx.start_cond);
+
+  if(ctx.file_hdls != NULL)
+    Mem_Free(ctx.file_hdls);
+  if(ctx.write_buff != NULL)
+    Mem_Free(ctx.write_buff);
+  if(ctx.conns != NULL)
+    Mem_Free(ctx.conns);
+  if(threads != NULL)
+    Mem_Free(threads);
+  if(p_total != NULL)
+    Mem_Free(p_total);
+
+  return rc;
+}                               /* fn_nfs_remote_loadgen */
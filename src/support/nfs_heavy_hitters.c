@@ -0,0 +1,458 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * \file    nfs_heavy_hitters.c
+ * \brief   Top-K clients and exports, from per worker space-saving sketches.
+ *
+ * nfs_heavy_hitters.c : Each worker counts the requests it serves per client,
+ * per export and per (client, export, operation) in its own sketch, made of a
+ * table of NFS_HH_SKETCH_SIZE counters for each. When a table is full, an
+ * unknown key takes the counter of the least busy one (the "space-saving"
+ * algorithm): the busiest keys are never evicted, and the count of a key is
+ * overestimated by at most its error.
+ * The sketches of all the workers are merged on demand, by the stat exporter
+ * and by the stats thread which starts a new window after each dump.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef _SOLARIS
+#include "solaris_port.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "log_macros.h"
+#include "stuff_alloc.h"
+#include "lookup3.h"
+#include "nfs_core.h"
+#include "nfs_file_handle.h"
+#include "nfs_stat.h"
+
+extern nfs_parameter_t nfs_param;
+
+static unsigned int nfs_hh_hash(nfs_hh_key_t * pkey)
+{
+  return Lookup3_hash_buff((char *)pkey, sizeof(nfs_hh_key_t)) & (NFS_HH_SKETCH_SIZE - 1);
+}                               /* nfs_hh_hash */
+
+/* Called with the sketch's lock held */
+static void nfs_hh_reset(nfs_hh_sketch_t * psketch)
+{
+  nfs_hh_table_t *ptable;
+  unsigned int t;
+  unsigned int i;
+
+  for(t = 0; t < NFS_HH_NB_REPORT_TYPES; t++)
+    {
+      ptable = &psketch->tables[t];
+      memset(ptable->counters, 0, ptable->nb_used * sizeof(nfs_hh_counter_t));
+      for(i = 0; i < NFS_HH_SKETCH_SIZE; i++)
+        ptable->heads[i] = -1;
+      ptable->nb_used = 0;
+    }
+  psketch->since = time(NULL);
+}                               /* nfs_hh_reset */
+
+/**
+ *
+ * nfs_hh_init: Initializes a worker's heavy hitters sketch.
+ *
+ * @param psketch [OUT] the sketch to initialize
+ *
+ * @return nothing (void function)
+ *
+ */
+void nfs_hh_init(nfs_hh_sketch_t * psketch)
+{
+  memset(psketch->tables, 0, sizeof(psketch->tables));
+  nfs_hh_reset(psketch);
+  pthread_mutex_init(&psketch->lock, NULL);
+}                               /* nfs_hh_init */
+
+/* Called with the sketch's lock held */
+static void nfs_hh_table_update(nfs_hh_table_t * ptable, nfs_hh_key_t * pkey,
+                                unsigned long long nb_bytes, unsigned int latency)
+{
+  nfs_hh_counter_t *pcounter;
+  unsigned int h;
+  unsigned int i;
+  int *pprev;
+  int slot;
+
+  h = nfs_hh_hash(pkey);
+
+  for(slot = ptable->heads[h]; slot != -1; slot = ptable->counters[slot].next)
+    if(!memcmp(&ptable->counters[slot].key, pkey, sizeof(nfs_hh_key_t)))
+      break;
+
+  if(slot == -1)
+    {
+      if(ptable->nb_used < NFS_HH_SKETCH_SIZE)
+        {
+          slot = ptable->nb_used++;
+          pcounter = &ptable->counters[slot];
+        }
+      else
+        {
+          /* Take the counter of the least busy key, and inherit its count */
+          slot = 0;
+          for(i = 1; i < NFS_HH_SKETCH_SIZE; i++)
+            if(ptable->counters[i].nb_ops < ptable->counters[slot].nb_ops)
+              slot = i;
+          pcounter = &ptable->counters[slot];
+
+          for(pprev = &ptable->heads[nfs_hh_hash(&pcounter->key)];
+              *pprev != slot; pprev = &ptable->counters[*pprev].next) ;
+          *pprev = pcounter->next;
+
+          pcounter->error = pcounter->nb_ops;
+          pcounter->nb_bytes = 0;
+          pcounter->tot_latency = 0;
+        }
+
+      pcounter->key = *pkey;
+      pcounter->next = ptable->heads[h];
+      ptable->heads[h] = slot;
+    }
+
+  pcounter = &ptable->counters[slot];
+  pcounter->nb_ops += 1;
+  pcounter->nb_bytes += nb_bytes;
+  pcounter->tot_latency += latency;
+}                               /* nfs_hh_table_update */
+
+/**
+ *
+ * nfs_hh_update: Accounts a request in a worker's heavy hitters sketch.
+ *
+ * @param psketch   [INOUT] the worker's sketch
+ * @param paddr     [IN]    address of the client
+ * @param export_id [IN]    id of the export the request was for, 0 if none
+ * @param preq      [IN]    the request
+ * @param nb_bytes  [IN]    bytes read or written by the request
+ * @param latency   [IN]    service time of the request, in microseconds
+ *
+ * @return nothing (void function)
+ *
+ */
+void nfs_hh_update(nfs_hh_sketch_t * psketch, struct sockaddr_storage *paddr,
+                   unsigned short export_id, struct svc_req *preq,
+                   unsigned long long nb_bytes, unsigned int latency)
+{
+  nfs_hh_key_t key;
+  nfs_hh_key_t client_key;
+  nfs_hh_key_t export_key;
+
+  memset(&key, 0, sizeof(key));
+  key.family = paddr->ss_family;
+  if(paddr->ss_family == AF_INET6)
+    memcpy(key.addr, &((struct sockaddr_in6 *)paddr)->sin6_addr, NFS_HH_ADDR_LEN);
+  else
+    memcpy(key.addr, &((struct sockaddr_in *)paddr)->sin_addr, sizeof(struct in_addr));
+
+  client_key = key;
+
+  memset(&export_key, 0, sizeof(export_key));
+  export_key.export_id = export_id;
+
+  key.export_id = export_id;
+  key.prog = preq->rq_prog;
+  key.vers = preq->rq_vers;
+  key.proc = preq->rq_proc;
+
+  P(psketch->lock);
+
+  nfs_hh_table_update(&psketch->tables[NFS_HH_BY_CLIENT], &client_key, nb_bytes, latency);
+  nfs_hh_table_update(&psketch->tables[NFS_HH_BY_EXPORT], &export_key, nb_bytes, latency);
+  nfs_hh_table_update(&psketch->tables[NFS_HH_BY_TUPLE], &key, nb_bytes, latency);
+
+  V(psketch->lock);
+}                               /* nfs_hh_update */
+
+static int nfs_hh_compare_key(const void *p1, const void *p2)
+{
+  return memcmp(&((nfs_hh_counter_t *) p1)->key, &((nfs_hh_counter_t *) p2)->key,
+                sizeof(nfs_hh_key_t));
+}                               /* nfs_hh_compare_key */
+
+static int nfs_hh_compare_ops(const void *p1, const void *p2)
+{
+  unsigned long long ops1 = ((nfs_hh_counter_t *) p1)->nb_ops;
+  unsigned long long ops2 = ((nfs_hh_counter_t *) p2)->nb_ops;
+
+  return (ops1 < ops2) ? 1 : (ops1 > ops2) ? -1 : 0;
+}                               /* nfs_hh_compare_ops */
+
+/**
+ *
+ * nfs_hh_merge: Merges the workers' sketches into a top-K report.
+ *
+ * The counters of the asked table are summed over the workers, and the K
+ * busiest keys are reported. A sketch is locked only while it is copied.
+ *
+ * @param sketches    [INOUT] the workers' sketches
+ * @param nb_sketches [IN]    number of sketches
+ * @param type        [IN]    clients, exports or tuples
+ * @param preport     [OUT]   the busiest items, by decreasing number of requests
+ *
+ * @return 0 if successful, -1 if there was no memory for the merge.
+ *
+ */
+int nfs_hh_merge(nfs_hh_sketch_t ** sketches, unsigned int nb_sketches,
+                 nfs_hh_report_type_t type, nfs_hh_report_t * preport)
+{
+  nfs_hh_counter_t *all;
+  nfs_hh_table_t *ptable;
+  unsigned int nb_all = 0;
+  unsigned int nb_merged = 0;
+  unsigned int i;
+  unsigned int j;
+
+  memset(preport, 0, sizeof(nfs_hh_report_t));
+  preport->since = time(NULL);
+
+  if((all = (nfs_hh_counter_t *) Mem_Alloc_Label(nb_sketches * NFS_HH_SKETCH_SIZE *
+                                                 sizeof(nfs_hh_counter_t),
+                                                 "nfs_hh_merge")) == NULL)
+    return -1;
+
+  for(i = 0; i < nb_sketches; i++)
+    {
+      P(sketches[i]->lock);
+
+      ptable = &sketches[i]->tables[type];
+      memcpy(&all[nb_all], ptable->counters, ptable->nb_used * sizeof(nfs_hh_counter_t));
+      nb_all += ptable->nb_used;
+
+      if(sketches[i]->since < preport->since)
+        preport->since = sketches[i]->since;
+
+      V(sketches[i]->lock);
+    }
+
+  qsort(all, nb_all, sizeof(nfs_hh_counter_t), nfs_hh_compare_key);
+
+  for(i = 0; i < nb_all; i = j)
+    {
+      all[nb_merged] = all[i];
+
+      for(j = i + 1; j < nb_all && !nfs_hh_compare_key(&all[i], &all[j]); j++)
+        {
+          all[nb_merged].nb_ops += all[j].nb_ops;
+          all[nb_merged].error += all[j].error;
+          all[nb_merged].nb_bytes += all[j].nb_bytes;
+          all[nb_merged].tot_latency += all[j].tot_latency;
+        }
+
+      nb_merged += 1;
+    }
+
+  qsort(all, nb_merged, sizeof(nfs_hh_counter_t), nfs_hh_compare_ops);
+
+  preport->nb_items = (nb_merged < NFS_HH_TOP_K) ? nb_merged : NFS_HH_TOP_K;
+  memcpy(preport->items, all, preport->nb_items * sizeof(nfs_hh_counter_t));
+
+  Mem_Free(all);
+
+  return 0;
+}                               /* nfs_hh_merge */
+
+/**
+ *
+ * nfs_hh_new_window: Clears all the tables of the workers' sketches.
+ *
+ * To be called once all the reports of a window are merged, so that every
+ * table starts the next window at the same time.
+ *
+ * @param sketches    [INOUT] the workers' sketches
+ * @param nb_sketches [IN]    number of sketches
+ *
+ * @return nothing (void function)
+ *
+ */
+void nfs_hh_new_window(nfs_hh_sketch_t ** sketches, unsigned int nb_sketches)
+{
+  unsigned int i;
+
+  for(i = 0; i < nb_sketches; i++)
+    {
+      P(sketches[i]->lock);
+      nfs_hh_reset(sketches[i]);
+      V(sketches[i]->lock);
+    }
+}                               /* nfs_hh_new_window */
+
+/**
+ *
+ * nfs_hh_sprint_item: Prints an item of a top-K report.
+ *
+ * The item is printed as "_name_ ops error bytes latency", the latency being
+ * the total service time in milliseconds.
+ *
+ * @param str   [OUT] output buffer
+ * @param size  [IN]  size of the output buffer
+ * @param type  [IN]  type of the report the item comes from
+ * @param pitem [IN]  the item
+ *
+ * @return the number of characters printed, as snprintf.
+ *
+ */
+int nfs_hh_sprint_item(char *str, size_t size, nfs_hh_report_type_t type,
+                       nfs_hh_counter_t * pitem)
+{
+  char addr[INET6_ADDRSTRLEN];
+  char name[INET6_ADDRSTRLEN + 64];
+
+  if(type != NFS_HH_BY_EXPORT)
+    {
+      if(pitem->key.family == 0 ||
+         inet_ntop(pitem->key.family, pitem->key.addr, addr, sizeof(addr)) == NULL)
+        strcpy(addr, "unknown");
+    }
+
+  switch (type)
+    {
+    case NFS_HH_BY_CLIENT:
+      snprintf(name, sizeof(name), "%s", addr);
+      break;
+
+    case NFS_HH_BY_EXPORT:
+      snprintf(name, sizeof(name), "export%u", pitem->key.export_id);
+      break;
+
+    case NFS_HH_BY_TUPLE:
+      if(pitem->key.prog == nfs_param.core_param.nfs_program &&
+         pitem->key.vers == NFS_V3 && pitem->key.proc < NFS_V3_NB_COMMAND)
+        snprintf(name, sizeof(name), "%s,export%u,%s", addr, pitem->key.export_id,
+                 nfsv3_function_names[pitem->key.proc]);
+      else if(pitem->key.prog == nfs_param.core_param.nfs_program &&
+              pitem->key.vers == NFS_V2 && pitem->key.proc < NFS_V2_NB_COMMAND)
+        snprintf(name, sizeof(name), "%s,export%u,%s", addr, pitem->key.export_id,
+                 nfsv2_function_names[pitem->key.proc]);
+      else if(pitem->key.prog == nfs_param.core_param.nfs_program &&
+              pitem->key.vers == NFS_V4 && pitem->key.proc < NFS_V4_NB_COMMAND)
+        snprintf(name, sizeof(name), "%s,export%u,%s", addr, pitem->key.export_id,
+                 nfsv4_function_names[pitem->key.proc]);
+      else
+        snprintf(name, sizeof(name), "%s,export%u,%u.%u.%u", addr,
+                 pitem->key.export_id, pitem->key.prog, pitem->key.vers,
+                 pitem->key.proc);
+      break;
+
+    default:
+      strcpy(name, "unknown");
+      break;
+    }
+
+  return snprintf(str, size, "_%s_ %llu %llu %llu %.2f", name, pitem->nb_ops,
+                  pitem->error, pitem->nb_bytes, (float)pitem->tot_latency / 1000.0);
+}                               /* nfs_hh_sprint_item */
+
+/**
+ *
+ * nfs_hh_request_info: Gets what a request is accounted with in the sketches.
+ *
+ * NFSv2/v3 requests are accounted to the export of their file handle, NFSv4
+ * COMPOUNDs to the export of their first PUTFH. The bytes are the ones read or
+ * written.
+ *
+ * @param preq       [IN]  the request
+ * @param pexport    [IN]  export entry found for the request
+ * @param parg       [IN]  arguments of the request
+ * @param pres       [IN]  result of the request
+ * @param pexport_id [OUT] id of the export, 0 if none
+ * @param pbytes     [OUT] number of bytes read or written
+ *
+ * @return nothing (void function)
+ *
+ */
+void nfs_hh_request_info(struct svc_req *preq, exportlist_t * pexport,
+                         nfs_arg_t * parg, nfs_res_t * pres,
+                         unsigned short *pexport_id, unsigned long long *pbytes)
+{
+  nfs_argop4 *pargop;
+  nfs_resop4 *presop;
+  short exportid;
+  unsigned int i;
+
+  *pexport_id = 0;
+  *pbytes = 0;
+
+  if(preq->rq_prog != nfs_param.core_param.nfs_program || preq->rq_proc == 0)
+    return;
+
+  switch (preq->rq_vers)
+    {
+    case NFS_V2:
+      *pexport_id = pexport->id;
+      if(preq->rq_proc == NFSPROC_READ && pres->res_read2.status == NFS_OK)
+        *pbytes = pres->res_read2.READ2res_u.readok.data.nfsdata2_len;
+      else if(preq->rq_proc == NFSPROC_WRITE)
+        *pbytes = parg->arg_write2.data.nfsdata2_len;
+      break;
+
+    case NFS_V3:
+      *pexport_id = pexport->id;
+      if(preq->rq_proc == NFSPROC3_READ && pres->res_read3.status == NFS3_OK)
+        *pbytes = pres->res_read3.READ3res_u.resok.data.data_len;
+      else if(preq->rq_proc == NFSPROC3_WRITE)
+        *pbytes = parg->arg_write3.data.data_len;
+      break;
+
+    case NFS_V4:
+      for(i = 0; i < parg->arg_compound4.argarray.argarray_len; i++)
+        {
+          pargop = &parg->arg_compound4.argarray.argarray_val[i];
+
+          if(pargop->argop == NFS4_OP_PUTFH && *pexport_id == 0)
+            {
+              exportid = nfs4_FhandleToExportId(&pargop->nfs_argop4_u.opputfh.object);
+              if(exportid > 0)
+                *pexport_id = exportid;
+            }
+          else if(pargop->argop == NFS4_OP_WRITE)
+            *pbytes += pargop->nfs_argop4_u.opwrite.data.data_len;
+        }
+
+      for(i = 0; i < pres->res_compound4.resarray.resarray_len; i++)
+        {
+          presop = &pres->res_compound4.resarray.resarray_val[i];
+
+          if(presop->resop == NFS4_OP_READ && presop->nfs_resop4_u.opread.status == NFS4_OK)
+            *pbytes += presop->nfs_resop4_u.opread.READ4res_u.resok4.data.data_len;
+        }
+      break;
+    }
+}                               /* nfs_hh_request_info */
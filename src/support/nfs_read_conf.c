@@ -76,6 +76,7 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
 #include <fcntl.h>
@@ -269,6 +270,18 @@ int nfs_read_core_conf(config_file_t in_config, nfs_core_parameter_t * pparam)
         {
           pparam->nb_worker = atoi(key_value);
         }
+      else if(!strcasecmp(key_name, "Nb_Min_Worker"))
+        {
+          pparam->nb_min_worker = atoi(key_value);
+        }
+      else if(!strcasecmp(key_name, "Worker_Target_Wait"))
+        {
+          pparam->worker_target_wait = atoi(key_value);
+        }
+      else if(!strcasecmp(key_name, "Worker_Idle_Delay"))
+        {
+          pparam->worker_idle_delay = atoi(key_value);
+        }
       else if(!strcasecmp(key_name, "Nb_Call_Before_Queue_Avg"))
         {
           pparam->nb_call_before_queue_avg = atoi(key_value);
@@ -421,6 +434,22 @@ int nfs_read_core_conf(config_file_t in_config, nfs_core_parameter_t * pparam)
         {
           pparam->tcp_fridge_expiration_delay = atoi(key_value);
         }
+      else if(!strcasecmp(key_name, "Nb_TCP_Receivers"))
+        {
+          pparam->nb_tcp_receivers = atoi(key_value);
+        }
+      else if(!strcasecmp(key_name, "TCP_Send_Queue_Size"))
+        {
+          pparam->tcp_send_queue_size = strtoull(key_value, NULL, 10);
+        }
+      else if(!strcasecmp(key_name, "UDP_Batch_Size"))
+        {
+          pparam->udp_batch_size = atoi(key_value);
+        }
+      else if(!strcasecmp(key_name, "Zero_Copy_Read"))
+        {
+          pparam->zero_copy_read = StrToBoolean(key_value);
+        }
       else if(!strcasecmp(key_name, "Dump_Stats_Per_Client"))
         {
           pparam->dump_stats_per_client = StrToBoolean(key_value);
@@ -0,0 +1,396 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ *
+ * Micro-benchmark tools: runs an operation from several threads, with a
+ * latency histogram per thread (no sharing while measuring), merged at the
+ * end and printed in JSON.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include "BenchStats.h"
+
+typedef struct bench_gate__
+{
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  unsigned int nb_ready;
+  int go;
+} bench_gate_t;
+
+typedef struct bench_thread__
+{
+  pthread_t thrid;
+  bench_def_t *p_bench;
+  bench_gate_t *p_gate;
+  unsigned int index;
+  unsigned long long nb_ops;
+  unsigned long long end_ns;
+  int rc;
+  bench_stat_t stat;
+} bench_thread_t;
+
+unsigned long long BenchStats_Now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}                               /* BenchStats_Now */
+
+static unsigned int BenchStats_Index(unsigned long long ns)
+{
+  unsigned int shift;
+
+  if(ns < 2 * BENCH_HIST_SUB)
+    return (unsigned int)ns;
+
+  if(ns >= (1ULL << BENCH_HIST_MAX_BITS))
+    ns = (1ULL << BENCH_HIST_MAX_BITS) - 1;
+
+  shift = (63 - __builtin_clzll(ns)) - BENCH_HIST_SUB_BITS;
+
+  return (shift + 1) * BENCH_HIST_SUB + (unsigned int)(ns >> shift) - BENCH_HIST_SUB;
+}                               /* BenchStats_Index */
+
+/* highest latency that falls in a bucket */
+static unsigned long long BenchStats_Value(unsigned int index)
+{
+  unsigned int shift;
+  unsigned long long sub;
+
+  if(index < 2 * BENCH_HIST_SUB)
+    return index;
+
+  shift = index / BENCH_HIST_SUB - 1;
+  sub = index % BENCH_HIST_SUB + BENCH_HIST_SUB;
+
+  return ((sub + 1) << shift) - 1;
+}                               /* BenchStats_Value */
+
+void BenchStats_Record(bench_stat_t * p_stat, unsigned long long ns, int is_error)
+{
+  if(is_error)
+    {
+      p_stat->errors++;
+      return;
+    }
+
+  if(p_stat->count == 0 || ns < p_stat->min_ns)
+    p_stat->min_ns = ns;
+  if(ns > p_stat->max_ns)
+    p_stat->max_ns = ns;
+
+  p_stat->count++;
+  p_stat->sum_ns += ns;
+  p_stat->hist[BenchStats_Index(ns)]++;
+}                               /* BenchStats_Record */
+
+void BenchStats_Merge(bench_stat_t * p_to, bench_stat_t * p_from)
+{
+  unsigned int i;
+
+  if(p_from->count != 0)
+    {
+      if(p_to->count == 0 || p_from->min_ns < p_to->min_ns)
+        p_to->min_ns = p_from->min_ns;
+      if(p_from->max_ns > p_to->max_ns)
+        p_to->max_ns = p_from->max_ns;
+    }
+
+  p_to->count += p_from->count;
+  p_to->errors += p_from->errors;
+  p_to->sum_ns += p_from->sum_ns;
+
+  for(i = 0; i < BENCH_HIST_SIZE; i++)
+    p_to->hist[i] += p_from->hist[i];
+}                               /* BenchStats_Merge */
+
+unsigned long long BenchStats_Percentile(bench_stat_t * p_stat, double percent)
+{
+  unsigned long long target;
+  unsigned long long seen = 0;
+  unsigned long long value;
+  unsigned int i;
+
+  if(p_stat->count == 0)
+    return 0;
+
+  target = (unsigned long long)(percent / 100.0 * p_stat->count + 0.999999);
+  if(target == 0)
+    target = 1;
+
+  for(i = 0; i < BENCH_HIST_SIZE; i++)
+    {
+      seen += p_stat->hist[i];
+      if(seen >= target)
+        break;
+    }
+
+  value = BenchStats_Value(i);
+
+  return (value > p_stat->max_ns) ? p_stat->max_ns : value;
+}                               /* BenchStats_Percentile */
+
+/**
+ * BenchStats_GetOptions: reads the options common to all the benchmarks.
+ *
+ *   -t <n1,n2,...> thread counts (default 1,2,4,8)
+ *   -n <nb_ops>    operations per thread
+ *   -o <file>      JSON output (default stdout)
+ *
+ * @return 0 if the benchmark can run, 1 if help was asked, -1 on error.
+ */
+int BenchStats_GetOptions(int argc, char **argv, unsigned long long default_nb_ops,
+                          bench_options_t * p_options)
+{
+  char *str_threads = "1,2,4,8";
+  char *str_out = NULL;
+  char buff[256];
+  char *item;
+  char *saveptr;
+  int option;
+  int nb;
+
+  memset(p_options, 0, sizeof(bench_options_t));
+  p_options->nb_ops = default_nb_ops;
+  p_options->output = stdout;
+
+  while((option = getopt(argc, argv, "ht:n:o:")) != -1)
+    {
+      switch (option)
+        {
+        case 't':
+          str_threads = optarg;
+          break;
+        case 'n':
+          p_options->nb_ops = strtoull(optarg, NULL, 10);
+          break;
+        case 'o':
+          str_out = optarg;
+          break;
+        case 'h':
+        default:
+          fprintf(stderr,
+                  "Usage: %s [-h] [-t <n1,n2,...>] [-n <nb_ops>] [-o <file>]\n"
+                  "  -t: thread counts to run the benchmarks with (default 1,2,4,8)\n"
+                  "  -n: operations per thread (default %llu)\n"
+                  "  -o: write the JSON results to <file> instead of stdout\n",
+                  argv[0], default_nb_ops);
+          return (option == 'h') ? 1 : -1;
+        }
+    }
+
+  strncpy(buff, str_threads, sizeof(buff));
+  buff[sizeof(buff) - 1] = '\0';
+
+  for(item = strtok_r(buff, ",", &saveptr); item != NULL;
+      item = strtok_r(NULL, ",", &saveptr))
+    {
+      nb = atoi(item);
+      if(nb <= 0 || p_options->nb_thread_counts == BENCH_MAX_THREAD_COUNTS)
+        {
+          fprintf(stderr, "%s: invalid thread counts \"%s\"\n", argv[0], str_threads);
+          return -1;
+        }
+      p_options->thread_counts[p_options->nb_thread_counts++] = nb;
+      if(nb > p_options->max_threads)
+        p_options->max_threads = nb;
+    }
+
+  if(p_options->nb_thread_counts == 0 || p_options->nb_ops == 0)
+    {
+      fprintf(stderr, "%s: nothing to run\n", argv[0]);
+      return -1;
+    }
+
+  if(str_out != NULL && (p_options->output = fopen(str_out, "w")) == NULL)
+    {
+      perror(str_out);
+      return -1;
+    }
+
+  return 0;
+}                               /* BenchStats_GetOptions */
+
+void BenchStats_Begin(bench_options_t * p_options, char *suite)
+{
+  char hostname[256];
+
+  if(gethostname(hostname, sizeof(hostname)) != 0)
+    strcpy(hostname, "unknown");
+  hostname[sizeof(hostname) - 1] = '\0';
+
+  fprintf(p_options->output,
+          "{\"suite\": \"%s\", \"host\": \"%s\", \"cpus\": %ld, \"date\": %lu,\n"
+          " \"results\": [", suite, hostname, sysconf(_SC_NPROCESSORS_ONLN),
+          (unsigned long)time(NULL));
+  p_options->nb_results = 0;
+}                               /* BenchStats_Begin */
+
+void BenchStats_End(bench_options_t * p_options)
+{
+  fprintf(p_options->output, "\n]}\n");
+  fflush(p_options->output);
+
+  if(p_options->output != stdout)
+    fclose(p_options->output);
+}                               /* BenchStats_End */
+
+static void *BenchStats_Thread(void *arg)
+{
+  bench_thread_t *p_thr = (bench_thread_t *) arg;
+  bench_def_t *p_bench = p_thr->p_bench;
+  bench_gate_t *p_gate = p_thr->p_gate;
+  unsigned long long iter;
+  unsigned long long start;
+  unsigned long long end = 0;
+  int rc;
+
+  if(p_bench->thread_init != NULL)
+    p_thr->rc = p_bench->thread_init(p_bench->arg, p_thr->index);
+
+  /* everybody starts at the same time, once all the threads are ready */
+  pthread_mutex_lock(&p_gate->lock);
+  p_gate->nb_ready++;
+  pthread_cond_broadcast(&p_gate->cond);
+  while(!p_gate->go)
+    pthread_cond_wait(&p_gate->cond, &p_gate->lock);
+  pthread_mutex_unlock(&p_gate->lock);
+
+  if(p_thr->rc == 0)
+    for(iter = 0; iter < p_thr->nb_ops; iter++)
+      {
+        start = BenchStats_Now();
+        rc = p_bench->op(p_bench->arg, p_thr->index, iter);
+        end = BenchStats_Now();
+
+        BenchStats_Record(&p_thr->stat, end - start, rc != 0);
+      }
+
+  p_thr->end_ns = (end != 0) ? end : BenchStats_Now();
+
+  if(p_bench->thread_fini != NULL)
+    p_bench->thread_fini(p_bench->arg, p_thr->index);
+
+  return NULL;
+}                               /* BenchStats_Thread */
+
+/**
+ * BenchStats_Run: runs a benchmark with nb_threads threads and prints its results.
+ *
+ * @return 0 if OK, -1 if the threads could not be run or a thread_init failed.
+ */
+int BenchStats_Run(bench_options_t * p_options, bench_def_t * p_bench,
+                   unsigned int nb_threads)
+{
+  bench_thread_t *threads;
+  bench_stat_t *p_total;
+  bench_gate_t gate;
+  unsigned long long start;
+  unsigned long long end = 0;
+  double elapsed_sec;
+  unsigned int nb_started = 0;
+  unsigned int i;
+  int rc = 0;
+
+  threads = (bench_thread_t *) calloc(nb_threads, sizeof(bench_thread_t));
+  p_total = (bench_stat_t *) calloc(1, sizeof(bench_stat_t));
+  if(threads == NULL || p_total == NULL)
+    {
+      free(threads);
+      free(p_total);
+      return -1;
+    }
+
+  pthread_mutex_init(&gate.lock, NULL);
+  pthread_cond_init(&gate.cond, NULL);
+  gate.nb_ready = 0;
+  gate.go = 0;
+
+  for(i = 0; i < nb_threads; i++)
+    {
+      threads[i].p_bench = p_bench;
+      threads[i].p_gate = &gate;
+      threads[i].index = i;
+      threads[i].nb_ops = p_options->nb_ops;
+
+      if(pthread_create(&threads[i].thrid, NULL, BenchStats_Thread, &threads[i]) != 0)
+        {
+          rc = -1;
+          break;
+        }
+      nb_started++;
+    }
+
+  pthread_mutex_lock(&gate.lock);
+  while(gate.nb_ready < nb_started)
+    pthread_cond_wait(&gate.cond, &gate.lock);
+  start = BenchStats_Now();
+  gate.go = 1;
+  pthread_cond_broadcast(&gate.cond);
+  pthread_mutex_unlock(&gate.lock);
+
+  for(i = 0; i < nb_started; i++)
+    {
+      pthread_join(threads[i].thrid, NULL);
+
+      if(threads[i].rc != 0)
+        rc = -1;
+      if(threads[i].end_ns > end)
+        end = threads[i].end_ns;
+
+      BenchStats_Merge(p_total, &threads[i].stat);
+    }
+
+  pthread_mutex_destroy(&gate.lock);
+  pthread_cond_destroy(&gate.cond);
+
+  elapsed_sec = (end > start) ? (end - start) / 1000000000.0 : 0.000000001;
+
+  fprintf(p_options->output,
+          "%s\n  {\"bench\": \"%s\", \"threads\": %u, \"ops\": %llu, \"errors\": %llu,"
+          " \"elapsed_sec\": %.6f, \"ops_per_sec\": %.1f,\n"
+          "   \"latency_ns\": {\"min\": %llu, \"mean\": %.1f, \"p50\": %llu, \"p90\": %llu,"
+          " \"p99\": %llu, \"p99.9\": %llu, \"max\": %llu}, \"status\": \"%s\"}",
+          p_options->nb_results ? "," : "", p_bench->name, nb_threads, p_total->count,
+          p_total->errors, elapsed_sec, p_total->count / elapsed_sec, p_total->min_ns,
+          p_total->count ? (double)p_total->sum_ns / p_total->count : 0.0,
+          BenchStats_Percentile(p_total, 50.0), BenchStats_Percentile(p_total, 90.0),
+          BenchStats_Percentile(p_total, 99.0), BenchStats_Percentile(p_total, 99.9),
+          p_total->max_ns, rc ? "failed" : "ok");
+  fflush(p_options->output);
+  p_options->nb_results++;
+
+  free(threads);
+  free(p_total);
+
+  return rc;
+}                               /* BenchStats_Run */